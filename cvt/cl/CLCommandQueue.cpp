@@ -25,8 +25,50 @@
 #include <cvt/cl/CLCommandQueue.h>
 #include <cvt/cl/CLContext.h>
 #include <cvt/cl/CLDevice.h>
+#include <cvt/util/Profiler.h>
+#include <cvt/util/Mutex.h>
 
 namespace cvt {
+	/* kernel launches waiting for their device timings */
+	struct CLProfileKernel {
+		const char* name;
+		uint64_t	host;
+		CLEvent		event;
+	};
+
+	static Mutex						 _clProfileMutex;
+	static std::vector<CLProfileKernel>	 _clProfilePending;
+
+	/* resolve the finished kernels, the lock has to be held */
+	static void _clProfileResolve()
+	{
+		size_t n = 0;
+		for( size_t i = 0; i < _clProfilePending.size(); i++ ) {
+			CLProfileKernel& k = _clProfilePending[ i ];
+			try {
+				cl_int status = k.event.status();
+				if( status > CL_COMPLETE ) {
+					// still queued, submitted or running
+					_clProfilePending[ n++ ] = k;
+					continue;
+				}
+				if( status < 0 )
+					continue;
+				/* map the device time to the host time using the enqueue timestamp */
+				cl_ulong queued = k.event.profilingQueued();
+				Profiler::gpuZone( k.name, k.host + ( k.event.profilingStart() - queued ), k.host + ( k.event.profilingEnd() - queued ) );
+			} catch( CLException& ) {
+			}
+		}
+		_clProfilePending.resize( n );
+	}
+
+	static void _clProfileCollect()
+	{
+		ScopeLock lock( &_clProfileMutex );
+		_clProfileResolve();
+	}
+
 	CLCommandQueue::CLCommandQueue( cl_command_queue q ) : CLObject<cl_command_queue>( q )
 	{
 	}
@@ -59,4 +101,35 @@ namespace cvt {
 		return CLDevice( _device() );
 	}
 
+	/**
+	  Remember the kernel launch, its device timings are added to the profiler as soon as it finished.
+	  Kernels still running when exporting the profile are missing, call finish() before.
+	 */
+	void CLCommandQueue::profileKernel( const CLKernel& kernel, const CLEvent& event )
+	{
+		uint64_t host = Profiler::timestamp();
+		if( !( properties() & CL_QUEUE_PROFILING_ENABLE ) )
+			return;
+
+		String name;
+		kernel.functionName( name );
+
+		CLProfileKernel k;
+		k.name = Profiler::intern( name );
+		k.host = host;
+		k.event = event;
+
+		static bool registered = false;
+		ScopeLock lock( &_clProfileMutex );
+		if( !registered ) {
+			Profiler::addCollector( _clProfileCollect );
+			registered = true;
+		}
+		_clProfilePending.push_back( k );
+
+		// do not let the pending launches pile up between two exports
+		if( _clProfilePending.size() >= 256 )
+			_clProfileResolve();
+	}
+
 }
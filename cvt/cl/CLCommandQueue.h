@@ -90,6 +90,8 @@ namespace cvt {
 									   const CLNDRange& offset = CLNDRange(), const std::vector<CLEvent>* waitevents = NULL, CLEvent* event = NULL );
 
 		private:
+			void profileKernel( const CLKernel& kernel, const CLEvent& event );
+
 			CLUTIL_GETINFOTYPE( _context, CL_QUEUE_CONTEXT, cl_context, _object, ::clGetCommandQueueInfo );
 			CLUTIL_GETINFOTYPE( _device, CL_QUEUE_DEVICE, cl_device_id, _object, ::clGetCommandQueueInfo );
 	};
@@ -253,11 +255,20 @@ namespace cvt {
 													  const CLNDRange& offset, const std::vector<CLEvent>* waitevents , CLEvent* event )
 	{
 		cl_int err;
+#ifdef CVT_PROFILE
+		// the device timings are only available with an event
+		CLEvent profileEvent;
+		if( !event )
+			event = &profileEvent;
+#endif
 		err = ::clEnqueueNDRangeKernel( _object, kernel, global.dimension(), offset.dimension()?offset.range():NULL, global.range(),
 									    local.dimension()?local.range():NULL,
 										waitevents?waitevents->size() : 0, waitevents?( const cl_event* ) &(*waitevents)[0]:NULL, ( cl_event* ) event );
 		if( err != CL_SUCCESS )
 			throw CLException( __PRETTY_FUNCTION__, err );
+#ifdef CVT_PROFILE
+		profileKernel( kernel, *event );
+#endif
 	}
 
 	inline void CLCommandQueue::enqueueAcquireGLObject( const CLMemory& mem, const std::vector<CLEvent>* waitevents , CLEvent* event )
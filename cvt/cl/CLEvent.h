@@ -45,6 +45,11 @@ namespace cvt {
 			CLUTIL_GETINFOTYPE( type, CL_EVENT_COMMAND_TYPE, cl_command_type, _object, ::clGetEventInfo )
 			CLUTIL_GETINFOTYPE( status, CL_EVENT_COMMAND_EXECUTION_STATUS, cl_int, _object, ::clGetEventInfo )
 
+			/* device time in nanoseconds, requires a queue with CL_QUEUE_PROFILING_ENABLE */
+			CLUTIL_GETINFOTYPE( profilingQueued, CL_PROFILING_COMMAND_QUEUED, cl_ulong, _object, ::clGetEventProfilingInfo )
+			CLUTIL_GETINFOTYPE( profilingStart, CL_PROFILING_COMMAND_START, cl_ulong, _object, ::clGetEventProfilingInfo )
+			CLUTIL_GETINFOTYPE( profilingEnd, CL_PROFILING_COMMAND_END, cl_ulong, _object, ::clGetEventProfilingInfo )
+
 			void wait() const;
 
 			static void waitEvents( const std::vector<CLEvent>& waitevents );
@@ -33,13 +33,23 @@ namespace cvt {
 	CLDevice*	    CL::_device = NULL;
 	CLCommandQueue* CL::_queue = NULL;
 
+	static inline cl_command_queue_properties _queueProperties()
+	{
+#ifdef CVT_PROFILE
+		// kernel timings for the profiler
+		return CL_QUEUE_PROFILING_ENABLE;
+#else
+		return 0;
+#endif
+	}
+
 	bool CL::setDefaultDevice( const CLDevice& dev )
 	{
 		if( !_ctx ) {
 			_glsharing = false;
 			_ctx = new CLContext( dev.platform(), dev );
 			_device = new CLDevice( dev );
-			_queue = new CLCommandQueue( *_ctx, *_device /*, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE*/ );
+			_queue = new CLCommandQueue( *_ctx, *_device, _queueProperties() /*| CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE*/ );
 			return true;
 		}
 		return false;
@@ -67,7 +77,7 @@ namespace cvt {
 							try {
 								_ctx = new CLContext( clplatforms[ i ], devs[ k ], ctx );
 								_device = new CLDevice( devs[ k ] );
-								_queue = new CLCommandQueue( *_ctx, *_device );
+								_queue = new CLCommandQueue( *_ctx, *_device, _queueProperties() );
 								_glsharing = true;
 								return true;
 							} catch( Exception& e ) {
@@ -72,6 +72,8 @@ namespace cvt
 
 	inline AsyncTCPClient::~AsyncTCPClient()
 	{
+		/* the socket closes the descriptor */
+		unregister();
 		if( _socket )
 			delete _socket;
 	}
@@ -36,6 +36,7 @@ namespace cvt
 	{
 		public:
 			AsyncTCPServer( const String & address, uint16_t port, int maxConnections = 10 );
+			~AsyncTCPServer();
 
 			/* the server is only accepting new connections */
 			void onDataReadable();
@@ -60,6 +61,12 @@ namespace cvt
 		_socket.listen( _maxConnections );	
 	}
 
+	inline AsyncTCPServer::~AsyncTCPServer()
+	{
+		/* _socket closes the descriptor before ~IOHandler would run */
+		unregister();
+	}
+
 	inline void AsyncTCPServer::onDataReadable()
 	{
 		// notify observers, that server has pending Connection request!
@@ -71,6 +71,8 @@ namespace cvt
 
 	inline AsyncUDPClient::~AsyncUDPClient()
 	{
+		/* the socket closes the descriptor */
+		unregister();
 		if( _socket )
 			delete _socket;
 	}
@@ -0,0 +1,513 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/com/SharedFrameRing.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/math/Math.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#define SHAREDFRAMERING_MAGIC	0x52465643
+#define SHAREDFRAMERING_VERSION 1
+#define SHAREDFRAMERING_WRITING ( ~( uint64_t ) 0 )
+
+namespace cvt
+{
+	/*
+	   Layout of the shared segment:
+	   header | reader table | slot table | page aligned slot data
+
+	   Slot states are 0 (empty), SHAREDFRAMERING_WRITING or sequence + 1.
+	   A reader holds a slot by setting its bit in its pinned mask and then
+	   re-checking the slot state; the writer marks a slot as WRITING and then
+	   checks all pinned masks. With a full barrier between the store and the load
+	   on both sides, at least one of them sees the other and backs off.
+	 */
+	struct SharedFrameReaderEntry {
+		volatile int32_t	pid;
+		uint32_t			reserved;
+		volatile uint64_t	pinned;
+		uint8_t				pad[ 48 ];
+	};
+
+	struct SharedFrameSlot {
+		volatile uint64_t	state;
+		uint64_t			offset;
+		uint32_t			width;
+		uint32_t			height;
+		uint32_t			stride;
+		uint32_t			formatID;
+		double				timestamp;
+		uint8_t				pad[ 24 ];
+	};
+
+	struct SharedFrameRingHeader {
+		uint32_t			magic;
+		uint32_t			version;
+		uint32_t			numSlots;
+		volatile int32_t	writerPid;
+		uint64_t			slotSize;
+		volatile uint64_t	published;
+		volatile uint32_t	futex;
+		volatile uint32_t	waiters;
+		uint8_t				pad[ 24 ];
+		SharedFrameReaderEntry readers[ SHAREDFRAMERING_MAXREADERS ];
+		SharedFrameSlot		slots[ SHAREDFRAMERING_MAXSLOTS ];
+	};
+
+	static String _shmName( const String& name )
+	{
+		if( name.length() && name[ 0 ] == '/' )
+			return name;
+		String ret( "/" );
+		ret += name;
+		return ret;
+	}
+
+	static void _throwErrno( const char* msg )
+	{
+		String str( msg );
+		str += strerror( errno );
+		throw CVTException( str.c_str() );
+	}
+
+	static bool _processAlive( int32_t pid )
+	{
+		return pid > 0 && ( kill( pid, 0 ) == 0 || errno != ESRCH );
+	}
+
+#ifdef LINUX
+	static bool _futexWait( volatile uint32_t* addr, uint32_t val, size_t timeoutMs )
+	{
+		struct timespec ts;
+		ts.tv_sec = timeoutMs / 1000;
+		ts.tv_nsec = ( timeoutMs % 1000 ) * 1000000;
+		/* not FUTEX_PRIVATE, the word lives in memory shared between processes */
+		return syscall( SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0 ) == 0 || errno != ETIMEDOUT;
+	}
+
+	static void _futexWake( volatile uint32_t* addr )
+	{
+		syscall( SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+	}
+#endif
+
+	SharedFrame::SharedFrame() :
+		_reader( NULL ),
+		_slot( 0 ),
+		_sequence( 0 ),
+		_timestamp( 0.0 ),
+		_image( NULL )
+	{
+	}
+
+	SharedFrame::~SharedFrame()
+	{
+		release();
+	}
+
+	void SharedFrame::release()
+	{
+		if( !_reader )
+			return;
+		delete _image;
+		_image = NULL;
+		_reader->unpin( _slot );
+		_reader = NULL;
+	}
+
+	SharedFrameWriter::SharedFrameWriter( const String& name, size_t numSlots, size_t slotSize ) :
+		_name( _shmName( name ) ),
+		_fd( -1 ),
+		_base( NULL ),
+		_size( 0 ),
+		_header( NULL ),
+		_pending( -1 ),
+		_view( NULL ),
+		_dropped( 0 )
+	{
+		if( numSlots < 2 || numSlots > SHAREDFRAMERING_MAXSLOTS )
+			throw CVTException( "SharedFrameWriter: invalid number of slots" );
+
+		size_t page = sysconf( _SC_PAGESIZE );
+		slotSize = Math::pad( slotSize, page );
+		size_t dataOffset = Math::pad( sizeof( SharedFrameRingHeader ), page );
+		_size = dataOffset + numSlots * slotSize;
+
+		/* a stale segment of a crashed writer is replaced, attached readers keep the old one */
+		shm_unlink( _name.c_str() );
+		_fd = shm_open( _name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP );
+		if( _fd < 0 )
+			_throwErrno( "SharedFrameWriter: could not create shared memory: " );
+
+		if( ftruncate( _fd, _size ) != 0 ) {
+			::close( _fd );
+			shm_unlink( _name.c_str() );
+			_throwErrno( "SharedFrameWriter: could not resize shared memory: " );
+		}
+
+		void* ptr = mmap( NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+		if( ptr == MAP_FAILED ) {
+			::close( _fd );
+			shm_unlink( _name.c_str() );
+			_throwErrno( "SharedFrameWriter: could not map shared memory: " );
+		}
+		_base = ( uint8_t* ) ptr;
+		_header = ( SharedFrameRingHeader* ) _base;
+
+		/* ftruncate zero-fills: all readers free, all slots empty */
+		_header->version = SHAREDFRAMERING_VERSION;
+		_header->numSlots = numSlots;
+		_header->slotSize = slotSize;
+		_header->writerPid = getpid();
+		for( size_t i = 0; i < numSlots; i++ )
+			_header->slots[ i ].offset = dataOffset + i * slotSize;
+		__sync_synchronize();
+		_header->magic = SHAREDFRAMERING_MAGIC;
+	}
+
+	SharedFrameWriter::~SharedFrameWriter()
+	{
+		delete _view;
+		_header->writerPid = 0;
+		__sync_add_and_fetch( &_header->futex, 1 );
+#ifdef LINUX
+		_futexWake( &_header->futex );
+#endif
+		munmap( _base, _size );
+		::close( _fd );
+		shm_unlink( _name.c_str() );
+	}
+
+	size_t SharedFrameWriter::numSlots() const
+	{
+		return _header->numSlots;
+	}
+
+	size_t SharedFrameWriter::slotSize() const
+	{
+		return _header->slotSize;
+	}
+
+	uint64_t SharedFrameWriter::published() const
+	{
+		return _header->published;
+	}
+
+	uint64_t SharedFrameWriter::pinnedSlots() const
+	{
+		uint64_t mask = 0;
+		for( size_t i = 0; i < SHAREDFRAMERING_MAXREADERS; i++ )
+			mask |= _header->readers[ i ].pinned;
+		return mask;
+	}
+
+	void SharedFrameWriter::reapReaders()
+	{
+		for( size_t i = 0; i < SHAREDFRAMERING_MAXREADERS; i++ ) {
+			SharedFrameReaderEntry& r = _header->readers[ i ];
+			int32_t pid = r.pid;
+			if( pid && !_processAlive( pid ) ) {
+				r.pinned = 0;
+				__sync_bool_compare_and_swap( &r.pid, pid, 0 );
+			}
+		}
+	}
+
+	Image* SharedFrameWriter::begin( size_t width, size_t height, const IFormat& format )
+	{
+		if( _pending >= 0 )
+			throw CVTException( "SharedFrameWriter: begin without commit" );
+
+		size_t stride = Math::pad16( width * format.bpp );
+		if( stride * height > _header->slotSize )
+			throw CVTException( "SharedFrameWriter: frame does not fit into a slot" );
+
+		bool reaped = false;
+		uint64_t tried = 0;
+		while( 1 ) {
+			/* oldest slot not held by any reader */
+			uint64_t busy = pinnedSlots() | tried;
+			int slot = -1;
+			for( size_t i = 0; i < _header->numSlots; i++ ) {
+				if( busy & ( ( uint64_t ) 1 << i ) )
+					continue;
+				if( slot < 0 || _header->slots[ i ].state < _header->slots[ slot ].state )
+					slot = i;
+			}
+
+			if( slot < 0 ) {
+				if( reaped ) {
+					_dropped++;
+					return NULL;
+				}
+				/* readers that died while holding frames */
+				reapReaders();
+				reaped = true;
+				tried = 0;
+				continue;
+			}
+
+			SharedFrameSlot& s = _header->slots[ slot ];
+			uint64_t old = s.state;
+			s.state = SHAREDFRAMERING_WRITING;
+			__sync_synchronize();
+			if( pinnedSlots() & ( ( uint64_t ) 1 << slot ) ) {
+				/* a reader got there first, the data is untouched */
+				s.state = old;
+				tried |= ( uint64_t ) 1 << slot;
+				continue;
+			}
+
+			s.width = width;
+			s.height = height;
+			s.stride = stride;
+			s.formatID = format.formatID;
+			_pending = slot;
+			_view = new Image( width, height, format, _base + s.offset, stride );
+			return _view;
+		}
+	}
+
+	void SharedFrameWriter::commit( double timestamp )
+	{
+		if( _pending < 0 )
+			throw CVTException( "SharedFrameWriter: commit without begin" );
+
+		SharedFrameSlot& s = _header->slots[ _pending ];
+		s.timestamp = timestamp;
+		delete _view;
+		_view = NULL;
+		__sync_synchronize();
+		s.state = _header->published + 1;
+		__sync_synchronize();
+		_header->published++;
+		__sync_add_and_fetch( &_header->futex, 1 );
+		_pending = -1;
+#ifdef LINUX
+		if( _header->waiters )
+			_futexWake( &_header->futex );
+#endif
+	}
+
+	bool SharedFrameWriter::publish( const Image& img, double timestamp )
+	{
+		Image* view = begin( img.width(), img.height(), img.format() );
+		if( !view )
+			return false;
+
+		SIMD* simd = SIMD::instance();
+		size_t sstride, dstride;
+		const uint8_t* src = img.map( &sstride );
+		uint8_t* dst = view->map( &dstride );
+		size_t n = img.width() * img.format().bpp;
+		for( size_t y = 0; y < img.height(); y++ )
+			simd->Memcpy( dst + y * dstride, src + y * sstride, n );
+		view->unmap( dst );
+		img.unmap( src );
+
+		commit( timestamp );
+		return true;
+	}
+
+	SharedFrameReader::SharedFrameReader( const String& name ) :
+		_fd( -1 ),
+		_base( NULL ),
+		_size( 0 ),
+		_header( NULL ),
+		_index( 0 ),
+		_next( 0 ),
+		_dropped( 0 )
+	{
+		memset( _pins, 0, sizeof( _pins ) );
+
+		String shmName = _shmName( name );
+		_fd = shm_open( shmName.c_str(), O_RDWR, 0 );
+		if( _fd < 0 )
+			_throwErrno( "SharedFrameReader: could not open shared memory: " );
+
+		struct stat info;
+		if( fstat( _fd, &info ) != 0 || ( size_t ) info.st_size < sizeof( SharedFrameRingHeader ) ) {
+			::close( _fd );
+			throw CVTException( "SharedFrameReader: not a frame ring" );
+		}
+		_size = info.st_size;
+
+		void* ptr = mmap( NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+		if( ptr == MAP_FAILED ) {
+			::close( _fd );
+			_throwErrno( "SharedFrameReader: could not map shared memory: " );
+		}
+		_base = ( uint8_t* ) ptr;
+		_header = ( SharedFrameRingHeader* ) _base;
+
+		try {
+			if( _header->magic != SHAREDFRAMERING_MAGIC || _header->version != SHAREDFRAMERING_VERSION )
+				throw CVTException( "SharedFrameReader: not a frame ring or incompatible version" );
+			__sync_synchronize();
+
+			int32_t pid = getpid();
+			for( _index = 0; _index < SHAREDFRAMERING_MAXREADERS; _index++ ) {
+				if( __sync_bool_compare_and_swap( &_header->readers[ _index ].pid, 0, pid ) )
+					break;
+			}
+			if( _index == SHAREDFRAMERING_MAXREADERS )
+				throw CVTException( "SharedFrameReader: too many readers" );
+			_header->readers[ _index ].pinned = 0;
+
+			/* only frames overwritten after attaching count as dropped */
+			_next = _header->published;
+			for( size_t i = 0; i < _header->numSlots; i++ ) {
+				uint64_t state = _header->slots[ i ].state;
+				if( state && state != SHAREDFRAMERING_WRITING && state - 1 < _next )
+					_next = state - 1;
+			}
+		} catch( ... ) {
+			munmap( _base, _size );
+			::close( _fd );
+			throw;
+		}
+	}
+
+	SharedFrameReader::~SharedFrameReader()
+	{
+		__sync_lock_test_and_set( &_header->readers[ _index ].pinned, 0 );
+		__sync_lock_test_and_set( &_header->readers[ _index ].pid, 0 );
+		munmap( _base, _size );
+		::close( _fd );
+	}
+
+	bool SharedFrameReader::writerAlive() const
+	{
+		return _processAlive( _header->writerPid );
+	}
+
+	bool SharedFrameReader::pin( size_t slot, uint64_t state )
+	{
+		/* frames of this reader share the bit of their slot */
+		if( _pins[ slot ]++ == 0 )
+			__sync_fetch_and_or( &_header->readers[ _index ].pinned, ( uint64_t ) 1 << slot );
+		if( _header->slots[ slot ].state == state )
+			return true;
+		unpin( slot );
+		return false;
+	}
+
+	void SharedFrameReader::unpin( size_t slot )
+	{
+		if( --_pins[ slot ] )
+			return;
+		__sync_fetch_and_and( &_header->readers[ _index ].pinned, ~( ( uint64_t ) 1 << slot ) );
+	}
+
+	bool SharedFrameReader::acquire( SharedFrame& frame, bool newest )
+	{
+		frame.release();
+
+		while( 1 ) {
+			/* candidate: newest or oldest frame with sequence >= _next */
+			int slot = -1;
+			uint64_t state = 0;
+			for( size_t i = 0; i < _header->numSlots; i++ ) {
+				uint64_t s = _header->slots[ i ].state;
+				if( s == 0 || s == SHAREDFRAMERING_WRITING || s - 1 < _next )
+					continue;
+				if( slot < 0 || ( newest ? s > state : s < state ) ) {
+					slot = i;
+					state = s;
+				}
+			}
+			if( slot < 0 )
+				return false;
+			/* the slot was reused meanwhile - look again */
+			if( !pin( slot, state ) )
+				continue;
+
+			const SharedFrameSlot& s = _header->slots[ slot ];
+			frame._reader = this;
+			frame._slot = slot;
+			frame._sequence = state - 1;
+			frame._timestamp = s.timestamp;
+			frame._image = new Image( s.width, s.height, IFormat::formatForId( ( IFormatID ) s.formatID ),
+									  _base + s.offset, s.stride );
+			if( !newest )
+				_dropped += frame._sequence - _next;
+			_next = frame._sequence + 1;
+			return true;
+		}
+	}
+
+	bool SharedFrameReader::latest( SharedFrame& frame )
+	{
+		return acquire( frame, true );
+	}
+
+	bool SharedFrameReader::next( SharedFrame& frame )
+	{
+		return acquire( frame, false );
+	}
+
+	bool SharedFrameReader::wait( size_t timeoutMs )
+	{
+#ifdef LINUX
+		while( 1 ) {
+			uint32_t seen = _header->futex;
+			__sync_synchronize();
+			if( _header->published > _next )
+				return true;
+			if( !writerAlive() )
+				return false;
+			__sync_add_and_fetch( &_header->waiters, 1 );
+			bool woken = _futexWait( &_header->futex, seen, timeoutMs );
+			__sync_sub_and_fetch( &_header->waiters, 1 );
+			if( !woken )
+				return _header->published > _next;
+		}
+#else
+		for( size_t t = 0; t <= timeoutMs; t++ ) {
+			if( _header->published > _next )
+				return true;
+			if( !writerAlive() )
+				return false;
+			usleep( 1000 );
+		}
+		return false;
+#endif
+	}
+}
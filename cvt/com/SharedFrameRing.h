@@ -0,0 +1,162 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SHAREDFRAMERING_H
+#define CVT_SHAREDFRAMERING_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/util/String.h>
+#include <stdint.h>
+
+#define SHAREDFRAMERING_MAXSLOTS	64
+#define SHAREDFRAMERING_MAXREADERS	32
+
+namespace cvt
+{
+	struct SharedFrameRingHeader;
+	struct SharedFrameSlot;
+	class SharedFrameReader;
+
+	/**
+	  \brief Frame of a SharedFrameRing acquired by a SharedFrameReader.
+
+	  While the frame is held, the producer does not reuse its slot and image()
+	  is a zero-copy view into the shared memory. Copying the image copies the
+	  pixels, which is the way to keep the data after release().
+	*/
+	class SharedFrame
+	{
+		friend class SharedFrameReader;
+
+		public:
+			SharedFrame();
+			~SharedFrame();
+
+			bool			valid() const { return _reader != NULL; }
+			const Image&	image() const { return *_image; }
+			uint64_t		sequence() const { return _sequence; }
+			double			timestamp() const { return _timestamp; }
+
+			void			release();
+
+		private:
+			SharedFrame( const SharedFrame& );
+			SharedFrame& operator=( const SharedFrame& );
+
+			SharedFrameReader*	_reader;
+			size_t				_slot;
+			uint64_t			_sequence;
+			double				_timestamp;
+			Image*				_image;
+	};
+
+	/**
+	  \brief Producer side of a shared-memory frame ring.
+
+	  Creates a named POSIX shared memory segment with a fixed number of slots
+	  of a fixed size. Publishing never blocks: the oldest slot that is not held
+	  by a reader is overwritten, if every slot is held the frame is dropped.
+	  There must be only one writer per ring.
+	*/
+	class SharedFrameWriter
+	{
+		public:
+			SharedFrameWriter( const String& name, size_t numSlots, size_t slotSize );
+			~SharedFrameWriter();
+
+			/* copies the image into a free slot, false if all slots are held by readers */
+			bool	publish( const Image& img, double timestamp = 0.0 );
+
+			/* zero-copy publishing: write into the returned view (NULL if all slots are held), then commit */
+			Image*	begin( size_t width, size_t height, const IFormat& format );
+			void	commit( double timestamp = 0.0 );
+
+			size_t	numSlots() const;
+			size_t	slotSize() const;
+			uint64_t published() const;
+			uint64_t dropped() const { return _dropped; }
+
+		private:
+			SharedFrameWriter( const SharedFrameWriter& );
+			SharedFrameWriter& operator=( const SharedFrameWriter& );
+
+			uint64_t pinnedSlots() const;
+			void	 reapReaders();
+
+			String					_name;
+			int						_fd;
+			uint8_t*				_base;
+			size_t					_size;
+			SharedFrameRingHeader*	_header;
+			int						_pending;
+			Image*					_view;
+			uint64_t				_dropped;
+	};
+
+	/**
+	  \brief Consumer side of a shared-memory frame ring.
+
+	  Any number of readers (up to SHAREDFRAMERING_MAXREADERS) can attach to a
+	  ring. Acquiring a frame is lock-free and does not involve the producer.
+	  A reader is not thread-safe, use one reader per thread.
+	*/
+	class SharedFrameReader
+	{
+		friend class SharedFrame;
+
+		public:
+			SharedFrameReader( const String& name );
+			~SharedFrameReader();
+
+			/* the newest frame not delivered yet */
+			bool	latest( SharedFrame& frame );
+			/* the oldest frame not delivered yet, frames already overwritten are counted as dropped */
+			bool	next( SharedFrame& frame );
+			/* wait until a frame not delivered yet is published, false on timeout */
+			bool	wait( size_t timeoutMs );
+
+			bool	 writerAlive() const;
+			uint64_t dropped() const { return _dropped; }
+
+		private:
+			SharedFrameReader( const SharedFrameReader& );
+			SharedFrameReader& operator=( const SharedFrameReader& );
+
+			bool	acquire( SharedFrame& frame, bool newest );
+			bool	pin( size_t slot, uint64_t state );
+			void	unpin( size_t slot );
+
+			int						_fd;
+			uint8_t*				_base;
+			size_t					_size;
+			SharedFrameRingHeader*	_header;
+			size_t					_index;
+			uint64_t				_next;
+			uint64_t				_dropped;
+			uint32_t				_pins[ SHAREDFRAMERING_MAXSLOTS ];
+	};
+}
+
+#endif
@@ -0,0 +1,192 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/com/SharedFrameRing.h>
+#include <cvt/util/CVTTest.h>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace cvt {
+
+	static void _fill( Image& img, uint8_t value )
+	{
+		size_t stride;
+		uint8_t* ptr = img.map( &stride );
+		for( size_t y = 0; y < img.height(); y++ )
+			memset( ptr + y * stride, value, img.width() * img.format().bpp );
+		img.unmap( ptr );
+	}
+
+	static bool _check( const Image& img, uint8_t value )
+	{
+		size_t stride;
+		bool ret = true;
+		const uint8_t* ptr = img.map( &stride );
+		for( size_t y = 0; y < img.height(); y++ )
+			for( size_t x = 0; x < img.width() * img.format().bpp; x++ )
+				ret &= ptr[ y * stride + x ] == value;
+		img.unmap( ptr );
+		return ret;
+	}
+
+	static bool _testPublishAcquire( const String& name )
+	{
+		SharedFrameWriter writer( name, 4, 64 * 48 * 4 );
+		SharedFrameReader reader( name );
+		Image img( 64, 48, IFormat::RGBA_UINT8 );
+		SharedFrame frame;
+
+		bool ret = !reader.latest( frame ) && !reader.wait( 1 );
+		for( size_t i = 0; i < 3; i++ ) {
+			_fill( img, i + 1 );
+			ret &= writer.publish( img, i * 0.5 );
+		}
+
+		for( size_t i = 0; i < 3; i++ ) {
+			ret &= reader.next( frame );
+			ret &= frame.sequence() == i && frame.timestamp() == i * 0.5;
+			ret &= frame.image().width() == 64 && frame.image().height() == 48 && frame.image().format() == IFormat::RGBA_UINT8;
+			ret &= _check( frame.image(), i + 1 );
+		}
+		ret &= !reader.next( frame ) && !frame.valid();
+
+		/* zero-copy writing and latest() skipping ahead */
+		for( size_t i = 3; i < 6; i++ ) {
+			Image* view = writer.begin( 32, 16, IFormat::GRAY_UINT8 );
+			ret &= view != NULL;
+			_fill( *view, i + 1 );
+			writer.commit( i * 0.5 );
+		}
+		ret &= reader.wait( 0 ) && reader.latest( frame ) && frame.sequence() == 5;
+		ret &= frame.image().format() == IFormat::GRAY_UINT8 && _check( frame.image(), 6 );
+		ret &= !reader.latest( frame ) && reader.dropped() == 0;
+		return ret;
+	}
+
+	static bool _testHeldSlots( const String& name )
+	{
+		SharedFrameWriter writer( name, 4, 16 * 16 );
+		SharedFrameReader reader( name );
+		SharedFrameReader logger( name );
+		Image img( 16, 16, IFormat::GRAY_UINT8 );
+
+		_fill( img, 1 );
+		writer.publish( img );
+
+		/* a held frame is never overwritten */
+		SharedFrame held;
+		bool ret = reader.latest( held );
+		for( size_t i = 0; i < 20; i++ ) {
+			_fill( img, i + 2 );
+			ret &= writer.publish( img );
+		}
+		ret &= held.sequence() == 0 && _check( held.image(), 1 );
+
+		/* the logger only finds the last three frames, the others were overwritten */
+		SharedFrame frame;
+		ret &= logger.next( frame ) && frame.sequence() == 0;
+		ret &= logger.next( frame ) && frame.sequence() == 18 && _check( frame.image(), 19 );
+		ret &= logger.dropped() == 17;
+		frame.release();
+
+		/* with every slot held, publishing drops the frame */
+		SharedFrame f[ 3 ];
+		for( size_t i = 0; i < 3; i++ )
+			ret &= reader.next( f[ i ] );
+		ret &= !writer.publish( img ) && writer.dropped() == 1;
+		f[ 0 ].release();
+		ret &= writer.publish( img );
+		return ret;
+	}
+
+	static bool _testProcesses( const String& name )
+	{
+		const size_t numFrames = 200;
+		SharedFrameWriter writer( name, 8, 320 * 240 );
+
+		pid_t pid = fork();
+		if( pid < 0 )
+			return false;
+		if( pid == 0 ) {
+			bool ok = true;
+			try {
+				SharedFrameReader reader( name );
+				SharedFrame frame;
+				size_t received = 0;
+				while( received < numFrames ) {
+					if( !reader.wait( 2000 ) )
+						break;
+					while( reader.next( frame ) ) {
+						ok &= _check( frame.image(), frame.sequence() & 0xff );
+						received++;
+					}
+				}
+				ok &= received + reader.dropped() == numFrames;
+			} catch( ... ) {
+				ok = false;
+			}
+			_exit( ok ? 0 : 1 );
+		}
+
+		Image img( 320, 240, IFormat::GRAY_UINT8 );
+		/* give the child time to attach */
+		usleep( 100000 );
+		for( size_t i = 0; i < numFrames; i++ ) {
+			Image* view;
+			while( ( view = writer.begin( 320, 240, IFormat::GRAY_UINT8 ) ) == NULL )
+				usleep( 100 );
+			_fill( *view, i & 0xff );
+			writer.commit( i );
+			usleep( 200 );
+		}
+
+		int status;
+		waitpid( pid, &status, 0 );
+		return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+	}
+
+BEGIN_CVTTEST( SharedFrameRing )
+	bool result = true;
+	bool b;
+	String name;
+	name.sprintf( "cvt_framering_test_%d", ( int ) getpid() );
+
+	b = _testPublishAcquire( name );
+	CVTTEST_PRINT( "SharedFrameRing publish/acquire", b );
+	result &= b;
+
+	b = _testHeldSlots( name );
+	CVTTEST_PRINT( "SharedFrameRing held slots and drops", b );
+	result &= b;
+
+	b = _testProcesses( name );
+	CVTTEST_PRINT( "SharedFrameRing across processes", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
@@ -0,0 +1,395 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/geom/KNNIndex.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/Exception.h>
+
+#include <algorithm>
+
+namespace cvt {
+
+#define KNNINDEX_LEAF		 0xffffffff
+#define KNNINDEX_MAXBUCKET	 64
+/* the stack holds at most one entry per tree level */
+#define KNNINDEX_MAXDEPTH	 64
+/* subtrees below this size are not split further for the parallel build */
+#define KNNINDEX_PARALLELMIN 4096
+#define KNNINDEX_BATCHGRAIN	 64
+
+	template<int dim>
+	const size_t KNNIndex<dim>::NONE;
+
+	template<int dim>
+	class KNNIndex<dim>::EntryLess {
+		public:
+			EntryLess( size_t axis ) : _axis( axis ) {}
+			bool operator()( const Entry& a, const Entry& b ) const { return a.c[ _axis ] < b.c[ _axis ]; }
+
+		private:
+			size_t _axis;
+	};
+
+	template<int dim>
+	class KNNIndex<dim>::Builder {
+		public:
+			Builder( KNNIndex<dim>& index, Entry* entries, const std::vector<BuildTask>& tasks ) :
+				_index( index ), _entries( entries ), _tasks( tasks )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t i = begin; i < end; i++ )
+					_index.buildSubtree( _entries, _tasks[ i ].node, _tasks[ i ].begin, _tasks[ i ].end );
+			}
+
+		private:
+			KNNIndex<dim>&					_index;
+			Entry*							_entries;
+			const std::vector<BuildTask>&	_tasks;
+	};
+
+	template<int dim>
+	class KNNIndex<dim>::BatchQuery {
+		public:
+			BatchQuery( const KNNIndex<dim>& index, size_t* indices, float* distSqr, const PointType* queries,
+						size_t k, float maxDistSqr ) :
+				_index( index ), _indices( indices ), _distSqr( distSqr ), _queries( queries ), _k( k ), _maxDistSqr( maxDistSqr )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				ScopedBuffer<float, true> buf( _distSqr ? 1 : _k );
+				for( size_t i = begin; i < end; i++ ) {
+					float* dist = _distSqr ? _distSqr + i * _k : buf.ptr();
+					_index.query( _indices + i * _k, dist, _queries[ i ].ptr(), _k, _maxDistSqr );
+				}
+			}
+
+		private:
+			const KNNIndex<dim>& _index;
+			size_t*				 _indices;
+			float*				 _distSqr;
+			const PointType*	 _queries;
+			size_t				 _k;
+			float				 _maxDistSqr;
+	};
+
+	template<int dim>
+	KNNIndex<dim>::KNNIndex( const PointType* pts, size_t n, size_t bucketSize ) :
+		_size( 0 ), _bucketSize( 0 ), _numNodes( 0 ), _stride( 0 ), _nodes( NULL ), _coords( NULL ), _ids( NULL )
+	{
+		build( n ? pts[ 0 ].ptr() : NULL, n, sizeof( PointType ), bucketSize );
+	}
+
+	template<int dim>
+	KNNIndex<dim>::KNNIndex( const std::vector<PointType>& pts, size_t bucketSize ) :
+		_size( 0 ), _bucketSize( 0 ), _numNodes( 0 ), _stride( 0 ), _nodes( NULL ), _coords( NULL ), _ids( NULL )
+	{
+		build( pts.empty() ? NULL : pts[ 0 ].ptr(), pts.size(), sizeof( PointType ), bucketSize );
+	}
+
+	template<int dim>
+	KNNIndex<dim>::KNNIndex( const PointSet<dim, float>& pts, size_t bucketSize ) :
+		_size( 0 ), _bucketSize( 0 ), _numNodes( 0 ), _stride( 0 ), _nodes( NULL ), _coords( NULL ), _ids( NULL )
+	{
+		build( pts.ptr(), pts.size(), sizeof( float ) * dim, bucketSize );
+	}
+
+	template<int dim>
+	KNNIndex<dim>::KNNIndex( const float* data, size_t n, size_t stride, size_t bucketSize ) :
+		_size( 0 ), _bucketSize( 0 ), _numNodes( 0 ), _stride( 0 ), _nodes( NULL ), _coords( NULL ), _ids( NULL )
+	{
+		build( data, n, stride, bucketSize );
+	}
+
+	template<int dim>
+	KNNIndex<dim>::~KNNIndex()
+	{
+		delete[] _nodes;
+		delete[] _coords;
+		delete[] _ids;
+	}
+
+	template<int dim>
+	void KNNIndex<dim>::build( const float* data, size_t n, size_t stride, size_t bucketSize )
+	{
+		if( n >= ( size_t ) KNNINDEX_LEAF )
+			throw CVTException( "Too many points for KNNIndex" );
+
+		_size = n;
+		_bucketSize = Math::clamp<size_t>( bucketSize, 1, KNNINDEX_MAXBUCKET );
+		if( !n )
+			return;
+
+		Entry* entries = new Entry[ n ];
+		const uint8_t* src = ( const uint8_t* ) data;
+		for( size_t i = 0; i < n; i++ ) {
+			const float* p = ( const float* ) src;
+			for( size_t k = 0; k < dim; k++ )
+				entries[ i ].c[ k ] = p[ k ];
+			entries[ i ].id = i;
+			src += stride;
+		}
+
+		_numNodes = subtreeNodes( n );
+		_nodes = new Node[ _numNodes ];
+
+		/* split the top levels serially until there are enough subtrees for all threads */
+		std::vector<BuildTask> tasks, next;
+		BuildTask root = { 0, 0, n };
+		tasks.push_back( root );
+		size_t minSplit = Math::max<size_t>( _bucketSize, KNNINDEX_PARALLELMIN );
+		size_t numTasks = ParallelFor::numThreads() > 1 ? 4 * ParallelFor::numThreads() : 1;
+		bool split = true;
+		while( split && tasks.size() < numTasks ) {
+			split = false;
+			next.clear();
+			for( size_t i = 0; i < tasks.size(); i++ ) {
+				const BuildTask& t = tasks[ i ];
+				if( t.end - t.begin <= minSplit ) {
+					next.push_back( t );
+					continue;
+				}
+				size_t mid = splitNode( entries, t.node, t.begin, t.end );
+				BuildTask left = { t.node + 1, t.begin, mid };
+				BuildTask right = { _nodes[ t.node ].a, mid, t.end };
+				next.push_back( left );
+				next.push_back( right );
+				split = true;
+			}
+			tasks.swap( next );
+		}
+
+		Builder builder( *this, entries, tasks );
+		ParallelFor::run( builder, 0, tasks.size(), 1 );
+
+		/* the leaves refer to consecutive entries, store them as coordinate planes */
+		_stride = ( n + 3 ) & ~( ( size_t ) 3 );
+		_coords = new float[ dim * _stride ];
+		_ids = new uint32_t[ n ];
+		for( size_t i = 0; i < n; i++ ) {
+			for( size_t k = 0; k < dim; k++ )
+				_coords[ k * _stride + i ] = entries[ i ].c[ k ];
+			_ids[ i ] = entries[ i ].id;
+		}
+		delete[] entries;
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::subtreeNodes( size_t n ) const
+	{
+		if( n <= _bucketSize )
+			return 1;
+		return 1 + subtreeNodes( n >> 1 ) + subtreeNodes( n - ( n >> 1 ) );
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::splitNode( Entry* entries, size_t node, size_t begin, size_t end )
+	{
+		float min[ dim ], max[ dim ];
+		for( size_t k = 0; k < dim; k++ )
+			min[ k ] = max[ k ] = entries[ begin ].c[ k ];
+		for( size_t i = begin + 1; i < end; i++ ) {
+			for( size_t k = 0; k < dim; k++ ) {
+				min[ k ] = Math::min( min[ k ], entries[ i ].c[ k ] );
+				max[ k ] = Math::max( max[ k ], entries[ i ].c[ k ] );
+			}
+		}
+
+		/* split the dimension with the largest extent at the median */
+		size_t axis = 0;
+		for( size_t k = 1; k < dim; k++ )
+			if( max[ k ] - min[ k ] > max[ axis ] - min[ axis ] )
+				axis = k;
+
+		size_t mid = begin + ( ( end - begin ) >> 1 );
+		std::nth_element( entries + begin, entries + mid, entries + end, EntryLess( axis ) );
+
+		Node& n = _nodes[ node ];
+		n.split = entries[ mid ].c[ axis ];
+		n.axis = axis;
+		n.a = node + 1 + subtreeNodes( mid - begin );
+		n.b = 0;
+		return mid;
+	}
+
+	template<int dim>
+	void KNNIndex<dim>::buildSubtree( Entry* entries, size_t node, size_t begin, size_t end )
+	{
+		if( end - begin <= _bucketSize ) {
+			Node& n = _nodes[ node ];
+			n.split = 0.0f;
+			n.axis = KNNINDEX_LEAF;
+			n.a = begin;
+			n.b = end;
+			return;
+		}
+		size_t mid = splitNode( entries, node, begin, end );
+		buildSubtree( entries, node + 1, begin, mid );
+		buildSubtree( entries, _nodes[ node ].a, mid, end );
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::query( size_t* indices, float* dist, const float* pt, size_t k, float maxDistSqr ) const
+	{
+		size_t found = 0;
+
+		if( _size && k ) {
+			struct {
+				uint32_t node;
+				float	 dist;
+			} stack[ KNNINDEX_MAXDEPTH ];
+			float leafDist[ KNNINDEX_MAXBUCKET ];
+			SIMD* simd = SIMD::instance();
+			float worst = maxDistSqr;
+			size_t sp = 0;
+			uint32_t node = 0;
+
+			for( ;; ) {
+				const Node& n = _nodes[ node ];
+				if( n.axis != KNNINDEX_LEAF ) {
+					/* descend into the near side, the far side is at least diff^2 away */
+					float diff = pt[ n.axis ] - n.split;
+					stack[ sp ].node = diff < 0.0f ? n.a : node + 1;
+					stack[ sp ].dist = diff * diff;
+					sp++;
+					node = diff < 0.0f ? node + 1 : n.a;
+					continue;
+				}
+
+				size_t num = n.b - n.a;
+				simd->sqrDistances_f( leafDist, _coords + n.a, _stride, pt, dim, num );
+				for( size_t i = 0; i < num; i++ ) {
+					float d = leafDist[ i ];
+					if( d >= worst )
+						continue;
+					size_t j = found < k ? found++ : k - 1;
+					while( j && dist[ j - 1 ] > d ) {
+						dist[ j ] = dist[ j - 1 ];
+						indices[ j ] = indices[ j - 1 ];
+						j--;
+					}
+					dist[ j ] = d;
+					indices[ j ] = _ids[ n.a + i ];
+					if( found == k )
+						worst = dist[ k - 1 ];
+				}
+
+				while( sp && stack[ sp - 1 ].dist >= worst )
+					sp--;
+				if( !sp )
+					break;
+				node = stack[ --sp ].node;
+			}
+		}
+
+		for( size_t i = found; i < k; i++ ) {
+			indices[ i ] = NONE;
+			dist[ i ] = Math::MAXF;
+		}
+		return found;
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::nearest( const PointType& pt, float maxDist, float* distSqr ) const
+	{
+		size_t idx;
+		float dist;
+		query( &idx, &dist, pt.ptr(), 1, maxDist == Math::MAXF ? Math::MAXF : Math::sqr( maxDist ) );
+		if( distSqr )
+			*distSqr = dist;
+		return idx;
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::knn( size_t* indices, float* distSqr, const PointType& pt, size_t k, float maxDist ) const
+	{
+		float maxDistSqr = maxDist == Math::MAXF ? Math::MAXF : Math::sqr( maxDist );
+		if( distSqr )
+			return query( indices, distSqr, pt.ptr(), k, maxDistSqr );
+		ScopedBuffer<float, true> buf( k );
+		return query( indices, buf.ptr(), pt.ptr(), k, maxDistSqr );
+	}
+
+	template<int dim>
+	void KNNIndex<dim>::knn( size_t* indices, float* distSqr, const PointType* queries, size_t n, size_t k, float maxDist ) const
+	{
+		if( !k )
+			return;
+		BatchQuery batch( *this, indices, distSqr, queries, k, maxDist == Math::MAXF ? Math::MAXF : Math::sqr( maxDist ) );
+		ParallelFor::run( batch, 0, n, KNNINDEX_BATCHGRAIN );
+	}
+
+	template<int dim>
+	size_t KNNIndex<dim>::radiusSearch( std::vector<size_t>& indices, const PointType& pt, float radius, std::vector<float>* distSqr ) const
+	{
+		if( !_size || radius < 0.0f )
+			return 0;
+
+		uint32_t stack[ KNNINDEX_MAXDEPTH ];
+		float leafDist[ KNNINDEX_MAXBUCKET ];
+		SIMD* simd = SIMD::instance();
+		const float* p = pt.ptr();
+		float radiusSqr = Math::sqr( radius );
+		size_t sp = 0;
+		size_t num = indices.size();
+
+		uint32_t node = 0;
+		for( ;; ) {
+			const Node& n = _nodes[ node ];
+			if( n.axis != KNNINDEX_LEAF ) {
+				/* the far side is only visited if the ball crosses the split plane */
+				float diff = p[ n.axis ] - n.split;
+				if( diff * diff <= radiusSqr )
+					stack[ sp++ ] = diff < 0.0f ? n.a : node + 1;
+				node = diff < 0.0f ? node + 1 : n.a;
+				continue;
+			}
+
+			size_t len = n.b - n.a;
+			simd->sqrDistances_f( leafDist, _coords + n.a, _stride, p, dim, len );
+			for( size_t i = 0; i < len; i++ ) {
+				if( leafDist[ i ] <= radiusSqr ) {
+					indices.push_back( _ids[ n.a + i ] );
+					if( distSqr )
+						distSqr->push_back( leafDist[ i ] );
+				}
+			}
+
+			if( !sp )
+				break;
+			node = stack[ --sp ];
+		}
+		return indices.size() - num;
+	}
+
+	template class KNNIndex<2>;
+	template class KNNIndex<3>;
+}
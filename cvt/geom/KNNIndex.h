@@ -0,0 +1,148 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_KNNINDEX_H
+#define CVT_KNNINDEX_H
+
+#include <cvt/math/Math.h>
+#include <cvt/math/Vector.h>
+#include <cvt/geom/PointSet.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  k nearest neighbour and radius search index for 2D and 3D float points.
+
+	  The index is a kd-tree with bucketed leaves. The points are copied and
+	  stored in tree order as one contiguous array of coordinate planes, so
+	  every leaf is a run of at most bucketSize consecutive values per
+	  coordinate and its distances are evaluated with SIMD::sqrDistances_f.
+	  The nodes are stored in preorder, the left child of a node directly
+	  follows it. Queries traverse the tree with an explicit stack, the
+	  construction splits the top levels serially and builds the remaining
+	  subtrees in parallel. Batch queries are distributed across threads.
+
+	  Result indices refer to the order of the points passed to the
+	  constructor, the index does not reference the caller's data after
+	  construction. The points must be finite.
+	*/
+	template<int dim>
+	class KNNIndex {
+		public:
+			typedef typename Vector<dim, float>::TYPE PointType;
+
+			/* index reported for missing neighbours */
+			static const size_t NONE = ( size_t ) -1;
+
+			KNNIndex( const PointType* pts, size_t n, size_t bucketSize = 16 );
+			KNNIndex( const std::vector<PointType>& pts, size_t bucketSize = 16 );
+			KNNIndex( const PointSet<dim, float>& pts, size_t bucketSize = 16 );
+			/* dim floats per point, consecutive points are stride bytes apart, e.g. &features[ 0 ].pt.x with sizeof( Feature ) */
+			KNNIndex( const float* data, size_t n, size_t stride, size_t bucketSize = 16 );
+			~KNNIndex();
+
+			size_t		size() const { return _size; }
+			size_t		bucketSize() const { return _bucketSize; }
+			size_t		numNodes() const { return _numNodes; }
+
+			/**
+			 *	\brief nearest point closer than maxDist
+			 *	\param	distSqr	if not NULL the squared distance of the neighbour
+			 *	\return	the index of the nearest point or NONE
+			 */
+			size_t		nearest( const PointType& pt, float maxDist = Math::MAXF, float* distSqr = NULL ) const;
+
+			/**
+			 *	\brief the k nearest points closer than maxDist sorted by distance
+			 *	\param	indices	at least k indices, entries after the returned number are NONE
+			 *	\param	distSqr	if not NULL at least k squared distances
+			 *	\return	the number of neighbours found
+			 */
+			size_t		knn( size_t* indices, float* distSqr, const PointType& pt, size_t k, float maxDist = Math::MAXF ) const;
+
+			/**
+			 *	\brief knn for n queries, distributed across threads
+			 *	\param	indices	n * k indices, the neighbours of query i start at i * k
+			 *	\param	distSqr	NULL or n * k squared distances
+			 */
+			void		knn( size_t* indices, float* distSqr, const PointType* queries, size_t n, size_t k, float maxDist = Math::MAXF ) const;
+
+			/**
+			 *	\brief append all points with a distance of at most radius in unspecified order
+			 *	\param	distSqr	if not NULL the squared distances are appended as well
+			 *	\return	the number of appended points
+			 */
+			size_t		radiusSearch( std::vector<size_t>& indices, const PointType& pt, float radius, std::vector<float>* distSqr = NULL ) const;
+
+		private:
+			KNNIndex( const KNNIndex& );
+			KNNIndex& operator=( const KNNIndex& );
+
+			struct Node {
+				float		split;
+				uint32_t	axis;	/* LEAF for leaves */
+				uint32_t	a;		/* right child or first point of a leaf */
+				uint32_t	b;		/* end of the points of a leaf */
+			};
+
+			struct Entry {
+				float		c[ dim ];
+				uint32_t	id;
+			};
+
+			struct BuildTask {
+				size_t		node;
+				size_t		begin;
+				size_t		end;
+			};
+
+			class EntryLess;
+			class Builder;
+			class BatchQuery;
+
+			void		build( const float* data, size_t n, size_t stride, size_t bucketSize );
+			size_t		subtreeNodes( size_t n ) const;
+			size_t		splitNode( Entry* entries, size_t node, size_t begin, size_t end );
+			void		buildSubtree( Entry* entries, size_t node, size_t begin, size_t end );
+			/* the k nearest points closer than sqrt( maxDistSqr ), dist has to hold k values */
+			size_t		query( size_t* indices, float* dist, const float* pt, size_t k, float maxDistSqr ) const;
+
+			size_t		_size;
+			size_t		_bucketSize;
+			size_t		_numNodes;
+			size_t		_stride;	/* distance of the coordinate planes in floats */
+			Node*		_nodes;
+			float*		_coords;
+			uint32_t*	_ids;
+	};
+
+	typedef KNNIndex<2> KNNIndex2f;
+	typedef KNNIndex<3> KNNIndex3f;
+
+}
+
+#endif
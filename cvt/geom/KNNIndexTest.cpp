@@ -0,0 +1,258 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/Time.h>
+#include <cvt/math/Vector.h>
+#include <cvt/geom/KNNIndex.h>
+#include <cvt/geom/KDTree.h>
+#include <cvt/geom/PointSet.h>
+#include <cvt/vision/features/Feature.h>
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace cvt {
+
+	template<int dim>
+	static void _knnPoints( std::vector<typename Vector<dim, float>::TYPE>& pts, size_t n, float range )
+	{
+		typename Vector<dim, float>::TYPE vec;
+		pts.clear();
+		while( n-- ) {
+			for( int i = 0; i < dim; i++ )
+				vec[ i ] = Math::rand( -range, range );
+			pts.push_back( vec );
+		}
+	}
+
+	template<int dim>
+	static float _knnDistSqr( const typename Vector<dim, float>::TYPE& a, const typename Vector<dim, float>::TYPE& b )
+	{
+		float d = 0.0f;
+		for( int i = 0; i < dim; i++ )
+			d += Math::sqr( a[ i ] - b[ i ] );
+		return d;
+	}
+
+	template<int dim>
+	static bool _knnCheck( size_t n, size_t k, size_t bucketSize, float maxDist )
+	{
+		typedef typename Vector<dim, float>::TYPE VecType;
+		std::vector<VecType> pts, queries;
+		_knnPoints<dim>( pts, n, 100.0f );
+		/* duplicates end up on both sides of a split */
+		for( size_t i = 0; i < n / 10; i++ )
+			pts.push_back( pts[ i ] );
+		_knnPoints<dim>( queries, 200, 110.0f );
+
+		KNNIndex<dim> index( pts, bucketSize );
+		std::vector<size_t> idx( queries.size() * k ), bidx( queries.size() * k );
+		std::vector<float> dist( queries.size() * k ), bdist( queries.size() * k );
+		index.knn( &bidx[ 0 ], &bdist[ 0 ], &queries[ 0 ], queries.size(), k, maxDist );
+
+		std::vector<float> all( pts.size() );
+		for( size_t q = 0; q < queries.size(); q++ ) {
+			size_t* qidx = &idx[ q * k ];
+			float* qdist = &dist[ q * k ];
+			size_t found = index.knn( qidx, qdist, queries[ q ], k, maxDist );
+
+			for( size_t i = 0; i < pts.size(); i++ )
+				all[ i ] = _knnDistSqr<dim>( pts[ i ], queries[ q ] );
+			std::sort( all.begin(), all.end() );
+			size_t expected = 0;
+			while( expected < k && all[ expected ] < Math::sqr( maxDist ) )
+				expected++;
+
+			if( found != expected ) {
+				std::cout << "KNNIndex found " << found << " neighbours, true: " << expected << std::endl;
+				return false;
+			}
+			for( size_t i = 0; i < k; i++ ) {
+				if( i >= found ) {
+					if( qidx[ i ] != KNNIndex<dim>::NONE )
+						return false;
+					continue;
+				}
+				if( Math::abs( qdist[ i ] - all[ i ] ) > 1e-5f * Math::max( 1.0f, all[ i ] ) ||
+					Math::abs( qdist[ i ] - _knnDistSqr<dim>( pts[ qidx[ i ] ], queries[ q ] ) ) > 1e-5f * Math::max( 1.0f, all[ i ] ) ) {
+					std::cout << "KNNIndex neighbour " << i << " at distance " << Math::sqrt( qdist[ i ] ) << ", true: " << Math::sqrt( all[ i ] ) << std::endl;
+					return false;
+				}
+			}
+		}
+
+		if( idx != bidx || dist != bdist ) {
+			std::cout << "KNNIndex batch queries differ from single queries" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	template<int dim>
+	static bool _knnRadiusCheck( size_t n, size_t bucketSize )
+	{
+		typedef typename Vector<dim, float>::TYPE VecType;
+		std::vector<VecType> pts, queries;
+		_knnPoints<dim>( pts, n, 100.0f );
+		_knnPoints<dim>( queries, 100, 100.0f );
+
+		KNNIndex<dim> index( pts, bucketSize );
+		for( size_t q = 0; q < queries.size(); q++ ) {
+			float radius = Math::rand( 0.0f, 30.0f );
+			std::vector<size_t> result, truth;
+			std::vector<float> dist;
+			index.radiusSearch( result, queries[ q ], radius, &dist );
+			for( size_t i = 0; i < pts.size(); i++ )
+				if( _knnDistSqr<dim>( pts[ i ], queries[ q ] ) <= Math::sqr( radius ) )
+					truth.push_back( i );
+
+			if( dist.size() != result.size() )
+				return false;
+			for( size_t i = 0; i < result.size(); i++ )
+				if( dist[ i ] != _knnDistSqr<dim>( pts[ result[ i ] ], queries[ q ] ) )
+					return false;
+			std::sort( result.begin(), result.end() );
+			if( result != truth ) {
+				std::cout << "KNNIndex found " << result.size() << " points in range, true: " << truth.size() << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool _knnSources()
+	{
+		bool ret = true;
+
+		PointSet3f ptset;
+		for( size_t i = 0; i < 1000; i++ )
+			ptset.add( Vector3f( Math::rand( -1.0f, 1.0f ), Math::rand( -1.0f, 1.0f ), Math::rand( -1.0f, 1.0f ) ) );
+		KNNIndex3f index3( ptset );
+		for( size_t i = 0; i < ptset.size(); i++ ) {
+			float d;
+			size_t id = index3.nearest( ptset[ i ], 0.5f, &d );
+			ret &= id != KNNIndex3f::NONE && d == 0.0f && ptset[ id ] == ptset[ i ];
+		}
+
+		std::vector<Feature> features;
+		for( size_t i = 0; i < 1000; i++ )
+			features.push_back( Feature( Math::rand( 0.0f, 640.0f ), Math::rand( 0.0f, 480.0f ) ) );
+		KNNIndex2f index2( &features[ 0 ].pt.x, features.size(), sizeof( Feature ) );
+		for( size_t i = 0; i < features.size(); i++ ) {
+			size_t id = index2.nearest( features[ i ].pt );
+			ret &= id != KNNIndex2f::NONE && features[ id ].pt == features[ i ].pt;
+		}
+
+		std::vector<Vector2f> empty;
+		KNNIndex2f none( empty );
+		std::vector<size_t> result;
+		ret &= none.nearest( Vector2f( 0.0f, 0.0f ) ) == KNNIndex2f::NONE;
+		ret &= none.radiusSearch( result, Vector2f( 0.0f, 0.0f ), 1.0f ) == 0;
+		return ret;
+	}
+
+	static void _knnBenchmark()
+	{
+		std::vector<Vector3f> pts, queries;
+		_knnPoints<3>( pts, 200000, 100.0f );
+		_knnPoints<3>( queries, 20000, 100.0f );
+		size_t nbrute = 200;
+		double checksum = 0.0;
+		Time t;
+
+		t.reset();
+		KDTree<Vector3f> kdtree( pts );
+		double kdbuild = t.elapsedMilliSeconds();
+		t.reset();
+		KNNIndex3f index( pts );
+		double build = t.elapsedMilliSeconds();
+
+		t.reset();
+		for( size_t q = 0; q < nbrute; q++ ) {
+			float best = Math::MAXF;
+			for( size_t i = 0; i < pts.size(); i++ )
+				best = Math::min( best, _knnDistSqr<3>( pts[ i ], queries[ q ] ) );
+			checksum += best;
+		}
+		double brute = t.elapsedMicroSeconds() / nbrute;
+
+		/* the KDTree is pruned by the given distance */
+		t.reset();
+		for( size_t q = 0; q < nbrute; q++ )
+			checksum += kdtree.locate( queries[ q ], 10.0f );
+		double kdquery = t.elapsedMicroSeconds() / nbrute;
+
+		t.reset();
+		for( size_t q = 0; q < queries.size(); q++ )
+			checksum += index.nearest( queries[ q ] );
+		double query = t.elapsedMicroSeconds() / queries.size();
+
+		std::vector<size_t> idx( queries.size() * 8 );
+		t.reset();
+		index.knn( &idx[ 0 ], NULL, &queries[ 0 ], queries.size(), 1 );
+		double batch = t.elapsedMicroSeconds() / queries.size();
+		t.reset();
+		index.knn( &idx[ 0 ], NULL, &queries[ 0 ], queries.size(), 8 );
+		double batch8 = t.elapsedMicroSeconds() / queries.size();
+		checksum += idx[ 0 ];
+
+		std::cout << "200000 points, build KDTree: " << kdbuild << " ms KNNIndex: " << build << " ms" << std::endl;
+		std::cout << "nearest neighbour, brute force: " << brute << " us KDTree: " << kdquery << " us KNNIndex: " << query
+				  << " us batch: " << batch << " us batch k = 8: " << batch8 << " us ( " << ( checksum != 0.0 ) << " )" << std::endl;
+	}
+
+}
+
+BEGIN_CVTTEST( KNNIndex )
+	bool ret = true;
+	bool b;
+
+	b = cvt::_knnCheck<2>( 5000, 1, 16, cvt::Math::MAXF );
+	b &= cvt::_knnCheck<2>( 5000, 8, 16, cvt::Math::MAXF );
+	b &= cvt::_knnCheck<2>( 5000, 8, 5, 3.0f );
+	CVTTEST_PRINT( "knn Vector 2", b );
+	ret &= b;
+	b = cvt::_knnCheck<3>( 20000, 1, 16, cvt::Math::MAXF );
+	b &= cvt::_knnCheck<3>( 20000, 16, 32, cvt::Math::MAXF );
+	b &= cvt::_knnCheck<3>( 20000, 8, 1, 5.0f );
+	CVTTEST_PRINT( "knn Vector 3", b );
+	ret &= b;
+
+	b = cvt::_knnRadiusCheck<2>( 10000, 16 );
+	b &= cvt::_knnRadiusCheck<3>( 10000, 16 );
+	CVTTEST_PRINT( "radius search", b );
+	ret &= b;
+
+	b = cvt::_knnSources();
+	CVTTEST_PRINT( "PointSet and Feature sources", b );
+	ret &= b;
+
+	/* timings only, the benchmark takes a while */
+	if( getenv( "CVT_KNN_BENCHMARK" ) )
+		cvt::_knnBenchmark();
+
+	return ret;
+END_CVTTEST
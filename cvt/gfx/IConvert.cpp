@@ -28,7 +28,7 @@
 
 namespace cvt {
 
-#define LAST_FORMAT	( IFORMAT_UYVY_UINT8 )
+#define LAST_FORMAT	( IFORMAT_RGBA_HALF )
 
 #define TABLE( table, source, dst ) table[ ( ( source ) - 1 ) * LAST_FORMAT + ( dst ) - 1 ]
 
@@ -155,6 +155,62 @@ namespace cvt {
         CONV( Conv_f_to_u16, dstImage, uint16_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
     }
 
+    static void Conv_f_to_h( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    {
+        SIMD* simd = SIMD::instance();
+        const uint8_t* src;
+        const uint8_t* sbase;
+        size_t sstride;
+        size_t dstride;
+        uint8_t* dst;
+        uint8_t* dbase;
+        size_t h;
+
+        CONV( Conv_f_to_h, dstImage, uint16_t*, sourceImage, float*, sourceImage.width() * dstImage.channels() )
+    }
+
+    static void Conv_h_to_f( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    {
+        SIMD* simd = SIMD::instance();
+        const uint8_t* src;
+        const uint8_t* sbase;
+        size_t sstride;
+        size_t dstride;
+        uint8_t* dst;
+        uint8_t* dbase;
+        size_t h;
+
+        CONV( Conv_h_to_f, dstImage, float*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
+    }
+
+    static void Conv_u8_to_h( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    {
+        SIMD* simd = SIMD::instance();
+        const uint8_t* src;
+        const uint8_t* sbase;
+        size_t sstride;
+        size_t dstride;
+        uint8_t* dst;
+        uint8_t* dbase;
+        size_t h;
+
+        CONV( Conv_u8_to_h, dstImage, uint16_t*, sourceImage, uint8_t*, sourceImage.width() * dstImage.channels() )
+    }
+
+    static void Conv_h_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
+    {
+        SIMD* simd = SIMD::instance();
+        const uint8_t* src;
+        const uint8_t* sbase;
+        size_t sstride;
+        size_t dstride;
+        uint8_t* dst;
+        uint8_t* dbase;
+        size_t h;
+
+        CONV( Conv_h_to_u8, dstImage, uint8_t*, sourceImage, uint16_t*, sourceImage.width() * dstImage.channels() )
+    }
+
     static void Conv_s16_to_u8( Image & dstImage, const Image & sourceImage, IConvertFlags )
     {
         SIMD* simd = SIMD::instance();
@@ -1008,6 +1064,20 @@ namespace cvt {
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_RGBA_UINT8 ) = &Conv_UYVYu8_to_RGBAu8;
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_BGRA_UINT8 ) = &Conv_UYVYu8_to_BGRAu8;
         TABLE( _convertFuncs, IFORMAT_UYVY_UINT8, IFORMAT_GRAY_FLOAT ) = &Conv_UYVYu8_to_GRAYf;
+
+        /* X to HALF */
+        TABLE( _convertFuncs, IFORMAT_GRAY_FLOAT, IFORMAT_GRAY_HALF ) = &Conv_f_to_h;
+        TABLE( _convertFuncs, IFORMAT_RGBA_FLOAT, IFORMAT_RGBA_HALF ) = &Conv_f_to_h;
+        TABLE( _convertFuncs, IFORMAT_GRAY_UINT8, IFORMAT_GRAY_HALF ) = &Conv_u8_to_h;
+        TABLE( _convertFuncs, IFORMAT_RGBA_UINT8, IFORMAT_RGBA_HALF ) = &Conv_u8_to_h;
+
+        /* GRAY_HALF to X */
+        TABLE( _convertFuncs, IFORMAT_GRAY_HALF, IFORMAT_GRAY_FLOAT ) = &Conv_h_to_f;
+        TABLE( _convertFuncs, IFORMAT_GRAY_HALF, IFORMAT_GRAY_UINT8 ) = &Conv_h_to_u8;
+
+        /* RGBA_HALF to X */
+        TABLE( _convertFuncs, IFORMAT_RGBA_HALF, IFORMAT_RGBA_FLOAT ) = &Conv_h_to_f;
+        TABLE( _convertFuncs, IFORMAT_RGBA_HALF, IFORMAT_RGBA_UINT8 ) = &Conv_h_to_u8;
     }
 
     const IConvert& IConvert::instance()
@@ -26,6 +26,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/gfx/IBorder.h>
+#include <cvt/gfx/IFourier.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
 
@@ -163,8 +164,17 @@ namespace cvt {
 
 	}
 
+	/* large kernels are cheaper in the frequency domain */
+	static inline bool useFourier( const Image& dst, const Image& src, size_t cost, size_t threshold )
+	{
+		return cost >= threshold && src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT;
+	}
+
 	void IConvolve::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype, const Color& )
 	{
+		if( useFourier( dst, src, Math::min( kernel.width(), kernel.height() ), FFT_KERNEL_SIZE ) )
+			return IFourier::convolve( dst, src, kernel, btype );
+
 		if( src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT ) {
 			if( src.channels() == 1 )
 				return convolveTemplate<float,float,float,float>( dst, src, kernel.ptr(), kernel.width(), kernel.height(),
@@ -202,6 +212,14 @@ namespace cvt {
 																		  &SIMD::ConvolveHorizontal4u8_to_fx, &SIMD::AddVert_fx_to_u8, btype );
 
 #endif
+		} else if( src.format().type == IFORMAT_TYPE_HALF && dst.format().type == IFORMAT_TYPE_FLOAT ) {
+			/* half input is converted on the fly, accumulation is done in float */
+			if( src.channels() == 1 )
+				return convolveTemplate<float,uint16_t,float,float>( dst, src, kernel.ptr(), kernel.width(), kernel.height(),
+																		  &SIMD::ConvolveHorizontal1h_to_f, &SIMD::AddVert_f, btype );
+			else if( src.channels() == 4 )
+				return convolveTemplate<float,uint16_t,float,float>( dst, src, kernel.ptr(), kernel.width(), kernel.height(),
+																		  &SIMD::ConvolveHorizontal4h_to_f, &SIMD::AddVert_f, btype );
 		}
 
 	}
@@ -212,6 +230,9 @@ namespace cvt {
 		bool symh = hkernel.isSymmetrical();
 		bool symv = vkernel.isSymmetrical();
 
+		if( useFourier( dst, src, hkernel.width() + vkernel.height(), FFT_SEPARABLE_SIZE ) )
+			return IFourier::convolve( dst, src, hkernel, vkernel, btype );
+
 		if( src.format().type == IFORMAT_TYPE_FLOAT && dst.format().type == IFORMAT_TYPE_FLOAT ) {
 
 			if( symh && !symv ) {
@@ -330,6 +351,14 @@ namespace cvt {
 																				  &SIMD::ConvolveHorizontal4u8_to_f, &SIMD::ConvolveClampVert_f_to_u8, btype );
 			}
 #endif
+		} else if( src.format().type == IFORMAT_TYPE_HALF && dst.format().type == IFORMAT_TYPE_FLOAT ) {
+			/* half input is converted on the fly, accumulation is done in float */
+			if( src.channels() == 1 )
+				return convolveSeparableTemplate<float,uint16_t,float,float>( dst, src, hkernel.ptr(), hkernel.width(), vkernel.ptr(), vkernel.height(),
+																			 &SIMD::ConvolveHorizontal1h_to_f, symv ? &SIMD::ConvolveClampVertSym_f : &SIMD::ConvolveClampVert_f, btype );
+			else if( src.channels() == 4 )
+				return convolveSeparableTemplate<float,uint16_t,float,float>( dst, src, hkernel.ptr(), hkernel.width(), vkernel.ptr(), vkernel.height(),
+																			 &SIMD::ConvolveHorizontal4h_to_f, symv ? &SIMD::ConvolveClampVertSym_f : &SIMD::ConvolveClampVert_f, btype );
 		} else if( src.format().type == IFORMAT_TYPE_UINT8 && dst.format().type == IFORMAT_TYPE_INT16 ) {
 			if( symh && !symv ) {
 				if( src.channels() == 1 )
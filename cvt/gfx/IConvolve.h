@@ -35,6 +35,11 @@ namespace cvt
 
 	class IConvolve {
 		public:
+			/* FLOAT images with non separable kernels of at least this width and height ( radius > 15 ) are convolved via FFT */
+			static const size_t FFT_KERNEL_SIZE = 31;
+			/* separable kernels switch to the FFT if width + height reaches this size */
+			static const size_t FFT_SEPARABLE_SIZE = 128;
+
 			static void convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
 			static void convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype = IBORDER_CLAMP, const Color& = Color::BLACK );
 
@@ -0,0 +1,475 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IFilterGraph.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Time.h>
+
+namespace cvt {
+
+	static const size_t IFILTERGRAPH_NONE = ( size_t ) -1;
+
+	class IFilterGraph::NodeRunner {
+		public:
+			NodeRunner( IFilterGraph& graph, const std::vector<Node*>& nodes ) : _graph( graph ), _nodes( nodes ), _errors( nodes.size() ), _failed( 0 )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				for( size_t i = begin; i < end; i++ ) {
+					try {
+						_graph.runNode( *_nodes[ i ] );
+					} catch( const Exception& e ) {
+						_errors[ i ] = e.what();
+						__sync_fetch_and_add( &_failed, 1 );
+					} catch( ... ) {
+						_errors[ i ] = "Unknown exception in filter " + std::string( _nodes[ i ]->filter->name().c_str() );
+						__sync_fetch_and_add( &_failed, 1 );
+					}
+				}
+			}
+
+			void check() const
+			{
+				if( !_failed )
+					return;
+				for( size_t i = 0; i < _errors.size(); i++ ) {
+					if( !_errors[ i ].empty() )
+						throw CVTException( _errors[ i ] );
+				}
+			}
+
+		private:
+			IFilterGraph&			 _graph;
+			const std::vector<Node*>& _nodes;
+			std::vector<std::string> _errors;
+			int						 _failed;
+	};
+
+	IFilterGraph::IFilterGraph() : _compiled( false ), _time( 0 )
+	{
+	}
+
+	IFilterGraph::~IFilterGraph()
+	{
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			delete _nodes[ i ]->params;
+			delete _nodes[ i ];
+		}
+		for( size_t i = 0; i < _images.size(); i++ )
+			delete _images[ i ];
+	}
+
+	size_t IFilterGraph::addInput()
+	{
+		ImageSlot slot;
+		slot.producer = IFILTERGRAPH_NONE;
+		slot.format = IFORMAT_GRAY_UINT8;
+		slot.bound = NULL;
+		for( size_t v = 0; v < NUM_VIEWS; v++ )
+			slot.views[ v ] = NULL;
+		slot.consumers = 0;
+		slot.pending = 0;
+		slot.width = 0;
+		slot.height = 0;
+		_slots.push_back( slot );
+		_compiled = false;
+		return _slots.size() - 1;
+	}
+
+	size_t IFilterGraph::addNode( const IFilter& filter, IFilterType type )
+	{
+		if( !( filter.getIFilterType() & type ) )
+			throw CVTException( "Filter " + std::string( filter.name().c_str() ) + " does not support the requested filter type" );
+
+		Node* n = new Node();
+		n->filter = &filter;
+		n->type = type;
+		n->params = filter.parameterSet();
+		n->level = 0;
+		n->time = 0;
+		n->timeSum = 0;
+		n->runs = 0;
+		/* unconnected images are passed as NULL */
+		for( size_t i = 0; i < n->params->size(); i++ ) {
+			if( n->params->paramInfo( i )->type == PTYPE_IMAGEPTR )
+				n->params->setArg<Image*>( i, NULL );
+		}
+		_nodes.push_back( n );
+		_compiled = false;
+		return _nodes.size() - 1;
+	}
+
+	size_t IFilterGraph::imageParam( Node& n, const std::string& param )
+	{
+		size_t h = n.params->paramHandle( param );
+		if( n.params->paramInfo( h )->type != PTYPE_IMAGEPTR )
+			throw CVTException( "Parameter \"" + param + "\" is not an image" );
+		for( size_t i = 0; i < n.inputHandles.size(); i++ ) {
+			if( n.inputHandles[ i ] == h )
+				throw CVTException( "Parameter \"" + param + "\" is already connected" );
+		}
+		for( size_t i = 0; i < n.outputHandles.size(); i++ ) {
+			if( n.outputHandles[ i ] == h )
+				throw CVTException( "Parameter \"" + param + "\" is already connected" );
+		}
+		return h;
+	}
+
+	void IFilterGraph::connect( size_t node, const std::string& param, size_t image )
+	{
+		Node& n = checkNode( node );
+		checkImage( image );
+		size_t h = imageParam( n, param );
+		if( !n.params->paramInfo( h )->isInput )
+			throw CVTException( "Parameter \"" + param + "\" is not an input" );
+		n.inputs.push_back( image );
+		n.inputHandles.push_back( h );
+		_compiled = false;
+	}
+
+	size_t IFilterGraph::output( size_t node, const std::string& param, const IFormat& format )
+	{
+		Node& n = checkNode( node );
+		size_t h = imageParam( n, param );
+		if( n.params->paramInfo( h )->isInput )
+			throw CVTException( "Parameter \"" + param + "\" is not an output" );
+
+		size_t image = addInput();
+		_slots[ image ].producer = node;
+		_slots[ image ].format = format.formatID;
+		n.outputs.push_back( image );
+		n.outputHandles.push_back( h );
+		return image;
+	}
+
+	void IFilterGraph::bindInput( size_t image, const Image& img )
+	{
+		ImageSlot& slot = checkImage( image );
+		if( slot.producer != IFILTERGRAPH_NONE )
+			throw CVTException( "Image is not a graph input" );
+		slot.bound = const_cast<Image*>( &img );
+	}
+
+	void IFilterGraph::bindOutput( size_t image, Image& img )
+	{
+		ImageSlot& slot = checkImage( image );
+		if( slot.producer == IFILTERGRAPH_NONE )
+			throw CVTException( "Image is not produced by a node" );
+		slot.bound = &img;
+	}
+
+	double IFilterGraph::nodeTime( size_t node ) const
+	{
+		return checkNode( node ).time;
+	}
+
+	double IFilterGraph::nodeTimeAverage( size_t node ) const
+	{
+		const Node& n = checkNode( node );
+		return n.runs ? n.timeSum / ( double ) n.runs : 0.0;
+	}
+
+	void IFilterGraph::clearPool()
+	{
+		for( size_t i = 0; i < _images.size(); i++ )
+			delete _images[ i ];
+		_images.clear();
+		_free.clear();
+	}
+
+	IFilterGraph::Node& IFilterGraph::checkNode( size_t node )
+	{
+		if( node >= _nodes.size() )
+			throw CVTException( "Invalid node" );
+		return *_nodes[ node ];
+	}
+
+	const IFilterGraph::Node& IFilterGraph::checkNode( size_t node ) const
+	{
+		if( node >= _nodes.size() )
+			throw CVTException( "Invalid node" );
+		return *_nodes[ node ];
+	}
+
+	IFilterGraph::ImageSlot& IFilterGraph::checkImage( size_t image )
+	{
+		if( image >= _slots.size() )
+			throw CVTException( "Invalid image" );
+		return _slots[ image ];
+	}
+
+	void IFilterGraph::compile()
+	{
+		size_t nnodes = _nodes.size();
+		std::vector<size_t> deps( nnodes, 0 );
+		std::vector< std::vector<size_t> > users( _slots.size() );
+		std::vector<size_t> queue;
+
+		for( size_t i = 0; i < _slots.size(); i++ )
+			_slots[ i ].consumers = 0;
+
+		for( size_t i = 0; i < nnodes; i++ ) {
+			Node& n = *_nodes[ i ];
+			for( size_t p = 0; p < n.params->size(); p++ ) {
+				const ParamInfo* info = n.params->paramInfo( p );
+				if( info->type != PTYPE_IMAGEPTR || info->isInput )
+					continue;
+				size_t o = 0;
+				while( o < n.outputHandles.size() && n.outputHandles[ o ] != p )
+					o++;
+				if( o == n.outputHandles.size() )
+					throw CVTException( "Output \"" + info->name + "\" of filter " + std::string( n.filter->name().c_str() ) + " is not connected" );
+			}
+
+			for( size_t k = 0; k < n.inputs.size(); k++ ) {
+				ImageSlot& slot = _slots[ n.inputs[ k ] ];
+				slot.consumers++;
+				if( slot.producer != IFILTERGRAPH_NONE ) {
+					users[ n.inputs[ k ] ].push_back( i );
+					deps[ i ]++;
+				}
+			}
+			n.level = 0;
+			if( !deps[ i ] )
+				queue.push_back( i );
+		}
+
+		/* topological order, the level of a node is the longest path from the graph inputs */
+		size_t nlevels = 0;
+		for( size_t q = 0; q < queue.size(); q++ ) {
+			Node& n = *_nodes[ queue[ q ] ];
+			nlevels = Math::max( nlevels, n.level + 1 );
+			for( size_t o = 0; o < n.outputs.size(); o++ ) {
+				const std::vector<size_t>& u = users[ n.outputs[ o ] ];
+				for( size_t k = 0; k < u.size(); k++ ) {
+					Node& un = *_nodes[ u[ k ] ];
+					un.level = Math::max( un.level, n.level + 1 );
+					if( !--deps[ u[ k ] ] )
+						queue.push_back( u[ k ] );
+				}
+			}
+		}
+		if( queue.size() != nnodes )
+			throw CVTException( "Filter graph contains a cycle" );
+
+		_levels.clear();
+		_levels.resize( nlevels );
+		for( size_t i = 0; i < nnodes; i++ )
+			_levels[ _nodes[ i ]->level ].push_back( i );
+		_compiled = true;
+	}
+
+	size_t IFilterGraph::viewType( IFilterType type )
+	{
+		return type == IFILTER_OPENCL ? VIEW_CL : VIEW_MEM;
+	}
+
+	static inline size_t _IFilterGraphViewIndex( const Image& img )
+	{
+		return img.memType() == IALLOCATOR_CL ? 1 : 0;
+	}
+
+	Image* IFilterGraph::acquire( IFormatID format, size_t width, size_t height, size_t type )
+	{
+		const IFormat& fmt = IFormat::formatForId( format );
+		IAllocatorType memtype = type == VIEW_CL ? IALLOCATOR_CL : IALLOCATOR_MEM;
+
+		/* prefer an image needing no reallocation, then one of the same memory type */
+		size_t best = IFILTERGRAPH_NONE;
+		int bestscore = -1;
+		for( size_t i = 0; i < _free.size() && bestscore < 2; i++ ) {
+			Image* img = _free[ i ];
+			int score = 0;
+			if( img->memType() == memtype ) {
+				score = 1;
+				if( img->width() == width && img->height() == height && img->format() == fmt )
+					score = 2;
+			}
+			if( score > bestscore ) {
+				best = i;
+				bestscore = score;
+			}
+		}
+
+		Image* img;
+		if( best == IFILTERGRAPH_NONE ) {
+			img = new Image( width, height, fmt, memtype );
+			_images.push_back( img );
+		} else {
+			img = _free[ best ];
+			_free[ best ] = _free.back();
+			_free.pop_back();
+			img->reallocate( width, height, fmt, memtype );
+		}
+		return img;
+	}
+
+	void IFilterGraph::release( ImageSlot& slot )
+	{
+		for( size_t v = 0; v < NUM_VIEWS; v++ ) {
+			if( slot.views[ v ] && slot.views[ v ] != slot.bound )
+				_free.push_back( slot.views[ v ] );
+			slot.views[ v ] = NULL;
+		}
+	}
+
+	Image* IFilterGraph::view( ImageSlot& slot, size_t type )
+	{
+		if( slot.views[ type ] )
+			return slot.views[ type ];
+
+		const Image* src = NULL;
+		for( size_t v = 0; v < NUM_VIEWS && !src; v++ )
+			src = slot.views[ v ];
+		if( !src )
+			throw CVTException( "Filter graph input is not bound" );
+
+		/* one copy per backend, shared by all consumers */
+		Image* img = acquire( src->format().formatID, src->width(), src->height(), type );
+		*img = *src;
+		slot.views[ type ] = img;
+		return img;
+	}
+
+	void IFilterGraph::prepareNode( Node& n )
+	{
+		size_t type = viewType( n.type );
+
+		for( size_t i = 0; i < n.inputs.size(); i++ )
+			n.params->setArg<Image*>( n.inputHandles[ i ], view( _slots[ n.inputs[ i ] ], type ) );
+
+		for( size_t i = 0; i < n.outputs.size(); i++ ) {
+			ImageSlot& slot = _slots[ n.outputs[ i ] ];
+			Image* img = slot.bound;
+			if( !img ) {
+				/* size of the previous execution or of the first input, the filter reallocates if needed */
+				size_t w = slot.width, h = slot.height;
+				if( !w && n.inputs.size() ) {
+					const Image* in = n.params->arg<Image*>( n.inputHandles[ 0 ] );
+					w = in->width();
+					h = in->height();
+				}
+				img = acquire( slot.format, Math::max<size_t>( w, 1 ), Math::max<size_t>( h, 1 ), type );
+				slot.views[ type ] = img;
+			}
+			n.params->setArg<Image*>( n.outputHandles[ i ], img );
+		}
+	}
+
+	void IFilterGraph::runNode( Node& n )
+	{
+		Time t;
+		n.filter->apply( n.params, n.type );
+		n.time = t.elapsedMilliSeconds();
+		n.timeSum += n.time;
+		n.runs++;
+	}
+
+	void IFilterGraph::finishNode( Node& n )
+	{
+		for( size_t i = 0; i < n.outputs.size(); i++ ) {
+			ImageSlot& slot = _slots[ n.outputs[ i ] ];
+			Image* img = n.params->arg<Image*>( n.outputHandles[ i ] );
+			/* the filter may have moved the image to another memory type */
+			for( size_t v = 0; v < NUM_VIEWS; v++ )
+				slot.views[ v ] = NULL;
+			slot.views[ _IFilterGraphViewIndex( *img ) ] = img;
+			slot.width = img->width();
+			slot.height = img->height();
+			slot.pending = slot.consumers;
+			if( !slot.consumers )
+				release( slot );
+		}
+
+		for( size_t i = 0; i < n.inputs.size(); i++ ) {
+			n.params->setArg<Image*>( n.inputHandles[ i ], NULL );
+			ImageSlot& slot = _slots[ n.inputs[ i ] ];
+			if( !--slot.pending )
+				release( slot );
+		}
+	}
+
+	void IFilterGraph::execute()
+	{
+		if( !_compiled )
+			compile();
+
+		for( size_t i = 0; i < _slots.size(); i++ ) {
+			ImageSlot& slot = _slots[ i ];
+			if( slot.producer != IFILTERGRAPH_NONE )
+				continue;
+			if( !slot.bound && slot.consumers )
+				throw CVTException( "Filter graph input is not bound" );
+			if( slot.bound )
+				slot.views[ _IFilterGraphViewIndex( *slot.bound ) ] = slot.bound;
+			slot.pending = slot.consumers;
+		}
+
+		Time t;
+		std::vector<Node*> cpu;
+		try {
+			for( size_t l = 0; l < _levels.size(); l++ ) {
+				const std::vector<size_t>& level = _levels[ l ];
+
+				/* pool and residency bookkeeping is done by this thread only */
+				cpu.clear();
+				for( size_t i = 0; i < level.size(); i++ ) {
+					Node& n = *_nodes[ level[ i ] ];
+					prepareNode( n );
+					if( n.type == IFILTER_CPU )
+						cpu.push_back( &n );
+				}
+
+				for( size_t i = 0; i < level.size(); i++ ) {
+					Node& n = *_nodes[ level[ i ] ];
+					if( n.type != IFILTER_CPU )
+						runNode( n );
+				}
+
+				/* a single CPU node keeps the worker threads for itself */
+				if( cpu.size() == 1 ) {
+					runNode( *cpu[ 0 ] );
+				} else if( cpu.size() > 1 ) {
+					NodeRunner runner( *this, cpu );
+					ParallelFor::run( runner, 0, cpu.size(), 1 );
+					runner.check();
+				}
+
+				for( size_t i = 0; i < level.size(); i++ )
+					finishNode( *_nodes[ level[ i ] ] );
+			}
+		} catch( ... ) {
+			for( size_t i = 0; i < _slots.size(); i++ )
+				release( _slots[ i ] );
+			throw;
+		}
+
+		for( size_t i = 0; i < _slots.size(); i++ )
+			release( _slots[ i ] );
+		_time = t.elapsedMilliSeconds();
+	}
+}
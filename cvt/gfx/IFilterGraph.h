@@ -0,0 +1,179 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_IFILTERGRAPH_H
+#define CVT_IFILTERGRAPH_H
+
+#include <cvt/gfx/IFilter.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/ParamSet.h>
+#include <cvt/util/Exception.h>
+
+#include <vector>
+#include <string>
+
+namespace cvt {
+
+	/**
+	  Reusable graph of IFilter applications.
+
+	  Images are referred to by handles. Graph inputs and outputs are bound to
+	  user images, all other images are intermediates owned by the graph. An
+	  intermediate is taken from a pool of images when its producer runs and
+	  returned as soon as its last consumer has finished, so intermediates of
+	  one execution share memory and nothing is allocated once the sizes of
+	  consecutive executions stay the same.
+
+	  An image is kept in the memory of the backend that produced it. If a
+	  node of another backend consumes it, one copy is made and shared by all
+	  consumers of that backend, consecutive OpenCL nodes never go through
+	  host memory.
+
+	  Nodes are executed in dependency levels. CPU nodes of the same level run
+	  concurrently on the ParallelFor threads, OpenCL and OpenGL nodes run on
+	  the calling thread. The duration of every node is measured.
+
+	  \code
+		IFilterGraph graph;
+		size_t in  = graph.addInput();
+		size_t box = graph.addNode( boxfilter );
+		graph.connect( box, "Input", in );
+		graph.setArg<int>( box, "Radius", 3 );
+		size_t tmp = graph.output( box, "Output", IFormat::GRAY_FLOAT );
+		size_t gf  = graph.addNode( guidedfilter );
+		graph.connect( gf, "Input", tmp );
+		graph.connect( gf, "Guide", in );
+		...
+		size_t out = graph.output( gf, "Output", IFormat::GRAY_FLOAT );
+
+		graph.bindInput( in, frame );
+		graph.bindOutput( out, result );
+		graph.execute();
+	  \endcode
+	*/
+	class IFilterGraph {
+		public:
+			IFilterGraph();
+			~IFilterGraph();
+
+			/* handle of a new graph input image */
+			size_t addInput();
+			/* add an application of filter with the given backend, returns the node handle */
+			size_t addNode( const IFilter& filter, IFilterType type = IFILTER_CPU );
+
+			/* set a non-image parameter of a node */
+			template<typename T>
+			void setArg( size_t node, const std::string& param, T value );
+
+			/* use image as input parameter param of node */
+			void connect( size_t node, const std::string& param, size_t image );
+			/* handle of the image written to output parameter param of node, format is the requested output format */
+			size_t output( size_t node, const std::string& param, const IFormat& format );
+
+			void bindInput( size_t image, const Image& img );
+			/* the result is left in the memory of the producing backend */
+			void bindOutput( size_t image, Image& img );
+
+			void execute();
+
+			size_t numNodes() const { return _nodes.size(); }
+			/* time of the last execution of node in ms */
+			double nodeTime( size_t node ) const;
+			/* average time of node over all executions in ms */
+			double nodeTimeAverage( size_t node ) const;
+			/* time of the last execution in ms */
+			double executionTime() const { return _time; }
+
+			/* images owned by the graph, either in use or pooled */
+			size_t numPooledImages() const { return _images.size(); }
+			void clearPool();
+
+		private:
+			IFilterGraph( const IFilterGraph& );
+			IFilterGraph& operator=( const IFilterGraph& );
+
+			enum { VIEW_MEM = 0, VIEW_CL = 1, NUM_VIEWS = 2 };
+
+			struct ImageSlot {
+				size_t	   producer;
+				IFormatID  format;
+				Image*	   bound;
+				Image*	   views[ NUM_VIEWS ];
+				size_t	   consumers;
+				size_t	   pending;
+				size_t	   width;
+				size_t	   height;
+			};
+
+			struct Node {
+				const IFilter*		filter;
+				IFilterType			type;
+				ParamSet*			params;
+				std::vector<size_t> inputs;
+				std::vector<size_t> inputHandles;
+				std::vector<size_t> outputs;
+				std::vector<size_t> outputHandles;
+				size_t				level;
+				double				time;
+				double				timeSum;
+				size_t				runs;
+			};
+
+			class NodeRunner;
+
+			Node& checkNode( size_t node );
+			const Node& checkNode( size_t node ) const;
+			ImageSlot& checkImage( size_t image );
+			size_t imageParam( Node& n, const std::string& param );
+			void compile();
+			void prepareNode( Node& n );
+			void runNode( Node& n );
+			void finishNode( Node& n );
+			static size_t viewType( IFilterType type );
+			Image* view( ImageSlot& slot, size_t type );
+			Image* acquire( IFormatID format, size_t width, size_t height, size_t type );
+			void release( ImageSlot& slot );
+
+			std::vector<Node*>	   _nodes;
+			std::vector<ImageSlot> _slots;
+			std::vector< std::vector<size_t> > _levels;
+			std::vector<Image*>	   _images;
+			std::vector<Image*>	   _free;
+			bool				   _compiled;
+			double				   _time;
+	};
+
+	template<typename T>
+	inline void IFilterGraph::setArg( size_t node, const std::string& param, T value )
+	{
+		ParamSet* set = checkNode( node ).params;
+		size_t h = set->paramHandle( param );
+		if( set->paramInfo( h )->type == PTYPE_IMAGEPTR )
+			throw CVTException( "Image parameter \"" + param + "\" has to be set with connect or output" );
+		set->setArg<T>( h, value );
+	}
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IFilterGraph.h>
+#include <cvt/gfx/ifilter/GaussIIR.h>
+#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/RNG.h>
+
+namespace cvt {
+
+	static void _filterGraphFill( Image& img, size_t w, size_t h )
+	{
+		RNG rng( 1234 );
+		img.reallocate( w, h, IFormat::GRAY_FLOAT );
+		IMapScoped<float> map( img );
+		for( size_t y = 0; y < h; y++ ) {
+			float* row = map.ptr();
+			for( size_t x = 0; x < w; x++ )
+				row[ x ] = ( ( x / 8 + y / 8 ) & 1 ) * 0.6f + rng.uniform( 0.0f, 0.4f );
+			map++;
+		}
+	}
+
+	static bool _filterGraphCompare( const Image& a, const Image& b )
+	{
+		if( a.width() != b.width() || a.height() != b.height() || a.format() != b.format() )
+			return false;
+		IMapScoped<const float> ma( a );
+		IMapScoped<const float> mb( b );
+		for( size_t y = 0; y < a.height(); y++ ) {
+			const float* ra = ma.ptr();
+			const float* rb = mb.ptr();
+			for( size_t x = 0; x < a.width(); x++ ) {
+				if( Math::abs( ra[ x ] - rb[ x ] ) > 1e-6f )
+					return false;
+			}
+			ma++;
+			mb++;
+		}
+		return true;
+	}
+
+	/* the graph below applied directly */
+	static void _filterGraphReference( Image& dst, const Image& src, const GaussIIR& gauss, const GuidedFilter& guided )
+	{
+		ParamSet* pgauss = gauss.parameterSet();
+		Image a( 1, 1, IFormat::GRAY_FLOAT ), b( 1, 1, IFormat::GRAY_FLOAT ), c( 1, 1, IFormat::GRAY_FLOAT );
+
+		pgauss->setArg<Image*>( 0, const_cast<Image*>( &src ) );
+		pgauss->setArg<Image*>( 1, &a );
+		pgauss->setArg<float>( 2, 1.0f );
+		gauss.apply( pgauss, IFILTER_CPU );
+		pgauss->setArg<Image*>( 1, &b );
+		pgauss->setArg<float>( 2, 3.0f );
+		gauss.apply( pgauss, IFILTER_CPU );
+		guided.applyCPU( c, a, b, 4, 0.01f );
+		pgauss->setArg<Image*>( 0, &c );
+		pgauss->setArg<Image*>( 1, &dst );
+		pgauss->setArg<float>( 2, 1.0f );
+		gauss.apply( pgauss, IFILTER_CPU );
+		delete pgauss;
+	}
+
+BEGIN_CVTTEST( IFilterGraph )
+	bool result = true;
+	GaussIIR gauss;
+	GuidedFilter guided;
+
+	/* two independent blur branches feed the guided filter, followed by another blur */
+	IFilterGraph graph;
+	size_t in = graph.addInput();
+	size_t n0 = graph.addNode( gauss );
+	graph.connect( n0, "Input", in );
+	graph.setArg<float>( n0, "Sigma", 1.0f );
+	size_t a = graph.output( n0, "Output", IFormat::GRAY_FLOAT );
+	size_t n1 = graph.addNode( gauss );
+	graph.connect( n1, "Input", in );
+	graph.setArg<float>( n1, "Sigma", 3.0f );
+	size_t b = graph.output( n1, "Output", IFormat::GRAY_FLOAT );
+	size_t n2 = graph.addNode( guided );
+	graph.connect( n2, "Input", a );
+	graph.connect( n2, "Guide", b );
+	graph.setArg<int>( n2, "Radius", 4 );
+	graph.setArg<float>( n2, "Epsilon", 0.01f );
+	size_t c = graph.output( n2, "Output", IFormat::GRAY_FLOAT );
+	size_t n3 = graph.addNode( gauss );
+	graph.connect( n3, "Input", c );
+	graph.setArg<float>( n3, "Sigma", 1.0f );
+	size_t out = graph.output( n3, "Output", IFormat::GRAY_FLOAT );
+
+	Image src, dst( 1, 1, IFormat::GRAY_FLOAT ), ref( 1, 1, IFormat::GRAY_FLOAT );
+	graph.bindInput( in, src );
+	graph.bindOutput( out, dst );
+
+	bool b0 = true;
+	size_t sizes[ 3 ][ 2 ] = { { 160, 120 }, { 160, 120 }, { 97, 61 } };
+	size_t pooled = 0;
+	for( size_t i = 0; i < 3; i++ ) {
+		_filterGraphFill( src, sizes[ i ][ 0 ], sizes[ i ][ 1 ] );
+		graph.execute();
+		_filterGraphReference( ref, src, gauss, guided );
+		b0 &= _filterGraphCompare( dst, ref );
+		/* intermediates are kept from frame to frame */
+		if( i == 0 )
+			pooled = graph.numPooledImages();
+		b0 &= pooled == 3 && graph.numPooledImages() == pooled;
+	}
+	for( size_t i = 0; i < graph.numNodes(); i++ )
+		b0 &= graph.nodeTime( i ) >= 0 && graph.nodeTimeAverage( i ) >= 0;
+	CVTTEST_PRINT( "branches", b0 );
+	result &= b0;
+
+	/* a chain of blurs only needs two intermediates */
+	IFilterGraph chain;
+	size_t cin = chain.addInput();
+	size_t cimg = cin;
+	for( size_t i = 0; i < 5; i++ ) {
+		size_t n = chain.addNode( gauss );
+		chain.connect( n, "Input", cimg );
+		chain.setArg<float>( n, "Sigma", 1.0f );
+		cimg = chain.output( n, "Output", IFormat::GRAY_FLOAT );
+	}
+	chain.bindInput( cin, src );
+	chain.bindOutput( cimg, dst );
+	chain.execute();
+	bool b3 = chain.numPooledImages() == 2;
+	CVTTEST_PRINT( "buffer reuse", b3 );
+	result &= b3;
+
+	/* cycles and unbound inputs are rejected */
+	bool b1 = false;
+	try {
+		IFilterGraph cyclic;
+		size_t x = cyclic.addNode( gauss );
+		size_t y = cyclic.addNode( gauss );
+		size_t ix = cyclic.output( x, "Output", IFormat::GRAY_FLOAT );
+		size_t iy = cyclic.output( y, "Output", IFormat::GRAY_FLOAT );
+		cyclic.connect( x, "Input", iy );
+		cyclic.connect( y, "Input", ix );
+		cyclic.execute();
+	} catch( const Exception& ) {
+		b1 = true;
+	}
+	bool b2 = false;
+	try {
+		IFilterGraph unbound;
+		size_t i0 = unbound.addInput();
+		size_t x = unbound.addNode( gauss );
+		unbound.connect( x, "Input", i0 );
+		unbound.output( x, "Output", IFormat::GRAY_FLOAT );
+		unbound.execute();
+	} catch( const Exception& ) {
+		b2 = true;
+	}
+	CVTTEST_PRINT( "invalid graphs", b1 && b2 );
+	result &= b1 && b2;
+
+	return result;
+END_CVTTEST
+
+}
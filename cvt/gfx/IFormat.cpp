@@ -50,6 +50,8 @@ namespace cvt {
     const IFormat IFormat::BAYER_GBRG_UINT8		= FORMATDESC( 1, uint8_t	, IFORMAT_BAYER_GBRG_UINT8  , IFORMAT_TYPE_UINT8 );
 	const IFormat IFormat::YUYV_UINT8			= FORMATDESC( 2, uint8_t	, IFORMAT_YUYV_UINT8		, IFORMAT_TYPE_UINT8 );
 	const IFormat IFormat::UYVY_UINT8			= FORMATDESC( 2, uint8_t	, IFORMAT_UYVY_UINT8		, IFORMAT_TYPE_UINT8 );
+	const IFormat IFormat::GRAY_HALF			= FORMATDESC( 1, uint16_t	, IFORMAT_GRAY_HALF			, IFORMAT_TYPE_HALF );
+	const IFormat IFormat::RGBA_HALF			= FORMATDESC( 4, uint16_t	, IFORMAT_RGBA_HALF			, IFORMAT_TYPE_HALF );
 
 #undef FORMATDESC
 
@@ -86,7 +88,9 @@ namespace cvt {
             "BAYER_GRBG_UINT8",
             "BAYER_GBRG_UINT8",
 			"YUYV_UINT8",
-			"UYVY_UINT8"
+			"UYVY_UINT8",
+			"GRAY_HALF",
+			"RGBA_HALF"
 		};
 
 		out << "Format: " << _iformatstring[ f.formatID - 1 ];
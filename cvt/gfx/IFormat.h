@@ -59,7 +59,10 @@ namespace cvt
         IFORMAT_BAYER_GRBG_UINT8,
         IFORMAT_BAYER_GBRG_UINT8,
 		IFORMAT_YUYV_UINT8,
-		IFORMAT_UYVY_UINT8
+		IFORMAT_UYVY_UINT8,
+
+		IFORMAT_GRAY_HALF,
+		IFORMAT_RGBA_HALF
 	};
 
 	enum IFormatType
@@ -68,7 +71,8 @@ namespace cvt
 		IFORMAT_TYPE_UINT8,
 		IFORMAT_TYPE_UINT16,
 		IFORMAT_TYPE_INT16,
-		IFORMAT_TYPE_FLOAT
+		IFORMAT_TYPE_FLOAT,
+		IFORMAT_TYPE_HALF
 	};
 
 	struct IFormat
@@ -104,11 +108,14 @@ namespace cvt
         static const IFormat BAYER_GBRG_UINT8;
 		static const IFormat YUYV_UINT8;
 		static const IFormat UYVY_UINT8;
+		static const IFormat GRAY_HALF;
+		static const IFormat RGBA_HALF;
 
 		static const IFormat& uint8Equivalent( const IFormat& format );
 		static const IFormat& uint16Equivalent( const IFormat& format );
 		static const IFormat& int16Equivalent( const IFormat& format );
 		static const IFormat& floatEquivalent( const IFormat& format );
+		static const IFormat& halfEquivalent( const IFormat& format );
         static const IFormat& formatForId( IFormatID formatID );
 		static const IFormat& glEquivalent( GLenum format, GLenum type );
 
@@ -136,6 +143,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_UINT8;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -146,6 +154,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_UINT8;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -174,6 +183,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_UINT16;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -184,6 +194,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_UINT16;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -203,6 +214,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_INT16;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -213,6 +225,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_INT16;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -232,6 +245,7 @@ namespace cvt
 			case IFORMAT_GRAY_UINT16:
 			case IFORMAT_GRAY_INT16:
 			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
 				return IFormat::GRAY_FLOAT;
 			case IFORMAT_GRAYALPHA_UINT8:
 			case IFORMAT_GRAYALPHA_UINT16:
@@ -242,6 +256,7 @@ namespace cvt
 			case IFORMAT_RGBA_UINT16:
 			case IFORMAT_RGBA_INT16:
 			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
 				return IFormat::RGBA_FLOAT;
 			case IFORMAT_BGRA_UINT8:
 			case IFORMAT_BGRA_UINT16:
@@ -254,6 +269,27 @@ namespace cvt
 		}
 	}
 
+	inline const IFormat & IFormat::halfEquivalent( const IFormat & format )
+	{
+		switch ( format.formatID ) {
+			case IFORMAT_GRAY_UINT8:
+			case IFORMAT_GRAY_UINT16:
+			case IFORMAT_GRAY_INT16:
+			case IFORMAT_GRAY_FLOAT:
+			case IFORMAT_GRAY_HALF:
+				return IFormat::GRAY_HALF;
+			case IFORMAT_RGBA_UINT8:
+			case IFORMAT_RGBA_UINT16:
+			case IFORMAT_RGBA_INT16:
+			case IFORMAT_RGBA_FLOAT:
+			case IFORMAT_RGBA_HALF:
+				return IFormat::RGBA_HALF;
+			default:
+				throw CVTException( "NO HALF equivalent for requested FORMAT" );
+				break;
+		}
+	}
+
 
 	inline void IFormat::toGLFormatType( GLenum& glformat, GLenum& gltype ) const
 	{
@@ -284,6 +320,9 @@ namespace cvt
 
 			case IFORMAT_YUYV_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
 			case IFORMAT_UYVY_UINT8:		glformat = GL_RG; gltype = GL_UNSIGNED_BYTE; break;
+
+			case IFORMAT_GRAY_HALF:			glformat = GL_RED; gltype = GL_HALF_FLOAT; break;
+			case IFORMAT_RGBA_HALF:			glformat = GL_RGBA; gltype = GL_HALF_FLOAT; break;
 			default:
 											throw CVTException( "No equivalent GL format found" );
 											break;
@@ -322,6 +361,9 @@ namespace cvt
 
 			case IFORMAT_YUYV_UINT8:		clorder = CL_RA; cltype = CL_UNORM_INT8; break;
 			case IFORMAT_UYVY_UINT8:		clorder = CL_RA; cltype = CL_UNORM_INT8; break;
+
+			case IFORMAT_GRAY_HALF:			clorder = CL_INTENSITY; cltype = CL_HALF_FLOAT; break;
+			case IFORMAT_RGBA_HALF:			clorder = CL_RGBA; cltype = CL_HALF_FLOAT; break;
 			default:
 				throw CVTException( "No equivalent CL format found" );
 				break;
@@ -339,6 +381,7 @@ namespace cvt
 					case GL_UNSIGNED_SHORT: return IFormat::GRAY_UINT16;
 					case GL_SHORT: return IFormat::GRAY_INT16;
 					case GL_FLOAT: return IFormat::GRAY_FLOAT;
+					case GL_HALF_FLOAT: return IFormat::GRAY_HALF;
 					default:
 						throw CVTException("GL type unsupported");
 						break;
@@ -361,6 +404,7 @@ namespace cvt
 					case GL_UNSIGNED_SHORT: return IFormat::RGBA_UINT16;
 					case GL_SHORT: return IFormat::RGBA_INT16;
 					case GL_FLOAT: return IFormat::RGBA_FLOAT;
+					case GL_HALF_FLOAT: return IFormat::RGBA_HALF;
 					default:
 						throw CVTException("GL type unsupported");
 						break;
@@ -428,6 +472,10 @@ namespace cvt
                 return IFormat::BAYER_GRBG_UINT8;
             case IFORMAT_BAYER_GBRG_UINT8:
                 return IFormat::BAYER_GBRG_UINT8;
+			case IFORMAT_GRAY_HALF:
+				return IFormat::GRAY_HALF;
+			case IFORMAT_RGBA_HALF:
+				return IFormat::RGBA_HALF;
 			default:
 				String msg;
 				msg.sprintf( "UNKNOWN INPUT FORMAT: %d", (int)formatID );
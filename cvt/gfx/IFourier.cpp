@@ -0,0 +1,263 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IFourier.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IKernel.h>
+#include <cvt/math/FFT.h>
+#include <cvt/util/Exception.h>
+#include <vector>
+
+namespace cvt {
+
+	typedef std::vector<Complex<float> > SpectrumBuffer;
+
+	void IFourier::forward( Image& spectrum, const Image& src )
+	{
+		if( src.format() != IFormat::GRAY_FLOAT )
+			throw CVTException( "IFourier::forward: GRAY_FLOAT image expected" );
+
+		size_t w = src.width();
+		size_t h = src.height();
+		spectrum.reallocate( w / 2 + 1, h, IFormat::GRAYALPHA_FLOAT );
+
+		IMapScoped<const float> msrc( src );
+		IMapScoped<float> mdst( spectrum );
+		FFT::realForward2D( ( Complex<float>* ) mdst.ptr(), mdst.stride() / sizeof( Complex<float> ), msrc.ptr(), msrc.stride(), w, h );
+	}
+
+	void IFourier::inverse( Image& dst, const Image& spectrum, size_t width )
+	{
+		if( spectrum.format() != IFormat::GRAYALPHA_FLOAT || spectrum.width() != width / 2 + 1 )
+			throw CVTException( "IFourier::inverse: invalid spectrum" );
+
+		size_t h = spectrum.height();
+		dst.reallocate( width, h, IFormat::GRAY_FLOAT );
+
+		IMapScoped<const float> msrc( spectrum );
+		IMapScoped<float> mdst( dst );
+		FFT::realInverse2D( mdst.ptr(), mdst.stride(), ( const Complex<float>* ) msrc.ptr(), msrc.stride() / sizeof( Complex<float> ), width, h );
+	}
+
+	void IFourier::mulConj( Image& dst, const Image& a, const Image& b )
+	{
+		if( a.format() != IFormat::GRAYALPHA_FLOAT || b.format() != IFormat::GRAYALPHA_FLOAT ||
+			a.width() != b.width() || a.height() != b.height() )
+			throw CVTException( "IFourier::mulConj: spectra do not match" );
+
+		size_t w = a.width();
+		size_t h = a.height();
+		dst.reallocate( w, h, IFormat::GRAYALPHA_FLOAT );
+
+		IMapScoped<const float> ma( a );
+		IMapScoped<const float> mb( b );
+		IMapScoped<float> mdst( dst );
+		for( size_t y = 0; y < h; y++ ) {
+			const Complex<float>* pa = ( const Complex<float>* ) ma.ptr();
+			const Complex<float>* pb = ( const Complex<float>* ) mb.ptr();
+			Complex<float>* pd = ( Complex<float>* ) mdst.ptr();
+			for( size_t x = 0; x < w; x++ )
+				pd[ x ] = pa[ x ] * pb[ x ].conj();
+			ma++;
+			mb++;
+			mdst++;
+		}
+	}
+
+	/*
+	   Correlation of src with the kernel K given as kw x kh float array:
+	   dst( x, y ) = sum K( j, k ) src( x - kw / 2 + j, y - kh / 2 + k )
+	   The image is padded with its border, the product with the conjugate kernel
+	   spectrum yields the correlation without wrap around.
+	 */
+	static void fourierCorrelate( Image& dst, const Image& src, const float* kernel, size_t kw, size_t kh, IBorderType btype )
+	{
+		if( src.format().type != IFORMAT_TYPE_FLOAT )
+			throw CVTException( "IFourier::convolve: FLOAT image expected" );
+
+		const ssize_t w = src.width();
+		const ssize_t h = src.height();
+		const ssize_t b1x = kw >> 1;
+		const ssize_t b1y = kh >> 1;
+		const size_t pw = w + kw - 1;
+		const size_t ph = h + kh - 1;
+		const size_t W = FFTPlan::fastSize( pw );
+		const size_t H = FFTPlan::fastSize( ph );
+		const size_t nc = W / 2 + 1;
+		const size_t channels = src.channels();
+
+		std::vector<float> pad( W * H, 0.0f );
+		SpectrumBuffer kspec( nc * H );
+		SpectrumBuffer ispec( nc * H );
+
+		for( size_t k = 0; k < kh; k++ )
+			for( size_t j = 0; j < kw; j++ )
+				pad[ k * W + j ] = kernel[ k * kw + j ];
+		FFT::realForward2D( &kspec[ 0 ], nc, &pad[ 0 ], W * sizeof( float ), W, H );
+
+		std::vector<ssize_t> xoff( pw );
+		for( size_t u = 0; u < pw; u++ )
+			xoff[ u ] = IBorder::value<ssize_t>( ( ssize_t ) u - b1x, w, btype );
+
+		dst.reallocate( w, h, src.format() );
+
+		IMapScoped<const float> msrc( src );
+		for( size_t c = 0; c < channels; c++ ) {
+			/* gather the channel with border */
+			for( size_t v = 0; v < ph; v++ ) {
+				float* prow = &pad[ v * W ];
+				ssize_t y = IBorder::value<ssize_t>( ( ssize_t ) v - b1y, h, btype );
+				if( y < 0 ) {
+					for( size_t u = 0; u < pw; u++ )
+						prow[ u ] = 0.0f;
+					continue;
+				}
+				const float* srow = msrc.line( y );
+				for( size_t u = 0; u < pw; u++ )
+					prow[ u ] = xoff[ u ] < 0 ? 0.0f : srow[ xoff[ u ] * channels + c ];
+			}
+			for( size_t v = ph; v < H; v++ )
+				for( size_t u = 0; u < W; u++ )
+					pad[ v * W + u ] = 0.0f;
+
+			FFT::realForward2D( &ispec[ 0 ], nc, &pad[ 0 ], W * sizeof( float ), W, H );
+			for( size_t i = 0; i < nc * H; i++ )
+				ispec[ i ] *= kspec[ i ].conj();
+			FFT::realInverse2D( &pad[ 0 ], W * sizeof( float ), &ispec[ 0 ], nc, W, H );
+
+			IMapScoped<float> mdst( dst );
+			for( ssize_t y = 0; y < h; y++ ) {
+				float* drow = mdst.ptr();
+				const float* prow = &pad[ y * W ];
+				for( ssize_t x = 0; x < w; x++ )
+					drow[ x * channels + c ] = prow[ x ];
+				mdst++;
+			}
+		}
+	}
+
+	void IFourier::convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype )
+	{
+		fourierCorrelate( dst, src, kernel.ptr(), kernel.width(), kernel.height(), btype );
+	}
+
+	void IFourier::convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype )
+	{
+		size_t kw = hkernel.width();
+		size_t kh = vkernel.height();
+		std::vector<float> kernel( kw * kh );
+		for( size_t k = 0; k < kh; k++ )
+			for( size_t j = 0; j < kw; j++ )
+				kernel[ k * kw + j ] = hkernel( j, 0 ) * vkernel( 0, k );
+		fourierCorrelate( dst, src, &kernel[ 0 ], kw, kh, btype );
+	}
+
+	/* subpixel offset of a parabola through three samples */
+	static inline float parabolaPeak( float l, float c, float r )
+	{
+		float denom = l - 2.0f * c + r;
+		if( Math::abs( denom ) < Math::EPSILONF )
+			return 0.0f;
+		return Math::clamp( 0.5f * ( l - r ) / denom, -0.5f, 0.5f );
+	}
+
+	Vector2f IFourier::phaseCorrelation( const Image& a, const Image& b, float* response )
+	{
+		if( a.format() != IFormat::GRAY_FLOAT || b.format() != IFormat::GRAY_FLOAT ||
+			a.width() != b.width() || a.height() != b.height() )
+			throw CVTException( "IFourier::phaseCorrelation: GRAY_FLOAT images of equal size expected" );
+
+		const size_t w = a.width();
+		const size_t h = a.height();
+		const size_t W = FFTPlan::fastSize( w );
+		const size_t H = FFTPlan::fastSize( h );
+		const size_t nc = W / 2 + 1;
+
+		/* hann window against the discontinuities at the image border */
+		std::vector<float> wx( w ), wy( h );
+		for( size_t x = 0; x < w; x++ )
+			wx[ x ] = w > 1 ? 0.5f - 0.5f * Math::cos( 2.0f * Math::PI * x / ( float ) ( w - 1 ) ) : 1.0f;
+		for( size_t y = 0; y < h; y++ )
+			wy[ y ] = h > 1 ? 0.5f - 0.5f * Math::cos( 2.0f * Math::PI * y / ( float ) ( h - 1 ) ) : 1.0f;
+
+		std::vector<float> pad( W * H );
+		SpectrumBuffer sa( nc * H ), sb( nc * H );
+		const Image* imgs[ 2 ] = { &a, &b };
+		SpectrumBuffer* specs[ 2 ] = { &sa, &sb };
+		for( size_t i = 0; i < 2; i++ ) {
+			IMapScoped<const float> map( *imgs[ i ] );
+			double mean = 0.0;
+			for( size_t y = 0; y < h; y++ ) {
+				const float* row = map.line( y );
+				for( size_t x = 0; x < w; x++ )
+					mean += row[ x ];
+			}
+			mean /= ( double ) ( w * h );
+
+			std::fill( pad.begin(), pad.end(), 0.0f );
+			for( size_t y = 0; y < h; y++ ) {
+				const float* row = map.line( y );
+				for( size_t x = 0; x < w; x++ )
+					pad[ y * W + x ] = ( row[ x ] - ( float ) mean ) * wx[ x ] * wy[ y ];
+			}
+			FFT::realForward2D( &( *specs[ i ] )[ 0 ], nc, &pad[ 0 ], W * sizeof( float ), W, H );
+		}
+
+		/* normalized cross power spectrum conj( A ) * B / | conj( A ) * B | */
+		for( size_t i = 0; i < nc * H; i++ ) {
+			Complex<float> r = sa[ i ].conj() * sb[ i ];
+			float mag = r.abs();
+			sa[ i ] = mag > 1e-12f ? r / mag : Complex<float>( 0.0f, 0.0f );
+		}
+		FFT::realInverse2D( &pad[ 0 ], W * sizeof( float ), &sa[ 0 ], nc, W, H );
+
+		size_t px = 0, py = 0;
+		float best = pad[ 0 ];
+		for( size_t y = 0; y < H; y++ ) {
+			for( size_t x = 0; x < W; x++ ) {
+				if( pad[ y * W + x ] > best ) {
+					best = pad[ y * W + x ];
+					px = x;
+					py = y;
+				}
+			}
+		}
+
+		Vector2f t;
+		t.x = ( float ) px + parabolaPeak( pad[ py * W + ( px + W - 1 ) % W ], best, pad[ py * W + ( px + 1 ) % W ] );
+		t.y = ( float ) py + parabolaPeak( pad[ ( ( py + H - 1 ) % H ) * W + px ], best, pad[ ( ( py + 1 ) % H ) * W + px ] );
+		/* the correlation is circular: large shifts are negative */
+		if( t.x > W / 2 )
+			t.x -= W;
+		if( t.y > H / 2 )
+			t.y -= H;
+
+		if( response )
+			*response = best;
+		return t;
+	}
+
+}
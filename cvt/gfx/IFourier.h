@@ -0,0 +1,74 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_IFOURIER_H
+#define CVT_IFOURIER_H
+
+#include <cvt/gfx/IBorder.h>
+#include <cvt/math/Vector.h>
+
+namespace cvt
+{
+	class Image;
+	class IKernel;
+
+	/**
+	  \brief Frequency domain operations on images
+
+	  Spectra are stored as GRAYALPHA_FLOAT images ( real, imaginary ) of size
+	  ( width / 2 + 1 ) x height, the redundant half of the spectrum of a real
+	  image is omitted. Transforms use the cached plans of FFTPlan.
+	*/
+	class IFourier {
+		public:
+			/* GRAY_FLOAT image to half spectrum */
+			static void		forward( Image& spectrum, const Image& src );
+			/* half spectrum to GRAY_FLOAT image of the given width */
+			static void		inverse( Image& dst, const Image& spectrum, size_t width );
+			/* dst = a * conj( b ) */
+			static void		mulConj( Image& dst, const Image& a, const Image& b );
+
+			/**
+			  Same result as IConvolve::convolve for FLOAT images, computed in the
+			  frequency domain. The image is padded with the border of the kernel
+			  to a size with only factors 2, 3 and 5.
+			 */
+			static void		convolve( Image& dst, const Image& src, const IKernel& kernel, IBorderType btype = IBORDER_CLAMP );
+			static void		convolve( Image& dst, const Image& src, const IKernel& hkernel, const IKernel& vkernel, IBorderType btype = IBORDER_CLAMP );
+
+			/**
+			  Translation t between two images of equal size with b( x ) = a( x - t ),
+			  estimated by phase correlation with subpixel refinement of the peak.
+			  \param response	height of the normalized correlation peak
+			 */
+			static Vector2f phaseCorrelation( const Image& a, const Image& b, float* response = NULL );
+
+		private:
+			IFourier() {}
+			IFourier( const IFourier& ) {}
+	};
+}
+
+#endif
@@ -22,123 +22,525 @@
    THE SOFTWARE.
 */
 
-
+#include <cvt/gfx/IMorphological.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/ScopedBuffer.h>
-#include <cvt/gfx/IMorphological.h>
+#include <cvt/util/ParallelFor.h>
+
+#include <limits>
+#include <vector>
 
 namespace cvt
 {
+/* rows per band of the horizontal pass */
+#define IMORPH_BANDROWS	  16
+/* pixels per column strip of the vertical and diagonal passes */
+#define IMORPH_STRIPWIDTH 256
 
-	template<typename TYPE>
-	static void morphTemplate( Image& dst, const Image& src, size_t radius,
-								void ( SIMD::*hfunc )( TYPE*, const TYPE*, size_t, size_t ) const,
-								void ( SIMD::*hfuncborder )( TYPE*, const TYPE*, const TYPE*, size_t ) const,
-								void ( SIMD::*vfunc )( TYPE*, const TYPE**, size_t, size_t ) const
-							 )
-	{
-		SIMD* simd = SIMD::instance();
-		const size_t boxsize = radius * 2 + 1;
-		size_t curbuf;
-		size_t w = src.width();
-		size_t h = src.height();
-		size_t bstride = Math::pad16( sizeof( TYPE ) * w ) / sizeof( TYPE ); //FIXME: does this always work - it should
-		TYPE** buf;
-		size_t i;
-
-		IMapScoped<TYPE> mapdst( dst );
-		IMapScoped<const TYPE> mapsrc( src );
-
-		/* allocate and fill buffer */
-		ScopedBuffer<TYPE,true> bufmem( bstride * boxsize );
-		ScopedBuffer<TYPE*,true> bufptr( boxsize );
-
-		buf = bufptr.ptr();
-		buf[ 0 ] = bufmem.ptr();
-		for( i = 0; i < boxsize; i++ ) {
-			if( i != 0 )
-				buf[ i ] = buf[ i - 1 ] + bstride;
-			( simd->*hfunc )( buf[ i ], mapsrc.ptr(), w, radius );
-			mapsrc++;
+	template<typename T>
+	struct IMorphMax {
+		static inline T op( T a, T b ) { return a > b ? a : b; }
+		static inline T identity()
+		{
+			return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::min();
 		}
+	};
 
-		/* upper border */
-		( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, radius + 1, w );
-		for( i = 1; i < radius; i++ ) {
-			TYPE* prev = mapdst.ptr();
-			mapdst++;
-			( simd->*hfuncborder )( mapdst.ptr(), ( const TYPE* ) prev, ( const TYPE* ) buf[ radius + 1 + i ], w );
-		}
-		mapdst++;
-
-		/* center */
-		curbuf = 0;
-		i = h - 2 * radius - 1;
-		( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, boxsize, w );
-		mapdst++;
-		while( i-- ) {
-			( simd->*hfunc )( buf[ curbuf ], mapsrc.ptr(), w, radius );
-			curbuf = ( curbuf + 1 ) % boxsize;
-			( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) buf, boxsize, w );
+	template<typename T>
+	struct IMorphMin {
+		static inline T op( T a, T b ) { return a < b ? a : b; }
+		static inline T identity()
+		{
+			return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+		}
+	};
+
+	/* line segment of 2 * radius + 1 pixels, horizontal or along ( dx, 1 ) */
+	struct IMorphLine {
+		size_t	radius;
+		bool	horizontal;
+		int		dx;
+	};
+
+	/*
+	   van Herk/Gil-Werman: the padded signal is split into blocks of
+	   k = 2 * radius + 1 values, g holds the running extremum from the start
+	   of each block, h the one to the end of each block. Every window of k
+	   values covers the end of one block and the start of the next one, so
+	   out[ x ] = op( h[ x - radius ], g[ x + radius ] ) needs three
+	   comparisons per value for any radius.
+	 */
+	template<typename T, class OP>
+	class IMorphHorizontal {
+		public:
+			IMorphHorizontal( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t width, size_t channels,
+							  size_t radius, void ( SIMD::*rowfunc )( T*, const T*, const T*, size_t ) const ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width ), _channels( channels ),
+				_radius( radius ), _rowfunc( rowfunc )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				SIMD* simd = SIMD::instance();
+				const size_t n = _width * _channels;
+				const size_t pad = _radius * _channels;
+				const size_t len = n + 2 * pad;
+				const size_t block = ( 2 * _radius + 1 ) * _channels;
+				ScopedBuffer<T, true> buf( 3 * len );
+				T* f = buf.ptr();
+				T* g = f + len;
+				T* h = g + len;
+
+				for( size_t i = 0; i < pad; i++ ) {
+					f[ i ] = OP::identity();
+					f[ pad + n + i ] = OP::identity();
+				}
+
+				for( size_t y = begin; y < end; y++ ) {
+					memcpy( f + pad, _src + y * _sstride, sizeof( T ) * n );
+
+					for( size_t b = 0; b < len; b += block ) {
+						size_t e = Math::min( b + block, len );
+						for( size_t i = b; i < b + _channels; i++ )
+							g[ i ] = f[ i ];
+						for( size_t i = b + _channels; i < e; i++ )
+							g[ i ] = OP::op( g[ i - _channels ], f[ i ] );
+						for( size_t i = e - _channels; i < e; i++ )
+							h[ i ] = f[ i ];
+						for( size_t i = e - _channels; i-- > b; )
+							h[ i ] = OP::op( h[ i + _channels ], f[ i ] );
+					}
+
+					( simd->*_rowfunc )( ( T* ) ( _dst + y * _dstride ), h, g + 2 * pad, n );
+				}
+			}
+
+		private:
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_width;
+			size_t			_channels;
+			size_t			_radius;
+			void ( SIMD::*_rowfunc )( T*, const T*, const T*, size_t ) const;
+	};
+
+	/*
+	   van Herk/Gil-Werman along the columns or diagonals, whole rows are
+	   combined with the SIMD row function. For a diagonal with direction
+	   ( dx, 1 ) the running extremum of a row is combined with the previous
+	   row shifted by dx pixels. The image is processed in column strips,
+	   diagonal strips are extended by radius pixels on both sides, values
+	   outside of the image are the identity.
+	 */
+	template<typename T, class OP>
+	class IMorphVertical {
+		public:
+			IMorphVertical( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t width, size_t height,
+							size_t channels, size_t radius, int dx, void ( SIMD::*rowfunc )( T*, const T*, const T*, size_t ) const ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width ), _height( height ),
+				_channels( channels ), _radius( radius ), _dx( dx ), _rowfunc( rowfunc )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				const size_t k = 2 * _radius + 1;
+				const size_t margin = _dx ? _radius : 0;
+				const size_t rowlen = ( IMORPH_STRIPWIDTH + 2 * margin ) * _channels;
+				ScopedBuffer<T, true> buf( ( 3 * k + 2 ) * rowlen );
+				std::vector<T*> rows( 3 * k );
+				for( size_t i = 0; i < 3 * k; i++ )
+					rows[ i ] = buf.ptr() + i * rowlen;
+				T* ident = buf.ptr() + 3 * k * rowlen;
+				T* scratch = ident + rowlen;
+				for( size_t i = 0; i < rowlen; i++ )
+					ident[ i ] = OP::identity();
+
+				for( size_t strip = begin; strip < end; strip++ ) {
+					size_t x0 = strip * IMORPH_STRIPWIDTH;
+					size_t x1 = Math::min( x0 + IMORPH_STRIPWIDTH, _width );
+					process( &rows[ 0 ], &rows[ k ], &rows[ 2 * k ], ident, scratch, x0, x1, margin );
+				}
+			}
+
+		private:
+			/* the source row of padded row q in buffer coordinates */
+			const T* sourceRow( T* scratch, const T* ident, size_t q, size_t x0, size_t margin ) const
+			{
+				if( q < _radius || q >= _height + _radius )
+					return ident;
+				const T* src = ( const T* ) ( _src + ( q - _radius ) * _sstride );
+				if( !margin )
+					return src + x0 * _channels;
+				/* the identity borders of scratch are set per strip */
+				ssize_t sx0 = Math::max<ssize_t>( ( ssize_t ) x0 - ( ssize_t ) margin, 0 );
+				ssize_t sx1 = Math::min( x0 + IMORPH_STRIPWIDTH + margin, _width );
+				memcpy( scratch + ( sx0 - ( ( ssize_t ) x0 - ( ssize_t ) margin ) ) * _channels, src + sx0 * _channels,
+						sizeof( T ) * ( sx1 - sx0 ) * _channels );
+				return scratch;
+			}
+
+			/* dst[ u ] = op( f[ u ], prev[ u - shift ] ), values of prev outside of the row are the identity */
+			void shiftRow( SIMD* simd, T* dst, const T* f, const T* prev, int shift, size_t n ) const
+			{
+				if( !shift ) {
+					( simd->*_rowfunc )( dst, f, prev, n );
+				} else if( shift > 0 ) {
+					memcpy( dst, f, sizeof( T ) * _channels );
+					( simd->*_rowfunc )( dst + _channels, f + _channels, prev, n - _channels );
+				} else {
+					( simd->*_rowfunc )( dst, f, prev + _channels, n - _channels );
+					memcpy( dst + n - _channels, f + n - _channels, sizeof( T ) * _channels );
+				}
+			}
+
+			void process( T** g, T** h, T** hprev, const T* ident, T* scratch, size_t x0, size_t x1, size_t margin ) const
+			{
+				SIMD* simd = SIMD::instance();
+				const size_t k = 2 * _radius + 1;
+				const size_t rows = _height + 2 * _radius;
+				const size_t nblocks = ( rows + k - 1 ) / k;
+				/* the buffer rows cover x0 - margin to x0 + IMORPH_STRIPWIDTH + margin */
+				const size_t n = ( x1 - x0 + 2 * margin ) * _channels;
+				const size_t nout = ( x1 - x0 ) * _channels;
+				const size_t hoff = ( margin - _dx * ( ssize_t ) _radius ) * _channels;
+				const size_t goff = ( margin + _dx * ( ssize_t ) _radius ) * _channels;
+
+				if( margin ) {
+					for( size_t i = 0; i < ( IMORPH_STRIPWIDTH + 2 * margin ) * _channels; i++ )
+						scratch[ i ] = OP::identity();
+				}
+
+				for( size_t b = 0; b <= nblocks; b++ ) {
+					if( b < nblocks ) {
+						size_t q0 = b * k;
+						size_t q1 = Math::min( q0 + k, rows );
+						for( size_t q = q0; q < q1; q++ ) {
+							const T* f = sourceRow( scratch, ident, q, x0, margin );
+							if( q == q0 )
+								memcpy( g[ 0 ], f, sizeof( T ) * n );
+							else
+								shiftRow( simd, g[ q - q0 ], f, g[ q - q0 - 1 ], _dx, n );
+						}
+						for( size_t q = q1; q-- > q0; ) {
+							const T* f = sourceRow( scratch, ident, q, x0, margin );
+							if( q == q1 - 1 )
+								memcpy( h[ q - q0 ], f, sizeof( T ) * n );
+							else
+								shiftRow( simd, h[ q - q0 ], f, h[ q - q0 + 1 ], -_dx, n );
+						}
+					}
+
+					/* outputs whose window starts in the previous block */
+					if( b ) {
+						for( size_t j = 0; j < k; j++ ) {
+							size_t y = ( b - 1 ) * k + j;
+							if( y >= _height )
+								break;
+							T* out = ( T* ) ( _dst + y * _dstride ) + x0 * _channels;
+							if( !j )
+								memcpy( out, hprev[ 0 ] + hoff, sizeof( T ) * nout );
+							else
+								( simd->*_rowfunc )( out, hprev[ j ] + hoff, g[ j - 1 ] + goff, nout );
+						}
+					}
+
+					for( size_t j = 0; j < k; j++ ) {
+						T* tmp = hprev[ j ];
+						hprev[ j ] = h[ j ];
+						h[ j ] = tmp;
+					}
+				}
+			}
+
+			uint8_t*		_dst;
+			size_t			_dstride;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			size_t			_width;
+			size_t			_height;
+			size_t			_channels;
+			size_t			_radius;
+			int				_dx;
+			void ( SIMD::*_rowfunc )( T*, const T*, const T*, size_t ) const;
+	};
+
+	template<typename T, class OP>
+	static void morphLine( Image& dst, const Image& src, const IMorphLine& line,
+						   void ( SIMD::*rowfunc )( T*, const T*, const T*, size_t ) const )
+	{
+		IMapScoped<T> mapdst( dst );
+		IMapScoped<const T> mapsrc( src );
+
+		if( line.horizontal ) {
+			IMorphHorizontal<T, OP> pass( ( uint8_t* ) mapdst.base(), mapdst.stride(), ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+										  src.width(), src.channels(), line.radius, rowfunc );
+			ParallelFor::run( pass, 0, src.height(), IMORPH_BANDROWS );
+		} else {
+			IMorphVertical<T, OP> pass( ( uint8_t* ) mapdst.base(), mapdst.stride(), ( const uint8_t* ) mapsrc.base(), mapsrc.stride(),
+										src.width(), src.height(), src.channels(), line.radius, line.dx, rowfunc );
+			ParallelFor::run( pass, 0, ( src.width() + IMORPH_STRIPWIDTH - 1 ) / IMORPH_STRIPWIDTH, 1 );
+		}
+	}
+
+	/* decompose the structuring element into line segments */
+	static size_t morphLines( IMorphLine* lines, size_t rx, size_t ry, IMorphologicalShape shape )
+	{
+		size_t rh = rx, rv = ry, rd = 0;
+		if( shape == IMORPHOLOGICAL_DISK ) {
+			/* regular octagon: the square and the diagonals contribute r ( sqrt( 2 ) - 1 ) and r ( 1 - 1 / sqrt( 2 ) ),
+			   the sum of the two diagonal segments only covers every second pixel, the square of radius >= 1 closes the gaps */
+			rd = Math::round( ( float ) rx * ( 1.0f - Math::sqrt( 0.5f ) ) );
+			if( rd && rx < 2 * rd + 1 )
+				rd = ( rx - 1 ) / 2;
+			rh = rv = rx - 2 * rd;
+		}
+
+		size_t n = 0;
+		IMorphLine h = { rh, true, 0 };
+		IMorphLine v = { rv, false, 0 };
+		IMorphLine d0 = { rd, false, 1 };
+		IMorphLine d1 = { rd, false, -1 };
+		if( rh ) lines[ n++ ] = h;
+		if( rv ) lines[ n++ ] = v;
+		if( rd ) {
+			lines[ n++ ] = d0;
+			lines[ n++ ] = d1;
+		}
+		return n;
+	}
+
+	/* copy src into the center of dst and fill the border of pad pixels with the identity */
+	template<typename T, class OP>
+	static void morphPad( Image& dst, const Image& src, size_t pad )
+	{
+		IMapScoped<T> mapdst( dst );
+		IMapScoped<const T> mapsrc( src );
+		size_t c = src.channels();
+		size_t n = dst.width() * c;
+
+		for( size_t y = 0; y < dst.height(); y++ ) {
+			T* d = mapdst.ptr();
+			if( y < pad || y >= pad + src.height() ) {
+				for( size_t i = 0; i < n; i++ )
+					d[ i ] = OP::identity();
+			} else {
+				for( size_t i = 0; i < pad * c; i++ ) {
+					d[ i ] = OP::identity();
+					d[ n - 1 - i ] = OP::identity();
+				}
+				memcpy( d + pad * c, mapsrc.ptr(), sizeof( T ) * src.width() * c );
+				mapsrc++;
+			}
 			mapdst++;
-			mapsrc++;
 		}
+	}
 
-		/* lower border */
-		/* reorder buffer */
-		ScopedBuffer<TYPE*,true> bufptr2( boxsize );
-		TYPE** buf2 = bufptr2.ptr();
-		for( i = 0; i < boxsize; i++ )
-			buf2[ i ] = buf[ ( curbuf + i ) % boxsize ];
+	template<typename T>
+	static void morphCrop( Image& dst, const Image& src, size_t pad )
+	{
+		IMapScoped<T> mapdst( dst );
+		IMapScoped<const T> mapsrc( src );
+		size_t c = src.channels();
 
-		for( i = 1; i <= radius; i++ ) {
-			( simd->*vfunc )( mapdst.ptr(), ( const TYPE** ) ( buf2 + i ), boxsize - i, w );
+		mapsrc.setLine( pad );
+		for( size_t y = 0; y < dst.height(); y++ ) {
+			memcpy( mapdst.ptr(), mapsrc.ptr() + pad * c, sizeof( T ) * dst.width() * c );
 			mapdst++;
+			mapsrc++;
 		}
 	}
 
-	void IMorphological::dilate( Image& dst, const Image& src, size_t radius )
+	template<typename T, class OP>
+	static void morphTemplate( Image& dst, const Image& src, size_t rx, size_t ry, IMorphologicalShape shape,
+							   void ( SIMD::*rowfunc )( T*, const T*, const T*, size_t ) const )
 	{
-		if( src.channels() != 1 )
-			throw CVTException( "Not implemented IMorphological::dilate" );
+		IMorphLine lines[ 4 ];
+		size_t n = morphLines( lines, rx, ry, shape );
 
 		dst.reallocate( src.width(), src.height(), src.format() );
+		if( !n ) {
+			dst = src;
+			return;
+		}
+
+		/* every pass reads all rows of its input */
+		Image tmp[ 2 ];
+		if( !lines[ n - 1 ].dx ) {
+			/* horizontal and vertical segments never read values that depend on pixels outside of the image */
+			const Image* in = &src;
+			for( size_t i = 0; i < n; i++ ) {
+				Image* out = ( i + 1 == n ) ? &dst : &tmp[ i & 1 ];
+				out->reallocate( src.width(), src.height(), src.format() );
+				morphLine<T, OP>( *out, *in, lines[ i ], rowfunc );
+				in = out;
+			}
+		} else {
+			/* the diagonals read the result of the previous passes outside of the image, which is not the
+			   identity there: run the passes on an image padded by the radius of the element */
+			tmp[ 0 ].reallocate( src.width() + 2 * rx, src.height() + 2 * rx, src.format() );
+			tmp[ 1 ].reallocate( src.width() + 2 * rx, src.height() + 2 * rx, src.format() );
+			morphPad<T, OP>( tmp[ 0 ], src, rx );
+			for( size_t i = 0; i < n; i++ )
+				morphLine<T, OP>( tmp[ ( i + 1 ) & 1 ], tmp[ i & 1 ], lines[ i ], rowfunc );
+			morphCrop<T>( dst, tmp[ n & 1 ], rx );
+		}
+	}
 
+	static void morphCheckFormat( const Image& src )
+	{
 		switch( src.format().formatID ) {
-			case IFORMAT_GRAY_UINT8:
-				morphTemplate<uint8_t>( dst, src, radius, &SIMD::dilateSpanU8, &SIMD::MaxValueU8, &SIMD::MaxValueVertU8 );
-				return;
-			case IFORMAT_GRAY_UINT16:
-				morphTemplate<uint16_t>( dst, src, radius, &SIMD::dilateSpanU16, &SIMD::MaxValueU16, &SIMD::MaxValueVertU16 );
+			case IFORMAT_BAYER_RGGB_UINT8:
+			case IFORMAT_BAYER_GRBG_UINT8:
+			case IFORMAT_BAYER_GBRG_UINT8:
+			case IFORMAT_YUYV_UINT8:
+			case IFORMAT_UYVY_UINT8:
+				throw CVTException( "Not implemented" );
+			default:
 				break;
-			case IFORMAT_GRAY_FLOAT:
-				morphTemplate<float>( dst, src, radius, &SIMD::dilateSpan1f, &SIMD::MaxValue1f, &SIMD::MaxValueVert1f );
+		}
+	}
+
+	static void morphDilate( Image& dst, const Image& src, size_t rx, size_t ry, IMorphologicalShape shape )
+	{
+		morphCheckFormat( src );
+		if( &dst == &src ) {
+			Image tmp( src );
+			morphDilate( dst, tmp, rx, ry, shape );
+			return;
+		}
+
+		switch( src.format().type ) {
+			case IFORMAT_TYPE_UINT8:
+				morphTemplate<uint8_t, IMorphMax<uint8_t> >( dst, src, rx, ry, shape, &SIMD::MaxValueU8 );
+				break;
+			case IFORMAT_TYPE_UINT16:
+				morphTemplate<uint16_t, IMorphMax<uint16_t> >( dst, src, rx, ry, shape, &SIMD::MaxValueU16 );
+				break;
+			case IFORMAT_TYPE_FLOAT:
+				morphTemplate<float, IMorphMax<float> >( dst, src, rx, ry, shape, &SIMD::MaxValue1f );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
 	}
 
-	void IMorphological::erode( Image& dst, const Image& src, size_t radius )
+	static void morphErode( Image& dst, const Image& src, size_t rx, size_t ry, IMorphologicalShape shape )
 	{
-		if( src.channels() != 1 )
-			throw CVTException( "Not implemented IMorphological::erode" );
-
-		dst.reallocate( src.width(), src.height(), src.format() );
+		morphCheckFormat( src );
+		if( &dst == &src ) {
+			Image tmp( src );
+			morphErode( dst, tmp, rx, ry, shape );
+			return;
+		}
 
-		switch( src.format().formatID ) {
-			case IFORMAT_GRAY_UINT8:
-				morphTemplate<uint8_t>( dst, src, radius, &SIMD::erodeSpanU8, &SIMD::MinValueU8, &SIMD::MinValueVertU8 );
-				return;
-			case IFORMAT_GRAY_UINT16:
-				morphTemplate<uint16_t>( dst, src, radius, &SIMD::erodeSpanU16, &SIMD::MinValueU16, &SIMD::MinValueVertU16 );
+		switch( src.format().type ) {
+			case IFORMAT_TYPE_UINT8:
+				morphTemplate<uint8_t, IMorphMin<uint8_t> >( dst, src, rx, ry, shape, &SIMD::MinValueU8 );
 				break;
-			case IFORMAT_GRAY_FLOAT:
-				morphTemplate<float>( dst, src, radius, &SIMD::erodeSpan1f, &SIMD::MinValue1f, &SIMD::MinValueVert1f );
+			case IFORMAT_TYPE_UINT16:
+				morphTemplate<uint16_t, IMorphMin<uint16_t> >( dst, src, rx, ry, shape, &SIMD::MinValueU16 );
+				break;
+			case IFORMAT_TYPE_FLOAT:
+				morphTemplate<float, IMorphMin<float> >( dst, src, rx, ry, shape, &SIMD::MinValue1f );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
 	}
+
+	template<typename T>
+	static void morphSub( Image& dst, const Image& src )
+	{
+		IMapScoped<T> mapdst( dst );
+		IMapScoped<const T> mapsrc( src );
+		size_t n = dst.width() * dst.channels();
+		size_t h = dst.height();
+		/* the dilation is never smaller than the erosion */
+		while( h-- ) {
+			T* d = mapdst.ptr();
+			const T* s = mapsrc.ptr();
+			for( size_t i = 0; i < n; i++ )
+				d[ i ] -= s[ i ];
+			mapdst++;
+			mapsrc++;
+		}
+	}
+
+	static void morphGradient( Image& dst, const Image& src, size_t rx, size_t ry, IMorphologicalShape shape )
+	{
+		Image ero;
+		morphErode( ero, src, rx, ry, shape );
+		morphDilate( dst, src, rx, ry, shape );
+
+		switch( dst.format().type ) {
+			case IFORMAT_TYPE_UINT8:  morphSub<uint8_t>( dst, ero ); break;
+			case IFORMAT_TYPE_UINT16: morphSub<uint16_t>( dst, ero ); break;
+			case IFORMAT_TYPE_FLOAT:  morphSub<float>( dst, ero ); break;
+			default:
+				throw CVTException( "Not implemented" );
+		}
+	}
+
+	void IMorphological::dilate( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape )
+	{
+		morphDilate( dst, src, radius, radius, shape );
+	}
+
+	void IMorphological::erode( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape )
+	{
+		morphErode( dst, src, radius, radius, shape );
+	}
+
+	void IMorphological::open( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape )
+	{
+		Image tmp;
+		morphErode( tmp, src, radius, radius, shape );
+		morphDilate( dst, tmp, radius, radius, shape );
+	}
+
+	void IMorphological::close( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape )
+	{
+		Image tmp;
+		morphDilate( tmp, src, radius, radius, shape );
+		morphErode( dst, tmp, radius, radius, shape );
+	}
+
+	void IMorphological::gradient( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape )
+	{
+		morphGradient( dst, src, radius, radius, shape );
+	}
+
+	void IMorphological::dilate( Image& dst, const Image& src, size_t rx, size_t ry )
+	{
+		morphDilate( dst, src, rx, ry, IMORPHOLOGICAL_RECT );
+	}
+
+	void IMorphological::erode( Image& dst, const Image& src, size_t rx, size_t ry )
+	{
+		morphErode( dst, src, rx, ry, IMORPHOLOGICAL_RECT );
+	}
+
+	void IMorphological::open( Image& dst, const Image& src, size_t rx, size_t ry )
+	{
+		Image tmp;
+		morphErode( tmp, src, rx, ry, IMORPHOLOGICAL_RECT );
+		morphDilate( dst, tmp, rx, ry, IMORPHOLOGICAL_RECT );
+	}
+
+	void IMorphological::close( Image& dst, const Image& src, size_t rx, size_t ry )
+	{
+		Image tmp;
+		morphDilate( tmp, src, rx, ry, IMORPHOLOGICAL_RECT );
+		morphErode( dst, tmp, rx, ry, IMORPHOLOGICAL_RECT );
+	}
+
+	void IMorphological::gradient( Image& dst, const Image& src, size_t rx, size_t ry )
+	{
+		morphGradient( dst, src, rx, ry, IMORPHOLOGICAL_RECT );
+	}
 }
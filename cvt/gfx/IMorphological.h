@@ -22,20 +22,51 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_IMORPHOLOGICAL_H
 #define CVT_IMORPHOLOGICAL_H
 
+#include <stdlib.h>
+
 namespace cvt
 {
 	class Image;
 
+	enum IMorphologicalShape {
+		IMORPHOLOGICAL_RECT,	/* ( 2 * radius + 1 ) x ( 2 * radius + 1 ) square */
+		IMORPHOLOGICAL_DISK		/* octagon approximating a disk with the given radius */
+	};
+
+	/**
+	  Dilation, erosion and the derived operators for images with any number
+	  of uint8, uint16 or float channels, every channel is processed on its own.
+
+	  The structuring elements are decomposed into line segments which are
+	  processed with the van Herk/Gil-Werman algorithm, the cost per pixel
+	  does not depend on the radius. Rectangles use a horizontal and a
+	  vertical segment, the disk is approximated by an octagon built from a
+	  horizontal, a vertical and the two diagonal segments. Pixels outside of
+	  the image do not take part, the element is clipped at the borders.
+	*/
 	class IMorphological
 	{
 		public:
-			static void dilate( Image& dst, const Image& src, size_t radius );
-			static void erode( Image& dst, const Image& src, size_t radius );
-//			static void open( Image& dst, const Image& src, size_t radius );
-//			static void close( Image& dst, const Image& src, size_t radius );
+			static void dilate( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape = IMORPHOLOGICAL_RECT );
+			static void erode( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape = IMORPHOLOGICAL_RECT );
+			/* erode followed by dilate */
+			static void open( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape = IMORPHOLOGICAL_RECT );
+			/* dilate followed by erode */
+			static void close( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape = IMORPHOLOGICAL_RECT );
+			/* dilate - erode */
+			static void gradient( Image& dst, const Image& src, size_t radius, IMorphologicalShape shape = IMORPHOLOGICAL_RECT );
+
+			/* rectangular element with ( 2 * rx + 1 ) x ( 2 * ry + 1 ) pixels */
+			static void dilate( Image& dst, const Image& src, size_t rx, size_t ry );
+			static void erode( Image& dst, const Image& src, size_t rx, size_t ry );
+			static void open( Image& dst, const Image& src, size_t rx, size_t ry );
+			static void close( Image& dst, const Image& src, size_t rx, size_t ry );
+			static void gradient( Image& dst, const Image& src, size_t rx, size_t ry );
+
 		private:
 			IMorphological() {}
 			IMorphological( const IMorphological& ) {}
@@ -0,0 +1,258 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IMorphological.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/Time.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/* offsets of the structuring element as Minkowski sum of its segments */
+	static void _morphElement( std::vector<int>& dx, std::vector<int>& dy, size_t rx, size_t ry, IMorphologicalShape shape )
+	{
+		int rh = rx, rv = ry, rd = 0;
+		if( shape == IMORPHOLOGICAL_DISK ) {
+			rd = Math::round( ( float ) rx * ( 1.0f - Math::sqrt( 0.5f ) ) );
+			if( rd && ( int ) rx < 2 * rd + 1 )
+				rd = ( ( int ) rx - 1 ) / 2;
+			rh = rv = rx - 2 * rd;
+		}
+
+		int r = rh + rv + 2 * rd;
+		int size = 2 * r + 1;
+		std::vector<char> mask( size * size, 0 );
+		for( int y = -rv; y <= rv; y++ ) {
+			for( int x = -rh; x <= rh; x++ ) {
+				for( int a = -rd; a <= rd; a++ ) {
+					for( int b = -rd; b <= rd; b++ )
+						mask[ ( y + a + b + r ) * size + x + a - b + r ] = 1;
+				}
+			}
+		}
+
+		dx.clear();
+		dy.clear();
+		for( int y = 0; y < size; y++ ) {
+			for( int x = 0; x < size; x++ ) {
+				if( mask[ y * size + x ] ) {
+					dx.push_back( x - r );
+					dy.push_back( y - r );
+				}
+			}
+		}
+	}
+
+	template<typename T>
+	static void _morphReference( std::vector<T>& out, const std::vector<T>& in, size_t w, size_t h, size_t c,
+								 const std::vector<int>& dx, const std::vector<int>& dy, bool max )
+	{
+		out.resize( in.size() );
+		for( int y = 0; y < ( int ) h; y++ ) {
+			for( int x = 0; x < ( int ) w; x++ ) {
+				for( size_t ch = 0; ch < c; ch++ ) {
+					T v = in[ ( y * w + x ) * c + ch ];
+					for( size_t i = 0; i < dx.size(); i++ ) {
+						int sx = x + dx[ i ];
+						int sy = y + dy[ i ];
+						if( sx < 0 || sy < 0 || sx >= ( int ) w || sy >= ( int ) h )
+							continue;
+						T s = in[ ( sy * w + sx ) * c + ch ];
+						v = max ? Math::max( v, s ) : Math::min( v, s );
+					}
+					out[ ( y * w + x ) * c + ch ] = v;
+				}
+			}
+		}
+	}
+
+	template<typename T>
+	static void _morphToImage( Image& img, const std::vector<T>& v )
+	{
+		IMapScoped<T> map( img );
+		size_t n = img.width() * img.channels();
+		for( size_t y = 0; y < img.height(); y++ ) {
+			memcpy( map.ptr(), &v[ y * n ], sizeof( T ) * n );
+			map++;
+		}
+	}
+
+	template<typename T>
+	static bool _morphCompare( const Image& img, const std::vector<T>& v )
+	{
+		IMapScoped<const T> map( img );
+		size_t n = img.width() * img.channels();
+		for( size_t y = 0; y < img.height(); y++ ) {
+			if( memcmp( map.ptr(), &v[ y * n ], sizeof( T ) * n ) )
+				return false;
+			map++;
+		}
+		return true;
+	}
+
+	template<typename T>
+	static bool _morphCheck( const IFormat& format, size_t w, size_t h, size_t radius, IMorphologicalShape shape )
+	{
+		size_t c = format.channels;
+		std::vector<T> in( w * h * c ), ero, dil, tmp, ref;
+		for( size_t i = 0; i < in.size(); i++ )
+			in[ i ] = ( T ) Math::rand( 0, 250 );
+
+		Image src( w, h, format ), dst;
+		_morphToImage( src, in );
+
+		std::vector<int> dx, dy;
+		_morphElement( dx, dy, radius, radius, shape );
+		_morphReference( dil, in, w, h, c, dx, dy, true );
+		_morphReference( ero, in, w, h, c, dx, dy, false );
+
+		bool ret = true;
+		IMorphological::dilate( dst, src, radius, shape );
+		ret &= _morphCompare( dst, dil );
+		IMorphological::erode( dst, src, radius, shape );
+		ret &= _morphCompare( dst, ero );
+
+		_morphReference( ref, ero, w, h, c, dx, dy, true );
+		IMorphological::open( dst, src, radius, shape );
+		ret &= _morphCompare( dst, ref );
+		_morphReference( ref, dil, w, h, c, dx, dy, false );
+		IMorphological::close( dst, src, radius, shape );
+		ret &= _morphCompare( dst, ref );
+
+		for( size_t i = 0; i < ref.size(); i++ )
+			ref[ i ] = dil[ i ] - ero[ i ];
+		IMorphological::gradient( dst, src, radius, shape );
+		ret &= _morphCompare( dst, ref );
+
+		/* in place */
+		IMorphological::dilate( src, src, radius, shape );
+		ret &= _morphCompare( src, dil );
+
+		if( !ret )
+			std::cout << format << " " << w << " x " << h << " radius " << radius << ( shape == IMORPHOLOGICAL_DISK ? " disk" : " rect" ) << " failed" << std::endl;
+		return ret;
+	}
+
+	static bool _morphRectCheck( size_t rx, size_t ry )
+	{
+		size_t w = 301, h = 37;
+		std::vector<uint8_t> in( w * h ), ref;
+		for( size_t i = 0; i < in.size(); i++ )
+			in[ i ] = Math::rand( 0, 255 );
+		Image src( w, h, IFormat::GRAY_UINT8 ), dst;
+		_morphToImage( src, in );
+
+		std::vector<int> dx, dy;
+		_morphElement( dx, dy, rx, ry, IMORPHOLOGICAL_RECT );
+		_morphReference( ref, in, w, h, 1, dx, dy, false );
+		IMorphological::erode( dst, src, rx, ry );
+		return _morphCompare( dst, ref );
+	}
+
+	/* the octagon touches the circle with its edges, the corners are at r / cos( 22.5 ) */
+	static bool _morphDiskShape()
+	{
+		for( size_t r = 3; r <= 40; r++ ) {
+			std::vector<int> dx, dy;
+			_morphElement( dx, dy, r, r, IMORPHOLOGICAL_DISK );
+			size_t inside = 0;
+			for( size_t i = 0; i < dx.size(); i++ ) {
+				float d = Math::sqrt( ( float ) ( dx[ i ] * dx[ i ] + dy[ i ] * dy[ i ] ) );
+				if( d > 1.0824f * r + 0.5f )
+					return false;
+			}
+			for( int y = -( int ) r; y <= ( int ) r; y++ )
+				for( int x = -( int ) r; x <= ( int ) r; x++ )
+					inside += Math::sqrt( ( float ) ( x * x + y * y ) ) <= 0.9f * r;
+			size_t found = 0;
+			for( size_t i = 0; i < dx.size(); i++ )
+				found += Math::sqrt( ( float ) ( dx[ i ] * dx[ i ] + dy[ i ] * dy[ i ] ) ) <= 0.9f * r;
+			if( found != inside )
+				return false;
+		}
+		return true;
+	}
+
+	static void _morphTiming()
+	{
+		Image img( 2048, 2048, IFormat::GRAY_UINT8 ), dst;
+		{
+			IMapScoped<uint8_t> map( img );
+			for( size_t y = 0; y < img.height(); y++ ) {
+				uint8_t* p = map.ptr();
+				for( size_t x = 0; x < img.width(); x++ )
+					p[ x ] = Math::rand( 0, 255 );
+				map++;
+			}
+		}
+
+		size_t radii[] = { 1, 5, 15, 40 };
+		for( size_t i = 0; i < 4; i++ ) {
+			Time t;
+			IMorphological::dilate( dst, img, radii[ i ] );
+			double rect = t.elapsedMilliSeconds();
+			t.reset();
+			IMorphological::dilate( dst, img, radii[ i ], IMORPHOLOGICAL_DISK );
+			double disk = t.elapsedMilliSeconds();
+			std::cout << "2048 x 2048 GRAY_UINT8 dilate radius " << radii[ i ] << ": rect " << rect << " ms disk " << disk << " ms" << std::endl;
+		}
+	}
+
+}
+
+BEGIN_CVTTEST( IMorphological )
+	using namespace cvt;
+	bool ret = true;
+	bool b = true;
+
+	size_t radii[] = { 0, 1, 2, 3, 7, 24 };
+	for( size_t i = 0; i < 6; i++ ) {
+		for( int s = 0; s < 2; s++ ) {
+			IMorphologicalShape shape = s ? IMORPHOLOGICAL_DISK : IMORPHOLOGICAL_RECT;
+			b &= _morphCheck<uint8_t>( IFormat::GRAY_UINT8, 301, 40, radii[ i ], shape );
+			b &= _morphCheck<uint8_t>( IFormat::RGBA_UINT8, 67, 45, radii[ i ], shape );
+			b &= _morphCheck<uint16_t>( IFormat::GRAYALPHA_UINT16, 50, 31, radii[ i ], shape );
+			b &= _morphCheck<float>( IFormat::GRAY_FLOAT, 290, 23, radii[ i ], shape );
+			b &= _morphCheck<float>( IFormat::RGBA_FLOAT, 33, 60, radii[ i ], shape );
+		}
+	}
+	CVTTEST_PRINT( "dilate, erode, open, close, gradient", b );
+	ret &= b;
+
+	b = _morphRectCheck( 0, 5 ) && _morphRectCheck( 9, 0 ) && _morphRectCheck( 3, 17 ) && _morphRectCheck( 60, 2 );
+	CVTTEST_PRINT( "rectangles", b );
+	ret &= b;
+
+	b = _morphDiskShape();
+	CVTTEST_PRINT( "disk approximation", b );
+	ret &= b;
+
+	_morphTiming();
+
+	return ret;
+END_CVTTEST
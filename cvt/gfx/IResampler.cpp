@@ -0,0 +1,453 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IResampler.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <list>
+#include <stdlib.h>
+#include <string.h>
+
+namespace cvt {
+
+	/* minimum number of output rows per band */
+	static const size_t RESAMPLER_BAND_HEIGHT = 32;
+	/* number of plans kept in the cache */
+	static const size_t RESAMPLER_CACHE_SIZE = 16;
+
+	static Mutex					_cacheMutex;
+	static std::list<IResampler*>	_cache;
+
+	static inline bool _isZeroWeight( float w ) { return Math::abs( w ) < Math::EPSILONF; }
+	static inline bool _isZeroWeight( Fixed w ) { return w.native() == 0; }
+	static inline bool _equalWeight( float a, float b ) { return Math::abs( a - b ) < Math::EPSILONF; }
+	static inline bool _equalWeight( Fixed a, Fixed b ) { return a.native() == b.native(); }
+
+	class IResamplerBand {
+		public:
+			IResamplerBand( IResampler* plan, const uint8_t* src, size_t sstride, uint8_t* dst, size_t dstride ) :
+				_plan( plan ), _src( src ), _sstride( sstride ), _dst( dst ), _dstride( dstride )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				for( size_t b = begin; b < end; b++ )
+					_plan->processBand( b, _src, _sstride, _dst, _dstride );
+			}
+
+		private:
+			IResampler*		_plan;
+			const uint8_t*	_src;
+			size_t			_sstride;
+			uint8_t*		_dst;
+			size_t			_dstride;
+	};
+
+	IResampler::IResampler( size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight,
+							const IFormat& format, const IScaleFilter& filter ) :
+		_srcWidth( srcWidth ), _srcHeight( srcHeight ),
+		_dstWidth( dstWidth ), _dstHeight( dstHeight ),
+		_format( format ),
+		_filterName( filter.name() ),
+		_filterSupport( filter.support() ),
+		_filterSharpSmooth( filter.sharpSmooth() ),
+		_channels( format.channels ),
+		_float( format.type == IFORMAT_TYPE_FLOAT ),
+		_ringSize( 0 ),
+		_decFactor( 0 ),
+		_decBegin( 0 ),
+		_decEnd( 0 ),
+		_decTaps( 0 ),
+		_rowsPerBand( 0 )
+	{
+		if( format.type != IFORMAT_TYPE_FLOAT && format.type != IFORMAT_TYPE_UINT8 )
+			throw CVTException( "IResampler: unsupported format" );
+		if( _channels != 1 && _channels != 2 && _channels != 4 )
+			throw CVTException( "IResampler: unsupported number of channels" );
+		if( !srcWidth || !srcHeight || !dstWidth || !dstHeight )
+			throw CVTException( "IResampler: empty image" );
+
+		_xf.size = _yf.size = _xfx.size = _yfx.size = NULL;
+		_xf.weights = _yf.weights = NULL;
+		_xfx.weights = _yfx.weights = NULL;
+
+		if( _float ) {
+			filter.getAdaptiveConvolutionWeights( dstHeight, srcHeight, _yf, true );
+			filter.getAdaptiveConvolutionWeights( dstWidth, srcWidth, _xf, false );
+			buildTaps( _ytaps, _yf.size, _yf.weights, dstHeight, srcHeight, true );
+			buildTaps( _xtaps, _xf.size, _xf.weights, dstWidth, srcWidth, false );
+			findDecimation( _xf.weights );
+		} else {
+			filter.getAdaptiveConvolutionWeights( dstHeight, srcHeight, _yfx, true );
+			filter.getAdaptiveConvolutionWeights( dstWidth, srcWidth, _xfx, false );
+			buildTaps( _ytaps, _yfx.size, _yfx.weights, dstHeight, srcHeight, true );
+			buildTaps( _xtaps, _xfx.size, _xfx.weights, dstWidth, srcWidth, false );
+			findDecimation( _xfx.weights );
+		}
+
+		/* ring rows needed: rows may still be in use by a later output row */
+		ssize_t end = 0;
+		for( size_t y = 0; y < _ytaps.size(); y++ ) {
+			end = Math::max<ssize_t>( end, _ytaps[ y ].start + _ytaps[ y ].numw );
+			_ringSize = Math::max<size_t>( _ringSize, end - _ytaps[ y ].start );
+		}
+
+		_rowSize = Math::max<size_t>( 16, Math::pad( dstWidth * _channels, 16 ) );
+		allocateBands();
+	}
+
+	IResampler::~IResampler()
+	{
+		for( size_t i = 0; i < _bandScratch.size(); i++ )
+			free( _bandScratch[ i ] );
+		delete[] _xf.size;
+		delete[] _xf.weights;
+		delete[] _yf.size;
+		delete[] _yf.weights;
+		delete[] _xfx.size;
+		delete[] _xfx.weights;
+		delete[] _yfx.size;
+		delete[] _yfx.weights;
+	}
+
+	bool IResampler::matches( size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight,
+							  const IFormat& format, const IScaleFilter& filter ) const
+	{
+		return _srcWidth == srcWidth && _srcHeight == srcHeight &&
+			   _dstWidth == dstWidth && _dstHeight == dstHeight &&
+			   _format == format &&
+			   _filterSupport == filter.support() &&
+			   _filterSharpSmooth == filter.sharpSmooth() &&
+			   _filterName == filter.name();
+	}
+
+	template<typename W>
+	void IResampler::buildTaps( std::vector<Tap>& taps, const IConvolveAdaptiveSize* size, const W* weights, size_t n, size_t srcn, bool trim )
+	{
+		ssize_t pos = 0;
+		size_t woffset = 0;
+
+		taps.resize( n );
+		for( size_t i = 0; i < n; i++ ) {
+			Tap& t = taps[ i ];
+			pos += size[ i ].incr;
+			t.start = pos;
+			t.numw = size[ i ].numw;
+			t.woffset = woffset;
+			woffset += size[ i ].numw;
+
+			/* the vertical weights keep leading zeros, skip those rows */
+			if( trim ) {
+				while( t.numw > 1 && _isZeroWeight( weights[ t.woffset ] ) ) {
+					t.start++;
+					t.woffset++;
+					t.numw--;
+				}
+			}
+			if( t.start >= ( ssize_t ) srcn )
+				t.start = srcn - 1;
+			if( t.start + t.numw > srcn )
+				t.numw = srcn - t.start;
+		}
+	}
+
+	template<typename W>
+	void IResampler::findDecimation( const W* weights )
+	{
+		size_t factor = _srcWidth / _dstWidth;
+		if( ( factor != 2 && factor != 4 ) || factor * _dstWidth != _srcWidth )
+			return;
+
+		/* grow the range of outputs sharing the kernel of the center output */
+		size_t mid = _dstWidth / 2;
+		const Tap& m = _xtaps[ mid ];
+		size_t begin = mid, end = mid + 1;
+		while( begin > 0 ) {
+			const Tap& t = _xtaps[ begin - 1 ];
+			if( t.numw != m.numw || t.start != m.start - ( ssize_t ) ( factor * ( mid - begin + 1 ) ) )
+				break;
+			size_t k;
+			for( k = 0; k < m.numw && _equalWeight( weights[ t.woffset + k ], weights[ m.woffset + k ] ); k++ )
+				;
+			if( k != m.numw )
+				break;
+			begin--;
+		}
+		while( end < _dstWidth ) {
+			const Tap& t = _xtaps[ end ];
+			if( t.numw != m.numw || t.start != m.start + ( ssize_t ) ( factor * ( end - mid ) ) )
+				break;
+			size_t k;
+			for( k = 0; k < m.numw && _equalWeight( weights[ t.woffset + k ], weights[ m.woffset + k ] ); k++ )
+				;
+			if( k != m.numw )
+				break;
+			end++;
+		}
+		if( end - begin < 8 )
+			return;
+
+		_decFactor = factor;
+		_decBegin = begin;
+		_decEnd = end;
+		_decTaps = m.numw;
+		/* copy the raw weights, W is float or Fixed */
+		for( size_t k = 0; k < m.numw; k++ ) {
+			float wf;
+			int32_t wfx;
+			memcpy( &wf, &weights[ m.woffset + k ], sizeof( float ) );
+			memcpy( &wfx, &weights[ m.woffset + k ], sizeof( int32_t ) );
+			_decKernelf.push_back( wf );
+			_decKernelfx.push_back( wfx );
+		}
+	}
+
+	void IResampler::allocateBands()
+	{
+		size_t bands = Math::min( ParallelFor::numThreads(), Math::max<size_t>( 1, _dstHeight / RESAMPLER_BAND_HEIGHT ) );
+		_rowsPerBand = ( _dstHeight + bands - 1 ) / bands;
+		bands = ( _dstHeight + _rowsPerBand - 1 ) / _rowsPerBand;
+
+		/* ring rows, one output row and the row pointers for the vertical pass */
+		size_t bytes = ( _ringSize + 1 ) * _rowSize * sizeof( float ) + _ringSize * sizeof( void* );
+		_bandScratch.resize( bands, NULL );
+		for( size_t i = 0; i < bands; i++ ) {
+			void* ptr;
+			if( posix_memalign( &ptr, 16, bytes ) )
+				throw CVTException( "Out of memory" );
+			memset( ptr, 0, bytes );
+			_bandScratch[ i ] = ( uint8_t* ) ptr;
+		}
+	}
+
+	static inline float	  _tapWeight( float w ) { return w; }
+	static inline int32_t _tapWeight( int32_t w ) { return w; }
+	static inline int32_t _tapWeight( Fixed w ) { return w.native(); }
+
+	template<size_t C, typename S, typename A, typename W>
+	static inline void _resampleTap( A* out, const S* src, const W* weights, size_t numw )
+	{
+		A acc[ C ];
+		for( size_t c = 0; c < C; c++ )
+			acc[ c ] = 0;
+		for( size_t k = 0; k < numw; k++ ) {
+			const A w = _tapWeight( weights[ k ] );
+			for( size_t c = 0; c < C; c++ )
+				acc[ c ] += w * ( A ) src[ k * C + c ];
+		}
+		for( size_t c = 0; c < C; c++ )
+			out[ c ] = acc[ c ];
+	}
+
+	/* horizontal pass of an exact decimation, A is float or the native value of Fixed */
+	template<size_t C, typename S, typename A, typename W>
+	static void _resampleDecimate( A* out, const S* src, const W* weights, const std::vector<IResampler::Tap>& taps,
+								   size_t n, size_t begin, size_t end, size_t factor, const A* kernel, size_t ntaps )
+	{
+		for( size_t x = 0; x < begin; x++ )
+			_resampleTap<C>( out + x * C, src + taps[ x ].start * C, weights + taps[ x ].woffset, taps[ x ].numw );
+
+		const S* s = src + taps[ begin ].start * C;
+		A* o = out + begin * C;
+		if( ntaps == 2 ) {
+			const A k0 = kernel[ 0 ], k1 = kernel[ 1 ];
+			for( size_t x = begin; x < end; x++ ) {
+				for( size_t c = 0; c < C; c++ )
+					o[ c ] = k0 * ( A ) s[ c ] + k1 * ( A ) s[ C + c ];
+				o += C;
+				s += factor * C;
+			}
+		} else if( ntaps == 4 ) {
+			const A k0 = kernel[ 0 ], k1 = kernel[ 1 ], k2 = kernel[ 2 ], k3 = kernel[ 3 ];
+			for( size_t x = begin; x < end; x++ ) {
+				for( size_t c = 0; c < C; c++ )
+					o[ c ] = k0 * ( A ) s[ c ] + k1 * ( A ) s[ C + c ] + k2 * ( A ) s[ 2 * C + c ] + k3 * ( A ) s[ 3 * C + c ];
+				o += C;
+				s += factor * C;
+			}
+		} else {
+			for( size_t x = begin; x < end; x++ ) {
+				_resampleTap<C>( o, s, kernel, ntaps );
+				o += C;
+				s += factor * C;
+			}
+		}
+
+		for( size_t x = end; x < n; x++ )
+			_resampleTap<C>( out + x * C, src + taps[ x ].start * C, weights + taps[ x ].woffset, taps[ x ].numw );
+	}
+
+	template<typename S, typename A, typename W>
+	static void _resampleDecimate( A* out, const S* src, size_t channels, const W* weights, const std::vector<IResampler::Tap>& taps,
+								   size_t n, size_t begin, size_t end, size_t factor, const A* kernel, size_t ntaps )
+	{
+		if( channels == 1 )
+			_resampleDecimate<1>( out, src, weights, taps, n, begin, end, factor, kernel, ntaps );
+		else if( channels == 2 )
+			_resampleDecimate<2>( out, src, weights, taps, n, begin, end, factor, kernel, ntaps );
+		else
+			_resampleDecimate<4>( out, src, weights, taps, n, begin, end, factor, kernel, ntaps );
+	}
+
+	void IResampler::horizontal( void* out, const uint8_t* src )
+	{
+		SIMD* simd = SIMD::instance();
+
+		if( _float ) {
+			if( _decFactor ) {
+				_resampleDecimate( ( float* ) out, ( const float* ) src, _channels, _xf.weights, _xtaps,
+								   _dstWidth, _decBegin, _decEnd, _decFactor, &_decKernelf[ 0 ], _decTaps );
+			} else if( _channels == 1 ) {
+				simd->ConvolveAdaptiveClamp1f( ( float* ) out, ( const float* ) src, _dstWidth, &_xf );
+			} else if( _channels == 2 ) {
+				simd->ConvolveAdaptiveClamp2f( ( float* ) out, ( const float* ) src, _dstWidth, &_xf );
+			} else {
+				simd->ConvolveAdaptiveClamp4f( ( float* ) out, ( const float* ) src, _dstWidth, &_xf );
+			}
+		} else {
+			if( _decFactor ) {
+				/* Fixed * uint8_t is the product of the native value */
+				_resampleDecimate( ( int32_t* ) out, src, _channels, _xfx.weights, _xtaps,
+								   _dstWidth, _decBegin, _decEnd, _decFactor, &_decKernelfx[ 0 ], _decTaps );
+			} else if( _channels == 1 ) {
+				simd->ConvolveAdaptive1Fixed( ( Fixed* ) out, src, _dstWidth, &_xfx );
+			} else if( _channels == 2 ) {
+				simd->ConvolveAdaptive2Fixed( ( Fixed* ) out, src, _dstWidth, &_xfx );
+			} else {
+				simd->ConvolveAdaptive4Fixed( ( Fixed* ) out, src, _dstWidth, &_xfx );
+			}
+		}
+	}
+
+	void IResampler::processBand( size_t band, const uint8_t* src, size_t sstride, uint8_t* dst, size_t dstride )
+	{
+		SIMD* simd = SIMD::instance();
+		const size_t rowBytes = _rowSize * sizeof( float );
+		const size_t n = _dstWidth * _channels;
+		uint8_t* ring = _bandScratch[ band ];
+		uint8_t* tmp = ring + _ringSize * rowBytes;
+		/* the row pointers are stored with the type the vertical pass reads */
+		const float** rowsf = ( const float** ) ( tmp + rowBytes );
+		const Fixed** rowsfx = ( const Fixed** ) ( tmp + rowBytes );
+
+		size_t y = band * _rowsPerBand;
+		size_t yend = Math::min( y + _rowsPerBand, _dstHeight );
+		ssize_t next = _ytaps[ y ].start;
+
+		dst += y * dstride;
+		for( ; y < yend; y++ ) {
+			const Tap& t = _ytaps[ y ];
+			/* horizontally scale the source rows entering the window */
+			for( ; next < t.start + ( ssize_t ) t.numw; next++ )
+				horizontal( ring + ( next % _ringSize ) * rowBytes, src + next * sstride );
+
+			/* the SIMD versions need aligned output and at least 16 elements */
+			bool direct = n >= 16 && !( ( size_t ) dst & 0xf );
+			uint8_t* out = direct ? dst : tmp;
+			size_t width = direct ? n : _rowSize;
+			if( _float ) {
+				for( size_t k = 0; k < t.numw; k++ )
+					rowsf[ k ] = ( const float* ) ( ring + ( ( t.start + k ) % _ringSize ) * rowBytes );
+				simd->ConvolveClampVert_f( ( float* ) out, rowsf, _yf.weights + t.woffset, t.numw, width );
+				if( !direct )
+					memcpy( dst, tmp, n * sizeof( float ) );
+			} else {
+				for( size_t k = 0; k < t.numw; k++ )
+					rowsfx[ k ] = ( const Fixed* ) ( ring + ( ( t.start + k ) % _ringSize ) * rowBytes );
+				simd->ConvolveClampVert_fx_to_u8( out, rowsfx, _yfx.weights + t.woffset, t.numw, width );
+				if( !direct )
+					memcpy( dst, tmp, n );
+			}
+			dst += dstride;
+		}
+	}
+
+	void IResampler::apply( Image& idst, const Image& isrc )
+	{
+		if( isrc.width() != _srcWidth || isrc.height() != _srcHeight || isrc.format() != _format )
+			throw CVTException( "IResampler: source does not match the plan" );
+
+		idst.reallocate( _dstWidth, _dstHeight, _format );
+
+		size_t sstride, dstride;
+		const uint8_t* src = isrc.map( &sstride );
+		uint8_t* dst = idst.map( &dstride );
+
+		IResamplerBand bands( this, src, sstride, dst, dstride );
+		ParallelFor::run( bands, 0, _bandScratch.size(), 1 );
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+	}
+
+	void IResampler::scale( Image& dst, const Image& src, size_t width, size_t height, const IScaleFilter& filter )
+	{
+		IResampler* plan = NULL;
+
+		_cacheMutex.lock();
+		for( std::list<IResampler*>::iterator it = _cache.begin(); it != _cache.end(); ++it ) {
+			if( ( *it )->matches( src.width(), src.height(), width, height, src.format(), filter ) ) {
+				plan = *it;
+				_cache.erase( it );
+				break;
+			}
+		}
+		_cacheMutex.unlock();
+
+		if( !plan )
+			plan = new IResampler( src.width(), src.height(), width, height, src.format(), filter );
+
+		try {
+			plan->apply( dst, src );
+		} catch( ... ) {
+			delete plan;
+			throw;
+		}
+
+		/* most recently used first */
+		_cacheMutex.lock();
+		_cache.push_front( plan );
+		if( _cache.size() > RESAMPLER_CACHE_SIZE ) {
+			delete _cache.back();
+			_cache.pop_back();
+		}
+		_cacheMutex.unlock();
+	}
+
+	void IResampler::clearCache()
+	{
+		_cacheMutex.lock();
+		for( std::list<IResampler*>::iterator it = _cache.begin(); it != _cache.end(); ++it )
+			delete *it;
+		_cache.clear();
+		_cacheMutex.unlock();
+	}
+
+}
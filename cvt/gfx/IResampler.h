@@ -0,0 +1,117 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_IRESAMPLER_H
+#define CVT_IRESAMPLER_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IScaleFilter.h>
+
+#include <vector>
+#include <string>
+
+namespace cvt {
+
+	/**
+	  Precomputed plan for scaling images of one size, format and filter to another size.
+
+	  The plan owns the filter weights and the scratch rows, so repeated scaling
+	  of the same sizes does not allocate. Output rows are split into bands
+	  processed in parallel, the vertical accumulation uses the SIMD
+	  ConvolveClampVert functions and exact 2:1 and 4:1 decimations run a
+	  fixed-kernel horizontal pass.
+
+	  A plan must not be applied from several threads at the same time,
+	  IResampler::scale hands out cached plans to one caller at a time.
+	*/
+	class IResampler {
+		public:
+			IResampler( size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight,
+					    const IFormat& format, const IScaleFilter& filter );
+			~IResampler();
+
+			bool matches( size_t srcWidth, size_t srcHeight, size_t dstWidth, size_t dstHeight,
+						  const IFormat& format, const IScaleFilter& filter ) const;
+
+			void apply( Image& dst, const Image& src );
+
+			/* scale with a plan from the process-wide plan cache */
+			static void scale( Image& dst, const Image& src, size_t width, size_t height, const IScaleFilter& filter );
+			static void clearCache();
+
+			/* source range and weights of one output row or column */
+			struct Tap {
+				ssize_t start;
+				size_t	numw;
+				size_t	woffset;
+			};
+
+		private:
+			IResampler( const IResampler& );
+			IResampler& operator=( const IResampler& );
+
+			template<typename W>
+			void buildTaps( std::vector<Tap>& taps, const IConvolveAdaptiveSize* size, const W* weights, size_t n, size_t srcn, bool trim );
+			template<typename W>
+			void findDecimation( const W* weights );
+
+			void allocateBands();
+			void processBand( size_t band, const uint8_t* src, size_t sstride, uint8_t* dst, size_t dstride );
+			void horizontal( void* out, const uint8_t* src );
+
+			friend class IResamplerBand;
+
+			size_t					_srcWidth, _srcHeight;
+			size_t					_dstWidth, _dstHeight;
+			IFormat					_format;
+			std::string				_filterName;
+			float					_filterSupport;
+			float					_filterSharpSmooth;
+
+			size_t					_channels;
+			bool					_float;
+			/* elements of a scratch row, padded for the SIMD functions */
+			size_t					_rowSize;
+			size_t					_ringSize;
+
+			IConvolveAdaptivef		_xf, _yf;
+			IConvolveAdaptiveFixed	_xfx, _yfx;
+			std::vector<Tap>		_xtaps;
+			std::vector<Tap>		_ytaps;
+
+			/* exact decimation: outputs [ _decBegin, _decEnd ) share one kernel */
+			size_t					_decFactor;
+			size_t					_decBegin, _decEnd;
+			size_t					_decTaps;
+			std::vector<float>		_decKernelf;
+			std::vector<int32_t>	_decKernelfx;
+
+			size_t					_rowsPerBand;
+			std::vector<uint8_t*>	_bandScratch;
+	};
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/gfx/IResampler.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdlib.h>
+
+namespace cvt {
+
+	/* separable reference on float values, straight from the filter weights */
+	static void _resampleReference( std::vector<float>& out, const Image& img, size_t w, size_t h, const IScaleFilter& filter )
+	{
+		IConvolveAdaptivef cx, cy;
+		size_t c = img.channels();
+		filter.getAdaptiveConvolutionWeights( w, img.width(), cx, false );
+		filter.getAdaptiveConvolutionWeights( h, img.height(), cy, true );
+
+		std::vector<float> tmp( img.height() * w * c, 0.0f );
+		{
+			IMapScoped<const uint8_t> map( img );
+			for( size_t y = 0; y < img.height(); y++ ) {
+				const uint8_t* row = map.ptr();
+				ssize_t pos = 0;
+				const float* wx = cx.weights;
+				for( size_t x = 0; x < w; x++ ) {
+					pos += cx.size[ x ].incr;
+					for( size_t k = 0; k < cx.size[ x ].numw; k++, wx++ ) {
+						for( size_t ch = 0; ch < c; ch++ ) {
+							float v = img.format().type == IFORMAT_TYPE_FLOAT ? ( ( const float* ) row )[ ( pos + k ) * c + ch ]
+																				: row[ ( pos + k ) * c + ch ];
+							tmp[ ( y * w + x ) * c + ch ] += *wx * v;
+						}
+					}
+				}
+				map++;
+			}
+		}
+
+		out.assign( h * w * c, 0.0f );
+		ssize_t pos = 0;
+		const float* wy = cy.weights;
+		for( size_t y = 0; y < h; y++ ) {
+			pos += cy.size[ y ].incr;
+			for( size_t k = 0; k < cy.size[ y ].numw; k++, wy++ ) {
+				if( pos + k >= img.height() )
+					continue;
+				for( size_t i = 0; i < w * c; i++ )
+					out[ y * w * c + i ] += *wy * tmp[ ( pos + k ) * w * c + i ];
+			}
+		}
+
+		delete[] cx.size;
+		delete[] cx.weights;
+		delete[] cy.size;
+		delete[] cy.weights;
+	}
+
+	static bool _resampleCompare( const Image& src, size_t w, size_t h, const IScaleFilter& filter )
+	{
+		Image dst;
+		std::vector<float> ref;
+
+		src.scale( dst, w, h, filter );
+		_resampleReference( ref, src, w, h, filter );
+
+		if( dst.width() != w || dst.height() != h || dst.format() != src.format() )
+			return false;
+
+		size_t c = src.channels();
+		bool isfloat = src.format().type == IFORMAT_TYPE_FLOAT;
+		IMapScoped<const uint8_t> map( dst );
+		for( size_t y = 0; y < h; y++ ) {
+			const uint8_t* row = map.ptr();
+			for( size_t i = 0; i < w * c; i++ ) {
+				float r = ref[ y * w * c + i ];
+				if( isfloat ) {
+					if( Math::abs( ( ( const float* ) row )[ i ] - r ) > 1e-4f )
+						return false;
+				} else {
+					if( Math::abs( ( float ) row[ i ] - Math::clamp( r, 0.0f, 255.0f ) ) > 1.5f )
+						return false;
+				}
+			}
+			map++;
+		}
+		return true;
+	}
+
+	static void _resampleFill( Image& img )
+	{
+		IMapScoped<uint8_t> map( img );
+		size_t n = img.width() * img.channels();
+		srand( 42 );
+		for( size_t y = 0; y < img.height(); y++ ) {
+			uint8_t* row = map.ptr();
+			for( size_t i = 0; i < n; i++ ) {
+				if( img.format().type == IFORMAT_TYPE_FLOAT )
+					( ( float* ) row )[ i ] = ( float ) ( rand() % 1000 ) / 1000.0f;
+				else
+					row[ i ] = rand() & 0xff;
+			}
+			map++;
+		}
+	}
+
+BEGIN_CVTTEST( IResampler )
+	bool result = true;
+	IScaleFilterBilinear bilinear;
+	IScaleFilterCubic cubic;
+	IScaleFilterLanczos lanczos;
+
+	const IFormat* formats[] = { &IFormat::GRAY_UINT8, &IFormat::GRAY_FLOAT, &IFormat::RGBA_UINT8, &IFormat::GRAYALPHA_FLOAT };
+	const char* names[] = { "GRAY_UINT8", "GRAY_FLOAT", "RGBA_UINT8", "GRAYALPHA_FLOAT" };
+	for( size_t f = 0; f < 4; f++ ) {
+		Image src( 160, 120, *formats[ f ] );
+		_resampleFill( src );
+
+		bool b = true;
+		/* exact decimations */
+		b &= _resampleCompare( src, 80, 60, bilinear );
+		b &= _resampleCompare( src, 80, 60, cubic );
+		b &= _resampleCompare( src, 40, 30, bilinear );
+		b &= _resampleCompare( src, 40, 30, lanczos );
+		/* generic down- and upscaling, narrow output rows */
+		b &= _resampleCompare( src, 97, 71, cubic );
+		b &= _resampleCompare( src, 7, 5, bilinear );
+		b &= _resampleCompare( src, 211, 173, lanczos );
+		/* cached plan */
+		b &= _resampleCompare( src, 80, 60, bilinear );
+		CVTTEST_PRINT( names[ f ], b );
+		result &= b;
+	}
+	IResampler::clearCache();
+
+	return result;
+END_CVTTEST
+
+}
@@ -51,6 +51,8 @@ namespace cvt {
 			virtual ~IScaleFilter() {}
 			virtual float eval( float x ) const = 0;
 			virtual const std::string name() const = 0;
+			float support() const { return _support; }
+			float sharpSmooth() const { return _sharpsmooth; }
 			size_t getAdaptiveConvolutionWeights( size_t dst, size_t src, IConvolveAdaptivef& conva, bool nonegincr = true ) const;
 			size_t getAdaptiveConvolutionWeights( size_t dst, size_t src, IConvolveAdaptiveFixed& conva, bool nonegincr = true ) const;
 
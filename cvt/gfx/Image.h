@@ -168,9 +168,6 @@ namespace cvt {
             GFXEngine* gfxEngine();
 
 		private:
-			void scaleFloat( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const;
-			void scaleU8( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const;
-
 			void checkFormat( const Image & img, const char* func, size_t lineNum, const IFormat & format ) const;
 			void checkSize( const Image & img, const char* func, size_t lineNum, size_t w, size_t h ) const;
 			void checkFormatAndSize( const Image & img, const char* func, size_t lineNum ) const;
@@ -28,6 +28,7 @@
 #include <cvt/util/Exception.h>
 #include <cvt/util/ScopedBuffer.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IResampler.h>
 
 #include <iomanip>
 
@@ -525,10 +526,8 @@ namespace cvt {
 	{
 		switch ( _mem->_format.type ) {
 			case IFORMAT_TYPE_FLOAT:
-				scaleFloat( idst, width, height, filter );
-				break;
 			case IFORMAT_TYPE_UINT8:
-				scaleU8( idst, width, height, filter );
+				IResampler::scale( idst, *this, width, height, filter );
 				break;
 			default:
 				throw CVTException("Unimplemented");
@@ -536,195 +535,6 @@ namespace cvt {
 		}
 	}
 
-	void Image::scaleFloat( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
-	{
-		IConvolveAdaptivef scalerx;
-		IConvolveAdaptivef scalery;
-		IConvolveAdaptiveSize* pysw;
-		float* pyw;
-		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
-		uint8_t* dst;
-		uint8_t* odst;
-		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		float** buf;
-		size_t bufsize;
-		size_t curbuf;
-		void (SIMD::*scalex_func)( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
-		SIMD* simd = SIMD::instance();
-
-
-		if( _mem->_format.channels == 1 ) {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp1f;
-		} else if( _mem->_format.channels == 2 ) {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp2f;
-		} else {
-			scalex_func = &SIMD::ConvolveAdaptiveClamp4f;
-		}
-
-		//checkFormat( idst, __PRETTY_FUNCTION__, __LINE__, _mem->_format );
-		//checkSize( idst, __PRETTY_FUNCTION__, __LINE__, width, height );
-		idst.reallocate( width, height, this->format() );
-
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
-
-		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
-		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
-
-		buf = new float*[ bufsize ];
-		/* allocate and fill buffer */
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( float ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( ( float* ) buf[ i ], ( float* ) src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
-
-		pysw = scalery.size;
-		pyw = scalery.weights;
-
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( ( float* ) buf[ ( curbuf + k ) % bufsize ], ( float* ) src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( Math::abs( *pyw ) < Math::EPSILONF ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( Math::abs( *pyw ) > Math::EPSILONF )
-					simd->MulAddValue1f( ( float* ) dst, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
-
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
-		delete[] scalerx.size;
-		delete[] scalerx.weights;
-		delete[] scalery.size;
-		delete[] scalery.weights;
-	}
-
-	void Image::scaleU8( Image& idst, size_t width, size_t height, const IScaleFilter& filter ) const
-	{
-		IConvolveAdaptiveFixed scalerx;
-		IConvolveAdaptiveFixed scalery;
-
-		IConvolveAdaptiveSize* pysw;
-		Fixed* pyw;
-
-		const uint8_t* src;
-		const uint8_t* osrc;
-		const uint8_t* send;
-		uint8_t* dst;
-		uint8_t* odst;
-		size_t sstride, dstride;
-		size_t i, l;
-		int32_t k;
-		Fixed** buf;
-		Fixed* accumBuf;
-		size_t bufsize;
-		size_t curbuf;
-		void (SIMD::*scalex_func)( Fixed* _dst, uint8_t const* _src, const size_t width, IConvolveAdaptiveFixed* conva ) const;
-		SIMD* simd = SIMD::instance();
-
-		if( _mem->_format.channels == 1 ) {
-			scalex_func = &SIMD::ConvolveAdaptive1Fixed;
-		} else if( _mem->_format.channels == 2 ) {
-			scalex_func = &SIMD::ConvolveAdaptive2Fixed;
-		} else {
-			scalex_func = &SIMD::ConvolveAdaptive4Fixed;
-		}
-
-		idst.reallocate( width, height, this->format() );
-
-		osrc = src = map( &sstride );
-		odst = dst = idst.map( &dstride );
-		send = src + sstride * _mem->_height;
-
-		bufsize = filter.getAdaptiveConvolutionWeights( height, _mem->_height, scalery, true );
-		filter.getAdaptiveConvolutionWeights( width, _mem->_width, scalerx, false );
-
-		buf = new Fixed*[ bufsize ];
-		// allocate and fill buffer
-		for( i = 0; i < bufsize; i++ ) {
-			if( posix_memalign( ( void** ) &buf[ i ], 16, sizeof( Fixed ) * width * _mem->_format.channels) )
-				throw CVTException("Out of memory");
-			( simd->*scalex_func )( buf[ i ], src, width, &scalerx );
-			src += sstride;
-		}
-		curbuf = 0;
-
-		pysw = scalery.size;
-		pyw = scalery.weights;
-
-		if( posix_memalign( ( void** ) &accumBuf, 16, sizeof( Fixed ) * width * _mem->_format.channels ) )
-			throw CVTException("Out of memory");
-
-		while( height-- ) {
-			if( pysw->incr ) {
-				for( k = 0; k < pysw->incr && src < send ; k++ ) {
-					( simd->*scalex_func )( buf[ ( curbuf + k ) % bufsize ], src, width, &scalerx );
-					src += sstride;
-				}
-				curbuf = ( curbuf + pysw->incr ) % bufsize;
-			}
-
-			l = 0;
-			while( *pyw == ( Fixed )0.0f ) {
-				l++;
-				pyw++;
-			}
-			simd->MulValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw++, width * _mem->_format.channels );
-			l++;
-			for( ; l < pysw->numw; l++ ) {
-				if( *pyw != ( Fixed )0.0f )
-					simd->MulAddValue1fx( accumBuf, buf[ ( curbuf + l ) % bufsize ], *pyw, width * _mem->_format.channels );
-				pyw++;
-			}
-
-			for( size_t w = 0;  w < width * _mem->_format.channels; w++ ){
-				dst[ w ] = Math::clamp( accumBuf[ w ].round(), 0, 255 );
-			}
-
-			pysw++;
-			dst += dstride;
-		}
-
-		idst.unmap( odst );
-		unmap( osrc );
-
-		free( accumBuf );
-		for( i = 0; i < bufsize; i++ )
-			free( buf[ i ] );
-		delete[] buf;
-		delete[] scalerx.size;
-		delete[] scalerx.weights;
-		delete[] scalery.size;
-		delete[] scalery.weights;
-	}
-
 	void Image::warpBilinear( Image& idst, const Image& warp ) const
 	{
 		size_t m, n, k, K;
@@ -88,7 +88,8 @@ namespace cvt {
 
 		switch ( t ) {
 			case IFILTER_OPENCL:
-				this->apply( *out, *in, radius );
+			case IFILTER_CPU:
+				this->apply( *out, *in, radius, t );
 				break;
 			default:
 				throw CVTException( "Not implemented" );
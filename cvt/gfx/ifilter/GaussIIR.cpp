@@ -28,7 +28,10 @@
 #include <cvt/cl/CLContext.h>
 #include <cvt/cl/kernel/gaussiir.h>
 #include <cvt/cl/kernel/gaussiir2.h>
-#include <cvt/math/Fixed.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/gfx/IMapScoped.h>
 
 
 namespace cvt {
@@ -161,7 +164,7 @@ namespace cvt {
 		&porder
 	};
 
-	GaussIIR::GaussIIR() : IFilter( "GaussIIR", _params, 4, IFILTER_OPENCL ), _kernelIIR( 0 ), _kernelIIR2( 0 )
+	GaussIIR::GaussIIR() : IFilter( "GaussIIR", _params, 4, IFILTER_CPU | IFILTER_OPENCL ), _kernelIIR( 0 ), _kernelIIR2( 0 )
 	{
 	}
 
@@ -174,6 +177,11 @@ namespace cvt {
 
 	}
 
+	void GaussIIR::coefficients( float sigma, int order, Vector4f& n, Vector4f& m, Vector4f& d )
+	{
+		_GaussIIRCoeff( sigma, order, n, m, d );
+	}
+
 	void GaussIIR::apply( const ParamSet* set, IFilterType t ) const
 	{
 		Image * in = set->arg<Image*>( 0 );
@@ -249,290 +257,200 @@ namespace cvt {
 		_kernelIIR2->run( CLNDRange( Math::pad16( w ) ), _kernelIIR->bestLocalRange1d( CLNDRange( Math::pad16( w ) ) ) );
 	}
 
-	void GaussIIR::applyCPUf( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
-	{
-		float b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
-		float b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f );
-
-		size_t sstride, dstride;
-		const float * inTmp = src.map<float>( &sstride );
-		float * outTmp = dst.map<float>( &dstride );
-		const float * in = inTmp;
-		float * out = outTmp;
-
-		uint32_t h = dst.height();
-		uint32_t w = dst.width();
-		uint32_t channels = dst.channels();
-
-		/* last four values */
-		const float* x;
-		float* y;
-
-		float tmpLine[ channels * w ];
-		float * tmpBuf = tmpLine + channels * ( w - 1 );
-
-		// horizontal pass
-		for( uint32_t k = 0; k < h; k++ ){
-			x = in;
-			y = out;
-
-			for( uint32_t c = 0; c < channels; c++ ){
-				y[ c ] = n[ 0 ] * x[ c ] + n[ 1 ] * x[ c ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- b1 * ( d[ 0 ] * x[ c ] + d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				y[ c + channels  ] = n[ 0 ] * x[ c + channels ] + n[ 1 ] * x[ c ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c ] - b1 * ( d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				y[ c + 2 * channels ] = n[ 0 ] * x[ c + 2 * channels ] + n[ 1 ] * x[ c + channels ] + n[ 2 ] * x[ c ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c + channels ] - d[ 1 ] * y[ c ] - b1 * (  d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				y[ c + 3 * channels ] = n[ 0 ] * x[ c + 3 * channels ] + n[ 1 ] * x[ c + 2 * channels ] + n[ 2 ] * x[ c + channels ] + n[ 3 ] * x[ c ]
-				- d[ 0 ] * y[ c + 2 * channels ] - d[ 1 ] * y[ c + channels ] - d[ 2 ] * y[ c ] - b1 * d[ 3 ] * x[ c ];
+	/* signals per strip of the recursive passes, keeps the four rows of history in the cache */
+	static const size_t GAUSSIIR_STRIP = 512;
+	/* pixels per side of the transposed blocks */
+	static const size_t GAUSSIIR_TILE = 16;
+
+	/* causal and anticausal recursion along the rows of a float buffer, the columns are independent signals */
+	class GaussIIRPass {
+		public:
+			GaussIIRPass( float* dst, size_t dstride, const float* src, size_t sstride, size_t rows, size_t len,
+						  const Vector4f& n, const Vector4f& m, const Vector4f& d ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _rows( rows ), _len( len )
+			{
+				float sd = d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + 1.0f;
+				for( size_t i = 0; i < 4; i++ ) {
+					_cn[ i ] = n[ i ];
+					_cm[ i ] = m[ i ];
+					_cn[ 4 + i ] = _cm[ 4 + i ] = d[ i ];
+				}
+				/* steady state responses for a replicated border */
+				_b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / sd;
+				_b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / sd;
 			}
 
-			// forward pass
-			for( uint32_t i = 4; i < w; i++ ){
-				x+=channels; /* last 4 pixels, x[ 3*channels ] is current pixel */
+			size_t strips() const { return ( _len + GAUSSIIR_STRIP - 1 ) / GAUSSIIR_STRIP; }
 
-				for( uint32_t c = 0; c < channels; c++ ){
-					y[ 4 * channels + c ] = n[ 0 ] * x[ 3 * channels + c ] + n[ 1 ] * x[ 2 * channels + c ] + n[ 2 ] * x[ channels + c ] + n[ 3 ] * x[ c ]
-					- d[ 0 ] * y[ 3 * channels + c ] - d[ 1 ] * y[ 2 * channels + c ] - d[ 2 ] * y[ channels + c ] - d[ 3 ] * y[ c ];
+			void operator()( size_t begin, size_t end )
+			{
+				for( size_t s = begin; s < end; s++ ) {
+					size_t j = s * GAUSSIIR_STRIP;
+					strip( j, Math::min( _len - j, GAUSSIIR_STRIP ) );
 				}
-				y+=channels;
 			}
 
-			// backward border init:
-			x = ( in + channels * ( w - 1 ) );
-			y = ( out + channels * ( w - 1 ) );
-			for( uint32_t c = 0; c < channels; c++ ){
-				tmpBuf[ c ] = m[ 0 ] * x[ c ] + m[ 1 ] * x[ c ] + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- b2 * ( d[ 0 ] * x[ c ] + d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				*( tmpBuf - channels + c ) = m[ 0 ] * *( x - channels + c ) + m[ 1 ] * x[ c ] + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- d[ 0 ] * tmpBuf[ c ] - b2 * ( d[ 1 ] * x[ c ] + d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				*( tmpBuf - 2 * channels + c ) = m[ 0 ] * *( x - 2 * channels + c ) + m[ 1 ] * *( x - channels + c ) + m[ 2 ] * x[ c ] + m[ 3 ] * x[ c ]
-				- d[ 0 ] * *( tmpBuf - channels + c ) - d[ 1 ] * tmpBuf[ c ] - b2 * (  d[ 2 ] * x[ c ] + d[ 3 ] * x[ c ] );
-
-				*( tmpBuf - 3 * channels + c ) = m[ 0 ] * *( x - 3 * channels + c ) + m[ 1 ] * *( x - 2 * channels + c ) + m[ 2 ] * *( x - channels + c ) + m[ 3 ] * x[ c ]
-				- d[ 0 ] * *( tmpBuf - 2 * channels + c ) - d[ 1 ] * *( tmpBuf - channels + c ) - d[ 2 ] * tmpBuf[ c ] - b2 * d[ 3 ] * x[ c ];
-
-				y[ c ] += tmpBuf[ c ];
-				*( y - channels + c ) += *( tmpBuf - channels + c );
-				*( y - 2 * channels + c ) += *( tmpBuf - 2 * channels + c );
-				*( y - 3 * channels + c ) += *( tmpBuf - 3 * channels + c );
-			}
+		private:
+			void strip( size_t j, size_t k )
+			{
+				SIMD* simd = SIMD::instance();
+				float buf[ 5 * GAUSSIIR_STRIP ];
+				float* init = buf;
+				float* ring = buf + GAUSSIIR_STRIP;
+				const float* x[ 4 ];
+				const float* y[ 4 ];
+				ssize_t rows = _rows;
+
+				/* causal pass, writes dst */
+				const float* first = _src + j;
+				for( size_t i = 0; i < k; i++ )
+					init[ i ] = _b1 * first[ i ];
+				for( ssize_t r = 0; r < rows; r++ ) {
+					for( ssize_t l = 0; l < 4; l++ ) {
+						x[ l ] = _src + Math::max<ssize_t>( r - l, 0 ) * _sstride + j;
+						y[ l ] = r - 1 - l >= 0 ? _dst + ( r - 1 - l ) * _dstride + j : init;
+					}
+					simd->IIR4_f( _dst + r * _dstride + j, NULL, x, y, _cn, k );
+				}
 
-			// backward pass
-			y -= ( 4 * channels );
-			for (int i = w-4; i > 0; i--) {
-				x-=channels;
-				for( uint32_t c = 0; c < channels; c++ ){
-					*( tmpBuf - 4 * channels + c ) = ( m[ 0 ] * *( x - 3 * channels + c ) + m[ 1 ] * *( x - 2 * channels + c ) + m[ 2 ] * *( x - channels + c ) + m[ 3 ] * x[ c ]
-					- d[ 0 ] * *( tmpBuf - 3 * channels + c ) - d[ 1 ] * *( tmpBuf - 2 * channels + c ) - d[ 2 ] * *( tmpBuf - channels + c ) - d[ 3 ] * tmpBuf[ c ] );
-					y[ c ] += *( tmpBuf - 4 * channels + c );
+				/* anticausal pass, the last four results are kept in the ring and added to dst */
+				const float* last = _src + ( rows - 1 ) * _sstride + j;
+				for( size_t i = 0; i < k; i++ )
+					init[ i ] = _b2 * last[ i ];
+				for( ssize_t r = rows - 1; r >= 0; r-- ) {
+					for( ssize_t l = 0; l < 4; l++ ) {
+						x[ l ] = _src + Math::min<ssize_t>( r + l, rows - 1 ) * _sstride + j;
+						y[ l ] = r + 1 + l < rows ? ring + ( ( r + 1 + l ) & 3 ) * GAUSSIIR_STRIP : init;
+					}
+					simd->IIR4_f( ring + ( r & 3 ) * GAUSSIIR_STRIP, _dst + r * _dstride + j, x, y, _cm, k );
 				}
-				tmpBuf-=channels;
 			}
 
-			in += sstride;
-			out += dstride;
-		}
+			float*			_dst;
+			size_t			_dstride;
+			const float*	_src;
+			size_t			_sstride;
+			size_t			_rows;
+			size_t			_len;
+			float			_cn[ 8 ];
+			float			_cm[ 8 ];
+			float			_b1, _b2;
+	};
 
-		// vertical pass
-		const float * x0 = inTmp;
-		const float * x1 = x0 + sstride;
-		const float * x2 = x1 + sstride;
-		const float * x3 = x2 + sstride;
-		float * y0 = outTmp;
-		float * y1 = y0 + dstride;
-		float * y2 = y1 + dstride;
-		float * y3 = y2 + dstride;
-		for( size_t i = 0; i < w; i++ ){
-			for( uint32_t c = 0; c < channels; c++ ){
-				y0[ c ] = n[ 0 ] * x0[ c ] + n[ 1 ] * x0[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- b1 * ( d[ 0 ] * x0[ c ] + d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y1[ c ] = n[ 0 ] * x1[ c ] + n[ 1 ] * x0[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y0[ c ] - b1 * ( d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y2[ c ] = n[ 0 ] * x2[ c ] + n[ 1 ] * x1[ c ] + n[ 2 ] * x0[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y1[ c ] - d[ 1 ] * y0[ c ] - b1 * (  d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-
-				y3[ c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-				- d[ 0 ] * y2[ c ] - d[ 1 ] * y1[ c ] - d[ 2 ] * y0[ c ] - b1 * d[ 3 ] * x0[ c ];
+	/* blocked transpose of pixels with a number of float channels */
+	class GaussIIRTranspose {
+		public:
+			GaussIIRTranspose( float* dst, size_t dstride, const float* src, size_t sstride, size_t width, size_t height, size_t channels ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width ), _height( height ), _channels( channels )
+			{
 			}
-			x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-			y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-		}
 
-		float * currOut;
-		// from fourth line to end:
-		for( uint32_t i = 4; i < h; i++ ){
-			x0 = inTmp + i * sstride;
-			x1 = x0 + sstride;
-			x2 = x1 + sstride;
-			x3 = x2 + sstride;
-
-			y0 = outTmp + ( i - 4 ) * dstride;
-			y1 = y0 + dstride;
-			y2 = y1 + dstride;
-			y3 = y2 + dstride;
-			currOut = y3 + dstride;
-
-			for( uint32_t j = 0; j < w; j++ ){
-				for( uint32_t c = 0; c < channels; c++ ){
-					currOut[ c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-					- d[ 0 ] * y3[ c ] - d[ 1 ] * y2[ c ] - d[ 2 ] * y1[ c ] - d[ 3 ] * y0[ c ];
+			size_t blocks() const { return ( _height + GAUSSIIR_TILE - 1 ) / GAUSSIIR_TILE; }
+
+			void operator()( size_t begin, size_t end )
+			{
+				const size_t c = _channels;
+				for( size_t b = begin; b < end; b++ ) {
+					size_t y0 = b * GAUSSIIR_TILE;
+					size_t y1 = Math::min( y0 + GAUSSIIR_TILE, _height );
+					for( size_t x0 = 0; x0 < _width; x0 += GAUSSIIR_TILE ) {
+						size_t x1 = Math::min( x0 + GAUSSIIR_TILE, _width );
+						for( size_t y = y0; y < y1; y++ ) {
+							const float* s = _src + y * _sstride + x0 * c;
+							float* d = _dst + x0 * _dstride + y * c;
+							for( size_t x = x0; x < x1; x++ ) {
+								for( size_t i = 0; i < c; i++ )
+									d[ i ] = s[ i ];
+								s += c;
+								d += _dstride;
+							}
+						}
+					}
 				}
-				x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-				y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-				currOut+=channels;
 			}
-		}
 
-		x0 = inTmp + ( h - 1 ) * sstride;
-		x1 = x0 - sstride;
-		x2 = x1 - sstride;
-		x3 = x2 - sstride;
-
-		float tmpBuffer[ 4 * w * channels ];
-		y0 = outTmp + ( h - 1 ) * dstride;
-		y1 = y0 - dstride;
-		y2 = y1 - dstride;
-		y3 = y2 - dstride;
-
-		float * t0 = ( tmpBuffer + 3 * w * channels );
-		float * t1 = ( tmpBuffer + 2 * w * channels );
-		float * t2 = ( tmpBuffer + 1 * w * channels );
-		float * t3 = ( tmpBuffer );
-
-		for( size_t i = 0; i < w; i++ ){
-			for( uint32_t c = 0; c < channels; c++ ){
-				t0[ c ] = m[ 0 ] * x0[ c ] + m[ 1 ] * x0[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- b1 * ( d[ 0 ] * x0[ c ] + d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y0[ c ] += t0[ c ];
-
-				t1[ c ] = m[ 0 ] * x1[ c ] + m[ 1 ] * x0[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t0[ c ] - b1 * ( d[ 1 ] * x0[ c ] + d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y1[ c ] += t1[ c ];
-
-				t2[ c ] = m[ 0 ] * x2[ c ] + m[ 1 ] * x1[ c ] + m[ 2 ] * x0[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t1[ c ] - d[ 1 ] * t0[ c ] - b1 * (  d[ 2 ] * x0[ c ] + d[ 3 ] * x0[ c ] );
-				y2[ c ] += t2[ c ];
-
-				t3[ c ] = m[ 0 ] * x3[ c ] + m[ 1 ] * x2[ c ] + m[ 2 ] * x1[ c ] + m[ 3 ] * x0[ c ]
-				- d[ 0 ] * t2[ c ] - d[ 1 ] * t1[ c ] - d[ 2 ] * t0[ c ] - b1 * d[ 3 ] * x0[ c ];
-				y3[ c ] += t3[ c ];
-			}
-			x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-			y0+=channels; y1+=channels; y2+=channels; y3+=channels;
-			t0+=channels; t1+=channels; t2+=channels; t3+=channels;
-		}
+		private:
+			float*			_dst;
+			size_t			_dstride;
+			const float*	_src;
+			size_t			_sstride;
+			size_t			_width;
+			size_t			_height;
+			size_t			_channels;
+	};
 
-		float* tmp;
-		t0 = ( tmpBuffer + 3 * w * channels );
-		t1 = ( tmpBuffer + 2 * w * channels );
-		t2 = ( tmpBuffer + 1 * w * channels );
-		t3 = ( tmpBuffer );
-		for( uint32_t i = h - 4; i > 0; i-- ){
-			x0 = inTmp + ( i + 2 ) * sstride;
-			x1 = x0 - sstride;
-			x2 = x1 - sstride;
-			x3 = x2 - sstride;
-
-			currOut = outTmp + ( i - 1 ) * dstride;
-
-			for( uint32_t j = 0; j < w; j++ ){
-				for( uint32_t c = 0; c < channels; c++ ){
-					t0[ j * channels + c ] = n[ 0 ] * x3[ c ] + n[ 1 ] * x2[ c ] + n[ 2 ] * x1[ c ] + n[ 3 ] * x0[ c ]
-					- d[ 0 ] * t3[ j * channels + c ] - d[ 1 ] * t2[ j * channels + c ] - d[ 2 ] * t1[ j * channels + c ] - d[ 3 ] * t0[ j * channels + c ];
-					currOut[ c ] += t0[ j * channels + c ];
-				}
+	/*
+	   Vertical pass straight on the image rows, the horizontal pass as a vertical pass
+	   on the transposed result. Work is split into column strips and row blocks.
+	 */
+	static void _GaussIIRCPU( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d )
+	{
+		SIMD* simd = SIMD::instance();
+		size_t w = src.width();
+		size_t h = src.height();
+		size_t c = src.channels();
+		size_t len = w * c;
+		bool isfloat = src.format().type == IFORMAT_TYPE_FLOAT;
+
+		if( !w || !h )
+			return;
+		if( &dst != &src )
+			dst.reallocate( w, h, src.format() );
+
+		ScopedBuffer<float, true> memA( w * h * c );
+		ScopedBuffer<float, true> memB( w * h * c );
+		float* bufA = memA.ptr();
+		float* bufB = memB.ptr();
 
-				// next pixel of row
-				x0+=channels; x1+=channels; x2+=channels; x3+=channels;
-				currOut+=channels;
+		{
+			/* unmapped before dst is mapped, src and dst may be the same image */
+			IMapScoped<const uint8_t> msrc( src );
+			const uint8_t* psrc = msrc.base();
+			size_t sstride = msrc.stride();
+			const float* in;
+			size_t instride;
+			if( isfloat ) {
+				in = ( const float* ) psrc;
+				instride = sstride / sizeof( float );
+			} else {
+				for( size_t y = 0; y < h; y++ )
+					simd->Conv_u8_to_f( bufA + y * len, psrc + y * sstride, len );
+				in = bufA;
+				instride = len;
 			}
-			tmp = t0;
-			t0 = t1; t1 = t2; t2 = t3; t3 = tmp;
+
+			/* vertical */
+			GaussIIRPass vert( bufB, len, in, instride, h, len, n, m, d );
+			ParallelFor::run( vert, 0, vert.strips(), 1 );
 		}
 
-		src.unmap( inTmp );
-		dst.unmap( outTmp );
+		/* horizontal on the transposed image */
+		GaussIIRTranspose tr( bufA, h * c, bufB, len, w, h, c );
+		ParallelFor::run( tr, 0, tr.blocks(), 1 );
+		GaussIIRPass horiz( bufB, h * c, bufA, h * c, w, h * c, n, m, d );
+		ParallelFor::run( horiz, 0, horiz.strips(), 1 );
+
+		IMapScoped<uint8_t> mdst( dst );
+		uint8_t* pdst = mdst.base();
+		size_t dstride = mdst.stride();
+		if( isfloat ) {
+			GaussIIRTranspose back( ( float* ) pdst, dstride / sizeof( float ), bufB, h * c, h, w, c );
+			ParallelFor::run( back, 0, back.blocks(), 1 );
+		} else {
+			GaussIIRTranspose back( bufA, len, bufB, h * c, h, w, c );
+			ParallelFor::run( back, 0, back.blocks(), 1 );
+			for( size_t y = 0; y < h; y++ )
+				simd->Conv_f_to_u8( pdst + y * dstride, bufA + y * len, len );
+		}
 	}
 
-	void GaussIIR::applyCPUu8( Image& dst, const Image& src, const Vector4f & _n, const Vector4f & _m, const Vector4f & _d ) const
+	void GaussIIR::applyCPUf( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
 	{
-		uint32_t h = dst.height();
-		uint32_t w = dst.width();
-		uint32_t channels = dst.channels();
-		
-		void (SIMD::*fwdHoriz)( Fixed* dst, const uint8_t * src, size_t width, const Fixed * n, const Fixed * d, const Fixed & b1 ) const;
-		void (SIMD::*bwdHoriz)( uint8_t * dst, const Fixed* fwdRes, const uint8_t * src, size_t w, const Fixed * n, const Fixed * d, const Fixed & b  ) const;
-		void (SIMD::*fwdVert)( Fixed* buffer, const uint8_t * src, size_t sstride, size_t h, const Fixed * n, const Fixed * d, const Fixed & b ) const;
-		void (SIMD::*bwdVert)( uint8_t * dst, size_t dstride, Fixed* fwdRes, size_t h, const Fixed * n, const Fixed * d, const Fixed & b ) const;
-		
-		SIMD * simd = SIMD::instance();		
-		switch ( channels ) {
-			case 4:
-				fwdHoriz = &SIMD::IIR4FwdHorizontal4Fx;
-				bwdHoriz = &SIMD::IIR4BwdHorizontal4Fx;
-				fwdVert = &SIMD::IIR4FwdVertical4Fx;
-				bwdVert = &SIMD::IIR4BwdVertical4Fx;
-				break;
-			default:
-				String msg;
-				msg.sprintf( "Not implement for number of channles: %d", channels );
-				throw CVTException( msg.c_str() );
-				break;
-		}
-		
-		
-		Fixed n[ 4 ], m[ 4 ], d[ 4 ];
-		n[ 0 ] = _n[ 0 ]; n[ 1 ] = _n[ 1 ]; n[ 2 ] = _n[ 2 ]; n[ 3 ] = _n[ 3 ];
-		m[ 0 ] = _m[ 0 ]; m[ 1 ] = _m[ 1 ]; m[ 2 ] = _m[ 2 ]; m[ 3 ] = _m[ 3 ];
-		d[ 0 ] = _d[ 0 ]; d[ 1 ] = _d[ 1 ]; d[ 2 ] = _d[ 2 ]; d[ 3 ] = _d[ 3 ];
-
-		Fixed one( 1.0f );
-		Fixed b1 = ( n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + one );
-		Fixed b2 = ( m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / ( d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ] + one );
-
-		size_t sstride, dstride;
-		const uint8_t * in = src.map<uint8_t>( &sstride );
-		uint8_t * out = dst.map<uint8_t>( &dstride );
-
-		/* last four values */
-		const uint8_t* x = in;
-		uint8_t* y = out;
-
-		Fixed* tmpLine = new Fixed[ channels * w ];		
-
-		// horizontal pass
-		for( uint32_t k = 0; k < h; k++ ){
-			( simd->*fwdHoriz )( tmpLine, x, w, n, d, b1 );
-			( simd->*bwdHoriz )( y, tmpLine, x, w, m, d, b2 );
-
-			x += sstride;
-			y += dstride;
-		}
-        delete[] tmpLine;
-
-		// vertical pass:
-		// buffer for 4 lines:
-		Fixed* column = new Fixed[ channels * h ];
-		x = in;
-		y = out;
-		for( uint32_t k = 0; k < w; k++ ){
-			( simd->*fwdVert )( column, y, dstride, h, n, d, b1 );
-			( simd->*bwdVert )( y, dstride, column, h, m, d, b2 );
-			x += channels;
-			y += channels;
-		}
-        delete[] column;
-
+		_GaussIIRCPU( dst, src, n, m, d );
+	}
 
-		src.unmap( in );
-		dst.unmap( out );
+	void GaussIIR::applyCPUu8( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const
+	{
+		_GaussIIRCPU( dst, src, n, m, d );
 	}
 }
@@ -40,6 +40,9 @@ namespace cvt
 			void	applyCPUu8( Image& dst, const Image& src, const Vector4f & n, const Vector4f & m, const Vector4f & d ) const;
 			void	apply( const ParamSet* set, IFilterType t = IFILTER_CPU ) const;
 
+			/* coefficients of the recursive approximation of a gaussian ( order 0 ) or its derivatives for the apply methods */
+			static void coefficients( float sigma, int order, Vector4f& n, Vector4f& m, Vector4f& d );
+
 		private:
 			mutable CLKernel*	_kernelIIR;
 			mutable CLKernel*	_kernelIIR2;
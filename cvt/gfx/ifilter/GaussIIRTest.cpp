@@ -0,0 +1,159 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/GaussIIR.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/RNG.h>
+#include <vector>
+
+namespace cvt {
+
+	/* causal plus anticausal recursion on one signal with replicated borders, in double precision */
+	static void _gaussIIRRef( double* data, size_t len, size_t step, const Vector4f& n, const Vector4f& m, const Vector4f& d )
+	{
+		ssize_t N = len;
+		std::vector<double> x( N ), yc( N ), ya( N );
+		for( ssize_t i = 0; i < N; i++ )
+			x[ i ] = data[ i * step ];
+
+		double sd = 1.0 + d[ 0 ] + d[ 1 ] + d[ 2 ] + d[ 3 ];
+		double b1 = ( ( double ) n[ 0 ] + n[ 1 ] + n[ 2 ] + n[ 3 ] ) / sd;
+		double b2 = ( ( double ) m[ 0 ] + m[ 1 ] + m[ 2 ] + m[ 3 ] ) / sd;
+
+		for( ssize_t i = 0; i < N; i++ ) {
+			double v = 0.0;
+			for( ssize_t l = 0; l < 4; l++ ) {
+				v += n[ l ] * x[ Math::max<ssize_t>( i - l, 0 ) ];
+				v -= d[ l ] * ( i - 1 - l >= 0 ? yc[ i - 1 - l ] : b1 * x[ 0 ] );
+			}
+			yc[ i ] = v;
+		}
+
+		for( ssize_t i = N - 1; i >= 0; i-- ) {
+			double v = 0.0;
+			for( ssize_t l = 0; l < 4; l++ ) {
+				v += m[ l ] * x[ Math::min<ssize_t>( i + l, N - 1 ) ];
+				v -= d[ l ] * ( i + 1 + l < N ? ya[ i + 1 + l ] : b2 * x[ N - 1 ] );
+			}
+			ya[ i ] = v;
+		}
+
+		for( ssize_t i = 0; i < N; i++ )
+			data[ i * step ] = yc[ i ] + ya[ i ];
+	}
+
+	static bool _gaussIIRTest( RNG& rng, size_t w, size_t h, const IFormat& format, float sigma, int order, bool inplace )
+	{
+		size_t c = format.channels;
+		bool isfloat = format.type == IFORMAT_TYPE_FLOAT;
+		Image src( w, h, format ), dst;
+		std::vector<double> ref( w * h * c );
+		{
+			IMapScoped<uint8_t> map( src );
+			for( size_t y = 0; y < h; y++ ) {
+				for( size_t x = 0; x < w * c; x++ ) {
+					if( isfloat )
+						ref[ y * w * c + x ] = ( ( float* ) map.ptr() )[ x ] = rng.uniform( 0.0f, 1.0f );
+					else
+						ref[ y * w * c + x ] = ( map.ptr()[ x ] = rng.uint32( 256 ) ) / 255.0;
+				}
+				map++;
+			}
+		}
+
+		Vector4f n, m, d;
+		GaussIIR::coefficients( sigma, order, n, m, d );
+
+		GaussIIR filter;
+		Image& out = inplace ? src : dst;
+		if( isfloat )
+			filter.applyCPUf( out, src, n, m, d );
+		else
+			filter.applyCPUu8( out, src, n, m, d );
+		if( inplace )
+			dst = src;
+
+		for( size_t y = 0; y < h; y++ )
+			for( size_t i = 0; i < c; i++ )
+				_gaussIIRRef( &ref[ y * w * c + i ], w, c, n, m, d );
+		for( size_t x = 0; x < w * c; x++ )
+			_gaussIIRRef( &ref[ x ], h, w * c, n, m, d );
+
+		if( dst.width() != w || dst.height() != h || dst.format() != format )
+			return false;
+
+		/* every pixel including the borders, u8 results are rounded and clamped */
+		IMapScoped<const uint8_t> map( dst );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w * c; x++ ) {
+				double r = ref[ y * w * c + x ];
+				double v = isfloat ? ( ( const float* ) map.ptr() )[ x ] : map.ptr()[ x ];
+				bool ok = isfloat ? Math::abs( v - r ) <= 2e-5 : Math::abs( v - Math::clamp( r * 255.0, 0.0, 255.0 ) ) <= 0.51;
+				if( !ok ) {
+					std::cout << "GaussIIR " << w << "x" << h << " sigma " << sigma << " order " << order << " differs at "
+							  << x / c << ", " << y << ": " << v << " " << r << std::endl;
+					return false;
+				}
+			}
+			map++;
+		}
+		return true;
+	}
+
+BEGIN_CVTTEST( GaussIIR )
+	bool result = true;
+	bool b;
+	RNG rng( 1337 );
+
+	b = _gaussIIRTest( rng, 37, 29, IFormat::GRAY_FLOAT, 1.0f, 0, false );
+	b &= _gaussIIRTest( rng, 64, 48, IFormat::GRAY_FLOAT, 3.5f, 0, false );
+	b &= _gaussIIRTest( rng, 3, 2, IFormat::GRAY_FLOAT, 2.0f, 0, false );
+	CVTTEST_PRINT( "gray", b );
+	result &= b;
+
+	/* several strips and partial transpose tiles */
+	b = _gaussIIRTest( rng, 150, 41, IFormat::RGBA_FLOAT, 2.0f, 0, false );
+	b &= _gaussIIRTest( rng, 17, 530, IFormat::RGBA_FLOAT, 6.0f, 0, false );
+	CVTTEST_PRINT( "rgba", b );
+	result &= b;
+
+	b = _gaussIIRTest( rng, 45, 33, IFormat::GRAY_FLOAT, 2.5f, 1, false );
+	CVTTEST_PRINT( "first derivative", b );
+	result &= b;
+
+	b = _gaussIIRTest( rng, 53, 21, IFormat::RGBA_FLOAT, 1.5f, 0, true );
+	CVTTEST_PRINT( "in place", b );
+	result &= b;
+
+	b = _gaussIIRTest( rng, 61, 43, IFormat::GRAY_UINT8, 2.0f, 0, false );
+	b &= _gaussIIRTest( rng, 150, 41, IFormat::RGBA_UINT8, 3.0f, 0, false );
+	b &= _gaussIIRTest( rng, 29, 35, IFormat::RGBA_UINT8, 1.5f, 0, true );
+	CVTTEST_PRINT( "u8", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
@@ -23,6 +23,11 @@
 */
 
 #include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/ParallelFor.h>
+#include <vector>
 
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_calcab.h>
 #include <cvt/cl/kernel/guidedfilter/guidedfilter_calcab_outerrgb.h>
@@ -36,29 +41,66 @@ namespace cvt {
 	static ParamInfoTyped<Image*> pout( "Output", false );
 	static ParamInfoTyped<int>	  pradius( "Radius", true );
 	static ParamInfoTyped<float>  pepsilon( "Epsilon", true );
+	static ParamInfoTyped<int>	  psubsample( "Subsample", 1, 16, 1, true );
 
-	static ParamInfo * _params[ 5 ] = {
+	static ParamInfo * _params[ 6 ] = {
 		&pin,
 		&pinguide,
 		&pout,
 		&pradius,
 		&pepsilon,
+		&psubsample
 	};
 
 	GuidedFilter::GuidedFilter() :
-		IFilter( "GuidedFilter", _params, 5, IFILTER_CPU | IFILTER_OPENCL ),
-		_clguidedfilter_calcab( _guidedfilter_calcab_source, "guidedfilter_calcab" ),
-		_clguidedfilter_calcab_outerrgb( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" ),
-		_clguidedfilter_applyab_gc( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" ),
-		_clguidedfilter_applyab_gc_outer( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" ),
-		_clguidedfilter_applyab_cc( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" )
+		IFilter( "GuidedFilter", _params, 6, IFILTER_CPU | IFILTER_OPENCL ),
+		_clguidedfilter_calcab( 0 ),
+		_clguidedfilter_calcab_outerrgb( 0 ),
+		_clguidedfilter_applyab_gc( 0 ),
+		_clguidedfilter_applyab_gc_outer( 0 ),
+		_clguidedfilter_applyab_cc( 0 ),
+		_intfilter( 0 ),
+		_boxfilter( 0 )
 	{
 	}
 
+	GuidedFilter::~GuidedFilter()
+	{
+		if( _clguidedfilter_calcab ) {
+			delete _clguidedfilter_calcab;
+			delete _clguidedfilter_calcab_outerrgb;
+			delete _clguidedfilter_applyab_gc;
+			delete _clguidedfilter_applyab_gc_outer;
+			delete _clguidedfilter_applyab_cc;
+			delete _intfilter;
+			delete _boxfilter;
+		}
+	}
+
+	/*
+	   the kernels need a CL context, create them on first use so the CPU path works without one,
+	   the lock makes concurrent apply calls on the same filter safe
+	 */
+	void GuidedFilter::initCL() const
+	{
+		ScopeLock lock( &_clmutex );
+		if( _clguidedfilter_calcab )
+			return;
+		_clguidedfilter_calcab = new CLKernel( _guidedfilter_calcab_source, "guidedfilter_calcab" );
+		_clguidedfilter_calcab_outerrgb = new CLKernel( _guidedfilter_calcab_outerrgb_source, "guidedfilter_calcab_outerrgb" );
+		_clguidedfilter_applyab_gc = new CLKernel( _guidedfilter_applyab_gc_source, "guidedfilter_applyab_gc" );
+		_clguidedfilter_applyab_gc_outer = new CLKernel( _guidedfilter_applyab_gc_outer_source, "guidedfilter_applyab_gc_outer" );
+		_clguidedfilter_applyab_cc = new CLKernel( _guidedfilter_applyab_cc_source, "guidedfilter_applyab_cc" );
+		_intfilter = new IntegralFilter();
+		_boxfilter = new BoxFilter();
+	}
+
 	void GuidedFilter::apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance ) const
 	{
 		// G guidance image, S source image
 
+		initCL();
+
 		if( rgbcovariance ) {
 			applyGC_COV( dst, src, guide, radius, epsilon );
 		} else if( src.format().channels <= 2 ) {
@@ -78,38 +120,38 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL ); // FIXME: use only RGBA/GRAY/GRAYALPHA for SRC * GUIDE
 		Image imeanGG( src.width(), src.height(), IFormat::floatEquivalent( guide.format() ), IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab.setArg( 0, ia );
-		_clguidedfilter_calcab.setArg( 1, ib );
-		_clguidedfilter_calcab.setArg( 2, imeanG );
-		_clguidedfilter_calcab.setArg( 3, imeanS );
-		_clguidedfilter_calcab.setArg( 4, imeanGS );
-		_clguidedfilter_calcab.setArg( 5, imeanGG );
-		_clguidedfilter_calcab.setArg( 6, epsilon );
-		_clguidedfilter_calcab.run( global, local);
+		_clguidedfilter_calcab->setArg( 0, ia );
+		_clguidedfilter_calcab->setArg( 1, ib );
+		_clguidedfilter_calcab->setArg( 2, imeanG );
+		_clguidedfilter_calcab->setArg( 3, imeanS );
+		_clguidedfilter_calcab->setArg( 4, imeanGS );
+		_clguidedfilter_calcab->setArg( 5, imeanGG );
+		_clguidedfilter_calcab->setArg( 6, epsilon );
+		_clguidedfilter_calcab->run( global, local);
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_gc.setArg( 0, dst );
-		_clguidedfilter_applyab_gc.setArg( 1, guide );
-		_clguidedfilter_applyab_gc.setArg( 2, ia );
-		_clguidedfilter_applyab_gc.setArg( 3, ib );
-		_clguidedfilter_applyab_gc.run( global, local );
+		_clguidedfilter_applyab_gc->setArg( 0, dst );
+		_clguidedfilter_applyab_gc->setArg( 1, guide );
+		_clguidedfilter_applyab_gc->setArg( 2, ia );
+		_clguidedfilter_applyab_gc->setArg( 3, ib );
+		_clguidedfilter_applyab_gc->run( global, local );
 	}
 
 	void GuidedFilter::applyGC_COV( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const
@@ -125,41 +167,41 @@ namespace cvt {
 		Image imean_RR_RG_RB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imean_GG_GB_BB( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.applyOuterRGB( iint, iint2, guide );
-		_boxfilter.apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
-		_boxfilter.apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->applyOuterRGB( iint, iint2, guide );
+		_boxfilter->apply( imean_RR_RG_RB, iint, radius, IFILTER_OPENCL );
+		_boxfilter->apply( imean_GG_GB_BB, iint2, radius, IFILTER_OPENCL );
 
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab_outerrgb.setArg( 0, ia );
-		_clguidedfilter_calcab_outerrgb.setArg( 1, ib );
-		_clguidedfilter_calcab_outerrgb.setArg( 2, imeanG );
-		_clguidedfilter_calcab_outerrgb.setArg( 3, imeanS );
-		_clguidedfilter_calcab_outerrgb.setArg( 4, imeanGS );
-		_clguidedfilter_calcab_outerrgb.setArg( 5, imean_RR_RG_RB );
-		_clguidedfilter_calcab_outerrgb.setArg( 6, imean_GG_GB_BB );
-		_clguidedfilter_calcab_outerrgb.setArg( 7, epsilon );
-		_clguidedfilter_calcab_outerrgb.run( global, local );
-
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_clguidedfilter_calcab_outerrgb->setArg( 0, ia );
+		_clguidedfilter_calcab_outerrgb->setArg( 1, ib );
+		_clguidedfilter_calcab_outerrgb->setArg( 2, imeanG );
+		_clguidedfilter_calcab_outerrgb->setArg( 3, imeanS );
+		_clguidedfilter_calcab_outerrgb->setArg( 4, imeanGS );
+		_clguidedfilter_calcab_outerrgb->setArg( 5, imean_RR_RG_RB );
+		_clguidedfilter_calcab_outerrgb->setArg( 6, imean_GG_GB_BB );
+		_clguidedfilter_calcab_outerrgb->setArg( 7, epsilon );
+		_clguidedfilter_calcab_outerrgb->run( global, local );
+
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_gc_outer.setArg( 0, dst );
-		_clguidedfilter_applyab_gc_outer.setArg( 1, guide );
-		_clguidedfilter_applyab_gc_outer.setArg( 2, ia );
-		_clguidedfilter_applyab_gc_outer.setArg( 3, ib );
-		_clguidedfilter_applyab_gc_outer.run( global, local );
+		_clguidedfilter_applyab_gc_outer->setArg( 0, dst );
+		_clguidedfilter_applyab_gc_outer->setArg( 1, guide );
+		_clguidedfilter_applyab_gc_outer->setArg( 2, ia );
+		_clguidedfilter_applyab_gc_outer->setArg( 3, ib );
+		_clguidedfilter_applyab_gc_outer->run( global, local );
 	}
 
 	void GuidedFilter::applyCC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const
@@ -173,38 +215,507 @@ namespace cvt {
 		Image imeanGS( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 		Image imeanGG( src.width(), src.height(), IFormat::RGBA_FLOAT, IALLOCATOR_CL );
 
-		_intfilter.apply( iint, guide );
-		_boxfilter.apply( imeanG, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, src );
-		_boxfilter.apply( imeanS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &src );
-		_boxfilter.apply( imeanGS, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, guide, &guide );
-		_boxfilter.apply( imeanGG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide );
+		_boxfilter->apply( imeanG, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, src );
+		_boxfilter->apply( imeanS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &src );
+		_boxfilter->apply( imeanGS, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, guide, &guide );
+		_boxfilter->apply( imeanGG, iint, radius, IFILTER_OPENCL );
 
 		CLNDRange global( Math::pad16( src.width() ), Math::pad16( src.height() ) );
 		CLNDRange local( 16, 16 );
 
-		_clguidedfilter_calcab.setArg( 0, ia );
-		_clguidedfilter_calcab.setArg( 1, ib );
-		_clguidedfilter_calcab.setArg( 2, imeanG );
-		_clguidedfilter_calcab.setArg( 3, imeanS );
-		_clguidedfilter_calcab.setArg( 4, imeanGS );
-		_clguidedfilter_calcab.setArg( 5, imeanGG );
-		_clguidedfilter_calcab.setArg( 6, epsilon );
-		_clguidedfilter_calcab.run( global, local );
+		_clguidedfilter_calcab->setArg( 0, ia );
+		_clguidedfilter_calcab->setArg( 1, ib );
+		_clguidedfilter_calcab->setArg( 2, imeanG );
+		_clguidedfilter_calcab->setArg( 3, imeanS );
+		_clguidedfilter_calcab->setArg( 4, imeanGS );
+		_clguidedfilter_calcab->setArg( 5, imeanGG );
+		_clguidedfilter_calcab->setArg( 6, epsilon );
+		_clguidedfilter_calcab->run( global, local );
 
-		_intfilter.apply( iint, ia );
-		_boxfilter.apply( ia, iint, radius, IFILTER_OPENCL );
-		_intfilter.apply( iint, ib );
-		_boxfilter.apply( ib, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ia );
+		_boxfilter->apply( ia, iint, radius, IFILTER_OPENCL );
+		_intfilter->apply( iint, ib );
+		_boxfilter->apply( ib, iint, radius, IFILTER_OPENCL );
 
 		dst.reallocate( src.width(), src.height(), src.format(), IALLOCATOR_CL );
-		_clguidedfilter_applyab_cc.setArg( 0, dst );
-		_clguidedfilter_applyab_cc.setArg( 1, guide );
-		_clguidedfilter_applyab_cc.setArg( 2, ia );
-		_clguidedfilter_applyab_cc.setArg( 3, ib );
-		_clguidedfilter_applyab_cc.run( global, local );
+		_clguidedfilter_applyab_cc->setArg( 0, dst );
+		_clguidedfilter_applyab_cc->setArg( 1, guide );
+		_clguidedfilter_applyab_cc->setArg( 2, ia );
+		_clguidedfilter_applyab_cc->setArg( 3, ib );
+		_clguidedfilter_applyab_cc->run( global, local );
+	}
+
+
+	/*
+	   CPU guided filter: all box means of one stage come out of a single pass over K planar
+	   statistic rows. Every row band keeps one running column sum per plane and regenerates the
+	   rows entering and leaving the ( 2r + 1 ) window, so the cost per pixel and the scratch
+	   memory do not depend on the radius. Borders are replicated.
+	 */
+	class GuidedFilterBox {
+		public:
+			GuidedFilterBox( size_t width, size_t height, size_t planes, size_t radius ) :
+				_width( width ), _height( height ), _planes( planes ), _radius( radius )
+			{
+				_stride = rowStride( _width );
+				size_t n = ParallelFor::numThreads() * 4;
+				_bandHeight = Math::max( ( _height + n - 1 ) / n, 2 * _radius + 1 );
+			}
+
+			virtual ~GuidedFilterBox() {}
+
+			size_t bands() const { return ( _height + _bandHeight - 1 ) / _bandHeight; }
+
+			/* padded rows for the aligned vertical SIMD accumulation */
+			static size_t rowStride( size_t width ) { return Math::max<size_t>( Math::pad16( width ), 16 ); }
+
+			void operator()( size_t begin, size_t end )
+			{
+				SIMD* simd = SIMD::instance();
+				size_t K = _planes;
+				ScopedBuffer<float, true> buf( 5 * K * _stride );
+				float* scratch = buf.ptr();
+				float* add = scratch + K * _stride;
+				float* sub = add + K * _stride;
+				float* acc = sub + K * _stride;
+				float* out = acc + K * _stride;
+				std::vector<float*> scr( K ), o( K );
+				std::vector<const float*> rows( K );
+				ssize_t r = _radius;
+
+				simd->SetValue1f( scratch, 0.0f, 5 * K * _stride );
+				for( size_t k = 0; k < K; k++ ) {
+					scr[ k ] = scratch + k * _stride;
+					o[ k ] = out + k * _stride;
+				}
+
+				for( size_t b = begin; b < end; b++ ) {
+					ssize_t y0 = b * _bandHeight;
+					ssize_t y1 = Math::min( b * _bandHeight + _bandHeight, _height );
+
+					/* column sums of the window above the first row */
+					simd->SetValue1f( acc, 0.0f, K * _stride );
+					for( ssize_t y = y0 - 1 - r; y <= y0 - 1 + r; y++ ) {
+						filteredRows( add, &rows[ 0 ], &scr[ 0 ], y );
+						simd->Add( acc, acc, add, K * _stride );
+					}
+
+					for( ssize_t y = y0; y < y1; y++ ) {
+						filteredRows( add, &rows[ 0 ], &scr[ 0 ], y + r );
+						filteredRows( sub, &rows[ 0 ], &scr[ 0 ], y - r - 1 );
+						for( size_t k = 0; k < K; k++ )
+							simd->BoxFilterVert_f( o[ k ], acc + k * _stride, add + k * _stride, sub + k * _stride, _radius, _stride );
+						consume( &o[ 0 ], y );
+					}
+				}
+			}
+
+		protected:
+			/* either write the raw row of plane k at image row y into scratch[ k ] or point rows[ k ] to it */
+			virtual void produce( const float** rows, float** scratch, size_t y ) = 0;
+			/* box means of all planes for image row y */
+			virtual void consume( float* const* means, size_t y ) = 0;
+
+			size_t _width;
+			size_t _height;
+			size_t _planes;
+			size_t _radius;
+			size_t _stride;
+			size_t _bandHeight;
+
+		private:
+			/* horizontally filtered rows of all planes at the clamped row y */
+			void filteredRows( float* dst, const float** rows, float** scratch, ssize_t y )
+			{
+				y = Math::clamp<ssize_t>( y, 0, _height - 1 );
+				for( size_t k = 0; k < _planes; k++ )
+					rows[ k ] = scratch[ k ];
+				produce( rows, scratch, y );
+				for( size_t k = 0; k < _planes; k++ )
+					boxHorizontal( dst + k * _stride, rows[ k ] );
+			}
+
+			void boxHorizontal( float* dst, const float* src ) const
+			{
+				ssize_t w = _width;
+				ssize_t r = _radius;
+
+				if( w > 2 * r + 16 ) {
+					SIMD::instance()->BoxFilterHorizontal_1f( dst, src, _radius, _width );
+					return;
+				}
+
+				/* narrow rows, the window covers the border on both sides */
+				float invmean = 1.0f / ( float ) ( 2 * r + 1 );
+				float accum = 0.0f;
+				for( ssize_t x = -r; x <= r; x++ )
+					accum += src[ Math::clamp<ssize_t>( x, 0, w - 1 ) ];
+				dst[ 0 ] = accum * invmean;
+				for( ssize_t x = 1; x < w; x++ ) {
+					accum += src[ Math::min( x + r, w - 1 ) ] - src[ Math::max<ssize_t>( x - r - 1, 0 ) ];
+					dst[ x ] = accum * invmean;
+				}
+			}
+	};
+
+	/*
+	   First stage, means and (co)variances of guide I and input p to the linear coefficients
+	   q = a * I + b in every window. Gray guide planes: I, I * I, p_c, I * p_c. Color guide
+	   planes: I_0..2, the six products I_i * I_j, p_c, I_j * p_c. The coefficient planes are
+	   a_c, b_c for gray guides and a_c0, a_c1, a_c2, b_c for color guides.
+	 */
+	class GuidedFilterCoeff : public GuidedFilterBox {
+		public:
+			GuidedFilterCoeff( float* coeff, const float* guide, size_t gstride, size_t gchannels, const float* src, size_t sstride, size_t channels,
+							   size_t width, size_t height, size_t radius, float epsilon ) :
+				GuidedFilterBox( width, height, gchannels >= 3 ? 9 + 4 * channels : 2 + 2 * channels, radius ),
+				_coeff( coeff ), _guide( guide ), _gstride( gstride ), _gchannels( gchannels ),
+				_src( src ), _sstride( sstride ), _channels( channels ), _epsilon( epsilon )
+			{
+			}
+
+		protected:
+			void produce( const float**, float** scratch, size_t y )
+			{
+				const float* g = _guide + y * _gstride;
+				const float* s = _src + y * _sstride;
+				size_t gc = _gchannels;
+				size_t C = _channels;
+
+				if( gc < 3 ) {
+					float* I = scratch[ 0 ];
+					float* II = scratch[ 1 ];
+					for( size_t x = 0; x < _width; x++ ) {
+						I[ x ] = g[ x * gc ];
+						II[ x ] = I[ x ] * I[ x ];
+					}
+					for( size_t c = 0; c < C; c++ ) {
+						float* p = scratch[ 2 + c ];
+						float* Ip = scratch[ 2 + C + c ];
+						for( size_t x = 0; x < _width; x++ ) {
+							p[ x ] = s[ x * C + c ];
+							Ip[ x ] = I[ x ] * p[ x ];
+						}
+					}
+					return;
+				}
+
+				for( size_t x = 0; x < _width; x++ ) {
+					float i0 = g[ x * gc ];
+					float i1 = g[ x * gc + 1 ];
+					float i2 = g[ x * gc + 2 ];
+					scratch[ 0 ][ x ] = i0;
+					scratch[ 1 ][ x ] = i1;
+					scratch[ 2 ][ x ] = i2;
+					scratch[ 3 ][ x ] = i0 * i0;
+					scratch[ 4 ][ x ] = i0 * i1;
+					scratch[ 5 ][ x ] = i0 * i2;
+					scratch[ 6 ][ x ] = i1 * i1;
+					scratch[ 7 ][ x ] = i1 * i2;
+					scratch[ 8 ][ x ] = i2 * i2;
+				}
+				for( size_t c = 0; c < C; c++ ) {
+					float* p = scratch[ 9 + c ];
+					float* Ip0 = scratch[ 9 + C + 3 * c ];
+					float* Ip1 = scratch[ 10 + C + 3 * c ];
+					float* Ip2 = scratch[ 11 + C + 3 * c ];
+					for( size_t x = 0; x < _width; x++ ) {
+						p[ x ] = s[ x * C + c ];
+						Ip0[ x ] = scratch[ 0 ][ x ] * p[ x ];
+						Ip1[ x ] = scratch[ 1 ][ x ] * p[ x ];
+						Ip2[ x ] = scratch[ 2 ][ x ] * p[ x ];
+					}
+				}
+			}
+
+			void consume( float* const* m, size_t y )
+			{
+				size_t C = _channels;
+				size_t plane = _height * _stride;
+				float* coeff = _coeff + y * _stride;
+
+				if( _gchannels < 3 ) {
+					for( size_t c = 0; c < C; c++ ) {
+						float* a = coeff + c * plane;
+						float* b = coeff + ( C + c ) * plane;
+						for( size_t x = 0; x < _width; x++ ) {
+							float mI = m[ 0 ][ x ];
+							float mp = m[ 2 + c ][ x ];
+							float var = m[ 1 ][ x ] - mI * mI;
+							float cov = m[ 2 + C + c ][ x ] - mI * mp;
+							a[ x ] = cov / ( var + _epsilon );
+							b[ x ] = mp - a[ x ] * mI;
+						}
+					}
+					return;
+				}
+
+				for( size_t x = 0; x < _width; x++ ) {
+					float mI[ 3 ] = { m[ 0 ][ x ], m[ 1 ][ x ], m[ 2 ][ x ] };
+					/* symmetric covariance of the guide plus epsilon and its inverse via cofactors */
+					float s00 = m[ 3 ][ x ] - mI[ 0 ] * mI[ 0 ] + _epsilon;
+					float s01 = m[ 4 ][ x ] - mI[ 0 ] * mI[ 1 ];
+					float s02 = m[ 5 ][ x ] - mI[ 0 ] * mI[ 2 ];
+					float s11 = m[ 6 ][ x ] - mI[ 1 ] * mI[ 1 ] + _epsilon;
+					float s12 = m[ 7 ][ x ] - mI[ 1 ] * mI[ 2 ];
+					float s22 = m[ 8 ][ x ] - mI[ 2 ] * mI[ 2 ] + _epsilon;
+
+					float i00 = s11 * s22 - s12 * s12;
+					float i01 = s02 * s12 - s01 * s22;
+					float i02 = s01 * s12 - s02 * s11;
+					float i11 = s00 * s22 - s02 * s02;
+					float i12 = s01 * s02 - s00 * s12;
+					float i22 = s00 * s11 - s01 * s01;
+					float invdet = 1.0f / ( s00 * i00 + s01 * i01 + s02 * i02 );
+
+					for( size_t c = 0; c < C; c++ ) {
+						float mp = m[ 9 + c ][ x ];
+						float c0 = m[ 9 + C + 3 * c ][ x ] - mI[ 0 ] * mp;
+						float c1 = m[ 10 + C + 3 * c ][ x ] - mI[ 1 ] * mp;
+						float c2 = m[ 11 + C + 3 * c ][ x ] - mI[ 2 ] * mp;
+						float a0 = ( i00 * c0 + i01 * c1 + i02 * c2 ) * invdet;
+						float a1 = ( i01 * c0 + i11 * c1 + i12 * c2 ) * invdet;
+						float a2 = ( i02 * c0 + i12 * c1 + i22 * c2 ) * invdet;
+						float* a = coeff + 4 * c * plane;
+						a[ x ] = a0;
+						a[ x + plane ] = a1;
+						a[ x + 2 * plane ] = a2;
+						a[ x + 3 * plane ] = mp - a0 * mI[ 0 ] - a1 * mI[ 1 ] - a2 * mI[ 2 ];
+					}
+				}
+			}
+
+		private:
+			float*			_coeff;
+			const float*	_guide;
+			size_t			_gstride;
+			size_t			_gchannels;
+			const float*	_src;
+			size_t			_sstride;
+			size_t			_channels;
+			float			_epsilon;
+	};
+
+	/* q = mean_a * I + mean_b with the guide at the same resolution as the coefficients */
+	static inline void _GuidedFilterCombine( float* dst, const float* g, size_t gchannels, size_t channels, float* const* m, size_t width )
+	{
+		size_t C = channels;
+		if( gchannels < 3 ) {
+			for( size_t x = 0; x < width; x++ )
+				for( size_t c = 0; c < C; c++ )
+					dst[ x * C + c ] = m[ c ][ x ] * g[ x * gchannels ] + m[ C + c ][ x ];
+			return;
+		}
+		for( size_t x = 0; x < width; x++ ) {
+			const float* i = g + x * gchannels;
+			for( size_t c = 0; c < C; c++ ) {
+				float* const* a = m + 4 * c;
+				dst[ x * C + c ] = a[ 0 ][ x ] * i[ 0 ] + a[ 1 ][ x ] * i[ 1 ] + a[ 2 ][ x ] * i[ 2 ] + a[ 3 ][ x ];
+			}
+		}
+	}
+
+	/*
+	   Second stage, box means of the coefficient planes. Either combined with the guide into
+	   the output rows or, for the subsampled filter, stored as planes to be upsampled.
+	 */
+	class GuidedFilterMean : public GuidedFilterBox {
+		public:
+			GuidedFilterMean( const float* coeff, size_t cstride, size_t planes, size_t width, size_t height, size_t radius ) :
+				GuidedFilterBox( width, height, planes, radius ),
+				_coeff( coeff ), _cstride( cstride ),
+				_dst( 0 ), _dstride( 0 ), _guide( 0 ), _gstride( 0 ), _gchannels( 0 ), _channels( 0 ), _planeDst( 0 ), _planeStrides( 0 )
+			{
+			}
+
+			void setOutput( float* dst, size_t dstride, const float* guide, size_t gstride, size_t gchannels, size_t channels )
+			{
+				_dst = dst;
+				_dstride = dstride;
+				_guide = guide;
+				_gstride = gstride;
+				_gchannels = gchannels;
+				_channels = channels;
+			}
+
+			void setPlaneOutput( float** planes, const size_t* strides )
+			{
+				_planeDst = planes;
+				_planeStrides = strides;
+			}
+
+		protected:
+			void produce( const float** rows, float**, size_t y )
+			{
+				for( size_t k = 0; k < _planes; k++ )
+					rows[ k ] = _coeff + ( k * _height + y ) * _cstride;
+			}
+
+			void consume( float* const* m, size_t y )
+			{
+				if( _planeDst ) {
+					for( size_t k = 0; k < _planes; k++ )
+						SIMD::instance()->Memcpy( ( uint8_t* ) ( _planeDst[ k ] + y * _planeStrides[ k ] ), ( const uint8_t* ) m[ k ], _width * sizeof( float ) );
+					return;
+				}
+				_GuidedFilterCombine( _dst + y * _dstride, _guide + y * _gstride, _gchannels, _channels, m, _width );
+			}
+
+		private:
+			const float*	_coeff;
+			size_t			_cstride;
+			float*			_dst;
+			size_t			_dstride;
+			const float*	_guide;
+			size_t			_gstride;
+			size_t			_gchannels;
+			size_t			_channels;
+			float**			_planeDst;
+			const size_t*	_planeStrides;
+	};
+
+	/* combination of the upsampled coefficient planes with the full resolution guide */
+	class GuidedFilterUpsampled {
+		public:
+			GuidedFilterUpsampled( float* dst, size_t dstride, const float* guide, size_t gstride, size_t gchannels, size_t channels,
+								   float* const* planes, const size_t* strides, size_t nplanes, size_t width ) :
+				_dst( dst ), _dstride( dstride ), _guide( guide ), _gstride( gstride ), _gchannels( gchannels ), _channels( channels ),
+				_planes( planes ), _strides( strides ), _nplanes( nplanes ), _width( width )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				float* m[ 16 ];
+				for( size_t y = begin; y < end; y++ ) {
+					for( size_t k = 0; k < _nplanes; k++ )
+						m[ k ] = _planes[ k ] + y * _strides[ k ];
+					_GuidedFilterCombine( _dst + y * _dstride, _guide + y * _gstride, _gchannels, _channels, m, _width );
+				}
+			}
+
+		private:
+			float*			_dst;
+			size_t			_dstride;
+			const float*	_guide;
+			size_t			_gstride;
+			size_t			_gchannels;
+			size_t			_channels;
+			float* const*	_planes;
+			const size_t*	_strides;
+			size_t			_nplanes;
+			size_t			_width;
+	};
+
+	static const Image* _GuidedFilterFloat( Image& tmp, const Image& img )
+	{
+		if( img.format().type == IFORMAT_TYPE_FLOAT )
+			return &img;
+		img.convert( tmp, IFormat::floatEquivalent( img.format() ) );
+		return &tmp;
+	}
+
+	void GuidedFilter::applyCPU( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, size_t subsample ) const
+	{
+		size_t w = src.width();
+		size_t h = src.height();
+
+		if( guide.width() != w || guide.height() != h )
+			throw CVTException( "Guide and input image dimensions differ" );
+		if( radius < 0 )
+			throw CVTException( "Invalid radius" );
+		if( !w || !h )
+			return;
+
+		/* everything is done in float, integer inputs are normalized to [ 0, 1 ] */
+		Image tsrc, tguide;
+		const Image* fsrc = _GuidedFilterFloat( tsrc, src );
+		const Image* fguide = _GuidedFilterFloat( tguide, guide );
+
+		size_t C = fsrc->channels();
+		size_t gc = fguide->channels();
+		size_t nplanes = gc >= 3 ? 4 * C : 2 * C;
+
+		/* coefficients from subsampled images for the fast guided filter */
+		size_t lw = w, lh = h, lradius = radius;
+		Image tlsrc, tlguide;
+		const Image* lsrc = fsrc;
+		const Image* lguide = fguide;
+		if( subsample > 1 ) {
+			IScaleFilterBilinear bilinear;
+			lw = Math::max<size_t>( w / subsample, 1 );
+			lh = Math::max<size_t>( h / subsample, 1 );
+			lradius = Math::max<size_t>( ( radius + subsample / 2 ) / subsample, 1 );
+			fsrc->scale( tlsrc, lw, lh, bilinear );
+			fguide->scale( tlguide, lw, lh, bilinear );
+			lsrc = &tlsrc;
+			lguide = &tlguide;
+		}
+
+		/* float output straight into dst unless it is one of the inputs */
+		Image tdst;
+		Image* fdst = &tdst;
+		if( src.format().type == IFORMAT_TYPE_FLOAT && &dst != &src && &dst != &guide ) {
+			dst.reallocate( w, h, src.format() );
+			fdst = &dst;
+		} else
+			tdst.reallocate( w, h, fsrc->format() );
+
+		size_t cstride = GuidedFilterBox::rowStride( lw );
+		ScopedBuffer<float, true> coeff( nplanes * lh * cstride );
+
+		size_t sstride, gstride, dstride;
+		const float* psrc = lsrc->map<float>( &sstride );
+		const float* pguide = lguide->map<float>( &gstride );
+		GuidedFilterCoeff stage1( coeff.ptr(), pguide, gstride, gc, psrc, sstride, C, lw, lh, lradius, epsilon );
+		ParallelFor::run( stage1, 0, stage1.bands(), 1 );
+		lsrc->unmap( psrc );
+
+		GuidedFilterMean stage2( coeff.ptr(), cstride, nplanes, lw, lh, lradius );
+		if( subsample == 1 ) {
+			float* pdst = fdst->map<float>( &dstride );
+			stage2.setOutput( pdst, dstride, pguide, gstride, gc, C );
+			ParallelFor::run( stage2, 0, stage2.bands(), 1 );
+			fdst->unmap( pdst );
+			lguide->unmap( pguide );
+		} else {
+			lguide->unmap( pguide );
+
+			/* mean coefficients at low resolution, upsampled plane by plane */
+			std::vector<Image> low( nplanes ), high( nplanes );
+			std::vector<float*> ptrs( nplanes );
+			std::vector<size_t> strides( nplanes );
+			for( size_t k = 0; k < nplanes; k++ ) {
+				low[ k ].reallocate( lw, lh, IFormat::GRAY_FLOAT );
+				ptrs[ k ] = low[ k ].map<float>( &strides[ k ] );
+			}
+			stage2.setPlaneOutput( &ptrs[ 0 ], &strides[ 0 ] );
+			ParallelFor::run( stage2, 0, stage2.bands(), 1 );
+
+			IScaleFilterBilinear bilinear;
+			for( size_t k = 0; k < nplanes; k++ ) {
+				low[ k ].unmap( ptrs[ k ] );
+				low[ k ].scale( high[ k ], w, h, bilinear );
+				ptrs[ k ] = high[ k ].map<float>( &strides[ k ] );
+			}
+
+			float* pdst = fdst->map<float>( &dstride );
+			pguide = fguide->map<float>( &gstride );
+			GuidedFilterUpsampled up( pdst, dstride, pguide, gstride, gc, C, &ptrs[ 0 ], &strides[ 0 ], nplanes, w );
+			ParallelFor::run( up, 0, h );
+			fguide->unmap( pguide );
+			fdst->unmap( pdst );
+
+			for( size_t k = 0; k < nplanes; k++ )
+				high[ k ].unmap( ptrs[ k ] );
+		}
+
+		if( fdst != &dst )
+			fdst->convert( dst, src.format() );
 	}
 
 
@@ -215,12 +726,16 @@ namespace cvt {
 		Image * out = set->arg<Image*>( 2 );
 		int radius = set->arg<int>( 3 );
 		float epsilon = set->arg<float>( 4 );
+		int subsample = set->arg<int>( 5 );
 
 
 		switch ( t ) {
 			case IFILTER_OPENCL:
 				this->apply( *out, *in, guide?*guide:*in, radius, epsilon );
 				break;
+			case IFILTER_CPU:
+				this->applyCPU( *out, *in, guide?*guide:*in, radius, epsilon, Math::max( subsample, 1 ) );
+				break;
 			default:
 				throw CVTException( "Not implemented" );
 		}
@@ -28,6 +28,7 @@
 #include <cvt/gfx/IFilter.h>
 #include <cvt/util/Plugin.h>
 #include <cvt/util/PluginManager.h>
+#include <cvt/util/Mutex.h>
 #include <cvt/cl/CLKernel.h>
 
 #include <cvt/gfx/ifilter/IntegralFilter.h>
@@ -37,10 +38,17 @@ namespace cvt {
 	class GuidedFilter : public IFilter {
 		public:
 			GuidedFilter();
-			~GuidedFilter() {};
+			~GuidedFilter();
 
 			void apply( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, bool rgbcovariance = false ) const;
 
+			/*
+			   CPU version, gray guides ( one or two channels ) and color guides ( first three channels ).
+			   With subsample > 1 the coefficients are computed on images reduced by that factor and
+			   upsampled again ( fast guided filter ), the output keeps the full resolution.
+			 */
+			void applyCPU( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon, size_t subsample = 1 ) const;
+
 			void apply( const ParamSet* attribs, IFilterType iftype ) const;
 
 		private:
@@ -48,15 +56,18 @@ namespace cvt {
 			void applyGC_COV( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 			void applyCC( Image& dst, const Image& src, const Image& guide, const int radius, const float epsilon ) const;
 
+			void initCL() const;
+
 			GuidedFilter( const GuidedFilter& t );
 
-			CLKernel	   _clguidedfilter_calcab;
-			CLKernel	   _clguidedfilter_calcab_outerrgb;
-			CLKernel	   _clguidedfilter_applyab_gc;
-			CLKernel	   _clguidedfilter_applyab_gc_outer;
-			CLKernel	   _clguidedfilter_applyab_cc;
-			IntegralFilter _intfilter;
-			BoxFilter	   _boxfilter;
+			mutable CLKernel*		_clguidedfilter_calcab;
+			mutable CLKernel*		_clguidedfilter_calcab_outerrgb;
+			mutable CLKernel*		_clguidedfilter_applyab_gc;
+			mutable CLKernel*		_clguidedfilter_applyab_gc_outer;
+			mutable CLKernel*		_clguidedfilter_applyab_cc;
+			mutable IntegralFilter* _intfilter;
+			mutable BoxFilter*		_boxfilter;
+			mutable Mutex			_clmutex;
 	};
 }
 
@@ -0,0 +1,234 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/gfx/ifilter/GuidedFilter.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/RNG.h>
+#include <vector>
+
+namespace cvt {
+
+	typedef std::vector<double> GFPlane;
+
+	static void _gfRandom( Image& img, size_t w, size_t h, const IFormat& format, RNG& rng )
+	{
+		img.reallocate( w, h, format );
+		IMapScoped<float> map( img );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w * format.channels; x++ )
+				map.ptr()[ x ] = rng.uniform( 0.0f, 1.0f );
+			map++;
+		}
+	}
+
+	static void _gfPlanes( std::vector<GFPlane>& planes, const Image& img, size_t channels )
+	{
+		size_t w = img.width(), h = img.height(), n = img.channels();
+		planes.assign( channels, GFPlane( w * h ) );
+		IMapScoped<const float> map( img );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ )
+				for( size_t c = 0; c < channels; c++ )
+					planes[ c ][ y * w + x ] = map.ptr()[ x * n + c ];
+			map++;
+		}
+	}
+
+	/* box mean with replicated borders */
+	static GFPlane _gfMean( const GFPlane& in, ssize_t w, ssize_t h, ssize_t r )
+	{
+		GFPlane out( w * h );
+		for( ssize_t y = 0; y < h; y++ ) {
+			for( ssize_t x = 0; x < w; x++ ) {
+				double sum = 0.0;
+				for( ssize_t dy = -r; dy <= r; dy++ )
+					for( ssize_t dx = -r; dx <= r; dx++ )
+						sum += in[ Math::clamp<ssize_t>( y + dy, 0, h - 1 ) * w + Math::clamp<ssize_t>( x + dx, 0, w - 1 ) ];
+				out[ y * w + x ] = sum / ( double ) Math::sqr( 2 * r + 1 );
+			}
+		}
+		return out;
+	}
+
+	static GFPlane _gfProduct( const GFPlane& a, const GFPlane& b )
+	{
+		GFPlane out( a.size() );
+		for( size_t i = 0; i < a.size(); i++ )
+			out[ i ] = a[ i ] * b[ i ];
+		return out;
+	}
+
+	/* mean coefficient planes of the guided filter: a_c, b_c for gray and a_c0, a_c1, a_c2, b_c for color guides */
+	static void _gfCoefficients( std::vector<GFPlane>& coeff, const Image& src, const Image& guide, size_t r, double eps )
+	{
+		size_t w = src.width(), h = src.height(), C = src.channels();
+		size_t gc = guide.channels() >= 3 ? 3 : 1;
+		std::vector<GFPlane> I, p, mI( gc );
+		_gfPlanes( I, guide, gc );
+		_gfPlanes( p, src, C );
+
+		for( size_t i = 0; i < gc; i++ )
+			mI[ i ] = _gfMean( I[ i ], w, h, r );
+
+		std::vector<GFPlane> mII( gc * gc );
+		for( size_t i = 0; i < gc; i++ )
+			for( size_t j = 0; j < gc; j++ )
+				mII[ i * gc + j ] = _gfMean( _gfProduct( I[ i ], I[ j ] ), w, h, r );
+
+		coeff.assign( ( gc + 1 ) * C, GFPlane( w * h ) );
+		for( size_t c = 0; c < C; c++ ) {
+			GFPlane mp = _gfMean( p[ c ], w, h, r );
+			std::vector<GFPlane> mIp( gc );
+			for( size_t i = 0; i < gc; i++ )
+				mIp[ i ] = _gfMean( _gfProduct( I[ i ], p[ c ] ), w, h, r );
+
+			std::vector<GFPlane> a( gc, GFPlane( w * h ) );
+			GFPlane b( w * h );
+			for( size_t k = 0; k < w * h; k++ ) {
+				if( gc == 1 ) {
+					a[ 0 ][ k ] = ( mIp[ 0 ][ k ] - mI[ 0 ][ k ] * mp[ k ] ) / ( mII[ 0 ][ k ] - Math::sqr( mI[ 0 ][ k ] ) + eps );
+					b[ k ] = mp[ k ] - a[ 0 ][ k ] * mI[ 0 ][ k ];
+					continue;
+				}
+				Matrix3d sigma;
+				Vector3d cov;
+				for( size_t i = 0; i < 3; i++ ) {
+					for( size_t j = 0; j < 3; j++ )
+						sigma[ i ][ j ] = mII[ i * 3 + j ][ k ] - mI[ i ][ k ] * mI[ j ][ k ] + ( i == j ? eps : 0.0 );
+					cov[ i ] = mIp[ i ][ k ] - mI[ i ][ k ] * mp[ k ];
+				}
+				Vector3d ak = sigma.inverse() * cov;
+				b[ k ] = mp[ k ];
+				for( size_t i = 0; i < 3; i++ ) {
+					a[ i ][ k ] = ak[ i ];
+					b[ k ] -= ak[ i ] * mI[ i ][ k ];
+				}
+			}
+
+			for( size_t i = 0; i < gc; i++ )
+				coeff[ gc == 1 ? c : 4 * c + i ] = _gfMean( a[ i ], w, h, r );
+			coeff[ gc == 1 ? C + c : 4 * c + 3 ] = _gfMean( b, w, h, r );
+		}
+	}
+
+	/* reference of GuidedFilter::applyCPU, low resolution coefficients are upsampled with the same bilinear filter */
+	static double _gfCompare( const Image& src, const Image& guide, size_t r, double eps, size_t subsample )
+	{
+		size_t w = src.width(), h = src.height(), C = src.channels();
+		size_t gc = guide.channels() >= 3 ? 3 : 1;
+
+		Image lsrc( src ), lguide( guide );
+		size_t lr = r;
+		IScaleFilterBilinear bilinear;
+		if( subsample > 1 ) {
+			src.scale( lsrc, w / subsample, h / subsample, bilinear );
+			guide.scale( lguide, w / subsample, h / subsample, bilinear );
+			lr = Math::max<size_t>( ( r + subsample / 2 ) / subsample, 1 );
+		}
+
+		std::vector<GFPlane> coeff;
+		_gfCoefficients( coeff, lsrc, lguide, lr, eps );
+		if( subsample > 1 ) {
+			for( size_t k = 0; k < coeff.size(); k++ ) {
+				Image low( lsrc.width(), lsrc.height(), IFormat::GRAY_FLOAT ), high;
+				{
+					IMapScoped<float> map( low );
+					for( size_t y = 0; y < low.height(); y++ ) {
+						for( size_t x = 0; x < low.width(); x++ )
+							map.ptr()[ x ] = ( float ) coeff[ k ][ y * low.width() + x ];
+						map++;
+					}
+				}
+				low.scale( high, w, h, bilinear );
+				std::vector<GFPlane> up;
+				_gfPlanes( up, high, 1 );
+				coeff[ k ] = up[ 0 ];
+			}
+		}
+
+		Image dst;
+		GuidedFilter filter;
+		filter.applyCPU( dst, src, guide, r, eps, subsample );
+		if( dst.width() != w || dst.height() != h || dst.format() != src.format() )
+			return 1e10;
+
+		std::vector<GFPlane> I, q;
+		_gfPlanes( I, guide, gc );
+		_gfPlanes( q, dst, C );
+		double maxErr = 0.0;
+		for( size_t c = 0; c < C; c++ ) {
+			for( size_t k = 0; k < w * h; k++ ) {
+				double ref;
+				if( gc == 1 )
+					ref = coeff[ c ][ k ] * I[ 0 ][ k ] + coeff[ C + c ][ k ];
+				else
+					ref = coeff[ 4 * c ][ k ] * I[ 0 ][ k ] + coeff[ 4 * c + 1 ][ k ] * I[ 1 ][ k ] + coeff[ 4 * c + 2 ][ k ] * I[ 2 ][ k ] + coeff[ 4 * c + 3 ][ k ];
+				maxErr = Math::max( maxErr, Math::abs( ref - q[ c ][ k ] ) );
+			}
+		}
+		return maxErr;
+	}
+
+BEGIN_CVTTEST( GuidedFilter )
+	bool result = true;
+	bool b;
+	RNG rng( 4711 );
+	Image gray, gray2, rgba, rgba2;
+
+	_gfRandom( gray, 61, 43, IFormat::GRAY_FLOAT, rng );
+	_gfRandom( gray2, 61, 43, IFormat::GRAY_FLOAT, rng );
+	_gfRandom( rgba, 61, 43, IFormat::RGBA_FLOAT, rng );
+	_gfRandom( rgba2, 61, 43, IFormat::RGBA_FLOAT, rng );
+
+	b = _gfCompare( gray, gray2, 4, 0.01, 1 ) < 1e-4;
+	b &= _gfCompare( gray, gray, 7, 0.001, 1 ) < 1e-4;
+	CVTTEST_PRINT( "gray guide", b );
+	result &= b;
+
+	b = _gfCompare( gray, rgba, 3, 0.01, 1 ) < 1e-4;
+	b &= _gfCompare( rgba2, rgba, 5, 0.05, 1 ) < 1e-4;
+	CVTTEST_PRINT( "color guide", b );
+	result &= b;
+
+	/* windows wider than the image */
+	Image narrow, narrowGuide;
+	_gfRandom( narrow, 13, 9, IFormat::GRAY_FLOAT, rng );
+	_gfRandom( narrowGuide, 13, 9, IFormat::RGBA_FLOAT, rng );
+	b = _gfCompare( narrow, narrow, 10, 0.01, 1 ) < 1e-4;
+	b &= _gfCompare( narrow, narrowGuide, 6, 0.01, 1 ) < 1e-4;
+	CVTTEST_PRINT( "borders", b );
+	result &= b;
+
+	b = _gfCompare( gray, gray2, 6, 0.01, 2 ) < 1e-4;
+	b &= _gfCompare( rgba2, rgba, 8, 0.02, 3 ) < 1e-4;
+	CVTTEST_PRINT( "subsampled", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
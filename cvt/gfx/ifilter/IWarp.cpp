@@ -51,7 +51,11 @@ namespace cvt {
 		if( warp.format() != IFormat::GRAYALPHA_FLOAT )
 			throw CVTException( "Unsupported warp image type" );
 
-		dst.reallocate( warp.width(), warp.height(), src.format() );
+		/* half input is interpolated in float precision, the result is stored as float */
+		if( src.format().type == IFORMAT_TYPE_HALF )
+			dst.reallocate( warp.width(), warp.height(), IFormat::floatEquivalent( src.format() ) );
+		else
+			dst.reallocate( warp.width(), warp.height(), src.format() );
 
 		switch( src.format().formatID ) {
 			case IFORMAT_GRAY_FLOAT: return applyFC1( dst, src, warp );
@@ -60,6 +64,8 @@ namespace cvt {
 			case IFORMAT_BGRA_FLOAT: return applyFC4( dst, src, warp );
 			case IFORMAT_RGBA_UINT8:
 			case IFORMAT_BGRA_UINT8: return applyU8C4( dst, src, warp );
+			case IFORMAT_GRAY_HALF: return applyHC1( dst, src, warp );
+			case IFORMAT_RGBA_HALF: return applyHC4( dst, src, warp );
 			default: throw CVTException( "Unsupported image format!" );
 		}
 	}
@@ -312,6 +318,67 @@ namespace cvt {
 		iwarp.unmap( wrp );
 	}
 
+	void IWarp::applyHC1( Image& idst, const Image& isrc, const Image& iwarp )
+	{
+		const uint8_t* src;
+		uint8_t* dst;
+		const uint8_t* wrp;
+		uint8_t* pdst;
+		const uint8_t* pwrp;
+		size_t sstride, dstride, wstride, w, h, sw, sh;
+
+		pdst = dst = idst.map( &dstride );
+		pwrp = wrp = iwarp.map( &wstride );
+		src = isrc.map( &sstride );
+
+		SIMD* simd = SIMD::instance();
+
+		sw = isrc.width();
+		sh = isrc.height();
+		w = iwarp.width();
+		h = iwarp.height();
+		while( h-- ) {
+			simd->warpBilinear1h_to_f( ( float* ) pdst, ( const float* ) pwrp, ( const uint16_t* ) src, sstride, sw, sh, 0.0f, w );
+			pdst += dstride;
+			pwrp += wstride;
+		}
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+		iwarp.unmap( wrp );
+	}
+
+	void IWarp::applyHC4( Image& idst, const Image& isrc, const Image& iwarp )
+	{
+		const uint8_t* src;
+		uint8_t* dst;
+		const uint8_t* wrp;
+		uint8_t* pdst;
+		const uint8_t* pwrp;
+		size_t sstride, dstride, wstride, w, h, sw, sh;
+		float black[ ] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		pdst = dst = idst.map( &dstride );
+		pwrp = wrp = iwarp.map( &wstride );
+		src = isrc.map( &sstride );
+
+		SIMD* simd = SIMD::instance();
+
+		sw = isrc.width();
+		sh = isrc.height();
+		w = iwarp.width();
+		h = iwarp.height();
+		while( h-- ) {
+			simd->warpBilinear4h_to_f( ( float* ) pdst, ( const float* ) pwrp, ( const uint16_t* ) src, sstride, sw, sh, black, w );
+			pdst += dstride;
+			pwrp += wstride;
+		}
+
+		idst.unmap( dst );
+		isrc.unmap( src );
+		iwarp.unmap( wrp );
+	}
+
 	void IWarp::applyU8C1( Image& idst, const Image& isrc, const Image& iwarp )
 	{
 		const uint8_t* src;
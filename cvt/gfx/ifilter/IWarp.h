@@ -68,6 +68,8 @@ namespace cvt {
 			static void applyFC4( Image& dst, const Image& src, const Image& warp );
 			static void applyU8C1( Image& dst, const Image& src, const Image& warp );
 			static void applyU8C4( Image& dst, const Image& src, const Image& warp );
+			static void applyHC1( Image& dst, const Image& src, const Image& warp );
+			static void applyHC4( Image& dst, const Image& src, const Image& warp );
 
 			IWarp( const IWarp& t );
 	};
@@ -0,0 +1,308 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_FRAMEPREFETCHER_H
+#define CVT_FRAMEPREFETCHER_H
+
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Exception.h>
+
+#include <vector>
+#include <exception>
+#include <sys/types.h>
+
+namespace cvt {
+
+	/**
+	  @brief Bounded ring of frames decoded ahead of time by worker threads.
+
+	  Derived classes implement decode() for a single frame index. Frames are
+	  claimed in increasing index order by the workers and delivered in order by
+	  next(), so random access sources can use several workers while sequential
+	  sources have to use exactly one. The slot storage is reused, i.e. T should
+	  recycle its memory if the frame layout does not change ( as Image does ).
+
+	  Derived classes have to call start() at the end of their constructor and
+	  stop() at the beginning of their destructor.
+
+	  An exception thrown by decode() is rethrown as Exception by the next() call
+	  that would deliver the frame, the following call continues with the next frame.
+	 */
+	template<typename T>
+	class FramePrefetcher {
+		public:
+			FramePrefetcher( size_t ringSize, size_t numThreads, size_t numFrames = NUMFRAMES_UNKNOWN );
+			virtual ~FramePrefetcher();
+
+			/* blocks until the next frame is available, false at the end of the input */
+			bool		next();
+			/* blocks until the next frame is available without delivering it, NULL at the end of the input or on error */
+			const T*	peek();
+			/* the frame delivered by the last call to next() */
+			const T&	current() const;
+			/* index of the current frame, -1 before the first call to next() */
+			ssize_t		index() const;
+			/* the next call to next() delivers frame idx, invalidates current() */
+			void		seek( size_t idx );
+
+			size_t		ringSize() const { return _ringSize; }
+			size_t		numThreads() const { return _numThreads; }
+
+			static const size_t NUMFRAMES_UNKNOWN = ( size_t ) -1;
+
+		protected:
+			/* decode frame idx into slot, return false if idx is beyond the end of the input */
+			virtual bool decode( T& slot, size_t idx ) = 0;
+
+			void start();
+			void stop();
+
+		private:
+			enum SlotState {
+				SLOT_EMPTY,
+				SLOT_DECODING,
+				SLOT_READY,
+				SLOT_FAILED
+			};
+
+			struct Slot {
+				Slot() : index( ( size_t ) -1 ), state( SLOT_EMPTY ) {}
+				T			data;
+				size_t		index;
+				SlotState	state;
+				Exception	error;
+			};
+
+			class Worker : public Thread<FramePrefetcher<T> > {
+				public:
+					void execute( FramePrefetcher<T>* prefetcher ) { prefetcher->decodeLoop(); }
+			};
+
+			FramePrefetcher( const FramePrefetcher& );
+			FramePrefetcher& operator=( const FramePrefetcher& );
+
+			void decodeLoop();
+
+			Slot*					_slots;
+			std::vector<Worker*>	_workers;
+			Mutex					_mutex;
+			Condition				_cond;
+			const size_t			_ringSize;
+			const size_t			_numThreads;
+			const size_t			_numFrames;
+			size_t					_next;		/* next index to be claimed by a worker */
+			ssize_t					_current;	/* index of the delivered frame */
+			size_t					_end;		/* first index beyond the input */
+			size_t					_generation;
+			size_t					_busy;
+			bool					_stop;
+	};
+
+	template<typename T>
+	inline FramePrefetcher<T>::FramePrefetcher( size_t ringSize, size_t numThreads, size_t numFrames ) :
+		_slots( 0 ),
+		_ringSize( ringSize < 2 ? 2 : ringSize ),
+		_numThreads( numThreads < 1 ? 1 : numThreads ),
+		_numFrames( numFrames ),
+		_next( 0 ),
+		_current( -1 ),
+		_end( numFrames ),
+		_generation( 0 ),
+		_busy( 0 ),
+		_stop( false )
+	{
+		_slots = new Slot[ _ringSize ];
+	}
+
+	template<typename T>
+	inline FramePrefetcher<T>::~FramePrefetcher()
+	{
+		stop();
+		delete[] _slots;
+	}
+
+	template<typename T>
+	inline void FramePrefetcher<T>::start()
+	{
+		for( size_t i = 0; i < _numThreads; i++ ) {
+			Worker* w = new Worker();
+			_workers.push_back( w );
+			w->run( this );
+		}
+	}
+
+	template<typename T>
+	inline void FramePrefetcher<T>::stop()
+	{
+		if( _workers.empty() )
+			return;
+
+		_mutex.lock();
+		_stop = true;
+		_cond.notifyAll();
+		_mutex.unlock();
+
+		for( size_t i = 0; i < _workers.size(); i++ ) {
+			_workers[ i ]->join();
+			delete _workers[ i ];
+		}
+		_workers.clear();
+	}
+
+	template<typename T>
+	inline bool FramePrefetcher<T>::next()
+	{
+		ScopeLock lock( &_mutex );
+		size_t want = ( size_t ) ( _current + 1 );
+		const Slot& slot = _slots[ want % _ringSize ];
+
+		while( true ) {
+			if( slot.index == want && ( slot.state == SLOT_READY || slot.state == SLOT_FAILED ) ) {
+				_current = want;
+				/* the previous frame is released, wake up waiting workers */
+				_cond.notifyAll();
+				if( slot.state == SLOT_FAILED )
+					throw slot.error;
+				return true;
+			}
+			if( want >= _end )
+				return false;
+			_cond.wait( _mutex );
+		}
+	}
+
+	template<typename T>
+	inline const T* FramePrefetcher<T>::peek()
+	{
+		ScopeLock lock( &_mutex );
+		size_t want = ( size_t ) ( _current + 1 );
+		const Slot& slot = _slots[ want % _ringSize ];
+
+		/* the workers do not touch the slot until it is delivered */
+		while( true ) {
+			if( slot.index == want && slot.state == SLOT_READY )
+				return &slot.data;
+			if( slot.index == want && slot.state == SLOT_FAILED )
+				return NULL;
+			if( want >= _end )
+				return NULL;
+			_cond.wait( _mutex );
+		}
+	}
+
+	template<typename T>
+	inline const T& FramePrefetcher<T>::current() const
+	{
+		if( _current < 0 )
+			return _slots[ 0 ].data;
+		return _slots[ _current % _ringSize ].data;
+	}
+
+	template<typename T>
+	inline ssize_t FramePrefetcher<T>::index() const
+	{
+		return _current;
+	}
+
+	template<typename T>
+	inline void FramePrefetcher<T>::seek( size_t idx )
+	{
+		ScopeLock lock( &_mutex );
+
+		/* results of frames still being decoded are discarded */
+		_generation++;
+		while( _busy )
+			_cond.wait( _mutex );
+
+		for( size_t i = 0; i < _ringSize; i++ ) {
+			_slots[ i ].index = ( size_t ) -1;
+			_slots[ i ].state = SLOT_EMPTY;
+		}
+		_next = idx;
+		_current = ( ssize_t ) idx - 1;
+		_end = _numFrames;
+		_cond.notifyAll();
+	}
+
+	template<typename T>
+	inline void FramePrefetcher<T>::decodeLoop()
+	{
+		_mutex.lock();
+		while( true ) {
+			/* the slot of the current frame is in use by the consumer */
+			while( !_stop && ( _next >= _end || ( ssize_t ) _next >= _current + ( ssize_t ) _ringSize ) )
+				_cond.wait( _mutex );
+			if( _stop )
+				break;
+
+			size_t idx = _next++;
+			size_t generation = _generation;
+			Slot& slot = _slots[ idx % _ringSize ];
+			slot.index = idx;
+			slot.state = SLOT_DECODING;
+			_busy++;
+			_mutex.unlock();
+
+			bool valid = false;
+			bool failed = false;
+			Exception error;
+			try {
+				valid = decode( slot.data, idx );
+			} catch( const Exception& e ) {
+				failed = true;
+				error = e;
+			} catch( const std::exception& e ) {
+				failed = true;
+				error = Exception( e.what() );
+			} catch( ... ) {
+				failed = true;
+				error = CVTException( "Unknown error while decoding a frame" );
+			}
+
+			_mutex.lock();
+			_busy--;
+			if( generation == _generation ) {
+				if( failed ) {
+					/* delivered to the consumer by next() */
+					slot.state = SLOT_FAILED;
+					slot.error = error;
+				} else if( valid ) {
+					slot.state = SLOT_READY;
+				} else {
+					slot.state = SLOT_EMPTY;
+					if( idx < _end )
+						_end = idx;
+				}
+			}
+			_cond.notifyAll();
+		}
+		_mutex.unlock();
+	}
+
+}
+
+#endif
@@ -41,6 +41,12 @@ namespace cvt {
 			void notifyReadable( bool b );
 			void notifyWriteable( bool b );
 			void notifyException( bool b );
+			/* epoll only: report readiness changes once instead of while the condition holds */
+			void setEdgeTriggered( bool b );
+
+		protected:
+			/* handlers owning their descriptor have to unregister before closing it */
+			void unregister();
 
 		private:
 			IOHandler( const IOHandler& );
@@ -48,34 +54,69 @@ namespace cvt {
 			bool _read;
 			bool _write;
 			bool _except;
+			bool _edge;
+			/* state of the registration with _select */
+			IOSelect*		_select;
+			/* slot and generation of the registration */
+			uint64_t		_key;
+			uint32_t		_events;
+			volatile bool	_dispatching;
+			/* the descriptor does not support epoll ( regular files ) */
+			bool			_alwaysReady;
 		protected:
 			int _fd;
 	};
 
-	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ), _fd( fd )
+	inline IOHandler::IOHandler( int fd ) : _read( false ), _write( false ), _except( false ), _edge( false ),
+		_select( NULL ), _key( 0 ), _events( 0 ), _dispatching( false ), _alwaysReady( false ), _fd( fd )
 	{
 	}
 
 	inline IOHandler::~IOHandler()
 	{
+		unregister();
+	}
+
+	inline void IOHandler::unregister()
+	{
+		if( _select )
+			_select->unregisterIOHandler( this );
 	}
 
 	inline void IOHandler::notifyReadable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _read != b ) {
 			_read = b;
+			if( _select )
+				_select->update( this );
+		}
 	}
 
 	inline void IOHandler::notifyWriteable( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _write != b ) {
 			_write = b;
+			if( _select )
+				_select->update( this );
+		}
 	}
 
 	inline void IOHandler::notifyException( bool b )
 	{
-		if( _fd >= 0 )
+		if( _fd >= 0 && _except != b ) {
 			_except = b;
+			if( _select )
+				_select->update( this );
+		}
+	}
+
+	inline void IOHandler::setEdgeTriggered( bool b )
+	{
+		if( _edge != b ) {
+			_edge = b;
+			if( _select )
+				_select->update( this );
+		}
 	}
 
 	inline void IOHandler::onDataReadable()
@@ -22,38 +22,518 @@
    THE SOFTWARE.
 */
 
+
 #include <cvt/io/IOSelect.h>
 #include <cvt/io/IOHandler.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/String.h>
 #include <cvt/math/Math.h>
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef LINUX
+#include <sys/eventfd.h>
+#endif
 
 namespace cvt {
 
-	IOSelect::IOSelect()
+	class IOSelectThread : public Thread<IOSelect>
+	{
+		public:
+			void execute( IOSelect* ioselect )
+			{
+				while( !ioselect->_stop )
+					ioselect->handleIO( -1 );
+			}
+	};
+
+	static void _throwErrno( const char* msg )
+	{
+		String str( msg );
+		str += strerror( errno );
+		throw CVTException( str.c_str() );
+	}
+
+	/* key of the wakeup descriptor, no slot has this index */
+	static const uint64_t _wakeupKey = ~( uint64_t ) 0;
+
+	IOSelect::IOSelect( bool concurrent ) :
+		_concurrent( concurrent ),
+		_stop( false )
+#ifdef LINUX
+		, _epfd( -1 ),
+		_alwaysReadyPos( 0 )
+#endif
 	{
+#ifdef LINUX
+		_epfd = epoll_create1( EPOLL_CLOEXEC );
+		if( _epfd < 0 )
+			_throwErrno( "IOSelect: epoll_create failed: " );
+
+		_wakefd[ 0 ] = _wakefd[ 1 ] = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if( _wakefd[ 0 ] < 0 ) {
+			::close( _epfd );
+			_throwErrno( "IOSelect: eventfd failed: " );
+		}
+
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = _wakeupKey;
+		epoll_ctl( _epfd, EPOLL_CTL_ADD, _wakefd[ 0 ], &ev );
+		_events.resize( 64 );
+#else
+		if( concurrent )
+			throw CVTException( "IOSelect: concurrent dispatch needs epoll" );
+		if( pipe( _wakefd ) != 0 )
+			_throwErrno( "IOSelect: pipe failed: " );
+		fcntl( _wakefd[ 0 ], F_SETFL, O_NONBLOCK );
+		fcntl( _wakefd[ 1 ], F_SETFL, O_NONBLOCK );
+#endif
 	}
 
 	IOSelect::~IOSelect()
 	{
+		for( size_t i = 0; i < _slots.size(); i++ ) {
+			IOHandler* ioh = _slots[ i ].ioh;
+			if( ioh ) {
+				ioh->_select = NULL;
+				ioh->_events = 0;
+				ioh->_alwaysReady = false;
+			}
+		}
+#ifdef LINUX
+		::close( _wakefd[ 0 ] );
+		::close( _epfd );
+#else
+		::close( _wakefd[ 0 ] );
+		::close( _wakefd[ 1 ] );
+#endif
+	}
+
+	void IOSelect::registerIOHandler( IOHandler* ioh )
+	{
+		_mutex.lock();
+		if( ioh->_select ) {
+			bool other = ioh->_select != this;
+			_mutex.unlock();
+			if( other )
+				throw CVTException( "IOSelect: handler is registered with another IOSelect" );
+			return;
+		}
+
+		uint32_t slot;
+		if( _freeSlots.empty() ) {
+			Slot s = { NULL, 0 };
+			slot = _slots.size();
+			_slots.push_back( s );
+		} else {
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		_slots[ slot ].ioh = ioh;
+		ioh->_select = this;
+		ioh->_key = ( ( uint64_t ) _slots[ slot ].gen << 32 ) | slot;
+		ioh->_events = 0;
+		_mutex.unlock();
+
+		update( ioh );
+	}
+
+	void IOSelect::unregisterIOHandler( IOHandler* ioh )
+	{
+		ScopeLock lock( &_mutex );
+		if( ioh->_select != this )
+			return;
+
+#ifdef LINUX
+		if( ioh->_alwaysReady ) {
+			for( size_t i = 0; i < _alwaysReady.size(); i++ ) {
+				if( _alwaysReady[ i ] == ioh ) {
+					_alwaysReady.erase( _alwaysReady.begin() + i );
+					break;
+				}
+			}
+			ioh->_alwaysReady = false;
+		} else if( ioh->_events ) {
+			epoll_ctl( _epfd, EPOLL_CTL_DEL, ioh->_fd, NULL );
+		}
+#endif
+		/* pending events of the old key are dropped by lookup */
+		Slot& slot = _slots[ ( uint32_t ) ioh->_key ];
+		slot.ioh = NULL;
+		slot.gen++;
+		_freeSlots.push_back( ( uint32_t ) ioh->_key );
+
+		ioh->_select = NULL;
+		ioh->_events = 0;
+
+		/* the dispatcher must not touch the handler after the callback, wait if it runs in another thread */
+		pthread_t self = pthread_self();
+		bool wait = false;
+		for( size_t i = 0; i < _dispatches.size(); i++ ) {
+			if( _dispatches[ i ]->ioh == ioh ) {
+				_dispatches[ i ]->unregistered = true;
+				wait = !pthread_equal( _dispatches[ i ]->thread, self );
+			}
+		}
+		while( wait ) {
+			_dispatchDone.wait( _mutex );
+			wait = false;
+			for( size_t i = 0; i < _dispatches.size(); i++ )
+				wait |= _dispatches[ i ]->ioh == ioh;
+		}
+	}
+
+	IOHandler* IOSelect::lookup( uint64_t key ) const
+	{
+		uint32_t slot = ( uint32_t ) key;
+		if( slot >= _slots.size() || _slots[ slot ].gen != ( uint32_t ) ( key >> 32 ) )
+			return NULL;
+		return _slots[ slot ].ioh;
+	}
+
+	void IOSelect::beginDispatch( IOHandler* ioh, Dispatch& d )
+	{
+		d.ioh = ioh;
+		d.thread = pthread_self();
+		d.unregistered = false;
+		_dispatches.push_back( &d );
+		ioh->_dispatching = true;
+	}
+
+	bool IOSelect::beginDispatch( uint64_t key, Dispatch& d )
+	{
+		ScopeLock lock( &_mutex );
+		IOHandler* ioh = lookup( key );
+		if( !ioh )
+			return false;
+		beginDispatch( ioh, d );
+		return true;
+	}
+
+	void IOSelect::endDispatch( Dispatch& d )
+	{
+		bool wake = false;
+		{
+			ScopeLock lock( &_mutex );
+			for( size_t i = 0; i < _dispatches.size(); i++ ) {
+				if( _dispatches[ i ] == &d ) {
+					_dispatches.erase( _dispatches.begin() + i );
+					break;
+				}
+			}
+
+			if( d.unregistered ) {
+				_dispatchDone.notifyAll();
+				return;
+			}
+			d.ioh->_dispatching = false;
+			/* concurrent: the handler is re-armed after its callback returned */
+			if( _concurrent )
+				wake = updateLocked( d.ioh, true );
+		}
+		if( wake )
+			wakeup();
+	}
+
+	bool IOSelect::dispatching( const Dispatch& d )
+	{
+		ScopeLock lock( &_mutex );
+		return !d.unregistered;
+	}
+
+	void IOSelect::update( IOHandler* ioh, bool rearm )
+	{
+		bool wake;
+		{
+			ScopeLock lock( &_mutex );
+			if( ioh->_select != this )
+				return;
+			wake = updateLocked( ioh, rearm );
+		}
+		if( wake )
+			wakeup();
+	}
+
+	/* returns whether a waiting handleIO has to notice new interest */
+	bool IOSelect::updateLocked( IOHandler* ioh, bool rearm )
+	{
+#ifdef LINUX
+		uint32_t events = ( ioh->_read ? ( uint32_t ) EPOLLIN : ( uint32_t ) 0 ) |
+						  ( ioh->_write ? ( uint32_t ) EPOLLOUT : ( uint32_t ) 0 ) |
+						  ( ioh->_except ? ( uint32_t ) EPOLLPRI : ( uint32_t ) 0 );
+		if( events ) {
+			if( ioh->_edge )
+				events |= EPOLLET;
+			if( _concurrent )
+				events |= EPOLLONESHOT;
+		}
+
+		if( ioh->_alwaysReady )
+			return addAlwaysReady( ioh, events );
+
+		if( _concurrent && ioh->_dispatching )
+			return false;
+		if( events == ioh->_events && !rearm )
+			return false;
+
+		/* with no interest left, remove the descriptor - hangups would still be reported */
+		int op = !ioh->_events ? EPOLL_CTL_ADD : ( events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL );
+		if( !events && !ioh->_events )
+			return false;
+
+		struct epoll_event ev;
+		ev.events = events;
+		ev.data.u64 = ioh->_key;
+		if( epoll_ctl( _epfd, op, ioh->_fd, &ev ) != 0 && op != EPOLL_CTL_DEL ) {
+			/* no epoll support for the descriptor, handled like select would */
+			if( op == EPOLL_CTL_ADD && errno == EPERM )
+				return addAlwaysReady( ioh, events );
+			_throwErrno( "IOSelect: epoll_ctl failed: " );
+		}
+		ioh->_events = events;
+#else
+		( void ) ioh;
+		( void ) rearm;
+#endif
+		return false;
+	}
+
+#ifdef LINUX
+	bool IOSelect::addAlwaysReady( IOHandler* ioh, uint32_t events )
+	{
+		if( !ioh->_alwaysReady ) {
+			ioh->_alwaysReady = true;
+			_alwaysReady.push_back( ioh );
+		}
+		bool wake = events && !ioh->_events;
+		ioh->_events = events;
+		return wake;
+	}
+
+	bool IOSelect::alwaysReadyPending()
+	{
+		ScopeLock lock( &_mutex );
+		for( size_t i = 0; i < _alwaysReady.size(); i++ ) {
+			if( _alwaysReady[ i ]->_events && !_alwaysReady[ i ]->_dispatching )
+				return true;
+		}
+		return false;
+	}
+
+	int IOSelect::dispatchAlwaysReady()
+	{
+		const uint32_t ready = EPOLLIN | EPOLLOUT;
+		Dispatch d;
+		uint32_t events = 0;
+
+		if( _concurrent ) {
+			/* claim one handler, round robin */
+			IOHandler* ioh = NULL;
+			_mutex.lock();
+			for( size_t i = 0; i < _alwaysReady.size() && !ioh; i++ ) {
+				IOHandler* h = _alwaysReady[ ( _alwaysReadyPos + i ) % _alwaysReady.size() ];
+				if( h->_events && !h->_dispatching ) {
+					ioh = h;
+					events = ioh->_events & ready;
+					beginDispatch( ioh, d );
+					_alwaysReadyPos = ( _alwaysReadyPos + i + 1 ) % _alwaysReady.size();
+				}
+			}
+			_mutex.unlock();
+			if( !ioh )
+				return 0;
+
+			dispatch( d, events );
+			endDispatch( d );
+			return 1;
+		}
+
+		/* callbacks may unregister handlers, keep the keys and look them up again */
+		std::vector<uint64_t> keys;
+		_mutex.lock();
+		for( size_t i = 0; i < _alwaysReady.size(); i++ )
+			keys.push_back( _alwaysReady[ i ]->_key );
+		_mutex.unlock();
+
+		int ret = 0;
+		for( size_t i = 0; i < keys.size(); i++ ) {
+			_mutex.lock();
+			IOHandler* ioh = lookup( keys[ i ] );
+			if( ioh && ioh->_events ) {
+				events = ioh->_events & ready;
+				beginDispatch( ioh, d );
+			} else {
+				ioh = NULL;
+			}
+			_mutex.unlock();
+			if( !ioh )
+				continue;
+			dispatch( d, events );
+			endDispatch( d );
+			ret++;
+		}
+		return ret;
+	}
+#endif
+
+	void IOSelect::dispatch( Dispatch& d, uint32_t events )
+	{
+#ifdef LINUX
+		/* like select, errors and hangups make the descriptor readable and writeable */
+		bool error = events & ( EPOLLERR | EPOLLHUP );
+		bool readable = ( events & EPOLLIN ) || error;
+		bool writeable = ( events & EPOLLOUT ) || error;
+		bool exception = events & EPOLLPRI;
+#else
+		bool readable = events & 1;
+		bool writeable = events & 2;
+		bool exception = events & 4;
+#endif
+		/* callbacks may unregister or delete the handler */
+		IOHandler* ioh = d.ioh;
+		if( readable && ioh->_read )
+			ioh->onDataReadable();
+		if( writeable && dispatching( d ) && ioh->_write )
+			ioh->onDataWriteable();
+		if( exception && dispatching( d ) && ioh->_except )
+			ioh->onException();
+	}
+
+	void IOSelect::drainWakeup()
+	{
+#ifdef LINUX
+		uint64_t value;
+		if( read( _wakefd[ 0 ], &value, sizeof( value ) ) < 0 )
+			return;
+#else
+		char buf[ 64 ];
+		while( read( _wakefd[ 0 ], buf, sizeof( buf ) ) > 0 )
+			;
+#endif
+	}
+
+	void IOSelect::wakeup()
+	{
+#ifdef LINUX
+		uint64_t one = 1;
+		if( write( _wakefd[ 1 ], &one, sizeof( one ) ) < 0 )
+			return;
+#else
+		char c = 0;
+		if( write( _wakefd[ 1 ], &c, 1 ) < 0 )
+			return;
+#endif
+	}
+
+	void IOSelect::stop()
+	{
+		_stop = true;
+		wakeup();
+	}
+
+	void IOSelect::run( size_t numThreads )
+	{
+		if( numThreads > 1 && !_concurrent )
+			throw CVTException( "IOSelect: multi-threaded dispatch needs a concurrent IOSelect" );
 
+		std::vector<IOSelectThread*> threads;
+		for( size_t i = 1; i < numThreads; i++ ) {
+			threads.push_back( new IOSelectThread() );
+			threads.back()->run( this );
+		}
+		while( !_stop )
+			handleIO( -1 );
+		for( size_t i = 0; i < threads.size(); i++ ) {
+			threads[ i ]->join();
+			delete threads[ i ];
+		}
+		drainWakeup();
+		_stop = false;
 	}
 
+#ifdef LINUX
 	int IOSelect::handleIO( ssize_t ms )
 	{
-		int maxfd = 0;
-		int numfd, ret, active;
+		int timeout = ms < 0 ? -1 : ( int ) ms;
+		/* always ready handlers must not block the wait */
+		bool ready = alwaysReadyPending();
+		if( ready )
+			timeout = 0;
 
-		if( _handlers.empty() )
-			return 0;
+		if( _concurrent ) {
+			/* one event per call, a handler is only dispatched once it has been taken out of the set */
+			struct epoll_event ev;
+			int n = epoll_wait( _epfd, &ev, 1, timeout );
+			if( n == 0 && ready )
+				return dispatchAlwaysReady();
+			if( n <= 0 )
+				return ( n < 0 && errno != EINTR ) ? -1 : 0;
+			if( ev.data.u64 == _wakeupKey ) {
+				/* a stop stays signalled for all threads */
+				if( !_stop )
+					drainWakeup();
+				return 0;
+			}
 
+			Dispatch d;
+			if( !beginDispatch( ev.data.u64, d ) )
+				return 0;
+			dispatch( d, ev.events );
+			endDispatch( d );
+			return 1;
+		}
+
+		int n = epoll_wait( _epfd, &_events[ 0 ], _events.size(), timeout );
+		if( n < 0 )
+			return errno != EINTR ? -1 : 0;
+
+		int ret = 0;
+		for( int i = 0; i < n; i++ ) {
+			const struct epoll_event& ev = _events[ i ];
+			if( ev.data.u64 == _wakeupKey ) {
+				if( !_stop )
+					drainWakeup();
+				continue;
+			}
+			/* handlers unregistered by earlier callbacks are skipped */
+			Dispatch d;
+			if( !beginDispatch( ev.data.u64, d ) )
+				continue;
+			dispatch( d, ev.events );
+			endDispatch( d );
+			ret++;
+		}
+
+		if( ready )
+			ret += dispatchAlwaysReady();
+
+		/* large fan-out: collect more events per call */
+		if( ( size_t ) n == _events.size() )
+			_events.resize( 2 * n );
+		return ret;
+	}
+#else
+	int IOSelect::handleIO( ssize_t ms )
+	{
+		int maxfd = _wakefd[ 0 ];
+		int numfd, ret;
 
 		FD_ZERO( &_readfds );
 		FD_ZERO( &_writefds );
 		FD_ZERO( &_execeptfds );
 
-		for( std::list<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
-			IOHandler* ioh = *it;
-			if( ioh->_read || ioh->_write || ioh->_except ) {
+		FD_SET( _wakefd[ 0 ], &_readfds );
+		/* callbacks may unregister handlers, keep the keys and look them up again */
+		std::vector<uint64_t> keys;
+		_mutex.lock();
+		for( size_t i = 0; i < _slots.size(); i++ ) {
+			IOHandler* ioh = _slots[ i ].ioh;
+			if( ioh && ( ioh->_read || ioh->_write || ioh->_except ) ) {
 				maxfd = Math::max( maxfd, ioh->_fd );
 				if( ioh->_read )
 					FD_SET( ioh->_fd, &_readfds );
@@ -61,8 +541,10 @@ namespace cvt {
 					FD_SET( ioh->_fd, &_writefds );
 				if( ioh->_except )
 					FD_SET( ioh->_fd, &_execeptfds );
+				keys.push_back( ioh->_key );
 			}
 		}
+		_mutex.unlock();
 
 		if( ms < 0 ) {
 			ret = pselect( maxfd + 1, &_readfds, &_writefds, &_execeptfds, NULL, NULL );
@@ -70,34 +552,41 @@ namespace cvt {
 			msToTimespec( ms, _timeout );
 			ret = pselect( maxfd + 1, &_readfds, &_writefds, &_execeptfds, &_timeout, NULL );
 		}
-		/* FIXME: do error handling */
 		if( ret <= 0 )
-			return ret;
+			return ( ret < 0 && errno != EINTR ) ? -1 : 0;
 
 		numfd = ret;
+		if( FD_ISSET( _wakefd[ 0 ], &_readfds ) ) {
+			if( !_stop )
+				drainWakeup();
+			numfd--;
+			ret--;
+		}
 
-		for( std::list<IOHandler*>::iterator it = _handlers.begin(), end = _handlers.end(); it != end; ++it ) {
-			IOHandler* ioh = *it;
-			if( ioh->_read || ioh->_write || ioh->_except ) {
-				active = 0;
-				if( ioh->_read && FD_ISSET( ioh->_fd, &_readfds ) ) {
-					ioh->onDataReadable();
-					active = 1;
-				}
-				if( ioh->_write && FD_ISSET( ioh->_fd, &_writefds ) ) {
-					ioh->onDataWriteable();
-					active = 1;
-				}
-				if( ioh->_except && FD_ISSET( ioh->_fd, &_execeptfds ) ) {
-					ioh->onException();
-					active = 1;
-				}
-				numfd -= active;
-				if( !numfd )
-					break;
+		for( size_t i = 0; i < keys.size() && numfd > 0; i++ ) {
+			Dispatch d;
+			uint32_t events = 0;
+			_mutex.lock();
+			IOHandler* ioh = lookup( keys[ i ] );
+			if( ioh ) {
+				if( ioh->_read && FD_ISSET( ioh->_fd, &_readfds ) )
+					events |= 1;
+				if( ioh->_write && FD_ISSET( ioh->_fd, &_writefds ) )
+					events |= 2;
+				if( ioh->_except && FD_ISSET( ioh->_fd, &_execeptfds ) )
+					events |= 4;
+				if( events )
+					beginDispatch( ioh, d );
 			}
+			_mutex.unlock();
+			if( !events )
+				continue;
+			dispatch( d, events );
+			endDispatch( d );
+			numfd--;
 		}
 
 		return ret;
 	}
+#endif
 }
@@ -22,48 +22,119 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_IOSELECT_H
 #define CVT_IOSELECT_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/select.h>
 #include <time.h>
 
-#include <list>
+#include <vector>
+#include <pthread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+
+#ifdef LINUX
+#include <sys/epoll.h>
+#endif
 
 namespace cvt {
 	class IOHandler;
+	class IOSelectThread;
+
+	/**
+	  Event loop for IOHandlers.
+
+	  On Linux the loop is backed by epoll: registration and interest changes are O(1)
+	  and the cost of a wakeup only depends on the number of ready handlers.
+	  Other systems fall back to pselect. Descriptors epoll rejects ( regular files,
+	  directories ) are, as with select, always readable and writeable: their handlers
+	  are dispatched on every call while they have interest and the loop does not block.
 
+	  With concurrent set, handleIO may be called from several threads at once
+	  (or use run). A handler is then never dispatched to two threads at the same time.
+
+	  Handlers may unregister or delete themselves and other handlers from within
+	  their callbacks. Unregistering from another thread waits until a running
+	  callback of the handler returned. The descriptor has to stay open until the
+	  handler is unregistered.
+	*/
 	class IOSelect {
+		friend class IOHandler;
+		friend class IOSelectThread;
+
 		public:
-			IOSelect();
+			IOSelect( bool concurrent = false );
 			~IOSelect();
+
 			int handleIO( ssize_t timeout_ms );
 			void registerIOHandler( IOHandler* ioh );
 			void unregisterIOHandler( IOHandler* ion );
 
+			/* thread-safe: interrupt a handleIO call that is waiting */
+			void wakeup();
+
+			/* dispatch with numThreads threads until stop() is called */
+			void run( size_t numThreads = 1 );
+			void stop();
+
 		private:
+			IOSelect( const IOSelect& );
+			IOSelect& operator=( const IOSelect& );
+
+			/* registered handler, the generation invalidates keys of earlier registrations */
+			struct Slot {
+				IOHandler*	ioh;
+				uint32_t	gen;
+			};
+
+			/* a running callback, lives on the stack of the dispatching thread */
+			struct Dispatch {
+				IOHandler*		ioh;
+				pthread_t		thread;
+				bool			unregistered;
+			};
+
+			void update( IOHandler* ioh, bool rearm = false );
+			bool updateLocked( IOHandler* ioh, bool rearm );
+			IOHandler* lookup( uint64_t key ) const;
+			void beginDispatch( IOHandler* ioh, Dispatch& d );
+			bool beginDispatch( uint64_t key, Dispatch& d );
+			void endDispatch( Dispatch& d );
+			bool dispatching( const Dispatch& d );
+			void dispatch( Dispatch& d, uint32_t events );
+			void drainWakeup();
 			void msToTimespec( size_t ms, struct timespec& ts ) const;
+#ifdef LINUX
+			bool addAlwaysReady( IOHandler* ioh, uint32_t events );
+			bool alwaysReadyPending();
+			int dispatchAlwaysReady();
+#endif
 
+			bool					_concurrent;
+			volatile bool			_stop;
+			int						_wakefd[ 2 ];
+			Mutex					_mutex;
+			std::vector<Slot>		_slots;
+			std::vector<uint32_t>	_freeSlots;
+			std::vector<Dispatch*>	_dispatches;
+			Condition				_dispatchDone;
+#ifdef LINUX
+			int						_epfd;
+			std::vector<struct epoll_event> _events;
+			/* handlers of descriptors without epoll support */
+			std::vector<IOHandler*> _alwaysReady;
+			size_t					_alwaysReadyPos;
+#else
 			fd_set _readfds;
 			fd_set _writefds;
 			fd_set _execeptfds;
 			struct timespec _timeout;
-			std::list<IOHandler*> _handlers;
+#endif
 	};
 
-
-	inline void IOSelect::registerIOHandler( IOHandler* ioh )
-	{
-		_handlers.push_back( ioh );
-	}
-
-	inline void IOSelect::unregisterIOHandler( IOHandler* ion )
-	{
-		_handlers.remove( ion );
-	}
-
-
 	inline void IOSelect::msToTimespec( size_t ms, struct timespec& ts ) const
 	{
 		long ns;
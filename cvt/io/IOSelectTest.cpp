@@ -0,0 +1,358 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/IOSelect.h>
+#include <cvt/io/IOHandler.h>
+#include <cvt/io/IOTimer.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Delegate.h>
+#include <cvt/util/CVTTest.h>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+namespace cvt {
+
+	namespace {
+
+		class PipeReader : public IOHandler {
+			public:
+				PipeReader( int fd, IOSelect* ioselect = NULL ) : IOHandler( fd ), count( 0 ), _ioselect( ioselect )
+				{
+					notifyReadable( true );
+				}
+
+				void onDataReadable()
+				{
+					char c;
+					if( read( _fd, &c, 1 ) == 1 )
+						__sync_add_and_fetch( &count, 1 );
+					/* unregister from within the callback */
+					if( _ioselect )
+						_ioselect->unregisterIOHandler( this );
+				}
+
+				volatile int count;
+
+			private:
+				IOSelect* _ioselect;
+		};
+
+		class IOSelectWaker : public Thread<IOSelect> {
+			public:
+				void execute( IOSelect* ioselect )
+				{
+					usleep( 20000 );
+					ioselect->wakeup();
+				}
+		};
+
+		class IOSelectStopper : public Thread<IOSelect> {
+			public:
+				void execute( IOSelect* ioselect )
+				{
+					usleep( 50000 );
+					ioselect->stop();
+				}
+		};
+
+		class TimerCount {
+			public:
+				TimerCount() : count( 0 ) {}
+				void timeout() { count++; }
+				int count;
+		};
+
+		/* reads a regular file, which epoll does not support */
+		class FileReader : public IOHandler {
+			public:
+				FileReader( int fd, int max ) : IOHandler( fd ), count( 0 ), _max( max )
+				{
+					notifyReadable( true );
+				}
+
+				void onDataReadable()
+				{
+					if( ++count == _max )
+						notifyReadable( false );
+				}
+
+				int count;
+
+			private:
+				int _max;
+		};
+
+		/* deletes itself and a peer from within its callback */
+		class SelfDeleter : public IOHandler {
+			public:
+				SelfDeleter( int fd, int* deleted ) : IOHandler( fd ), peer( NULL ), _deleted( deleted )
+				{
+					notifyReadable( true );
+					notifyWriteable( true );
+				}
+
+				~SelfDeleter()
+				{
+					unregister();
+					__sync_add_and_fetch( _deleted, 1 );
+				}
+
+				void onDataReadable()
+				{
+					if( peer ) {
+						peer->peer = NULL;
+						delete peer;
+					}
+					delete this;
+				}
+
+				void onDataWriteable()
+				{
+				}
+
+				SelfDeleter* peer;
+
+			private:
+				int* _deleted;
+		};
+
+	}
+
+	static bool _ioSelectPipe()
+	{
+		IOSelect ioselect;
+		int fds[ 2 ];
+		if( pipe( fds ) )
+			return false;
+
+		bool result = true;
+		{
+			PipeReader reader( fds[ 0 ] );
+			ioselect.registerIOHandler( &reader );
+			bool b = ioselect.handleIO( 0 ) == 0;
+			if( write( fds[ 1 ], "ab", 2 ) != 2 )
+				b = false;
+			b &= ioselect.handleIO( 100 ) == 1 && reader.count == 1;
+			b &= ioselect.handleIO( 100 ) == 1 && reader.count == 2;
+			reader.notifyReadable( false );
+			if( write( fds[ 1 ], "c", 1 ) != 1 )
+				b = false;
+			b &= ioselect.handleIO( 0 ) == 0 && reader.count == 2;
+			CVTTEST_PRINT( "readable", b );
+			result &= b;
+		}
+
+		/* the handler unregisters itself from within its callback */
+		{
+			PipeReader reader( fds[ 0 ], &ioselect );
+			ioselect.registerIOHandler( &reader );
+			bool b = ioselect.handleIO( 100 ) == 1 && reader.count == 1;
+			if( write( fds[ 1 ], "d", 1 ) != 1 )
+				b = false;
+			b &= ioselect.handleIO( 0 ) == 0 && reader.count == 1;
+			CVTTEST_PRINT( "unregister in callback", b );
+			result &= b;
+		}
+
+		close( fds[ 0 ] );
+		close( fds[ 1 ] );
+		return result;
+	}
+
+	static bool _ioSelectWakeup()
+	{
+		IOSelect ioselect;
+		IOSelectWaker waker;
+		waker.run( &ioselect );
+		/* returns early instead of waiting for the timeout */
+		bool b = ioselect.handleIO( 5000 ) == 0;
+		waker.join();
+		CVTTEST_PRINT( "wakeup", b );
+		return b;
+	}
+
+	static bool _ioSelectDelete()
+	{
+		int sv[ 2 ][ 2 ];
+		if( socketpair( AF_UNIX, SOCK_STREAM, 0, sv[ 0 ] ) || socketpair( AF_UNIX, SOCK_STREAM, 0, sv[ 1 ] ) )
+			return false;
+
+		/* both are ready, the first callback deletes the second handler */
+		IOSelect ioselect;
+		int deleted = 0;
+		SelfDeleter* a = new SelfDeleter( sv[ 0 ][ 0 ], &deleted );
+		SelfDeleter* b = new SelfDeleter( sv[ 1 ][ 0 ], &deleted );
+		a->peer = b;
+		b->peer = a;
+		ioselect.registerIOHandler( a );
+		ioselect.registerIOHandler( b );
+		bool ok = write( sv[ 0 ][ 1 ], "a", 1 ) == 1 && write( sv[ 1 ][ 1 ], "b", 1 ) == 1;
+		ok &= ioselect.handleIO( 100 ) == 1 && deleted == 2;
+		ok &= ioselect.handleIO( 0 ) == 0;
+
+#ifdef LINUX
+		/* regular files are dispatched from the always ready list */
+		FILE* file = tmpfile();
+		if( file ) {
+			deleted = 0;
+			a = new SelfDeleter( fileno( file ), &deleted );
+			b = new SelfDeleter( fileno( file ), &deleted );
+			a->peer = b;
+			b->peer = a;
+			ioselect.registerIOHandler( a );
+			ioselect.registerIOHandler( b );
+			ok &= ioselect.handleIO( 100 ) == 1 && deleted == 2;
+			ok &= ioselect.handleIO( 0 ) == 0;
+			fclose( file );
+		} else {
+			ok = false;
+		}
+
+		/* concurrent dispatch */
+		{
+			IOSelect cselect( true );
+			deleted = 0;
+			for( size_t i = 0; i < 2; i++ ) {
+				cselect.registerIOHandler( new SelfDeleter( sv[ i ][ 0 ], &deleted ) );
+				ok &= write( sv[ i ][ 1 ], "c", 1 ) == 1;
+			}
+			IOSelectStopper stopper;
+			stopper.run( &cselect );
+			cselect.run( 4 );
+			stopper.join();
+			ok &= deleted == 2;
+		}
+#endif
+
+		for( size_t i = 0; i < 2; i++ ) {
+			close( sv[ i ][ 0 ] );
+			close( sv[ i ][ 1 ] );
+		}
+		CVTTEST_PRINT( "delete in callback", ok );
+		return ok;
+	}
+
+#ifdef LINUX
+	static bool _ioSelectTimer()
+	{
+		IOSelect ioselect;
+		IOTimer timer;
+		TimerCount counter;
+		Delegate<void ()> d( &counter, &TimerCount::timeout );
+		timer.timeout.add( d );
+		ioselect.registerIOHandler( &timer );
+
+		timer.start( 5 );
+		while( counter.count < 3 )
+			ioselect.handleIO( 1000 );
+		timer.stop();
+		bool b = !timer.isActive() && ioselect.handleIO( 20 ) == 0 && counter.count == 3;
+
+		timer.start( 1, false );
+		ioselect.handleIO( 1000 );
+		b &= counter.count == 4 && !timer.isActive();
+		CVTTEST_PRINT( "timer", b );
+		return b;
+	}
+
+	static bool _ioSelectConcurrent()
+	{
+		IOSelect ioselect( true );
+		int fds[ 2 ];
+		if( pipe( fds ) )
+			return false;
+
+		PipeReader reader( fds[ 0 ] );
+		ioselect.registerIOHandler( &reader );
+		if( write( fds[ 1 ], "abcd", 4 ) != 4 )
+			return false;
+
+		IOSelectStopper stopper;
+		stopper.run( &ioselect );
+		ioselect.run( 4 );
+		stopper.join();
+
+		bool b = reader.count == 4;
+		ioselect.unregisterIOHandler( &reader );
+		close( fds[ 0 ] );
+		close( fds[ 1 ] );
+		CVTTEST_PRINT( "concurrent run", b );
+		return b;
+	}
+
+	static bool _ioSelectRegularFile()
+	{
+		FILE* file = tmpfile();
+		if( !file )
+			return false;
+
+		bool b;
+		{
+			IOSelect ioselect;
+			FileReader reader( fileno( file ), 2 );
+			ioselect.registerIOHandler( &reader );
+			/* always ready, the timeout is not waited for */
+			b = ioselect.handleIO( 5000 ) == 1 && reader.count == 1;
+			b &= ioselect.handleIO( -1 ) == 1 && reader.count == 2;
+			b &= ioselect.handleIO( 0 ) == 0 && reader.count == 2;
+			reader.notifyReadable( true );
+			b &= ioselect.handleIO( 5000 ) == 1 && reader.count == 3;
+			ioselect.unregisterIOHandler( &reader );
+			b &= ioselect.handleIO( 0 ) == 0 && reader.count == 3;
+		}
+
+		{
+			IOSelect ioselect( true );
+			FileReader reader( fileno( file ), 100 );
+			ioselect.registerIOHandler( &reader );
+			IOSelectStopper stopper;
+			stopper.run( &ioselect );
+			ioselect.run( 4 );
+			stopper.join();
+			b &= reader.count == 100;
+		}
+
+		fclose( file );
+		CVTTEST_PRINT( "regular file", b );
+		return b;
+	}
+#endif
+
+BEGIN_CVTTEST( ioselect )
+	bool result = true;
+	result &= _ioSelectPipe();
+	result &= _ioSelectWakeup();
+	result &= _ioSelectDelete();
+#ifdef LINUX
+	result &= _ioSelectTimer();
+	result &= _ioSelectConcurrent();
+	result &= _ioSelectRegularFile();
+#endif
+	return result;
+END_CVTTEST
+
+}
@@ -0,0 +1,85 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/IOTimer.h>
+#include <cvt/util/Exception.h>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	IOTimer::IOTimer() : IOHandler( timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) ),
+		_active( false ),
+		_repeat( false ),
+		_expirations( 0 )
+	{
+		if( _fd < 0 )
+			throw CVTException( "IOTimer: timerfd_create failed" );
+		notifyReadable( true );
+	}
+
+	IOTimer::~IOTimer()
+	{
+		unregister();
+		::close( _fd );
+	}
+
+	void IOTimer::start( size_t intervalms, bool repeat )
+	{
+		struct itimerspec its;
+		its.it_value.tv_sec = intervalms / 1000;
+		its.it_value.tv_nsec = ( intervalms % 1000 ) * 1000000L;
+		/* a zero value would disarm the timer */
+		if( !intervalms )
+			its.it_value.tv_nsec = 1;
+		its.it_interval.tv_sec = repeat ? its.it_value.tv_sec : 0;
+		its.it_interval.tv_nsec = repeat ? its.it_value.tv_nsec : 0;
+		if( timerfd_settime( _fd, 0, &its, NULL ) != 0 )
+			throw CVTException( "IOTimer: timerfd_settime failed" );
+		_active = true;
+		_repeat = repeat;
+	}
+
+	void IOTimer::stop()
+	{
+		struct itimerspec its;
+		its.it_value.tv_sec = its.it_value.tv_nsec = 0;
+		its.it_interval.tv_sec = its.it_interval.tv_nsec = 0;
+		timerfd_settime( _fd, 0, &its, NULL );
+		_active = false;
+	}
+
+	void IOTimer::onDataReadable()
+	{
+		uint64_t n;
+		if( read( _fd, &n, sizeof( n ) ) != sizeof( n ) )
+			return;
+		_expirations = n;
+		if( !_repeat )
+			_active = false;
+		timeout.notify();
+	}
+}
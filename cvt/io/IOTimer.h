@@ -0,0 +1,70 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_IOTIMER_H
+#define CVT_IOTIMER_H
+
+#include <cvt/io/IOHandler.h>
+#include <cvt/util/Signal.h>
+
+namespace cvt {
+
+	/**
+	  Timer driven by an IOSelect loop, backed by a timerfd.
+	  The timeout signal is emitted from the dispatching thread.
+	*/
+	class IOTimer : public IOHandler {
+		public:
+			IOTimer();
+			~IOTimer();
+
+			void		start( size_t intervalms, bool repeat = true );
+			void		stop();
+			bool		isActive() const;
+			/* expirations since the last timeout signal, more than one if the loop fell behind */
+			uint64_t	expirations() const;
+
+			void		onDataReadable();
+
+			Signal<void> timeout;
+
+		private:
+			bool		_active;
+			bool		_repeat;
+			uint64_t	_expirations;
+	};
+
+	inline bool IOTimer::isActive() const
+	{
+		return _active;
+	}
+
+	inline uint64_t IOTimer::expirations() const
+	{
+		return _expirations;
+	}
+}
+
+#endif
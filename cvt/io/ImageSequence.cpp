@@ -79,6 +79,20 @@ namespace cvt {
 	}
 
 
+	bool ImageSequence::rewind()
+	{
+		_index = 0;
+		return true;
+	}
+
+	bool ImageSequence::loadFrame( Image& img, size_t idx ) const
+	{
+		if( idx >= _files.size() )
+			return false;
+		img.load( _files[ idx ] );
+		return true;
+	}
+
 	bool ImageSequence::hasNext() const
 	{
 		if( _index < ( _files.size() - 1 ) )
@@ -45,6 +45,11 @@ namespace cvt
             const   Image & frame() const { return _current; }
             bool    nextFrame( size_t timeout = 0 );
 			bool	hasNext() const;
+			bool	rewind();
+
+			/* random access to the frames of the sequence, independent of nextFrame() */
+			size_t	size() const { return _files.size(); }
+			bool	loadFrame( Image& img, size_t idx ) const;
             
         
         private:
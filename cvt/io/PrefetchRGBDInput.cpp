@@ -0,0 +1,107 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/PrefetchRGBDInput.h>
+#include <cvt/util/PluginManager.h>
+
+namespace cvt {
+
+	PrefetchRGBDInput::PrefetchRGBDInput( RGBDInput* input, size_t ringSize ) :
+		FramePrefetcher<PrefetchRGBDSample>( ringSize, 1 ),
+		_input( input ),
+		_parser( 0 ),
+		_inputPos( 0 )
+	{
+		setCalibration( input->calibration() );
+		start();
+	}
+
+	PrefetchRGBDInput::PrefetchRGBDInput( RGBDParser* parser, size_t ringSize, size_t numThreads ) :
+		FramePrefetcher<PrefetchRGBDSample>( ringSize, numThreads, parser->size() ),
+		_input( 0 ),
+		_parser( parser ),
+		_inputPos( 0 )
+	{
+		setCalibration( parser->calibration() );
+		/* make sure the loader plugins are initialized before the workers start */
+		PluginManager::instance();
+		start();
+	}
+
+	PrefetchRGBDInput::~PrefetchRGBDInput()
+	{
+		stop();
+	}
+
+	void PrefetchRGBDInput::next()
+	{
+		FramePrefetcher<PrefetchRGBDSample>::next();
+	}
+
+	bool PrefetchRGBDInput::hasNext() const
+	{
+		if( !_parser )
+			return true;
+		return ( size_t ) ( index() + 1 ) < _parser->size();
+	}
+
+	void PrefetchRGBDInput::seek( size_t idx )
+	{
+		FramePrefetcher<PrefetchRGBDSample>::seek( idx );
+	}
+
+	bool PrefetchRGBDInput::decode( PrefetchRGBDSample& slot, size_t idx )
+	{
+		if( _parser ) {
+			if( !_parser->loadSample( slot.sample, idx ) )
+				return false;
+			slot.pose = slot.sample.pose<double>();
+			return true;
+		}
+
+		/* generic input, only called from a single worker */
+		if( idx < _inputPos )
+			throw CVTException( "Input does not support seeking backwards" );
+
+		while( _inputPos < idx ) {
+			_input->next();
+			_inputPos++;
+		}
+
+		_input->next();
+		_inputPos++;
+		/* copy into the recycled slot, the input may reuse its images */
+		slot.sample.rgb = _input->rgb();
+		slot.sample.depth = _input->depth();
+		slot.sample.stamp = _input->stamp();
+		slot.sample.poseValid = _input->hasGroundTruthPose();
+		if( slot.sample.poseValid )
+			slot.pose = _input->groundTruthPose();
+		else
+			slot.pose.setIdentity();
+		return true;
+	}
+
+}
@@ -0,0 +1,90 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_PREFETCHRGBDINPUT_H
+#define CVT_PREFETCHRGBDINPUT_H
+
+#include <cvt/io/RGBDInput.h>
+#include <cvt/io/RGBDParser.h>
+#include <cvt/io/FramePrefetcher.h>
+
+namespace cvt {
+
+	struct PrefetchRGBDSample {
+		RGBDParser::RGBDSample	sample;
+		Matrix4d				pose;
+	};
+
+	/**
+	  @brief RGBDInput decorator loading samples ahead of time in background threads.
+
+	  Generic inputs ( e.g. cameras ) are read by a single thread calling next()
+	  on the wrapped input, the samples of a RGBDParser are loaded by several
+	  threads in parallel. Samples are delivered in order, the data is valid after
+	  the first call to next(). Loading errors are rethrown by next(), at the end
+	  of the data next() keeps the last sample. The wrapped input must not be used
+	  while the prefetcher exists.
+	 */
+	class PrefetchRGBDInput : public RGBDInput, private FramePrefetcher<PrefetchRGBDSample>
+	{
+		public:
+			PrefetchRGBDInput( RGBDInput* input, size_t ringSize = 8 );
+			PrefetchRGBDInput( RGBDParser* parser, size_t ringSize = 8, size_t numThreads = 2 );
+			~PrefetchRGBDInput();
+
+			void			next();
+			/* always true for generic inputs */
+			bool			hasNext() const;
+			/* number of samples, NUMFRAMES_UNKNOWN for generic inputs */
+			size_t			size() const { return _parser ? _parser->size() : NUMFRAMES_UNKNOWN; }
+
+			bool			hasGroundTruthPose() const { return data().poseValid; }
+			Matrix4d		groundTruthPose() const { return current().pose; }
+			const Image&	depth() const { return data().depth; }
+			const Image&	rgb() const { return data().rgb; }
+			double			stamp() const { return data().stamp; }
+
+			const RGBDParser::RGBDSample& data() const { return current().sample; }
+
+			/* the next call to next() delivers sample idx, generic inputs can only seek forward */
+			void			seek( size_t idx );
+			void			rewind() { seek( 0 ); }
+			ssize_t			index() const { return FramePrefetcher<PrefetchRGBDSample>::index(); }
+
+			using FramePrefetcher<PrefetchRGBDSample>::NUMFRAMES_UNKNOWN;
+
+		private:
+			PrefetchRGBDInput( const PrefetchRGBDInput& );
+
+			bool decode( PrefetchRGBDSample& slot, size_t idx );
+
+			RGBDInput*		_input;
+			RGBDParser*		_parser;
+			size_t			_inputPos;
+	};
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/FramePrefetcher.h>
+#include <cvt/io/PrefetchVideoInput.h>
+#include <cvt/io/PrefetchRGBDInput.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	namespace {
+
+		/* random access source failing on a single frame */
+		class IndexPrefetcher : public FramePrefetcher<size_t>
+		{
+			public:
+				IndexPrefetcher( size_t numFrames, size_t fail ) :
+					FramePrefetcher<size_t>( 4, 3, numFrames ),
+					_fail( fail )
+				{
+					start();
+				}
+
+				~IndexPrefetcher()
+				{
+					stop();
+				}
+
+			private:
+				bool decode( size_t& slot, size_t idx )
+				{
+					if( idx == _fail )
+						throw CVTException( "decode failed" );
+					slot = idx;
+					return true;
+				}
+
+				size_t _fail;
+		};
+
+		static void setValue( Image& img, uint8_t value )
+		{
+			size_t stride;
+			uint8_t* ptr = img.map( &stride );
+			for( size_t y = 0; y < img.height(); y++ )
+				memset( ptr + y * stride, value, img.width() );
+			img.unmap( ptr );
+		}
+
+		static uint8_t value( const Image& img )
+		{
+			size_t stride;
+			const uint8_t* ptr = img.map( &stride );
+			uint8_t v = ptr[ ( img.height() - 1 ) * stride + img.width() - 1 ];
+			img.unmap( ptr );
+			return v;
+		}
+
+		/* sequential input knowing its geometry only after the first frame */
+		class CountingVideoInput : public VideoInput
+		{
+			public:
+				CountingVideoInput( size_t num ) : _frame( 8, 4, IFormat::GRAY_UINT8 ), _num( num ), _pos( 0 ) {}
+
+				size_t			width() const { return _pos ? _frame.width() : 0; }
+				size_t			height() const { return _pos ? _frame.height() : 0; }
+				const IFormat&	format() const { return _frame.format(); }
+				const Image&	frame() const { return _frame; }
+				bool			rewind() { _pos = 0; return true; }
+
+				bool nextFrame( size_t )
+				{
+					if( _pos >= _num )
+						return false;
+					setValue( _frame, ( uint8_t ) _pos++ );
+					return true;
+				}
+
+			private:
+				Image	_frame;
+				size_t	_num;
+				size_t	_pos;
+		};
+
+		/* live input without an end */
+		class CountingRGBDInput : public RGBDInput
+		{
+			public:
+				CountingRGBDInput() : _rgb( 8, 4, IFormat::GRAY_UINT8 ), _depth( 8, 4, IFormat::GRAY_UINT16 ), _pos( 0 ) {}
+
+				void next()
+				{
+					_pos++;
+					setValue( _rgb, ( uint8_t ) _pos );
+				}
+
+				bool			hasGroundTruthPose() const { return true; }
+				const Image&	depth() const { return _depth; }
+				const Image&	rgb() const { return _rgb; }
+				double			stamp() const { return _pos; }
+
+				Matrix4d groundTruthPose() const
+				{
+					Matrix4d pose;
+					pose.setIdentity();
+					pose[ 0 ][ 3 ] = _pos;
+					return pose;
+				}
+
+			private:
+				Image	_rgb;
+				Image	_depth;
+				size_t	_pos;
+		};
+
+	}
+
+BEGIN_CVTTEST( Prefetch )
+	bool result = true;
+	bool b;
+
+	{
+		IndexPrefetcher prefetcher( 20, 7 );
+		size_t failed = 0;
+		b = true;
+		for( size_t i = 0; i < 20; i++ ) {
+			try {
+				b &= prefetcher.next();
+				b &= prefetcher.current() == i && prefetcher.index() == ( ssize_t ) i;
+			} catch( const Exception& ) {
+				failed = i;
+			}
+		}
+		b &= failed == 7 && !prefetcher.next();
+		CVTTEST_PRINT( "in order delivery, decoding errors", b );
+		result &= b;
+
+		prefetcher.seek( 3 );
+		b = prefetcher.index() == 2 && prefetcher.next() && prefetcher.current() == 3;
+		b &= prefetcher.next() && prefetcher.current() == 4;
+		prefetcher.seek( 19 );
+		b &= prefetcher.next() && prefetcher.current() == 19 && !prefetcher.next();
+		CVTTEST_PRINT( "seek", b );
+		result &= b;
+	}
+
+	{
+		CountingVideoInput input( 5 );
+		PrefetchVideoInput prefetch( &input, 2 );
+		b = prefetch.width() == 8 && prefetch.height() == 4 && prefetch.format() == IFormat::GRAY_UINT8;
+		CVTTEST_PRINT( "video geometry before the first frame", b );
+		result &= b;
+
+		b = true;
+		for( size_t i = 0; i < 5; i++ )
+			b &= prefetch.nextFrame() && value( prefetch.frame() ) == i;
+		b &= !prefetch.nextFrame();
+		prefetch.rewind();
+		b &= prefetch.nextFrame() && value( prefetch.frame() ) == 0;
+		CVTTEST_PRINT( "video sequential input", b );
+		result &= b;
+	}
+
+	{
+		CountingRGBDInput input;
+		PrefetchRGBDInput prefetch( &input, 3 );
+		b = prefetch.size() == PrefetchRGBDInput::NUMFRAMES_UNKNOWN;
+		for( size_t i = 1; i <= 10; i++ ) {
+			b &= prefetch.hasNext();
+			prefetch.next();
+			b &= prefetch.stamp() == i && value( prefetch.rgb() ) == i;
+			b &= prefetch.hasGroundTruthPose() && prefetch.groundTruthPose()[ 0 ][ 3 ] == i;
+			b &= prefetch.depth().format() == IFormat::GRAY_UINT16;
+		}
+		CVTTEST_PRINT( "generic rgbd input", b );
+		result &= b;
+
+		prefetch.seek( 20 );
+		prefetch.next();
+		b = prefetch.stamp() == 21 && prefetch.index() == 20;
+		prefetch.seek( 0 );
+		try {
+			prefetch.next();
+			b = false;
+		} catch( const Exception& ) {
+		}
+		CVTTEST_PRINT( "generic rgbd seek", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
+
+}
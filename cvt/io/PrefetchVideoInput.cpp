@@ -0,0 +1,121 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/PrefetchVideoInput.h>
+#include <cvt/io/ImageSequence.h>
+#include <cvt/util/PluginManager.h>
+
+namespace cvt {
+
+	PrefetchVideoInput::PrefetchVideoInput( VideoInput* input, size_t ringSize ) :
+		FramePrefetcher<Image>( ringSize, 1 ),
+		_input( input ),
+		_sequence( 0 ),
+		_inputPos( 0 ),
+		_width( input->width() ),
+		_height( input->height() ),
+		_format( input->format() )
+	{
+		start();
+		initGeometry();
+	}
+
+	PrefetchVideoInput::PrefetchVideoInput( ImageSequence* sequence, size_t ringSize, size_t numThreads ) :
+		FramePrefetcher<Image>( ringSize, numThreads, sequence->size() ),
+		_input( 0 ),
+		_sequence( sequence ),
+		_inputPos( 0 ),
+		_width( 0 ),
+		_height( 0 ),
+		_format( IFormat::GRAY_UINT8 )
+	{
+		/* make sure the loader plugins are initialized before the workers start */
+		PluginManager::instance();
+		start();
+		initGeometry();
+	}
+
+	PrefetchVideoInput::~PrefetchVideoInput()
+	{
+		stop();
+	}
+
+	bool PrefetchVideoInput::nextFrame( size_t )
+	{
+		return next();
+	}
+
+	bool PrefetchVideoInput::rewind()
+	{
+		seek( 0 );
+		return true;
+	}
+
+	void PrefetchVideoInput::seek( size_t idx )
+	{
+		FramePrefetcher<Image>::seek( idx );
+	}
+
+	void PrefetchVideoInput::initGeometry()
+	{
+		if( _width && _height )
+			return;
+
+		/* the input does not know its geometry before the first frame */
+		const Image* first = peek();
+		if( first ) {
+			_width = first->width();
+			_height = first->height();
+			_format = first->format();
+		}
+	}
+
+	bool PrefetchVideoInput::decode( Image& slot, size_t idx )
+	{
+		if( _sequence )
+			return _sequence->loadFrame( slot, idx );
+
+		/* sequential input, only called from a single worker */
+		if( idx < _inputPos ) {
+			if( !_input->rewind() )
+				throw CVTException( "Input does not support rewinding" );
+			_inputPos = 0;
+		}
+
+		while( _inputPos < idx ) {
+			if( !_input->nextFrame() )
+				return false;
+			_inputPos++;
+		}
+
+		if( !_input->nextFrame() )
+			return false;
+		_inputPos++;
+		/* copy into the recycled slot, the input may reuse its frame */
+		slot = _input->frame();
+		return true;
+	}
+
+}
@@ -0,0 +1,81 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_PREFETCHVIDEOINPUT_H
+#define CVT_PREFETCHVIDEOINPUT_H
+
+#include <cvt/io/VideoInput.h>
+#include <cvt/io/FramePrefetcher.h>
+
+namespace cvt {
+
+	class ImageSequence;
+
+	/**
+	  @brief VideoInput decorator decoding frames ahead of time in background threads.
+
+	  Sequential inputs ( e.g. VideoReader ) are decoded by a single thread calling
+	  nextFrame() on the wrapped input, image sequences are loaded by several threads
+	  in parallel. Frames are always delivered in order, frame() is valid after the
+	  first call to nextFrame(), width(), height() and format() are valid after
+	  construction. Decoding errors are rethrown by nextFrame(). The wrapped input
+	  must not be used while the prefetcher exists.
+	 */
+	class PrefetchVideoInput : public VideoInput, private FramePrefetcher<Image>
+	{
+		public:
+			PrefetchVideoInput( VideoInput* input, size_t ringSize = 8 );
+			PrefetchVideoInput( ImageSequence* sequence, size_t ringSize = 8, size_t numThreads = 2 );
+			~PrefetchVideoInput();
+
+			size_t			width() const { return index() < 0 ? _width : frame().width(); }
+			size_t			height() const { return index() < 0 ? _height : frame().height(); }
+			const IFormat&	format() const { return index() < 0 ? _format : frame().format(); }
+			const Image&	frame() const { return current(); }
+			/* blocks until the frame is decoded, the timeout is ignored, throws on decoding errors */
+			bool			nextFrame( size_t timeout = 0 );
+			bool			rewind();
+
+			/* the next call to nextFrame() delivers frame idx */
+			void			seek( size_t idx );
+			ssize_t			index() const { return FramePrefetcher<Image>::index(); }
+
+		private:
+			PrefetchVideoInput( const PrefetchVideoInput& );
+
+			bool decode( Image& slot, size_t idx );
+			void initGeometry();
+
+			VideoInput*		_input;
+			ImageSequence*	_sequence;
+			size_t			_inputPos;
+			size_t			_width;
+			size_t			_height;
+			IFormat			_format;
+	};
+
+}
+
+#endif
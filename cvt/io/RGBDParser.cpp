@@ -77,15 +77,23 @@ namespace cvt
             std::cout << "End of data !" << std::endl;
             return;
         }
-        _sample.stamp	= _stamps[ _idx ];
-        _sample.rgb.load( _rgbFiles[ _idx ] );
-        _sample.depth.load( _depthFiles[ _idx ] );
-        _sample.orientation = _orientations[ _idx ];
-        _sample.position = _positions[ _idx ];
-        _sample.poseValid = _poseValid[ _idx ];
+        loadSample( _sample, _idx );
         _idx++;
     }
 
+    bool RGBDParser::loadSample( RGBDSample& sample, size_t idx ) const
+    {
+        if( idx >= _stamps.size() )
+            return false;
+        sample.stamp	= _stamps[ idx ];
+        sample.rgb.load( _rgbFiles[ idx ] );
+        sample.depth.load( _depthFiles[ idx ] );
+        sample.orientation = _orientations[ idx ];
+        sample.position = _positions[ idx ];
+        sample.poseValid = _poseValid[ idx ];
+        return true;
+    }
+
     void RGBDParser::loadGroundTruth()
     {
         String file;
@@ -82,6 +82,9 @@ namespace cvt
             const String&       rgbFile( size_t idx ) const { return _rgbFiles[ idx ]; }
             const String&       depthFile( size_t idx ) const { return _depthFiles[ idx ]; }
 
+            /* load sample idx independent of the current position, returns false if idx is out of range */
+            bool                loadSample( RGBDSample& sample, size_t idx ) const;
+
         private:
             const double			 _maxStampDiff;
             String					 _folder;
@@ -0,0 +1,93 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_RAWVIDEOFORMAT_H
+#define CVT_RAWVIDEOFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cvt
+{
+	/*
+	   On-disk layout of the raw video container (version 2), native byte order:
+
+	   [ RawVideoFileHeader, padded to RAWVIDEO_HEADERSIZE ]
+	   [ RawVideoChunkHeader | payload, padded to the chunk alignment ] * numFrames
+	   [ RawVideoIndexEntry * numFrames, padded to the chunk alignment ]
+
+	   Every chunk carries the geometry of its stream, so files without
+	   index (e.g. from an interrupted capture) can be recovered by scanning.
+	   Files without the magic are read as version 1 (uint32 width, height,
+	   stride, format followed by the frames).
+	 */
+
+	#define RAWVIDEO_MAGIC		"CVTRAWV2"
+	#define RAWVIDEO_CHUNKMAGIC	0x4d415246 /* "FRAM" */
+	#define RAWVIDEO_VERSION	2
+	#define RAWVIDEO_HEADERSIZE	4096
+	#define RAWVIDEO_CHUNKALIGN	64
+	#define RAWVIDEO_DIRECTALIGN	4096
+
+	struct RawVideoFileHeader {
+		char		magic[ 8 ];
+		uint32_t	version;
+		uint32_t	numStreams;
+		uint64_t	numFrames;
+		/* 0 if the index was never written */
+		uint64_t	indexOffset;
+		uint64_t	indexSize;
+	};
+
+	struct RawVideoChunkHeader {
+		uint32_t	magic;
+		uint32_t	stream;
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	stride;
+		uint32_t	formatID;
+		/* payload size and size of the whole chunk including padding */
+		uint64_t	size;
+		uint64_t	chunkSize;
+		double		stamp;
+		uint64_t	sequence;
+		uint64_t	reserved;
+	};
+
+	struct RawVideoIndexEntry {
+		/* offset of the chunk header in the file */
+		uint64_t	offset;
+		double		stamp;
+		uint32_t	stream;
+		uint32_t	reserved;
+	};
+
+	inline uint64_t RawVideoAlign( uint64_t size, uint64_t alignment )
+	{
+		return ( size + alignment - 1 ) & ~( alignment - 1 );
+	}
+}
+
+#endif
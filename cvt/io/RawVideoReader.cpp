@@ -22,25 +22,32 @@
    THE SOFTWARE.
 */
 
+
 #include <cvt/io/RawVideoReader.h>
 #include <cvt/util/Exception.h>
 
 #include <fcntl.h>
+#include <errno.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
 namespace cvt
 {
-	RawVideoReader::RawVideoReader( const String & filename, bool autoRewind ):
+	RawVideoReader::RawVideoReader( const String & filename, bool autoRewind, size_t stream, size_t windowSize ):
 		_fd( -1 ),
-		_format( IFormat::RGBA_UINT8 ),
-		_autoRewind( autoRewind ),
+		_fileSize( 0 ),
+		_windowSize( windowSize ),
+		_version( 0 ),
 		_map( 0 ),
-		_mappedSize( 0 ),
-		_ptr( 0 )
+		_mapOffset( 0 ),
+		_mapSize( 0 ),
+		_stream( stream ),
+		_autoRewind( autoRewind ),
+		_next( 0 ),
+		_current( -1 ),
+		_stamp( 0.0 )
 	{
-		// create the file (open, truncate to header size)
 		_fd = open( filename.c_str(), O_RDONLY , 0 );
 		if( _fd < 0 ){
 			char * err = strerror( errno );
@@ -50,97 +57,308 @@ namespace cvt
 		}
 
 		_pageSize = sysconf( _SC_PAGE_SIZE );
-	
+
 		struct stat fileInfo;
 		if( fstat( _fd, &fileInfo ) == -1 ){
 			char * err = strerror( errno );
 			String msg( "fstat error: " );
 			msg += err;
+			::close( _fd );
 			throw CVTException( msg.c_str() );
-		}	
+		}
+		_fileSize = fileInfo.st_size;
+
+		try {
+			readHeader();
+		} catch( ... ){
+			::close( _fd );
+			throw;
+		}
+
+		const Stream & s = _streams[ _stream ];
+		_frame.reallocate( s.width, s.height, IFormat::formatForId( s.formatID ) );
+	}
+
+	RawVideoReader::~RawVideoReader()
+	{
+		unmap();
+		if( _fd != -1 )
+			::close( _fd );
+	}
+
+	void RawVideoReader::readHeader()
+	{
+		RawVideoFileHeader header;
+		if( !readAt( &header, sizeof( header ), 0 ) || memcmp( header.magic, RAWVIDEO_MAGIC, sizeof( header.magic ) ) ){
+			readLegacyHeader();
+		} else {
+			_version = header.version;
+			if( _version > RAWVIDEO_VERSION )
+				throw CVTException( "Unsupported raw video version" );
+
+			// without valid index (e.g. interrupted capture) recover the frames from the chunk headers
+			if( !header.indexOffset || !readIndex( header.indexOffset, header.indexSize ) )
+				scanChunks();
+		}
+
+		if( _stream >= _streams.size() )
+			throw CVTException( "Raw video does not contain the requested stream" );
+	}
+
+	void RawVideoReader::readLegacyHeader()
+	{
+		uint32_t header[ 4 ];
+		if( !readAt( header, sizeof( header ), 0 ) )
+			throw CVTException( "Could not read raw video header" );
+
+		_version = 1;
+
+		Stream s;
+		s.width = header[ 0 ];
+		s.height = header[ 1 ];
+		s.stride = header[ 2 ];
+		s.formatID = ( IFormatID ) header[ 3 ];
+
+		uint64_t frameSize = ( uint64_t )s.stride * s.height;
+		if( !frameSize )
+			throw CVTException( "Invalid raw video header" );
+
+		uint64_t numFrames = ( _fileSize - sizeof( header ) ) / frameSize;
+		s.frames.resize( numFrames );
+		for( uint64_t i = 0; i < numFrames; i++ ){
+			s.frames[ i ].offset = sizeof( header ) + i * frameSize;
+			s.frames[ i ].stamp = ( double ) i;
+		}
+		_streams.push_back( s );
+	}
+
+	bool RawVideoReader::readIndex( uint64_t indexOffset, uint64_t indexSize )
+	{
+		if( indexOffset + indexSize > _fileSize || indexSize % sizeof( RawVideoIndexEntry ) )
+			return false;
+
+		std::vector<RawVideoIndexEntry> index( indexSize / sizeof( RawVideoIndexEntry ) );
+		if( index.size() && !readAt( &index[ 0 ], indexSize, indexOffset ) )
+			return false;
+
+		for( size_t i = 0; i < index.size(); i++ ){
+			RawVideoChunkHeader chunk;
+			// the geometry of a stream is in the chunk headers
+			if( index[ i ].stream >= _streams.size() ){
+				if( !readAt( &chunk, sizeof( chunk ), index[ i ].offset ) || chunk.magic != RAWVIDEO_CHUNKMAGIC )
+					return false;
+			} else {
+				chunk.magic = RAWVIDEO_CHUNKMAGIC;
+				chunk.stream = index[ i ].stream;
+				chunk.size = 0;
+			}
+			chunk.stamp = index[ i ].stamp;
+			if( index[ i ].offset + sizeof( chunk ) > indexOffset || chunk.stream > _streams.size() ){
+				_streams.clear();
+				return false;
+			}
+			addFrame( chunk, index[ i ].offset );
+
+			const Stream & s = _streams[ chunk.stream ];
+			if( s.frames.back().offset + s.stride * s.height > indexOffset ){
+				_streams.clear();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void RawVideoReader::scanChunks()
+	{
+		_streams.clear();
+
+		uint64_t offset = RAWVIDEO_HEADERSIZE;
+		RawVideoChunkHeader chunk;
+		while( readAt( &chunk, sizeof( chunk ), offset ) ){
+			if( chunk.magic != RAWVIDEO_CHUNKMAGIC ||
+			    chunk.chunkSize < sizeof( chunk ) + chunk.size ||
+			    offset + sizeof( chunk ) + chunk.size > _fileSize ||
+			    chunk.stream > _streams.size() )
+				break;
+			addFrame( chunk, offset );
+			offset += chunk.chunkSize;
+		}
+	}
+
+	void RawVideoReader::addFrame( const RawVideoChunkHeader & chunk, uint64_t offset )
+	{
+		if( chunk.stream == _streams.size() ){
+			Stream s;
+			s.width = chunk.width;
+			s.height = chunk.height;
+			s.stride = chunk.stride;
+			s.formatID = ( IFormatID ) chunk.formatID;
+			_streams.push_back( s );
+		}
+
+		Entry e;
+		e.offset = offset + sizeof( RawVideoChunkHeader );
+		e.stamp = chunk.stamp;
+		_streams[ chunk.stream ].frames.push_back( e );
+	}
+
+	bool RawVideoReader::readAt( void* dst, size_t size, uint64_t offset ) const
+	{
+		uint8_t* ptr = ( uint8_t* ) dst;
+		while( size ){
+			ssize_t n = ::pread( _fd, ptr, size, ( off_t ) offset );
+			if( n < 0 && errno == EINTR )
+				continue;
+			if( n <= 0 )
+				return false;
+			ptr += n;
+			size -= n;
+			offset += n;
+		}
+		return true;
+	}
+
+	const uint8_t* RawVideoReader::map( uint64_t offset, size_t size )
+	{
+		if( _map && offset >= _mapOffset && offset + size <= _mapOffset + _mapSize )
+			return _map + ( offset - _mapOffset );
+
+		unmap();
+
+		uint64_t aligned = offset & ~( ( uint64_t ) _pageSize - 1 );
+		size_t len = Math::max<uint64_t>( _windowSize, offset + size - aligned );
+		len = Math::min<uint64_t>( len, _fileSize - aligned );
 
-		_mappedSize = fileInfo.st_size;
-		_map = mmap( 0, _mappedSize, PROT_READ, MAP_PRIVATE, _fd, 0 );
-		if( _map == MAP_FAILED ){
+		void* ptr = mmap( 0, len, PROT_READ, MAP_SHARED, _fd, ( off_t ) aligned );
+		if( ptr == MAP_FAILED ){
 			char * err = strerror( errno );
 			String msg( "Could not map file: " );
 			msg += err;
-			_map = 0;
 			throw CVTException( msg.c_str() );
 		}
-		_ptr = ( uint8_t* )_map;
+		madvise( ptr, len, MADV_SEQUENTIAL );
 
-		readHeader();	
+		_map = ( uint8_t* ) ptr;
+		_mapOffset = aligned;
+		_mapSize = len;
+		return _map + ( offset - _mapOffset );
 	}
 
-	RawVideoReader::~RawVideoReader()
+	void RawVideoReader::unmap()
 	{
-		if( _fd != -1 ){
-			if( _map != 0 ){
-				if( munmap( _map, _mappedSize ) != 0 ){
-					char * err = strerror( errno );
-					String msg( "Could not unmap memory: " );
-					msg += err;
-					throw CVTException( msg.c_str() );
-				}
-			}
+		if( _map ){
+			munmap( _map, _mapSize );
+			_map = 0;
+			_mapSize = 0;
+		}
+	}
 
-			if( close( _fd ) < 0 ){
-				char * err = strerror( errno );
-				String msg( "Could not close file: " );
-				msg += err;
-				throw CVTException( msg.c_str() );
+	void RawVideoReader::prefetch( const Stream & s, size_t idx )
+	{
+		if( idx >= s.frames.size() )
+			return;
+
+		// readahead of the next frame if it is inside the current window
+		uint64_t begin = s.frames[ idx ].offset & ~( ( uint64_t ) _pageSize - 1 );
+		uint64_t end = Math::min<uint64_t>( s.frames[ idx ].offset + s.stride * s.height, _mapOffset + _mapSize );
+		if( _map && begin >= _mapOffset && end > begin )
+			madvise( _map + ( begin - _mapOffset ), end - begin, MADV_WILLNEED );
+	}
+
+	void RawVideoReader::copyFrame( Image & dst, const Stream & s, size_t idx )
+	{
+		dst.reallocate( s.width, s.height, IFormat::formatForId( s.formatID ) );
+
+		const uint8_t* src = map( s.frames[ idx ].offset, s.stride * s.height );
+
+		size_t istride;
+		uint8_t* iptr = dst.map<uint8_t>( &istride );
+
+		SIMD* simd = SIMD::instance();
+		if( istride == s.stride ){
+			simd->Memcpy( iptr, src, s.height * s.stride );
+		} else {
+			size_t h = s.height;
+			uint8_t * p = iptr;
+			size_t bytesPerRow = s.width * dst.bpp();
+			while( h-- ){
+				simd->Memcpy( p, src, bytesPerRow );
+				src += s.stride;
+				p += istride;
 			}
 		}
+		dst.unmap( iptr );
 	}
 
-	void RawVideoReader::readHeader()
+	bool RawVideoReader::nextFrame( size_t )
 	{
-		_width = *( ( uint32_t* ) _ptr );
-		_ptr += sizeof( uint32_t );
-		_height = *( ( uint32_t* ) _ptr );
-		_ptr += sizeof( uint32_t );
-		_stride = *( ( uint32_t* ) _ptr );
-		_ptr += sizeof( uint32_t );
-		_format = IFormat::formatForId( (IFormatID ) *( ( uint32_t* ) _ptr ) );
-		_ptr += sizeof( uint32_t );
-		
-		uint32_t dataSize = _mappedSize - ( 4 * sizeof( uint32_t ) );
-		uint32_t frameSize = _stride * _height;
+		const Stream & s = _streams[ _stream ];
+		if( _next >= s.frames.size() ){
+			if( !_autoRewind || s.frames.empty() )
+				return false;
+			_next = 0;
+		}
 
-		_numFrames = dataSize / frameSize;
-		_currentFrame = 1;
+		copyFrame( _frame, s, _next );
+		_current = _next;
+		_stamp = s.frames[ _next ].stamp;
+		_next++;
+		prefetch( s, _next );
+		return true;
+	}
 
-		_frame.reallocate( _width, _height, _format );
+	bool RawVideoReader::rewind()
+	{
+		return seek( 0 );
 	}
 
+	bool RawVideoReader::seek( size_t idx )
+	{
+		if( idx >= _streams[ _stream ].frames.size() )
+			return false;
+		_next = idx;
+		prefetch( _streams[ _stream ], _next );
+		return true;
+	}
 
-	bool RawVideoReader::nextFrame( size_t )
+	bool RawVideoReader::readFrame( Image & dst, size_t stream, size_t idx, double* stamp )
 	{
-		if( _currentFrame < _numFrames ){
-			size_t istride;
-			uint8_t* iptr = _frame.map<uint8_t>( &istride );
+		if( stream >= _streams.size() || idx >= _streams[ stream ].frames.size() )
+			return false;
 
-			SIMD* simd = SIMD::instance();
-			if( istride == _stride ){
-				size_t num = _height * _stride;
-				simd->Memcpy( iptr, _ptr, num );
-				_ptr += num;
-			} else {
-				size_t h = _height;
-				uint8_t * p = iptr;
-				size_t bytesPerRow = _width * _frame.bpp();
-				while( h-- ){
-					simd->Memcpy( p, _ptr, bytesPerRow );
-					_ptr += _stride;
-					p += istride;
-				}
-			}
-			_frame.unmap( iptr );
-			_currentFrame++;
-			return true;
+		copyFrame( dst, _streams[ stream ], idx );
+		if( stamp )
+			*stamp = _streams[ stream ].frames[ idx ].stamp;
+		return true;
+	}
+
+	double RawVideoReader::frameStamp( size_t stream, size_t idx ) const
+	{
+		if( stream >= _streams.size() || idx >= _streams[ stream ].frames.size() )
+			throw CVTException( "Frame out of range" );
+		return _streams[ stream ].frames[ idx ].stamp;
+	}
+
+	size_t RawVideoReader::findFrame( size_t stream, double stamp ) const
+	{
+		if( stream >= _streams.size() || _streams[ stream ].frames.empty() )
+			throw CVTException( "Stream out of range" );
+
+		const std::vector<Entry> & frames = _streams[ stream ].frames;
+		// binary search for the first frame not before stamp
+		size_t lo = 0, hi = frames.size();
+		while( lo < hi ){
+			size_t mid = ( lo + hi ) >> 1;
+			if( frames[ mid ].stamp < stamp )
+				lo = mid + 1;
+			else
+				hi = mid;
 		}
-		return false;
+
+		if( lo == frames.size() )
+			return lo - 1;
+		if( lo > 0 && ( stamp - frames[ lo - 1 ].stamp ) <= ( frames[ lo ].stamp - stamp ) )
+			return lo - 1;
+		return lo;
 	}
 }
-
@@ -22,19 +22,32 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_RAWVIDEO_READER
 #define CVT_RAWVIDEO_READER
 
 #include <cvt/util/String.h>
 #include <cvt/io/VideoInput.h>
+#include <cvt/io/RawVideoFormat.h>
 #include <cvt/gfx/Image.h>
 
+#include <vector>
+#include <sys/types.h>
+
 namespace cvt {
 
+	/**
+	  Reads files of RawVideoWriter.
+
+	  Only a window of the file is mapped at a time, so files larger than
+	  the address space limits can be read. As VideoInput the reader delivers
+	  the frames of one stream, the other streams can be accessed randomly
+	  via readFrame().
+	 */
 	class RawVideoReader : public VideoInput
 	{
 		public:
-			RawVideoReader( const String & fileName, bool autoRewind = true );
+			RawVideoReader( const String & fileName, bool autoRewind = true, size_t stream = 0, size_t windowSize = ( 64 << 20 ) );
 			~RawVideoReader();
 
 			size_t  width() const;
@@ -42,37 +55,80 @@ namespace cvt {
 			const   IFormat & format() const;
 			const   Image & frame() const;
 			bool    nextFrame( size_t timeout = 0 );
-			size_t	numFrames() const { return _numFrames; }
+			bool	rewind();
+
+			/* the next call to nextFrame delivers frame idx */
+			bool	seek( size_t idx );
+
+			/* index and timestamp of the current frame, -1 before the first call to nextFrame */
+			ssize_t	frameIndex() const { return _current; }
+			double	stamp() const { return _stamp; }
+
+			size_t	numFrames() const { return _streams[ _stream ].frames.size(); }
+			size_t	numFrames( size_t stream ) const;
+			size_t	numStreams() const { return _streams.size(); }
+			size_t	version() const { return _version; }
+
+			/* random access to any stream */
+			bool	readFrame( Image & dst, size_t stream, size_t idx, double* stamp = NULL );
+			double	frameStamp( size_t stream, size_t idx ) const;
+
+			/* index of the frame of stream with the timestamp closest to stamp */
+			size_t	findFrame( size_t stream, double stamp ) const;
 
 		private:
-			int			_fd;
-			Image		_frame;
-
-			size_t		_pageSize;
-			size_t		_width;
-			size_t		_height;
-			IFormat		_format;
-			bool		_autoRewind;
-
-			void*		_map;
-			size_t		_mappedSize;
-			uint8_t*	_ptr;
-			size_t		_stride;
-			size_t		_numFrames;
-			size_t		_currentFrame;
-
-			void rewind();
-			void readHeader();
+			struct Entry {
+				uint64_t	offset;
+				double		stamp;
+			};
+
+			struct Stream {
+				size_t				width;
+				size_t				height;
+				size_t				stride;
+				IFormatID			formatID;
+				std::vector<Entry>	frames;
+			};
+
+			int					_fd;
+			uint64_t			_fileSize;
+			size_t				_pageSize;
+			size_t				_windowSize;
+			size_t				_version;
+
+			/* the currently mapped window */
+			uint8_t*			_map;
+			uint64_t			_mapOffset;
+			size_t				_mapSize;
+
+			std::vector<Stream>	_streams;
+			size_t				_stream;
+			Image				_frame;
+			bool				_autoRewind;
+			size_t				_next;
+			ssize_t				_current;
+			double				_stamp;
+
+			void				readHeader();
+			void				readLegacyHeader();
+			bool				readIndex( uint64_t indexOffset, uint64_t indexSize );
+			void				scanChunks();
+			void				addFrame( const RawVideoChunkHeader & chunk, uint64_t offset );
+			bool				readAt( void* dst, size_t size, uint64_t offset ) const;
+			const uint8_t*		map( uint64_t offset, size_t size );
+			void				unmap();
+			void				prefetch( const Stream & s, size_t idx );
+			void				copyFrame( Image & dst, const Stream & s, size_t idx );
 	};
 
 	inline size_t RawVideoReader::width() const
 	{
-		return _width;
+		return _streams[ _stream ].width;
 	}
 
 	inline size_t RawVideoReader::height() const
 	{
-		return _height;
+		return _streams[ _stream ].height;
 	}
 
 	inline const Image & RawVideoReader::frame() const
@@ -82,7 +138,14 @@ namespace cvt {
 
 	inline const IFormat & RawVideoReader::format() const
 	{
-		return _format;
+		return IFormat::formatForId( _streams[ _stream ].formatID );
+	}
+
+	inline size_t RawVideoReader::numFrames( size_t stream ) const
+	{
+		if( stream >= _streams.size() )
+			return 0;
+		return _streams[ stream ].frames.size();
 	}
 
 }
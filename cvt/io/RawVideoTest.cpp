@@ -0,0 +1,192 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/RawVideoWriter.h>
+#include <cvt/io/RawVideoReader.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	static void fillImage( Image & img, size_t value )
+	{
+		IMapScoped<uint8_t> map( img );
+		size_t lineSize = img.width() * img.bpp();
+		for( size_t y = 0; y < img.height(); y++ ){
+			uint8_t* ptr = map.ptr();
+			for( size_t x = 0; x < lineSize; x++ )
+				ptr[ x ] = ( uint8_t )( value + x + 3 * y );
+			map++;
+		}
+	}
+
+	static bool checkImage( const Image & img, size_t value )
+	{
+		IMapScoped<const uint8_t> map( img );
+		size_t lineSize = img.width() * img.bpp();
+		for( size_t y = 0; y < img.height(); y++ ){
+			const uint8_t* ptr = map.ptr();
+			for( size_t x = 0; x < lineSize; x++ )
+				if( ptr[ x ] != ( uint8_t )( value + x + 3 * y ) )
+					return false;
+			map++;
+		}
+		return true;
+	}
+
+	/* drop the index and cut the last chunk as an interrupted capture would */
+	static bool _rawVideoRecoverTest( const String & file )
+	{
+		RawVideoFileHeader header;
+		RawVideoIndexEntry last;
+		FILE* f = fopen( file.c_str(), "r+b" );
+		if( !f )
+			return false;
+		bool b = fread( &header, sizeof( header ), 1, f ) == 1 && header.numFrames;
+		fseek( f, header.indexOffset + ( header.numFrames - 1 ) * sizeof( last ), SEEK_SET );
+		b &= fread( &last, sizeof( last ), 1, f ) == 1 && last.stream == 1;
+		uint64_t end = last.offset + sizeof( RawVideoChunkHeader ) + 10;
+		header.indexOffset = 0;
+		header.indexSize = 0;
+		fseek( f, 0, SEEK_SET );
+		b &= fwrite( &header, sizeof( header ), 1, f ) == 1;
+		fclose( f );
+		b &= truncate( file.c_str(), ( off_t ) end ) == 0;
+		if( !b )
+			return false;
+
+		RawVideoReader reader( file, false, 1 );
+		b = reader.numStreams() == 2 && reader.numFrames( 0 ) == 50 && reader.numFrames( 1 ) == 49;
+		size_t n = 0;
+		while( reader.nextFrame() ){
+			b &= checkImage( reader.frame(), 100 + n ) && reader.stamp() == n * 0.1 + 0.01;
+			n++;
+		}
+		Image img;
+		b &= n == 49 && reader.readFrame( img, 0, 49 ) && checkImage( img, 49 );
+		return b;
+	}
+
+	static bool _rawVideoTest( const String & file, bool directIO )
+	{
+		bool result = true;
+		bool b;
+
+		{
+			RawVideoWriter writer( file, directIO, 3 );
+			Image rgba( 37, 23, IFormat::RGBA_UINT8 );
+			Image gray( 17, 11, IFormat::GRAY_UINT8 );
+			for( size_t i = 0; i < 50; i++ ){
+				fillImage( rgba, i );
+				fillImage( gray, 100 + i );
+				writer.write( rgba, i * 0.1, 0 );
+				writer.write( gray, i * 0.1 + 0.01, 1 );
+			}
+		}
+
+		// small window to force remapping
+		RawVideoReader reader( file, false, 0, 4096 );
+		b = reader.numStreams() == 2 && reader.numFrames( 0 ) == 50 && reader.numFrames( 1 ) == 50;
+		b &= reader.frameIndex() == -1;
+		CVTTEST_PRINT( "index", b );
+		result &= b;
+
+		size_t n = 0;
+		b = true;
+		while( reader.nextFrame() ){
+			b &= checkImage( reader.frame(), n );
+			b &= reader.stamp() == n * 0.1;
+			n++;
+		}
+		b &= n == 50;
+		CVTTEST_PRINT( "sequential read", b );
+		result &= b;
+
+		b = reader.seek( 20 ) && reader.nextFrame() && reader.frameIndex() == 20 && checkImage( reader.frame(), 20 );
+		Image img;
+		b &= reader.readFrame( img, 1, 33 ) && checkImage( img, 133 );
+		b &= reader.findFrame( 1, 2.0 ) == 20;
+		CVTTEST_PRINT( "random access", b );
+		result &= b;
+
+		b = _rawVideoRecoverTest( file );
+		CVTTEST_PRINT( "recovery without index", b );
+		result &= b;
+
+		unlink( file.c_str() );
+		return result;
+	}
+
+	/* version 1: uint32 width, height, stride, format followed by the frames */
+	static bool _rawVideoLegacyTest( const String & file )
+	{
+		Image img( 13, 7, IFormat::RGBA_UINT8 );
+		uint32_t header[ 4 ] = { 13, 7, 13 * 4, img.format().formatID };
+		FILE* f = fopen( file.c_str(), "wb" );
+		if( !f )
+			return false;
+		fwrite( header, sizeof( header ), 1, f );
+		for( size_t i = 0; i < 5; i++ ){
+			fillImage( img, i );
+			IMapScoped<const uint8_t> map( img );
+			for( size_t y = 0; y < img.height(); y++, map++ )
+				fwrite( map.ptr(), 13 * 4, 1, f );
+		}
+		fclose( f );
+
+		bool b;
+		{
+			RawVideoReader reader( file, false );
+			b = reader.version() == 1 && reader.numStreams() == 1 && reader.numFrames() == 5 && reader.frameIndex() == -1;
+			size_t n = 0;
+			while( reader.nextFrame() ){
+				b &= reader.frameIndex() == ( ssize_t ) n && reader.stamp() == n && checkImage( reader.frame(), n );
+				n++;
+			}
+			b &= n == 5;
+		}
+		unlink( file.c_str() );
+		return b;
+	}
+
+BEGIN_CVTTEST( rawvideo )
+	bool result = true;
+
+	CVTTEST_LOG( "buffered" );
+	result &= _rawVideoTest( "/tmp/cvt_rawvideo_test.rawv", false );
+	CVTTEST_LOG( "direct io" );
+	result &= _rawVideoTest( "/tmp/cvt_rawvideo_test.rawv", true );
+
+	bool b = _rawVideoLegacyTest( "/tmp/cvt_rawvideo_test.rawv" );
+	CVTTEST_PRINT( "version 1", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
@@ -22,32 +22,43 @@
    THE SOFTWARE.
 */
 
+
 #include <cvt/io/RawVideoWriter.h>
 #include <cvt/util/Exception.h>
+#include <cvt/util/Time.h>
 #include <cvt/gfx/IMapScoped.h>
 
 #include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
 #include <unistd.h>
 
 namespace cvt
 {
-	RawVideoWriter::RawVideoWriter( const String & filename ):
+	RawVideoWriter::RawVideoWriter( const String & filename, bool directIO, size_t numBuffers ):
 		_fd( -1 ),
-		_currSize( 0 ),
-		_maxSize( 0 ),
-		_offsetInFile( 0 ),
-		_map( 0 ),
-		_mappedSize( 0 ),
-		_pos( 0 ),
-		_width( 0 ),
-		_height( 0 ),
-		_stride( 0 ),
-		_formatID( 0 )
+		_directIO( false ),
+		_alignment( RAWVIDEO_CHUNKALIGN ),
+		_fileOffset( RAWVIDEO_HEADERSIZE ),
+		_inFlight( 0 ),
+		_stop( false ),
+		_error( 0 )
 	{
-		// create the file (open, truncate to header size)
-		_fd = open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG );
+		int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+		if( directIO ){
+			_fd = open( filename.c_str(), flags | O_DIRECT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+			if( _fd >= 0 ){
+				_directIO = true;
+				_alignment = RAWVIDEO_DIRECTALIGN;
+			}
+		}
+#endif
+		// no O_DIRECT support (e.g. tmpfs): fall back to buffered io
+		if( _fd < 0 )
+			_fd = open( filename.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+
 		if( _fd < 0 ){
 			char * err = strerror( errno );
 			String msg( "Could not open file: " );
@@ -55,164 +66,277 @@ namespace cvt
 			throw CVTException( msg.c_str() );
 		}
 
-		// get the system page size
-		_pageSize = sysconf( _SC_PAGE_SIZE );
+		// header without index, so interrupted captures can be recovered
+		writeHeader( 0, 0 );
+
+		if( numBuffers < 1 )
+			numBuffers = 1;
+		_buffers.resize( numBuffers );
+		for( size_t i = 0; i < numBuffers; i++ ){
+			_buffers[ i ].data = 0;
+			_buffers[ i ].capacity = 0;
+			_buffers[ i ].size = 0;
+			_buffers[ i ].offset = 0;
+			_free.push_back( &_buffers[ i ] );
+		}
+
+		_thread.run( this );
 	}
 
 	RawVideoWriter::~RawVideoWriter()
 	{
-		if( _fd != -1 ){
-			if( _map != 0 ){
-				if( munmap( _map, _mappedSize ) != 0 ){
-					char * err = strerror( errno );
-					String msg( "Could not unmap memory: " );
-					msg += err;
-					throw CVTException( msg.c_str() );
-				}
-			}
-
-			// truncate to current size 
-			if( ftruncate( _fd, _currSize ) < 0){
-				char * err = strerror( errno );
-				String msg( "Could not resize file: " );
-				msg += err;
-				throw CVTException( msg.c_str() );
-			}
-
-			if( close( _fd ) < 0 ){
-				char * err = strerror( errno );
-				String msg( "Could not close file: " );
-				msg += err;
-				throw CVTException( msg.c_str() );
-			}
+		try {
+			close();
+		} catch( const Exception & e ){
+			std::cerr << "RawVideoWriter: " << e.what() << std::endl;
 		}
 
+		for( size_t i = 0; i < _buffers.size(); i++ )
+			free( _buffers[ i ].data );
 	}
 
-	void RawVideoWriter::write( const Image & img )
+	void RawVideoWriter::write( const Image & img, double stamp, size_t stream )
 	{
-		IMapScoped<const uint8_t> map( img );
-		if( _width == 0 ){
-			_width = img.width();
-			_height = img.height();
-			_stride = map.stride();
-			_formatID = (size_t)img.format().formatID;
-			_imgSize = _height * _stride;
-
-			// need to write the header first
-			remapFile( 4 * sizeof( uint32_t ) );
-			writeHeader();
-		} else {
-			// check size and format
-			if( _width != img.width() ||
-				_height != img.height() ||
-				_stride != map.stride() ||
-				_formatID != ( size_t )img.format().formatID ){
-				throw CVTException( "Trying to mix different image resolution or format in a single video!");
-			}
+		checkError();
+
+		size_t lineSize = img.width() * img.format().bpp;
+		if( stream == _streams.size() ){
+			StreamInfo info;
+			info.width = img.width();
+			info.height = img.height();
+			info.stride = lineSize;
+			info.formatID = ( uint32_t ) img.format().formatID;
+			info.sequence = 0;
+			_streams.push_back( info );
+		} else if( stream > _streams.size() ){
+			throw CVTException( "Streams have to be added in order" );
 		}
 
-		// check if we need to remap
-		if( ( _currSize + ( off_t )_imgSize ) > _maxSize ){
-			remapFile();
+		StreamInfo & info = _streams[ stream ];
+		if( info.width != img.width() ||
+			info.height != img.height() ||
+			info.formatID != ( uint32_t )img.format().formatID ){
+			throw CVTException( "Trying to mix different image resolution or format in a single stream!" );
 		}
 
-		SIMD * simd = SIMD::instance();
-		simd->Memcpy( _pos, map.ptr(), _imgSize );
+		if( stamp < 0.0 ){
+			Time now;
+			stamp = now.ms() * 1e-3;
+		}
 
-		// compute page aligned pointer position
-		uint8_t* ppos = (uint8_t*)( ( size_t )_pos &( ~( _pageSize - 1 ) ) );
-		size_t len = ( ( size_t )_pos + _imgSize - ( size_t )ppos );// & ( ~( _pageSize -1 ) );
-		if( msync( ppos, len, MS_ASYNC ) == -1 ){
-			char * err = strerror( errno );
-			String msg( "Could not msync: " );
-			msg += err;
-			throw CVTException( msg.c_str() );
+		// get a free staging buffer, only blocks if the disk cannot keep up
+		Buffer* buf;
+		_mutex.lock();
+		while( _free.empty() )
+			_cond.wait( _mutex );
+		buf = _free.front();
+		_free.pop_front();
+		_mutex.unlock();
+
+		size_t payload = info.stride * info.height;
+		size_t chunkSize = RawVideoAlign( sizeof( RawVideoChunkHeader ) + payload, _alignment );
+		if( buf->capacity < chunkSize ){
+			free( buf->data );
+			buf->data = 0;
+			buf->capacity = 0;
+			buf->data = allocAligned( chunkSize );
+			buf->capacity = chunkSize;
 		}
 
-		_pos += _imgSize;
-		_offsetInFile += _imgSize;
-		_currSize += _imgSize;
+		RawVideoChunkHeader* header = ( RawVideoChunkHeader* ) buf->data;
+		memset( header, 0, sizeof( RawVideoChunkHeader ) );
+		header->magic = RAWVIDEO_CHUNKMAGIC;
+		header->stream = stream;
+		header->width = info.width;
+		header->height = info.height;
+		header->stride = info.stride;
+		header->formatID = info.formatID;
+		header->size = payload;
+		header->chunkSize = chunkSize;
+		header->stamp = stamp;
+		header->sequence = info.sequence++;
+
+		SIMD * simd = SIMD::instance();
+		IMapScoped<const uint8_t> map( img );
+		uint8_t* dst = buf->data + sizeof( RawVideoChunkHeader );
+		size_t h = info.height;
+		while( h-- ){
+			simd->Memcpy( dst, map.ptr(), lineSize );
+			dst += lineSize;
+			map++;
+		}
+		memset( dst, 0, chunkSize - sizeof( RawVideoChunkHeader ) - payload );
+
+		buf->size = chunkSize;
+		buf->offset = _fileOffset;
+
+		RawVideoIndexEntry entry;
+		entry.offset = _fileOffset;
+		entry.stamp = stamp;
+		entry.stream = stream;
+		entry.reserved = 0;
+		_index.push_back( entry );
+		_fileOffset += chunkSize;
+
+		_mutex.lock();
+		_pending.push_back( buf );
+		_inFlight++;
+		_mutex.unlock();
+		_cond.notifyAll();
+	}
+
+	void RawVideoWriter::flush()
+	{
+		_mutex.lock();
+		while( _inFlight )
+			_cond.wait( _mutex );
+		_mutex.unlock();
+		checkError();
 	}
 
-	void RawVideoWriter::remapFile( size_t additionalBytes )
+	void RawVideoWriter::writeLoop()
 	{
-		size_t resizeSize = 50 * _imgSize + additionalBytes;
-		if( _map != 0 ){
-			if( munmap( _map, _mappedSize ) != 0 ){
-				char * err = strerror( errno );
-				String msg( "Could not unmap memory: " );
-				msg += err;
-				_map = 0;
-				_mappedSize = 0;
-				throw CVTException( msg.c_str() );
+		while( true ){
+			Buffer* buf;
+			_mutex.lock();
+			while( _pending.empty() && !_stop )
+				_cond.wait( _mutex );
+			if( _pending.empty() ){
+				_mutex.unlock();
+				return;
 			}
-			_map = 0;
-			_mappedSize = 0;
-		}
-		_maxSize += resizeSize;
-		resizeFile();
-
-		// file has maxSize 
-		size_t mapSize = resizeSize;
-		off_t alignedOffset = 0;
-		size_t ptrOffset = 0;
-		if( _offsetInFile != 0 ){
-			// copmute page aligned offset: 
-			alignedOffset = _offsetInFile & ( ~( _pageSize - 1 ) );
-			ptrOffset = _offsetInFile - alignedOffset;
-			mapSize += ptrOffset;
+			buf = _pending.front();
+			_pending.pop_front();
+			bool failed = _error != 0;
+			_mutex.unlock();
+
+			int err = 0;
+			if( !failed )
+				err = pwriteAll( buf->data, buf->size, buf->offset );
+
+			_mutex.lock();
+			if( err && !_error )
+				_error = err;
+			_free.push_back( buf );
+			_inFlight--;
+			_mutex.unlock();
+			_cond.notifyAll();
 		}
+	}
 
-		_map = mmap( 0, mapSize, PROT_WRITE, MAP_SHARED, _fd, alignedOffset );
-		if( _map == MAP_FAILED ){
-			std::cout << "MapSize: " << mapSize << " AlignedOffset: " << alignedOffset << ", _offsetInFile " << _offsetInFile << std::endl;
-			char * err = strerror( errno );
-			String msg( "Could not map file: " );
-			msg += err;
-			_map = 0;
-			throw CVTException( msg.c_str() );
-		} 
-			
-		// map successful
-		_pos = ( uint8_t* )_map;
-		_pos += ptrOffset;
-		_mappedSize = mapSize;
-		
-		if( madvise( _map, _mappedSize, MADV_SEQUENTIAL ) != 0 ){
-			char * err = strerror( errno );
-			String msg( "Memadvise failed: " );
-			msg += err;
-			throw CVTException( msg.c_str() );
+	int RawVideoWriter::pwriteAll( const uint8_t* data, size_t size, uint64_t offset )
+	{
+		while( size ){
+			ssize_t n = ::pwrite( _fd, data, size, ( off_t ) offset );
+			if( n < 0 ){
+				if( errno == EINTR )
+					continue;
+				return errno;
+			}
+			data += n;
+			size -= n;
+			offset += n;
 		}
+		return 0;
 	}
 
-	void RawVideoWriter::writeHeader()
+	void RawVideoWriter::throwError( int error ) const
 	{
-		*( ( uint32_t* )_pos ) = _width; _pos += sizeof( uint32_t );
-		*( ( uint32_t* )_pos ) = _height; _pos += sizeof( uint32_t );
-		*( ( uint32_t* )_pos ) = _stride; _pos += sizeof( uint32_t );
-		*( ( uint32_t* )_pos ) = _formatID; _pos += sizeof( uint32_t );
-		_offsetInFile += 4 * sizeof( uint32_t );
+		String msg( "Could not write file: " );
+		msg += strerror( error );
+		throw CVTException( msg.c_str() );
 	}
 
-	void RawVideoWriter::resizeFile()
+	uint8_t* RawVideoWriter::allocAligned( size_t size ) const
 	{
-		int res = lseek( _fd, _maxSize - 1, SEEK_SET );
-		if( res == -1 ){
-			char * err = strerror( errno );
-			String msg( "File resize failed: " );
-			msg += err;
-			throw CVTException( msg.c_str() );
+		void* ptr;
+		if( posix_memalign( &ptr, RAWVIDEO_DIRECTALIGN, size ) )
+			throw CVTException( "Could not allocate staging buffer" );
+		return ( uint8_t* ) ptr;
+	}
+
+	void RawVideoWriter::writeHeader( uint64_t indexOffset, uint64_t indexSize )
+	{
+		uint8_t* block = allocAligned( RAWVIDEO_HEADERSIZE );
+		memset( block, 0, RAWVIDEO_HEADERSIZE );
+
+		RawVideoFileHeader* header = ( RawVideoFileHeader* ) block;
+		memcpy( header->magic, RAWVIDEO_MAGIC, sizeof( header->magic ) );
+		header->version = RAWVIDEO_VERSION;
+		header->numStreams = _streams.size();
+		header->numFrames = _index.size();
+		header->indexOffset = indexOffset;
+		header->indexSize = indexSize;
+
+		int err = pwriteAll( block, RAWVIDEO_HEADERSIZE, 0 );
+		free( block );
+		if( err )
+			throwError( err );
+	}
+
+	void RawVideoWriter::writeIndex()
+	{
+		size_t indexSize = _index.size() * sizeof( RawVideoIndexEntry );
+		size_t size = RawVideoAlign( indexSize, _alignment );
+		if( !size ){
+			writeHeader( _fileOffset, 0 );
+			return;
 		}
 
-		res = ::write( _fd, "", 1 );
-		if( res == -1 ){
+		uint8_t* block = allocAligned( size );
+		memcpy( block, &_index[ 0 ], indexSize );
+		memset( block + indexSize, 0, size - indexSize );
+
+		int err = pwriteAll( block, size, _fileOffset );
+		free( block );
+		if( err )
+			throwError( err );
+
+		writeHeader( _fileOffset, indexSize );
+	}
+
+	void RawVideoWriter::close()
+	{
+		if( _fd == -1 )
+			return;
+
+		_mutex.lock();
+		_stop = true;
+		_mutex.unlock();
+		_cond.notifyAll();
+		_thread.join();
+
+		int fd = _fd;
+		int error = _error;
+		if( !error ){
+			try {
+				writeIndex();
+			} catch( ... ){
+				_fd = -1;
+				::close( fd );
+				throw;
+			}
+		}
+
+		_fd = -1;
+		if( ::close( fd ) < 0 ){
 			char * err = strerror( errno );
-			String msg( "File resize failed: " );
+			String msg( "Could not close file: " );
 			msg += err;
 			throw CVTException( msg.c_str() );
 		}
+
+		if( error )
+			throwError( error );
 	}
-}
 
+	void RawVideoWriter::checkError()
+	{
+		int error;
+		_mutex.lock();
+		error = _error;
+		_mutex.unlock();
+		if( error )
+			throwError( error );
+	}
+}
@@ -22,52 +22,99 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_RAWVIDEOWRITER_H
 #define CVT_RAWVIDEOWRITER_H
 
 #include <cvt/util/String.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
 #include <cvt/gfx/Image.h>
+#include <cvt/io/RawVideoFormat.h>
+
+#include <vector>
+#include <deque>
 
 namespace cvt
 {
+	/**
+	  Writes the chunked raw video container (see RawVideoFormat.h).
+
+	  Frames are copied into a pool of staging buffers and written to disk
+	  by a separate thread, write() only blocks if all staging buffers are
+	  in flight. Multiple streams (e.g. left/right or rgb/depth) can be
+	  interleaved in one file, each stream has a fixed size and format.
+	 */
 	class RawVideoWriter
 	{
 		public:
-			RawVideoWriter( const String & outname );
+			/**
+			  @param outname	the file to create
+			  @param directIO	bypass the page cache (O_DIRECT) if the filesystem supports it
+			  @param numBuffers	number of frames that can be queued for writing
+			 */
+			RawVideoWriter( const String & outname, bool directIO = false, size_t numBuffers = 8 );
 			~RawVideoWriter();
 
-			void write( const Image & img );
-
-		private:
-			// file descriptor
-			int		_fd;
-			off_t	_currSize;
-			off_t	_maxSize;
-
-			// the total offset into the file
-			off_t	_offsetInFile;
+			/* stamp < 0 uses the current time */
+			void write( const Image & img, double stamp = -1.0, size_t stream = 0 );
 
-			/* current position in mapped region */
-			void	* _map;
-			size_t	  _mappedSize;
-			uint8_t * _pos;
-			size_t	  _pageSize;
+			/* wait until all queued frames are on disk, throws on write errors */
+			void flush();
 
-			size_t	_width;
-			size_t	_height;
-			size_t	_stride;
-			size_t	_formatID;
-			size_t	_imgSize;
-
-			/* change the filesize and update the mapping */
-			void remapFile( size_t additionalBytes = 0 );
-
-			/* write the header to the file */
-			void writeHeader();
-
-			/* resize to maxsize */
-			void resizeFile();
+			size_t numFrames() const { return _index.size(); }
+			size_t numStreams() const { return _streams.size(); }
+			bool   directIO() const { return _directIO; }
 
+		private:
+			struct StreamInfo {
+				size_t		width;
+				size_t		height;
+				size_t		stride;
+				uint32_t	formatID;
+				size_t		sequence;
+			};
+
+			struct Buffer {
+				uint8_t*	data;
+				size_t		capacity;
+				size_t		size;
+				uint64_t	offset;
+			};
+
+			class WriterThread : public Thread<RawVideoWriter>
+			{
+				public:
+					void execute( RawVideoWriter* writer ) { writer->writeLoop(); }
+			};
+
+			int							_fd;
+			bool						_directIO;
+			size_t						_alignment;
+			uint64_t					_fileOffset;
+
+			std::vector<StreamInfo>		_streams;
+			std::vector<RawVideoIndexEntry>	_index;
+
+			std::vector<Buffer>			_buffers;
+			std::deque<Buffer*>			_free;
+			std::deque<Buffer*>			_pending;
+			size_t						_inFlight;
+			bool						_stop;
+			int							_error;
+			Mutex						_mutex;
+			Condition					_cond;
+			WriterThread				_thread;
+
+			void		writeLoop();
+			int			pwriteAll( const uint8_t* data, size_t size, uint64_t offset );
+			void		throwError( int error ) const;
+			uint8_t*	allocAligned( size_t size ) const;
+			void		writeHeader( uint64_t indexOffset, uint64_t indexSize );
+			void		writeIndex();
+			void		close();
+			void		checkError();
 	};
 }
 
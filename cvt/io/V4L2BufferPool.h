@@ -0,0 +1,181 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_V4L2BUFFERPOOL_H
+#define CVT_V4L2BUFFERPOOL_H
+
+#include <cvt/io/V4L2Camera.h>
+#include <cvt/util/Mutex.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+namespace cvt
+{
+	/**
+	  Driver buffers of a V4L2Camera, shared with the outstanding V4L2Frame leases.
+
+	  The buffers stay mapped until the camera and all leases are gone. A buffer is
+	  handed back to the driver when its last lease is released, this never throws:
+	  if the requeue fails ( device unplugged, stream stopped ) the buffer is marked
+	  lost and the camera retries and reports it on the next dequeue.
+	 */
+	struct V4L2BufferPool {
+		struct Buffer {
+			Buffer() : start( MAP_FAILED ), length( 0 ), dmabuf( -1 ), view( 0 ), refs( 0 ), lost( false ), sequence( 0 ), stamp( 0.0 ), dequeueStamp( 0.0 ) {}
+
+			void*		start;
+			size_t		length;
+			int			dmabuf;
+			Image*		view;
+			size_t		refs;
+			bool		lost;
+			uint32_t	sequence;
+			double		stamp;
+			double		dequeueStamp;
+		};
+
+		V4L2BufferPool( int fd, V4L2BufferType type, size_t num ) :
+			fd( fd ), type( type ), num( num ), refs( 1 ), attached( true ), numLost( 0 ), lostErrno( 0 )
+		{
+			buffers = new Buffer[ num ];
+		}
+
+		~V4L2BufferPool()
+		{
+			for( size_t i = 0; i < num; i++ ) {
+				delete buffers[ i ].view;
+				if( buffers[ i ].dmabuf != -1 )
+					::close( buffers[ i ].dmabuf );
+				if( buffers[ i ].start == MAP_FAILED )
+					continue;
+				if( type == V4L2BUFFER_USERPTR )
+					free( buffers[ i ].start );
+				else
+					munmap( buffers[ i ].start, buffers[ i ].length );
+			}
+			delete[] buffers;
+		}
+
+		uint32_t memory() const
+		{
+			return type == V4L2BUFFER_USERPTR ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
+		}
+
+		/* returns false and keeps errno if VIDIOC_QBUF failed */
+		bool queue( size_t idx )
+		{
+			v4l2_buffer buffer;
+			memset( &buffer, 0, sizeof( buffer ) );
+			buffer.index = idx;
+			buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buffer.memory = memory();
+			if( type == V4L2BUFFER_USERPTR ) {
+				buffer.m.userptr = ( unsigned long ) buffers[ idx ].start;
+				buffer.length = buffers[ idx ].length;
+			}
+			return ioctl( fd, VIDIOC_QBUF, &buffer ) == 0;
+		}
+
+		V4L2Frame lease( size_t idx )
+		{
+			return V4L2Frame( this, idx );
+		}
+
+		void ref( size_t idx )
+		{
+			ScopeLock lock( &mutex );
+			buffers[ idx ].refs++;
+			refs++;
+		}
+
+		/* returns true if the pool has to be deleted, never throws */
+		bool unref( size_t idx )
+		{
+			ScopeLock lock( &mutex );
+			if( --buffers[ idx ].refs == 0 && attached && !queue( idx ) ) {
+				buffers[ idx ].lost = true;
+				lostErrno = errno;
+				numLost++;
+			}
+			return --refs == 0;
+		}
+
+		/* retry to queue the lost buffers, returns false if one still fails */
+		bool requeueLost()
+		{
+			ScopeLock lock( &mutex );
+			if( !numLost )
+				return true;
+			for( size_t i = 0; i < num; i++ ) {
+				if( !buffers[ i ].lost )
+					continue;
+				if( !queue( i ) ) {
+					lostErrno = errno;
+					return false;
+				}
+				buffers[ i ].lost = false;
+				numLost--;
+			}
+			return true;
+		}
+
+		/* number of buffers currently held by leases */
+		size_t leased()
+		{
+			ScopeLock lock( &mutex );
+			size_t n = 0;
+			for( size_t i = 0; i < num; i++ ) {
+				if( buffers[ i ].refs )
+					n++;
+			}
+			return n;
+		}
+
+		/* the camera is closed: no more requeueing */
+		bool detach()
+		{
+			ScopeLock lock( &mutex );
+			attached = false;
+			return --refs == 0;
+		}
+
+		int				fd;
+		V4L2BufferType	type;
+		size_t			num;
+		Buffer*			buffers;
+		size_t			refs;
+		bool			attached;
+		size_t			numLost;
+		int				lostErrno;
+		Mutex			mutex;
+	};
+}
+
+#endif
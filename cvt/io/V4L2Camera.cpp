@@ -23,6 +23,7 @@
 */
 
 #include <cvt/io/V4L2Camera.h>
+#include <cvt/io/V4L2BufferPool.h>
 #include <cvt/io/FileSystem.h>
 
 #include <iostream>
@@ -39,31 +40,112 @@
 #include <stdio.h>
 
 #include "util/Exception.h"
+#include "util/Mutex.h"
 #include "math/Math.h"
 
 namespace cvt
 {
 
+	V4L2Frame::V4L2Frame() :
+		_pool( 0 ),
+		_index( 0 )
+	{
+	}
+
+	V4L2Frame::V4L2Frame( V4L2BufferPool* pool, size_t index ) :
+		_pool( pool ),
+		_index( index )
+	{
+		_pool->ref( _index );
+	}
+
+	V4L2Frame::V4L2Frame( const V4L2Frame& other ) :
+		_pool( other._pool ),
+		_index( other._index )
+	{
+		if( _pool )
+			_pool->ref( _index );
+	}
+
+	V4L2Frame::~V4L2Frame()
+	{
+		release();
+	}
+
+	V4L2Frame& V4L2Frame::operator=( const V4L2Frame& other )
+	{
+		// other may be this lease
+		V4L2BufferPool* pool = other._pool;
+		size_t index = other._index;
+		if( pool )
+			pool->ref( index );
+		release();
+		_pool = pool;
+		_index = index;
+		return *this;
+	}
+
+	void V4L2Frame::release()
+	{
+		if( !_pool )
+			return;
+		if( _pool->unref( _index ) )
+			delete _pool;
+		_pool = 0;
+	}
+
+	const Image& V4L2Frame::image() const
+	{
+		if( !_pool )
+			throw CVTException( "Invalid V4L2 frame lease" );
+		return *_pool->buffers[ _index ].view;
+	}
+
+	size_t V4L2Frame::sequence() const
+	{
+		return _pool ? _pool->buffers[ _index ].sequence : 0;
+	}
+
+	double V4L2Frame::stamp() const
+	{
+		return _pool ? _pool->buffers[ _index ].stamp : 0.0;
+	}
+
+	double V4L2Frame::dequeueStamp() const
+	{
+		return _pool ? _pool->buffers[ _index ].dequeueStamp : 0.0;
+	}
+
+	int V4L2Frame::dmabufFd() const
+	{
+		return _pool ? _pool->buffers[ _index ].dmabuf : -1;
+	}
+
 	const int V4L2Camera::supportedPixFormats[] = { V4L2_PIX_FMT_RGB32, V4L2_PIX_FMT_BGR32, V4L2_PIX_FMT_YUYV,
 													V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_GREY, V4L2_PIX_FMT_Y16};
 
 	const int V4L2Camera::standardWidths[] = {1024, 640, 320, 704, 352};
 	const int V4L2Camera::standardHeights[] = {768, 480, 240, 576, 288};
 
-	V4L2Camera::V4L2Camera( size_t camIndex, const CameraMode & mode ) :
+	V4L2Camera::V4L2Camera( size_t camIndex, const CameraMode & mode, size_t numBuffers, V4L2BufferType bufferType ) :
 		_width( mode.width ),
 		_height( mode.height ),
 		_fps( mode.fps ),
-		_numBuffers( 4 ),
+		_numBuffers( numBuffers < 2 ? 2 : numBuffers ),
+		_bufferType( bufferType ),
 		_camIndex( camIndex ),
 		_opened( false ),
 		_capturing( false ),
 		_nextBuf( -1 ),
 		_fd( -1 ),
-		_buffers( NULL ),
+		_pool( NULL ),
+		_stride( 0 ),
+		_imageSize( 0 ),
 		_frame( NULL ),
 		_format( mode.format ),
+		_zeroCopy( false ),
 		_stamp( 0.0 ),
+		_dequeueStamp( 0.0 ),
 		_frameIdx( 0 ),
 		_extControlsToSet( 0 ),
 		_autoExposure( false ),
@@ -109,20 +191,22 @@ namespace cvt
 
 	void V4L2Camera::close( )
 	{
-		for( size_t i = 0; i < _numBuffers; i++ ) {
-			if( ( _buffers[ i ].start != MAP_FAILED ) && _buffers[ i ].length ) {
-				if( munmap( _buffers[ i ].start, _buffers[ i ].length ) < 0 ) {
-					throw CVTException( "Could not unmap buffer " + i );
-				}
-			}
-		}
+		if( _capturing )
+			stopCapture( );
+
+		_current.release( );
+		// outstanding leases keep the buffers mapped
+		if( _pool && _pool->detach( ) )
+			delete _pool;
+		_pool = NULL;
+
+		if( _frame )
+			delete _frame;
+		_frame = NULL;
 
 		if( _extControlsToSet != 0 )
 			delete[] _extControlsToSet;
 
-		if( _buffers != 0 )
-			delete[] _buffers;
-
 		if( _fd != -1 )
 			::close( _fd );
 
@@ -178,6 +262,8 @@ namespace cvt
 
 		_width = fmt.fmt.pix.width;
 		_height = fmt.fmt.pix.height;
+		_stride = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : _width * _format.bpp;
+		_imageSize = fmt.fmt.pix.sizeimage ? fmt.fmt.pix.sizeimage : _stride * _height;
 
 		if( _frame )
 			delete _frame;
@@ -204,11 +290,21 @@ namespace cvt
 				streamParameter.parm.capture.timeperframe.numerator << " fps" << std::endl;
 		}
 
+		// the old buffers can only be released if no lease is left
+		if( _pool ) {
+			_current.release( );
+			if( _pool->leased( ) )
+				throw CVTException( "V4L2 buffers can not be reallocated while frames are leased" );
+			if( _pool->detach( ) )
+				delete _pool;
+			_pool = NULL;
+		}
+
 		// request the buffers
 		v4l2_requestbuffers requestBuffers = {0};
 		requestBuffers.count = _numBuffers;
 		requestBuffers.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		requestBuffers.memory = V4L2_MEMORY_MMAP;
+		requestBuffers.memory = _bufferType == V4L2BUFFER_USERPTR ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP;
 
 		if( ioctl( _fd, VIDIOC_REQBUFS, &requestBuffers ) != 0 ) {
 			throw CVTException( "VIDIOC_REQBUFS - Unable to allocate buffers" );
@@ -218,9 +314,9 @@ namespace cvt
 			throw CVTException( "VIDIOC_REQBUFS: Unable to allocate the request number of buffers" );
 		}
 
-		_buffers = new buffer_t[ _numBuffers ];
+		_pool = new V4L2BufferPool( _fd, _bufferType, _numBuffers );
 
-		queryBuffers( false );
+		queryBuffers( );
 		enqueueBuffers( );
 	}
 
@@ -248,35 +344,74 @@ namespace cvt
 		}
 	}
 
-	bool V4L2Camera::nextFrame( size_t tout )
+	bool V4L2Camera::dequeue( size_t& index, size_t tout )
 	{
 		fd_set rdset;
 		struct timeval timeout = {0};
 
 		v4l2_buffer buffer = {0};
 		buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buffer.memory = V4L2_MEMORY_MMAP;
+		buffer.memory = _pool->memory( );
 
 		if( !_capturing )
 			startCapture( );
 
+		// buffers released by leases that could not be handed back to the driver
+		if( !_pool->requeueLost( ) ) {
+			String msg;
+			msg.sprintf( "VIDIOC_QBUF - Unable to requeue released buffer: %s", strerror( _pool->lostErrno ) );
+			throw CVTException( msg.c_str( ) );
+		}
+
 		FD_ZERO( &rdset );
 		FD_SET( _fd, &rdset );
 
-		timeout.tv_usec = tout * 1000; // ms
+		timeout.tv_sec = tout / 1000;
+		timeout.tv_usec = ( tout % 1000 ) * 1000; // ms
 
 		// select - wait for data or timeout
 		int ret = select( _fd + 1, &rdset, NULL, NULL, &timeout );
 		if( ret < 0 ) {
 			throw CVTException( "Could not grab image (select error)" );
-		} else if( ret == 0 ) {
+		} else if( ret == 0 || !FD_ISSET( _fd, &rdset ) ) {
 			return false;
-		} else if( ( ret > 0 ) && ( FD_ISSET( _fd, &rdset ) ) ) {
-			if( ioctl( _fd, VIDIOC_DQBUF, &buffer ) != 0 ) {
-				throw CVTException( "Unable to dequeue buffer!" );
-			}
 		}
 
+		if( ioctl( _fd, VIDIOC_DQBUF, &buffer ) != 0 ) {
+			// all buffers might be leased
+			if( errno == EAGAIN )
+				return false;
+			throw CVTException( "Unable to dequeue buffer!" );
+		}
+
+		struct timespec now;
+		clock_gettime( CLOCK_MONOTONIC, &now );
+
+		index = buffer.index;
+		V4L2BufferPool::Buffer& b = _pool->buffers[ index ];
+		b.sequence = buffer.sequence;
+		b.stamp = static_cast<double>( buffer.timestamp.tv_sec ) +
+				  static_cast<double>( buffer.timestamp.tv_usec ) / 1000000.0;
+		b.dequeueStamp = static_cast<double>( now.tv_sec ) + static_cast<double>( now.tv_nsec ) * 1e-9;
+
+		_frameIdx     = b.sequence;
+		_stamp        = b.stamp;
+		_dequeueStamp = b.dequeueStamp;
+		return true;
+	}
+
+	bool V4L2Camera::nextFrame( size_t tout )
+	{
+		if( _zeroCopy ) {
+			// hand the previous buffer back before waiting for the next one
+			_current.release( );
+			return nextFrame( _current, tout );
+		}
+
+		size_t index;
+		if( !dequeue( index, tout ) )
+			return false;
+
 		// get frame from buffer
 		size_t stride;
 		uint8_t* ptrM;
@@ -284,30 +419,36 @@ namespace cvt
 
 		ptrM = ptr = _frame->map( &stride );
 		size_t h = _frame->height( );
-		uint8_t* bufPtr = static_cast<uint8_t*>( _buffers[ buffer.index ].start );
-		size_t bufStride = _frame->width( ) * _format.bpp;
+		const uint8_t* bufPtr = static_cast<const uint8_t*>( _pool->buffers[ index ].start );
+		size_t lineSize = _frame->width( ) * _format.bpp;
 		SIMD* simd = SIMD::instance( );
 		while( h-- ) {
-			simd->Memcpy( ptr, bufPtr, bufStride );
+			simd->Memcpy( ptr, bufPtr, lineSize );
 			ptr += stride;
-			bufPtr += bufStride;
+			bufPtr += _stride;
 		}
 		_frame->unmap( ptrM );
 
+		if( !_pool->queue( index ) )
+			throw CVTException( "VIDIOC_QBUF - Unable to queue buffer" );
 
-		_frameIdx = buffer.sequence;
-		_stamp    = static_cast<double>( buffer.timestamp.tv_sec ) +
-					static_cast<double>( buffer.timestamp.tv_usec ) / 1000000.0;
+		return true;
+	}
 
-		if( ioctl( _fd, VIDIOC_QBUF, &buffer ) != 0 ) {
-			throw CVTException( "Unable to requeue buffer" );
-		}
+	bool V4L2Camera::nextFrame( V4L2Frame& frame, size_t tout )
+	{
+		size_t index;
+		if( !dequeue( index, tout ) )
+			return false;
 
+		frame = _pool->lease( index );
 		return true;
 	}
 
 	const Image & V4L2Camera::frame( ) const
 	{
+		if( _zeroCopy && _current.valid( ) )
+			return _current.image( );
 		assert( _frame != NULL );
 		return *_frame;
 	}
@@ -426,59 +567,64 @@ namespace cvt
 
 	}
 
-	void V4L2Camera::queryBuffers( bool unmap )
+	void V4L2Camera::queryBuffers( )
 	{
-		int ret = 0;
-
 		for( unsigned int i = 0; i < _numBuffers ; i++ )
 		{
-			// unmap old buffer
-			if( unmap ) {
-				if( -1 == munmap( _buffers[ i ].start, _buffers[ i ].length ) ) {
-					std::cerr << "Unable to unmap V4L2 buffer " << i + 1 << " of " << _numBuffers << ": "
-							  << strerror( errno ) << std::endl;
-					throw CVTException( "V4L2 munmap failed: " );
+			V4L2BufferPool::Buffer& b = _pool->buffers[ i ];
+
+			if( _bufferType == V4L2BUFFER_USERPTR ) {
+				// page aligned memory owned by us
+				b.length = _imageSize;
+				if( posix_memalign( &b.start, getpagesize( ), b.length ) ) {
+					b.start = MAP_FAILED;
+					throw CVTException( "V4L2 userptr buffer allocation failed" );
 				}
-			}
+			} else {
+				v4l2_buffer buffer = {0};
+				buffer.index = i;
+				buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+				buffer.memory = V4L2_MEMORY_MMAP;
 
-			v4l2_buffer buffer = {0};
-			buffer.index = i;
-			buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			buffer.timestamp.tv_sec = 0;                //get frame as soon as possible
-			buffer.timestamp.tv_usec = 0;
-			buffer.memory = V4L2_MEMORY_MMAP;
+				if( ioctl( _fd, VIDIOC_QUERYBUF, &buffer ) != 0 ) {
+					throw CVTException( "VIDIOC_QUERYBUF failed" );
+				}
 
-			if( ioctl( _fd, VIDIOC_QUERYBUF, &buffer ) != 0 ) {
-				throw CVTException( "VIDIOC_QUERYBUF failed" );
-			}
+				if( 0 == buffer.length ) {
+					throw CVTException( "V4L2 querried buffer length is 0" );
+				}
 
-			if( 0 == buffer.length ) {
-				throw CVTException( "V4L2 querried buffer length is 0" );
-			}
+				// map new buffer
+				b.start = mmap( NULL, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buffer.m.offset );
+				b.length = buffer.length;
 
-			// map new buffer
-			_buffers[ i ].start = mmap( NULL, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buffer.m.offset );
-			_buffers[ i ].length = buffer.length;
+				if( b.start == MAP_FAILED ) {
+					throw CVTException( "V4L2 buffer mmap failed" );
+				}
 
-			if( _buffers[ i ].start == MAP_FAILED ) {
-				throw CVTException( "V4L2 buffer mmap failed" );
+				if( _bufferType == V4L2BUFFER_DMABUF ) {
+					v4l2_exportbuffer expbuf;
+					memset( &expbuf, 0, sizeof( expbuf ) );
+					expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+					expbuf.index = i;
+					expbuf.flags = O_CLOEXEC | O_RDONLY;
+					if( ioctl( _fd, VIDIOC_EXPBUF, &expbuf ) != 0 ) {
+						throw CVTException( "VIDIOC_EXPBUF failed" );
+					}
+					b.dmabuf = expbuf.fd;
+				}
 			}
+
+			// the zero-copy view on the buffer
+			b.view = new Image( _width, _height, _format, static_cast<uint8_t*>( b.start ), _stride );
 		}
 	}
 
 	void V4L2Camera::enqueueBuffers( )
 	{
 		for( unsigned int i = 0; i < _numBuffers; i++ ) {
-			v4l2_buffer buffer = {0};
-			buffer.index = i;
-			buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			buffer.timestamp.tv_sec = 0; //get frame as soon as possible
-			buffer.timestamp.tv_usec = 0;
-			buffer.memory = V4L2_MEMORY_MMAP;
-
-			if( ioctl( _fd, VIDIOC_QBUF, &buffer ) ) {
+			if( !_pool->queue( i ) )
 				throw CVTException( "VIDIOC_QBUF - Unable to queue buffer" );
-			}
 		}
 	}
 
@@ -32,12 +32,61 @@
 
 namespace cvt
 {
+	struct V4L2BufferPool;
+
+	enum V4L2BufferType {
+		V4L2BUFFER_MMAP,	/* driver allocated buffers mapped into the process */
+		V4L2BUFFER_USERPTR,	/* page aligned buffers allocated by the application */
+		V4L2BUFFER_DMABUF	/* driver allocated buffers, additionally exported as dmabuf file descriptors */
+	};
+
+	/**
+	  @brief Lease of a dequeued V4L2 buffer.
+
+	  The image is a view on the driver buffer without any copy. The buffer is
+	  handed back to the driver when the last copy of the lease is released,
+	  holding too many leases starves the capture. Leases stay valid after the
+	  camera is closed, their buffers are unmapped with the last lease.
+	  The driver buffers can not be reallocated while leases are held,
+	  reinitialising the camera throws in this case.
+	 */
+	class V4L2Frame
+	{
+		friend struct V4L2BufferPool;
+
+		public:
+			V4L2Frame();
+			V4L2Frame( const V4L2Frame& other );
+			~V4L2Frame();
+			V4L2Frame& operator=( const V4L2Frame& other );
+
+			bool			valid() const { return _pool != 0; }
+			void			release();
+
+			const Image&	image() const;
+			/* driver sequence number */
+			size_t			sequence() const;
+			/* kernel capture timestamp in seconds ( CLOCK_MONOTONIC for most drivers ) */
+			double			stamp() const;
+			/* CLOCK_MONOTONIC time of VIDIOC_DQBUF, stamp() to dequeueStamp() is the driver latency */
+			double			dequeueStamp() const;
+			/* exported dmabuf file descriptor, -1 if the camera does not use V4L2BUFFER_DMABUF */
+			int				dmabufFd() const;
+
+		private:
+			V4L2Frame( V4L2BufferPool* pool, size_t index );
+
+			V4L2BufferPool*	_pool;
+			size_t			_index;
+	};
 
 	class V4L2Camera : public Camera
 	{
 		public:
 			V4L2Camera( size_t camIndex,
-			const CameraMode & mode );
+			const CameraMode & mode,
+			size_t numBuffers = 4,
+			V4L2BufferType bufferType = V4L2BUFFER_MMAP );
 
 			virtual ~V4L2Camera( );
 
@@ -46,6 +95,8 @@ namespace cvt
 			const IFormat & format( ) const;
 			const Image & frame( ) const;
 			bool  nextFrame( size_t timeout = 30 );
+			/* zero-copy capture, the returned lease keeps the buffer out of the driver queue */
+			bool  nextFrame( V4L2Frame& frame, size_t timeout = 30 );
 			void  startCapture( );
 			void  stopCapture( );
 
@@ -53,6 +104,18 @@ namespace cvt
 			const String&   identifier( ) const { return _identifier; }
 			size_t          frameIndex( ) const { return _frameIdx; }
 			double          stamp( ) const { return _stamp; }
+			double          dequeueStamp( ) const { return _dequeueStamp; }
+
+			/**
+			 * \brief In zero-copy mode frame() is a view on the driver buffer,
+			 *        valid until the next call to nextFrame()
+			 */
+			void            setZeroCopy( bool b ) { _zeroCopy = b; }
+			bool            zeroCopy( ) const { return _zeroCopy; }
+			/* lease of the current frame in zero-copy mode, copy it to keep the buffer */
+			const V4L2Frame& lease( ) const { return _current; }
+			size_t          numBuffers( ) const { return _numBuffers; }
+			V4L2BufferType  bufferType( ) const { return _bufferType; }
 
 			void updateAutoIrisExp( );
 			void setAutoIris( bool b );
@@ -70,16 +133,12 @@ namespace cvt
 			 */
 			static void listDevices( std::vector<String> & devices, bool verbose = false );
 
-			typedef struct buffer {
-				void* start;
-				size_t length;
-			} buffer_t;
-
 		private:
 			size_t _width;
 			size_t _height;
 			size_t _fps;
 			size_t _numBuffers;
+			V4L2BufferType _bufferType;
 			size_t _camIndex;
 			bool   _opened;
 			bool   _capturing;
@@ -88,14 +147,19 @@ namespace cvt
 			// the device file descriptor
 			int _fd;
 
-			// memory buffers for mmap frames
-			buffer_t* _buffers;
+			// driver buffers, shared with the outstanding leases
+			V4L2BufferPool* _pool;
+			size_t  _stride;
+			size_t  _imageSize;
 
 			Image*  _frame;
 			IFormat _format;
+			bool    _zeroCopy;
+			V4L2Frame _current;
 
-			// frame acquisition time
+			// frame acquisition time ( kernel timestamp )
 			double _stamp;
+			double _dequeueStamp;
 			// sequence number of last acquired frame
 			size_t _frameIdx;
 
@@ -127,8 +191,9 @@ namespace cvt
 			void                  open( );
 			void                  close( );
 			void                  init( );
-			void                  queryBuffers( bool unmap = false );
+			void                  queryBuffers( );
 			void                  enqueueBuffers( );
+			bool                  dequeue( size_t& index, size_t timeout );
 			void                  extendedControl( );
 			static void           control( int fd, int field, int value );
 			static const IFormat& formatForV4L2PixFormat( uint32_t pixelformat );
@@ -0,0 +1,97 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/V4L2BufferPool.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	/* pool without a device: every requeue fails */
+	static V4L2BufferPool* _v4l2TestPool( size_t num )
+	{
+		V4L2BufferPool* pool = new V4L2BufferPool( -1, V4L2BUFFER_USERPTR, num );
+		for( size_t i = 0; i < num; i++ ) {
+			V4L2BufferPool::Buffer& b = pool->buffers[ i ];
+			b.length = 16 * 16;
+			b.start = malloc( b.length );
+			memset( b.start, ( int ) i, b.length );
+			b.view = new Image( 16, 16, IFormat::GRAY_UINT8, static_cast<uint8_t*>( b.start ), 16 );
+			b.sequence = i;
+		}
+		return pool;
+	}
+
+BEGIN_CVTTEST( V4L2BufferPool )
+	bool result = true;
+	bool b;
+
+	{
+		V4L2BufferPool* pool = _v4l2TestPool( 3 );
+		V4L2Frame f0 = pool->lease( 0 );
+		V4L2Frame f1 = pool->lease( 1 );
+		V4L2Frame copy( f0 );
+		V4L2Frame assigned;
+		assigned = f1;
+		assigned = assigned;
+
+		b = pool->leased() == 2 && pool->buffers[ 0 ].refs == 2 && pool->buffers[ 1 ].refs == 2 && pool->refs == 5;
+		b &= copy.valid() && copy.sequence() == 0 && assigned.sequence() == 1;
+		b &= copy.image().width() == 16 && copy.dmabufFd() == -1;
+		CVTTEST_PRINT( "refcount", b );
+		result &= b;
+
+		// the failed requeue must not throw from the destructor
+		copy.release();
+		b = !copy.valid() && pool->numLost == 0 && pool->leased() == 2;
+		f0.release();
+		b &= pool->numLost == 1 && pool->buffers[ 0 ].lost && pool->leased() == 1;
+		b &= !pool->requeueLost() && pool->numLost == 1;
+		CVTTEST_PRINT( "lost requeue", b );
+		result &= b;
+
+		// detached pools do not requeue and are deleted with the last lease
+		b = !pool->detach();
+		f1.release();
+		b &= pool->numLost == 1 && pool->refs == 1;
+		b &= assigned.valid() && assigned.image().width() == 16;
+		CVTTEST_PRINT( "detach", b );
+		result &= b;
+		assigned.release();
+		b = !assigned.valid();
+		CVTTEST_PRINT( "delete with last lease", b );
+		result &= b;
+	}
+
+	{
+		V4L2BufferPool* pool = _v4l2TestPool( 2 );
+		b = pool->detach();
+		delete pool;
+		CVTTEST_PRINT( "delete without leases", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
+
+}
@@ -42,6 +42,9 @@ namespace cvt {
 		virtual bool nextFrame( size_t timeOut = 5 ) = 0;
 		
 		virtual const IFormat & format() const = 0;
+
+		/* restart at the first frame, returns false if the input cannot be rewound */
+		virtual bool rewind() { return false; }
 	};
 }
 
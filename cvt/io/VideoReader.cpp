@@ -22,13 +22,17 @@
    THE SOFTWARE.
 */
 
+
 #include <cvt/io/VideoReader.h>
 
 #include <cvt/io/FileSystem.h>
+#include <cvt/gfx/IConvert.h>
 #include <cvt/util/SIMD.h>
 #include <cvt/util/Exception.h>
 
 #include <iostream>
+#include <string.h>
+#include <unistd.h>
 
 extern "C" {
 	#include <libavformat/avformat.h>
@@ -37,16 +41,21 @@ extern "C" {
 
 namespace cvt {
 
-	VideoReader::VideoReader( const String & fileName, bool autoRewind ):
+	VideoReader::VideoReader( const String & fileName, bool autoRewind, VideoReaderOutput output, size_t numThreads, size_t poolSize ):
 		_formatContext( 0 ),
 		_codecContext( 0 ),
 		_avStream( 0 ),
 		_streamIndex( -1 ),
 		_avFrame( 0 ),
-		_frame( 0 ),
+		_pool( 0 ),
+		_poolSize( poolSize < 1 ? 1 : poolSize ),
+		_poolIdx( 0 ),
+		_frameIndex( -1 ),
+		_eof( false ),
 		_width( 0 ),
 		_height( 0 ),
 		_format( IFormat::BGRA_UINT8 ),
+		_output( output ),
 		_autoRewind( autoRewind )
 	{
 		if( !FileSystem::exists( fileName ) ){
@@ -87,6 +96,14 @@ namespace cvt {
 			throw CVTException( "No appropriate codec found" );
 		}
 
+		// decoder threading, has to be set before opening the codec
+		if( numThreads == 0 ) {
+			long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+			numThreads = ncpu > 0 ? ( size_t ) ncpu : 1;
+		}
+		_codecContext->thread_count = ( int ) numThreads;
+		_codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 #if LIBAVCODEC_VERSION_MAJOR == 52
         if( avcodec_open( _codecContext, _codec ) < 0 )
             throw CVTException( "Could not open codec!" );
@@ -98,15 +115,25 @@ namespace cvt {
 		_width = _codecContext->width;
 		_height = _codecContext->height;
 
+		// like the former reader: convert YUV420P only
+		if( _output == VIDEOREADER_OUTPUT_DEFAULT )
+			_output = _codecContext->pix_fmt == PIX_FMT_YUV420P ? VIDEOREADER_OUTPUT_BGRA : VIDEOREADER_OUTPUT_NATIVE;
+
 		updateFormat();
 
 		_avFrame = avcodec_alloc_frame();
+
+		size_t h = _height;
+		if( _output == VIDEOREADER_OUTPUT_NATIVE && _codecContext->pix_fmt == PIX_FMT_YUV420P )
+			h += _height >> 1;
+		_pool = new Image[ _poolSize ];
+		for( size_t i = 0; i < _poolSize; i++ )
+			_pool[ i ].reallocate( _width, h, _format );
 	}
 
 	VideoReader::~VideoReader()
 	{
-		if( _frame )
-			delete _frame;
+		delete[] _pool;
 
 		av_free( _avFrame );
 		avcodec_close( _codecContext );
@@ -119,7 +146,7 @@ namespace cvt {
 
 	void VideoReader::updateFormat()
 	{
-		// alloc frame:
+		// native format of the decoder
 		switch( _codecContext->pix_fmt ){
 			case PIX_FMT_BGRA:
 				_format = IFormat::BGRA_UINT8;
@@ -140,80 +167,203 @@ namespace cvt {
 				_format = IFormat::UYVY_UINT8;
 				break;
 			case PIX_FMT_YUV420P:
-				_format = IFormat::BGRA_UINT8;
+				_format = IFormat::GRAY_UINT8;
 				break;
 			default:
 				std::cout << "Pixelformat:" << (int)_codecContext->pix_fmt << std::endl;
 				throw CVTException( "Cannot map Pixelformat to CVT Format!" );
 		}
+
+		switch( _output ) {
+			case VIDEOREADER_OUTPUT_BGRA: _format = IFormat::BGRA_UINT8; break;
+			case VIDEOREADER_OUTPUT_RGBA: _format = IFormat::RGBA_UINT8; break;
+			case VIDEOREADER_OUTPUT_GRAY: _format = IFormat::GRAY_UINT8; break;
+			case VIDEOREADER_OUTPUT_DEFAULT:
+			case VIDEOREADER_OUTPUT_NATIVE: break;
+		}
 	}
 
 	bool VideoReader::nextFrame( size_t )
 	{
-		int	frameFinished;
+		if( !decodeFrame() ) {
+			if( !_autoRewind || !rewind() || !decodeFrame() )
+				return false;
+		}
+		outputFrame();
+		return true;
+	}
 
+	bool VideoReader::decodeFrame()
+	{
+		int	frameFinished = 0;
 		AVPacket packet;
-		int ret;
-		while( ( ret = av_read_frame( _formatContext, &packet ) ) >= 0 ) {
+
+		while( !_eof ) {
+			if( av_read_frame( _formatContext, &packet ) < 0 ) {
+				_eof = true;
+				break;
+			}
+
 			// Is this a packet from the video stream?
-			if( packet.stream_index == _streamIndex ) {
-				// Decode video frame
+			if( packet.stream_index == _streamIndex )
 				avcodec_decode_video2( _codecContext, _avFrame, &frameFinished, &packet );
 
-				// Did we get a video frame?
-				if(frameFinished) {
-					// decoded a new frame lying in _avFrame
-					if( _codecContext->pix_fmt == PIX_FMT_YUV420P ) {
-						if( !_frame )
-							_frame = new Image( _width, _height, _format );
-
-						SIMD* simd = SIMD::instance();
-
-						uint8_t * dOrig;
-						const uint8_t * src = _avFrame->data[ 0 ];
-						const uint8_t *srcu;
-						const uint8_t *srcv;
-
-						size_t stridedst;
-						uint8_t * dst = _frame->map( &stridedst );
-						dOrig = dst;
-
-						srcu = _avFrame->data[ 1 ];
-						srcv = _avFrame->data[ 2 ];
-
-						size_t n = _height >> 1;
-						while( n-- ) {
-							simd->Conv_YUV420u8_to_BGRAu8( dst, src, srcu, srcv, _width );
-							src += _avFrame->linesize[ 0 ];
-							dst += stridedst;
-							simd->Conv_YUV420u8_to_BGRAu8( dst, src, srcu, srcv, _width );
-							src += _avFrame->linesize[ 0 ];
-							dst += stridedst;
-							srcu += _avFrame->linesize[ 1 ];
-							srcv += _avFrame->linesize[ 2 ];
-						}
-						_frame->unmap( dOrig );
+			// Free the packet that was allocated by av_read_frame
+			av_free_packet( &packet );
+
+			if( frameFinished )
+				return true;
+		}
+
+		// end of file: drain the frames delayed by the decoder ( frame threading, B-frames )
+		av_init_packet( &packet );
+		packet.data = NULL;
+		packet.size = 0;
+		avcodec_decode_video2( _codecContext, _avFrame, &frameFinished, &packet );
+		return frameFinished != 0;
+	}
+
+	static inline void copyPlane( uint8_t* dst, size_t dstride, const uint8_t* src, size_t sstride, size_t bytes, size_t n )
+	{
+		while( n-- ) {
+			memcpy( dst, src, bytes );
+			dst += dstride;
+			src += sstride;
+		}
+	}
+
+	void VideoReader::outputFrame()
+	{
+		// recycle the pool images round robin
+		_poolIdx = ( _poolIdx + 1 ) % _poolSize;
+		_frameIndex++;
+
+		Image& out = _pool[ _poolIdx ];
+		size_t stridedst;
+		uint8_t* dst = out.map( &stridedst );
+
+		if( _codecContext->pix_fmt == PIX_FMT_YUV420P ) {
+			const uint8_t* src = _avFrame->data[ 0 ];
+			const uint8_t* srcu = _avFrame->data[ 1 ];
+			const uint8_t* srcv = _avFrame->data[ 2 ];
+			size_t n = _height >> 1;
+
+			if( _output == VIDEOREADER_OUTPUT_GRAY ) {
+				copyPlane( dst, stridedst, src, _avFrame->linesize[ 0 ], _width, _height );
+			} else if( _output == VIDEOREADER_OUTPUT_NATIVE ) {
+				uint8_t* dstuv = dst + _height * stridedst;
+				copyPlane( dst, stridedst, src, _avFrame->linesize[ 0 ], _width, _height );
+				copyPlane( dstuv, stridedst, srcu, _avFrame->linesize[ 1 ], _width >> 1, n );
+				copyPlane( dstuv + ( _width >> 1 ), stridedst, srcv, _avFrame->linesize[ 2 ], _width >> 1, n );
+			} else {
+				SIMD* simd = SIMD::instance();
+				uint8_t* d = dst;
+				while( n-- ) {
+					if( _output == VIDEOREADER_OUTPUT_RGBA ) {
+						simd->Conv_YUV420u8_to_RGBAu8( d, src, srcu, srcv, _width );
+						simd->Conv_YUV420u8_to_RGBAu8( d + stridedst, src + _avFrame->linesize[ 0 ], srcu, srcv, _width );
 					} else {
-						delete _frame;
-						_frame = new Image( _width, _height, _format, _avFrame->data[ 0 ], _avFrame->linesize[ 0 ] );
+						simd->Conv_YUV420u8_to_BGRAu8( d, src, srcu, srcv, _width );
+						simd->Conv_YUV420u8_to_BGRAu8( d + stridedst, src + _avFrame->linesize[ 0 ], srcu, srcv, _width );
 					}
-					break;
+					src += 2 * _avFrame->linesize[ 0 ];
+					d += 2 * stridedst;
+					srcu += _avFrame->linesize[ 1 ];
+					srcv += _avFrame->linesize[ 2 ];
+				}
+			}
+			out.unmap( dst );
+		} else {
+			if( _output == VIDEOREADER_OUTPUT_NATIVE ) {
+				copyPlane( dst, stridedst, _avFrame->data[ 0 ], _avFrame->linesize[ 0 ], _width * _format.bpp, _height );
+				out.unmap( dst );
+			} else {
+				out.unmap( dst );
+				// packed input in a different format: convert from a view on the decoder buffer
+				IFormat srcFormat = IFormat::BGRA_UINT8;
+				switch( _codecContext->pix_fmt ) {
+					case PIX_FMT_RGBA:		srcFormat = IFormat::RGBA_UINT8; break;
+					case PIX_FMT_GRAY8:		srcFormat = IFormat::GRAY_UINT8; break;
+					case PIX_FMT_GRAY16LE:	srcFormat = IFormat::GRAY_UINT16; break;
+					case PIX_FMT_YUV422P:	srcFormat = IFormat::YUYV_UINT8; break;
+					case PIX_FMT_UYVY422:	srcFormat = IFormat::UYVY_UINT8; break;
+					default: break;
 				}
+				Image view( _width, _height, srcFormat, _avFrame->data[ 0 ], _avFrame->linesize[ 0 ] );
+				IConvert::convert( out, view );
 			}
+		}
+	}
 
-			// Free the packet that was allocated by av_read_frame
-			av_free_packet( &packet );
+	int64_t VideoReader::frameToPts( size_t idx ) const
+	{
+		int64_t pts = av_rescale_q( ( int64_t ) idx, av_inv_q( _avStream->r_frame_rate ), _avStream->time_base );
+		if( _avStream->start_time != ( int64_t ) AV_NOPTS_VALUE )
+			pts += _avStream->start_time;
+		return pts;
+	}
+
+	ssize_t VideoReader::ptsToFrame( int64_t pts ) const
+	{
+		if( _avStream->start_time != ( int64_t ) AV_NOPTS_VALUE )
+			pts -= _avStream->start_time;
+		return ( ssize_t ) av_rescale_q( pts, _avStream->time_base, av_inv_q( _avStream->r_frame_rate ) );
+	}
+
+	bool VideoReader::seek( size_t idx )
+	{
+		int64_t target = frameToPts( idx );
+
+		// go to the keyframe at or before the target
+		if( av_seek_frame( _formatContext, _streamIndex, target, AVSEEK_FLAG_BACKWARD ) < 0 )
+			return false;
+		avcodec_flush_buffers( _codecContext );
+		_eof = false;
+
+		// decode up to the requested frame
+		while( decodeFrame() ) {
+			int64_t pts = _avFrame->best_effort_timestamp;
+			if( pts == ( int64_t ) AV_NOPTS_VALUE )
+				pts = _avFrame->pkt_pts;
+			// the index of the keyframe is unknown without timestamps
+			if( pts == ( int64_t ) AV_NOPTS_VALUE )
+				return seekFromStart( idx );
+			// missing frames ( variable frame rate, drops ): report the frame that was found
+			ssize_t frame = ptsToFrame( pts );
+			if( frame >= ( ssize_t ) idx ) {
+				_frameIndex = frame - 1;
+				outputFrame();
+				return true;
+			}
 		}
-		av_free_packet( &packet );
+		return false;
+	}
+
+	bool VideoReader::seekFromStart( size_t idx )
+	{
+		if( !rewind() )
+			return false;
 
-		if( ret < 0 && _autoRewind )
-			this->rewind();
+		// count the decoded frames
+		for( size_t i = 0; i < idx; i++ ) {
+			if( !decodeFrame() )
+				return false;
+		}
+		if( !decodeFrame() )
+			return false;
+		_frameIndex = ( ssize_t ) idx - 1;
+		outputFrame();
 		return true;
 	}
 
-	void VideoReader::rewind()
+	bool VideoReader::rewind()
 	{
-		av_seek_frame( _formatContext, _streamIndex, 0, AVSEEK_FLAG_BACKWARD );
+		if( av_seek_frame( _formatContext, _streamIndex, 0, AVSEEK_FLAG_BACKWARD ) < 0 )
+			return false;
+		avcodec_flush_buffers( _codecContext );
+		_eof = false;
+		_frameIndex = -1;
+		return true;
 	}
 
 	size_t VideoReader::numFrames() const
@@ -225,4 +375,3 @@ namespace cvt {
 		return ( size_t )_avStream->nb_frames;
 	}
 }
-
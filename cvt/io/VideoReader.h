@@ -22,6 +22,7 @@
    THE SOFTWARE.
 */
 
+
 #ifndef CVT_VIDEO_READER
 #define CVT_VIDEO_READER
 
@@ -29,19 +30,38 @@
 #include <cvt/io/VideoInput.h>
 #include <cvt/gfx/Image.h>
 
+#include <stdint.h>
+#include <sys/types.h>
+
 struct AVFormatContext;
 struct AVCodecContext;
 struct AVStream;
 struct AVCodec;
 struct AVFrame;
-struct AVPacket;
 
 namespace cvt {
 
+	enum VideoReaderOutput {
+		VIDEOREADER_OUTPUT_DEFAULT,	/* BGRA_UINT8 for YUV420P streams, the decoder format otherwise */
+		VIDEOREADER_OUTPUT_BGRA,	/* BGRA_UINT8 */
+		VIDEOREADER_OUTPUT_RGBA,	/* RGBA_UINT8 */
+		VIDEOREADER_OUTPUT_GRAY,	/* GRAY_UINT8, the luma plane for YUV input */
+		/* decoder layout without conversion, YUV420P is stored as GRAY_UINT8 image
+		   of height * 3 / 2 rows: the Y plane followed by the U and V planes side by side */
+		VIDEOREADER_OUTPUT_NATIVE
+	};
+
 	class VideoReader : public VideoInput
 	{
 		public:
-			VideoReader( const String & fileName, bool autoRewind = true );
+			/**
+			  @param output		the requested output format, converted directly from the decoder planes
+			  @param numThreads	decoder threads ( frame and slice threading ), 0 uses all cores
+			  @param poolSize	number of recycled output images, a frame stays valid during
+								the following poolSize - 1 calls to nextFrame()
+			 */
+			VideoReader( const String & fileName, bool autoRewind = true, VideoReaderOutput output = VIDEOREADER_OUTPUT_DEFAULT,
+						 size_t numThreads = 0, size_t poolSize = 2 );
 			~VideoReader();
 
 			size_t  width() const;
@@ -50,25 +70,48 @@ namespace cvt {
 			const   Image & frame() const;
 			bool    nextFrame( size_t timeout = 0 );
 			size_t	numFrames() const;
+			bool	rewind();
+
+			/* index of the current frame, -1 before the first frame */
+			ssize_t	frameIndex() const;
+
+			/**
+			  @brief Decode frame idx: seeks to the preceding keyframe and decodes up to idx.
+			  Streams without timestamps are decoded from the start.
+			  On success frame() holds frame idx and nextFrame() continues with idx + 1.
+			  If the stream has no frame at the timestamp of idx, the following frame
+			  is returned and frameIndex() reports its index.
+			 */
+			bool	seek( size_t idx );
 
 		private:
+			VideoReader( const VideoReader& );
+
 			AVFormatContext *	_formatContext;
 			AVCodecContext *	_codecContext;
 			AVStream *			_avStream;
 			AVCodec *			_codec;
 			int					_streamIndex;
 			AVFrame *			_avFrame;
-			Image *				_frame;
-			AVPacket *			_packet;
-			uint8_t *			_inBuffer;
+
+			Image *				_pool;
+			size_t				_poolSize;
+			size_t				_poolIdx;
+			ssize_t				_frameIndex;
+			bool				_eof;
 
 			size_t				_width;
 			size_t				_height;
 			IFormat				_format;
+			VideoReaderOutput	_output;
 			bool				_autoRewind;
 
-			void updateFormat();
-			void rewind();
+			void	updateFormat();
+			bool	decodeFrame();
+			void	outputFrame();
+			int64_t	frameToPts( size_t idx ) const;
+			ssize_t	ptsToFrame( int64_t pts ) const;
+			bool	seekFromStart( size_t idx );
 	};
 
 	inline size_t VideoReader::width() const
@@ -83,7 +126,7 @@ namespace cvt {
 
 	inline const Image & VideoReader::frame() const
 	{
-		return *_frame;
+		return _pool[ _poolIdx ];
 	}
 
 	inline const IFormat & VideoReader::format() const
@@ -91,6 +134,11 @@ namespace cvt {
 		return _format;
 	}
 
+	inline ssize_t VideoReader::frameIndex() const
+	{
+		return _frameIndex;
+	}
+
 }
 
 #endif
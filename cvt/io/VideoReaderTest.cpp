@@ -0,0 +1,328 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/io/VideoReader.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/Math.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+	#include <libavformat/avformat.h>
+	#include <libavcodec/avcodec.h>
+}
+
+namespace cvt {
+
+	static const size_t _vrWidth = 32;
+	static const size_t _vrHeight = 16;
+	static const size_t _vrFrames = 20;
+
+	static inline uint8_t _vrLuma( size_t frame, size_t x, size_t y )
+	{
+		return ( uint8_t ) ( 16 + frame * 8 + ( ( x + y ) & 3 ) );
+	}
+
+	/* uncompressed YUV4MPEG2 file, every frame has its own luma pattern */
+	static bool _vrWriteY4M( const String& file, bool mono )
+	{
+		FILE* f = fopen( file.c_str(), "wb" );
+		if( !f )
+			return false;
+		fprintf( f, "YUV4MPEG2 W%d H%d F25:1 Ip A1:1 %s\n", ( int ) _vrWidth, ( int ) _vrHeight, mono ? "Cmono" : "C420jpeg" );
+		std::vector<uint8_t> chroma( ( _vrWidth / 2 ) * ( _vrHeight / 2 ), 128 );
+		for( size_t i = 0; i < _vrFrames; i++ ) {
+			fprintf( f, "FRAME\n" );
+			for( size_t y = 0; y < _vrHeight; y++ )
+				for( size_t x = 0; x < _vrWidth; x++ )
+					fputc( _vrLuma( i, x, y ), f );
+			if( !mono ) {
+				fwrite( &chroma[ 0 ], 1, chroma.size(), f );
+				fwrite( &chroma[ 0 ], 1, chroma.size(), f );
+			}
+		}
+		fclose( f );
+		return true;
+	}
+
+	/* MPEG-4 in NUT with a keyframe every 5 frames, the frame dropped is left out */
+	static bool _vrWriteMPEG4( const String& file, size_t dropped )
+	{
+		av_register_all();
+		AVFormatContext* oc = NULL;
+		AVCodec* codec = avcodec_find_encoder( CODEC_ID_MPEG4 );
+		if( !codec || avformat_alloc_output_context2( &oc, NULL, "nut", file.c_str() ) < 0 )
+			return false;
+
+		AVStream* st = avformat_new_stream( oc, codec );
+		AVCodecContext* c = st->codec;
+		c->width = _vrWidth;
+		c->height = _vrHeight;
+		c->pix_fmt = PIX_FMT_YUV420P;
+		c->time_base.num = 1;
+		c->time_base.den = 25;
+		c->gop_size = 5;
+		c->max_b_frames = 0;
+		c->flags |= CODEC_FLAG_QSCALE;
+		c->global_quality = FF_QP2LAMBDA * 2;
+		if( oc->oformat->flags & AVFMT_GLOBALHEADER )
+			c->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+		bool ok = avcodec_open2( c, codec, NULL ) >= 0 &&
+				  avio_open( &oc->pb, file.c_str(), AVIO_FLAG_WRITE ) >= 0;
+		if( ok )
+			ok = avformat_write_header( oc, NULL ) >= 0;
+
+		AVFrame* frame = avcodec_alloc_frame();
+		avpicture_alloc( ( AVPicture* ) frame, PIX_FMT_YUV420P, _vrWidth, _vrHeight );
+		for( size_t i = 0; ok && i <= _vrFrames; i++ ) {
+			if( i == dropped )
+				continue;
+			/* the last call flushes the encoder */
+			AVFrame* in = NULL;
+			if( i < _vrFrames ) {
+				for( size_t y = 0; y < _vrHeight; y++ )
+					for( size_t x = 0; x < _vrWidth; x++ )
+						frame->data[ 0 ][ y * frame->linesize[ 0 ] + x ] = _vrLuma( i, x, y );
+				for( size_t y = 0; y < _vrHeight / 2; y++ ) {
+					memset( frame->data[ 1 ] + y * frame->linesize[ 1 ], 128, _vrWidth / 2 );
+					memset( frame->data[ 2 ] + y * frame->linesize[ 2 ], 128, _vrWidth / 2 );
+				}
+				frame->pts = i;
+				in = frame;
+			}
+
+			int got;
+			do {
+				AVPacket pkt;
+				av_init_packet( &pkt );
+				pkt.data = NULL;
+				pkt.size = 0;
+				got = 0;
+				if( avcodec_encode_video2( c, &pkt, in, &got ) < 0 ) {
+					ok = false;
+					break;
+				}
+				if( got ) {
+					if( pkt.pts != ( int64_t ) AV_NOPTS_VALUE )
+						pkt.pts = av_rescale_q( pkt.pts, c->time_base, st->time_base );
+					if( pkt.dts != ( int64_t ) AV_NOPTS_VALUE )
+						pkt.dts = av_rescale_q( pkt.dts, c->time_base, st->time_base );
+					pkt.stream_index = st->index;
+					ok &= av_interleaved_write_frame( oc, &pkt ) >= 0;
+				}
+			} while( got && !in );
+		}
+		if( ok )
+			ok = av_write_trailer( oc ) >= 0;
+
+		avpicture_free( ( AVPicture* ) frame );
+		av_free( frame );
+		avcodec_close( c );
+		if( oc->pb )
+			avio_close( oc->pb );
+		avformat_free_context( oc );
+		return ok;
+	}
+
+	/* lossy frames: compare the mean luma, frames differ by 8 */
+	static bool _vrCheckMean( const Image& img, size_t frame )
+	{
+		IMapScoped<const uint8_t> map( img );
+		float sum = 0.0f;
+		for( size_t y = 0; y < _vrHeight; y++ ) {
+			const uint8_t* ptr = map.ptr();
+			for( size_t x = 0; x < _vrWidth; x++ )
+				sum += ptr[ x ];
+			map++;
+		}
+		float expected = 16.0f + frame * 8.0f + 1.5f;
+		return Math::abs( sum / ( float ) ( _vrWidth * _vrHeight ) - expected ) < 3.0f;
+	}
+
+	/* checks the luma plane or the gray BGRA/RGBA pixels of frame */
+	static bool _vrCheck( const Image& img, size_t frame )
+	{
+		IMapScoped<const uint8_t> map( img );
+		size_t bpp = img.bpp();
+		for( size_t y = 0; y < _vrHeight; y++ ) {
+			const uint8_t* ptr = map.ptr();
+			for( size_t x = 0; x < _vrWidth; x++ ) {
+				int v = _vrLuma( frame, x, y );
+				if( bpp == 1 ) {
+					if( ptr[ x ] != v )
+						return false;
+				} else {
+					// neutral chroma: gray with a tolerance for the range conversion
+					const uint8_t* px = ptr + x * bpp;
+					if( px[ 0 ] != px[ 1 ] || px[ 1 ] != px[ 2 ] || px[ 3 ] != 255 || Math::abs( ( int ) px[ 0 ] - v ) > 20 )
+						return false;
+				}
+			}
+			map++;
+		}
+		return true;
+	}
+
+	static bool _vrCheckChroma( const Image& img )
+	{
+		// native YUV420P: U and V planes side by side below the luma
+		IMapScoped<const uint8_t> map( img );
+		map.setLine( _vrHeight );
+		for( size_t y = 0; y < _vrHeight / 2; y++ ) {
+			const uint8_t* ptr = map.ptr();
+			for( size_t x = 0; x < _vrWidth; x++ )
+				if( ptr[ x ] != 128 )
+					return false;
+			map++;
+		}
+		return true;
+	}
+
+	static bool _vrTestSequence( VideoReader& reader )
+	{
+		bool b = true;
+		for( size_t i = 0; i < _vrFrames; i++ ) {
+			b &= reader.nextFrame() && reader.frameIndex() == ( ssize_t ) i && _vrCheck( reader.frame(), i );
+		}
+		return b;
+	}
+
+	static bool _vrTestSeek( VideoReader& reader )
+	{
+		bool b = true;
+		b &= reader.seek( 13 ) && reader.frameIndex() == 13 && _vrCheck( reader.frame(), 13 );
+		b &= reader.nextFrame() && reader.frameIndex() == 14 && _vrCheck( reader.frame(), 14 );
+		b &= reader.seek( 3 ) && reader.frameIndex() == 3 && _vrCheck( reader.frame(), 3 );
+		b &= reader.seek( 0 ) && reader.frameIndex() == 0 && _vrCheck( reader.frame(), 0 );
+		b &= reader.nextFrame() && _vrCheck( reader.frame(), 1 );
+		b &= !reader.seek( _vrFrames + 5 );
+		return b;
+	}
+
+	/* inter coded stream, the missing frame is replaced by the next one */
+	static bool _vrTestSeekInter( VideoReader& reader, size_t dropped )
+	{
+		bool b = true;
+		b &= reader.seek( 7 ) && reader.frameIndex() == 7 && _vrCheckMean( reader.frame(), 7 );
+		b &= reader.nextFrame() && reader.frameIndex() == 8 && _vrCheckMean( reader.frame(), 8 );
+		b &= reader.seek( 13 ) && reader.frameIndex() == 13 && _vrCheckMean( reader.frame(), 13 );
+		b &= reader.seek( 2 ) && reader.frameIndex() == 2 && _vrCheckMean( reader.frame(), 2 );
+		b &= reader.seek( dropped ) && reader.frameIndex() == ( ssize_t ) dropped + 1 &&
+			 _vrCheckMean( reader.frame(), dropped + 1 );
+		b &= reader.nextFrame() && reader.frameIndex() == ( ssize_t ) dropped + 2 &&
+			 _vrCheckMean( reader.frame(), dropped + 2 );
+		return b;
+	}
+
+BEGIN_CVTTEST( VideoReader )
+	bool result = true;
+	bool b;
+	String yuvFile( "/tmp/cvt_videoreader_test.y4m" );
+	String monoFile( "/tmp/cvt_videoreader_test_mono.y4m" );
+	String interFile( "/tmp/cvt_videoreader_test.nut" );
+	const size_t dropped = 12;
+
+	if( !_vrWriteY4M( yuvFile, false ) || !_vrWriteY4M( monoFile, true ) || !_vrWriteMPEG4( interFile, dropped ) ) {
+		CVTTEST_PRINT( "write test video", false );
+		return false;
+	}
+
+	try {
+		{
+			// YUV420P defaults to BGRA
+			VideoReader reader( yuvFile, false );
+			b = reader.format() == IFormat::BGRA_UINT8 && reader.width() == _vrWidth && reader.height() == _vrHeight;
+			b &= _vrTestSequence( reader );
+			b &= !reader.nextFrame();
+			CVTTEST_PRINT( "default output YUV420P", b );
+			result &= b;
+		}
+
+		{
+			// other streams keep the decoder format by default
+			VideoReader reader( monoFile, false );
+			b = reader.format() == IFormat::GRAY_UINT8 && _vrTestSequence( reader );
+			CVTTEST_PRINT( "default output GRAY8", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( yuvFile, false, VIDEOREADER_OUTPUT_RGBA );
+			b = reader.format() == IFormat::RGBA_UINT8 && _vrTestSequence( reader );
+			CVTTEST_PRINT( "RGBA output", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( yuvFile, false, VIDEOREADER_OUTPUT_GRAY );
+			b = reader.format() == IFormat::GRAY_UINT8 && _vrTestSequence( reader );
+			CVTTEST_PRINT( "GRAY output", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( yuvFile, false, VIDEOREADER_OUTPUT_NATIVE );
+			b = reader.format() == IFormat::GRAY_UINT8 && reader.frame().height() == _vrHeight * 3 / 2;
+			b &= reader.nextFrame() && _vrCheck( reader.frame(), 0 ) && _vrCheckChroma( reader.frame() );
+			CVTTEST_PRINT( "native output", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( yuvFile, false, VIDEOREADER_OUTPUT_GRAY );
+			b = _vrTestSeek( reader );
+			CVTTEST_PRINT( "seek", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( interFile, false, VIDEOREADER_OUTPUT_GRAY );
+			b = _vrTestSeekInter( reader, dropped );
+			CVTTEST_PRINT( "seek to non-keyframes", b );
+			result &= b;
+		}
+
+		{
+			VideoReader reader( yuvFile, true, VIDEOREADER_OUTPUT_GRAY );
+			b = _vrTestSequence( reader );
+			b &= reader.nextFrame() && reader.frameIndex() == 0 && _vrCheck( reader.frame(), 0 );
+			CVTTEST_PRINT( "auto rewind", b );
+			result &= b;
+		}
+	} catch( const Exception& e ) {
+		CVTTEST_PRINT( e.what(), false );
+		result = false;
+	}
+
+	unlink( yuvFile.c_str() );
+	unlink( monoFile.c_str() );
+	unlink( interFile.c_str() );
+	return result;
+END_CVTTEST
+
+}
@@ -0,0 +1,147 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_XMLARENA_H
+#define CVT_XMLARENA_H
+
+#include <cvt/util/Exception.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  \ingroup XML
+	  Bump allocator for the nodes of an XMLArenaDocument.
+	  Memory is handed out from large blocks and only released as a whole
+	  by clear() or the destructor - no destructors are run for the allocated objects.
+	*/
+	class XMLArena {
+		public:
+			XMLArena( size_t blockSize = 64 * 1024 );
+			~XMLArena();
+
+			void*	alloc( size_t size );
+			template<typename T>
+			T*		alloc( size_t n = 1 );
+
+			void	clear();
+			size_t	size() const;
+
+		private:
+			XMLArena( const XMLArena& );
+			XMLArena& operator=( const XMLArena& );
+
+			struct Block {
+				Block*	next;
+				size_t	size;
+			};
+
+			void*	allocBlock( size_t size );
+
+			Block*	_blocks;
+			uint8_t* _ptr;
+			uint8_t* _end;
+			size_t	_blockSize;
+			size_t	_size;
+	};
+
+	inline XMLArena::XMLArena( size_t blockSize ) :
+		_blocks( NULL ),
+		_ptr( NULL ),
+		_end( NULL ),
+		_blockSize( blockSize ),
+		_size( 0 )
+	{
+	}
+
+	inline XMLArena::~XMLArena()
+	{
+		clear();
+	}
+
+	inline void* XMLArena::alloc( size_t size )
+	{
+		size = ( size + 7 ) & ~( ( size_t ) 7 );
+		if( ( size_t ) ( _end - _ptr ) < size )
+			return allocBlock( size );
+		void* ret = _ptr;
+		_ptr += size;
+		return ret;
+	}
+
+	template<typename T>
+	inline T* XMLArena::alloc( size_t n )
+	{
+		return ( T* ) alloc( sizeof( T ) * n );
+	}
+
+	inline void* XMLArena::allocBlock( size_t size )
+	{
+		size_t header = ( sizeof( Block ) + 7 ) & ~( ( size_t ) 7 );
+		/* oversized requests get their own block, the current block stays active */
+		bool large = size > _blockSize / 4;
+		size_t bsize = header + ( large ? size : _blockSize );
+
+		Block* block = ( Block* ) malloc( bsize );
+		if( !block )
+			throw CVTException( "XMLArena: out of memory" );
+		block->size = bsize;
+		_size += bsize;
+
+		uint8_t* data = ( uint8_t* ) block + header;
+		if( large && _blocks ) {
+			block->next = _blocks->next;
+			_blocks->next = block;
+			return data;
+		}
+		block->next = _blocks;
+		_blocks = block;
+		_ptr = data + size;
+		_end = ( uint8_t* ) block + bsize;
+		return data;
+	}
+
+	inline void XMLArena::clear()
+	{
+		while( _blocks ) {
+			Block* next = _blocks->next;
+			free( _blocks );
+			_blocks = next;
+		}
+		_ptr = _end = NULL;
+		_size = 0;
+	}
+
+	/**
+	  Bytes currently reserved by the arena
+	*/
+	inline size_t XMLArena::size() const
+	{
+		return _size;
+	}
+}
+
+#endif
@@ -0,0 +1,284 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/xml/XMLArenaDocument.h>
+#include <cvt/io/xml/XMLSAXParser.h>
+#include <new>
+
+namespace cvt {
+
+	/* elements with more children get a hash table for childByName */
+	static const size_t XMLARENA_INDEX_THRESHOLD = 8;
+
+	XMLArenaNode::XMLArenaNode() :
+		_type( XML_NODE_ELEMENT ),
+		_hash( 0 ),
+		_parent( NULL ),
+		_nextByName( NULL )
+	{
+	}
+
+	XMLArenaElement::XMLArenaElement() :
+		_children( NULL ),
+		_table( NULL ),
+		_childSize( 0 ),
+		_tableMask( 0 )
+	{
+	}
+
+	/**
+	  The text content of an element or the value of all other nodes.
+	  For elements with mixed content the first text or CDATA section is returned.
+	*/
+	XMLStringView XMLArenaNode::text() const
+	{
+		if( _type != XML_NODE_ELEMENT || !_value.isEmpty() )
+			return _value;
+
+		const XMLArenaElement* e = ( const XMLArenaElement* ) this;
+		for( size_t i = 0; i < e->_childSize; i++ ) {
+			if( e->_children[ i ]->_type == XML_NODE_TEXT )
+				return e->_children[ i ]->_value;
+		}
+		return XMLStringView();
+	}
+
+	const XMLArenaNode* XMLArenaNode::lookup( const char* name, size_t len ) const
+	{
+		if( _type != XML_NODE_ELEMENT )
+			return NULL;
+
+		const XMLArenaElement* e = ( const XMLArenaElement* ) this;
+		uint32_t h = XMLStringView::hash( name, len );
+		XMLStringView key( name, len );
+
+		if( e->_table ) {
+			for( uint32_t i = h & e->_tableMask; e->_table[ i ]; i = ( i + 1 ) & e->_tableMask ) {
+				if( e->_table[ i ]->_hash == h && e->_table[ i ]->_name == key )
+					return e->_table[ i ];
+			}
+			return NULL;
+		}
+
+		for( size_t i = 0; i < e->_childSize; i++ ) {
+			if( e->_children[ i ]->_hash == h && e->_children[ i ]->_name == key )
+				return e->_children[ i ];
+		}
+		return NULL;
+	}
+
+	class XMLArenaDocument::Builder : public XMLSAXHandler {
+		public:
+			Builder( XMLArenaDocument& doc ) : _doc( doc )
+			{
+			}
+
+			void startElement( const XMLStringView& name, const XMLSAXAttribute* attributes, size_t numAttributes )
+			{
+				XMLArenaElement* node = new( _doc._arena.alloc<XMLArenaElement>() ) XMLArenaElement();
+				init( node, XML_NODE_ELEMENT, name, XMLStringView() );
+				append( node );
+				_open.push_back( node );
+				_start.push_back( _pending.size() );
+				for( size_t i = 0; i < numAttributes; i++ ) {
+					XMLArenaNode* attr = newNode( XML_NODE_ATTRIBUTE, attributes[ i ].name, attributes[ i ].value );
+					attr->_parent = node;
+					_pending.push_back( attr );
+				}
+				_content.push_back( _pending.size() );
+				_inlineText.push_back( false );
+			}
+
+			void endElement( const XMLStringView& )
+			{
+				XMLArenaElement* node = _open.back();
+				size_t start = _start.back();
+				if( _pending.size() > start )
+					finish( node, &_pending[ start ], _pending.size() - start );
+				_pending.resize( start );
+				_open.pop_back();
+				_start.pop_back();
+				_content.pop_back();
+				_inlineText.pop_back();
+			}
+
+			void text( const XMLStringView& text )
+			{
+				/* the first text of an element is kept inline until more content follows */
+				if( !_open.empty() && _pending.size() == _content.back() && !_inlineText.back() ) {
+					_open.back()->_value = text;
+					_inlineText.back() = true;
+					return;
+				}
+				append( newNode( XML_NODE_TEXT, XMLStringView(), text ) );
+			}
+
+			void comment( const XMLStringView& comment )
+			{
+				append( newNode( XML_NODE_COMMENT, XMLStringView(), comment ) );
+			}
+
+		private:
+			void init( XMLArenaNode* node, XMLNodeType type, const XMLStringView& name, const XMLStringView& value )
+			{
+				node->_type = type;
+				node->_name = name;
+				node->_hash = name.hash();
+				node->_value = value;
+			}
+
+			XMLArenaNode* newNode( XMLNodeType type, const XMLStringView& name, const XMLStringView& value )
+			{
+				XMLArenaNode* node = new( _doc._arena.alloc<XMLArenaNode>() ) XMLArenaNode();
+				init( node, type, name, value );
+				return node;
+			}
+
+			void append( XMLArenaNode* node )
+			{
+				if( _open.empty() ) {
+					_doc._nodes.push_back( node );
+					return;
+				}
+
+				XMLArenaElement* parent = _open.back();
+				if( _inlineText.back() ) {
+					/* mixed content - move the inline text into a child of its own */
+					XMLArenaNode* text = newNode( XML_NODE_TEXT, XMLStringView(), parent->_value );
+					text->_parent = parent;
+					_pending.push_back( text );
+					parent->_value = XMLStringView();
+					_inlineText.back() = false;
+				}
+				node->_parent = parent;
+				_pending.push_back( node );
+			}
+
+			void finish( XMLArenaElement* node, XMLArenaNode** children, size_t n )
+			{
+				node->_childSize = n;
+				node->_children = _doc._arena.alloc<const XMLArenaNode*>( n );
+				for( size_t i = 0; i < n; i++ )
+					node->_children[ i ] = children[ i ];
+
+				if( n <= XMLARENA_INDEX_THRESHOLD ) {
+					for( size_t i = 1; i < n; i++ ) {
+						if( children[ i ]->_name.isEmpty() )
+							continue;
+						for( size_t k = i; k-- > 0; ) {
+							if( children[ k ]->_hash == children[ i ]->_hash && children[ k ]->_name == children[ i ]->_name ) {
+								children[ k ]->_nextByName = children[ i ];
+								break;
+							}
+						}
+					}
+					return;
+				}
+
+				size_t size = 16;
+				while( size < 2 * n )
+					size <<= 1;
+				uint32_t mask = size - 1;
+				const XMLArenaNode** table = _doc._arena.alloc<const XMLArenaNode*>( size );
+				memset( table, 0, sizeof( const XMLArenaNode* ) * size );
+				_last.assign( size, NULL );
+
+				for( size_t i = 0; i < n; i++ ) {
+					XMLArenaNode* c = children[ i ];
+					if( c->_name.isEmpty() )
+						continue;
+					uint32_t k = c->_hash & mask;
+					while( table[ k ] && !( table[ k ]->_hash == c->_hash && table[ k ]->_name == c->_name ) )
+						k = ( k + 1 ) & mask;
+					if( table[ k ] )
+						_last[ k ]->_nextByName = c;
+					else
+						table[ k ] = c;
+					_last[ k ] = c;
+				}
+				node->_table = table;
+				node->_tableMask = mask;
+			}
+
+			XMLArenaDocument&			  _doc;
+			std::vector<XMLArenaElement*> _open;
+			std::vector<size_t>			  _start;
+			std::vector<size_t>			  _content;
+			std::vector<bool>			  _inlineText;
+			std::vector<XMLArenaNode*>	  _pending;
+			std::vector<XMLArenaNode*>	  _last;
+	};
+
+	XMLArenaDocument::XMLArenaDocument() : _arena( 256 * 1024 ), _file( NULL )
+	{
+	}
+
+	XMLArenaDocument::~XMLArenaDocument()
+	{
+		clear();
+	}
+
+	void XMLArenaDocument::clear()
+	{
+		_nodes.clear();
+		_arena.clear();
+		delete _file;
+		_file = NULL;
+	}
+
+	void XMLArenaDocument::load( const char* buffer, size_t len )
+	{
+		clear();
+		try {
+			Builder builder( *this );
+			XMLSAXParser parser;
+			parser.parse( builder, buffer, len );
+		} catch( ... ) {
+			clear();
+			throw;
+		}
+	}
+
+	void XMLArenaDocument::load( const String& path )
+	{
+		XMLMappedFile* file = new XMLMappedFile( path );
+		try {
+			load( file->ptr(), file->size() );
+		} catch( ... ) {
+			delete file;
+			throw;
+		}
+		_file = file;
+	}
+
+	const XMLArenaNode* XMLArenaDocument::nodeByName( const String& name ) const
+	{
+		for( size_t i = 0; i < _nodes.size(); i++ ) {
+			if( _nodes[ i ]->_name == name )
+				return _nodes[ i ];
+		}
+		return NULL;
+	}
+}
@@ -0,0 +1,209 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_XMLARENADOCUMENT_H
+#define CVT_XMLARENADOCUMENT_H
+
+#include <cvt/io/xml/XMLNode.h>
+#include <cvt/io/xml/XMLArena.h>
+#include <cvt/io/xml/XMLStringView.h>
+#include <vector>
+
+namespace cvt {
+
+	class XMLMappedFile;
+	class XMLArenaDocument;
+
+	/**
+	  \ingroup XML
+	  Read-only node of an XMLArenaDocument.
+	  Like XMLElement, attributes are children of type XML_NODE_ATTRIBUTE
+	  in front of the element content.
+	  Text and comment nodes have an empty name.
+	  The content of an element holding nothing but a single text or CDATA section
+	  is stored as the value of the element instead of a text child.
+	*/
+	class XMLArenaNode {
+		friend class XMLArenaDocument;
+
+		public:
+			XMLNodeType			 type() const;
+			const XMLStringView& name() const;
+			const XMLStringView& value() const;
+			XMLStringView		 text() const;
+			const XMLArenaNode*	 parent() const;
+
+			size_t				 childSize() const;
+			const XMLArenaNode*	 child( size_t index ) const;
+			const XMLArenaNode*	 childByName( const char* name ) const;
+			const XMLArenaNode*	 childByName( const String& name ) const;
+			const XMLArenaNode*	 childByName( const XMLStringView& name ) const;
+			const XMLArenaNode*	 nextByName() const;
+
+		protected:
+			XMLArenaNode();
+
+		private:
+			XMLArenaNode( const XMLArenaNode& );
+			XMLArenaNode& operator=( const XMLArenaNode& );
+
+			const XMLArenaNode*	 lookup( const char* name, size_t len ) const;
+
+			XMLNodeType			 _type;
+			uint32_t			 _hash;
+			XMLStringView		 _name;
+			XMLStringView		 _value;
+			const XMLArenaNode*	 _parent;
+			const XMLArenaNode*	 _nextByName;
+	};
+
+	/* attributes, text and comments are allocated without the child bookkeeping */
+	class XMLArenaElement : public XMLArenaNode {
+		friend class XMLArenaNode;
+		friend class XMLArenaDocument;
+
+		private:
+			XMLArenaElement();
+
+			const XMLArenaNode** _children;
+			/* open addressing table of the first child per name, only for large elements */
+			const XMLArenaNode** _table;
+			uint32_t			 _childSize;
+			uint32_t			 _tableMask;
+	};
+
+	/**
+	  \ingroup XML
+	  Compact, read-only DOM.
+	  All nodes live in one arena owned by the document. Names and values
+	  reference the parsed buffer directly, entities are only resolved when
+	  a value is converted with XMLStringView::string().
+	  Children of large elements are indexed by name.
+	  For documents too large to hold even this DOM, use the XMLSAXParser.
+	*/
+	class XMLArenaDocument {
+		public:
+			XMLArenaDocument();
+			~XMLArenaDocument();
+
+			/* the buffer is not copied and has to outlive the document */
+			void load( const char* buffer, size_t len );
+			/* maps the file, no copy is made */
+			void load( const String& path );
+			void clear();
+
+			size_t				nodeSize() const;
+			const XMLArenaNode* node( size_t index ) const;
+			const XMLArenaNode* nodeByName( const String& name ) const;
+
+			size_t				memoryUsage() const;
+
+		private:
+			XMLArenaDocument( const XMLArenaDocument& );
+			XMLArenaDocument& operator=( const XMLArenaDocument& );
+
+			class Builder;
+
+			XMLArena						 _arena;
+			XMLMappedFile*					 _file;
+			std::vector<const XMLArenaNode*> _nodes;
+	};
+
+	inline XMLNodeType XMLArenaNode::type() const
+	{
+		return _type;
+	}
+
+	inline const XMLStringView& XMLArenaNode::name() const
+	{
+		return _name;
+	}
+
+	inline const XMLStringView& XMLArenaNode::value() const
+	{
+		return _value;
+	}
+
+	inline const XMLArenaNode* XMLArenaNode::parent() const
+	{
+		return _parent;
+	}
+
+	inline size_t XMLArenaNode::childSize() const
+	{
+		if( _type != XML_NODE_ELEMENT )
+			return 0;
+		return ( ( const XMLArenaElement* ) this )->_childSize;
+	}
+
+	inline const XMLArenaNode* XMLArenaNode::child( size_t index ) const
+	{
+		CVT_ASSERT( index < childSize(), "Out of bounds!" );
+		return ( ( const XMLArenaElement* ) this )->_children[ index ];
+	}
+
+	inline const XMLArenaNode* XMLArenaNode::childByName( const char* name ) const
+	{
+		return lookup( name, strlen( name ) );
+	}
+
+	inline const XMLArenaNode* XMLArenaNode::childByName( const String& name ) const
+	{
+		return lookup( name.c_str(), name.length() );
+	}
+
+	inline const XMLArenaNode* XMLArenaNode::childByName( const XMLStringView& name ) const
+	{
+		return lookup( name.ptr(), name.length() );
+	}
+
+	/**
+	  The next sibling with the same name
+	*/
+	inline const XMLArenaNode* XMLArenaNode::nextByName() const
+	{
+		return _nextByName;
+	}
+
+	inline size_t XMLArenaDocument::nodeSize() const
+	{
+		return _nodes.size();
+	}
+
+	inline const XMLArenaNode* XMLArenaDocument::node( size_t index ) const
+	{
+		return _nodes[ index ];
+	}
+
+	/**
+	  Bytes allocated for the nodes, the parsed buffer is not included
+	*/
+	inline size_t XMLArenaDocument::memoryUsage() const
+	{
+		return _arena.size();
+	}
+}
+
+#endif
@@ -0,0 +1,250 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/xml/XMLArenaDocument.h>
+#include <cvt/io/xml/XMLSAXParser.h>
+#include <cvt/io/xml/XMLDocument.h>
+#include <cvt/io/xml/XMLElement.h>
+#include <cvt/io/xml/XMLAttribute.h>
+#include <cvt/io/xml/XMLText.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	static const char* _xmlSample =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<!DOCTYPE config [ <!ENTITY unused \"x\"> ]>\n"
+		"<!-- top level comment -->\n"
+		"<config version='2' name=\"a &amp; b\">\n"
+		"  <camera id=\"0\"><fx>500.5</fx><fy>&#x35;01</fy></camera>\n"
+		"  <camera id=\"1\"/>\n"
+		"  <note>x &lt; y &#8364;</note>\n"
+		"  <raw><![CDATA[<b>&amp;</b>]]></raw>\n"
+		"  <mixed>a<b/>c</mixed>\n"
+		"</config>\n";
+
+	static bool _testStructure()
+	{
+		XMLArenaDocument doc;
+		doc.load( _xmlSample, strlen( _xmlSample ) );
+
+		bool ret = doc.nodeSize() == 2 && doc.node( 0 )->type() == XML_NODE_COMMENT;
+		const XMLArenaNode* config = doc.nodeByName( "config" );
+		if( !config )
+			return false;
+
+		/* 2 attributes + 5 elements */
+		ret &= config->childSize() == 7;
+		ret &= config->childByName( "version" )->type() == XML_NODE_ATTRIBUTE;
+		ret &= config->childByName( "version" )->value().toInteger() == 2;
+		ret &= config->childByName( "name" )->value().hasReferences();
+		ret &= config->childByName( "name" )->value().string() == "a & b";
+
+		const XMLArenaNode* cam = config->childByName( "camera" );
+		ret &= cam->childByName( "id" )->value() == "0";
+		ret &= cam->childByName( "fx" )->text().toDouble() == 500.5;
+		ret &= cam->childByName( "fy" )->text().toInteger() == 501;
+		ret &= cam->childByName( "fx" )->parent() == cam;
+		ret &= cam->nextByName() != NULL && cam->nextByName()->childByName( "id" )->value() == "1";
+		ret &= cam->nextByName()->nextByName() == NULL;
+		ret &= cam->nextByName()->childSize() == 1;
+
+		ret &= config->childByName( "note" )->text().string() == "x < y \xE2\x82\xAC";
+		/* CDATA content is not unescaped */
+		ret &= config->childByName( "raw" )->text().string() == "<b>&amp;</b>";
+		ret &= config->childByName( "missing" ) == NULL;
+
+		/* text-only elements keep their content inline, mixed content gets text children */
+		ret &= cam->childByName( "fx" )->childSize() == 0 && cam->childByName( "fx" )->value() == "500.5";
+		const XMLArenaNode* mixed = config->childByName( "mixed" );
+		ret &= mixed->childSize() == 3 && mixed->value().isEmpty();
+		ret &= mixed->child( 0 )->type() == XML_NODE_TEXT && mixed->child( 0 )->value() == "a";
+		ret &= mixed->child( 1 )->name() == "b" && mixed->child( 2 )->value() == "c";
+		ret &= mixed->text() == "a";
+		return ret;
+	}
+
+	static bool _testHashedLookup()
+	{
+		String xml( "<root>" );
+		for( size_t i = 0; i < 1000; i++ ) {
+			xml.sprintfConcat( "<item>%d</item>", ( int ) i );
+			xml.sprintfConcat( "<unique%d v=\"%d\"/>", ( int ) i, ( int ) i );
+		}
+		xml += "</root>";
+
+		XMLArenaDocument doc;
+		doc.load( xml.c_str(), xml.length() );
+		const XMLArenaNode* root = doc.node( 0 );
+		bool ret = root->childSize() == 2000;
+
+		for( size_t i = 0; i < 1000; i += 7 ) {
+			String name;
+			name.sprintf( "unique%d", ( int ) i );
+			const XMLArenaNode* n = root->childByName( name );
+			ret &= n != NULL && n->childByName( "v" )->value().toInteger() == ( long ) i;
+		}
+
+		size_t count = 0;
+		for( const XMLArenaNode* n = root->childByName( "item" ); n; n = n->nextByName() ) {
+			ret &= n->text().toInteger() == ( long ) count;
+			count++;
+		}
+		ret &= count == 1000;
+		return ret;
+	}
+
+	class _SAXCounter : public XMLSAXHandler {
+		public:
+			_SAXCounter() : depth( 0 ), maxDepth( 0 ), elements( 0 ), attributes( 0 ), texts( 0 ), comments( 0 ), balanced( true )
+			{
+			}
+
+			void startElement( const XMLStringView& name, const XMLSAXAttribute*, size_t numAttributes )
+			{
+				names.push_back( name );
+				elements++;
+				attributes += numAttributes;
+				depth++;
+				maxDepth = Math::max( depth, maxDepth );
+			}
+
+			void endElement( const XMLStringView& name )
+			{
+				balanced &= names.back() == name;
+				names.pop_back();
+				depth--;
+			}
+
+			void text( const XMLStringView& )
+			{
+				texts++;
+			}
+
+			void comment( const XMLStringView& )
+			{
+				comments++;
+			}
+
+			std::vector<XMLStringView> names;
+			size_t depth, maxDepth, elements, attributes, texts, comments;
+			bool balanced;
+	};
+
+	static bool _testSAX()
+	{
+		_SAXCounter counter;
+		XMLSAXParser parser;
+		parser.parse( counter, _xmlSample, strlen( _xmlSample ) );
+		bool ret = counter.balanced && counter.depth == 0 && counter.maxDepth == 3 && counter.elements == 9 &&
+				   counter.attributes == 4 && counter.texts == 6 && counter.comments == 1;
+
+		const char* malformed[] = {
+			"<a><b></a></b>",
+			"<a>",
+			"<a x=\"1></a>",
+			"text<a/>",
+			"<a><!-- unterminated </a>"
+		};
+		for( size_t i = 0; i < 5; i++ ) {
+			bool thrown = false;
+			try {
+				_SAXCounter c;
+				parser.parse( c, malformed[ i ], strlen( malformed[ i ] ) );
+			} catch( const Exception& ) {
+				thrown = true;
+			}
+			ret &= thrown;
+		}
+		return ret;
+	}
+
+	static bool _compare( const XMLNode* a, const XMLArenaNode* b )
+	{
+		if( b->name() != a->name() )
+			return false;
+		/* inline text content */
+		if( a->childSize() == 1 && a->child( 0 )->type() == XML_NODE_TEXT )
+			return b->childSize() == 0 && b->value().string() == a->child( 0 )->value();
+		if( b->value().string() != a->value() || a->childSize() != b->childSize() )
+			return false;
+		for( size_t i = 0; i < a->childSize(); i++ ) {
+			if( !_compare( a->child( i ), b->child( i ) ) )
+				return false;
+		}
+		return true;
+	}
+
+	static bool _testMatchesXMLDocument()
+	{
+		XMLElement* root = new XMLElement( "Map" );
+		for( size_t i = 0; i < 50; i++ ) {
+			XMLElement* kf = new XMLElement( "Keyframe" );
+			String id;
+			id.sprintf( "%d", ( int ) i );
+			kf->addChild( new XMLAttribute( "id", id ) );
+			XMLElement* pose = new XMLElement( "Pose" );
+			pose->addChild( new XMLText( "1 0 0 0.5\n0 1 0 0\n0 0 1 0\n0 0 0 1" ) );
+			kf->addChild( pose );
+			root->addChild( kf );
+		}
+		String xml( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" );
+		String body;
+		root->xmlString( body );
+		xml += body;
+		delete root;
+
+		XMLDocument ref;
+		ref.load( xml.c_str(), xml.length() );
+		XMLArenaDocument doc;
+		doc.load( xml.c_str(), xml.length() );
+
+		return doc.nodeSize() == 1 && _compare( ref.nodeByName( "Map" ), doc.node( 0 ) );
+	}
+
+BEGIN_CVTTEST( XMLArenaDocument )
+	bool result = true;
+	bool b;
+
+	b = _testStructure();
+	CVTTEST_PRINT( "XMLArenaDocument structure and unescaping", b );
+	result &= b;
+
+	b = _testHashedLookup();
+	CVTTEST_PRINT( "XMLArenaDocument hashed childByName/nextByName", b );
+	result &= b;
+
+	b = _testSAX();
+	CVTTEST_PRINT( "XMLSAXParser events and errors", b );
+	result &= b;
+
+	b = _testMatchesXMLDocument();
+	CVTTEST_PRINT( "XMLArenaDocument matches XMLDocument", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
@@ -74,6 +74,8 @@ namespace cvt {
 
 	inline void XMLDocument::load( const char* buffer, size_t len )
 	{
+		for( size_t i = 0; i < _nodes.size(); i++ )
+			delete _nodes[ i ];
         _nodes.clear();
 		XMLDecoder* dec = XMLDecoder::autodetect( buffer, len );
 		dec->parse( this, buffer, len );
@@ -82,7 +84,6 @@ namespace cvt {
 
 	inline void XMLDocument::load( const String& path )
 	{
-        _nodes.clear();
 		Data d;
 		FileSystem::load( d, path.c_str(), true );
 		load( ( const char* ) d.ptr(), d.size() - 1 );
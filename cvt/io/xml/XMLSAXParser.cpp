@@ -0,0 +1,302 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/xml/XMLSAXParser.h>
+#include <cvt/util/Exception.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	XMLMappedFile::XMLMappedFile( const String& path ) : _ptr( NULL ), _size( 0 )
+	{
+		int fd = open( path.c_str(), O_RDONLY, 0 );
+		if( fd < 0 ) {
+			String msg( "Could not open file: " );
+			msg += strerror( errno );
+			throw CVTException( msg.c_str() );
+		}
+
+		struct stat fileInfo;
+		if( fstat( fd, &fileInfo ) == -1 ) {
+			::close( fd );
+			throw CVTException( "fstat error" );
+		}
+		_size = fileInfo.st_size;
+
+		if( _size ) {
+			void* ptr = mmap( 0, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			if( ptr == MAP_FAILED ) {
+				::close( fd );
+				String msg( "Could not map file: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+			_ptr = ( const char* ) ptr;
+			madvise( ptr, _size, MADV_SEQUENTIAL );
+		}
+		/* the mapping stays valid after closing the descriptor */
+		::close( fd );
+	}
+
+	XMLMappedFile::~XMLMappedFile()
+	{
+		if( _ptr )
+			munmap( ( void* ) _ptr, _size );
+	}
+
+	XMLSAXParser::XMLSAXParser() : _ptr( NULL ), _end( NULL )
+	{
+	}
+
+	XMLSAXParser::~XMLSAXParser()
+	{
+	}
+
+	void XMLSAXParser::parse( XMLSAXHandler& handler, const String& path )
+	{
+		XMLMappedFile file( path );
+		parse( handler, file.ptr(), file.size() );
+	}
+
+	void XMLSAXParser::parse( XMLSAXHandler& handler, const char* data, size_t len )
+	{
+		_ptr = data;
+		_end = data + len;
+		_open.clear();
+
+		/* UTF-8 byte order mark */
+		if( match( "\xEF\xBB\xBF" ) )
+			_ptr += 3;
+
+		while( 1 ) {
+			skipWhitespace();
+			if( _ptr == _end || *_ptr == '\0' )
+				break;
+
+			if( *_ptr != '<' ) {
+				if( _open.empty() )
+					throw CVTException( "Invalid XML data" );
+				parseText( handler );
+			} else if( match( "</" ) ) {
+				parseEndTag( handler );
+			} else if( match( "<?" ) ) {
+				skipPI();
+			} else if( match( "<!--" ) ) {
+				parseComment( handler );
+			} else if( match( "<![CDATA[" ) ) {
+				if( _open.empty() )
+					throw CVTException( "CDATA section outside of element" );
+				parseCData( handler );
+			} else if( match( "<!" ) ) {
+				if( !_open.empty() )
+					throw CVTException( "Markup declaration inside of element" );
+				skipDeclaration();
+			} else {
+				parseStartTag( handler );
+			}
+		}
+
+		if( !_open.empty() )
+			throw CVTException( "Premature end of file" );
+	}
+
+	XMLStringView XMLSAXParser::parseName()
+	{
+		/* non-ASCII name characters are accepted without further validation */
+		const char* start = _ptr;
+		if( _ptr < _end && ( *_ptr == ':' || *_ptr == '_' ||
+						   ( *_ptr >= 'A' && *_ptr <= 'Z' ) ||
+						   ( *_ptr >= 'a' && *_ptr <= 'z' ) ||
+						   ( uint8_t ) *_ptr >= 0x80 ) ) {
+			_ptr++;
+			while( _ptr < _end && ( *_ptr == ':' || *_ptr == '_' ||
+								  *_ptr == '-' || *_ptr == '.' ||
+								  ( *_ptr >= '0' && *_ptr <= '9' ) ||
+								  ( *_ptr >= 'A' && *_ptr <= 'Z' ) ||
+								  ( *_ptr >= 'a' && *_ptr <= 'z' ) ||
+								  ( uint8_t ) *_ptr >= 0x80 ) )
+				_ptr++;
+		}
+		if( _ptr == start )
+			throw CVTException( "Malformed name" );
+		return XMLStringView( start, _ptr - start );
+	}
+
+	void XMLSAXParser::parseStartTag( XMLSAXHandler& handler )
+	{
+		advance( 1 );
+		/* spec says no whitespaces allowed - whatever */
+		skipWhitespace();
+		XMLStringView name = parseName();
+
+		_attributes.clear();
+		while( 1 ) {
+			skipWhitespace();
+			if( _ptr == _end )
+				throw CVTException( "Premature end of file" );
+			if( match( "/>" ) ) {
+				_ptr += 2;
+				handler.startElement( name, _attributes.empty() ? NULL : &_attributes[ 0 ], _attributes.size() );
+				handler.endElement( name );
+				return;
+			} else if( *_ptr == '>' ) {
+				_ptr++;
+				handler.startElement( name, _attributes.empty() ? NULL : &_attributes[ 0 ], _attributes.size() );
+				_open.push_back( name );
+				return;
+			}
+			parseAttribute();
+		}
+	}
+
+	void XMLSAXParser::parseEndTag( XMLSAXHandler& handler )
+	{
+		advance( 2 );
+		skipWhitespace();
+		XMLStringView name = parseName();
+		if( _open.empty() || _open.back() != name )
+			throw CVTException( "Names in start- and end-tag differ" );
+		skipWhitespace();
+		if( !match( ">" ) )
+			throw CVTException( "Missing '>'" );
+		_ptr++;
+		_open.pop_back();
+		handler.endElement( name );
+	}
+
+	void XMLSAXParser::parseAttribute()
+	{
+		XMLSAXAttribute attr;
+		attr.name = parseName();
+		skipWhitespace();
+		if( !match( "=" ) )
+			throw CVTException( "Malformed attribute - expected '='" );
+		_ptr++;
+		skipWhitespace();
+		if( _ptr == _end || ( *_ptr != '"' && *_ptr != '\'' ) )
+			throw CVTException( "Malformed attribute value" );
+
+		char quote = *_ptr++;
+		const char* start = _ptr;
+		bool escaped = false;
+		while( _ptr < _end && *_ptr != quote ) {
+			if( *_ptr == '<' || *_ptr == '\0' )
+				throw CVTException( "Malformed attribute value" );
+			escaped |= *_ptr == '&';
+			_ptr++;
+		}
+		if( _ptr == _end )
+			throw CVTException( "Malformed attribute value" );
+		attr.value = XMLStringView( start, _ptr - start, escaped );
+		_ptr++;
+		_attributes.push_back( attr );
+	}
+
+	void XMLSAXParser::parseText( XMLSAXHandler& handler )
+	{
+		const char* start = _ptr;
+		const char* lt = ( const char* ) memchr( _ptr, '<', _end - _ptr );
+		if( !lt )
+			throw CVTException( "Premature end of file" );
+		size_t len = lt - start;
+		if( len > 0xFFFFFFFF )
+			throw CVTException( "Text node too large" );
+		_ptr = lt;
+		handler.text( XMLStringView( start, len, memchr( start, '&', len ) != NULL ) );
+	}
+
+	void XMLSAXParser::parseCData( XMLSAXHandler& handler )
+	{
+		_ptr += 9;
+		const char* start = _ptr;
+		while( 1 ) {
+			const char* p = ( const char* ) memchr( _ptr, ']', _end - _ptr );
+			if( !p )
+				throw CVTException( "Unterminated CDATA section" );
+			_ptr = p;
+			if( match( "]]>" ) )
+				break;
+			_ptr++;
+		}
+		handler.text( XMLStringView( start, _ptr - start ) );
+		_ptr += 3;
+	}
+
+	void XMLSAXParser::parseComment( XMLSAXHandler& handler )
+	{
+		_ptr += 4;
+		const char* start = _ptr;
+		while( 1 ) {
+			const char* p = ( const char* ) memchr( _ptr, '-', _end - _ptr );
+			if( !p )
+				throw CVTException( "Invalid comment" );
+			_ptr = p;
+			if( match( "-->" ) )
+				break;
+			_ptr++;
+		}
+		handler.comment( XMLStringView( start, _ptr - start ) );
+		_ptr += 3;
+	}
+
+	void XMLSAXParser::skipPI()
+	{
+		_ptr += 2;
+		while( !match( "?>" ) )
+			advance( 1 );
+		_ptr += 2;
+	}
+
+	void XMLSAXParser::skipDeclaration()
+	{
+		/* DOCTYPE with an optional internal subset */
+		int depth = 0;
+		char quote = 0;
+		_ptr += 2;
+		while( 1 ) {
+			if( _ptr == _end )
+				throw CVTException( "Premature end of file" );
+			char c = *_ptr++;
+			if( quote ) {
+				if( c == quote )
+					quote = 0;
+			} else if( c == '"' || c == '\'' ) {
+				quote = c;
+			} else if( c == '[' ) {
+				depth++;
+			} else if( c == ']' ) {
+				depth--;
+			} else if( c == '>' && depth <= 0 ) {
+				return;
+			}
+		}
+	}
+}
@@ -0,0 +1,145 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_XMLSAXPARSER_H
+#define CVT_XMLSAXPARSER_H
+
+#include <cvt/io/xml/XMLStringView.h>
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  \ingroup XML
+	*/
+	struct XMLSAXAttribute {
+		XMLStringView name;
+		XMLStringView value;
+	};
+
+	/**
+	  \ingroup XML
+	  Callback interface of the XMLSAXParser.
+	  All views passed to the callbacks point into the parsed buffer and stay
+	  valid as long as the buffer does - for XMLSAXParser::parse( handler, path )
+	  only until the callback returns.
+	  Throwing from a callback aborts the parse.
+	*/
+	class XMLSAXHandler {
+		public:
+			virtual ~XMLSAXHandler() {}
+
+			virtual void startElement( const XMLStringView& /*name*/, const XMLSAXAttribute* /*attributes*/, size_t /*numAttributes*/ ) {}
+			virtual void endElement( const XMLStringView& /*name*/ ) {}
+			/* text and CDATA content, leading whitespace is skipped */
+			virtual void text( const XMLStringView& /*text*/ ) {}
+			virtual void comment( const XMLStringView& /*comment*/ ) {}
+	};
+
+	/**
+	  \ingroup XML
+	  Read-only mapping of a whole file
+	*/
+	class XMLMappedFile {
+		public:
+			XMLMappedFile( const String& path );
+			~XMLMappedFile();
+
+			const char* ptr() const { return _ptr; }
+			size_t		size() const { return _size; }
+
+		private:
+			XMLMappedFile( const XMLMappedFile& );
+			XMLMappedFile& operator=( const XMLMappedFile& );
+
+			const char* _ptr;
+			size_t		_size;
+	};
+
+	/**
+	  \ingroup XML
+	  Streaming UTF-8 XML parser.
+	  Reports the document through an XMLSAXHandler without building a DOM and
+	  without copying names or values.
+	  Processing instructions (including the XML declaration) and DOCTYPE declarations are skipped.
+	*/
+	class XMLSAXParser {
+		public:
+			XMLSAXParser();
+			~XMLSAXParser();
+
+			void parse( XMLSAXHandler& handler, const char* data, size_t len );
+			void parse( XMLSAXHandler& handler, const String& path );
+
+		private:
+			XMLSAXParser( const XMLSAXParser& );
+			XMLSAXParser& operator=( const XMLSAXParser& );
+
+			void skipWhitespace();
+			bool match( const char* str ) const;
+			void advance( size_t n );
+			XMLStringView parseName();
+			void parseStartTag( XMLSAXHandler& handler );
+			void parseEndTag( XMLSAXHandler& handler );
+			void parseAttribute();
+			void parseText( XMLSAXHandler& handler );
+			void parseCData( XMLSAXHandler& handler );
+			void parseComment( XMLSAXHandler& handler );
+			void skipPI();
+			void skipDeclaration();
+
+			const char*					_ptr;
+			const char*					_end;
+			std::vector<XMLSAXAttribute> _attributes;
+			std::vector<XMLStringView>	_open;
+	};
+
+	inline void XMLSAXParser::skipWhitespace()
+	{
+		while( _ptr < _end && ( *_ptr == 0x20 || *_ptr == 0x09 || *_ptr == 0x0A || *_ptr == 0x0D ) )
+			_ptr++;
+	}
+
+	inline bool XMLSAXParser::match( const char* str ) const
+	{
+		const char* ptr = _ptr;
+		while( *str ) {
+			if( ptr == _end || *ptr != *str )
+				return false;
+			ptr++;
+			str++;
+		}
+		return true;
+	}
+
+	inline void XMLSAXParser::advance( size_t n )
+	{
+		if( ( size_t ) ( _end - _ptr ) < n )
+			throw CVTException( "Premature end of file" );
+		_ptr += n;
+	}
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/io/xml/XMLStringView.h>
+#include <vector>
+
+namespace cvt {
+
+	static inline size_t _encodeUTF8( char* dst, uint32_t c )
+	{
+		if( c < 0x80 ) {
+			dst[ 0 ] = c;
+			return 1;
+		} else if( c < 0x800 ) {
+			dst[ 0 ] = 0xC0 | ( c >> 6 );
+			dst[ 1 ] = 0x80 | ( c & 0x3F );
+			return 2;
+		} else if( c < 0x10000 ) {
+			dst[ 0 ] = 0xE0 | ( c >> 12 );
+			dst[ 1 ] = 0x80 | ( ( c >> 6 ) & 0x3F );
+			dst[ 2 ] = 0x80 | ( c & 0x3F );
+			return 3;
+		}
+		dst[ 0 ] = 0xF0 | ( c >> 18 );
+		dst[ 1 ] = 0x80 | ( ( c >> 12 ) & 0x3F );
+		dst[ 2 ] = 0x80 | ( ( c >> 6 ) & 0x3F );
+		dst[ 3 ] = 0x80 | ( c & 0x3F );
+		return 4;
+	}
+
+	static inline bool _reference( uint32_t& c, const char* ref, size_t len )
+	{
+		if( len >= 2 && ref[ 0 ] == '#' ) {
+			char* end;
+			unsigned long v;
+			char buf[ 16 ];
+			if( len > sizeof( buf ) - 1 )
+				return false;
+			memcpy( buf, ref, len );
+			buf[ len ] = '\0';
+			if( buf[ 1 ] == 'x' )
+				v = strtoul( buf + 2, &end, 16 );
+			else
+				v = strtoul( buf + 1, &end, 10 );
+			if( *end != '\0' || v == 0 || v > 0x10FFFF )
+				return false;
+			c = v;
+			return true;
+		}
+
+		static const struct {
+			const char* name;
+			size_t		len;
+			char		c;
+		} _entities[] = {
+			{ "lt", 2, '<' },
+			{ "gt", 2, '>' },
+			{ "amp", 3, '&' },
+			{ "quot", 4, '"' },
+			{ "apos", 4, '\'' }
+		};
+
+		for( size_t i = 0; i < 5; i++ ) {
+			if( _entities[ i ].len == len && !memcmp( _entities[ i ].name, ref, len ) ) {
+				c = _entities[ i ].c;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	  Resolves the predefined entities and character references.
+	  Unknown references are copied unchanged.
+	*/
+	void XMLStringView::unescape( String& dst, const char* str, size_t len )
+	{
+		/* a reference is never shorter than its UTF-8 encoding */
+		std::vector<char> buf( len + 1 );
+		const char* end = str + len;
+		char* out = &buf[ 0 ];
+
+		while( str < end ) {
+			const char* amp = ( const char* ) memchr( str, '&', end - str );
+			if( !amp )
+				amp = end;
+			memcpy( out, str, amp - str );
+			out += amp - str;
+			str = amp;
+			if( str == end )
+				break;
+
+			const char* semi = ( const char* ) memchr( amp, ';', end - amp );
+			uint32_t c;
+			if( semi && _reference( c, amp + 1, semi - amp - 1 ) ) {
+				out += _encodeUTF8( out, c );
+				str = semi + 1;
+			} else {
+				*out++ = '&';
+				str++;
+			}
+		}
+		dst.assign( &buf[ 0 ], out - &buf[ 0 ] );
+	}
+
+	/* number conversion without heap allocation for the usual short values */
+	template<typename T, typename CONV>
+	static inline T _convert( const char* str, size_t len, bool escaped, CONV conv )
+	{
+		char buf[ 64 ];
+		if( escaped || len >= sizeof( buf ) ) {
+			String tmp;
+			if( escaped )
+				XMLStringView::unescape( tmp, str, len );
+			else
+				tmp.assign( str, len );
+			return conv( tmp.c_str() );
+		}
+		memcpy( buf, str, len );
+		buf[ len ] = '\0';
+		return conv( buf );
+	}
+
+	static long _strtol( const char* str )
+	{
+		return strtol( str, NULL, 0 );
+	}
+
+	static float _strtof( const char* str )
+	{
+		return strtof( str, NULL );
+	}
+
+	static double _strtod( const char* str )
+	{
+		return strtod( str, NULL );
+	}
+
+	long XMLStringView::toInteger() const
+	{
+		return _convert<long>( _str, _len, _escaped, _strtol );
+	}
+
+	float XMLStringView::toFloat() const
+	{
+		return _convert<float>( _str, _len, _escaped, _strtof );
+	}
+
+	double XMLStringView::toDouble() const
+	{
+		return _convert<double>( _str, _len, _escaped, _strtod );
+	}
+}
@@ -0,0 +1,179 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_XMLSTRINGVIEW_H
+#define CVT_XMLSTRINGVIEW_H
+
+#include <cvt/util/String.h>
+#include <string.h>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  \ingroup XML
+	  Non-owning reference to a name or value inside the parsed XML buffer.
+	  Entity and character references are kept as they are in the buffer
+	  and only resolved when the view is converted with string().
+	*/
+	class XMLStringView {
+		public:
+			XMLStringView();
+			XMLStringView( const char* str, size_t len, bool escaped = false );
+
+			const char* ptr() const;
+			size_t		length() const;
+			bool		isEmpty() const;
+			bool		hasReferences() const;
+			uint32_t	hash() const;
+
+			String		string() const;
+			void		string( String& dst ) const;
+
+			long		toInteger() const;
+			float		toFloat() const;
+			double		toDouble() const;
+
+			bool operator==( const XMLStringView& other ) const;
+			bool operator!=( const XMLStringView& other ) const;
+			bool operator==( const char* str ) const;
+			bool operator!=( const char* str ) const;
+			bool operator==( const String& str ) const;
+			bool operator!=( const String& str ) const;
+
+			static uint32_t hash( const char* str, size_t len );
+			static void		unescape( String& dst, const char* str, size_t len );
+
+		private:
+			const char* _str;
+			uint32_t	_len;
+			bool		_escaped;
+	};
+
+	inline XMLStringView::XMLStringView() : _str( "" ), _len( 0 ), _escaped( false )
+	{
+	}
+
+	inline XMLStringView::XMLStringView( const char* str, size_t len, bool escaped ) :
+		_str( str ),
+		_len( ( uint32_t ) len ),
+		_escaped( escaped )
+	{
+	}
+
+	inline const char* XMLStringView::ptr() const
+	{
+		return _str;
+	}
+
+	inline size_t XMLStringView::length() const
+	{
+		return _len;
+	}
+
+	inline bool XMLStringView::isEmpty() const
+	{
+		return _len == 0;
+	}
+
+	/**
+	  True if the raw text contains entity or character references
+	*/
+	inline bool XMLStringView::hasReferences() const
+	{
+		return _escaped;
+	}
+
+	inline uint32_t XMLStringView::hash() const
+	{
+		return hash( _str, _len );
+	}
+
+	/**
+	  FNV-1a hash of the raw bytes
+	*/
+	inline uint32_t XMLStringView::hash( const char* str, size_t len )
+	{
+		uint32_t h = 2166136261U;
+		while( len-- ) {
+			h ^= ( uint8_t ) *str++;
+			h *= 16777619U;
+		}
+		return h;
+	}
+
+	inline String XMLStringView::string() const
+	{
+		String ret;
+		string( ret );
+		return ret;
+	}
+
+	inline void XMLStringView::string( String& dst ) const
+	{
+		if( _escaped )
+			unescape( dst, _str, _len );
+		else
+			dst.assign( _str, _len );
+	}
+
+	inline bool XMLStringView::operator==( const XMLStringView& other ) const
+	{
+		return _len == other._len && !memcmp( _str, other._str, _len );
+	}
+
+	inline bool XMLStringView::operator!=( const XMLStringView& other ) const
+	{
+		return !( *this == other );
+	}
+
+	inline bool XMLStringView::operator==( const char* str ) const
+	{
+		return !strncmp( _str, str, _len ) && str[ _len ] == '\0';
+	}
+
+	inline bool XMLStringView::operator!=( const char* str ) const
+	{
+		return !( *this == str );
+	}
+
+	inline bool XMLStringView::operator==( const String& str ) const
+	{
+		return _len == str.length() && !memcmp( _str, str.c_str(), _len );
+	}
+
+	inline bool XMLStringView::operator!=( const String& str ) const
+	{
+		return !( *this == str );
+	}
+
+	inline std::ostream& operator<<( std::ostream& out, const XMLStringView& view )
+	{
+		out.write( view.ptr(), view.length() );
+		return out;
+	}
+}
+
+#endif
@@ -23,6 +23,11 @@
 */
 
 #include <cvt/math/FFT.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/ParallelFor.h>
+#include <map>
+#include <algorithm>
 
 namespace cvt {
 
@@ -183,4 +188,419 @@ namespace cvt {
 
 
 
+	FFTPlan::FFTPlan( size_t n ) : _n( n )
+	{
+		if( !n )
+			throw CVTException( "FFTPlan: invalid size" );
+
+		/* factorize: prefer radix 4, then 2, 3, 5 and the remaining primes */
+		std::vector<size_t> radices;
+		size_t rest = n;
+		while( ( rest & 3 ) == 0 ) {
+			radices.push_back( 4 );
+			rest >>= 2;
+		}
+		static const size_t small[] = { 2, 3, 5 };
+		for( size_t i = 0; i < 3; i++ ) {
+			while( rest % small[ i ] == 0 ) {
+				radices.push_back( small[ i ] );
+				rest /= small[ i ];
+			}
+		}
+		for( size_t p = 7; rest > 1; p += 2 ) {
+			while( rest % p == 0 ) {
+				radices.push_back( p );
+				rest /= p;
+			}
+		}
+
+		size_t ncur = n;
+		for( size_t i = 0; i < radices.size(); i++ ) {
+			Stage stage;
+			stage.radix = radices[ i ];
+			stage.m = ncur / stage.radix;
+			stage.twiddle = _twiddles.size();
+			stage.roots = 0;
+
+			for( size_t p = 0; p < stage.m; p++ ) {
+				for( size_t u = 1; u < stage.radix; u++ ) {
+					double phi = -2.0 * Math::PI * ( double ) ( ( p * u ) % ncur ) / ( double ) ncur;
+					_twiddles.push_back( Complex<float>( Math::cos( phi ), Math::sin( phi ) ) );
+					_twiddlesInv.push_back( _twiddles.back().conj() );
+				}
+			}
+
+			if( stage.radix > 5 ) {
+				stage.roots = _twiddles.size();
+				for( size_t k = 0; k < stage.radix; k++ ) {
+					double phi = -2.0 * Math::PI * ( double ) k / ( double ) stage.radix;
+					_twiddles.push_back( Complex<float>( Math::cos( phi ), Math::sin( phi ) ) );
+					_twiddlesInv.push_back( _twiddles.back().conj() );
+				}
+			}
+
+			_stages.push_back( stage );
+			ncur = stage.m;
+		}
+	}
+
+	bool FFTPlan::isFastSize( size_t n )
+	{
+		if( !n )
+			return false;
+		while( n % 2 == 0 ) n /= 2;
+		while( n % 3 == 0 ) n /= 3;
+		while( n % 5 == 0 ) n /= 5;
+		return n == 1;
+	}
+
+	size_t FFTPlan::fastSize( size_t n )
+	{
+		if( !n )
+			return 1;
+		while( !isFastSize( n ) )
+			n++;
+		return n;
+	}
+
+	const FFTPlan& FFTPlan::get( size_t n )
+	{
+		/* plans are never released, there are only a few sizes in practice */
+		static Mutex lock;
+		static std::map<size_t, FFTPlan*> plans;
+
+		ScopeLock sl( &lock );
+		std::map<size_t, FFTPlan*>::iterator it = plans.find( n );
+		if( it != plans.end() )
+			return *it->second;
+		FFTPlan* plan = new FFTPlan( n );
+		plans[ n ] = plan;
+		return *plan;
+	}
+
+	/* multiply with -i * sgn */
+	static inline Complex<float> mulNegI( const Complex<float>& c, float sgn )
+	{
+		return Complex<float>( sgn * c.im, -sgn * c.re );
+	}
+
+	/*
+	   One Stockham stage: x holds s interleaved sequences of length r * m,
+	   y[ q + s * ( r * p + u ) ] = w_p^u * DFT_r( x[ q + s * ( p + t * m ) ] )_u
+	   The inner loop over q is contiguous and covers the batch.
+	 */
+	static void fftStage2( Complex<float>* y, const Complex<float>* x, size_t m, size_t s, const Complex<float>* tw )
+	{
+		for( size_t p = 0; p < m; p++ ) {
+			const Complex<float> w1 = tw[ p ];
+			const Complex<float>* x0 = x + s * p;
+			const Complex<float>* x1 = x + s * ( p + m );
+			Complex<float>* y0 = y + s * 2 * p;
+			Complex<float>* y1 = y0 + s;
+			for( size_t q = 0; q < s; q++ ) {
+				Complex<float> a0 = x0[ q ], a1 = x1[ q ];
+				y0[ q ] = a0 + a1;
+				y1[ q ] = ( a0 - a1 ) * w1;
+			}
+		}
+	}
+
+	static void fftStage3( Complex<float>* y, const Complex<float>* x, size_t m, size_t s, const Complex<float>* tw, float sgn )
+	{
+		const float s60 = sgn * 0.86602540378443864676f;
+		for( size_t p = 0; p < m; p++ ) {
+			const Complex<float> w1 = tw[ 2 * p ], w2 = tw[ 2 * p + 1 ];
+			const Complex<float>* x0 = x + s * p;
+			const Complex<float>* x1 = x + s * ( p + m );
+			const Complex<float>* x2 = x + s * ( p + 2 * m );
+			Complex<float>* y0 = y + s * 3 * p;
+			Complex<float>* y1 = y0 + s;
+			Complex<float>* y2 = y1 + s;
+			for( size_t q = 0; q < s; q++ ) {
+				Complex<float> a0 = x0[ q ], a1 = x1[ q ], a2 = x2[ q ];
+				Complex<float> t1 = a1 + a2;
+				Complex<float> t2 = a0 - t1 * 0.5f;
+				Complex<float> t3 = mulNegI( a1 - a2, s60 );
+				y0[ q ] = a0 + t1;
+				y1[ q ] = ( t2 + t3 ) * w1;
+				y2[ q ] = ( t2 - t3 ) * w2;
+			}
+		}
+	}
+
+	static void fftStage4( Complex<float>* y, const Complex<float>* x, size_t m, size_t s, const Complex<float>* tw, float sgn )
+	{
+		for( size_t p = 0; p < m; p++ ) {
+			const Complex<float> w1 = tw[ 3 * p ], w2 = tw[ 3 * p + 1 ], w3 = tw[ 3 * p + 2 ];
+			const Complex<float>* x0 = x + s * p;
+			const Complex<float>* x1 = x + s * ( p + m );
+			const Complex<float>* x2 = x + s * ( p + 2 * m );
+			const Complex<float>* x3 = x + s * ( p + 3 * m );
+			Complex<float>* y0 = y + s * 4 * p;
+			Complex<float>* y1 = y0 + s;
+			Complex<float>* y2 = y1 + s;
+			Complex<float>* y3 = y2 + s;
+			for( size_t q = 0; q < s; q++ ) {
+				Complex<float> a0 = x0[ q ], a1 = x1[ q ], a2 = x2[ q ], a3 = x3[ q ];
+				Complex<float> t0 = a0 + a2, t1 = a0 - a2;
+				Complex<float> t2 = a1 + a3, t3 = mulNegI( a1 - a3, sgn );
+				y0[ q ] = t0 + t2;
+				y1[ q ] = ( t1 + t3 ) * w1;
+				y2[ q ] = ( t0 - t2 ) * w2;
+				y3[ q ] = ( t1 - t3 ) * w3;
+			}
+		}
+	}
+
+	static void fftStage5( Complex<float>* y, const Complex<float>* x, size_t m, size_t s, const Complex<float>* tw, float sgn )
+	{
+		const float c1 = 0.30901699437494742410f;	/* cos( 2 pi / 5 ) */
+		const float c2 = -0.80901699437494742410f;	/* cos( 4 pi / 5 ) */
+		const float s1 = sgn * 0.95105651629515357212f;
+		const float s2 = sgn * 0.58778525229247312917f;
+		for( size_t p = 0; p < m; p++ ) {
+			const Complex<float>* w = tw + 4 * p;
+			const Complex<float>* x0 = x + s * p;
+			const Complex<float>* x1 = x + s * ( p + m );
+			const Complex<float>* x2 = x + s * ( p + 2 * m );
+			const Complex<float>* x3 = x + s * ( p + 3 * m );
+			const Complex<float>* x4 = x + s * ( p + 4 * m );
+			Complex<float>* y0 = y + s * 5 * p;
+			Complex<float>* y1 = y0 + s;
+			Complex<float>* y2 = y1 + s;
+			Complex<float>* y3 = y2 + s;
+			Complex<float>* y4 = y3 + s;
+			for( size_t q = 0; q < s; q++ ) {
+				Complex<float> a0 = x0[ q ];
+				Complex<float> t1 = x1[ q ] + x4[ q ], t2 = x2[ q ] + x3[ q ];
+				Complex<float> t3 = x1[ q ] - x4[ q ], t4 = x2[ q ] - x3[ q ];
+				Complex<float> m1 = a0 + t1 * c1 + t2 * c2;
+				Complex<float> m2 = a0 + t1 * c2 + t2 * c1;
+				Complex<float> n1 = mulNegI( t3 * s1 + t4 * s2, 1.0f );
+				Complex<float> n2 = mulNegI( t3 * s2 - t4 * s1, 1.0f );
+				y0[ q ] = a0 + t1 + t2;
+				y1[ q ] = ( m1 + n1 ) * w[ 0 ];
+				y4[ q ] = ( m1 - n1 ) * w[ 3 ];
+				y2[ q ] = ( m2 + n2 ) * w[ 1 ];
+				y3[ q ] = ( m2 - n2 ) * w[ 2 ];
+			}
+		}
+	}
+
+	static void fftStageGeneric( Complex<float>* y, const Complex<float>* x, size_t r, size_t m, size_t s,
+								 const Complex<float>* tw, const Complex<float>* roots )
+	{
+		for( size_t p = 0; p < m; p++ ) {
+			const Complex<float>* w = tw + ( r - 1 ) * p;
+			for( size_t u = 0; u < r; u++ ) {
+				Complex<float>* yu = y + s * ( r * p + u );
+				for( size_t q = 0; q < s; q++ ) {
+					Complex<float> sum( 0.0f, 0.0f );
+					for( size_t t = 0; t < r; t++ )
+						sum += x[ q + s * ( p + t * m ) ] * roots[ ( t * u ) % r ];
+					yu[ q ] = u ? sum * w[ u - 1 ] : sum;
+				}
+			}
+		}
+	}
+
+	void FFTPlan::transform( Complex<float>* data, size_t batch, bool backward, Complex<float>* scratch ) const
+	{
+		const Complex<float>* tw = backward ? &_twiddlesInv[ 0 ] : &_twiddles[ 0 ];
+		const float sgn = backward ? -1.0f : 1.0f;
+		Complex<float>* x = data;
+		Complex<float>* y = scratch;
+		size_t s = batch;
+
+		for( size_t i = 0; i < _stages.size(); i++ ) {
+			const Stage& st = _stages[ i ];
+			switch( st.radix ) {
+				case 2: fftStage2( y, x, st.m, s, tw + st.twiddle ); break;
+				case 3: fftStage3( y, x, st.m, s, tw + st.twiddle, sgn ); break;
+				case 4: fftStage4( y, x, st.m, s, tw + st.twiddle, sgn ); break;
+				case 5: fftStage5( y, x, st.m, s, tw + st.twiddle, sgn ); break;
+				default: fftStageGeneric( y, x, st.radix, st.m, s, tw + st.twiddle, tw + st.roots ); break;
+			}
+			std::swap( x, y );
+			s *= st.radix;
+		}
+
+		if( x != data )
+			std::copy( x, x + _n * batch, data );
+	}
+
+	/* number of columns transformed together */
+	static const size_t FFT_COLUMN_BATCH = 8;
+
+	/* rows of the forward transform: two real rows are packed into one complex FFT */
+	class FFTRealRowsForward {
+		public:
+			FFTRealRowsForward( Complex<float>* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) :
+				_dst( dst ), _dstStride( dstStride ), _src( ( const uint8_t* ) src ), _srcStride( srcStride ),
+				_width( width ), _height( height ), _plan( FFTPlan::get( width ) )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				std::vector<Complex<float> > z( _width ), scratch( _width );
+				const size_t nc = _width / 2 + 1;
+
+				for( size_t pair = begin; pair < end; pair++ ) {
+					size_t r0 = pair * 2;
+					size_t r1 = r0 + 1;
+					const float* a = ( const float* ) ( _src + r0 * _srcStride );
+					const float* b = r1 < _height ? ( const float* ) ( _src + r1 * _srcStride ) : NULL;
+
+					for( size_t x = 0; x < _width; x++ )
+						z[ x ].set( a[ x ], b ? b[ x ] : 0.0f );
+
+					_plan.transform( &z[ 0 ], 1, false, &scratch[ 0 ] );
+
+					/* split: A_k = ( Z_k + conj( Z_n-k ) ) / 2, B_k = ( Z_k - conj( Z_n-k ) ) / 2i */
+					Complex<float>* da = _dst + r0 * _dstStride;
+					Complex<float>* db = _dst + r1 * _dstStride;
+					for( size_t k = 0; k < nc; k++ ) {
+						const Complex<float>& zk = z[ k ];
+						const Complex<float>& zn = z[ k ? _width - k : 0 ];
+						da[ k ].set( 0.5f * ( zk.re + zn.re ), 0.5f * ( zk.im - zn.im ) );
+						if( b )
+							db[ k ].set( 0.5f * ( zk.im + zn.im ), 0.5f * ( zn.re - zk.re ) );
+					}
+				}
+			}
+
+		private:
+			Complex<float>*	_dst;
+			size_t			_dstStride;
+			const uint8_t*	_src;
+			size_t			_srcStride;
+			size_t			_width;
+			size_t			_height;
+			const FFTPlan&	_plan;
+	};
+
+	/* rows of the inverse transform: two half spectra are merged into one complex FFT */
+	class FFTRealRowsInverse {
+		public:
+			FFTRealRowsInverse( float* dst, size_t dstStride, const Complex<float>* src, size_t srcStride, size_t width, size_t height ) :
+				_dst( ( uint8_t* ) dst ), _dstStride( dstStride ), _src( src ), _srcStride( srcStride ),
+				_width( width ), _height( height ), _plan( FFTPlan::get( width ) ),
+				_scale( 1.0f / ( ( float ) width * ( float ) height ) )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				std::vector<Complex<float> > z( _width ), scratch( _width );
+				const size_t nc = _width / 2 + 1;
+
+				for( size_t pair = begin; pair < end; pair++ ) {
+					size_t r0 = pair * 2;
+					size_t r1 = r0 + 1;
+					const Complex<float>* sa = _src + r0 * _srcStride;
+					const Complex<float>* sb = r1 < _height ? _src + r1 * _srcStride : NULL;
+
+					/* Z_k = A_k + i B_k with the hermitian continuation of A and B */
+					for( size_t k = 0; k < _width; k++ ) {
+						Complex<float> a, b( 0.0f, 0.0f );
+						if( k < nc ) {
+							a = sa[ k ];
+							if( sb ) b = sb[ k ];
+						} else {
+							a = sa[ _width - k ].conj();
+							if( sb ) b = sb[ _width - k ].conj();
+						}
+						z[ k ].set( a.re - b.im, a.im + b.re );
+					}
+
+					_plan.transform( &z[ 0 ], 1, true, &scratch[ 0 ] );
+
+					float* da = ( float* ) ( _dst + r0 * _dstStride );
+					for( size_t x = 0; x < _width; x++ )
+						da[ x ] = z[ x ].re * _scale;
+					if( sb ) {
+						float* db = ( float* ) ( _dst + r1 * _dstStride );
+						for( size_t x = 0; x < _width; x++ )
+							db[ x ] = z[ x ].im * _scale;
+					}
+				}
+			}
+
+		private:
+			uint8_t*				_dst;
+			size_t					_dstStride;
+			const Complex<float>*	_src;
+			size_t					_srcStride;
+			size_t					_width;
+			size_t					_height;
+			const FFTPlan&			_plan;
+			float					_scale;
+	};
+
+	/* columns are gathered in blocks of FFT_COLUMN_BATCH and transformed as one batch */
+	class FFTColumns {
+		public:
+			FFTColumns( Complex<float>* data, size_t stride, size_t columns, size_t height, bool backward ) :
+				_data( data ), _stride( stride ), _columns( columns ), _height( height ),
+				_backward( backward ), _plan( FFTPlan::get( height ) )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				std::vector<Complex<float> > buf( _height * FFT_COLUMN_BATCH ), scratch( _height * FFT_COLUMN_BATCH );
+
+				for( size_t block = begin; block < end; block++ ) {
+					size_t c0 = block * FFT_COLUMN_BATCH;
+					size_t n = Math::min( FFT_COLUMN_BATCH, _columns - c0 );
+
+					for( size_t y = 0; y < _height; y++ )
+						std::copy( _data + y * _stride + c0, _data + y * _stride + c0 + n, &buf[ y * n ] );
+					_plan.transform( &buf[ 0 ], n, _backward, &scratch[ 0 ] );
+					for( size_t y = 0; y < _height; y++ )
+						std::copy( &buf[ y * n ], &buf[ y * n ] + n, _data + y * _stride + c0 );
+				}
+			}
+
+		private:
+			Complex<float>* _data;
+			size_t			_stride;
+			size_t			_columns;
+			size_t			_height;
+			bool			_backward;
+			const FFTPlan&	_plan;
+	};
+
+	void FFT::realForward2D( Complex<float>* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height )
+	{
+		if( !width || !height )
+			return;
+		const size_t nc = width / 2 + 1;
+
+		FFTRealRowsForward rows( dst, dstStride, src, srcStride, width, height );
+		ParallelFor::run( rows, 0, ( height + 1 ) / 2 );
+
+		FFTColumns cols( dst, dstStride, nc, height, false );
+		ParallelFor::run( cols, 0, ( nc + FFT_COLUMN_BATCH - 1 ) / FFT_COLUMN_BATCH );
+	}
+
+	void FFT::realInverse2D( float* dst, size_t dstStride, const Complex<float>* src, size_t srcStride, size_t width, size_t height )
+	{
+		if( !width || !height )
+			return;
+		const size_t nc = width / 2 + 1;
+
+		/* the column pass works on a copy of the spectrum */
+		std::vector<Complex<float> > tmp( nc * height );
+		for( size_t y = 0; y < height; y++ )
+			std::copy( src + y * srcStride, src + y * srcStride + nc, &tmp[ y * nc ] );
+
+		FFTColumns cols( &tmp[ 0 ], nc, nc, height, true );
+		ParallelFor::run( cols, 0, ( nc + FFT_COLUMN_BATCH - 1 ) / FFT_COLUMN_BATCH );
+
+		FFTRealRowsInverse rows( dst, dstStride, &tmp[ 0 ], nc, width, height );
+		ParallelFor::run( rows, 0, ( height + 1 ) / 2 );
+	}
+
 }
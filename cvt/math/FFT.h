@@ -26,8 +26,59 @@
 #define CVT_FFT_H
 
 #include <cvt/math/Complex.h>
+#include <vector>
 
 namespace cvt {
+
+	/**
+	  \ingroup Math
+	  \brief Mixed radix ( 4, 2, 3, 5 and generic ) complex FFT plan of fixed length
+
+	  The twiddle factors of all stages are precomputed, the transform itself is a
+	  Stockham autosort FFT and does not need a bit reversal.
+	  Plans are immutable and can be shared between threads, get() returns a cached plan.
+	*/
+	class FFTPlan {
+		public:
+			FFTPlan( size_t n );
+
+			size_t size() const { return _n; }
+
+			/**
+			  Transform batch interleaved sequences in place: element i of sequence b is
+			  data[ i * batch + b ]. The inner loops run over the batch, so transforming
+			  several columns at once vectorizes well.
+			  The backward transform is not normalized.
+			  \param scratch	buffer of size() * batch elements
+			*/
+			void transform( Complex<float>* data, size_t batch, bool backward, Complex<float>* scratch ) const;
+
+			/* only factors 2, 3 and 5 */
+			static bool			  isFastSize( size_t n );
+			/* smallest fast size >= n */
+			static size_t		  fastSize( size_t n );
+			/* cached plan for length n */
+			static const FFTPlan& get( size_t n );
+
+		private:
+			FFTPlan( const FFTPlan& );
+			FFTPlan& operator=( const FFTPlan& );
+
+			struct Stage {
+				size_t radix;
+				size_t m;
+				/* offset of the twiddles [ m ][ radix - 1 ] */
+				size_t twiddle;
+				/* offset of the radix roots, generic radix only */
+				size_t roots;
+			};
+
+			size_t						 _n;
+			std::vector<Stage>			 _stages;
+			std::vector<Complex<float> > _twiddles;
+			std::vector<Complex<float> > _twiddlesInv;
+	};
+
 	class FFT {
 		public:
 			template<typename T>
@@ -36,6 +87,21 @@ namespace cvt {
 			template<typename T>
 			static void fftStridedRadix2( Complex<T>* data, size_t n, size_t stride, bool inverse );
 
+			/**
+			  Real to complex 2D FFT of a width x height float image.
+			  Only the non-redundant half spectrum of ( width / 2 + 1 ) x height
+			  elements is stored. Rows and columns are transformed in parallel.
+			  \param dstStride	stride of dst in elements
+			  \param srcStride	stride of src in bytes
+			*/
+			static void realForward2D( Complex<float>* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height );
+
+			/**
+			  Inverse of realForward2D, the result is normalized.
+			  \param dstStride	stride of dst in bytes
+			  \param srcStride	stride of src in elements
+			*/
+			static void realInverse2D( float* dst, size_t dstStride, const Complex<float>* src, size_t srcStride, size_t width, size_t height );
 
 		private:
 			FFT();
@@ -0,0 +1,258 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/math/FFT.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IConvolve.h>
+#include <cvt/gfx/IFourier.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/RNG.h>
+
+namespace cvt {
+
+	static bool _testPlan( RNG& rng, size_t n, size_t batch )
+	{
+		std::vector<Complex<float> > data( n * batch ), orig, scratch( n * batch );
+		for( size_t i = 0; i < n * batch; i++ )
+			data[ i ].set( rng.uniform( -1.0f, 1.0f ), rng.uniform( -1.0f, 1.0f ) );
+		orig = data;
+
+		FFTPlan::get( n ).transform( &data[ 0 ], batch, false, &scratch[ 0 ] );
+
+		/* compare with the naive DFT */
+		double maxErr = 0.0;
+		for( size_t b = 0; b < batch; b++ ) {
+			for( size_t k = 0; k < n; k++ ) {
+				double re = 0.0, im = 0.0;
+				for( size_t j = 0; j < n; j++ ) {
+					double phi = -2.0 * Math::PI * ( double ) ( ( j * k ) % n ) / ( double ) n;
+					const Complex<float>& c = orig[ j * batch + b ];
+					re += c.re * Math::cos( phi ) - c.im * Math::sin( phi );
+					im += c.re * Math::sin( phi ) + c.im * Math::cos( phi );
+				}
+				const Complex<float>& c = data[ k * batch + b ];
+				maxErr = Math::max( maxErr, Math::sqrt( Math::sqr( re - c.re ) + Math::sqr( im - c.im ) ) / Math::sqrt( ( double ) n ) );
+			}
+		}
+
+		/* and back */
+		FFTPlan::get( n ).transform( &data[ 0 ], batch, true, &scratch[ 0 ] );
+		for( size_t i = 0; i < n * batch; i++ ) {
+			Complex<float> d = data[ i ] / ( float ) n - orig[ i ];
+			maxErr = Math::max( maxErr, ( double ) d.abs() );
+		}
+
+		if( maxErr > 1e-5 ) {
+			std::cout << "FFT size " << n << " batch " << batch << " error: " << maxErr << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	static bool _testReal2D( RNG& rng, size_t w, size_t h )
+	{
+		Image img( w, h, IFormat::GRAY_FLOAT ), spectrum, back;
+		{
+			IMapScoped<float> map( img );
+			for( size_t y = 0; y < h; y++ ) {
+				for( size_t x = 0; x < w; x++ )
+					map.ptr()[ x ] = rng.uniform( -1.0f, 1.0f );
+				map++;
+			}
+		}
+
+		IFourier::forward( spectrum, img );
+		IFourier::inverse( back, spectrum, w );
+
+		IMapScoped<const float> m1( img );
+		IMapScoped<const float> m2( back );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				if( Math::abs( m1.ptr()[ x ] - m2.ptr()[ x ] ) > 1e-5f ) {
+					std::cout << "Roundtrip " << w << "x" << h << " failed at " << x << ", " << y << std::endl;
+					return false;
+				}
+			}
+			m1++;
+			m2++;
+		}
+		return true;
+	}
+
+	static bool _testConvolve( RNG& rng )
+	{
+		size_t w = 80, h = 61;
+		Image src( w, h, IFormat::GRAY_FLOAT ), spatial( w, h, IFormat::GRAY_FLOAT ), fourier;
+		{
+			IMapScoped<float> map( src );
+			for( size_t y = 0; y < h; y++ ) {
+				for( size_t x = 0; x < w; x++ )
+					map.ptr()[ x ] = rng.uniform( 0.0f, 1.0f );
+				map++;
+			}
+		}
+
+		/* below the threshold IConvolve stays in the spatial domain */
+		IKernel kernel( 21, 17 );
+		for( size_t y = 0; y < kernel.height(); y++ )
+			for( size_t x = 0; x < kernel.width(); x++ )
+				kernel( x, y ) = rng.uniform( -1.0f, 1.0f );
+
+		IConvolve::convolve( spatial, src, kernel, IBORDER_MIRROR );
+		IFourier::convolve( fourier, src, kernel, IBORDER_MIRROR );
+
+		IMapScoped<const float> m1( spatial );
+		IMapScoped<const float> m2( fourier );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				if( Math::abs( m1.ptr()[ x ] - m2.ptr()[ x ] ) > 1e-3f ) {
+					std::cout << "Convolution differs at " << x << ", " << y << ": " << m1.ptr()[ x ] << " " << m2.ptr()[ x ] << std::endl;
+					return false;
+				}
+			}
+			m1++;
+			m2++;
+		}
+		return true;
+	}
+
+	/* kernels of at least FFT_KERNEL_SIZE are convolved via FFT by IConvolve, compare with the direct sum */
+	static bool _testConvolveLarge( RNG& rng )
+	{
+		ssize_t w = 70, h = 53;
+		Image src( w, h, IFormat::GRAY_FLOAT ), dst( w, h, IFormat::GRAY_FLOAT ), fourier;
+		{
+			IMapScoped<float> map( src );
+			for( ssize_t y = 0; y < h; y++ ) {
+				for( ssize_t x = 0; x < w; x++ )
+					map.ptr()[ x ] = rng.uniform( 0.0f, 1.0f );
+				map++;
+			}
+		}
+
+		IKernel kernel( IConvolve::FFT_KERNEL_SIZE + 2, IConvolve::FFT_KERNEL_SIZE );
+		for( size_t y = 0; y < kernel.height(); y++ )
+			for( size_t x = 0; x < kernel.width(); x++ )
+				kernel( x, y ) = rng.uniform( -1.0f, 1.0f ) / ( float ) IConvolve::FFT_KERNEL_SIZE;
+
+		IConvolve::convolve( dst, src, kernel, IBORDER_MIRROR );
+		IFourier::convolve( fourier, src, kernel, IBORDER_MIRROR );
+
+		ssize_t kw = kernel.width(), kh = kernel.height();
+		ssize_t bx = kw >> 1, by = kh >> 1;
+		IMapScoped<const float> ms( src );
+		IMapScoped<const float> m1( dst );
+		IMapScoped<const float> m2( fourier );
+		for( ssize_t y = 0; y < h; y++ ) {
+			for( ssize_t x = 0; x < w; x++ ) {
+				double ref = 0.0;
+				for( ssize_t ky = 0; ky < kh; ky++ ) {
+					const float* line = ms.line( IBorder::value<ssize_t>( y - by + ky, h, IBORDER_MIRROR ) );
+					for( ssize_t kx = 0; kx < kw; kx++ )
+						ref += ( double ) kernel( kx, ky ) * line[ IBorder::value<ssize_t>( x - bx + kx, w, IBORDER_MIRROR ) ];
+				}
+
+				/* bitwise equality with IFourier shows that the FFT path was taken */
+				if( m1.ptr()[ x ] != m2.ptr()[ x ] || Math::abs( m1.ptr()[ x ] - ref ) > 1e-4 ) {
+					std::cout << "Large convolution differs at " << x << ", " << y << ": " << m1.ptr()[ x ] << " " << m2.ptr()[ x ] << " " << ref << std::endl;
+					return false;
+				}
+			}
+			m1++;
+			m2++;
+		}
+		return true;
+	}
+
+	static bool _testPhaseCorrelation( RNG& rng )
+	{
+		size_t w = 128, h = 96;
+		const float tx = 7.3f, ty = -4.6f;
+		Image a( w, h, IFormat::GRAY_FLOAT ), b( w, h, IFormat::GRAY_FLOAT );
+
+		/* random blobs */
+		std::vector<Vector2f> blobs( 40 );
+		for( size_t i = 0; i < blobs.size(); i++ )
+			blobs[ i ].set( rng.uniform( 0.0f, ( float ) w ), rng.uniform( 0.0f, ( float ) h ) );
+
+		IMapScoped<float> ma( a );
+		IMapScoped<float> mb( b );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				float va = 0.0f, vb = 0.0f;
+				for( size_t i = 0; i < blobs.size(); i++ ) {
+					va += Math::exp( -( Vector2f( x, y ) - blobs[ i ] ).lengthSqr() / 18.0f );
+					vb += Math::exp( -( Vector2f( x - tx, y - ty ) - blobs[ i ] ).lengthSqr() / 18.0f );
+				}
+				ma.ptr()[ x ] = va;
+				mb.ptr()[ x ] = vb;
+			}
+			ma++;
+			mb++;
+		}
+
+		Vector2f t = IFourier::phaseCorrelation( a, b );
+		if( Math::abs( t.x - tx ) > 0.5f || Math::abs( t.y - ty ) > 0.5f ) {
+			std::cout << "Estimated shift: " << t << " true: " << Vector2f( tx, ty ) << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+BEGIN_CVTTEST( FFT )
+	bool ret = true;
+	bool b;
+	RNG rng( 1234 );
+
+	const size_t sizes[] = { 1, 2, 3, 4, 5, 6, 7, 8, 12, 15, 30, 49, 60, 64, 77, 100, 243, 250, 256 };
+	b = true;
+	for( size_t i = 0; i < sizeof( sizes ) / sizeof( sizes[ 0 ] ); i++ ) {
+		b &= _testPlan( rng, sizes[ i ], 1 );
+		b &= _testPlan( rng, sizes[ i ], 5 );
+	}
+	CVTTEST_PRINT( "FFTPlan mixed radix", b );
+	ret &= b;
+
+	b = _testReal2D( rng, 64, 48 ) && _testReal2D( rng, 33, 17 ) && _testReal2D( rng, 1, 7 ) && _testReal2D( rng, 100, 75 );
+	CVTTEST_PRINT( "Real 2D FFT roundtrip", b );
+	ret &= b;
+
+	b = _testConvolve( rng );
+	CVTTEST_PRINT( "FFT convolution", b );
+	ret &= b;
+
+	b = _testConvolveLarge( rng );
+	CVTTEST_PRINT( "IConvolve FFT for large kernels", b );
+	ret &= b;
+
+	b = _testPhaseCorrelation( rng );
+	CVTTEST_PRINT( "Phase correlation", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
+
+}
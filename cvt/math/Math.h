@@ -141,6 +141,55 @@ namespace cvt {
             return u.f;
         }
 
+        /**
+         *  Convert IEEE 754 half precision value to float
+         */
+        static inline float halfToFloat( uint16_t h )
+        {
+            static const uint32_t shiftedexp = 0x7c00 << 13;
+            _flint32 u, magic;
+
+            magic.i = 113 << 23;
+            u.i = ( h & 0x7fff ) << 13;
+            uint32_t exp = shiftedexp & u.i;
+            u.i += ( 127 - 15 ) << 23;
+
+            if( exp == shiftedexp ) {
+                /* Inf/NaN */
+                u.i += ( 128 - 16 ) << 23;
+            } else if( exp == 0 ) {
+                /* zero/denormal */
+                u.i += 1 << 23;
+                u.f -= magic.f;
+            }
+            u.i |= ( uint32_t ) ( h & 0x8000 ) << 16;
+            return u.f;
+        }
+
+        /**
+         *  Convert float to IEEE 754 half precision value, round to nearest even
+         */
+        static inline uint16_t floatToHalf( float f )
+        {
+            _flint32 u, denorm;
+            u.f = f;
+            uint32_t sign = ( u.i >> 16 ) & 0x8000;
+            u.i &= 0x7fffffff;
+
+            if( u.i >= 0x47800000 ) {
+                /* overflow to Inf or NaN */
+                return sign | ( u.i > 0x7f800000 ? 0x7e00 : 0x7c00 );
+            } else if( u.i < 0x38800000 ) {
+                /* zero/denormal - let the FPU do the rounding */
+                denorm.i = ( 127 - 15 + 23 - 10 + 1 ) << 23;
+                u.f += denorm.f;
+                return sign | ( uint16_t ) ( u.i - denorm.i );
+            }
+            uint32_t mantodd = ( u.i >> 13 ) & 1;
+            u.i += ( ( uint32_t ) ( 15 - 127 ) << 23 ) + 0xfff + mantodd;
+            return sign | ( uint16_t ) ( u.i >> 13 );
+        }
+
         template<typename T>
             static inline T epsilon()
             {
@@ -378,7 +427,7 @@ namespace cvt {
             return ::powf( x, y );
         }
 
-
+        /* global libc generator, use RNG for reproducible or parallel sampling */
         static inline ssize_t rand()
         {
             return ( ssize_t ) ::random();
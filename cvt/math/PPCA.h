@@ -28,6 +28,7 @@
 #include <vector>
 #include <cvt/util/Exception.h>
 #include <cvt/math/Math.h>
+#include <cvt/util/RNG.h>
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include <Eigen/LU>
@@ -54,7 +55,7 @@ namespace cvt {
 				void addSample( const VectorType& sample );
 				void addSample( const T* sample );
 
-				void setRandomMeans();
+				void setRandomMeans( uint64_t seed = 0 );
 				void setMean( size_t index, const VectorType& value );
 
 				virtual void preprocessSample( VectorType& output, const VectorType& mean, const VectorType& value );
@@ -141,10 +142,11 @@ namespace cvt {
 
 
 	template<typename T>
-		inline void PPCA<T>::setRandomMeans()
+		inline void PPCA<T>::setRandomMeans( uint64_t seed )
 		{
+			RNG rng( seed );
 			for( size_t i = 0; i < _mixcomponents; i++ ) {
-				_means[ i ] = _samples[ Math::rand( 0, _samples.size() - 1 ) ];
+				_means[ i ] = _samples[ rng.uint32( _samples.size() ) ];
 				postprocessMean( _means[ i ] );
 			}
 		}
@@ -34,6 +34,7 @@
 
 #include <cvt/math/Math.h>
 #include <cvt/math/sac/SampleConsensusModel.h>
+#include <cvt/util/RNG.h>
 
 namespace cvt
 {
@@ -46,8 +47,9 @@ namespace cvt
 
         RANSAC( SampleConsensusModel<Model> & model,
                 DistanceType maxDistance,
-                float outlierProb = 0.05f ) :
-            _model( model ), _maxDistance( maxDistance ), _outlierProb( outlierProb )
+                float outlierProb = 0.05f,
+                uint64_t seed = 0 ) :
+            _model( model ), _maxDistance( maxDistance ), _outlierProb( outlierProb ), _rng( seed )
         {
         }
 
@@ -61,6 +63,7 @@ namespace cvt
         DistanceType                  _maxDistance;
         float                         _outlierProb;
         std::vector<size_t>           _lastInliers;
+        RNG                           _rng;
 
         void randomSamples( std::vector<size_t> & indices );
     };
@@ -121,7 +124,7 @@ namespace cvt
 
 		size_t idx;
 		while( indices.size() < _model.minSampleSize() ){
-			idx = Math::rand( 0, _model.size() - 1 );
+			idx = _rng.uint32( _model.size() );
 
             bool insert = true;
             for( size_t i = 0; i < indices.size(); i++ ){
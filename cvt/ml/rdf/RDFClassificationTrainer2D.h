@@ -31,6 +31,7 @@
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/ml/rdf/RDFClassifier.h>
+#include <cvt/util/RNG.h>
 
 namespace cvt {
 
@@ -39,7 +40,7 @@ namespace cvt {
 			public:
 				RDFTestLinear2D( const Vector2f& vec, float threshold  ) : _norm( vec ), _threshold( threshold ) {}
 
-				bool operator()( const Vector2f& other )
+				bool operator()( const Vector2f& other ) const
 				{
 					return Math::abs( _norm.x *  other.x + _norm.y * other.y ) < _threshold;
 				}
@@ -52,7 +53,7 @@ namespace cvt {
 		class RDFClassificationTrainer2D : public RDFClassificationTrainer<Vector2f,std::vector<Vector3f>,2>
 		{
 			public:
-				RDFClassificationTrainer2D( size_t numberOfClasses ) : _numClasses( numberOfClasses )
+				RDFClassificationTrainer2D( size_t numberOfClasses, uint64_t seed = 0 ) : _numClasses( numberOfClasses ), _rng( seed )
 				{
 				}
 
@@ -67,9 +68,9 @@ namespace cvt {
 
 				virtual RDFTest<Vector2f>*  randomTest()
 				{
-					float x = Math::rand( -1.0f, 1.0f );
+					float x = _rng.uniform( -1.0f, 1.0f );
 					float y = Math::sqrt( 1.0f - Math::sqr( x ) );
-					return new RDFTestLinear2D( Vector2f( x, y ), Math::rand( -10000.0f, 10000.0f  ) );
+					return new RDFTestLinear2D( Vector2f( x, y ), _rng.uniform( -10000.0f, 10000.0f  ) );
 				}
 
 				virtual size_t classLabel( const std::vector<Vector3f>& data, size_t index )
@@ -86,6 +87,7 @@ namespace cvt {
 
 			private:
 				size_t _numClasses;
+				RNG	   _rng;
 		};
 
 
@@ -37,6 +37,8 @@ namespace cvt {
 			~RDFClassificationTree();
 
 			const RDFClassHistogram<N>& classify( const DATA& d );
+
+			RDFNode<DATA,RDFClassHistogram<N> >* root() const { return _root; }
 		private:
 			RDFClassificationTree( const RDFClassificationTree<DATA,N>& );
 
@@ -0,0 +1,367 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_RDFFLATCLASSIFIER_H
+#define CVT_RDFFLATCLASSIFIER_H
+
+#include <vector>
+#include <deque>
+#include <stdint.h>
+
+#include <cvt/ml/rdf/RDFClassifier.h>
+#include <cvt/gfx/Image.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	/**
+	  Compiled form of a classification forest for fast inference.
+
+	  The inner nodes of all trees are stored breadth-first in one array,
+	  the split parameters are stored inline as a copy of the concrete test
+	  type TEST. Tests are therefore called without virtual dispatch. The leaf histograms are converted to
+	  a packed table of probabilities, pre-divided by the number of trees,
+	  so the forest posterior is the plain sum of the leaf rows.
+
+	  TEST has to be the (copyable) type of all tests in the trees.
+	  In contrast to RDFClassifier, which sums the raw histograms, the
+	  posterior is the average of the per tree leaf distributions.
+	 */
+	template<typename DATA, size_t N, typename TEST>
+	class RDFFlatClassifier {
+		public:
+			RDFFlatClassifier();
+			RDFFlatClassifier( const RDFClassifier<DATA,N>& classifier );
+			~RDFFlatClassifier();
+
+			/* flattens the tree, throws if a test is not of type TEST */
+			void	addTree( const RDFClassificationTree<DATA,N>& tree );
+			size_t  treeCount() const { return _roots.size(); }
+			size_t  nodeCount() const { return _nodes.size(); }
+			size_t  leafCount() const { return _leaves.size() / N; }
+
+			/* posterior of the forest, returns the most probable class */
+			size_t	classify( float* probability, const DATA& data ) const;
+
+			/* posteriors for n samples ( n * N values ) */
+			void	classify( float* probabilities, const DATA* data, size_t n ) const;
+
+			/**
+			  Per pixel classification of a width x height image.
+			  sampler( DATA&, x, y ) creates the sample of a pixel.
+			  labels ( GRAY_UINT8 ) receives the most probable class,
+			  the optional confidence image ( GRAY_FLOAT ) its probability.
+			 */
+			template<typename SAMPLER>
+			void	classify( Image& labels, Image* confidence, const SAMPLER& sampler, size_t width, size_t height ) const;
+
+		private:
+			enum { LANES = 16, TILESIZE = 64 };
+
+			struct Node {
+				Node( const TEST& t ) : test( t ) {}
+
+				TEST		test;
+				/* left/right child: index of an inner node or ~row in the leaf table */
+				int32_t		child[ 2 ];
+			};
+
+			template<typename SAMPLER>
+			class TileTask {
+				public:
+					TileTask( const RDFFlatClassifier<DATA,N,TEST>& forest, const SAMPLER& sampler, size_t width, size_t height,
+							  uint8_t* labels, size_t lstride, uint8_t* conf, size_t cstride );
+					void operator()( size_t begin, size_t end );
+
+				private:
+					const RDFFlatClassifier<DATA,N,TEST>& _forest;
+					const SAMPLER&	_sampler;
+					size_t			_width;
+					size_t			_height;
+					size_t			_tilesX;
+					uint8_t*		_labels;
+					size_t			_lstride;
+					uint8_t*		_conf;
+					size_t			_cstride;
+			};
+
+			bool		 evaluate( const Node& node, const DATA& data ) const;
+			void		 classifyLanes( float* probabilities, const DATA* data, size_t n ) const;
+			static size_t argmax( const float* prob );
+
+			std::vector<Node>		_nodes;
+			std::vector<int32_t>	_roots;
+			std::vector<float>		_leaves;
+	};
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFFlatClassifier<DATA,N,TEST>::RDFFlatClassifier()
+	{
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFFlatClassifier<DATA,N,TEST>::RDFFlatClassifier( const RDFClassifier<DATA,N>& classifier )
+	{
+		for( size_t i = 0; i < classifier.treeCount(); i++ )
+			addTree( classifier.tree( i ) );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline RDFFlatClassifier<DATA,N,TEST>::~RDFFlatClassifier()
+	{
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFFlatClassifier<DATA,N,TEST>::addTree( const RDFClassificationTree<DATA,N>& tree )
+	{
+		typedef RDFNode<DATA,RDFClassHistogram<N> > TreeNode;
+
+		// references to be resolved: the tree node and the slot pointing to it
+		std::deque<std::pair<TreeNode*,int32_t*> > queue;
+		std::vector<Node> nodes;
+		std::vector<float> leaves;
+		int32_t root;
+
+		size_t numInner = 0;
+		std::deque<TreeNode*> count( 1, tree.root() );
+		while( !count.empty() ) {
+			TreeNode* tnode = count.front();
+			count.pop_front();
+			if( !tnode->isLeaf() ) {
+				numInner++;
+				count.push_back( tnode->left() );
+				count.push_back( tnode->right() );
+			}
+		}
+		// no reallocation, the queue holds pointers into nodes
+		nodes.reserve( numInner );
+
+		int32_t nodeOffset = _nodes.size();
+		int32_t leafOffset = _leaves.size() / N;
+		queue.push_back( std::make_pair( tree.root(), &root ) );
+
+		// breadth-first
+		while( !queue.empty() ) {
+			TreeNode* tnode = queue.front().first;
+			int32_t*  ref	= queue.front().second;
+			queue.pop_front();
+
+			if( tnode->isLeaf() ) {
+				*ref = ~( int32_t ) ( leafOffset + leaves.size() / N );
+				const RDFClassHistogram<N>& hist = *tnode->data();
+				for( size_t c = 0; c < N; c++ ) {
+					float p = hist.sampleCount() ? hist.probability( c ) : 1.0f / ( float ) N;
+					leaves.push_back( p );
+				}
+			} else {
+				TEST* test = dynamic_cast<TEST*>( tnode->test() );
+				if( !test )
+					throw CVTException( "RDFFlatClassifier: unexpected test type" );
+				*ref = nodeOffset + nodes.size();
+				nodes.push_back( Node( *test ) );
+				queue.push_back( std::make_pair( tnode->left(), &nodes.back().child[ 0 ] ) );
+				queue.push_back( std::make_pair( tnode->right(), &nodes.back().child[ 1 ] ) );
+			}
+		}
+
+		_roots.push_back( root );
+		_nodes.insert( _nodes.end(), nodes.begin(), nodes.end() );
+
+		// pre-normalize the leaf table by the number of trees
+		float scale = ( float ) ( _roots.size() - 1 ) / ( float ) _roots.size();
+		for( size_t i = 0; i < _leaves.size(); i++ )
+			_leaves[ i ] *= scale;
+		float inv = 1.0f / ( float ) _roots.size();
+		for( size_t i = 0; i < leaves.size(); i++ )
+			_leaves.push_back( leaves[ i ] * inv );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline bool RDFFlatClassifier<DATA,N,TEST>::evaluate( const Node& node, const DATA& data ) const
+	{
+		// call through the concrete type, no virtual dispatch
+		return node.test.TEST::operator()( data );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline size_t RDFFlatClassifier<DATA,N,TEST>::argmax( const float* prob )
+	{
+		size_t best = 0;
+		for( size_t c = 1; c < N; c++ )
+			if( prob[ c ] > prob[ best ] )
+				best = c;
+		return best;
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline size_t RDFFlatClassifier<DATA,N,TEST>::classify( float* prob, const DATA& data ) const
+	{
+		for( size_t c = 0; c < N; c++ )
+			prob[ c ] = 0.0f;
+
+		const Node* nodes = _nodes.empty() ? NULL : &_nodes[ 0 ];
+		for( size_t t = 0; t < _roots.size(); t++ ) {
+			int32_t idx = _roots[ t ];
+			while( idx >= 0 )
+				idx = nodes[ idx ].child[ evaluate( nodes[ idx ], data ) ];
+
+			const float* leaf = &_leaves[ ~idx * N ];
+			for( size_t c = 0; c < N; c++ )
+				prob[ c ] += leaf[ c ];
+		}
+		return argmax( prob );
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFFlatClassifier<DATA,N,TEST>::classifyLanes( float* prob, const DATA* data, size_t n ) const
+	{
+		int32_t idx[ LANES ];
+		const Node* nodes = _nodes.empty() ? NULL : &_nodes[ 0 ];
+
+		for( size_t i = 0; i < n * N; i++ )
+			prob[ i ] = 0.0f;
+
+		for( size_t t = 0; t < _roots.size(); t++ ) {
+			for( size_t l = 0; l < n; l++ )
+				idx[ l ] = _roots[ t ];
+
+			// all lanes descend one level per iteration, each on its own path
+			bool active = true;
+			while( active ) {
+				active = false;
+				for( size_t l = 0; l < n; l++ ) {
+					if( idx[ l ] >= 0 ) {
+						const Node& node = nodes[ idx[ l ] ];
+						idx[ l ] = node.child[ evaluate( node, data[ l ] ) ];
+						active = true;
+					}
+				}
+			}
+
+			for( size_t l = 0; l < n; l++ ) {
+				const float* leaf = &_leaves[ ~idx[ l ] * N ];
+				float* p = prob + l * N;
+				for( size_t c = 0; c < N; c++ )
+					p[ c ] += leaf[ c ];
+			}
+		}
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	inline void RDFFlatClassifier<DATA,N,TEST>::classify( float* prob, const DATA* data, size_t n ) const
+	{
+		if( _roots.empty() )
+			throw CVTException( "RDFFlatClassifier: no trees" );
+
+		while( n ) {
+			size_t num = n < ( size_t ) LANES ? n : ( size_t ) LANES;
+			classifyLanes( prob, data, num );
+			prob += num * N;
+			data += num;
+			n	 -= num;
+		}
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	template<typename SAMPLER>
+	inline RDFFlatClassifier<DATA,N,TEST>::TileTask<SAMPLER>::TileTask( const RDFFlatClassifier<DATA,N,TEST>& forest, const SAMPLER& sampler,
+																		size_t width, size_t height,
+																		uint8_t* labels, size_t lstride, uint8_t* conf, size_t cstride ) :
+		_forest( forest ),
+		_sampler( sampler ),
+		_width( width ),
+		_height( height ),
+		_tilesX( ( width + TILESIZE - 1 ) / TILESIZE ),
+		_labels( labels ),
+		_lstride( lstride ),
+		_conf( conf ),
+		_cstride( cstride )
+	{
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	template<typename SAMPLER>
+	inline void RDFFlatClassifier<DATA,N,TEST>::TileTask<SAMPLER>::operator()( size_t begin, size_t end )
+	{
+		DATA	samples[ LANES ];
+		float	prob[ LANES * N ];
+
+		for( size_t tile = begin; tile < end; tile++ ) {
+			size_t x0 = ( tile % _tilesX ) * TILESIZE;
+			size_t y0 = ( tile / _tilesX ) * TILESIZE;
+			size_t x1 = Math::min<size_t>( x0 + TILESIZE, _width );
+			size_t y1 = Math::min<size_t>( y0 + TILESIZE, _height );
+
+			for( size_t y = y0; y < y1; y++ ) {
+				uint8_t* lptr = _labels + y * _lstride;
+				float*	 cptr = _conf ? ( float* ) ( _conf + y * _cstride ) : NULL;
+
+				for( size_t x = x0; x < x1; x += LANES ) {
+					size_t n = Math::min<size_t>( LANES, x1 - x );
+					for( size_t l = 0; l < n; l++ )
+						_sampler( samples[ l ], x + l, y );
+
+					_forest.classifyLanes( prob, samples, n );
+
+					for( size_t l = 0; l < n; l++ ) {
+						size_t label = argmax( prob + l * N );
+						lptr[ x + l ] = ( uint8_t ) label;
+						if( cptr )
+							cptr[ x + l ] = prob[ l * N + label ];
+					}
+				}
+			}
+		}
+	}
+
+	template<typename DATA, size_t N, typename TEST>
+	template<typename SAMPLER>
+	inline void RDFFlatClassifier<DATA,N,TEST>::classify( Image& labels, Image* confidence, const SAMPLER& sampler, size_t width, size_t height ) const
+	{
+		if( _roots.empty() )
+			throw CVTException( "RDFFlatClassifier: no trees" );
+
+		labels.reallocate( width, height, IFormat::GRAY_UINT8 );
+		size_t lstride, cstride = 0;
+		uint8_t* lptr = labels.map( &lstride );
+		uint8_t* cptr = NULL;
+		if( confidence ) {
+			confidence->reallocate( width, height, IFormat::GRAY_FLOAT );
+			cptr = confidence->map( &cstride );
+		}
+
+		size_t numTiles = ( ( width + TILESIZE - 1 ) / TILESIZE ) * ( ( height + TILESIZE - 1 ) / TILESIZE );
+		TileTask<SAMPLER> task( *this, sampler, width, height, lptr, lstride, cptr, cstride );
+		ParallelFor::run( task, 0, numTiles, 1 );
+
+		labels.unmap( lptr );
+		if( confidence )
+			confidence->unmap( cptr );
+	}
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/ml/rdf/RDFFlatClassifier.h>
+#include <cvt/ml/rdf/RDFTestSamples.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/RNG.h>
+
+#include <new>
+
+namespace cvt {
+
+	namespace {
+
+		typedef RDFSampleTrainer<3> RDFTrainer;
+
+		/* three noisy angular sectors */
+		static void _rdfSamples( std::vector<RDFSample>& samples, size_t n, RNG& rng )
+		{
+			samples.resize( n );
+			for( size_t i = 0; i < n; i++ ) {
+				RDFSample& s = samples[ i ];
+				s.pos.set( rng.uniform( -1.0f, 1.0f ), rng.uniform( -1.0f, 1.0f ) );
+				float phi = Math::atan2( s.pos.y, s.pos.x ) + ( float ) Math::PI + rng.uniform( -0.3f, 0.3f );
+				s.label = Math::clamp<size_t>( ( size_t ) ( 3.0f * phi / ( float ) Math::TWO_PI ), 0, 2 );
+			}
+		}
+
+		class RDFSampler {
+			public:
+				RDFSampler( bool fail = false ) : _fail( fail ) {}
+
+				void operator()( Vector2f& d, size_t x, size_t y ) const
+				{
+					if( _fail && x == 70 && y == 70 )
+						throw std::bad_alloc();
+					d.set( ( float ) x / 50.0f - 1.0f, ( float ) y / 40.0f - 1.0f );
+				}
+
+			private:
+				bool _fail;
+		};
+
+	}
+
+BEGIN_CVTTEST( RDFFlatClassifier )
+	bool result = true;
+	bool b;
+	RNG rng( 42 );
+
+	std::vector<RDFSample> train, test;
+	_rdfSamples( train, 2000, rng );
+	_rdfSamples( test, 500, rng );
+
+	RDFTrainer trainer;
+	RDFTrainer::Parameters params;
+	params.maxDepth = 8;
+	params.numFeatures = 20;
+	params.bagging = 0.7f;
+	params.seed = 7;
+
+	const size_t numTrees = 5;
+	std::vector<RDFClassificationTree<Vector2f,3>*> trees;
+	RDFClassifier<Vector2f,3> forest;
+	for( size_t t = 0; t < numTrees; t++ ) {
+		trees.push_back( trainer.train( train, params, t ) );
+		forest.addTree( trees.back() );
+	}
+
+	RDFFlatClassifier<Vector2f,3,RDFThresholdTest<Vector2f> > flat( forest );
+	b = flat.treeCount() == numTrees && flat.nodeCount() > 0 && flat.leafCount() > numTrees;
+	CVTTEST_PRINT( "flatten", b );
+	result &= b;
+
+	/* the flat posterior is the average of the per tree leaf distributions */
+	std::vector<Vector2f> data( test.size() );
+	std::vector<float> batch( test.size() * 3 );
+	for( size_t i = 0; i < test.size(); i++ )
+		data[ i ] = test[ i ].pos;
+	flat.classify( &batch[ 0 ], &data[ 0 ], data.size() );
+
+	b = true;
+	size_t correct = 0;
+	for( size_t i = 0; i < test.size(); i++ ) {
+		float ref[ 3 ] = { 0.0f, 0.0f, 0.0f };
+		for( size_t t = 0; t < numTrees; t++ ) {
+			const RDFClassHistogram<3>& hist = trees[ t ]->classify( data[ i ] );
+			for( size_t c = 0; c < 3; c++ )
+				ref[ c ] += hist.probability( c ) / ( float ) numTrees;
+		}
+
+		float prob[ 3 ];
+		size_t label = flat.classify( prob, data[ i ] );
+		size_t refLabel = 0;
+		for( size_t c = 0; c < 3; c++ ) {
+			b &= Math::abs( prob[ c ] - ref[ c ] ) < 1e-5f && prob[ c ] == batch[ i * 3 + c ];
+			if( ref[ c ] > ref[ refLabel ] )
+				refLabel = c;
+		}
+		b &= label == refLabel;
+		correct += label == test[ i ].label ? 1 : 0;
+	}
+	b &= correct > test.size() * 8 / 10;
+	CVTTEST_PRINT( "flat matches tree classification", b );
+	result &= b;
+
+	Image labels, confidence;
+	flat.classify( labels, &confidence, RDFSampler(), 100, 80 );
+	b = labels.width() == 100 && labels.height() == 80;
+	{
+		IMapScoped<const uint8_t> lmap( labels );
+		IMapScoped<const float> cmap( confidence );
+		for( size_t y = 0; y < 80; y++ ) {
+			for( size_t x = 0; x < 100; x++ ) {
+				Vector2f d;
+				RDFSampler()( d, x, y );
+				float prob[ 3 ];
+				b &= lmap.ptr()[ x ] == flat.classify( prob, d ) && cmap.ptr()[ x ] == prob[ lmap.ptr()[ x ] ];
+			}
+			lmap++;
+			cmap++;
+		}
+	}
+	CVTTEST_PRINT( "image classification", b );
+	result &= b;
+
+	/* non cvt exceptions from the worker threads reach the caller */
+	try {
+		flat.classify( labels, NULL, RDFSampler( true ), 100, 80 );
+		b = false;
+	} catch( const Exception& ) {
+		b = true;
+	} catch( const std::bad_alloc& ) {
+		/* a pool without workers runs the blocks directly */
+		b = true;
+	}
+	CVTTEST_PRINT( "exception propagation", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
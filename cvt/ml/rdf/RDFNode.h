@@ -38,7 +38,7 @@ namespace cvt {
 			RDFNode( NODEDATA* data, RDFTest<DATA>*, RDFNode<DATA,NODEDATA>* left, RDFNode<DATA,NODEDATA>* right );
 			~RDFNode();
 
-			bool				    test( const DATA& data );
+			bool				    test( const DATA& data ) const;
 			RDFNode<DATA,NODEDATA>*	left();
 			RDFNode<DATA,NODEDATA>* right();
 			RDFTest<DATA>*			test();
@@ -80,7 +80,7 @@ namespace cvt {
 	}
 
 	template<typename DATA, typename NODEDATA>
-	inline bool RDFNode<DATA, NODEDATA>::test( const DATA& data )
+	inline bool RDFNode<DATA, NODEDATA>::test( const DATA& data ) const
 	{
 		return _test->operator()( data );
 	}
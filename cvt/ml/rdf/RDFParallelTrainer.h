@@ -0,0 +1,432 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_RDFPARALLELTRAINER_H
+#define CVT_RDFPARALLELTRAINER_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include <cvt/ml/rdf/RDFNode.h>
+#include <cvt/ml/rdf/RDFThresholdTest.h>
+#include <cvt/ml/rdf/RDFClassHistogram.h>
+#include <cvt/ml/rdf/RDFClassificationTree.h>
+#include <cvt/ml/rdf/RDFClassifier.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/RNG.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Exception.h>
+
+namespace cvt {
+
+	/**
+	  Trainer for forests of threshold tests ( RDFThresholdTest ).
+
+	  At every node the responses of each candidate feature are sorted once
+	  and all thresholds are evaluated in a single linear sweep. The sample
+	  indices of a tree are partitioned in place, the nodes work on ranges
+	  of the index array. Trees are trained in parallel if there are enough
+	  of them, otherwise the candidate features of large nodes are evaluated
+	  in parallel.
+
+	  dataSize, classLabel and trainingData are called from several threads,
+	  so is randomFeature if trees are trained in parallel, each call with the
+	  RNG of the tree being trained. The features have to be thread-safe.
+	  Every tree draws from its own random stream, the forest does not depend
+	  on the thread count as long as randomFeature only uses that RNG.
+	 */
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	class RDFParallelTrainer
+	{
+		public:
+			struct Parameters {
+				Parameters() :
+					maxDepth( 16 ),
+					numFeatures( 100 ),
+					minSamples( 2 ),
+					minGain( 0.0f ),
+					bagging( 1.0f ),
+					seed( 0 )
+				{
+				}
+
+				size_t	maxDepth;
+				/* candidate features per node */
+				size_t	numFeatures;
+				/* nodes with less samples become leaves */
+				size_t	minSamples;
+				float	minGain;
+				/* fraction of the samples drawn with replacement per tree, 1.0 uses all samples once */
+				float	bagging;
+				uint64_t seed;
+			};
+
+			RDFParallelTrainer();
+			virtual ~RDFParallelTrainer();
+
+			size_t						classCount() const { return N; }
+			virtual size_t				dataSize( const DATACOLLECTION& data ) = 0;
+			virtual RDFFeature<DATA>*	randomFeature( RNG& rng ) = 0;
+			virtual size_t				classLabel( const DATACOLLECTION& data, size_t index ) = 0;
+			virtual const DATA&			trainingData( const DATACOLLECTION& data, size_t index ) = 0;
+
+			RDFClassificationTree<DATA,N>* train( const DATACOLLECTION& data, const Parameters& params, size_t treeIndex = 0 );
+			void						   train( RDFClassifier<DATA,N>& forest, const DATACOLLECTION& data, const Parameters& params, size_t numTrees );
+
+		private:
+			typedef RDFNode<DATA,RDFClassHistogram<N> > Node;
+
+			struct Split {
+				Split() : gain( 0.0f ), threshold( 0.0f ), feature( NULL ) {}
+
+				float				gain;
+				float				threshold;
+				RDFFeature<DATA>*	feature;
+			};
+
+			/* buffers of the split search, reused by the thread holding them */
+			struct Scratch {
+				std::vector<const DATA*> samples;
+				std::vector<float>		resp;
+				std::vector<uint64_t>	sorted;
+			};
+
+			/* state of one tree */
+			struct TreeContext {
+				TreeContext( uint64_t seed, uint64_t stream ) : rng( seed, stream ) {}
+				~TreeContext()
+				{
+					for( size_t i = 0; i < scratch.size(); i++ )
+						delete scratch[ i ];
+				}
+
+				/* at most one scratch per thread working on the tree */
+				Scratch* acquireScratch()
+				{
+					ScopeLock lock( &scratchMutex );
+					if( scratch.empty() )
+						return new Scratch();
+					Scratch* s = scratch.back();
+					scratch.pop_back();
+					return s;
+				}
+
+				void releaseScratch( Scratch* s )
+				{
+					ScopeLock lock( &scratchMutex );
+					scratch.push_back( s );
+				}
+
+				RNG						rng;
+				std::vector<uint32_t>	indices;
+				std::vector<const DATA*> samples;
+				std::vector<uint8_t>	labels;
+				/* x * log2( x ) for all possible counts */
+				std::vector<double>		xlogx;
+				const Parameters*		params;
+				std::vector<Scratch*>	scratch;
+				Mutex					scratchMutex;
+
+				private:
+					TreeContext( const TreeContext& );
+					TreeContext& operator=( const TreeContext& );
+			};
+
+			class FeatureTask {
+				public:
+					FeatureTask( TreeContext& ctx, size_t begin, size_t end, const size_t* counts, std::vector<Split>& splits ) :
+						_ctx( ctx ), _begin( begin ), _end( end ), _counts( counts ), _splits( splits )
+					{
+					}
+
+					void operator()( size_t begin, size_t end )
+					{
+						Scratch* scratch = _ctx.acquireScratch();
+						try {
+							for( size_t i = begin; i < end; i++ )
+								RDFParallelTrainer<DATA,DATACOLLECTION,N>::bestThreshold( _splits[ i ], *scratch, _ctx, _begin, _end, _counts );
+						} catch( ... ) {
+							_ctx.releaseScratch( scratch );
+							throw;
+						}
+						_ctx.releaseScratch( scratch );
+					}
+
+				private:
+					TreeContext&		_ctx;
+					size_t				_begin;
+					size_t				_end;
+					const size_t*		_counts;
+					std::vector<Split>& _splits;
+			};
+
+			class TreeTask {
+				public:
+					TreeTask( RDFParallelTrainer<DATA,DATACOLLECTION,N>& trainer, const DATACOLLECTION& data, const Parameters& params,
+							  std::vector<RDFClassificationTree<DATA,N>*>& trees ) :
+						_trainer( trainer ), _data( data ), _params( params ), _trees( trees )
+					{
+					}
+
+					void operator()( size_t begin, size_t end )
+					{
+						for( size_t i = begin; i < end; i++ )
+							_trees[ i ] = _trainer.train( _data, _params, i );
+					}
+
+				private:
+					RDFParallelTrainer<DATA,DATACOLLECTION,N>& _trainer;
+					const DATACOLLECTION&	_data;
+					const Parameters&		_params;
+					std::vector<RDFClassificationTree<DATA,N>*>& _trees;
+			};
+
+			Node*		 trainNode( TreeContext& ctx, size_t begin, size_t end, const size_t* counts, size_t depth );
+			static Node* makeLeaf( const size_t* counts );
+			static void  bestThreshold( Split& split, Scratch& scratch, const TreeContext& ctx, size_t begin, size_t end, const size_t* counts );
+			static float decodeKey( uint64_t key );
+	};
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline RDFParallelTrainer<DATA,DATACOLLECTION,N>::RDFParallelTrainer()
+	{
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline RDFParallelTrainer<DATA,DATACOLLECTION,N>::~RDFParallelTrainer()
+	{
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline RDFClassificationTree<DATA,N>* RDFParallelTrainer<DATA,DATACOLLECTION,N>::train( const DATACOLLECTION& data, const Parameters& params, size_t treeIndex )
+	{
+		if( N > 256 )
+			throw CVTException( "RDFParallelTrainer: too many classes" );
+
+		// one random stream per tree
+		TreeContext ctx( params.seed, treeIndex );
+		ctx.params = &params;
+
+		const size_t size = dataSize( data );
+		ctx.samples.resize( size );
+		ctx.labels.resize( size );
+		for( size_t i = 0; i < size; i++ ) {
+			ctx.samples[ i ] = &trainingData( data, i );
+			ctx.labels[ i ]	 = ( uint8_t ) classLabel( data, i );
+		}
+
+		// bagging: draw with replacement
+		if( params.bagging < 1.0f ) {
+			size_t num = Math::max<size_t>( 1, ( size_t ) ( params.bagging * size ) );
+			ctx.indices.resize( num );
+			for( size_t i = 0; i < num; i++ )
+				ctx.indices[ i ] = ctx.rng.uint32( size );
+		} else {
+			ctx.indices.resize( size );
+			for( size_t i = 0; i < size; i++ )
+				ctx.indices[ i ] = i;
+		}
+
+		ctx.xlogx.resize( ctx.indices.size() + 1 );
+		ctx.xlogx[ 0 ] = 0.0f;
+		for( size_t i = 1; i < ctx.xlogx.size(); i++ )
+			ctx.xlogx[ i ] = ( double ) i * Math::log2( ( double ) i );
+
+		size_t counts[ N ] = { 0 };
+		for( size_t i = 0; i < ctx.indices.size(); i++ )
+			counts[ ctx.labels[ ctx.indices[ i ] ] ]++;
+
+		return new RDFClassificationTree<DATA,N>( trainNode( ctx, 0, ctx.indices.size(), counts, 0 ) );
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline void RDFParallelTrainer<DATA,DATACOLLECTION,N>::train( RDFClassifier<DATA,N>& forest, const DATACOLLECTION& data, const Parameters& params, size_t numTrees )
+	{
+		std::vector<RDFClassificationTree<DATA,N>*> trees( numTrees, ( RDFClassificationTree<DATA,N>* ) NULL );
+
+		if( numTrees >= ParallelFor::numThreads() ) {
+			TreeTask task( *this, data, params, trees );
+			ParallelFor::run( task, 0, numTrees, 1 );
+		} else {
+			// too few trees, parallelize within the nodes instead
+			for( size_t i = 0; i < numTrees; i++ )
+				trees[ i ] = train( data, params, i );
+		}
+
+		for( size_t i = 0; i < numTrees; i++ )
+			forest.addTree( trees[ i ] );
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline typename RDFParallelTrainer<DATA,DATACOLLECTION,N>::Node* RDFParallelTrainer<DATA,DATACOLLECTION,N>::makeLeaf( const size_t* counts )
+	{
+		RDFClassHistogram<N>* hist = new RDFClassHistogram<N>();
+		for( size_t c = 0; c < N; c++ )
+			hist->addSamples( c, counts[ c ] );
+		return new Node( hist, NULL, NULL, NULL );
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline void RDFParallelTrainer<DATA,DATACOLLECTION,N>::bestThreshold( Split& split, Scratch& scratch, const TreeContext& ctx, size_t begin, size_t end, const size_t* counts )
+	{
+		const size_t n = end - begin;
+		std::vector<const DATA*>& samples = scratch.samples;
+		std::vector<float>& resp = scratch.resp;
+		std::vector<uint64_t>& sorted = scratch.sorted;
+		samples.resize( n );
+		resp.resize( n );
+		sorted.resize( n );
+
+		for( size_t i = 0; i < n; i++ )
+			samples[ i ] = ctx.samples[ ctx.indices[ begin + i ] ];
+		split.feature->responses( &resp[ 0 ], &samples[ 0 ], n );
+
+		// sort keys: the response mapped to an ordered integer in the upper, the label in the lower bits
+		for( size_t i = 0; i < n; i++ ) {
+			Math::_flint32 fi;
+			fi.f = resp[ i ];
+			uint32_t key = ( fi.i & 0x80000000 ) ? ~fi.i : ( fi.i | 0x80000000 );
+			sorted[ i ] = ( ( uint64_t ) key << 32 ) | ctx.labels[ ctx.indices[ begin + i ] ];
+		}
+		std::sort( sorted.begin(), sorted.end() );
+
+		const double* xlogx = &ctx.xlogx[ 0 ];
+
+		// entropy of a histogram with m samples: log2( m ) - sum( c log2 c ) / m
+		size_t left[ N ] = { 0 };
+		size_t right[ N ];
+		double sumLeft = 0.0, sumRight = 0.0;
+		for( size_t c = 0; c < N; c++ ) {
+			right[ c ] = counts[ c ];
+			sumRight += xlogx[ counts[ c ] ];
+		}
+		const double parent = ( xlogx[ n ] - sumRight ) / ( double ) n;
+
+		double bestGain = 0.0;
+		size_t bestIdx = 0;
+		// sweep all thresholds between distinct responses
+		for( size_t i = 0; i + 1 < n; i++ ) {
+			uint8_t l = ( uint8_t ) sorted[ i ];
+			sumLeft	 += xlogx[ left[ l ] + 1 ] - xlogx[ left[ l ] ];
+			sumRight += xlogx[ right[ l ] - 1 ] - xlogx[ right[ l ] ];
+			left[ l ]++;
+			right[ l ]--;
+
+			if( ( sorted[ i ] >> 32 ) == ( sorted[ i + 1 ] >> 32 ) )
+				continue;
+
+			size_t nl = i + 1;
+			size_t nr = n - nl;
+			double gain = parent - ( xlogx[ nl ] - sumLeft + xlogx[ nr ] - sumRight ) / ( double ) n;
+			if( gain > bestGain ) {
+				bestGain = gain;
+				bestIdx = i;
+			}
+		}
+
+		split.gain = ( float ) bestGain;
+		if( bestGain > 0.0 ) {
+			// the midpoint rounds to the lower value for adjacent floats, which would not separate them
+			float lower = decodeKey( sorted[ bestIdx ] );
+			float upper = decodeKey( sorted[ bestIdx + 1 ] );
+			split.threshold = 0.5f * lower + 0.5f * upper;
+			if( !( split.threshold > lower ) )
+				split.threshold = upper;
+		}
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline float RDFParallelTrainer<DATA,DATACOLLECTION,N>::decodeKey( uint64_t key )
+	{
+		uint32_t k = ( uint32_t ) ( key >> 32 );
+		Math::_flint32 fi;
+		fi.i = ( k & 0x80000000 ) ? ( k & 0x7fffffff ) : ~k;
+		return fi.f;
+	}
+
+	template<typename DATA, typename DATACOLLECTION, size_t N>
+	inline typename RDFParallelTrainer<DATA,DATACOLLECTION,N>::Node* RDFParallelTrainer<DATA,DATACOLLECTION,N>::trainNode( TreeContext& ctx, size_t begin, size_t end, const size_t* counts, size_t depth )
+	{
+		const Parameters& params = *ctx.params;
+		const size_t n = end - begin;
+
+		size_t nonzero = 0;
+		for( size_t c = 0; c < N; c++ )
+			nonzero += counts[ c ] ? 1 : 0;
+
+		if( depth >= params.maxDepth || n < params.minSamples || nonzero <= 1 )
+			return makeLeaf( counts );
+
+		// draw the candidates with the tree rng, evaluate them in parallel for large nodes
+		std::vector<Split> splits( params.numFeatures );
+		for( size_t f = 0; f < splits.size(); f++ )
+			splits[ f ].feature = randomFeature( ctx.rng );
+
+		FeatureTask task( ctx, begin, end, counts, splits );
+		if( n * splits.size() >= ( 1 << 16 ) )
+			ParallelFor::run( task, 0, splits.size(), 1 );
+		else
+			task( 0, splits.size() );
+
+		size_t best = 0;
+		for( size_t f = 1; f < splits.size(); f++ )
+			if( splits[ f ].gain > splits[ best ].gain )
+				best = f;
+
+		for( size_t f = 0; f < splits.size(); f++ )
+			if( f != best )
+				delete splits[ f ].feature;
+
+		if( splits.empty() || splits[ best ].gain <= params.minGain ) {
+			if( !splits.empty() )
+				delete splits[ best ].feature;
+			return makeLeaf( counts );
+		}
+
+		// partition the index range in place, left: response < threshold
+		const Split& split = splits[ best ];
+		size_t leftCounts[ N ] = { 0 };
+		size_t rightCounts[ N ] = { 0 };
+		size_t mid = begin;
+		for( size_t i = begin; i < end; i++ ) {
+			uint32_t idx = ctx.indices[ i ];
+			if( ( *split.feature )( *ctx.samples[ idx ] ) < split.threshold ) {
+				std::swap( ctx.indices[ i ], ctx.indices[ mid++ ] );
+				leftCounts[ ctx.labels[ idx ] ]++;
+			} else {
+				rightCounts[ ctx.labels[ idx ] ]++;
+			}
+		}
+
+		RDFThresholdTest<DATA>* test = new RDFThresholdTest<DATA>( split.feature, split.threshold );
+		Node* left	= trainNode( ctx, begin, mid, leftCounts, depth + 1 );
+		Node* right = trainNode( ctx, mid, end, rightCounts, depth + 1 );
+		return new Node( NULL, test, left, right );
+	}
+
+}
+
+#endif
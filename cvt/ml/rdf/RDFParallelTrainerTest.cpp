@@ -0,0 +1,131 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/ml/rdf/RDFTestSamples.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/ParallelFor.h>
+
+namespace cvt {
+
+	namespace {
+
+		typedef RDFSampleTrainer<2> RDFTrainer;
+		typedef RDFNode<Vector2f,RDFClassHistogram<2> > RDFSampleNode;
+
+		static bool _rdfEqual( RDFSampleNode* a, RDFSampleNode* b )
+		{
+			if( a->isLeaf() != b->isLeaf() )
+				return false;
+			if( a->isLeaf() )
+				return a->data()->probability( 0 ) == b->data()->probability( 0 ) &&
+					   a->data()->probability( 1 ) == b->data()->probability( 1 );
+
+			const RDFThresholdTest<Vector2f>* ta = ( const RDFThresholdTest<Vector2f>* ) a->test();
+			const RDFThresholdTest<Vector2f>* tb = ( const RDFThresholdTest<Vector2f>* ) b->test();
+			const RDFProjection& fa = ( const RDFProjection& ) ta->feature();
+			const RDFProjection& fb = ( const RDFProjection& ) tb->feature();
+			return ta->threshold() == tb->threshold() && fa.direction() == fb.direction() &&
+				   _rdfEqual( a->left(), b->left() ) && _rdfEqual( a->right(), b->right() );
+		}
+
+	}
+
+BEGIN_CVTTEST( RDFParallelTrainer )
+	bool result = true;
+	bool b;
+
+	/* responses one ulp apart, their midpoint rounds to the lower one */
+	{
+		const float lower = 1.0f;
+		const float upper = 1.0f + Math::EPSILONF;
+		std::vector<RDFSample> data( 100 );
+		for( size_t i = 0; i < data.size(); i++ ) {
+			data[ i ].label = i & 1;
+			data[ i ].pos.set( data[ i ].label ? upper : lower, 0.0f );
+		}
+
+		RDFTrainer trainer( true );
+		RDFTrainer::Parameters params;
+		params.numFeatures = 1;
+		RDFClassificationTree<Vector2f,2>* tree = trainer.train( data, params );
+
+		RDFSampleNode* root = tree->root();
+		b = !root->isLeaf() && root->left()->isLeaf() && root->right()->isLeaf();
+		if( b ) {
+			float t = ( ( const RDFThresholdTest<Vector2f>* ) root->test() )->threshold();
+			b = t > lower && t <= upper;
+		}
+		for( size_t i = 0; i < data.size(); i++ )
+			b &= tree->classify( data[ i ].pos ).probability( data[ i ].label ) == 1.0f;
+		CVTTEST_PRINT( "threshold separates adjacent responses", b );
+		result &= b;
+
+		delete tree;
+	}
+
+	/* trees trained in parallel match the ones trained one by one */
+	{
+		RNG rng( 23 );
+		std::vector<RDFSample> data( 3000 );
+		for( size_t i = 0; i < data.size(); i++ ) {
+			RDFSample& s = data[ i ];
+			s.pos.set( rng.uniform( -1.0f, 1.0f ), rng.uniform( -1.0f, 1.0f ) );
+			s.label = s.pos.x * s.pos.y + rng.uniform( -0.1f, 0.1f ) > 0.0f ? 1 : 0;
+		}
+
+		RDFTrainer trainer;
+		RDFTrainer::Parameters params;
+		params.maxDepth = 10;
+		params.numFeatures = 30;
+		params.bagging = 0.8f;
+		params.seed = 5;
+
+		const size_t numTrees = Math::max<size_t>( 2, ParallelFor::numThreads() );
+		RDFClassifier<Vector2f,2> forest;
+		trainer.train( forest, data, params, numTrees );
+
+		b = forest.treeCount() == numTrees;
+		for( size_t t = 0; b && t < numTrees; t++ ) {
+			RDFClassificationTree<Vector2f,2>* tree = trainer.train( data, params, t );
+			b &= _rdfEqual( forest.tree( t ).root(), tree->root() );
+			delete tree;
+		}
+		CVTTEST_PRINT( "deterministic training", b );
+		result &= b;
+
+		size_t correct = 0;
+		for( size_t i = 0; i < data.size(); i++ ) {
+			RDFClassHistogram<2> hist;
+			forest.classify( hist, data[ i ].pos );
+			correct += hist.probability( data[ i ].label ) > 0.5f ? 1 : 0;
+		}
+		b = correct > data.size() * 8 / 10;
+		CVTTEST_PRINT( "training accuracy", b );
+		result &= b;
+	}
+
+	return result;
+END_CVTTEST
+
+}
@@ -34,7 +34,7 @@ namespace cvt {
 			RDFTest() {}
 			virtual ~RDFTest() {}
 
-			virtual bool operator()( const DATA& d ) = 0;
+			virtual bool operator()( const DATA& d ) const = 0;
 	};
 }
 
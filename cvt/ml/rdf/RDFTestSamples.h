@@ -0,0 +1,81 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_RDFTESTSAMPLES_H
+#define CVT_RDFTESTSAMPLES_H
+
+#include <cvt/ml/rdf/RDFParallelTrainer.h>
+#include <cvt/math/Vector.h>
+#include <cvt/util/RNG.h>
+
+#include <vector>
+
+/* 2D samples, projection features and a trainer shared by the RDF tests, not installed */
+
+namespace cvt {
+
+	struct RDFSample {
+		Vector2f	pos;
+		size_t		label;
+	};
+
+	/* projection of the sample onto a direction */
+	class RDFProjection : public RDFFeature<Vector2f> {
+		public:
+			RDFProjection( const Vector2f& dir ) : _dir( dir ) {}
+
+			float operator()( const Vector2f& d ) const { return _dir.dot( d ); }
+			RDFFeature<Vector2f>* clone() const { return new RDFProjection( _dir ); }
+
+			const Vector2f& direction() const { return _dir; }
+
+		private:
+			Vector2f _dir;
+	};
+
+	/* random projections or the x axis only */
+	template<size_t N>
+	class RDFSampleTrainer : public RDFParallelTrainer<Vector2f, std::vector<RDFSample>, N> {
+		public:
+			RDFSampleTrainer( bool axis = false ) : _axis( axis ) {}
+
+			size_t dataSize( const std::vector<RDFSample>& data ) { return data.size(); }
+			size_t classLabel( const std::vector<RDFSample>& data, size_t i ) { return data[ i ].label; }
+			const Vector2f& trainingData( const std::vector<RDFSample>& data, size_t i ) { return data[ i ].pos; }
+
+			RDFFeature<Vector2f>* randomFeature( RNG& rng )
+			{
+				if( _axis )
+					return new RDFProjection( Vector2f( 1.0f, 0.0f ) );
+				float phi = rng.uniform( 0.0f, ( float ) Math::TWO_PI );
+				return new RDFProjection( Vector2f( Math::cos( phi ), Math::sin( phi ) ) );
+			}
+
+		private:
+			bool _axis;
+	};
+
+}
+
+#endif
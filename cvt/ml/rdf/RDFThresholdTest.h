@@ -0,0 +1,83 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_RDFTHRESHOLDTEST_H
+#define CVT_RDFTHRESHOLDTEST_H
+
+#include <cvt/ml/rdf/RDFTest.h>
+
+namespace cvt {
+
+	/* scalar feature of a sample */
+	template<typename DATA>
+	class RDFFeature
+	{
+		public:
+			RDFFeature() {}
+			virtual ~RDFFeature() {}
+
+			virtual float				operator()( const DATA& d ) const = 0;
+			virtual RDFFeature<DATA>*	clone() const = 0;
+
+			/* responses for n samples, override to evaluate batches more efficiently */
+			virtual void				responses( float* dst, const DATA* const* data, size_t n ) const
+			{
+				for( size_t i = 0; i < n; i++ )
+					dst[ i ] = this->operator()( *data[ i ] );
+			}
+	};
+
+	/* feature( d ) >= threshold, the test owns the feature */
+	template<typename DATA>
+	class RDFThresholdTest : public RDFTest<DATA>
+	{
+		public:
+			RDFThresholdTest( RDFFeature<DATA>* feature, float threshold ) : _feature( feature ), _threshold( threshold ) {}
+			RDFThresholdTest( const RDFThresholdTest<DATA>& other ) : RDFTest<DATA>(), _feature( other._feature->clone() ), _threshold( other._threshold ) {}
+			~RDFThresholdTest() { delete _feature; }
+
+			RDFThresholdTest<DATA>& operator=( const RDFThresholdTest<DATA>& other )
+			{
+				if( this != &other ) {
+					RDFFeature<DATA>* f = other._feature->clone();
+					delete _feature;
+					_feature = f;
+					_threshold = other._threshold;
+				}
+				return *this;
+			}
+
+			bool operator()( const DATA& d ) const { return ( *_feature )( d ) >= _threshold; }
+
+			const RDFFeature<DATA>& feature() const { return *_feature; }
+			float					threshold() const { return _threshold; }
+
+		private:
+			RDFFeature<DATA>*	_feature;
+			float				_threshold;
+	};
+}
+
+#endif
@@ -40,6 +40,9 @@ namespace cvt {
 		CPU_SSE4_1 = ( 1 << 6 ),
 		CPU_SSE4_2 = ( 1 << 7 ),
 		CPU_AVX    = ( 1 << 8 ),
+		CPU_F16C   = ( 1 << 9 ),
+		CPU_FMA    = ( 1 << 10 ),
+		CPU_AVX2   = ( 1 << 11 ),
 	};
 
 	CVT_ENUM_TO_FLAGS( CPUFeatureFlags, CPUFeatures )
@@ -48,6 +51,7 @@ namespace cvt {
 	{
 		CPUFeatures ret = CPU_BASE;
 		uint32_t eax, ebx, ecx, edx;
+		uint32_t ebx7;
 
 #ifdef ARCH_x86_64
 		/* FIXME: what a clusterfuck - this works only for x86_64, we need to save ebx on x86
@@ -75,6 +79,53 @@ namespace cvt {
 		eax = ebx = ecx = edx = 0;
 #endif
 
+		/* structured extended feature flags, leaf 7 subleaf 0 - if the maximum supported leaf allows it */
+		ebx7 = 0;
+		{
+			uint32_t maxleaf = 0, tmp1, tmp2, tmp3;
+#ifdef ARCH_x86_64
+			asm volatile(
+				"movl $0, %%eax;\n\t"
+				"cpuid;\n\t"
+					: "=a"(maxleaf), "=b"(tmp1), "=c"(tmp2), "=d"(tmp3)
+					:
+					:
+				);
+			if( maxleaf >= 7 ) {
+				asm volatile(
+					"movl $7, %%eax;\n\t"
+					"xorl %%ecx, %%ecx;\n\t"
+					"cpuid;\n\t"
+						: "=a"(tmp1), "=b"(ebx7), "=c"(tmp2), "=d"(tmp3)
+						:
+						:
+					);
+			}
+#elif ARCH_x86
+			asm volatile(
+				"movl %%ebx, %%esi;\n\t"
+				"movl $0, %%eax;\n\t"
+				"cpuid;\n\t"
+				"xchgl %%ebx, %%esi;\n\t"
+					: "=a"(maxleaf), "=S"(tmp1), "=c"(tmp2), "=d"(tmp3)
+					:
+					:
+				);
+			if( maxleaf >= 7 ) {
+				asm volatile(
+					"movl %%ebx, %%esi;\n\t"
+					"movl $7, %%eax;\n\t"
+					"xorl %%ecx, %%ecx;\n\t"
+					"cpuid;\n\t"
+					"xchgl %%ebx, %%esi;\n\t"
+						: "=a"(tmp1), "=S"(ebx7), "=c"(tmp2), "=d"(tmp3)
+						:
+						:
+					);
+			}
+#endif
+		}
+
 		if( edx & ( 1 << 23 ) )
 			ret |= CPU_MMX;
 		if( edx & ( 1 << 25 ) )
@@ -93,6 +144,12 @@ namespace cvt {
 			ret |= CPU_SSE4_2;
 		if( ecx & ( 1 << 28 ) )
 			ret |= CPU_AVX;
+		if( ecx & ( 1 << 29 ) )
+			ret |= CPU_F16C;
+		if( ecx & ( 1 << 12 ) )
+			ret |= CPU_FMA;
+		if( ebx7 & ( 1 <<  5 ) )
+			ret |= CPU_AVX2;
 		return ret;
 	}
 
@@ -117,6 +174,12 @@ namespace cvt {
 			std::cout << "SSE4.2 ";
 		if( f & CPU_AVX )
 			std::cout << "AVX ";
+		if( f & CPU_F16C )
+			std::cout << "F16C ";
+		if( f & CPU_FMA )
+			std::cout << "FMA ";
+		if( f & CPU_AVX2 )
+			std::cout << "AVX2 ";
 		std::cout << std::endl;
 	}
 
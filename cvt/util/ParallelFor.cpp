@@ -0,0 +1,221 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <vector>
+#include <exception>
+#include <unistd.h>
+#include <stdlib.h>
+
+namespace cvt {
+
+	/* runs one block, exceptions leave as Exception on the pool and the serial path alike */
+	static void _executeBlock( ParallelFor::Task& task, size_t begin, size_t end )
+	{
+		try {
+			task.execute( begin, end );
+		} catch( const Exception& ) {
+			throw;
+		} catch( const std::exception& ex ) {
+			throw CVTException( ex.what() );
+		} catch( ... ) {
+			throw CVTException( "ParallelFor: unknown exception" );
+		}
+	}
+
+	class ParallelForPool {
+		public:
+			ParallelForPool();
+
+			size_t numThreads() const { return _workers.size() + 1; }
+			void   dispatch( ParallelFor::Task& task, size_t begin, size_t end, size_t grain );
+
+		private:
+			class Worker : public Thread<ParallelForPool> {
+				public:
+					void execute( ParallelForPool* pool ) { pool->workerLoop(); }
+			};
+
+			void workerLoop();
+			void process();
+			void fail( const Exception& error );
+
+			std::vector<Worker*> _workers;
+			Mutex				 _mutex;
+			Condition			 _start;
+			Condition			 _done;
+
+			ParallelFor::Task*	 _task;
+			size_t				 _end;
+			size_t				 _grain;
+			volatile size_t		 _next;
+			size_t				 _generation;
+			size_t				 _running;
+			bool				 _busy;
+			bool				 _failed;
+			Exception			 _error;
+	};
+
+	ParallelForPool::ParallelForPool() :
+		_task( 0 ),
+		_end( 0 ),
+		_grain( 1 ),
+		_next( 0 ),
+		_generation( 0 ),
+		_running( 0 ),
+		_busy( false ),
+		_failed( false )
+	{
+		long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+		// allow to restrict/override the number of threads
+		const char* env = getenv( "CVT_NUM_THREADS" );
+		if( env )
+			ncpu = atol( env );
+		if( ncpu < 1 )
+			ncpu = 1;
+
+		for( long i = 1; i < ncpu; i++ ) {
+			Worker* w = new Worker();
+			w->run( this );
+			_workers.push_back( w );
+		}
+	}
+
+	void ParallelForPool::process()
+	{
+		while( true ) {
+			size_t b = __sync_fetch_and_add( &_next, _grain );
+			if( b >= _end )
+				return;
+			size_t e = b + _grain < _end ? b + _grain : _end;
+			/* exceptions must not leave the worker threads, the first one is rethrown by dispatch */
+			try {
+				_executeBlock( *_task, b, e );
+			} catch( const Exception& ex ) {
+				fail( ex );
+			}
+		}
+	}
+
+	void ParallelForPool::fail( const Exception& error )
+	{
+		ScopeLock lock( &_mutex );
+		if( !_failed ) {
+			_failed = true;
+			_error = error;
+		}
+	}
+
+	void ParallelForPool::workerLoop()
+	{
+		size_t generation = 0;
+		while( true ) {
+			_mutex.lock();
+			while( _generation == generation )
+				_start.wait( _mutex );
+			generation = _generation;
+			_mutex.unlock();
+
+			process();
+
+			_mutex.lock();
+			if( --_running == 0 )
+				_done.notify();
+			_mutex.unlock();
+		}
+	}
+
+	void ParallelForPool::dispatch( ParallelFor::Task& task, size_t begin, size_t end, size_t grain )
+	{
+		size_t n = end - begin;
+		if( !grain )
+			grain = Math::max<size_t>( 1, n / ( 4 * numThreads() ) );
+
+		_mutex.lock();
+		if( _busy || _workers.empty() || n <= grain ) {
+			// nested call or nothing to split
+			_mutex.unlock();
+			for( size_t b = begin; b < end; b += grain )
+				_executeBlock( task, b, b + grain < end ? b + grain : end );
+			return;
+		}
+
+		_busy = true;
+		_failed = false;
+		_task = &task;
+		_end = end;
+		_grain = grain;
+		_next = begin;
+		_running = _workers.size();
+		_generation++;
+		_start.notifyAll();
+		_mutex.unlock();
+
+		process();
+
+		_mutex.lock();
+		while( _running )
+			_done.wait( _mutex );
+		_busy = false;
+		_task = 0;
+		bool failed = _failed;
+		Exception error = _error;
+		_mutex.unlock();
+
+		if( failed )
+			throw error;
+	}
+
+	static pthread_once_t _poolOnce = PTHREAD_ONCE_INIT;
+	static ParallelForPool* _pool = 0;
+
+	static void _createPool()
+	{
+		_pool = new ParallelForPool();
+	}
+
+	static ParallelForPool& _instance()
+	{
+		pthread_once( &_poolOnce, _createPool );
+		return *_pool;
+	}
+
+	size_t ParallelFor::numThreads()
+	{
+		return _instance().numThreads();
+	}
+
+	void ParallelFor::dispatch( Task& task, size_t begin, size_t end, size_t grain )
+	{
+		_instance().dispatch( task, begin, end, grain );
+	}
+
+}
@@ -0,0 +1,85 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_PARALLELFOR_H
+#define CVT_PARALLELFOR_H
+
+#include <stddef.h>
+
+namespace cvt {
+
+	/**
+	  Splits a range into blocks and processes them on a shared pool of
+	  worker threads, the calling thread takes part in the work.
+
+	  The functor is called as func( begin, end ) for disjoint blocks of
+	  [ begin, end ), concurrently from different threads. Nested calls and
+	  calls while the pool is busy are executed by the calling thread.
+	  Exceptions thrown by the functor reach the caller of run as Exception,
+	  on the pool the first one once all blocks are done. Exception is
+	  passed on unchanged, other exceptions are converted to Exception.
+	  The pool uses all cores unless CVT_NUM_THREADS is set.
+	 */
+	class ParallelFor {
+		public:
+			/* grain: block size, 0 chooses the block size from the number of threads */
+			template<typename FUNC>
+			static void run( FUNC& func, size_t begin, size_t end, size_t grain = 0 );
+
+			/* number of threads taking part including the calling thread */
+			static size_t numThreads();
+
+			class Task {
+				public:
+					virtual ~Task() {}
+					virtual void execute( size_t begin, size_t end ) = 0;
+			};
+
+		private:
+			template<typename FUNC>
+			class FunctorTask : public Task {
+				public:
+					FunctorTask( FUNC& func ) : _func( func ) {}
+					void execute( size_t begin, size_t end ) { _func( begin, end ); }
+
+				private:
+					FUNC& _func;
+			};
+
+			static void dispatch( Task& task, size_t begin, size_t end, size_t grain );
+	};
+
+	template<typename FUNC>
+	inline void ParallelFor::run( FUNC& func, size_t begin, size_t end, size_t grain )
+	{
+		if( begin >= end )
+			return;
+		FunctorTask<FUNC> task( func );
+		dispatch( task, begin, end, grain );
+	}
+
+}
+
+#endif
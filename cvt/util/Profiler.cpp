@@ -0,0 +1,486 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/Profiler.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Exception.h>
+#include <cvt/math/Math.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#ifdef APPLE
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+namespace cvt {
+
+	enum ProfileEventType {
+		PROFILE_ZONE,
+		PROFILE_GPUZONE,
+		PROFILE_COUNTER,
+		PROFILE_HISTOGRAM
+	};
+
+	struct ProfileEvent {
+		const char* name;
+		uint64_t	start;
+		uint64_t	end;
+		double		value;
+		uint32_t	type;
+		uint32_t	tid;
+	};
+
+	struct ProfileStat {
+		/* log2 bins: [ 0, 1 ), [ 1, 2 ), [ 2, 4 ), ... */
+		enum { NUMBINS = 48 };
+
+		const char* volatile name;
+		uint32_t			 type;
+		uint64_t			 count;
+		double				 sum;
+		double				 min;
+		double				 max;
+		double				 last;
+		uint64_t			 bins[ NUMBINS ];
+
+		void reset( uint32_t t )
+		{
+			type  = t;
+			count = 0;
+			sum	  = 0.0;
+			min	  = 1e300;
+			max	  = -1e300;
+			last  = 0.0;
+			memset( bins, 0, sizeof( bins ) );
+		}
+
+		void add( double value )
+		{
+			count++;
+			sum += value;
+			min	 = Math::min( min, value );
+			max	 = Math::max( max, value );
+			last = value;
+			int bin = 0;
+			if( value >= 1.0 ) {
+				frexp( value, &bin );
+				bin = Math::min<int>( bin, NUMBINS - 1 );
+			}
+			bins[ bin ]++;
+		}
+
+		void merge( const ProfileStat& other )
+		{
+			count += other.count;
+			sum += other.sum;
+			min	 = Math::min( min, other.min );
+			max	 = Math::max( max, other.max );
+			last = other.last;
+			for( int i = 0; i < NUMBINS; i++ )
+				bins[ i ] += other.bins[ i ];
+		}
+	};
+
+	/*
+	   Per thread storage, only written by its owning thread. The ring buffer
+	   is published by incrementing _written, readers take the events below it.
+	   clear() only advances the global generation, the owner resets its buffer
+	   with its next sample and readers skip buffers of an older generation.
+	   Buffers of finished threads are reset under the mutex and handed to new
+	   threads with a new tid.
+	 */
+	class ProfileBuffer {
+		public:
+			enum { NUMEVENTS = 1 << 16, NUMSTATS = 256 };
+
+			ProfileBuffer( uint32_t tid, uint32_t generation ) :
+				_tid( tid ), _written( 0 ), _cleared( 0 ), _generation( generation ), _retired( false ), _next( NULL )
+			{
+				_events = new ProfileEvent[ NUMEVENTS ];
+				_stats	= new ProfileStat[ NUMSTATS ];
+				for( size_t i = 0; i < NUMSTATS; i++ )
+					_stats[ i ].name = NULL;
+			}
+
+			~ProfileBuffer()
+			{
+				delete[] _events;
+				delete[] _stats;
+			}
+
+			void record( const char* name, uint32_t type, uint64_t start, uint64_t end, double value )
+			{
+				ProfileEvent& e = _events[ _written & ( NUMEVENTS - 1 ) ];
+				e.name	= name;
+				e.start = start;
+				e.end	= end;
+				e.value = value;
+				e.type	= type;
+				e.tid	= type == PROFILE_GPUZONE ? 0 : _tid;
+				__sync_fetch_and_add( &_written, 1 );
+			}
+
+			void addStat( const char* name, uint32_t type, double value )
+			{
+				size_t h = ( ( size_t ) name >> 3 ) * 2654435761u;
+				for( size_t i = 0; i < NUMSTATS; i++ ){
+					ProfileStat& s = _stats[ ( h + i ) & ( NUMSTATS - 1 ) ];
+					if( s.name == name ){
+						s.add( value );
+						return;
+					}
+					if( s.name == NULL ){
+						s.reset( type );
+						__sync_synchronize();
+						s.name = name;
+						s.add( value );
+						return;
+					}
+				}
+				/* table full, drop the sample */
+			}
+
+			void events( std::vector<ProfileEvent>& events ) const
+			{
+				uint64_t end = __sync_fetch_and_add( ( volatile uint64_t* ) &_written, 0 );
+				uint64_t begin = Math::max<uint64_t>( _cleared, end > NUMEVENTS ? end - NUMEVENTS : 0 );
+				for( uint64_t i = begin; i < end; i++ )
+					events.push_back( _events[ i & ( NUMEVENTS - 1 ) ] );
+			}
+
+			/* by the owning thread or with the buffer retired */
+			void reset( uint32_t generation )
+			{
+				_cleared = _written;
+				for( size_t i = 0; i < NUMSTATS; i++ )
+					_stats[ i ].name = NULL;
+				__sync_synchronize();
+				_generation = generation;
+			}
+
+			uint32_t		  _tid;
+			ProfileEvent*	  _events;
+			volatile uint64_t _written;
+			volatile uint64_t _cleared;
+			volatile uint32_t _generation;
+			ProfileStat*	  _stats;
+			volatile bool	  _retired;
+			ProfileBuffer*	  _next;
+	};
+
+	static pthread_once_t				_profileOnce = PTHREAD_ONCE_INIT;
+	static pthread_key_t				_profileKey;
+	static Mutex*						_profileMutex = NULL;
+	static ProfileBuffer*				_profileBuffers = NULL;
+	static uint32_t						_profileNumThreads = 0;
+	static volatile uint32_t			_profileGeneration = 0;
+	static std::vector<const char*>*	_profileNames = NULL;
+	static std::vector<void (*)()>*		_profileCollectors = NULL;
+
+	static void _profileThreadExit( void* ptr )
+	{
+		ScopeLock lock( _profileMutex );
+		( ( ProfileBuffer* ) ptr )->_retired = true;
+	}
+
+	static void _profileInit()
+	{
+		_profileMutex = new Mutex();
+		_profileNames = new std::vector<const char*>();
+		_profileCollectors = new std::vector<void (*)()>();
+		pthread_key_create( &_profileKey, _profileThreadExit );
+	}
+
+	static ProfileBuffer* _profileThreadBuffer()
+	{
+		pthread_once( &_profileOnce, _profileInit );
+		ProfileBuffer* buf = ( ProfileBuffer* ) pthread_getspecific( _profileKey );
+		if( buf ){
+			/* apply a pending clear() */
+			uint32_t generation = _profileGeneration;
+			if( buf->_generation != generation )
+				buf->reset( generation );
+			return buf;
+		}
+
+		ScopeLock lock( _profileMutex );
+		for( buf = _profileBuffers; buf; buf = buf->_next ){
+			if( buf->_retired ){
+				/* the events keep the tid of the finished thread */
+				buf->_retired = false;
+				buf->_tid = ++_profileNumThreads;
+				/* retired after a clear() it has not applied yet */
+				if( buf->_generation != _profileGeneration )
+					buf->reset( _profileGeneration );
+				break;
+			}
+		}
+		if( !buf ){
+			buf = new ProfileBuffer( ++_profileNumThreads, _profileGeneration );
+			buf->_next = _profileBuffers;
+			_profileBuffers = buf;
+		}
+		pthread_setspecific( _profileKey, buf );
+		return buf;
+	}
+
+	/* runs the collectors and returns the buffers of the current generation */
+	static void _profileGather( std::vector<ProfileBuffer*>& buffers )
+	{
+		pthread_once( &_profileOnce, _profileInit );
+
+		std::vector<void (*)()> collectors;
+		_profileMutex->lock();
+		collectors = *_profileCollectors;
+		_profileMutex->unlock();
+		for( size_t i = 0; i < collectors.size(); i++ )
+			collectors[ i ]();
+
+		ScopeLock lock( _profileMutex );
+		for( ProfileBuffer* buf = _profileBuffers; buf; buf = buf->_next ){
+			/* not yet reset by its owner, all data predates clear() */
+			if( buf->_generation != _profileGeneration )
+				continue;
+			__sync_synchronize();
+			buffers.push_back( buf );
+		}
+	}
+
+	uint64_t Profiler::timestamp()
+	{
+#ifdef APPLE
+		static mach_timebase_info_data_t timebase = { 0, 0 };
+		if( timebase.denom == 0 )
+			mach_timebase_info( &timebase );
+		return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+		struct timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+#endif
+	}
+
+	void Profiler::zone( const char* name, uint64_t start, uint64_t end )
+	{
+		ProfileBuffer* buf = _profileThreadBuffer();
+		buf->record( name, PROFILE_ZONE, start, end, 0.0 );
+		buf->addStat( name, PROFILE_ZONE, ( double ) ( end - start ) * 1e-3 );
+	}
+
+	void Profiler::gpuZone( const char* name, uint64_t start, uint64_t end )
+	{
+		ProfileBuffer* buf = _profileThreadBuffer();
+		buf->record( name, PROFILE_GPUZONE, start, end, 0.0 );
+		buf->addStat( name, PROFILE_GPUZONE, ( double ) ( end - start ) * 1e-3 );
+	}
+
+	void Profiler::counter( const char* name, double value )
+	{
+		ProfileBuffer* buf = _profileThreadBuffer();
+		uint64_t t = timestamp();
+		buf->record( name, PROFILE_COUNTER, t, t, value );
+		buf->addStat( name, PROFILE_COUNTER, value );
+	}
+
+	void Profiler::histogram( const char* name, double value )
+	{
+		_profileThreadBuffer()->addStat( name, PROFILE_HISTOGRAM, value );
+	}
+
+	const char* Profiler::intern( const String& name )
+	{
+		pthread_once( &_profileOnce, _profileInit );
+		ScopeLock lock( _profileMutex );
+		for( size_t i = 0; i < _profileNames->size(); i++ ){
+			if( !strcmp( ( *_profileNames )[ i ], name.c_str() ) )
+				return ( *_profileNames )[ i ];
+		}
+		char* str = new char[ name.length() + 1 ];
+		memcpy( str, name.c_str(), name.length() + 1 );
+		_profileNames->push_back( str );
+		return str;
+	}
+
+	void Profiler::addCollector( void ( *collect )() )
+	{
+		pthread_once( &_profileOnce, _profileInit );
+		ScopeLock lock( _profileMutex );
+		if( std::find( _profileCollectors->begin(), _profileCollectors->end(), collect ) == _profileCollectors->end() )
+			_profileCollectors->push_back( collect );
+	}
+
+	void Profiler::clear()
+	{
+		/* the collectors hand over pending events, they are discarded as well */
+		std::vector<ProfileBuffer*> buffers;
+		_profileGather( buffers );
+
+		ScopeLock lock( _profileMutex );
+		uint32_t generation = _profileGeneration + 1;
+		__sync_synchronize();
+		_profileGeneration = generation;
+		for( ProfileBuffer* buf = _profileBuffers; buf; buf = buf->_next ){
+			if( buf->_retired )
+				buf->reset( generation );
+		}
+	}
+
+	size_t Profiler::bufferSize()
+	{
+		return ProfileBuffer::NUMEVENTS;
+	}
+
+	static void _profileWriteName( FILE* f, const char* name )
+	{
+		fputc( '"', f );
+		for( const char* c = name; *c; c++ ){
+			if( *c == '"' || *c == '\\' )
+				fputc( '\\', f );
+			if( ( unsigned char ) *c >= 0x20 )
+				fputc( *c, f );
+		}
+		fputc( '"', f );
+	}
+
+	void Profiler::saveChromeTrace( const String& filename )
+	{
+		std::vector<ProfileBuffer*> buffers;
+		_profileGather( buffers );
+
+		std::vector<ProfileEvent> events;
+		for( size_t i = 0; i < buffers.size(); i++ )
+			buffers[ i ]->events( events );
+
+		uint64_t base = ( uint64_t ) -1;
+		for( size_t i = 0; i < events.size(); i++ )
+			base = Math::min( base, events[ i ].start );
+
+		FILE* f = fopen( filename.c_str(), "w" );
+		if( !f )
+			throw CVTException( "Could not open file for the profiler trace" );
+
+		fprintf( f, "{\"traceEvents\":[\n" );
+		/* a buffer holds events of every thread that used it */
+		std::vector<uint32_t> tids;
+		for( size_t i = 0; i < events.size(); i++ )
+			if( events[ i ].tid )
+				tids.push_back( events[ i ].tid );
+		std::sort( tids.begin(), tids.end() );
+		tids.erase( std::unique( tids.begin(), tids.end() ), tids.end() );
+
+		fprintf( f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"OpenCL\"}}" );
+		for( size_t i = 0; i < tids.size(); i++ )
+			fprintf( f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+					 tids[ i ], tids[ i ] );
+
+		for( size_t i = 0; i < events.size(); i++ ){
+			const ProfileEvent& e = events[ i ];
+			double ts = ( double ) ( e.start - base ) * 1e-3;
+			fprintf( f, ",\n{\"name\":" );
+			_profileWriteName( f, e.name );
+			if( e.type == PROFILE_COUNTER ){
+				fprintf( f, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%g}}", ts, e.value );
+			} else {
+				fprintf( f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+						 e.type == PROFILE_GPUZONE ? "gpu" : "cpu", ts, ( double ) ( e.end - e.start ) * 1e-3, e.tid );
+			}
+		}
+		fprintf( f, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+		fclose( f );
+	}
+
+	static bool _profileCmpStat( const ProfileStat& a, const ProfileStat& b )
+	{
+		if( a.type != b.type )
+			return a.type < b.type;
+		if( a.type == PROFILE_ZONE || a.type == PROFILE_GPUZONE )
+			return a.sum > b.sum;
+		return strcmp( a.name, b.name ) < 0;
+	}
+
+	void Profiler::summary( String& str )
+	{
+		std::vector<ProfileBuffer*> buffers;
+		_profileGather( buffers );
+
+		/* merge the statistics of all threads by name */
+		std::vector<ProfileStat> stats;
+		for( size_t b = 0; b < buffers.size(); b++ ){
+			for( size_t i = 0; i < ProfileBuffer::NUMSTATS; i++ ){
+				const ProfileStat& s = buffers[ b ]->_stats[ i ];
+				if( s.name == NULL || s.count == 0 )
+					continue;
+				size_t k = 0;
+				while( k < stats.size() && ( stats[ k ].type != s.type || strcmp( stats[ k ].name, s.name ) ) )
+					k++;
+				if( k == stats.size() )
+					stats.push_back( s );
+				else
+					stats[ k ].merge( s );
+			}
+		}
+		std::sort( stats.begin(), stats.end(), _profileCmpStat );
+
+		static const char* titles[] = { "Zones", "Device zones", "Counters", "Histograms" };
+		str = "";
+		uint32_t section = ( uint32_t ) -1;
+		for( size_t i = 0; i < stats.size(); i++ ){
+			const ProfileStat& s = stats[ i ];
+			if( s.type != section ){
+				if( section != ( uint32_t ) -1 )
+					str += "\n";
+				section = s.type;
+				if( section == PROFILE_ZONE || section == PROFILE_GPUZONE )
+					str.sprintfConcat( "%s\n%-40s %10s %12s %12s %12s %12s\n", titles[ section ], "name", "calls", "total ms", "mean us", "min us", "max us" );
+				else
+					str.sprintfConcat( "%s\n%-40s %10s %12s %12s %12s %12s\n", titles[ section ], "name", "samples", "mean", "min", "max", "last" );
+			}
+
+			if( section == PROFILE_ZONE || section == PROFILE_GPUZONE )
+				str.sprintfConcat( "%-40s %10llu %12.3f %12.3f %12.3f %12.3f\n", s.name, ( unsigned long long ) s.count,
+								   s.sum * 1e-3, s.sum / ( double ) s.count, s.min, s.max );
+			else
+				str.sprintfConcat( "%-40s %10llu %12g %12g %12g %12g\n", s.name, ( unsigned long long ) s.count,
+								   s.sum / ( double ) s.count, s.min, s.max, s.last );
+
+			if( section == PROFILE_HISTOGRAM ){
+				for( int b = 0; b < ProfileStat::NUMBINS; b++ ){
+					if( !s.bins[ b ] )
+						continue;
+					String range;
+					range.sprintf( "[%g, %g)", b ? ldexp( 1.0, b - 1 ) : 0.0, ldexp( 1.0, b ) );
+					str.sprintfConcat( "    %-36s %10llu\n", range.c_str(), ( unsigned long long ) s.bins[ b ] );
+				}
+			}
+		}
+	}
+
+}
@@ -0,0 +1,103 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef CVT_PROFILER_H
+#define CVT_PROFILER_H
+
+#include <cvt/util/String.h>
+#include <stdint.h>
+
+namespace cvt {
+
+	/**
+	  Low overhead profiler for timed zones, counters and histograms.
+
+	  Every thread records into its own ring buffer and statistics table
+	  without any locking, the data is only gathered when exporting it as
+	  Chrome trace (chrome://tracing, Perfetto) or as text summary. Zone and
+	  statistic names have to stay valid for the lifetime of the program,
+	  i.e. string literals or names returned by intern().
+
+	  Use the CVT_PROFILE_* macros for instrumentation, they compile to
+	  nothing unless CVT_PROFILE is defined.
+	 */
+	class Profiler {
+		public:
+			/* monotonic timestamp in nanoseconds */
+			static uint64_t		timestamp();
+
+			static void			zone( const char* name, uint64_t start, uint64_t end );
+
+			/* device zone, start and end already in host time */
+			static void			gpuZone( const char* name, uint64_t start, uint64_t end );
+
+			/* counters are part of the trace, histograms only of the summary */
+			static void			counter( const char* name, double value );
+			static void			histogram( const char* name, double value );
+
+			/* returns a permanent copy of name */
+			static const char*	intern( const String& name );
+
+			/* called before exporting, e.g. to gather pending device events */
+			static void			addCollector( void ( *collect )() );
+
+			/* discard the recorded data, each thread resets its own buffer with its next sample */
+			static void			clear();
+
+			static void			saveChromeTrace( const String& filename );
+			static void			summary( String& str );
+
+			/* number of events kept per thread */
+			static size_t		bufferSize();
+	};
+
+	class ProfileZone {
+		public:
+			ProfileZone( const char* name ) : _name( name ), _start( Profiler::timestamp() ) {}
+			~ProfileZone() { Profiler::zone( _name, _start, Profiler::timestamp() ); }
+
+		private:
+			ProfileZone( const ProfileZone& );
+			ProfileZone& operator=( const ProfileZone& );
+
+			const char* _name;
+			uint64_t	_start;
+	};
+
+}
+
+#define CVT_PROFILE_CONCAT2( a, b ) a##b
+#define CVT_PROFILE_CONCAT( a, b ) CVT_PROFILE_CONCAT2( a, b )
+
+#ifdef CVT_PROFILE
+	#define CVT_PROFILE_ZONE( name ) ::cvt::ProfileZone CVT_PROFILE_CONCAT( _cvtProfileZone, __LINE__ )( name )
+	#define CVT_PROFILE_COUNTER( name, value ) ::cvt::Profiler::counter( name, ( double ) ( value ) )
+	#define CVT_PROFILE_HISTOGRAM( name, value ) ::cvt::Profiler::histogram( name, ( double ) ( value ) )
+#else
+	#define CVT_PROFILE_ZONE( name )
+	#define CVT_PROFILE_COUNTER( name, value ) ( ( void ) 0 )
+	#define CVT_PROFILE_HISTOGRAM( name, value ) ( ( void ) 0 )
+#endif
+
+#endif
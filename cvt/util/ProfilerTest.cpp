@@ -0,0 +1,225 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/util/Profiler.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/CVTTest.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace cvt {
+
+	struct ProfilerTestTask {
+		void operator()( size_t begin, size_t end )
+		{
+			for( size_t i = begin; i < end; i++ ){
+				ProfileZone zone( "ProfilerTest::zone" );
+				Profiler::histogram( "ProfilerTest::histogram", ( double ) i );
+			}
+		}
+	};
+
+	static bool _testStatistics()
+	{
+		Profiler::clear();
+
+		ProfilerTestTask task;
+		ParallelFor::run( task, 0, 1000, 10 );
+		for( int i = 0; i < 10; i++ )
+			Profiler::counter( "ProfilerTest::counter", i );
+
+		String sum;
+		Profiler::summary( sum );
+
+		/* statistics of all threads are merged */
+		unsigned long long n;
+		const char* zone = strstr( sum.c_str(), "ProfilerTest::zone" );
+		if( !zone || sscanf( zone + strlen( "ProfilerTest::zone" ), "%llu", &n ) != 1 || n != 1000 )
+			return false;
+
+		const char* counter = strstr( sum.c_str(), "ProfilerTest::counter" );
+		float mean, min, max, last;
+		if( !counter || sscanf( counter + strlen( "ProfilerTest::counter" ), "%llu %f %f %f %f", &n, &mean, &min, &max, &last ) != 5 )
+			return false;
+		if( n != 10 || mean != 4.5f || min != 0.0f || max != 9.0f || last != 9.0f )
+			return false;
+
+		/* [ 512, 1024 ) holds 488 values of 0 ... 999 */
+		const char* bin = strstr( sum.c_str(), "[512, 1024)" );
+		if( !bin || sscanf( bin + strlen( "[512, 1024)" ), "%llu", &n ) != 1 || n != 488 )
+			return false;
+
+		Profiler::clear();
+		Profiler::summary( sum );
+		return strstr( sum.c_str(), "ProfilerTest" ) == NULL;
+	}
+
+	/* the chrome trace as zero terminated string */
+	static bool _loadTrace( std::vector<char>& data )
+	{
+		const char* filename = "cvt_profilertest.json";
+		Profiler::saveChromeTrace( filename );
+
+		FILE* f = fopen( filename, "r" );
+		if( !f )
+			return false;
+		data.clear();
+		char buf[ 4096 ];
+		size_t n;
+		while( ( n = fread( buf, 1, sizeof( buf ), f ) ) > 0 )
+			data.insert( data.end(), buf, buf + n );
+		data.push_back( 0 );
+		fclose( f );
+		remove( filename );
+		return true;
+	}
+
+	static bool _testTrace()
+	{
+		Profiler::clear();
+
+		/* the ring buffer keeps the most recent events */
+		uint64_t t = Profiler::timestamp();
+		for( size_t i = 0; i < Profiler::bufferSize(); i++ )
+			Profiler::zone( "ProfilerTest::overflow", t, t );
+
+		Profiler::zone( "ProfilerTest::\"trace\"", t, t + 2000 );
+		Profiler::gpuZone( Profiler::intern( "ProfilerTest::kernel" ), t + 500, t + 1500 );
+		Profiler::counter( "ProfilerTest::counter", 3 );
+
+		std::vector<char> data;
+		if( !_loadTrace( data ) )
+			return false;
+		const char* json = &data[ 0 ];
+
+		size_t overflow = 0;
+		for( const char* c = json; ( c = strstr( c, "ProfilerTest::overflow" ) ) != NULL; c++ )
+			overflow++;
+
+		bool ret = strncmp( json, "{\"traceEvents\":[", 16 ) == 0;
+		ret &= overflow == Profiler::bufferSize() - 3;
+		ret &= strstr( json, "{\"name\":\"ProfilerTest::\\\"trace\\\"\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":0.000,\"dur\":2.000" ) != NULL;
+		ret &= strstr( json, "{\"name\":\"ProfilerTest::kernel\",\"cat\":\"gpu\",\"ph\":\"X\",\"ts\":0.500,\"dur\":1.000,\"pid\":1,\"tid\":0}" ) != NULL;
+		ret &= strstr( json, "{\"name\":\"ProfilerTest::counter\",\"ph\":\"C\"" ) != NULL;
+		ret &= strstr( json, "\n],\"displayTimeUnit\":\"ms\"}" ) != NULL;
+
+		Profiler::clear();
+		return ret;
+	}
+
+	static void* _profilerTestThread( void* name )
+	{
+		uint64_t t = Profiler::timestamp();
+		Profiler::zone( ( const char* ) name, t, t + 1000 );
+		return NULL;
+	}
+
+	static void* _profilerTestLoop( void* stop )
+	{
+		while( !*( volatile bool* ) stop ){
+			ProfileZone zone( "ProfilerTest::loop" );
+			Profiler::histogram( "ProfilerTest::loop histogram", 1.0 );
+		}
+		return NULL;
+	}
+
+	/* tid of the first event named name in the trace, -1 if there is none */
+	static int _traceTid( const char* json, const char* name )
+	{
+		const char* e = strstr( json, name );
+		const char* tid = e ? strstr( e, "\"tid\":" ) : NULL;
+		int n;
+		if( !tid || sscanf( tid + 6, "%d", &n ) != 1 )
+			return -1;
+		return n;
+	}
+
+	static bool _testThreads()
+	{
+		Profiler::clear();
+
+		/* buffers of finished threads are reused with a new tid */
+		const char* names[ 2 ] = { "ProfilerTest::first", "ProfilerTest::second" };
+		for( size_t i = 0; i < 2; i++ ){
+			pthread_t thread;
+			if( pthread_create( &thread, NULL, _profilerTestThread, ( void* ) names[ i ] ) )
+				return false;
+			pthread_join( thread, NULL );
+		}
+
+		std::vector<char> json;
+		if( !_loadTrace( json ) )
+			return false;
+		int first = _traceTid( &json[ 0 ], names[ 0 ] );
+		int second = _traceTid( &json[ 0 ], names[ 1 ] );
+		bool ret = first > 0 && second > 0 && first != second;
+
+		/* clear() resets the buffers of finished threads itself */
+		Profiler::clear();
+		if( !_loadTrace( json ) )
+			return false;
+		ret &= _traceTid( &json[ 0 ], names[ 0 ] ) == -1 && _traceTid( &json[ 0 ], names[ 1 ] ) == -1;
+
+		/* clear() while another thread is recording */
+		volatile bool stop = false;
+		pthread_t thread;
+		if( pthread_create( &thread, NULL, _profilerTestLoop, ( void* ) &stop ) )
+			return false;
+		String sum;
+		for( size_t i = 0; i < 200; i++ ){
+			Profiler::clear();
+			Profiler::summary( sum );
+		}
+		stop = true;
+		pthread_join( thread, NULL );
+
+		Profiler::clear();
+		Profiler::summary( sum );
+		ret &= strstr( sum.c_str(), "ProfilerTest" ) == NULL;
+		return ret;
+	}
+
+BEGIN_CVTTEST( Profiler )
+	bool ret = true;
+	bool b;
+
+	b = _testStatistics();
+	CVTTEST_PRINT( "Profiler zones, counters and histograms", b );
+	ret &= b;
+
+	b = _testTrace();
+	CVTTEST_PRINT( "Profiler chrome trace", b );
+	ret &= b;
+
+	b = _testThreads();
+	CVTTEST_PRINT( "Profiler thread buffers", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
+
+}
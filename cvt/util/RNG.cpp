@@ -0,0 +1,91 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/RNG.h>
+#include <cvt/util/SIMD.h>
+
+namespace cvt
+{
+	/* values generated at once by the bulk fills */
+	static const size_t RNG_CHUNK = 256;
+
+	void RNG::fill( uint32_t* dst, size_t n )
+	{
+		// drain the current block to stay in sync with uint32()
+		while( n && _pos < 4 ) {
+			*dst++ = _block[ _pos++ ];
+			n--;
+		}
+
+		size_t blocks = n >> 2;
+		if( blocks ) {
+			SIMD::instance()->philox4x32( dst, blocks, _counter, _stream, _key );
+			_counter += blocks;
+			dst += blocks << 2;
+			n &= 0x3;
+		}
+
+		while( n-- )
+			*dst++ = uint32();
+	}
+
+	void RNG::fillUniform( float* dst, size_t n, float min, float max )
+	{
+		uint32_t buf[ RNG_CHUNK ];
+		float scale = 5.9604644775390625E-8f * ( max - min );
+
+		while( n ) {
+			size_t len = Math::min( n, RNG_CHUNK );
+			fill( buf, len );
+			for( size_t i = 0; i < len; i++ )
+				dst[ i ] = min + scale * ( float ) ( buf[ i ] >> 8 );
+			dst += len;
+			n -= len;
+		}
+	}
+
+	void RNG::fillGaussian( float* dst, size_t n, float sigma )
+	{
+		uint32_t buf[ RNG_CHUNK ];
+
+		/* Box-Muller, one pair of uniform values per pair of outputs */
+		while( n ) {
+			size_t pairs = Math::min( ( n + 1 ) >> 1, RNG_CHUNK >> 1 );
+			fill( buf, pairs << 1 );
+			for( size_t i = 0; i < pairs; i++ ) {
+				/* u in ( 0, 1 ] */
+				float u = 5.9604644775390625E-8f * ( float ) ( ( buf[ 2 * i ] >> 8 ) + 1 );
+				float phi = 3.7450702e-07f * ( float ) ( buf[ 2 * i + 1 ] >> 8 ); /* 2 pi 2^-24 */
+				float r = sigma * Math::sqrt( -2.0f * Math::log( u ) );
+				*dst++ = r * Math::cos( phi );
+				if( --n == 0 )
+					break;
+				*dst++ = r * Math::sin( phi );
+				n--;
+			}
+		}
+	}
+
+}
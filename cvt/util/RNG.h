@@ -29,17 +29,39 @@
 
 namespace cvt
 {
+	/**
+	  Counter based random number generator ( Philox4x32-10 ).
+
+	  The output is the encryption of a 128 bit counter ( block index, stream )
+	  with the 64 bit seed as key. Generators with the same seed and different
+	  stream ids produce independent sequences, so parallel code should create
+	  one generator per task, e.g. RNG( seed, taskIndex ), instead of sharing one:
+	  the results are then independent of the number of threads.
+
+	  Bulk fills produce the same values as the corresponding sequence of single
+	  calls to uint32().
+	 */
 	class RNG
 	{
 		public:
-			RNG( uint64_t seed );
+			RNG( uint64_t seed, uint64_t stream = 0 );
+
+			/* generator with the same seed for another stream */
+			RNG			split( uint64_t stream ) const;
+
+			uint64_t	seed() const { return _key; }
+			uint64_t	stream() const { return _stream; }
+			/* jump to the n-th 128 bit block of the stream */
+			void		seek( uint64_t block );
 
 			uint32_t	uint32();
 			uint64_t	uint64();
+			/* in [ 0, n ) */
+			uint32_t	uint32( uint32_t n );
 			float		fl();
 			double		db();
 
-			/* uniform distribution */
+			/* uniform distribution in [ min, max ) */
 			double		uniform( double min, double max );
 			float		uniform( float min, float max );
 			int			uniform( int min, int max );
@@ -47,56 +69,105 @@ namespace cvt
 			/* zero mean, with sigma stddev */
 			double		gaussian( double sigma );
 
+			void		fill( uint32_t* dst, size_t n );
+			void		fillUniform( float* dst, size_t n, float min = 0.0f, float max = 1.0f );
+			/* zero mean, sigma stddev */
+			void		fillGaussian( float* dst, size_t n, float sigma = 1.0f );
+
+			/* one Philox4x32-10 block */
+			static void	block( uint32_t dst[ 4 ], uint64_t counter, uint64_t stream, uint64_t key );
+
 		private:
-			uint64_t _u;
-			uint64_t _v;
-			uint64_t _w;
+			void		nextBlock();
+
+			uint64_t	_key;
+			uint64_t	_stream;
+			uint64_t	_counter;
+			uint32_t	_block[ 4 ];
+			size_t		_pos;
 	};
 
-	inline RNG::RNG( uint64_t seed ) :
-		_v( 4101842887655102017LL ),
-		_w( 1 )
+	inline RNG::RNG( uint64_t seed, uint64_t stream ) :
+		_key( seed ),
+		_stream( stream ),
+		_counter( 0 ),
+		_pos( 4 )
 	{
-		_u = seed ^ _v;
-		uint64();
-		_v = _u;
-		uint64();
-		_w = _v;
-		uint64();
 	}
 
-	inline uint64_t RNG::uint64()
+	inline RNG RNG::split( uint64_t stream ) const
 	{
-		_u = _u * 2862933555777941757LL + 7046029254386353087LL;
-		_v ^= _v >> 17;
-		_v ^= _v << 31;
-		_v ^= _v >> 8;
-		_w = 4294957665U * ( _w & 0xffffffff ) + ( _w >> 32 );
+		return RNG( _key, stream );
+	}
 
-		uint64_t x = _u ^ ( _u << 21 );
+	inline void RNG::seek( uint64_t block )
+	{
+		_counter = block;
+		_pos = 4;
+	}
 
-		x ^= x >> 35;
-		x ^= x << 4;
+	inline void RNG::block( uint32_t dst[ 4 ], uint64_t counter, uint64_t stream, uint64_t key )
+	{
+		uint32_t c0 = ( uint32_t ) counter;
+		uint32_t c1 = ( uint32_t ) ( counter >> 32 );
+		uint32_t c2 = ( uint32_t ) stream;
+		uint32_t c3 = ( uint32_t ) ( stream >> 32 );
+		uint32_t k0 = ( uint32_t ) key;
+		uint32_t k1 = ( uint32_t ) ( key >> 32 );
+
+		for( int r = 0; r < 10; r++ ) {
+			uint64_t p0 = ( uint64_t ) 0xD2511F53 * c0;
+			uint64_t p1 = ( uint64_t ) 0xCD9E8D57 * c2;
+			c0 = ( uint32_t ) ( p1 >> 32 ) ^ c1 ^ k0;
+			c1 = ( uint32_t ) p1;
+			c2 = ( uint32_t ) ( p0 >> 32 ) ^ c3 ^ k1;
+			c3 = ( uint32_t ) p0;
+			k0 += 0x9E3779B9;
+			k1 += 0xBB67AE85;
+		}
+
+		dst[ 0 ] = c0;
+		dst[ 1 ] = c1;
+		dst[ 2 ] = c2;
+		dst[ 3 ] = c3;
+	}
 
-		return ( x + _v ) ^ _w;
+	inline void RNG::nextBlock()
+	{
+		block( _block, _counter++, _stream, _key );
+		_pos = 0;
 	}
 
-	/* between 0 and 1 */
-	inline float RNG::fl()
+	inline uint32_t RNG::uint32()
 	{
-		return ( float )2.3283064365386962890625E-10 * uint32();
+		if( _pos == 4 )
+			nextBlock();
+		return _block[ _pos++ ];
 	}
 
-	/* between 0.0 and 1.0 */
-	inline double RNG::db()
+	inline uint64_t RNG::uint64()
 	{
-		/* 2^-64 * uint64 */
-		return 5.4210108624275221700372640043497E-20 * uint64();
+		uint64_t lo = uint32();
+		return ( ( uint64_t ) uint32() << 32 ) | lo;
 	}
 
-	inline uint32_t RNG::uint32()
+	inline uint32_t RNG::uint32( uint32_t n )
+	{
+		return ( uint32_t ) ( ( ( uint64_t ) uint32() * n ) >> 32 );
+	}
+
+	/* between 0 and 1, 1 excluded */
+	inline float RNG::fl()
+	{
+		/* 2^-24 * 24 bit */
+		return 5.9604644775390625E-8f * ( float ) ( uint32() >> 8 );
+	}
+
+	/* between 0.0 and 1.0, 1.0 excluded */
+	inline double RNG::db()
 	{
-		return ( uint32_t ) uint64();
+		/* 2^-53 * 53 bit */
+		return 1.1102230246251565404236316680908203125E-16 * ( double ) ( uint64() >> 11 );
 	}
 
 	inline double RNG::gaussian( double sigma )
@@ -108,7 +179,7 @@ namespace cvt
 			x = u - 0.449871;
 			y = Math::abs( v ) + 0.386595;
 			q = x*x + y * ( 0.19600 * y - 0.25472 * x );
-		} while ( q > 0.27597 && ( q > 0.27846 || v*v > -4.0 * log( u ) *u*u ) );
+		} while ( u == 0.0 || ( q > 0.27597 && ( q > 0.27846 || v*v > -4.0 * log( u ) *u*u ) ) );
 
 		return sigma * v / u;
 	}
@@ -125,7 +196,7 @@ namespace cvt
 
 	inline int RNG::uniform( int min, int max )
 	{
-		return (int) ( min + fl() * ( max - min ) );
+		return (int) ( min + db() * ( max - min ) );
 	}
 
 }
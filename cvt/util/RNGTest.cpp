@@ -0,0 +1,166 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/RNG.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/CVTTest.h>
+
+#include <vector>
+#include <sstream>
+
+namespace cvt {
+
+	/* known answers of the Philox4x32-10 reference implementation */
+	static bool _testKnownAnswers()
+	{
+		uint32_t out[ 4 ];
+		bool ret = true;
+
+		RNG::block( out, 0, 0, 0 );
+		ret &= out[ 0 ] == 0x6627e8d5 && out[ 1 ] == 0xe169c58d && out[ 2 ] == 0xbc57ac4c && out[ 3 ] == 0x9b00dbd8;
+
+		RNG::block( out, 0xffffffffffffffffULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL );
+		ret &= out[ 0 ] == 0x408f276d && out[ 1 ] == 0x41c83b0e && out[ 2 ] == 0xa20bc7c6 && out[ 3 ] == 0x6d5451fd;
+
+		RNG::block( out, 0x85a308d3243f6a88ULL, 0x0370734413198a2eULL, 0x299f31d0a4093822ULL );
+		ret &= out[ 0 ] == 0xd16cfe09 && out[ 1 ] == 0x94fdcceb && out[ 2 ] == 0x5001e420 && out[ 3 ] == 0x24126ea1;
+
+		return ret;
+	}
+
+	static void _testSIMD()
+	{
+		const size_t blocks = 37;
+		std::vector<uint32_t> ref( blocks * 4 ), out( blocks * 4 );
+		for( size_t i = 0; i < blocks; i++ )
+			RNG::block( &ref[ i * 4 ], 0xfffffffeULL + i, 17, 0x123456789ULL );
+
+		SIMDType bestType = SIMD::bestSupportedType();
+		for( int st = SIMD_BASE; st <= bestType; st++ ) {
+			SIMD* simd = SIMD::get( ( SIMDType ) st );
+			simd->philox4x32( &out[ 0 ], blocks, 0xfffffffeULL, 17, 0x123456789ULL );
+			std::stringstream ss;
+			ss << simd->name() << " philox4x32";
+			CVTTEST_PRINT( ss.str(), out == ref );
+			delete simd;
+		}
+	}
+
+	static bool _testStreams()
+	{
+		bool ret = true;
+
+		/* bulk fills continue the sequence of single draws */
+		RNG a( 42, 3 ), b( 42, 3 );
+		std::vector<uint32_t> bulk( 103 );
+		a.uint32();
+		a.fill( &bulk[ 0 ], bulk.size() );
+		b.uint32();
+		for( size_t i = 0; i < bulk.size(); i++ )
+			ret &= bulk[ i ] == b.uint32();
+		ret &= a.uint32() == b.uint32();
+
+		/* seek and split reproduce */
+		RNG c = a.split( 3 );
+		c.seek( 10 );
+		RNG d( 42, 3 );
+		for( size_t i = 0; i < 40; i++ )
+			d.uint32();
+		ret &= c.uint32() == d.uint32();
+
+		/* different streams differ */
+		RNG e( 42, 4 );
+		RNG f( 42, 3 );
+		size_t equal = 0;
+		for( size_t i = 0; i < 100; i++ )
+			equal += e.uint32() == f.uint32();
+		ret &= equal < 2;
+
+		return ret;
+	}
+
+	static bool _testDistributions()
+	{
+		const size_t n = 100001;
+		std::vector<float> v( n );
+		RNG rng( 7 );
+		bool ret = true;
+
+		rng.fillUniform( &v[ 0 ], n, -2.0f, 6.0f );
+		double mean = 0.0;
+		for( size_t i = 0; i < n; i++ ) {
+			ret &= v[ i ] >= -2.0f && v[ i ] < 6.0f;
+			mean += v[ i ];
+		}
+		mean /= n;
+		ret &= Math::abs( mean - 2.0 ) < 0.05;
+
+		rng.fillGaussian( &v[ 0 ], n, 3.0f );
+		mean = 0.0;
+		double var = 0.0;
+		for( size_t i = 0; i < n; i++ ) {
+			mean += v[ i ];
+			var += Math::sqr( ( double ) v[ i ] );
+		}
+		mean /= n;
+		var = var / n - Math::sqr( mean );
+		ret &= Math::abs( mean ) < 0.05 && Math::abs( var - 9.0 ) < 0.2;
+
+		size_t hist[ 5 ] = { 0, 0, 0, 0, 0 };
+		for( size_t i = 0; i < 10000; i++ ) {
+			int k = rng.uniform( 0, 5 );
+			if( k < 0 || k >= 5 )
+				return false;
+			hist[ k ]++;
+			ret &= rng.uint32( 5 ) < 5;
+		}
+		for( size_t k = 0; k < 5; k++ )
+			ret &= hist[ k ] > 1800 && hist[ k ] < 2200;
+
+		return ret;
+	}
+
+BEGIN_CVTTEST( RNG )
+	bool ret = true;
+	bool b;
+
+	b = _testKnownAnswers();
+	CVTTEST_PRINT( "Philox4x32-10 known answers", b );
+	ret &= b;
+
+	_testSIMD();
+
+	b = _testStreams();
+	CVTTEST_PRINT( "RNG streams, seek and bulk fill", b );
+	ret &= b;
+
+	b = _testDistributions();
+	CVTTEST_PRINT( "RNG uniform and gaussian", b );
+	ret &= b;
+
+	return ret;
+END_CVTTEST
+
+}
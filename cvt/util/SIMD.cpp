@@ -26,6 +26,7 @@
 
 #include <cvt/util/SIMD.h>
 #include <cvt/math/Math.h>
+#include <cvt/util/RNG.h>
 #include <cvt/util/SIMDSSE.h>
 #include <cvt/util/SIMDSSE2.h>
 #include <cvt/util/SIMDSSE3.h>
@@ -33,6 +34,7 @@
 #include <cvt/util/SIMDSSE41.h>
 #include <cvt/util/SIMDSSE42.h>
 #include <cvt/util/SIMDAVX.h>
+#include <cvt/util/SIMDAVX2.h>
 #include <cvt/util/CPU.h>
 
 
@@ -745,7 +747,9 @@ namespace cvt {
         if( type == SIMD_BEST ) {
             CPUFeatures cpuf;
             cpuf = cpuFeatures();
-            if( cpuf & CPU_AVX ){
+            if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_F16C ) && ( cpuf & CPU_FMA ) ){
+                return new SIMDAVX2();
+            } else if( cpuf & CPU_AVX ){
                 return new SIMDAVX();
             } else if( cpuf & CPU_SSE4_2 ){
                 return new SIMDSSE42();
@@ -773,6 +777,7 @@ namespace cvt {
                 case SIMD_SSE41: return new SIMDSSE41();
                 case SIMD_SSE42: return new SIMDSSE42();
                 case SIMD_AVX: return new SIMDAVX();
+                case SIMD_AVX2: return new SIMDAVX2();
             }
         }
     }
@@ -781,7 +786,9 @@ namespace cvt {
     {
         CPUFeatures cpuf;
         cpuf = cpuFeatures();
-        if( cpuf & CPU_AVX ){
+        if( ( cpuf & CPU_AVX2 ) && ( cpuf & CPU_F16C ) && ( cpuf & CPU_FMA ) ){
+            return SIMD_AVX2;
+        } else if( cpuf & CPU_AVX ){
             return SIMD_AVX;
         } else if( cpuf & CPU_SSE4_2 ){
             return SIMD_SSE42;
@@ -2066,6 +2073,62 @@ namespace cvt {
     }
 
 
+    void SIMD::Conv_f_to_h( uint16_t* dst, const float* src, const size_t n ) const
+    {
+        size_t i = n >> 2;
+        while( i-- ) {
+            *dst++ = Math::floatToHalf( *src++ );
+            *dst++ = Math::floatToHalf( *src++ );
+            *dst++ = Math::floatToHalf( *src++ );
+            *dst++ = Math::floatToHalf( *src++ );
+        }
+        i = n & 0x03;
+        while( i-- )
+            *dst++ = Math::floatToHalf( *src++ );
+    }
+
+    void SIMD::Conv_h_to_f( float* dst, const uint16_t* src, const size_t n ) const
+    {
+        size_t i = n >> 2;
+        while( i-- ) {
+            *dst++ = Math::halfToFloat( *src++ );
+            *dst++ = Math::halfToFloat( *src++ );
+            *dst++ = Math::halfToFloat( *src++ );
+            *dst++ = Math::halfToFloat( *src++ );
+        }
+        i = n & 0x03;
+        while( i-- )
+            *dst++ = Math::halfToFloat( *src++ );
+    }
+
+    void SIMD::Conv_u8_to_h( uint16_t* dst, const uint8_t* src, const size_t n ) const
+    {
+        size_t i = n >> 2;
+        while( i-- ) {
+            *dst++ = Math::floatToHalf( U8_TO_F( *src++ ) );
+            *dst++ = Math::floatToHalf( U8_TO_F( *src++ ) );
+            *dst++ = Math::floatToHalf( U8_TO_F( *src++ ) );
+            *dst++ = Math::floatToHalf( U8_TO_F( *src++ ) );
+        }
+        i = n & 0x03;
+        while( i-- )
+            *dst++ = Math::floatToHalf( U8_TO_F( *src++ ) );
+    }
+
+    void SIMD::Conv_h_to_u8( uint8_t* dst, const uint16_t* src, const size_t n ) const
+    {
+        size_t i = n >> 2;
+        while( i-- ) {
+            *dst++ = ( uint8_t ) Math::clamp( Math::halfToFloat( *src++ ) * 255.0f + 0.5f, 0.0f, 255.0f );
+            *dst++ = ( uint8_t ) Math::clamp( Math::halfToFloat( *src++ ) * 255.0f + 0.5f, 0.0f, 255.0f );
+            *dst++ = ( uint8_t ) Math::clamp( Math::halfToFloat( *src++ ) * 255.0f + 0.5f, 0.0f, 255.0f );
+            *dst++ = ( uint8_t ) Math::clamp( Math::halfToFloat( *src++ ) * 255.0f + 0.5f, 0.0f, 255.0f );
+        }
+        i = n & 0x03;
+        while( i-- )
+            *dst++ = ( uint8_t ) Math::clamp( Math::halfToFloat( *src++ ) * 255.0f + 0.5f, 0.0f, 255.0f );
+    }
+
     void SIMD::Conv_u16_to_f( float* dst, uint16_t const* src, const size_t n ) const
     {
         size_t i = n >> 2;
@@ -3732,6 +3795,61 @@ namespace cvt {
 
 	}
 
+	void SIMD::ConvolveHorizontal1h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const
+	{
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+        for( x = 0; x < b1; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * Math::halfToFloat( src[ pos ] );
+			}
+            *dst++ = tmp;
+        }
+        for( ; x < ( ssize_t ) width - b2; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = x - b1 + k;
+				tmp += weights[ k ] * Math::halfToFloat( src[ pos ] );
+			}
+            *dst++ = tmp;
+        }
+        for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * Math::halfToFloat( src[ pos ] );
+			}
+            *dst++ = tmp;
+        }
+	}
+
+	void SIMD::ConvolveHorizontal4h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const
+	{
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+        for( x = 0; x < ( ssize_t ) width; x++ ) {
+			float tmp[ 4 ] = { 0, 0, 0, 0 };
+			bool border = x < b1 || x >= ( ssize_t ) width - b2;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = border ? IBorder::value<ssize_t>( x - b1 + k, width, btype ) << 2 : ( x - b1 + k ) << 2;
+				tmp[ 0 ] += weights[ k ] * Math::halfToFloat( src[ pos + 0 ] );
+				tmp[ 1 ] += weights[ k ] * Math::halfToFloat( src[ pos + 1 ] );
+				tmp[ 2 ] += weights[ k ] * Math::halfToFloat( src[ pos + 2 ] );
+				tmp[ 3 ] += weights[ k ] * Math::halfToFloat( src[ pos + 3 ] );
+			}
+            *dst++ = tmp[ 0 ];
+            *dst++ = tmp[ 1 ];
+            *dst++ = tmp[ 2 ];
+            *dst++ = tmp[ 3 ];
+        }
+	}
+
 	void SIMD::ConvolveHorizontalSym1u8_to_f( float* dst, const uint8_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const
 	{
         if( wn == 1 ) {
@@ -4129,6 +4247,27 @@ namespace cvt {
     }
 
 
+    void SIMD::IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const
+    {
+        const float* x0 = x[ 0 ];
+        const float* x1 = x[ 1 ];
+        const float* x2 = x[ 2 ];
+        const float* x3 = x[ 3 ];
+        const float* y0 = y[ 0 ];
+        const float* y1 = y[ 1 ];
+        const float* y2 = y[ 2 ];
+        const float* y3 = y[ 3 ];
+        float tmp;
+
+        for( size_t i = 0; i < n; i++ ) {
+            tmp = c[ 0 ] * x0[ i ] + c[ 1 ] * x1[ i ] + c[ 2 ] * x2[ i ] + c[ 3 ] * x3[ i ]
+                - c[ 4 ] * y0[ i ] - c[ 5 ] * y1[ i ] - c[ 6 ] * y2[ i ] - c[ 7 ] * y3[ i ];
+            dst[ i ] = tmp;
+            if( acc )
+                acc[ i ] += tmp;
+        }
+    }
+
     void SIMD::ConvolveAdaptiveClamp1f( float* _dst, float const* _src, const size_t w, IConvolveAdaptivef* conva ) const
     {
         IConvolveAdaptiveSize* sw;
@@ -4609,6 +4748,85 @@ namespace cvt {
 
     }
 
+    void SIMD::warpBilinear1h_to_f( float* dst, const float* coords, const uint16_t* _src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const
+    {
+        const uint8_t* src = ( const uint8_t* ) _src;
+        int endx = ( ( int ) srcWidth ) - 1;
+        int endy = ( ( int ) srcHeight ) - 1;
+
+        while( n-- )
+        {
+            float fx, fy;
+
+            fx = *coords++;
+            fy = *coords++;
+            int lx = _floor( fx );
+            int ly = _floor( fy );
+
+            if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+                float alpha1 = fx - ( float ) lx;
+                float alpha2 = fy - ( float ) ly;
+                float v1, v2, a, b;
+                const uint16_t* ptr = ( const uint16_t* ) ( src + srcStride * ly + sizeof( uint16_t ) * lx );
+                a = Math::halfToFloat( *ptr );
+                b = Math::halfToFloat( *( ptr + 1 ) );
+                v1 = Math::mix( a, b, alpha1 );
+                ptr = ( const uint16_t* ) ( ( ( const uint8_t* ) ptr ) + srcStride );
+                a = Math::halfToFloat( *ptr );
+                b = Math::halfToFloat( *( ptr + 1 ) );
+                v2 = Math::mix( a, b, alpha1 );
+                *dst++ = Math::mix( v1, v2, alpha2 );
+            } else if( lx >= -1 && lx < ( int ) srcWidth && ly >= -1 && ly < ( int ) srcHeight ) {
+                float alpha1 = fx - ( float ) lx;
+                float alpha2 = fy - ( float ) ly;
+#define VAL( fx, fy ) ( ( fx ) >= 0 && ( fx ) < ( int ) srcWidth && ( fy ) >= 0 && ( fy ) < ( int ) srcHeight ) ? Math::halfToFloat( *( ( const uint16_t* ) ( src + srcStride * ( fy ) + sizeof( uint16_t ) * ( fx ) ) ) ) : fillcolor
+                float v1, v2, a, b;
+                a = VAL( lx, ly );
+                b = VAL( lx + 1, ly );
+                v1 = Math::mix( a, b, alpha1 );
+                a = VAL( lx, ly + 1 );
+                b = VAL( lx + 1, ly + 1 );
+                v2 = Math::mix( a, b, alpha1 );
+                *dst++ = Math::mix( v1, v2, alpha2 );
+#undef VAL
+            } else
+                *dst++ = fillcolor;
+        }
+    }
+
+    void SIMD::warpBilinear4h_to_f( float* dst, const float* coords, const uint16_t* _src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const
+    {
+        const uint8_t* src = ( const uint8_t* ) _src;
+
+        while( n-- )
+        {
+            float fx, fy;
+
+            fx = *coords++;
+            fy = *coords++;
+
+            int lx = _floor( fx );
+            int ly = _floor( fy );
+
+            if( lx >= -1 && lx < ( int ) srcWidth && ly >= -1 && ly < ( int ) srcHeight ) {
+                float alpha1 = fx - ( float ) lx;
+                float alpha2 = fy - ( float ) ly;
+#define VAL( fx, fy, offset ) ( ( fx ) >= 0 && ( fx ) < ( int ) srcWidth && ( fy ) >= 0 && ( fy ) < ( int ) srcHeight ) ? Math::halfToFloat( *( ( const uint16_t* ) ( src + srcStride * ( fy ) + sizeof( uint16_t ) * ( ( fx ) * 4 + offset ) ) ) ) : fillcolor[ offset ]
+                for( int c = 0; c < 4; c++ ) {
+                    float v1 = Math::mix( VAL( lx, ly, c ), VAL( 1 + lx, ly, c ), alpha1 );
+                    float v2 = Math::mix( VAL( lx, 1 + ly, c ), VAL( 1 + lx, 1 + ly, c ), alpha1 );
+                    *dst++ = Math::mix( v1, v2, alpha2 );
+                }
+#undef VAL
+            } else {
+                *dst++ = fillcolor[ 0 ];
+                *dst++ = fillcolor[ 1 ];
+                *dst++ = fillcolor[ 2 ];
+                *dst++ = fillcolor[ 3 ];
+            }
+        }
+    }
+
     void SIMD::warpBilinear1u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const
     {
         int endx = ( ( int ) srcWidth ) - 1;
@@ -5795,6 +6013,35 @@ namespace cvt {
         return d;
     }
 
+    void SIMD::hammingDistances_u64_to_u8( uint8_t* dst, uint64_t ref, const uint64_t* src, size_t n ) const
+    {
+        while( n-- ) {
+            uint64_t xored = ref ^ *src++;
+            xored = xored - ( ( xored >> 1 ) & 0x5555555555555555ll );
+            xored = ( xored & 0x3333333333333333ll ) + ( ( xored >> 2 ) & 0x3333333333333333ll );
+            xored = ( xored + ( xored >> 4 ) ) & 0x0F0F0F0F0F0F0F0Fll;
+            *dst++ = ( uint8_t ) ( ( xored * 0x0101010101010101ll ) >> 56 );
+        }
+    }
+
+    uint16_t SIMD::SGMPath_u8_to_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost,
+                                      uint16_t prevmin, uint16_t p1, uint16_t p2, size_t n ) const
+    {
+        uint16_t jump = prevmin + p2;
+        uint16_t min = 0xffff;
+
+        for( size_t d = 0; d < n; d++ ) {
+            uint16_t l = Math::min( prev[ d ], jump );
+            l = Math::min<uint16_t>( l, prev[ d - 1 ] + p1 );
+            l = Math::min<uint16_t>( l, prev[ d + 1 ] + p1 );
+            l = cost[ d ] + l - prevmin;
+            dst[ d ] = l;
+            sum[ d ] += l;
+            min = Math::min( min, l );
+        }
+        return min;
+    }
+
     /*
     {
         size_t d = 0;
@@ -5955,6 +6202,49 @@ namespace cvt {
     }
 
 
+    /* prefix sum with exact accumulation in DST, the first row is not added to any previous row */
+    template<typename DST, typename SRC, bool SQUARED>
+    static inline void prefixSumExact( DST* dst, size_t dstStride, const SRC* src, size_t srcStride, size_t width, size_t height )
+    {
+        const DST* prevRow = NULL;
+        while( height-- ){
+            DST currRow = 0;
+            for( size_t i = 0; i < width; i++ ){
+                DST v = ( DST ) src[ i ];
+                currRow += SQUARED ? v * v : v;
+                dst[ i ] = prevRow ? currRow + prevRow[ i ] : currRow;
+            }
+            prevRow = dst;
+            dst += dstStride;
+            src += srcStride;
+        }
+    }
+
+    void SIMD::prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        prefixSumExact<uint32_t, uint8_t, false>( dst, dstStride, src, srcStride, width, height );
+    }
+
+    void SIMD::prefixSum1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        prefixSumExact<uint64_t, uint8_t, false>( dst, dstStride, src, srcStride, width, height );
+    }
+
+    void SIMD::prefixSumSqr1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        prefixSumExact<uint64_t, uint8_t, true>( dst, dstStride, src, srcStride, width, height );
+    }
+
+    void SIMD::prefixSum1_f_to_d( double* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        prefixSumExact<double, float, false>( dst, dstStride, src, srcStride, width, height );
+    }
+
+    void SIMD::prefixSumSqr1_f_to_d( double* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const
+    {
+        prefixSumExact<double, float, true>( dst, dstStride, src, srcStride, width, height );
+    }
+
 	void SIMD::boxFilterPrefixSum1_f_to_f( float* dst, size_t dststride, const float* src, size_t srcstride, size_t width, size_t height, size_t boxwidth, size_t boxheight ) const
 	{
 		// FIXME
@@ -6271,6 +6561,46 @@ namespace cvt {
         }
     }
 
+    float SIMD::normalEquations6_f( float* AtA, float* Atb, const float* J, size_t stride, const float* r, const float* w, size_t n ) const
+    {
+        float err = 0.0f;
+        for( size_t i = 0; i < n; i++ ){
+            float j[ 6 ];
+            for( size_t k = 0; k < 6; k++ )
+                j[ k ] = J[ k * stride + i ];
+            float wr = w[ i ] * r[ i ];
+            float* a = AtA;
+            for( size_t k = 0; k < 6; k++ ){
+                float wj = w[ i ] * j[ k ];
+                for( size_t l = k; l < 6; l++ )
+                    *a++ += wj * j[ l ];
+                Atb[ k ] += j[ k ] * wr;
+            }
+            err += wr * r[ i ];
+        }
+        return err;
+    }
+
+    void SIMD::sqrDistances_f( float* dst, const float* coords, size_t stride, const float* pt, size_t dim, size_t n ) const
+    {
+        for( size_t i = 0; i < n; i++ ){
+            float d = 0.0f;
+            for( size_t k = 0; k < dim; k++ ){
+                float t = coords[ k * stride + i ] - pt[ k ];
+                d += t * t;
+            }
+            dst[ i ] = d;
+        }
+    }
+
+    void SIMD::philox4x32( uint32_t* dst, size_t blocks, uint64_t counter, uint64_t stream, uint64_t key ) const
+    {
+        while( blocks-- ){
+            RNG::block( dst, counter++, stream, key );
+            dst += 4;
+        }
+    }
+
     void SIMD::cleanup()
     {
         if( _simd )
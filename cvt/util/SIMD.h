@@ -44,6 +44,7 @@ namespace cvt {
         SIMD_SSE41,
         SIMD_SSE42,
         SIMD_AVX,
+        SIMD_AVX2,
         SIMD_BEST
     };
 
@@ -201,6 +202,10 @@ namespace cvt {
             virtual void ConvolveHorizontalSym2u8_to_f( float* dst, const uint8_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
             virtual void ConvolveHorizontalSym4u8_to_f( float* dst, const uint8_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
 
+            /* half float input, accumulation in float */
+            virtual void ConvolveHorizontal1h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontal4h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
+
             virtual void ConvolveClampVert_fx_to_u8( uint8_t* dst, const Fixed** bufs, const Fixed* weights, size_t numw, size_t width ) const;
             virtual void ConvolveClampVert_fx_to_s16( int16_t* dst, const Fixed** bufs, const Fixed* weights, size_t numw, size_t width ) const;
             virtual void ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
@@ -212,6 +217,11 @@ namespace cvt {
             virtual void ConvolveClampVertSym_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
             virtual void ConvolveClampVertSym_f_to_s16( int16_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
 
+            /* 4th order recursion evaluated for n independent signals:
+               dst = c[ 0..3 ] * ( x[ 0 ], x[ 1 ], x[ 2 ], x[ 3 ] ) - c[ 4..7 ] * ( y[ 0 ], y[ 1 ], y[ 2 ], y[ 3 ] )
+               with x[ 0 ] the current input and y[ 0 ] the last output, added to acc if not NULL */
+            virtual void IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const;
+
             virtual void ConvolveAdaptiveClamp1f( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
             virtual void ConvolveAdaptiveClamp2f( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
             virtual void ConvolveAdaptiveClamp4f( float* _dst, float const* _src, const size_t width, IConvolveAdaptivef* conva ) const;
@@ -227,6 +237,12 @@ namespace cvt {
             // uint8_t -> ...
             virtual void Conv_u8_to_f( float* dst, const uint8_t* src, const size_t n ) const;
 
+            // half float ( IEEE 754 binary16 stored in uint16_t ) <-> ...
+            virtual void Conv_f_to_h( uint16_t* dst, const float* src, const size_t n ) const;
+            virtual void Conv_h_to_f( float* dst, const uint16_t* src, const size_t n ) const;
+            virtual void Conv_u8_to_h( uint16_t* dst, const uint8_t* src, const size_t n ) const;
+            virtual void Conv_h_to_u8( uint8_t* dst, const uint16_t* src, const size_t n ) const;
+
             // int16_t -> ...
             virtual void Conv_s16_to_u8( uint8_t* dst, int16_t const* src, const size_t n ) const;
 
@@ -314,6 +330,8 @@ namespace cvt {
             virtual void warpBilinear4f( float* dst, const float* coords, const float* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const;
             virtual void warpBilinear1u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint8_t fill, size_t n ) const;
             virtual void warpBilinear4u8( uint8_t* dst, const float* coords, const uint8_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, uint32_t fill, size_t n ) const;
+            virtual void warpBilinear1h_to_f( float* dst, const float* coords, const uint16_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const;
+            virtual void warpBilinear4h_to_f( float* dst, const float* coords, const uint16_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const;
 
 			virtual void harrisScore1f( float* dst, const float* boxdx2, const float* boxdy2, const float* boxdxdy, float kappa, size_t width ) const;
 
@@ -336,6 +354,14 @@ namespace cvt {
             virtual void debayer_ODD_RGGBu8_GRAYu8( uint32_t* dst, const uint32_t* src1, const uint32_t* src2, const uint32_t* src3, size_t n ) const;
 
             virtual size_t hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+            /* hamming distances of 64 bit descriptors: dst[ i ] = popcount( ref ^ src[ i ] ) */
+            virtual void hammingDistances_u64_to_u8( uint8_t* dst, uint64_t ref, const uint64_t* src, size_t n ) const;
+
+            /* semi-global matching path step over n disparities ( a multiple of 8 ):
+               dst[ d ] = cost[ d ] + min( prev[ d ], prev[ d - 1 ] + p1, prev[ d + 1 ] + p1, prevmin + p2 ) - prevmin,
+               added to sum. prev[ -1 ] and prev[ n ] have to be readable and large ( < 0x4000 ), returns the minimum of dst */
+            virtual uint16_t SGMPath_u8_to_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost,
+                                                uint16_t prevmin, uint16_t p1, uint16_t p2, size_t n ) const;
 
 			// prefix sum for 1 channel images
 			virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
@@ -346,6 +372,13 @@ namespace cvt {
 			virtual void prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
 			virtual void prefixSumSqr1_f_to_f( float * dst, size_t dStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
 
+			// exact prefix sums for integral tables that exceed the float precision
+			virtual void prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSum1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSumSqr1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSum1_f_to_d( double* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
+			virtual void prefixSumSqr1_f_to_d( double* dst, size_t dstStride, const float* src, size_t srcStride, size_t width, size_t height ) const;
+
 			virtual void boxFilterPrefixSum1_f_to_f( float* dst, size_t dstride, const float* src, size_t srcstride, size_t width, size_t height, size_t boxwidth, size_t boxheight ) const;
 			virtual void boxFilterPrefixSum1_f_to_u8( uint8_t* dst, size_t dstride, const float* src, size_t srcstride, size_t width, size_t height, size_t boxwidth, size_t boxheight ) const;
 
@@ -388,6 +421,34 @@ namespace cvt {
             virtual void projectPoints( Vector2f* dst, const Matrix4f& mat, const Vector3f* src, size_t n ) const;
             virtual void projectPoints( Vector2d* dst, const Matrix4d& mat, const Vector3d* src, size_t n ) const;
 
+            /**
+             *  \brief accumulate the weighted normal equations of a least squares problem with 6 parameters
+             *  \param AtA      upper triangle of J^T W J row by row ( 21 values ), the row sums are added
+             *  \param Atb      J^T W r ( 6 values ), the row sums are added
+             *  \param J        the Jacobian as 6 planes, component k of row i is J[ k * stride + i ]
+             *  \param r        the residuals
+             *  \param w        the weights, rows with weight zero must still have finite values
+             *  \param n        the number of rows
+             *  \return         the sum of w * r^2
+             */
+            virtual float normalEquations6_f( float* AtA, float* Atb, const float* J, size_t stride, const float* r, const float* w, size_t n ) const;
+
+            /**
+             *  \brief squared euclidean distances of points stored as coordinate planes to a single point
+             *  \param dst      the squared distances
+             *  \param coords   the points as dim planes, coordinate k of point i is coords[ k * stride + i ]
+             *  \param pt       the query point with dim coordinates
+             */
+            virtual void sqrDistances_f( float* dst, const float* coords, size_t stride, const float* pt, size_t dim, size_t n ) const;
+
+            /**
+             *  \brief Philox4x32-10 counter based random numbers
+             *  \param dst      4 * blocks random values, block i is the encrypted counter
+             *                  ( counter + i, stream ) with the 64 bit key
+             *  \param blocks   the number of 128 bit blocks to generate
+             */
+            virtual void philox4x32( uint32_t* dst, size_t blocks, uint64_t counter, uint64_t stream, uint64_t key ) const;
+
             virtual std::string name() const;
             virtual SIMDType type() const;
 
@@ -204,4 +204,44 @@ namespace cvt
 		return Math::invSqrt( var1var2 ) * cov;
 	}
 
+	void SIMDAVX::IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const
+	{
+		const float* x0 = x[ 0 ];
+		const float* x1 = x[ 1 ];
+		const float* x2 = x[ 2 ];
+		const float* x3 = x[ 3 ];
+		const float* y0 = y[ 0 ];
+		const float* y1 = y[ 1 ];
+		const float* y2 = y[ 2 ];
+		const float* y3 = y[ 3 ];
+		__m256 c0, c1, c2, c3, c4, c5, c6, c7, r;
+		size_t i = 0;
+
+		c0 = _mm256_set1_ps( c[ 0 ] );
+		c1 = _mm256_set1_ps( c[ 1 ] );
+		c2 = _mm256_set1_ps( c[ 2 ] );
+		c3 = _mm256_set1_ps( c[ 3 ] );
+		c4 = _mm256_set1_ps( c[ 4 ] );
+		c5 = _mm256_set1_ps( c[ 5 ] );
+		c6 = _mm256_set1_ps( c[ 6 ] );
+		c7 = _mm256_set1_ps( c[ 7 ] );
+
+		for( ; i + 8 <= n; i += 8 ) {
+			r = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( c0, _mm256_loadu_ps( x0 + i ) ), _mm256_mul_ps( c1, _mm256_loadu_ps( x1 + i ) ) ),
+							   _mm256_add_ps( _mm256_mul_ps( c2, _mm256_loadu_ps( x2 + i ) ), _mm256_mul_ps( c3, _mm256_loadu_ps( x3 + i ) ) ) );
+			r = _mm256_sub_ps( r, _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( c4, _mm256_loadu_ps( y0 + i ) ), _mm256_mul_ps( c5, _mm256_loadu_ps( y1 + i ) ) ),
+												 _mm256_add_ps( _mm256_mul_ps( c6, _mm256_loadu_ps( y2 + i ) ), _mm256_mul_ps( c7, _mm256_loadu_ps( y3 + i ) ) ) ) );
+			_mm256_storeu_ps( dst + i, r );
+			if( acc )
+				_mm256_storeu_ps( acc + i, _mm256_add_ps( _mm256_loadu_ps( acc + i ), r ) );
+		}
+
+		/* remaining signals with the SSE version */
+		if( i < n ) {
+			const float* xr[ 4 ] = { x0 + i, x1 + i, x2 + i, x3 + i };
+			const float* yr[ 4 ] = { y0 + i, y1 + i, y2 + i, y3 + i };
+			SIMDSSE42::IIR4_f( dst + i, acc ? acc + i : NULL, xr, yr, c, n - i );
+		}
+	}
+
 }
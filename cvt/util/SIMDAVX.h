@@ -40,6 +40,8 @@ namespace cvt {
             virtual float SSD( const float* src1, const float* src2, const size_t n ) const;
             virtual float NCC( const float* src1, const float* src2, const size_t n ) const;
 
+			virtual void IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const;
+
 			virtual std::string name() const;
 			virtual SIMDType type() const;
 	};
@@ -0,0 +1,290 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/util/SIMDAVX2.h>
+#include <cvt/math/Math.h>
+#include <cvt/gfx/IBorder.h>
+#include <immintrin.h>
+
+namespace cvt
+{
+	void SIMDAVX2::Conv_f_to_h( uint16_t* dst, const float* src, const size_t n ) const
+	{
+		size_t i = n >> 3;
+
+		while( i-- ) {
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_cvtps_ph( _mm256_loadu_ps( src ), _MM_FROUND_TO_NEAREST_INT ) );
+			src += 8;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0x07;
+		if( i )
+			SIMD::Conv_f_to_h( dst, src, i );
+	}
+
+	void SIMDAVX2::Conv_h_to_f( float* dst, const uint16_t* src, const size_t n ) const
+	{
+		size_t i = n >> 3;
+
+		while( i-- ) {
+			_mm256_storeu_ps( dst, _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) src ) ) );
+			src += 8;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0x07;
+		if( i )
+			SIMD::Conv_h_to_f( dst, src, i );
+	}
+
+	void SIMDAVX2::Conv_u8_to_h( uint16_t* dst, const uint8_t* src, const size_t n ) const
+	{
+		size_t i = n >> 3;
+		const __m256 scale = _mm256_set1_ps( 1.0f / 255.0f );
+
+		while( i-- ) {
+			__m256i in = _mm256_cvtepu8_epi32( _mm_loadl_epi64( ( const __m128i* ) src ) );
+			__m256 f = _mm256_mul_ps( _mm256_cvtepi32_ps( in ), scale );
+			_mm_storeu_si128( ( __m128i* ) dst, _mm256_cvtps_ph( f, _MM_FROUND_TO_NEAREST_INT ) );
+			src += 8;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0x07;
+		if( i )
+			SIMD::Conv_u8_to_h( dst, src, i );
+	}
+
+	void SIMDAVX2::Conv_h_to_u8( uint8_t* dst, const uint16_t* src, const size_t n ) const
+	{
+		size_t i = n >> 3;
+		const __m256 scale = _mm256_set1_ps( 255.0f );
+		const __m256 half = _mm256_set1_ps( 0.5f );
+		const __m256 zero = _mm256_setzero_ps();
+
+		while( i-- ) {
+			__m256 f = _mm256_fmadd_ps( _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) src ) ), scale, half );
+			f = _mm256_min_ps( _mm256_max_ps( f, zero ), scale );
+			__m256i in = _mm256_cvttps_epi32( f );
+			__m128i w = _mm_packus_epi32( _mm256_castsi256_si128( in ), _mm256_extracti128_si256( in, 1 ) );
+			_mm_storel_epi64( ( __m128i* ) dst, _mm_packus_epi16( w, w ) );
+			src += 8;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0x07;
+		if( i )
+			SIMD::Conv_h_to_u8( dst, src, i );
+	}
+
+	void SIMDAVX2::ConvolveHorizontal1h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const
+	{
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		if( ( ssize_t ) width - b2 - b1 < 8 ) {
+			SIMD::ConvolveHorizontal1h_to_f( dst, src, width, weights, wn, btype );
+			return;
+		}
+
+		for( x = 0; x < b1; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * Math::halfToFloat( src[ pos ] );
+			}
+			*dst++ = tmp;
+		}
+
+		for( ; x + 8 <= ( ssize_t ) width - b2; x += 8 ) {
+			const uint16_t* psrc = src + x - b1;
+			__m256 acc = _mm256_setzero_ps();
+			for( size_t k = 0; k < wn; k++ ) {
+				__m256 v = _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) ( psrc + k ) ) );
+				acc = _mm256_fmadd_ps( _mm256_set1_ps( weights[ k ] ), v, acc );
+			}
+			_mm256_storeu_ps( dst, acc );
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < ( ssize_t ) width; x++ ) {
+			float tmp = 0;
+			for( size_t k = 0; k < wn; k++ ) {
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype );
+				tmp += weights[ k ] * Math::halfToFloat( src[ pos ] );
+			}
+			*dst++ = tmp;
+		}
+	}
+
+	void SIMDAVX2::ConvolveHorizontal4h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const
+	{
+		ssize_t b1 = ( wn >> 1 );
+		ssize_t b2 = wn - b1 - 1;
+		ssize_t x;
+
+		if( ( ssize_t ) width - b2 - b1 < 2 ) {
+			SIMD::ConvolveHorizontal4h_to_f( dst, src, width, weights, wn, btype );
+			return;
+		}
+
+#define BORDERPIXEL() do { \
+			float tmp[ 4 ] = { 0, 0, 0, 0 }; \
+			for( size_t k = 0; k < wn; k++ ) { \
+				ssize_t pos = IBorder::value<ssize_t>( x - b1 + k, width, btype ) << 2; \
+				tmp[ 0 ] += weights[ k ] * Math::halfToFloat( src[ pos + 0 ] ); \
+				tmp[ 1 ] += weights[ k ] * Math::halfToFloat( src[ pos + 1 ] ); \
+				tmp[ 2 ] += weights[ k ] * Math::halfToFloat( src[ pos + 2 ] ); \
+				tmp[ 3 ] += weights[ k ] * Math::halfToFloat( src[ pos + 3 ] ); \
+			} \
+			*dst++ = tmp[ 0 ]; \
+			*dst++ = tmp[ 1 ]; \
+			*dst++ = tmp[ 2 ]; \
+			*dst++ = tmp[ 3 ]; \
+		} while( 0 )
+
+		for( x = 0; x < b1; x++ )
+			BORDERPIXEL();
+
+		/* two RGBA pixels per iteration */
+		for( ; x + 2 <= ( ssize_t ) width - b2; x += 2 ) {
+			const uint16_t* psrc = src + ( ( x - b1 ) << 2 );
+			__m256 acc = _mm256_setzero_ps();
+			for( size_t k = 0; k < wn; k++ ) {
+				__m256 v = _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) ( psrc + ( k << 2 ) ) ) );
+				acc = _mm256_fmadd_ps( _mm256_set1_ps( weights[ k ] ), v, acc );
+			}
+			_mm256_storeu_ps( dst, acc );
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		for( ; x < ( ssize_t ) width; x++ )
+			BORDERPIXEL();
+#undef BORDERPIXEL
+	}
+
+	void SIMDAVX2::warpBilinear1h_to_f( float* dst, const float* coords, const uint16_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const
+	{
+		const __m256i endx = _mm256_set1_epi32( ( int ) srcWidth - 1 );
+		const __m256i endy = _mm256_set1_epi32( ( int ) srcHeight - 1 );
+		const __m256i minus1 = _mm256_set1_epi32( -1 );
+		const __m256i stride = _mm256_set1_epi32( ( int ) srcStride );
+		const __m256i lomask = _mm256_set1_epi32( 0xffff );
+		const int* base = ( const int* ) src;
+		size_t i = n >> 3;
+
+		/* the gather offsets are 32bit */
+		if( srcStride * srcHeight >= ( size_t ) 0x7fffffff ) {
+			SIMD::warpBilinear1h_to_f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, n );
+			return;
+		}
+
+		while( i-- ) {
+			__m256 c0 = _mm256_loadu_ps( coords );
+			__m256 c1 = _mm256_loadu_ps( coords + 8 );
+			__m256 fx = ( __m256 ) _mm256_permute4x64_pd( ( __m256d ) _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 2, 0, 2, 0 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			__m256 fy = ( __m256 ) _mm256_permute4x64_pd( ( __m256d ) _mm256_shuffle_ps( c0, c1, _MM_SHUFFLE( 3, 1, 3, 1 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			__m256 flx = _mm256_floor_ps( fx );
+			__m256 fly = _mm256_floor_ps( fy );
+			__m256i lx = _mm256_cvttps_epi32( flx );
+			__m256i ly = _mm256_cvttps_epi32( fly );
+
+			/* 0 <= lx < endx && 0 <= ly < endy for all lanes */
+			__m256i inside = _mm256_and_si256( _mm256_and_si256( _mm256_cmpgt_epi32( lx, minus1 ), _mm256_cmpgt_epi32( endx, lx ) ),
+											   _mm256_and_si256( _mm256_cmpgt_epi32( ly, minus1 ), _mm256_cmpgt_epi32( endy, ly ) ) );
+
+			if( _mm256_movemask_epi8( inside ) != -1 ) {
+				SIMD::warpBilinear1h_to_f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, 8 );
+			} else {
+				__m256 alpha1 = _mm256_sub_ps( fx, flx );
+				__m256 alpha2 = _mm256_sub_ps( fy, fly );
+				__m256i offset = _mm256_add_epi32( _mm256_mullo_epi32( ly, stride ), _mm256_slli_epi32( lx, 1 ) );
+				/* each gather fetches the two horizontally neighbouring halfs */
+				__m256i top = _mm256_i32gather_epi32( base, offset, 1 );
+				__m256i bottom = _mm256_i32gather_epi32( base, _mm256_add_epi32( offset, stride ), 1 );
+
+				__m256i t = _mm256_permute4x64_epi64( _mm256_packus_epi32( _mm256_and_si256( top, lomask ), _mm256_srli_epi32( top, 16 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+				__m256i b = _mm256_permute4x64_epi64( _mm256_packus_epi32( _mm256_and_si256( bottom, lomask ), _mm256_srli_epi32( bottom, 16 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+
+				__m256 a00 = _mm256_cvtph_ps( _mm256_castsi256_si128( t ) );
+				__m256 a10 = _mm256_cvtph_ps( _mm256_extracti128_si256( t, 1 ) );
+				__m256 a01 = _mm256_cvtph_ps( _mm256_castsi256_si128( b ) );
+				__m256 a11 = _mm256_cvtph_ps( _mm256_extracti128_si256( b, 1 ) );
+
+				__m256 v1 = _mm256_fmadd_ps( _mm256_sub_ps( a10, a00 ), alpha1, a00 );
+				__m256 v2 = _mm256_fmadd_ps( _mm256_sub_ps( a11, a01 ), alpha1, a01 );
+				_mm256_storeu_ps( dst, _mm256_fmadd_ps( _mm256_sub_ps( v2, v1 ), alpha2, v1 ) );
+			}
+			coords += 16;
+			dst += 8;
+		}
+		_mm256_zeroupper();
+
+		i = n & 0x07;
+		if( i )
+			SIMD::warpBilinear1h_to_f( dst, coords, src, srcStride, srcWidth, srcHeight, fillcolor, i );
+	}
+
+	void SIMDAVX2::warpBilinear4h_to_f( float* dst, const float* coords, const uint16_t* _src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const
+	{
+		const uint8_t* src = ( const uint8_t* ) _src;
+		int endx = ( ( int ) srcWidth ) - 1;
+		int endy = ( ( int ) srcHeight ) - 1;
+
+		while( n-- ) {
+			float fx = coords[ 0 ];
+			float fy = coords[ 1 ];
+			int lx = ( int ) Math::floor( fx );
+			int ly = ( int ) Math::floor( fy );
+
+			if( lx >= 0 && lx < endx && ly >= 0 && ly < endy ) {
+				/* one load converts both horizontal neighbours ( 2 x RGBA ) */
+				const uint16_t* ptr = ( const uint16_t* ) ( src + srcStride * ly + sizeof( uint16_t ) * lx * 4 );
+				__m256 top = _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) ptr ) );
+				ptr = ( const uint16_t* ) ( ( ( const uint8_t* ) ptr ) + srcStride );
+				__m256 bottom = _mm256_cvtph_ps( _mm_loadu_si128( ( const __m128i* ) ptr ) );
+
+				__m256 alpha1 = _mm256_set1_ps( fx - ( float ) lx );
+				__m256 v = _mm256_fmadd_ps( _mm256_sub_ps( bottom, top ), _mm256_set1_ps( fy - ( float ) ly ), top );
+				__m128 v1 = _mm256_castps256_ps128( v );
+				__m128 v2 = _mm256_extractf128_ps( v, 1 );
+				_mm_storeu_ps( dst, _mm_fmadd_ps( _mm_sub_ps( v2, v1 ), _mm256_castps256_ps128( alpha1 ), v1 ) );
+			} else {
+				SIMD::warpBilinear4h_to_f( dst, coords, _src, srcStride, srcWidth, srcHeight, fillcolor, 1 );
+			}
+			coords += 2;
+			dst += 4;
+		}
+		_mm256_zeroupper();
+	}
+}
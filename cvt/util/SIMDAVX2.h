@@ -0,0 +1,67 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef SIMDAVX2_H
+#define SIMDAVX2_H
+
+#include <cvt/util/SIMDAVX.h>
+
+namespace cvt {
+
+	/* AVX2 with F16C and FMA - mainly used for the half float image paths */
+	class SIMDAVX2 : public SIMDAVX {
+		friend class SIMD;
+
+		protected:
+			SIMDAVX2() {}
+
+		public:
+            virtual void Conv_f_to_h( uint16_t* dst, const float* src, const size_t n ) const;
+            virtual void Conv_h_to_f( float* dst, const uint16_t* src, const size_t n ) const;
+            virtual void Conv_u8_to_h( uint16_t* dst, const uint8_t* src, const size_t n ) const;
+            virtual void Conv_h_to_u8( uint8_t* dst, const uint16_t* src, const size_t n ) const;
+
+            virtual void ConvolveHorizontal1h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
+            virtual void ConvolveHorizontal4h_to_f( float* dst, const uint16_t* src, const size_t width, const float* weights, const size_t wn, IBorderType btype ) const;
+
+            virtual void warpBilinear1h_to_f( float* dst, const float* coords, const uint16_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, float fillcolor, size_t n ) const;
+            virtual void warpBilinear4h_to_f( float* dst, const float* coords, const uint16_t* src, size_t srcStride, size_t srcWidth, size_t srcHeight, const float* fillcolor, size_t n ) const;
+
+			virtual std::string name() const;
+			virtual SIMDType type() const;
+	};
+
+	inline std::string SIMDAVX2::name() const
+	{
+		return "SIMD-AVX2";
+	}
+
+	inline SIMDType SIMDAVX2::type() const
+	{
+		return SIMD_AVX2;
+	}
+}
+
+#endif
@@ -337,6 +337,74 @@ namespace cvt
 		return Math::invSqrt( var1var2 ) * cov;
 	}
 
+	void SIMDSSE2::MinValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 16 <= n; i += 16 ) {
+			__m128i a = _mm_loadu_si128( ( const __m128i* ) ( src1 + i ) );
+			__m128i b = _mm_loadu_si128( ( const __m128i* ) ( src2 + i ) );
+			_mm_storeu_si128( ( __m128i* ) ( dst + i ), _mm_min_epu8( a, b ) );
+		}
+		if( i < n )
+			SIMD::MinValueU8( dst + i, src1 + i, src2 + i, n - i );
+	}
+
+	void SIMDSSE2::MinValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 8 <= n; i += 8 ) {
+			__m128i a = _mm_loadu_si128( ( const __m128i* ) ( src1 + i ) );
+			__m128i b = _mm_loadu_si128( ( const __m128i* ) ( src2 + i ) );
+			/* no unsigned 16 bit min before SSE4.1: a - max( a - b, 0 ) */
+			_mm_storeu_si128( ( __m128i* ) ( dst + i ), _mm_sub_epi16( a, _mm_subs_epu16( a, b ) ) );
+		}
+		if( i < n )
+			SIMD::MinValueU16( dst + i, src1 + i, src2 + i, n - i );
+	}
+
+	void SIMDSSE2::MinValue1f( float* dst, const float* src1, const float* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 4 <= n; i += 4 )
+			_mm_storeu_ps( dst + i, _mm_min_ps( _mm_loadu_ps( src1 + i ), _mm_loadu_ps( src2 + i ) ) );
+		if( i < n )
+			SIMD::MinValue1f( dst + i, src1 + i, src2 + i, n - i );
+	}
+
+	void SIMDSSE2::MaxValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 16 <= n; i += 16 ) {
+			__m128i a = _mm_loadu_si128( ( const __m128i* ) ( src1 + i ) );
+			__m128i b = _mm_loadu_si128( ( const __m128i* ) ( src2 + i ) );
+			_mm_storeu_si128( ( __m128i* ) ( dst + i ), _mm_max_epu8( a, b ) );
+		}
+		if( i < n )
+			SIMD::MaxValueU8( dst + i, src1 + i, src2 + i, n - i );
+	}
+
+	void SIMDSSE2::MaxValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 8 <= n; i += 8 ) {
+			__m128i a = _mm_loadu_si128( ( const __m128i* ) ( src1 + i ) );
+			__m128i b = _mm_loadu_si128( ( const __m128i* ) ( src2 + i ) );
+			/* no unsigned 16 bit max before SSE4.1: max( a - b, 0 ) + b */
+			_mm_storeu_si128( ( __m128i* ) ( dst + i ), _mm_adds_epu16( _mm_subs_epu16( a, b ), b ) );
+		}
+		if( i < n )
+			SIMD::MaxValueU16( dst + i, src1 + i, src2 + i, n - i );
+	}
+
+	void SIMDSSE2::MaxValue1f( float* dst, const float* src1, const float* src2, size_t n ) const
+	{
+		size_t i = 0;
+		for( ; i + 4 <= n; i += 4 )
+			_mm_storeu_ps( dst + i, _mm_max_ps( _mm_loadu_ps( src1 + i ), _mm_loadu_ps( src2 + i ) ) );
+		if( i < n )
+			SIMD::MaxValue1f( dst + i, src1 + i, src2 + i, n - i );
+	}
+
 	void SIMDSSE2::AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const
 	{
 		size_t x;
@@ -2335,6 +2403,79 @@ namespace cvt
 	}
 
 
+	void SIMDSSE2::IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const
+	{
+		const float* x0 = x[ 0 ];
+		const float* x1 = x[ 1 ];
+		const float* x2 = x[ 2 ];
+		const float* x3 = x[ 3 ];
+		const float* y0 = y[ 0 ];
+		const float* y1 = y[ 1 ];
+		const float* y2 = y[ 2 ];
+		const float* y3 = y[ 3 ];
+		__m128 c0, c1, c2, c3, c4, c5, c6, c7, r;
+		size_t i = 0;
+
+		c0 = _mm_set1_ps( c[ 0 ] );
+		c1 = _mm_set1_ps( c[ 1 ] );
+		c2 = _mm_set1_ps( c[ 2 ] );
+		c3 = _mm_set1_ps( c[ 3 ] );
+		c4 = _mm_set1_ps( c[ 4 ] );
+		c5 = _mm_set1_ps( c[ 5 ] );
+		c6 = _mm_set1_ps( c[ 6 ] );
+		c7 = _mm_set1_ps( c[ 7 ] );
+
+		for( ; i + 4 <= n; i += 4 ) {
+			r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_loadu_ps( x0 + i ) ), _mm_mul_ps( c1, _mm_loadu_ps( x1 + i ) ) ),
+							_mm_add_ps( _mm_mul_ps( c2, _mm_loadu_ps( x2 + i ) ), _mm_mul_ps( c3, _mm_loadu_ps( x3 + i ) ) ) );
+			r = _mm_sub_ps( r, _mm_add_ps( _mm_add_ps( _mm_mul_ps( c4, _mm_loadu_ps( y0 + i ) ), _mm_mul_ps( c5, _mm_loadu_ps( y1 + i ) ) ),
+										   _mm_add_ps( _mm_mul_ps( c6, _mm_loadu_ps( y2 + i ) ), _mm_mul_ps( c7, _mm_loadu_ps( y3 + i ) ) ) ) );
+			_mm_storeu_ps( dst + i, r );
+			if( acc )
+				_mm_storeu_ps( acc + i, _mm_add_ps( _mm_loadu_ps( acc + i ), r ) );
+		}
+
+		float tmp;
+		for( ; i < n; i++ ) {
+			tmp = c[ 0 ] * x0[ i ] + c[ 1 ] * x1[ i ] + c[ 2 ] * x2[ i ] + c[ 3 ] * x3[ i ]
+				- c[ 4 ] * y0[ i ] - c[ 5 ] * y1[ i ] - c[ 6 ] * y2[ i ] - c[ 7 ] * y3[ i ];
+			dst[ i ] = tmp;
+			if( acc )
+				acc[ i ] += tmp;
+		}
+	}
+
+	uint16_t SIMDSSE2::SGMPath_u8_to_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost,
+										  uint16_t prevmin, uint16_t p1, uint16_t p2, size_t n ) const
+	{
+		/* all values stay below 0x8000, the signed 16 bit minimum is sufficient */
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i vp1 = _mm_set1_epi16( p1 );
+		const __m128i vjump = _mm_set1_epi16( prevmin + p2 );
+		const __m128i vprevmin = _mm_set1_epi16( prevmin );
+		__m128i vmin = _mm_set1_epi16( 0x7fff );
+
+		if( ( ( size_t ) dst | ( size_t ) sum | ( size_t ) prev ) & 0xf )
+			return SIMD::SGMPath_u8_to_u16( dst, sum, prev, cost, prevmin, p1, p2, n );
+
+		for( size_t d = 0; d < n; d += 8 ) {
+			__m128i c = _mm_unpacklo_epi8( _mm_loadl_epi64( ( const __m128i* ) ( cost + d ) ), zero );
+			__m128i l = _mm_min_epi16( _mm_load_si128( ( const __m128i* ) ( prev + d ) ), vjump );
+			__m128i lm = _mm_add_epi16( _mm_loadu_si128( ( const __m128i* ) ( prev + d - 1 ) ), vp1 );
+			__m128i lp = _mm_add_epi16( _mm_loadu_si128( ( const __m128i* ) ( prev + d + 1 ) ), vp1 );
+			l = _mm_min_epi16( l, _mm_min_epi16( lm, lp ) );
+			l = _mm_add_epi16( c, _mm_sub_epi16( l, vprevmin ) );
+			_mm_store_si128( ( __m128i* ) ( dst + d ), l );
+			_mm_store_si128( ( __m128i* ) ( sum + d ), _mm_add_epi16( _mm_load_si128( ( const __m128i* ) ( sum + d ) ), l ) );
+			vmin = _mm_min_epi16( vmin, l );
+		}
+
+		vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 8 ) );
+		vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 4 ) );
+		vmin = _mm_min_epi16( vmin, _mm_srli_si128( vmin, 2 ) );
+		return ( uint16_t ) _mm_extract_epi16( vmin, 0 );
+	}
+
 	void SIMDSSE2::ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const
 	{
 		size_t x;
@@ -4587,6 +4728,121 @@ void SIMDSSE2::prefixSumSqr1_u8_to_f( float * _dst, size_t dStride, const uint8_
 		_src += srcStride;
 	}
 }
+
+/* 16 bytes to 4x4 uint32 inclusive prefix sums */
+static inline void prefix16_u8_to_u32( __m128i* p, __m128i x, bool squared )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i xl16 = _mm_unpacklo_epi8( x, zero );
+	__m128i xh16 = _mm_unpackhi_epi8( x, zero );
+
+	if( squared ) {
+		/* 255^2 still fits into unsigned 16 bit */
+		xl16 = _mm_mullo_epi16( xl16, xl16 );
+		xh16 = _mm_mullo_epi16( xh16, xh16 );
+	}
+
+	p[ 0 ] = _mm_unpacklo_epi16( xl16, zero );
+	p[ 1 ] = _mm_unpackhi_epi16( xl16, zero );
+	p[ 2 ] = _mm_unpacklo_epi16( xh16, zero );
+	p[ 3 ] = _mm_unpackhi_epi16( xh16, zero );
+
+	for( int i = 0; i < 4; i++ ) {
+		p[ i ] = _mm_add_epi32( p[ i ], _mm_slli_si128( p[ i ], 4 ) );
+		p[ i ] = _mm_add_epi32( p[ i ], _mm_slli_si128( p[ i ], 8 ) );
+		if( i )
+			p[ i ] = _mm_add_epi32( p[ i ], _mm_shuffle_epi32( p[ i - 1 ], _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+	}
+}
+
+void SIMDSSE2::prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+{
+	const uint32_t* prevRow = NULL;
+	__m128i p[ 4 ];
+
+	while( height-- ) {
+		size_t n = width >> 4;
+		const uint8_t* s = src;
+		uint32_t* d = dst;
+		const uint32_t* prev = prevRow;
+		__m128i y = _mm_setzero_si128();
+
+		while( n-- ) {
+			prefix16_u8_to_u32( p, _mm_loadu_si128( ( const __m128i* ) s ), false );
+			for( int i = 0; i < 4; i++ ) {
+				__m128i v = _mm_add_epi32( p[ i ], y );
+				if( prev )
+					v = _mm_add_epi32( v, _mm_loadu_si128( ( const __m128i* ) ( prev + 4 * i ) ) );
+				_mm_storeu_si128( ( __m128i* ) ( d + 4 * i ), v );
+			}
+			y = _mm_add_epi32( y, _mm_shuffle_epi32( p[ 3 ], _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+			s += 16;
+			d += 16;
+			if( prev )
+				prev += 16;
+		}
+
+		uint32_t yl = ( uint32_t ) _mm_cvtsi128_si32( y );
+		n = width & 0xf;
+		while( n-- ) {
+			yl += *s++;
+			*d++ = prev ? yl + *prev++ : yl;
+		}
+
+		prevRow = dst;
+		dst += dstStride;
+		src += srcStride;
+	}
+}
+
+void SIMDSSE2::prefixSumSqr1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const
+{
+	const __m128i zero = _mm_setzero_si128();
+	const uint64_t* prevRow = NULL;
+	__m128i p[ 4 ];
+
+	while( height-- ) {
+		size_t n = width >> 4;
+		const uint8_t* s = src;
+		uint64_t* d = dst;
+		const uint64_t* prev = prevRow;
+		/* running row sum in both 64 bit lanes */
+		__m128i y = _mm_setzero_si128();
+
+		while( n-- ) {
+			/* the 16 local squared sums fit into 32 bit, the row sum does not */
+			prefix16_u8_to_u32( p, _mm_loadu_si128( ( const __m128i* ) s ), true );
+			for( int i = 0; i < 4; i++ ) {
+				__m128i lo = _mm_add_epi64( _mm_unpacklo_epi32( p[ i ], zero ), y );
+				__m128i hi = _mm_add_epi64( _mm_unpackhi_epi32( p[ i ], zero ), y );
+				if( prev ) {
+					lo = _mm_add_epi64( lo, _mm_loadu_si128( ( const __m128i* ) ( prev + 4 * i ) ) );
+					hi = _mm_add_epi64( hi, _mm_loadu_si128( ( const __m128i* ) ( prev + 4 * i + 2 ) ) );
+				}
+				_mm_storeu_si128( ( __m128i* ) ( d + 4 * i ), lo );
+				_mm_storeu_si128( ( __m128i* ) ( d + 4 * i + 2 ), hi );
+			}
+			y = _mm_add_epi64( y, _mm_unpacklo_epi32( _mm_shuffle_epi32( p[ 3 ], _MM_SHUFFLE( 3, 3, 3, 3 ) ), zero ) );
+			s += 16;
+			d += 16;
+			if( prev )
+				prev += 16;
+		}
+
+		uint64_t yl;
+		_mm_storel_epi64( ( __m128i* ) &yl, y );
+		n = width & 0xf;
+		while( n-- ) {
+			uint64_t v = *s++;
+			yl += v * v;
+			*d++ = prev ? yl + *prev++ : yl;
+		}
+
+		prevRow = dst;
+		dst += dstStride;
+		src += srcStride;
+	}
+}
 #define BOXFILTER_PREFIXSUM_16_1F_TO_U8()							\
 																	\
 	r1 = _mm_loadu_ps( A );											\
@@ -6381,4 +6637,143 @@ void SIMDSSE2::projectPoints( Vector2f* dst, const Matrix4f& _mat, const Vector3
         }
 }
 
+    float SIMDSSE2::normalEquations6_f( float* AtA, float* Atb, const float* J, size_t stride, const float* r, const float* w, size_t n ) const
+    {
+        __m128 a[ 21 ], b[ 6 ], e, j[ 6 ], wj, rr, ww;
+        size_t i, k, l, idx;
+
+        for( k = 0; k < 21; k++ )
+            a[ k ] = _mm_setzero_ps();
+        for( k = 0; k < 6; k++ )
+            b[ k ] = _mm_setzero_ps();
+        e = _mm_setzero_ps();
+
+        /* four rows per lane group, the horizontal sums are formed once at the end */
+        for( i = 0; i + 4 <= n; i += 4 ) {
+            rr = _mm_loadu_ps( r + i );
+            ww = _mm_loadu_ps( w + i );
+            for( k = 0; k < 6; k++ )
+                j[ k ] = _mm_loadu_ps( J + k * stride + i );
+            idx = 0;
+            for( k = 0; k < 6; k++ ) {
+                wj = _mm_mul_ps( ww, j[ k ] );
+                for( l = k; l < 6; l++, idx++ )
+                    a[ idx ] = _mm_add_ps( a[ idx ], _mm_mul_ps( wj, j[ l ] ) );
+                b[ k ] = _mm_add_ps( b[ k ], _mm_mul_ps( wj, rr ) );
+            }
+            e = _mm_add_ps( e, _mm_mul_ps( _mm_mul_ps( ww, rr ), rr ) );
+        }
+
+        float tmp[ 4 ] __attribute__ ( ( aligned ( 16 ) ) );
+        for( k = 0; k < 21; k++ ) {
+            _mm_store_ps( tmp, a[ k ] );
+            AtA[ k ] += ( tmp[ 0 ] + tmp[ 1 ] ) + ( tmp[ 2 ] + tmp[ 3 ] );
+        }
+        for( k = 0; k < 6; k++ ) {
+            _mm_store_ps( tmp, b[ k ] );
+            Atb[ k ] += ( tmp[ 0 ] + tmp[ 1 ] ) + ( tmp[ 2 ] + tmp[ 3 ] );
+        }
+        _mm_store_ps( tmp, e );
+        float err = ( tmp[ 0 ] + tmp[ 1 ] ) + ( tmp[ 2 ] + tmp[ 3 ] );
+
+        if( i < n )
+            err += SIMD::normalEquations6_f( AtA, Atb, J + i, stride, r + i, w + i, n - i );
+        return err;
+    }
+
+    void SIMDSSE2::sqrDistances_f( float* dst, const float* coords, size_t stride, const float* pt, size_t dim, size_t n ) const
+    {
+        size_t i = 0;
+        if( dim == 3 ) {
+            __m128 px = _mm_set1_ps( pt[ 0 ] );
+            __m128 py = _mm_set1_ps( pt[ 1 ] );
+            __m128 pz = _mm_set1_ps( pt[ 2 ] );
+            const float* x = coords;
+            const float* y = x + stride;
+            const float* z = y + stride;
+            for( ; i + 4 <= n; i += 4 ) {
+                __m128 dx = _mm_sub_ps( _mm_loadu_ps( x + i ), px );
+                __m128 dy = _mm_sub_ps( _mm_loadu_ps( y + i ), py );
+                __m128 dz = _mm_sub_ps( _mm_loadu_ps( z + i ), pz );
+                _mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ) );
+            }
+        } else {
+            for( ; i + 4 <= n; i += 4 ) {
+                __m128 d = _mm_setzero_ps();
+                for( size_t k = 0; k < dim; k++ ) {
+                    __m128 t = _mm_sub_ps( _mm_loadu_ps( coords + k * stride + i ), _mm_set1_ps( pt[ k ] ) );
+                    d = _mm_add_ps( d, _mm_mul_ps( t, t ) );
+                }
+                _mm_storeu_ps( dst + i, d );
+            }
+        }
+
+        if( i < n )
+            SIMD::sqrDistances_f( dst + i, coords + i, stride, pt, dim, n - i );
+    }
+
+    /* hi and lo 32 bits of the products of the four lanes with m */
+    static inline void philoxMul( __m128i& hi, __m128i& lo, __m128i a, __m128i m )
+    {
+        __m128i p02 = _mm_mul_epu32( a, m );
+        __m128i p13 = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), m );
+        // p02 = lo0 hi0 lo2 hi2, p13 = lo1 hi1 lo3 hi3
+        __m128i l = _mm_unpacklo_epi32( p02, p13 ); // lo0 lo1 hi0 hi1
+        __m128i h = _mm_unpackhi_epi32( p02, p13 ); // lo2 lo3 hi2 hi3
+        lo = _mm_unpacklo_epi64( l, h );
+        hi = _mm_unpackhi_epi64( l, h );
+    }
+
+    void SIMDSSE2::philox4x32( uint32_t* dst, size_t blocks, uint64_t counter, uint64_t stream, uint64_t key ) const
+    {
+        const __m128i m0 = _mm_set1_epi32( 0xD2511F53 );
+        const __m128i m1 = _mm_set1_epi32( 0xCD9E8D57 );
+        const __m128i w0 = _mm_set1_epi32( 0x9E3779B9 );
+        const __m128i w1 = _mm_set1_epi32( 0xBB67AE85 );
+        const __m128i c2init = _mm_set1_epi32( ( uint32_t ) stream );
+        const __m128i c3init = _mm_set1_epi32( ( uint32_t ) ( stream >> 32 ) );
+        const __m128i k0init = _mm_set1_epi32( ( uint32_t ) key );
+        const __m128i k1init = _mm_set1_epi32( ( uint32_t ) ( key >> 32 ) );
+
+        /* four blocks at once, each register holds one word of the four blocks */
+        size_t n = blocks >> 2;
+        while( n-- ){
+            uint64_t ctr[ 4 ] = { counter, counter + 1, counter + 2, counter + 3 };
+            __m128i c0 = _mm_set_epi32( ( uint32_t ) ctr[ 3 ], ( uint32_t ) ctr[ 2 ], ( uint32_t ) ctr[ 1 ], ( uint32_t ) ctr[ 0 ] );
+            __m128i c1 = _mm_set_epi32( ( uint32_t ) ( ctr[ 3 ] >> 32 ), ( uint32_t ) ( ctr[ 2 ] >> 32 ),
+                                        ( uint32_t ) ( ctr[ 1 ] >> 32 ), ( uint32_t ) ( ctr[ 0 ] >> 32 ) );
+            __m128i c2 = c2init;
+            __m128i c3 = c3init;
+            __m128i k0 = k0init;
+            __m128i k1 = k1init;
+            __m128i hi0, lo0, hi1, lo1;
+
+            for( int r = 0; r < 10; r++ ){
+                philoxMul( hi0, lo0, c0, m0 );
+                philoxMul( hi1, lo1, c2, m1 );
+                c0 = _mm_xor_si128( _mm_xor_si128( hi1, c1 ), k0 );
+                c1 = lo1;
+                c2 = _mm_xor_si128( _mm_xor_si128( hi0, c3 ), k1 );
+                c3 = lo0;
+                k0 = _mm_add_epi32( k0, w0 );
+                k1 = _mm_add_epi32( k1, w1 );
+            }
+
+            // transpose to four consecutive blocks
+            __m128i t0 = _mm_unpacklo_epi32( c0, c1 );
+            __m128i t1 = _mm_unpacklo_epi32( c2, c3 );
+            __m128i t2 = _mm_unpackhi_epi32( c0, c1 );
+            __m128i t3 = _mm_unpackhi_epi32( c2, c3 );
+            _mm_storeu_si128( ( __m128i* ) dst, _mm_unpacklo_epi64( t0, t1 ) );
+            _mm_storeu_si128( ( __m128i* ) ( dst + 4 ), _mm_unpackhi_epi64( t0, t1 ) );
+            _mm_storeu_si128( ( __m128i* ) ( dst + 8 ), _mm_unpacklo_epi64( t2, t3 ) );
+            _mm_storeu_si128( ( __m128i* ) ( dst + 12 ), _mm_unpackhi_epi64( t2, t3 ) );
+
+            dst += 16;
+            counter += 4;
+        }
+
+        SIMD::philox4x32( dst, blocks & 0x3, counter, stream, key );
+    }
+
 }
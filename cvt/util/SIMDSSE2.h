@@ -49,6 +49,14 @@ namespace cvt {
 
             virtual float NCC( float const* src1, float const* src2, const size_t n ) const;
 
+			virtual void MinValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void MinValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const;
+			virtual void MinValue1f( float* dst, const float* src1, const float* src2, size_t n ) const;
+
+			virtual void MaxValueU8( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, size_t n ) const;
+			virtual void MaxValueU16( uint16_t* dst, const uint16_t* src1, const uint16_t* src2, size_t n ) const;
+			virtual void MaxValue1f( float* dst, const float* src1, const float* src2, size_t n ) const;
+
 			/* Add vertical */
 			virtual void AddVert_f( float* dst, const float**bufs, size_t numbufs, size_t width ) const;
 			virtual void AddVert_f_to_u8( uint8_t* dst, const float**bufs, size_t numbufs, size_t width ) const;
@@ -83,6 +91,9 @@ namespace cvt {
 
 			virtual void ConvolveClampVert_fx_to_u8( uint8_t* dst, const Fixed** bufs, const Fixed* weights, size_t numw, size_t width ) const;
 			virtual void ConvolveClampVert_f( float* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
+			virtual void IIR4_f( float* dst, float* acc, const float** x, const float** y, const float* c, size_t n ) const;
+			virtual uint16_t SGMPath_u8_to_u16( uint16_t* dst, uint16_t* sum, const uint16_t* prev, const uint8_t* cost,
+												uint16_t prevmin, uint16_t p1, uint16_t p2, size_t n ) const;
 			virtual void ConvolveClampVert_f_to_u8( uint8_t* dst, const float** bufs, const float* weights, size_t numw, size_t width ) const;
 
 			virtual void ConvolveClampVertSym_fx_to_u8( uint8_t* dst, const Fixed** bufs, const Fixed* weights, size_t numw, size_t width ) const;
@@ -118,6 +129,8 @@ namespace cvt {
 
             virtual void prefixSum1_u8_to_f( float * dst, size_t dstStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
             virtual void prefixSumSqr1_u8_to_f( float * dst, size_t dStride, const uint8_t * src, size_t srcStride, size_t width, size_t height ) const;
+            virtual void prefixSum1_u8_to_u32( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
+            virtual void prefixSumSqr1_u8_to_u64( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t width, size_t height ) const;
 
 			virtual void boxFilterPrefixSum1_f_to_u8( uint8_t* dst, size_t dstride, const float* src, size_t srcstride, size_t width, size_t height, size_t boxwidth, size_t boxheight ) const;
 
@@ -145,6 +158,11 @@ namespace cvt {
             using SIMDSSE::projectPoints;
             virtual void projectPoints( Vector2f* dst, const Matrix4f& mat, const Vector3f* src, size_t n ) const;
 
+            virtual float normalEquations6_f( float* AtA, float* Atb, const float* J, size_t stride, const float* r, const float* w, size_t n ) const;
+            virtual void sqrDistances_f( float* dst, const float* coords, size_t stride, const float* pt, size_t dim, size_t n ) const;
+
+            virtual void philox4x32( uint32_t* dst, size_t blocks, uint64_t counter, uint64_t stream, uint64_t key ) const;
+
 		public:
 			virtual std::string name() const;
 			virtual SIMDType type() const;
@@ -29,6 +29,18 @@
 
 namespace cvt
 {
+	void SIMDSSE42::hammingDistances_u64_to_u8( uint8_t* dst, uint64_t ref, const uint64_t* src, size_t n ) const
+	{
+		while( n-- ) {
+#ifdef ARCH_x86_64
+			*dst++ = ( uint8_t ) _mm_popcnt_u64( ref ^ *src++ );
+#else
+			uint64_t xored = ref ^ *src++;
+			*dst++ = ( uint8_t ) ( _mm_popcnt_u32( ( uint32_t ) xored ) + _mm_popcnt_u32( ( uint32_t ) ( xored >> 32 ) ) );
+#endif
+		}
+	}
+
     /*
 	size_t SIMDSSE42::hammingDistance( const uint8_t* src1, const uint8_t* src2, size_t n ) const
     {
@@ -37,6 +37,7 @@ namespace cvt {
 
 		public:
 //			virtual size_t hammingDistance(const uint8_t* src1, const uint8_t* src2, size_t n) const;
+			virtual void hammingDistances_u64_to_u8( uint8_t* dst, uint64_t ref, const uint64_t* src, size_t n ) const;
 
 			virtual std::string name() const;
 			virtual SIMDType type() const;
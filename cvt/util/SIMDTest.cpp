@@ -299,6 +299,99 @@ static void _NCCTest( float* src1, float* src2, size_t n )
 	delete[] constval;
 }
 
+static bool _halfTest()
+{
+	const size_t n = 35;
+	float src[ n ];
+	float ref[ n ];
+	float fdst[ n ];
+	uint16_t hdst[ n ];
+	uint16_t href[ n ];
+	bool result = true;
+
+	for( size_t i = 0; i < n; i++ ) {
+		src[ i ] = Math::rand( -100.0f, 100.0f );
+		href[ i ] = Math::floatToHalf( src[ i ] );
+		ref[ i ] = Math::halfToFloat( href[ i ] );
+	}
+
+	SIMDType bestType = SIMD::bestSupportedType( );
+	for( int st = SIMD_BASE; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		bool fail = false;
+
+		simd->Conv_f_to_h( hdst, src, n );
+		simd->Conv_h_to_f( fdst, hdst, n );
+		for( size_t i = 0; i < n; i++ ) {
+			/* round to nearest even has to be exact */
+			if( hdst[ i ] != href[ i ] || fdst[ i ] != ref[ i ] ) {
+				fail = true;
+				std::cout << "Error: half: " << src[ i ] << " " << simd->name( ) << ": " << fdst[ i ] << " reference: " << ref[ i ] << std::endl;
+			}
+			/* relative error of binary16 is bounded by 2^-11 */
+			if( Math::abs( fdst[ i ] - src[ i ] ) > Math::abs( src[ i ] ) * 0.00049f )
+				fail = true;
+		}
+
+		std::stringstream ss;
+		ss << simd->name( );
+		ss << " Conv float <-> half";
+		CVTTEST_PRINT( ss.str( ), !fail );
+		result &= !fail;
+		delete simd;
+	}
+	return result;
+}
+
+static bool _normalEquationsTest()
+{
+	const size_t n = 103;
+	float J[ 6 * n ];
+	float r[ n ];
+	float w[ n ];
+	double refA[ 21 ] = { 0 };
+	double refb[ 6 ] = { 0 };
+	double referr = 0;
+	bool result = true;
+
+	for( size_t i = 0; i < n; i++ ) {
+		for( size_t k = 0; k < 6; k++ )
+			J[ k * n + i ] = Math::rand( -1.0f, 1.0f );
+		r[ i ] = Math::rand( -1.0f, 1.0f );
+		w[ i ] = ( i % 7 ) ? Math::rand( 0.0f, 1.0f ) : 0.0f;
+
+		size_t idx = 0;
+		for( size_t k = 0; k < 6; k++ ) {
+			for( size_t l = k; l < 6; l++ )
+				refA[ idx++ ] += ( double ) w[ i ] * J[ k * n + i ] * J[ l * n + i ];
+			refb[ k ] += ( double ) w[ i ] * J[ k * n + i ] * r[ i ];
+		}
+		referr += ( double ) w[ i ] * r[ i ] * r[ i ];
+	}
+
+	SIMDType bestType = SIMD::bestSupportedType( );
+	for( int st = SIMD_BASE; st <= bestType; st++ ) {
+		SIMD* simd = SIMD::get( ( SIMDType ) st );
+		float A[ 21 ] = { 0 };
+		float b[ 6 ] = { 0 };
+		float err = simd->normalEquations6_f( A, b, J, n, r, w, n );
+
+		bool fail = Math::abs( err - referr ) > 1e-4;
+		for( size_t k = 0; k < 21; k++ )
+			fail |= Math::abs( A[ k ] - refA[ k ] ) > 1e-4;
+		for( size_t k = 0; k < 6; k++ )
+			fail |= Math::abs( b[ k ] - refb[ k ] ) > 1e-4;
+
+		std::stringstream ss;
+		ss << simd->name( );
+		ss << " normalEquations6_f";
+		CVTTEST_PRINT( ss.str( ), !fail );
+		result &= !fail;
+		delete simd;
+	}
+	return result;
+}
+
 BEGIN_CVTTEST( simd )
 		float* fdst;
 		float* fsrc1;
@@ -339,6 +432,12 @@ BEGIN_CVTTEST( simd )
 		testResult = _projectTest();
         CVTTEST_PRINT( "Project Points 3d->2d", testResult );
 
+		testResult = _halfTest();
+        CVTTEST_PRINT( "Half float conversion", testResult );
+
+		testResult = _normalEquationsTest();
+		CVTTEST_PRINT( "Normal equations", testResult );
+
 #define TESTSIZE ( 2048 * 2048 )
 		fdst = new float[ TESTSIZE ];
 		fsrc1 = new float[ TESTSIZE ];
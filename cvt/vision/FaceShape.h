@@ -31,6 +31,7 @@
 #include <cvt/math/CostFunction.h>
 #include <cvt/io/Resources.h>
 #include <cvt/gfx/GFX.h>
+#include <cvt/util/RNG.h>
 #include <stdio.h>
 
 //#define GTLINEINPUT 1
@@ -86,11 +87,12 @@ namespace cvt {
 			Eigen::Matrix<T, Eigen::Dynamic, 1 > _regcovar;
 			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic > _pc;
 			Eigen::Matrix<T, Eigen::Dynamic, 1 > _pts;
+			RNG _rng;
 	};
 
 	template<typename T>
 	inline FaceShape<T>::FaceShape() : _currI( NULL), _kdx( IKernel::HAAR_HORIZONTAL_3 ), _kdy( IKernel::HAAR_VERTICAL_3 ),
-									  _ptsize( 0 ), _pcsize( 0 ), _lsize( 0 ), _lines( 0 ), _costs( 0 )
+									  _ptsize( 0 ), _pcsize( 0 ), _lsize( 0 ), _lines( 0 ), _costs( 0 ), _rng( 0 )
 	{
 		_transform.setIdentity();
 
@@ -305,7 +307,7 @@ namespace cvt {
 			Matrix2<T> TTmp( _transform );
 			float incr = 5.0f / dp.length();
 			incr = Math::clamp( incr, 0.01f, 0.25f );
-			for( T alpha = Math::rand( 0.0f, incr ); alpha <= 1; alpha += incr ) {
+			for( T alpha = _rng.uniform( 0.0f, incr ); alpha <= 1; alpha += incr ) {
 				p = Math::mix( pts[ 0 ], pts[ 1 ], alpha );
 				if( flip ) {
 					tmp( 0 ) = n * p;
@@ -141,9 +141,9 @@ namespace cvt
 			delete _featureDetector;
 	}
 
-	void Ferns::train( const Image & img )
+	void Ferns::train( const Image & img, uint64_t seed )
 	{
-		RNG rng( time( NULL ) );
+		RNG rng( seed );
 
 		Eigen::Vector2i x0, x1;
 		for( uint32_t i = 0; i < _numFerns; i++ ){
@@ -167,7 +167,7 @@ namespace cvt
 		int32_t patchHalfSize = _patchSize >> 1;
 
 		/* train the class */
-		PatchGenerator patchGen( Rangef( 0.0f, Math::TWO_PI ), Rangef( 0.6f, 1.5f ), _patchSize, 3.0 /* noise */ );
+		PatchGenerator patchGen( Rangef( 0.0f, Math::TWO_PI ), Rangef( 0.6f, 1.5f ), _patchSize, 3.0 /* noise */, seed, 1 );
 
 		int x, y;
 		for( size_t i = 0; i < features.size(); i++ ){
@@ -46,7 +46,8 @@ namespace cvt
 			Ferns( const std::string & fileName );
 			~Ferns();
 			
-			void train( const Image & img );
+			/* training is reproducible for a given seed */
+			void train( const Image & img, uint64_t seed = 0 );
 			
 			double classify( Eigen::Vector2i & bestClass, const Image & img, const Eigen::Vector2i & p );
 		
@@ -0,0 +1,666 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/ICP.h>
+#include <cvt/geom/KNNIndex.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/math/SE3.h>
+#include <cvt/util/EigenBridge.h>
+#include <cvt/util/Exception.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/SIMD.h>
+
+#include <Eigen/Cholesky>
+#include <string.h>
+
+namespace cvt {
+
+	/* rows of one band of the projective reduction, one system per band keeps the sum deterministic */
+	#define ICP_BANDROWS 8
+	/* points of one block of the nearest neighbour reduction */
+	#define ICP_BLOCKSIZE 256
+	/* neighbourhood of the projective association for point to point */
+	#define ICP_SEARCHRADIUS 2
+
+	class ICPVertexMap {
+		public:
+			ICPVertexMap( float* dst, size_t dstride, const float* src, size_t sstride, size_t width, const Matrix3f& K ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width ),
+				_fxinv( 1.0f / K[ 0 ][ 0 ] ), _fyinv( 1.0f / K[ 1 ][ 1 ] ), _cx( K[ 0 ][ 2 ] ), _cy( K[ 1 ][ 2 ] )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t y = begin; y < end; y++ ) {
+					float* dst = _dst + y * _dstride;
+					const float* src = _src + y * _sstride;
+					float ny = ( ( float ) y - _cy ) * _fyinv;
+					for( size_t x = 0; x < _width; x++, dst += 4 ) {
+						float z = src[ x ];
+						dst[ 0 ] = ( ( float ) x - _cx ) * _fxinv * z;
+						dst[ 1 ] = ny * z;
+						dst[ 2 ] = z;
+						dst[ 3 ] = z > 0.0f ? 1.0f : 0.0f;
+					}
+				}
+			}
+
+		private:
+			float*		 _dst;
+			size_t		 _dstride;
+			const float* _src;
+			size_t		 _sstride;
+			size_t		 _width;
+			float		 _fxinv, _fyinv, _cx, _cy;
+	};
+
+	class ICPNormalMap {
+		public:
+			ICPNormalMap( float* dst, size_t dstride, const float* src, size_t sstride, size_t width, size_t height ) :
+				_dst( dst ), _dstride( dstride ), _src( src ), _sstride( sstride ), _width( width ), _height( height )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				for( size_t y = begin; y < end; y++ ) {
+					float* dst = _dst + y * _dstride;
+					memset( dst, 0, sizeof( float ) * 4 * _width );
+					if( y == 0 || y + 1 >= _height )
+						continue;
+					const float* v = _src + y * _sstride;
+					const float* vu = v - _sstride;
+					const float* vd = v + _sstride;
+					for( size_t x = 1; x + 1 < _width; x++ ) {
+						const float* l = v + 4 * ( x - 1 );
+						const float* r = v + 4 * ( x + 1 );
+						const float* u = vu + 4 * x;
+						const float* d = vd + 4 * x;
+						if( l[ 3 ] == 0.0f || r[ 3 ] == 0.0f || u[ 3 ] == 0.0f || d[ 3 ] == 0.0f || v[ 4 * x + 3 ] == 0.0f )
+							continue;
+						float ax = r[ 0 ] - l[ 0 ], ay = r[ 1 ] - l[ 1 ], az = r[ 2 ] - l[ 2 ];
+						float bx = d[ 0 ] - u[ 0 ], by = d[ 1 ] - u[ 1 ], bz = d[ 2 ] - u[ 2 ];
+						float nx = ay * bz - az * by;
+						float ny = az * bx - ax * bz;
+						float nz = ax * by - ay * bx;
+						float len = nx * nx + ny * ny + nz * nz;
+						if( len <= 0.0f )
+							continue;
+						len = 1.0f / Math::sqrt( len );
+						/* towards the camera */
+						if( nx * v[ 4 * x ] + ny * v[ 4 * x + 1 ] + nz * v[ 4 * x + 2 ] > 0.0f )
+							len = -len;
+						dst[ 4 * x + 0 ] = nx * len;
+						dst[ 4 * x + 1 ] = ny * len;
+						dst[ 4 * x + 2 ] = nz * len;
+						dst[ 4 * x + 3 ] = 1.0f;
+					}
+				}
+			}
+
+		private:
+			float*		 _dst;
+			size_t		 _dstride;
+			const float* _src;
+			size_t		 _sstride;
+			size_t		 _width;
+			size_t		 _height;
+	};
+
+	/* residuals and Jacobians of one correspondence, written to index i of the SoA buffers */
+	static inline void _ICPPointToPlane( float* J, size_t stride, float* r, float* w, size_t i,
+										 float px, float py, float pz, const float* q, const float* n )
+	{
+		J[ i ]				= py * n[ 2 ] - pz * n[ 1 ];
+		J[ stride + i ]		= pz * n[ 0 ] - px * n[ 2 ];
+		J[ 2 * stride + i ] = px * n[ 1 ] - py * n[ 0 ];
+		J[ 3 * stride + i ] = n[ 0 ];
+		J[ 4 * stride + i ] = n[ 1 ];
+		J[ 5 * stride + i ] = n[ 2 ];
+		r[ i ] = n[ 0 ] * ( px - q[ 0 ] ) + n[ 1 ] * ( py - q[ 1 ] ) + n[ 2 ] * ( pz - q[ 2 ] );
+		w[ i ] = 1.0f;
+	}
+
+	static inline void _ICPPointToPoint( float* J, size_t stride, float* r, float* w, size_t i,
+										 float px, float py, float pz, const float* q )
+	{
+		/* [ -[p]x | I ] */
+		const float rows[ 3 ][ 3 ] = { { 0.0f, pz, -py }, { -pz, 0.0f, px }, { py, -px, 0.0f } };
+		const float p[ 3 ] = { px, py, pz };
+		for( size_t k = 0; k < 3; k++, i++ ) {
+			J[ i ]				= rows[ k ][ 0 ];
+			J[ stride + i ]		= rows[ k ][ 1 ];
+			J[ 2 * stride + i ] = rows[ k ][ 2 ];
+			J[ 3 * stride + i ] = k == 0 ? 1.0f : 0.0f;
+			J[ 4 * stride + i ] = k == 1 ? 1.0f : 0.0f;
+			J[ 5 * stride + i ] = k == 2 ? 1.0f : 0.0f;
+			r[ i ] = p[ k ] - q[ k ];
+			w[ i ] = 1.0f;
+		}
+	}
+
+	static inline void _ICPInvalid( float* J, size_t stride, float* r, float* w, size_t i, size_t n )
+	{
+		for( size_t k = 0; k < n; k++, i++ ) {
+			for( size_t c = 0; c < 6; c++ )
+				J[ c * stride + i ] = 0.0f;
+			r[ i ] = 0.0f;
+			w[ i ] = 0.0f;
+		}
+	}
+
+	class ICP::ProjectiveReduce {
+		public:
+			ProjectiveReduce( std::vector<System>& systems, const float* refv, size_t refvstride, const float* refn, size_t refnstride,
+							  size_t refwidth, size_t refheight, const float* curv, size_t curvstride, const float* curn, size_t curnstride,
+							  size_t curwidth, size_t curheight, const Matrix3f& K, const Matrix4f& pose, const Params& params ) :
+				_systems( systems ), _refv( refv ), _refvstride( refvstride ), _refn( refn ), _refnstride( refnstride ),
+				_refwidth( refwidth ), _refheight( refheight ), _curv( curv ), _curvstride( curvstride ), _curn( curn ),
+				_curnstride( curnstride ), _curwidth( curwidth ), _curheight( curheight ), _K( K ), _pose( pose ),
+				_pointToPlane( params.metric == ICP_POINT_TO_PLANE ),
+				_maxDistSqr( Math::sqr( params.maxDistance ) ), _minCos( Math::cos( params.maxNormalAngle ) )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t rowsize = _pointToPlane ? _curwidth : 3 * _curwidth;
+				size_t stride = Math::pad16( rowsize );
+				ScopedBuffer<float, true> buf( 8 * stride );
+				float* J = buf.ptr();
+				float* r = J + 6 * stride;
+				float* w = r + stride;
+				SIMD* simd = SIMD::instance();
+				const float fx = _K[ 0 ][ 0 ], fy = _K[ 1 ][ 1 ], cx = _K[ 0 ][ 2 ], cy = _K[ 1 ][ 2 ];
+				const float maxu = ( float ) _refwidth - 0.5f, maxv = ( float ) _refheight - 0.5f;
+
+				for( size_t band = begin; band < end; band++ ) {
+					System& sys = _systems[ band ];
+					size_t yend = Math::min( ( band + 1 ) * ICP_BANDROWS, _curheight );
+					for( size_t y = band * ICP_BANDROWS; y < yend; y++ ) {
+						const float* cv = _curv + y * _curvstride;
+						const float* cn = _curn + y * _curnstride;
+						size_t num = 0;
+						for( size_t x = 0; x < _curwidth; x++, cv += 4, cn += 4 ) {
+							size_t i = _pointToPlane ? x : 3 * x;
+							size_t nrows = _pointToPlane ? 1 : 3;
+							if( cn[ 3 ] == 0.0f ) {
+								_ICPInvalid( J, stride, r, w, i, nrows );
+								continue;
+							}
+							float px = _pose[ 0 ][ 0 ] * cv[ 0 ] + _pose[ 0 ][ 1 ] * cv[ 1 ] + _pose[ 0 ][ 2 ] * cv[ 2 ] + _pose[ 0 ][ 3 ];
+							float py = _pose[ 1 ][ 0 ] * cv[ 0 ] + _pose[ 1 ][ 1 ] * cv[ 1 ] + _pose[ 1 ][ 2 ] * cv[ 2 ] + _pose[ 1 ][ 3 ];
+							float pz = _pose[ 2 ][ 0 ] * cv[ 0 ] + _pose[ 2 ][ 1 ] * cv[ 1 ] + _pose[ 2 ][ 2 ] * cv[ 2 ] + _pose[ 2 ][ 3 ];
+							if( pz <= 0.0f ) {
+								_ICPInvalid( J, stride, r, w, i, nrows );
+								continue;
+							}
+							float zinv = 1.0f / pz;
+							float u = fx * px * zinv + cx;
+							float v = fy * py * zinv + cy;
+							if( !( u >= -0.5f && u < maxu && v >= -0.5f && v < maxv ) ) {
+								_ICPInvalid( J, stride, r, w, i, nrows );
+								continue;
+							}
+							size_t ui = ( size_t ) ( u + 0.5f );
+							size_t vi = ( size_t ) ( v + 0.5f );
+							const float* q = _refv + vi * _refvstride + 4 * ui;
+							const float* n = _refn + vi * _refnstride + 4 * ui;
+							float dsqr = Math::sqr( px - q[ 0 ] ) + Math::sqr( py - q[ 1 ] ) + Math::sqr( pz - q[ 2 ] );
+							if( !_pointToPlane ) {
+								/* the projected point only differs along the ray, the nearest point of the
+								   neighbourhood also gives the lateral error */
+								size_t u0 = ui >= ICP_SEARCHRADIUS ? ui - ICP_SEARCHRADIUS : 0;
+								size_t u1 = Math::min( ui + ICP_SEARCHRADIUS, _refwidth - 1 );
+								size_t v0 = vi >= ICP_SEARCHRADIUS ? vi - ICP_SEARCHRADIUS : 0;
+								size_t v1 = Math::min( vi + ICP_SEARCHRADIUS, _refheight - 1 );
+								if( q[ 3 ] == 0.0f )
+									dsqr = _maxDistSqr * 2.0f;
+								for( size_t sv = v0; sv <= v1; sv++ ) {
+									const float* sq = _refv + sv * _refvstride + 4 * u0;
+									for( size_t su = u0; su <= u1; su++, sq += 4 ) {
+										float sd = Math::sqr( px - sq[ 0 ] ) + Math::sqr( py - sq[ 1 ] ) + Math::sqr( pz - sq[ 2 ] );
+										if( sq[ 3 ] != 0.0f && sd < dsqr ) {
+											dsqr = sd;
+											q = sq;
+											n = _refn + sv * _refnstride + 4 * su;
+										}
+									}
+								}
+							}
+							float ncos = n[ 0 ] * ( _pose[ 0 ][ 0 ] * cn[ 0 ] + _pose[ 0 ][ 1 ] * cn[ 1 ] + _pose[ 0 ][ 2 ] * cn[ 2 ] )
+									   + n[ 1 ] * ( _pose[ 1 ][ 0 ] * cn[ 0 ] + _pose[ 1 ][ 1 ] * cn[ 1 ] + _pose[ 1 ][ 2 ] * cn[ 2 ] )
+									   + n[ 2 ] * ( _pose[ 2 ][ 0 ] * cn[ 0 ] + _pose[ 2 ][ 1 ] * cn[ 1 ] + _pose[ 2 ][ 2 ] * cn[ 2 ] );
+							if( n[ 3 ] == 0.0f || dsqr > _maxDistSqr || ncos < _minCos ) {
+								_ICPInvalid( J, stride, r, w, i, nrows );
+								continue;
+							}
+							if( _pointToPlane )
+								_ICPPointToPlane( J, stride, r, w, i, px, py, pz, q, n );
+							else
+								_ICPPointToPoint( J, stride, r, w, i, px, py, pz, q );
+							num++;
+						}
+
+						float AtA[ 21 ] = { 0 };
+						float Atb[ 6 ] = { 0 };
+						sys.error += simd->normalEquations6_f( AtA, Atb, J, stride, r, w, rowsize );
+						for( size_t k = 0; k < 21; k++ )
+							sys.AtA[ k ] += AtA[ k ];
+						for( size_t k = 0; k < 6; k++ )
+							sys.Atb[ k ] += Atb[ k ];
+						sys.num += num;
+					}
+				}
+			}
+
+		private:
+			std::vector<System>& _systems;
+			const float*		 _refv;
+			size_t				 _refvstride;
+			const float*		 _refn;
+			size_t				 _refnstride;
+			size_t				 _refwidth, _refheight;
+			const float*		 _curv;
+			size_t				 _curvstride;
+			const float*		 _curn;
+			size_t				 _curnstride;
+			size_t				 _curwidth, _curheight;
+			const Matrix3f&		 _K;
+			const Matrix4f&		 _pose;
+			bool				 _pointToPlane;
+			float				 _maxDistSqr;
+			float				 _minCos;
+	};
+
+	class ICP::NearestReduce {
+		public:
+			NearestReduce( std::vector<System>& systems, const KNNIndex3f& tree, const std::vector<Vector3f>& model,
+						   const std::vector<Vector3f>& normals, const std::vector<Vector3f>& points, size_t step,
+						   const Matrix4f& pose, const Params& params ) :
+				_systems( systems ), _tree( tree ), _model( model ), _normals( normals ), _points( points ), _step( step ),
+				_pose( pose ), _pointToPlane( params.metric == ICP_POINT_TO_PLANE ),
+				_maxDist( params.maxDistance ), _maxDistSqr( Math::sqr( params.maxDistance ) )
+			{
+			}
+
+			void operator()( size_t begin, size_t end ) const
+			{
+				size_t stride = 3 * ICP_BLOCKSIZE;
+				ScopedBuffer<float, true> buf( 8 * stride );
+				float* J = buf.ptr();
+				float* r = J + 6 * stride;
+				float* w = r + stride;
+				SIMD* simd = SIMD::instance();
+				size_t nrows = _pointToPlane ? 1 : 3;
+
+				for( size_t block = begin; block < end; block++ ) {
+					System& sys = _systems[ block ];
+					size_t pbegin = block * ICP_BLOCKSIZE * _step;
+					size_t pend = Math::min( ( block + 1 ) * ICP_BLOCKSIZE * _step, _points.size() );
+					size_t i = 0;
+					for( size_t p = pbegin; p < pend; p += _step, i += nrows ) {
+						Vector3f pt = _pose * _points[ p ];
+						// validate the match before touching the model
+						float dsqr;
+						size_t idx = _tree.nearest( pt, _maxDist, &dsqr );
+						if( idx == KNNIndex3f::NONE || idx >= _model.size() || dsqr > _maxDistSqr ) {
+							_ICPInvalid( J, stride, r, w, i, nrows );
+							continue;
+						}
+						const float* q = _model[ idx ].ptr();
+						if( _pointToPlane )
+							_ICPPointToPlane( J, stride, r, w, i, pt.x, pt.y, pt.z, q, _normals[ idx ].ptr() );
+						else
+							_ICPPointToPoint( J, stride, r, w, i, pt.x, pt.y, pt.z, q );
+						sys.num++;
+					}
+
+					float AtA[ 21 ] = { 0 };
+					float Atb[ 6 ] = { 0 };
+					sys.error += simd->normalEquations6_f( AtA, Atb, J, stride, r, w, i );
+					for( size_t k = 0; k < 21; k++ )
+						sys.AtA[ k ] += AtA[ k ];
+					for( size_t k = 0; k < 6; k++ )
+						sys.Atb[ k ] += Atb[ k ];
+				}
+			}
+
+		private:
+			std::vector<System>&		 _systems;
+			const KNNIndex3f&			 _tree;
+			const std::vector<Vector3f>& _model;
+			const std::vector<Vector3f>& _normals;
+			const std::vector<Vector3f>& _points;
+			size_t						 _step;
+			const Matrix4f&				 _pose;
+			bool						 _pointToPlane;
+			float						 _maxDist;
+			float						 _maxDistSqr;
+	};
+
+	ICP::ICP( const Matrix3f& intrinsics, const Params& params ) :
+		_params( params ),
+		_intrinsics( intrinsics )
+	{
+		setParams( params );
+	}
+
+	ICP::~ICP()
+	{
+	}
+
+	void ICP::setParams( const Params& params )
+	{
+		if( params.pyramidLevels < 1 )
+			throw CVTException( "ICP needs at least one pyramid level" );
+		if( params.depthScale <= 0.0f )
+			throw CVTException( "Invalid depth scale" );
+		if( params.pyramidLevels != _params.pyramidLevels || params.depthScale != _params.depthScale ||
+			params.minDepth != _params.minDepth || params.maxDepth != _params.maxDepth ) {
+			_reference.clear();
+			_current.clear();
+		}
+		_params = params;
+	}
+
+	void ICP::vertexMap( Image& vertices, const Image& depth, const Matrix3f& intrinsics )
+	{
+		if( depth.format() != IFormat::GRAY_FLOAT )
+			throw CVTException( "Depth map in m has to be GRAY_FLOAT" );
+		vertices.reallocate( depth.width(), depth.height(), IFormat::RGBA_FLOAT );
+
+		IMapScoped<float> dst( vertices );
+		IMapScoped<const float> src( depth );
+		ICPVertexMap vmap( dst.ptr(), dst.stride() / sizeof( float ), src.ptr(), src.stride() / sizeof( float ), depth.width(), intrinsics );
+		ParallelFor::run( vmap, 0, depth.height() );
+	}
+
+	void ICP::normalMap( Image& normals, const Image& vertices )
+	{
+		if( vertices.format() != IFormat::RGBA_FLOAT )
+			throw CVTException( "Vertex map has to be RGBA_FLOAT" );
+		normals.reallocate( vertices.width(), vertices.height(), IFormat::RGBA_FLOAT );
+
+		IMapScoped<float> dst( normals );
+		IMapScoped<const float> src( vertices );
+		ICPNormalMap nmap( dst.ptr(), dst.stride() / sizeof( float ), src.ptr(), src.stride() / sizeof( float ), vertices.width(), vertices.height() );
+		ParallelFor::run( nmap, 0, vertices.height() );
+	}
+
+	/* depth in m, 0 for invalid measurements */
+	static void _ICPDepthToMeters( Image& dst, const Image& depth, float depthScale, float minDepth, float maxDepth )
+	{
+		size_t w = depth.width(), h = depth.height();
+		dst.reallocate( w, h, IFormat::GRAY_FLOAT );
+		IMapScoped<float> map( dst );
+
+		if( depth.format() == IFormat::GRAY_UINT16 ) {
+			IMapScoped<const uint16_t> src( depth );
+			float scale = 1.0f / depthScale;
+			for( size_t y = 0; y < h; y++, map++, src++ ) {
+				float* d = map.ptr();
+				const uint16_t* s = src.ptr();
+				for( size_t x = 0; x < w; x++ ) {
+					float z = s[ x ] * scale;
+					d[ x ] = ( z > minDepth && z < maxDepth ) ? z : 0.0f;
+				}
+			}
+		} else if( depth.format() == IFormat::GRAY_FLOAT ) {
+			IMapScoped<const float> src( depth );
+			float scale = ( float ) 0xFFFF / depthScale;
+			for( size_t y = 0; y < h; y++, map++, src++ ) {
+				float* d = map.ptr();
+				const float* s = src.ptr();
+				for( size_t x = 0; x < w; x++ ) {
+					float z = s[ x ] * scale;
+					d[ x ] = ( z > minDepth && z < maxDepth ) ? z : 0.0f;
+				}
+			}
+		} else
+			throw CVTException( "Depth maps have to be GRAY_UINT16 or GRAY_FLOAT" );
+	}
+
+	/* 2x2 blocks, the valid depths close to the nearest one are averaged to keep depth edges */
+	static void _ICPDownsampleDepth( Image& dst, const Image& src )
+	{
+		size_t w = src.width() / 2, h = src.height() / 2;
+		dst.reallocate( w, h, IFormat::GRAY_FLOAT );
+		IMapScoped<float> map( dst );
+		IMapScoped<const float> smap( src );
+		for( size_t y = 0; y < h; y++, map++ ) {
+			float* d = map.ptr();
+			const float* s0 = smap.ptr();
+			smap++;
+			const float* s1 = smap.ptr();
+			smap++;
+			for( size_t x = 0; x < w; x++ ) {
+				float v[ 4 ] = { s0[ 2 * x ], s0[ 2 * x + 1 ], s1[ 2 * x ], s1[ 2 * x + 1 ] };
+				float zmin = 0.0f;
+				for( size_t k = 0; k < 4; k++ ) {
+					if( v[ k ] > 0.0f && ( zmin == 0.0f || v[ k ] < zmin ) )
+						zmin = v[ k ];
+				}
+				float sum = 0.0f, n = 0.0f;
+				for( size_t k = 0; k < 4; k++ ) {
+					if( v[ k ] > 0.0f && v[ k ] - zmin < 0.05f * zmin ) {
+						sum += v[ k ];
+						n += 1.0f;
+					}
+				}
+				d[ x ] = n > 0.0f ? sum / n : 0.0f;
+			}
+		}
+	}
+
+	void ICP::buildPyramid( std::vector<Level>& pyramid, const Image& depth ) const
+	{
+		Image dm[ 2 ];
+		pyramid.resize( _params.pyramidLevels );
+
+		_ICPDepthToMeters( dm[ 0 ], depth, _params.depthScale, _params.minDepth, _params.maxDepth );
+		Matrix3f K = _intrinsics;
+		for( size_t l = 0; l < pyramid.size(); l++ ) {
+			const Image& d = dm[ l & 1 ];
+			if( l ) {
+				_ICPDownsampleDepth( dm[ l & 1 ], dm[ ( l - 1 ) & 1 ] );
+				K[ 0 ][ 0 ] *= 0.5f;
+				K[ 1 ][ 1 ] *= 0.5f;
+				K[ 0 ][ 2 ] = ( K[ 0 ][ 2 ] + 0.5f ) * 0.5f - 0.5f;
+				K[ 1 ][ 2 ] = ( K[ 1 ][ 2 ] + 0.5f ) * 0.5f - 0.5f;
+			}
+			if( d.width() < 3 || d.height() < 3 )
+				throw CVTException( "Depth map too small for the number of pyramid levels" );
+			pyramid[ l ].intrinsics = K;
+			vertexMap( pyramid[ l ].vertices, d, K );
+			normalMap( pyramid[ l ].normals, pyramid[ l ].vertices );
+		}
+	}
+
+	bool ICP::solve( Matrix4f& pose, float& update, Result& result, const std::vector<System>& systems ) const
+	{
+		Eigen::Matrix<double, 6, 6> A;
+		Eigen::Matrix<double, 6, 1> b;
+		double err = 0;
+		size_t num = 0;
+
+		A.setZero();
+		b.setZero();
+		for( size_t s = 0; s < systems.size(); s++ ) {
+			const System& sys = systems[ s ];
+			size_t idx = 0;
+			for( size_t k = 0; k < 6; k++ ) {
+				for( size_t l = k; l < 6; l++ )
+					A( k, l ) += sys.AtA[ idx++ ];
+				b[ k ] += sys.Atb[ k ];
+			}
+			err += sys.error;
+			num += sys.num;
+		}
+
+		result.numCorrespondences = num;
+		result.rmse = num ? ( float ) Math::sqrt( err / ( double ) num ) : 0.0f;
+		if( num < 6 )
+			return false;
+
+		for( size_t k = 0; k < 6; k++ )
+			for( size_t l = 0; l < k; l++ )
+				A( k, l ) = A( l, k );
+
+		Eigen::LDLT< Eigen::Matrix<double, 6, 6> > ldlt( A );
+		if( ldlt.info() != Eigen::Success )
+			return false;
+		Eigen::Matrix<double, 6, 1> delta = ldlt.solve( -b );
+		if( !( delta.norm() < 1e3 ) )
+			return false;
+
+		SE3<double> se;
+		se.set( ( Matrix4d ) pose );
+		se.apply( delta );
+		EigenBridge::toCVT( pose, se.transformation() );
+		update = ( float ) delta.norm();
+		return true;
+	}
+
+	void ICP::setReference( const Image& depth )
+	{
+		buildPyramid( _reference, depth );
+	}
+
+	void ICP::useCurrentAsReference()
+	{
+		if( _current.empty() )
+			throw CVTException( "No current frame" );
+		_reference.swap( _current );
+	}
+
+	bool ICP::align( Result& result, const Image& depth )
+	{
+		Matrix4f guess;
+		guess.setIdentity();
+		return align( result, depth, guess );
+	}
+
+	bool ICP::align( Result& result, const Image& depth, const Matrix4f& guess )
+	{
+		if( _reference.empty() )
+			throw CVTException( "ICP reference not set" );
+		buildPyramid( _current, depth );
+		if( _current[ 0 ].vertices.width() != _reference[ 0 ].vertices.width() ||
+			_current[ 0 ].vertices.height() != _reference[ 0 ].vertices.height() )
+			throw CVTException( "Reference and current depth map differ in size" );
+
+		Matrix4f pose = guess;
+		std::vector<System> systems;
+		bool ok = false;
+
+		result.iterations = 0;
+		result.numCorrespondences = 0;
+		result.rmse = 0.0f;
+		for( size_t l = _current.size(); l--; ) {
+			const Level& ref = _reference[ l ];
+			const Level& cur = _current[ l ];
+			IMapScoped<const float> refv( ref.vertices );
+			IMapScoped<const float> refn( ref.normals );
+			IMapScoped<const float> curv( cur.vertices );
+			IMapScoped<const float> curn( cur.normals );
+			size_t nbands = ( cur.vertices.height() + ICP_BANDROWS - 1 ) / ICP_BANDROWS;
+
+			for( size_t iter = 0; iter < _params.maxIterations; iter++ ) {
+				systems.assign( nbands, System() );
+				for( size_t s = 0; s < nbands; s++ )
+					memset( &systems[ s ], 0, sizeof( System ) );
+
+				ProjectiveReduce reduce( systems, refv.ptr(), refv.stride() / sizeof( float ), refn.ptr(), refn.stride() / sizeof( float ),
+										 ref.vertices.width(), ref.vertices.height(), curv.ptr(), curv.stride() / sizeof( float ),
+										 curn.ptr(), curn.stride() / sizeof( float ), cur.vertices.width(), cur.vertices.height(),
+										 ref.intrinsics, pose, _params );
+				ParallelFor::run( reduce, 0, nbands, 1 );
+
+				float update;
+				ok = solve( pose, update, result, systems );
+				if( !ok )
+					break;
+				result.iterations++;
+				if( update < _params.minParameterUpdate )
+					break;
+			}
+		}
+
+		result.pose = pose;
+		result.success = ok && result.numCorrespondences >= _params.minCorrespondences;
+		return result.success;
+	}
+
+	bool ICP::align( Result& result, const std::vector<Vector3f>& model, const std::vector<Vector3f>& modelNormals,
+					 const std::vector<Vector3f>& points, const Matrix4f& guess ) const
+	{
+		if( model.empty() || points.empty() )
+			throw CVTException( "Empty point set" );
+		if( _params.metric == ICP_POINT_TO_PLANE && modelNormals.size() != model.size() )
+			throw CVTException( "Point to plane ICP needs a normal for every model point" );
+
+		KNNIndex3f tree( model );
+		Matrix4f pose = guess;
+		std::vector<System> systems;
+		bool ok = false;
+
+		result.iterations = 0;
+		result.numCorrespondences = 0;
+		result.rmse = 0.0f;
+		for( size_t l = _params.pyramidLevels; l--; ) {
+			/* every 4^l-th point on level l */
+			size_t step = ( size_t ) 1 << ( 2 * l );
+			size_t npts = ( points.size() + step - 1 ) / step;
+			if( npts < _params.minCorrespondences && l )
+				continue;
+			size_t nblocks = ( npts + ICP_BLOCKSIZE - 1 ) / ICP_BLOCKSIZE;
+
+			for( size_t iter = 0; iter < _params.maxIterations; iter++ ) {
+				systems.assign( nblocks, System() );
+				for( size_t s = 0; s < nblocks; s++ )
+					memset( &systems[ s ], 0, sizeof( System ) );
+
+				NearestReduce reduce( systems, tree, model, modelNormals, points, step, pose, _params );
+				ParallelFor::run( reduce, 0, nblocks, 1 );
+
+				float update;
+				ok = solve( pose, update, result, systems );
+				if( !ok )
+					break;
+				result.iterations++;
+				if( update < _params.minParameterUpdate )
+					break;
+			}
+		}
+
+		result.pose = pose;
+		result.success = ok && result.numCorrespondences >= _params.minCorrespondences;
+		return result.success;
+	}
+
+}
@@ -0,0 +1,155 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_ICP_H
+#define CVT_ICP_H
+
+#include <cvt/gfx/Image.h>
+#include <cvt/math/Matrix.h>
+#include <cvt/math/Vector.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/**
+	  Iterative closest point alignment of depth maps and point clouds.
+
+	  Organized depth maps use projective data association: every point of
+	  the current frame is transformed by the current estimate and projected
+	  into the reference frame, the reference point at that pixel is its
+	  correspondence. Both frames are kept as vertex and normal pyramids and
+	  the alignment runs coarse to fine. The reference can be a previous
+	  frame or a depth map ray cast from a TSDFVolume for frame to model
+	  tracking.
+
+	  Unorganized point clouds are associated by nearest neighbours from a
+	  KNNIndex over the model points, coarse levels use subsets of the points.
+
+	  The normal equations of every iteration are reduced in parallel row
+	  bands with SIMD::normalEquations6_f. The update is
+	  pose = exp( delta ) * pose with the rotation first in delta, as in SE3.
+	*/
+	class ICP {
+		public:
+			enum Metric {
+				ICP_POINT_TO_POINT,
+				ICP_POINT_TO_PLANE
+			};
+
+			struct Params {
+				Params() :
+					metric( ICP_POINT_TO_PLANE ),
+					pyramidLevels( 3 ),
+					maxIterations( 10 ),
+					maxDistance( 0.1f ),
+					maxNormalAngle( Math::deg2Rad( 30.0f ) ),
+					depthScale( 1000.0f ),
+					minDepth( 0.3f ),
+					maxDepth( 8.0f ),
+					minCorrespondences( 100 ),
+					minParameterUpdate( 1e-6f )
+				{}
+
+				Metric metric;
+				size_t pyramidLevels;
+				/* iterations per pyramid level */
+				size_t maxIterations;
+				/* maximal distance of corresponding points in m */
+				float  maxDistance;
+				/* maximal angle between corresponding normals */
+				float  maxNormalAngle;
+				/* depthScale = #pixels / m, as in RGBDVisualOdometry */
+				float  depthScale;
+				float  minDepth;
+				float  maxDepth;
+				size_t minCorrespondences;
+				float  minParameterUpdate;
+			};
+
+			struct Result {
+				/* transformation from the current frame or point set to the reference */
+				Matrix4f pose;
+				size_t	 iterations;
+				size_t	 numCorrespondences;
+				/* root mean squared residual of the last iteration */
+				float	 rmse;
+				bool	 success;
+			};
+
+			ICP( const Matrix3f& intrinsics, const Params& params = Params() );
+			~ICP();
+
+			const Params& params() const { return _params; }
+			void setParams( const Params& params );
+			const Matrix3f& intrinsics() const { return _intrinsics; }
+
+			/* depth maps as GRAY_UINT16 or GRAY_FLOAT in the range of GRAY_UINT16 as loaded by RGBDParser */
+			void setReference( const Image& depth );
+			bool align( Result& result, const Image& depth );
+			bool align( Result& result, const Image& depth, const Matrix4f& guess );
+			/* make the frame of the last align call the reference without recomputing it */
+			void useCurrentAsReference();
+
+			/* unorganized points, modelNormals may be empty for ICP_POINT_TO_POINT */
+			bool align( Result& result, const std::vector<Vector3f>& model, const std::vector<Vector3f>& modelNormals,
+					    const std::vector<Vector3f>& points, const Matrix4f& guess ) const;
+
+			/* depth map in m to vertex and normal maps, RGBA_FLOAT with w = 0 for invalid entries */
+			static void vertexMap( Image& vertices, const Image& depth, const Matrix3f& intrinsics );
+			static void normalMap( Image& normals, const Image& vertices );
+
+		private:
+			ICP( const ICP& );
+			ICP& operator=( const ICP& );
+
+			struct Level {
+				Image	 vertices;
+				Image	 normals;
+				Matrix3f intrinsics;
+			};
+
+			struct System {
+				double AtA[ 21 ];
+				double Atb[ 6 ];
+				double error;
+				size_t num;
+			};
+
+			class ProjectiveReduce;
+			class NearestReduce;
+
+			void buildPyramid( std::vector<Level>& pyramid, const Image& depth ) const;
+			bool solve( Matrix4f& pose, float& update, Result& result, const std::vector<System>& systems ) const;
+
+			Params			   _params;
+			Matrix3f		   _intrinsics;
+			std::vector<Level> _reference;
+			std::vector<Level> _current;
+	};
+
+}
+
+#endif
@@ -0,0 +1,248 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/ICP.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/io/RGBDParser.h>
+#include <cvt/util/CVTTest.h>
+#include <cvt/util/Time.h>
+
+#include <stdlib.h>
+
+namespace cvt {
+
+	static const float _icpDepthScale = 5000.0f;
+
+	/* depth map of a room with a sphere seen by a camera with pose camera to world */
+	static void _icpRender( Image& depth, const Matrix3f& K, const Matrix4f& pose, size_t w, size_t h )
+	{
+		const Vector3f bmin( -2.0f, -1.5f, -1.0f ), bmax( 2.5f, 1.5f, 4.0f );
+		const Vector3f center( 0.4f, 0.3f, 2.2f );
+		const float radius = 0.5f;
+
+		depth.reallocate( w, h, IFormat::GRAY_UINT16 );
+		IMapScoped<uint16_t> map( depth );
+		Matrix3f R = pose.toMatrix3();
+		Vector3f o( pose[ 0 ][ 3 ], pose[ 1 ][ 3 ], pose[ 2 ][ 3 ] );
+		for( size_t y = 0; y < h; y++, map++ ) {
+			uint16_t* d = map.ptr();
+			for( size_t x = 0; x < w; x++ ) {
+				Vector3f dir = R * Vector3f( ( x - K[ 0 ][ 2 ] ) / K[ 0 ][ 0 ], ( y - K[ 1 ][ 2 ] ) / K[ 1 ][ 1 ], 1.0f );
+				/* the ray starts inside the room */
+				float t = 1e10f;
+				for( size_t k = 0; k < 3; k++ ) {
+					if( dir[ k ] > 0.0f )
+						t = Math::min( t, ( bmax[ k ] - o[ k ] ) / dir[ k ] );
+					else if( dir[ k ] < 0.0f )
+						t = Math::min( t, ( bmin[ k ] - o[ k ] ) / dir[ k ] );
+				}
+				Vector3f oc = o - center;
+				float a = dir.dot( dir ), b = dir.dot( oc ), c = oc.dot( oc ) - radius * radius;
+				float disc = b * b - a * c;
+				if( disc > 0.0f ) {
+					float ts = ( -b - Math::sqrt( disc ) ) / a;
+					if( ts > 0.0f )
+						t = Math::min( t, ts );
+				}
+				/* the ray has z = 1 in camera coordinates */
+				d[ x ] = ( uint16_t ) ( t * _icpDepthScale + 0.5f );
+			}
+		}
+	}
+
+	static void _icpPoseError( float& terr, float& rerr, const Matrix4f& a, const Matrix4f& b )
+	{
+		Matrix4f d = a.inverse() * b;
+		terr = Math::sqrt( Math::sqr( d[ 0 ][ 3 ] ) + Math::sqr( d[ 1 ][ 3 ] ) + Math::sqr( d[ 2 ][ 3 ] ) );
+		float c = Math::clamp( ( d[ 0 ][ 0 ] + d[ 1 ][ 1 ] + d[ 2 ][ 2 ] - 1.0f ) * 0.5f, -1.0f, 1.0f );
+		rerr = Math::rad2Deg( Math::acos( c ) );
+	}
+
+	static bool _icpCheck( const std::string& name, const ICP::Result& result, const Matrix4f& truth, double ms )
+	{
+		float terr, rerr;
+		_icpPoseError( terr, rerr, truth, result.pose );
+		bool b = result.success && terr < 0.005f && rerr < 0.2f;
+		if( !b )
+			std::cout << name << ": translation error " << terr << " m, rotation error " << rerr << " deg" << std::endl;
+		std::cout << name << ": " << result.iterations << " iterations, " << result.numCorrespondences << " correspondences, " << ms << " ms" << std::endl;
+		CVTTEST_PRINT( name, b );
+		return b;
+	}
+
+	static void _icpCloud( std::vector<Vector3f>& pts, std::vector<Vector3f>& normals, const Image& depth, const Matrix3f& K )
+	{
+		Image dm( depth.width(), depth.height(), IFormat::GRAY_FLOAT ), v, n;
+		{
+			IMapScoped<float> dst( dm );
+			IMapScoped<const uint16_t> src( depth );
+			for( size_t y = 0; y < depth.height(); y++, dst++, src++ )
+				for( size_t x = 0; x < depth.width(); x++ )
+					dst.ptr()[ x ] = src.ptr()[ x ] / _icpDepthScale;
+		}
+		ICP::vertexMap( v, dm, K );
+		ICP::normalMap( n, v );
+		IMapScoped<const float> vm( v );
+		IMapScoped<const float> nm( n );
+		for( size_t y = 0; y < v.height(); y++, vm++, nm++ ) {
+			for( size_t x = 0; x < v.width(); x++ ) {
+				const float* pv = vm.ptr() + 4 * x;
+				const float* pn = nm.ptr() + 4 * x;
+				if( pn[ 3 ] == 0.0f )
+					continue;
+				pts.push_back( Vector3f( pv[ 0 ], pv[ 1 ], pv[ 2 ] ) );
+				normals.push_back( Vector3f( pn[ 0 ], pn[ 1 ], pn[ 2 ] ) );
+			}
+		}
+	}
+
+	/* frame to frame tracking over a TUM RGB-D sequence, relative pose error per frame against the ground truth */
+	static bool _icpBenchmarkTUM( const String& folder )
+	{
+		RGBDParser parser( folder, 0.05 );
+		ICP::Params params;
+		params.depthScale = _icpDepthScale;
+		ICP icp( parser.calibration().intrinsics(), params );
+
+		parser.next();
+		icp.setReference( parser.depth() );
+		Matrix4f gtprev = ( Matrix4f ) parser.groundTruthPose();
+		Matrix4f gtfirst = gtprev;
+		Matrix4f est;
+		est.setIdentity();
+
+		double tsum = 0, tsqr = 0, rsqr = 0;
+		size_t frames = 0, failed = 0;
+		Matrix4f gt = gtprev;
+		while( parser.hasNext() ) {
+			parser.next();
+			ICP::Result result;
+			Time t;
+			if( !icp.align( result, parser.depth() ) )
+				failed++;
+			tsum += t.elapsedMilliSeconds();
+			icp.useCurrentAsReference();
+			est = est * result.pose;
+
+			gt = ( Matrix4f ) parser.groundTruthPose();
+			if( parser.hasGroundTruthPose() ) {
+				float terr, rerr;
+				_icpPoseError( terr, rerr, gtprev.inverse() * gt, result.pose );
+				tsqr += terr * terr;
+				rsqr += rerr * rerr;
+				frames++;
+			}
+			gtprev = gt;
+		}
+
+		float drift, rdrift;
+		_icpPoseError( drift, rdrift, gtfirst.inverse() * gt, est );
+		std::cout << "TUM " << folder << ": " << frames << " frames, " << failed << " failed, "
+				  << tsum / Math::max<size_t>( frames, 1 ) << " ms / frame" << std::endl;
+		std::cout << "RPE translation " << Math::sqrt( tsqr / Math::max<size_t>( frames, 1 ) ) << " m / frame, rotation "
+				  << Math::sqrt( rsqr / Math::max<size_t>( frames, 1 ) ) << " deg / frame, final drift " << drift << " m " << rdrift << " deg" << std::endl;
+		return frames > 0;
+	}
+
+}
+
+using namespace cvt;
+
+BEGIN_CVTTEST( ICP )
+	bool result = true;
+	const size_t w = 320, h = 240;
+	Matrix3f K;
+	K.setIdentity();
+	K[ 0 ][ 0 ] = K[ 1 ][ 1 ] = 262.5f;
+	K[ 0 ][ 2 ] = 159.5f;
+	K[ 1 ][ 2 ] = 119.5f;
+
+	Matrix4f ref, cur;
+	ref.setIdentity();
+	cur.setRotation( Vector3f( 0.3f, 1.0f, 0.2f ), Math::deg2Rad( 3.0f ) );
+	cur[ 0 ][ 3 ] = 0.04f;
+	cur[ 1 ][ 3 ] = -0.02f;
+	cur[ 2 ][ 3 ] = 0.05f;
+
+	Image dref, dcur;
+	_icpRender( dref, K, ref, w, h );
+	_icpRender( dcur, K, cur, w, h );
+
+	ICP::Params params;
+	params.depthScale = _icpDepthScale;
+	params.maxIterations = 15;
+	ICP icp( K, params );
+	ICP::Result res;
+
+	icp.setReference( dref );
+	Time t;
+	icp.align( res, dcur );
+	result &= _icpCheck( "projective point to plane", res, cur, t.elapsedMilliSeconds() );
+
+	/* point to point converges slowly, it gets the motion of consecutive frames */
+	Matrix4f small;
+	small.setRotation( Vector3f( 0.3f, 1.0f, 0.2f ), Math::deg2Rad( 1.0f ) );
+	small[ 0 ][ 3 ] = 0.02f;
+	small[ 1 ][ 3 ] = -0.01f;
+	small[ 2 ][ 3 ] = 0.02f;
+	_icpRender( dcur, K, small, w, h );
+	params.metric = ICP::ICP_POINT_TO_POINT;
+	params.maxIterations = 30;
+	icp.setParams( params );
+	t.reset();
+	icp.align( res, dcur );
+	result &= _icpCheck( "projective point to point", res, small, t.elapsedMilliSeconds() );
+
+	/* unorganized clouds of a quarter resolution rendering */
+	Matrix3f Ks = K;
+	Ks[ 0 ][ 0 ] *= 0.5f;
+	Ks[ 1 ][ 1 ] *= 0.5f;
+	Ks[ 0 ][ 2 ] = 79.5f;
+	Ks[ 1 ][ 2 ] = 59.5f;
+	_icpRender( dref, Ks, ref, w / 2, h / 2 );
+	_icpRender( dcur, Ks, cur, w / 2, h / 2 );
+	std::vector<Vector3f> model, modelNormals, points, pointNormals;
+	_icpCloud( model, modelNormals, dref, Ks );
+	_icpCloud( points, pointNormals, dcur, Ks );
+
+	Matrix4f guess;
+	guess.setIdentity();
+	params.metric = ICP::ICP_POINT_TO_PLANE;
+	params.maxIterations = 15;
+	icp.setParams( params );
+	t.reset();
+	icp.align( res, model, modelNormals, points, guess );
+	result &= _icpCheck( "kd-tree point to plane", res, cur, t.elapsedMilliSeconds() );
+
+	const char* tum = getenv( "CVT_TUM_DATASET" );
+	if( tum ) {
+		String folder( tum );
+		if( !folder.hasSuffix( "/" ) )
+			folder += "/";
+		result &= _icpBenchmarkTUM( folder );
+	}
+
+	return result;
+END_CVTTEST
@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -92,6 +93,7 @@ namespace cvt
 
     inline void ImagePyramid::update( const Image& img, const IScaleFilter& sfilter )
     {
+        CVT_PROFILE_ZONE( "ImagePyramid::update" );
         _image[ 0 ].reallocate( img );
         _image[ 0 ] = img;
         recompute( sfilter );
@@ -175,6 +177,7 @@ namespace cvt
 
     inline void ImagePyramid::convolve( ImagePyramid& out, const IKernel& kernel ) const
     {
+        CVT_PROFILE_ZONE( "ImagePyramid::convolve" );
         for( size_t i = 0; i < _image.size(); i++ ){
             out[ i ].reallocate( _image[ i ] );
             _image[ i ].convolve( out[ i ], kernel );
@@ -183,6 +186,7 @@ namespace cvt
 
     inline void ImagePyramid::convolve( ImagePyramid& out, const IKernel& hkernel, const IKernel& vkernel ) const
     {
+        CVT_PROFILE_ZONE( "ImagePyramid::convolve" );
         for( size_t i = 0; i < _image.size(); i++ ){
             out[ i ].reallocate( _image[ i ] );
             _image[ i ].convolve( out[ i ], hkernel, vkernel );
@@ -191,6 +195,7 @@ namespace cvt
 
     inline void ImagePyramid::convert( ImagePyramid& out, const IFormat& dstFormat ) const
     {
+        CVT_PROFILE_ZONE( "ImagePyramid::convert" );
         for( size_t i = 0; i < _image.size(); i++ ){
             out[ i ].reallocate( _image[ i ].width(), _image[ i ].height(), dstFormat, _image[ i ].memType() );
             _image[ i ].convert( out[ i ], dstFormat );
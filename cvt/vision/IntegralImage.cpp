@@ -26,17 +26,196 @@
 #include <cvt/util/Time.h>
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
+#include <cvt/util/ParallelFor.h>
+#include <limits>
 
 #define DUMP(v) std::cout << #v << " = " << v << std::endl;
 
 namespace cvt
 {
-	IntegralImage::IntegralImage( const Image & img, IntegralImageFlags flags ) : _flags( flags )
+    /* rows per band of the parallel table construction */
+    static const size_t INTEGRAL_BAND_HEIGHT = 64;
+
+    /* prefix sums of one band, dispatched on the table type */
+    static void integralBand( uint32_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t w, size_t h, bool squared )
+    {
+        if( squared )
+            throw CVTException( "Squared uint32_t integral table not supported - use uint64_t" );
+        SIMD::instance()->prefixSum1_u8_to_u32( dst, dstStride, src, srcStride, w, h );
+    }
+
+    static void integralBand( uint64_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t w, size_t h, bool squared )
+    {
+        if( squared )
+            SIMD::instance()->prefixSumSqr1_u8_to_u64( dst, dstStride, src, srcStride, w, h );
+        else
+            SIMD::instance()->prefixSum1_u8_to_u64( dst, dstStride, src, srcStride, w, h );
+    }
+
+    static void integralBand( double* dst, size_t dstStride, const float* src, size_t srcStride, size_t w, size_t h, bool squared )
+    {
+        if( squared )
+            SIMD::instance()->prefixSumSqr1_f_to_d( dst, dstStride, src, srcStride, w, h );
+        else
+            SIMD::instance()->prefixSum1_f_to_d( dst, dstStride, src, srcStride, w, h );
+    }
+
+    static void integralBand( uint32_t*, size_t, const float*, size_t, size_t, size_t, bool )
+    {
+        throw CVTException( "Integer integral table of a float image" );
+    }
+
+    static void integralBand( uint64_t*, size_t, const float*, size_t, size_t, size_t, bool )
+    {
+        throw CVTException( "Integer integral table of a float image" );
+    }
+
+    static void integralBand( double* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t w, size_t h, bool squared )
+    {
+        const double* prev = NULL;
+        while( h-- ){
+            double row = 0.0;
+            for( size_t x = 0; x < w; x++ ){
+                double v = src[ x ];
+                row += squared ? v * v : v;
+                dst[ x ] = prev ? row + prev[ x ] : row;
+            }
+            prev = dst;
+            dst += dstStride;
+            src += srcStride;
+        }
+    }
+
+    /* first pass: band local tables */
+    template<typename T, typename SRC>
+    class IntegralBandSums {
+        public:
+            IntegralBandSums( T* dst, size_t dstStride, const SRC* src, size_t srcStride, size_t w, size_t h, bool squared ) :
+                _dst( dst ), _dstStride( dstStride ), _src( src ), _srcStride( srcStride ), _w( w ), _h( h ), _squared( squared )
+            {
+            }
+
+            void operator()( size_t begin, size_t end )
+            {
+                for( size_t b = begin; b < end; b++ ){
+                    size_t y0 = b * INTEGRAL_BAND_HEIGHT;
+                    size_t rows = Math::min( INTEGRAL_BAND_HEIGHT, _h - y0 );
+                    integralBand( _dst + y0 * _dstStride, _dstStride, _src + y0 * _srcStride, _srcStride, _w, rows, _squared );
+                }
+            }
+
+        private:
+            T*          _dst;
+            size_t      _dstStride;
+            const SRC*  _src;
+            size_t      _srcStride;
+            size_t      _w;
+            size_t      _h;
+            bool        _squared;
+    };
+
+    /* second pass: add the sum of all previous bands */
+    template<typename T>
+    class IntegralBandCarry {
+        public:
+            IntegralBandCarry( T* dst, size_t dstStride, const T* carry, size_t w, size_t h ) :
+                _dst( dst ), _dstStride( dstStride ), _carry( carry ), _w( w ), _h( h )
+            {
+            }
+
+            void operator()( size_t begin, size_t end )
+            {
+                for( size_t b = begin; b < end; b++ ){
+                    const T* carry = _carry + ( b - 1 ) * _w;
+                    size_t y0 = b * INTEGRAL_BAND_HEIGHT;
+                    size_t y1 = Math::min( y0 + INTEGRAL_BAND_HEIGHT, _h );
+                    for( size_t y = y0; y < y1; y++ ){
+                        T* row = _dst + y * _dstStride;
+                        for( size_t x = 0; x < _w; x++ )
+                            row[ x ] += carry[ x ];
+                    }
+                }
+            }
+
+        private:
+            T*          _dst;
+            size_t      _dstStride;
+            const T*    _carry;
+            size_t      _w;
+            size_t      _h;
+    };
+
+    template<typename T, typename SRC>
+    static void integralTable( T* dst, size_t dstStride, const SRC* src, size_t srcStride, size_t w, size_t h, bool squared )
+    {
+        size_t bands = ( h + INTEGRAL_BAND_HEIGHT - 1 ) / INTEGRAL_BAND_HEIGHT;
+
+        IntegralBandSums<T, SRC> sums( dst, dstStride, src, srcStride, w, h, squared );
+        ParallelFor::run( sums, 0, bands, 1 );
+        if( bands < 2 )
+            return;
+
+        // carry of band b: sum of the last rows of the bands before
+        std::vector<T> carry( ( bands - 1 ) * w );
+        const T* last = dst + ( INTEGRAL_BAND_HEIGHT - 1 ) * dstStride;
+        for( size_t x = 0; x < w; x++ )
+            carry[ x ] = last[ x ];
+        for( size_t b = 1; b < bands - 1; b++ ){
+            last += INTEGRAL_BAND_HEIGHT * dstStride;
+            for( size_t x = 0; x < w; x++ )
+                carry[ b * w + x ] = carry[ ( b - 1 ) * w + x ] + last[ x ];
+        }
+
+        IntegralBandCarry<T> propagate( dst, dstStride, &carry[ 0 ], w, h );
+        ParallelFor::run( propagate, 1, bands, 1 );
+    }
+
+    template<typename T>
+    void IntegralTable<T>::update( const Image & img, bool squared )
+    {
+        if( img.channels() != 1 )
+            throw CVTException( "IntegralTable: single channel image expected" );
+
+        _width = img.width();
+        _height = img.height();
+        _data.assign( ( _width + 1 ) * ( _height + 1 ), T( 0 ) );
+        if( !_width || !_height )
+            return;
+
+        size_t srcStride;
+        T* dst = &_data[ stride() + 1 ];
+
+        if( img.format() == IFormat::GRAY_UINT8 ){
+            if( std::numeric_limits<T>::is_integer ){
+                // every entry has to be representable
+                double maxval = squared ? 255.0 * 255.0 : 255.0;
+                if( maxval * ( double ) _width * ( double ) _height > ( double ) std::numeric_limits<T>::max() )
+                    throw CVTException( "IntegralTable: image too large for the accumulation type" );
+            }
+            const uint8_t* src = img.map<uint8_t>( &srcStride );
+            integralTable( dst, stride(), src, srcStride, _width, _height, squared );
+            img.unmap( src );
+        } else if( img.format() == IFormat::GRAY_FLOAT && !std::numeric_limits<T>::is_integer ){
+            const float* src = img.map<float>( &srcStride );
+            integralTable( dst, stride(), src, srcStride, _width, _height, squared );
+            img.unmap( src );
+        } else {
+            throw CVTException( "IntegralTable: unsupported image format" );
+        }
+    }
+
+    template class IntegralTable<uint32_t>;
+    template class IntegralTable<uint64_t>;
+    template class IntegralTable<double>;
+
+	IntegralImage::IntegralImage( const Image & img, IntegralImageFlags flags, IntegralImagePrecision precision ) :
+        _flags( flags ), _precision( precision )
 	{
         update( img );
 	}
 
-    IntegralImage::IntegralImage( IntegralImageFlags flags ) : _flags( flags )
+    IntegralImage::IntegralImage( IntegralImageFlags flags, IntegralImagePrecision precision ) :
+        _flags( flags ), _precision( precision )
     {
     }
 
@@ -46,6 +225,23 @@ namespace cvt
 
     void IntegralImage::update( const Image & img )
     {
+        if( _precision != INTEGRAL_FLOAT ){
+            if( _flags & SUMMED_AREA ){
+                switch( _precision ){
+                    case INTEGRAL_UINT32: _sumU32.update( img ); break;
+                    case INTEGRAL_UINT64: _sumU64.update( img ); break;
+                    default:              _sumDouble.update( img ); break;
+                }
+            }
+            if( _flags & SQUARED_SUMMED_AREA ){
+                if( _precision == INTEGRAL_DOUBLE )
+                    _sqrSumDouble.update( img, true );
+                else
+                    _sqrSumU64.update( img, true );
+            }
+            return;
+        }
+
         if( _flags & SUMMED_AREA ){
             _sum.reallocate( img.width(), img.height(), IFormat::floatEquivalent( img.format() ), img.memType() );
             img.integralImage( _sum );
@@ -56,20 +252,40 @@ namespace cvt
         }
     }
 
-    float IntegralImage::area( const Recti & r ) const
+    double IntegralImage::sumArea( const Recti & r ) const
     {
-        if( !_flags & SUMMED_AREA )
+        if( !( _flags & SUMMED_AREA ) )
             throw CVTException( "Summed Area Table is not computed -> cannot calculate area" );
 
-        return IntegralImage::area( _sum, r );
+        switch( _precision ){
+            case INTEGRAL_UINT32: return _sumU32.area( r );
+            case INTEGRAL_UINT64: return _sumU64.area( r );
+            case INTEGRAL_DOUBLE: return _sumDouble.area( r );
+            default:              return IntegralImage::area( _sum, r );
+        }
     }
 
-    float IntegralImage::sqrArea( const Recti & r ) const
+    double IntegralImage::sqrSumArea( const Recti & r ) const
     {
-        if( !_flags & SQUARED_SUMMED_AREA )
+        if( !( _flags & SQUARED_SUMMED_AREA ) )
             throw CVTException( "Squared Summed Area Table is not computed -> cannot calculate area" );
 
-        return IntegralImage::area( _sqrSum, r );
+        switch( _precision ){
+            case INTEGRAL_UINT32:
+            case INTEGRAL_UINT64: return _sqrSumU64.area( r );
+            case INTEGRAL_DOUBLE: return _sqrSumDouble.area( r );
+            default:              return IntegralImage::area( _sqrSum, r );
+        }
+    }
+
+    float IntegralImage::area( const Recti & r ) const
+    {
+        return ( float ) sumArea( r );
+    }
+
+    float IntegralImage::sqrArea( const Recti & r ) const
+    {
+        return ( float ) sqrSumArea( r );
     }
 
     float IntegralImage::ncc( const Image & img,
@@ -78,24 +294,25 @@ namespace cvt
                               const Recti & rOther,
                               const Vector2i & pos ) const
     {
-        if( !_flags & SUMMED_AREA || !_flags & SQUARED_SUMMED_AREA ||
-            !otherII.flags() & SUMMED_AREA ||!otherII.flags() & SQUARED_SUMMED_AREA ){
+        if( !( _flags & SUMMED_AREA ) || !( _flags & SQUARED_SUMMED_AREA ) ||
+            !( otherII.flags() & SUMMED_AREA ) || !( otherII.flags() & SQUARED_SUMMED_AREA ) ){
             throw CVTException( "NCC needs SUMMED_AREA and SQUARED_SUMMED_AREA" );
         }
 
         // corresponding rect in img:
         Recti iRect( pos.x, pos.y, rOther.width, rOther.height );
 
-        float sumI = IntegralImage::area( _sum, iRect );
-        float ssumI = IntegralImage::area( _sqrSum, iRect );
+        // the moments are evaluated in double: exact for the integer tables
+        double sumI = sumArea( iRect );
+        double ssumI = sqrSumArea( iRect );
 
-        float sumO = IntegralImage::area( otherII.sumImage(), rOther );
-        float ssumO = IntegralImage::area( otherII.sqrSumImage(), rOther );
-        float size = rOther.width * rOther.height;
+        double sumO = otherII.sumArea( rOther );
+        double ssumO = otherII.sqrSumArea( rOther );
+        double size = rOther.width * rOther.height;
 
-        float meanP = sumO / size;
-        float meanI = sumI / size;
-        float sigmaPSigmaI = Math::invSqrt( ( ssumO/size - Math::sqr( meanP ) ) * ( ssumI / size - Math::sqr( meanI ) ) );
+        double meanP = sumO / size;
+        double meanI = sumI / size;
+        float sigmaPSigmaI = Math::invSqrt( ( float )( ( ssumO / size - Math::sqr( meanP ) ) * ( ssumI / size - Math::sqr( meanI ) ) ) );
 
         // calc SUM( I_i * P_i )
         size_t istride, pstride;
@@ -115,24 +332,24 @@ namespace cvt
         img.unmap( i );
         otherI.unmap( p );
 
-        return ( mulSum - meanP * sumI ) * sigmaPSigmaI / ( size - 1.0f);
+        return ( float )( ( mulSum - meanP * sumI ) * sigmaPSigmaI / ( size - 1.0 ) );
     }
 
     float IntegralImage::ncc( const Image & img, const Patch & patch, const Vector2i & pos ) const
     {
-        if( !_flags & SUMMED_AREA || !_flags & SQUARED_SUMMED_AREA ){
+        if( !( _flags & SUMMED_AREA ) || !( _flags & SQUARED_SUMMED_AREA ) ){
             throw CVTException( "NCC needs SUMMED_AREA and SQUARED_SUMMED_AREA" );
         }
 
         // corresponding rect in this img:
         Recti iRect( pos.x, pos.y, patch.width(), patch.height() );
 
-        float sumI = IntegralImage::area( _sum, iRect );
-        float ssumI = IntegralImage::area( _sqrSum, iRect );
+        double sumI = sumArea( iRect );
+        double ssumI = sqrSumArea( iRect );
 
-        float size = iRect.width * iRect.height;
+        double size = iRect.width * iRect.height;
 
-        float sigmaPSigmaI = Math::invSqrt( patch.variance() * ( ssumI / size - Math::sqr( sumI / size ) ) );
+        float sigmaPSigmaI = Math::invSqrt( patch.variance() * ( float )( ssumI / size - Math::sqr( sumI / size ) ) );
 
         // calc SUM( I_i * P_i )
         size_t istride, pstride;
@@ -152,7 +369,7 @@ namespace cvt
         img.unmap( i );
         patch.data().unmap( p );
 
-        return ( mulSum - patch.mean() * sumI ) * sigmaPSigmaI / ( size - 1.0f );
+        return ( float )( ( mulSum - patch.mean() * sumI ) * sigmaPSigmaI / ( size - 1.0 ) );
     }
 
     /************************INTEGRAL IMAGE TESTS *********************************/
@@ -362,6 +579,32 @@ namespace cvt
         return Math::abs( iArea - iiArea ) < Math::EPSILONF;
     }
 
+    template<typename T>
+    static bool _exactTable( const Image & img, bool squared )
+    {
+        IntegralTable<T> table;
+        table.update( img, squared );
+
+        IMapScoped<const uint8_t> map( img );
+        std::vector<uint64_t> row( img.width() + 1, 0 );
+        bool ret = table.width() == img.width() && table.height() == img.height();
+        for( size_t y = 0; y < img.height() && ret; y++ ){
+            const uint8_t* p = map.ptr();
+            uint64_t rowSum = 0;
+            for( size_t x = 0; x < img.width(); x++ ){
+                rowSum += squared ? ( uint64_t )p[ x ] * p[ x ] : p[ x ];
+                row[ x + 1 ] += rowSum;
+                if( ( uint64_t )table( x + 1, y + 1 ) != row[ x + 1 ] ){
+                    std::cout << "Error: Pos = " << y << ", " << x << ": GT = " << row[ x + 1 ] << " Computed: " << ( uint64_t )table( x + 1, y + 1 ) << std::endl;
+                    ret = false;
+                    break;
+                }
+            }
+            map++;
+        }
+        return ret;
+    }
+
     BEGIN_CVTTEST( IntegralImage )
 
     Image img( 20, 20, IFormat::GRAY_UINT8 );
@@ -429,6 +672,46 @@ namespace cvt
     CVTTEST_PRINT("::squaredArea( ... )", test );
     result &= test;
 
+    {
+        // several bands to exercise the carry propagation
+        Image rnd( 333, 517, IFormat::GRAY_UINT8 );
+        {
+            IMapScoped<uint8_t> map( rnd );
+            for( size_t y = 0; y < rnd.height(); y++, map++ )
+                for( size_t x = 0; x < rnd.width(); x++ )
+                    map.ptr()[ x ] = rand() & 0xff;
+        }
+        test = _exactTable<uint32_t>( rnd, false ) &&
+               _exactTable<uint64_t>( rnd, false ) &&
+               _exactTable<uint64_t>( rnd, true ) &&
+               _exactTable<double>( rnd, true );
+        CVTTEST_PRINT( "IntegralTable( random )", test );
+        result &= test;
+
+        // 255 * 4096 * 4096 is beyond the float mantissa but fits uint32_t
+        Image white( 4096, 4096, IFormat::GRAY_UINT8 );
+        white.fill( Color::WHITE );
+        IntegralTable<uint32_t> t32;
+        t32.update( white );
+        IntegralTable<uint64_t> t64;
+        t64.update( white, true );
+        test = t32.area( 0, 0, 4096, 4096 ) == 255u * 4096u * 4096u &&
+               t32.area( 1, 3, 4000, 17 ) == 255u * 4000u * 17u &&
+               t64.area( 0, 0, 4096, 4096 ) == ( uint64_t ) 255 * 255 * 4096 * 4096;
+        CVTTEST_PRINT( "IntegralTable( exact large )", test );
+        result &= test;
+
+        bool caught = false;
+        try {
+            IntegralTable<uint32_t> tf;
+            tf.update( Image( 8, 8, IFormat::GRAY_FLOAT ) );
+        } catch( const Exception& ) {
+            caught = true;
+        }
+        CVTTEST_PRINT( "IntegralTable( float input rejected )", caught );
+        result &= caught;
+    }
+
     return result;
 
     END_CVTTEST
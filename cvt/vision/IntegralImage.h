@@ -29,6 +29,7 @@
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/util/Flags.h>
 #include <cvt/vision/Patch.h>
+#include <vector>
 
 namespace cvt
 {
@@ -39,11 +40,67 @@ namespace cvt
 
 	CVT_ENUM_TO_FLAGS( IntImgFlagTypes, IntegralImageFlags )
 
+    /**
+     * accumulation type of the tables: float sums lose integer exactness
+     * once a table entry exceeds 2^24, the other variants are exact
+     * ( UINT32 stores the squared sums in 64 bit )
+     */
+    enum IntegralImagePrecision {
+        INTEGRAL_FLOAT = 0,
+        INTEGRAL_UINT32,
+        INTEGRAL_UINT64,
+        INTEGRAL_DOUBLE
+    };
+
+    /**
+     * integral table with exact accumulation type T ( uint32_t, uint64_t or double )
+     * The table has a leading zero row and column, ( x, y ) holds the sum of all
+     * pixels left of x and above y. Tables are built in horizontal bands in parallel,
+     * the band sums are propagated in a second pass.
+     */
+    template<typename T>
+    class IntegralTable
+    {
+        public:
+            IntegralTable() : _width( 0 ), _height( 0 ) {}
+
+            /**
+             * uint32_t/uint64_t tables need GRAY_UINT8 images, double tables GRAY_UINT8 or GRAY_FLOAT images
+             */
+            void        update( const Image & img, bool squared = false );
+
+            size_t      width() const  { return _width; }
+            size_t      height() const { return _height; }
+            /* stride in elements */
+            size_t      stride() const { return _width + 1; }
+            const T*    ptr() const    { return _data.empty() ? NULL : &_data[ 0 ]; }
+
+            const T&    operator()( size_t x, size_t y ) const { return _data[ y * stride() + x ]; }
+
+            /* sum over the rectangle, the rectangle has to be inside the image */
+            T           area( int x, int y, int w, int h ) const;
+            T           area( const Recti & r ) const { return area( r.x, r.y, r.width, r.height ); }
+
+        private:
+            size_t          _width;
+            size_t          _height;
+            std::vector<T>  _data;
+    };
+
+    template<typename T>
+    inline T IntegralTable<T>::area( int x, int y, int w, int h ) const
+    {
+        const T* p0 = &_data[ y * stride() + x ];
+        const T* p1 = p0 + h * stride();
+        // both differences are non-negative: no wrap around for unsigned tables
+        return ( p1[ w ] - p1[ 0 ] ) - ( p0[ w ] - p0[ 0 ] );
+    }
+
 	class IntegralImage
 	{
 		public:
-            IntegralImage( const Image & img, IntegralImageFlags flags = SUMMED_AREA );
-            IntegralImage( IntegralImageFlags flags = SUMMED_AREA );
+            IntegralImage( const Image & img, IntegralImageFlags flags = SUMMED_AREA, IntegralImagePrecision precision = INTEGRAL_FLOAT );
+            IntegralImage( IntegralImageFlags flags = SUMMED_AREA, IntegralImagePrecision precision = INTEGRAL_FLOAT );
             
             ~IntegralImage();
 
@@ -68,9 +125,18 @@ namespace cvt
              */
             float   ncc( const Image & img, const Patch & patch, const Vector2i & pos ) const;
 
+            /* only valid for INTEGRAL_FLOAT */
             const Image & sumImage()	const { return _sum; };
             const Image & sqrSumImage() const { return _sqrSum; };
             IntegralImageFlags flags()  const { return _flags; };
+            IntegralImagePrecision precision() const { return _precision; }
+
+            /* exact tables, depending on the precision */
+            const IntegralTable<uint32_t>& sumTableU32() const { return _sumU32; }
+            const IntegralTable<uint64_t>& sumTableU64() const { return _sumU64; }
+            const IntegralTable<uint64_t>& sqrSumTableU64() const { return _sqrSumU64; }
+            const IntegralTable<double>&   sumTableDouble() const { return _sumDouble; }
+            const IntegralTable<double>&   sqrSumTableDouble() const { return _sqrSumDouble; }
 
             static inline float area( const Image & img, const Recti & r );
 
@@ -80,9 +146,19 @@ namespace cvt
             static inline float area( const IMapScoped<const float>& map, size_t x, size_t y, size_t w, size_t h );
 
         private:
+            double  sumArea( const Recti & r ) const;
+            double  sqrSumArea( const Recti & r ) const;
+
             Image              _sum;
             Image              _sqrSum;
             IntegralImageFlags _flags;
+            IntegralImagePrecision _precision;
+
+            IntegralTable<uint32_t> _sumU32;
+            IntegralTable<uint64_t> _sumU64;
+            IntegralTable<uint64_t> _sqrSumU64;
+            IntegralTable<double>   _sumDouble;
+            IntegralTable<double>   _sqrSumDouble;
 
 	};
 
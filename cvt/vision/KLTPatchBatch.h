@@ -0,0 +1,544 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_KLT_PATCH_BATCH_H
+#define CVT_KLT_PATCH_BATCH_H
+
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <cvt/vision/ImagePyramid.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/EigenBridge.h>
+#include <cvt/util/CVTAssert.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Time.h>
+
+namespace cvt
+{
+    /**
+     *  \brief  statistics of one KLTPatchBatch::track call
+     */
+    struct KLTTrackingStats
+    {
+        KLTTrackingStats() { reset(); }
+
+        void reset()
+        {
+            numPatches = numTracked = numLost = numRejected = numConverged = iterations = 0;
+            meanSSD = 0.0f;
+            timeMs = 0.0;
+        }
+
+        size_t  numPatches;
+        size_t  numTracked;
+        /* left the image or failed at the finest octave */
+        size_t  numLost;
+        /* failed the SSD/SAD check */
+        size_t  numRejected;
+        /* stopped before maxIters at the finest octave */
+        size_t  numConverged;
+        /* Gauss-Newton iterations over all patches and octaves */
+        size_t  iterations;
+        /* mean SSD per pixel of the tracked patches */
+        float   meanSSD;
+        double  timeMs;
+    };
+
+    /**
+     *  \brief  the patches of a keyframe in one structure-of-arrays block
+     *
+     *  Templates, the jacobian planes ( one plane per pose parameter ) and the
+     *  inverse hessians of all patches and octaves are stored contiguously.
+     *  The inverse compositional alignment of KLTPatch is run for all patches
+     *  of a frame at once: the pyramid is mapped once, the patches are
+     *  distributed over the threads of ParallelFor and the scratch buffers of
+     *  a patch live on the stack of the worker. The normal equations of a patch
+     *  are accumulated from the jacobian planes in a single sweep.
+     */
+    template <size_t pSize, class PoseType>
+    class KLTPatchBatch
+    {
+        public:
+            static const size_t NPARAMS = PoseType::NPARAMS;
+            static const size_t NPIXELS = pSize * pSize;
+            typedef Eigen::Matrix<float, NPARAMS, NPARAMS> HessType;
+            typedef Eigen::Matrix<float, NPARAMS, 1>       JacType;
+
+            enum Status {
+                TRACKED,
+                LOST,
+                REJECTED
+            };
+
+            struct Track {
+                Track() : index( 0 ), status( LOST ), ssd( 0.0f ), sad( 0.0f ), iterations( 0 ), converged( false ) {}
+                Track( size_t idx, const Vector2f& predicted ) :
+                    index( idx ), position( predicted ), status( LOST ), ssd( 0.0f ), sad( 0.0f ), iterations( 0 ), converged( false )
+                {}
+
+                /* patch index in the batch */
+                size_t      index;
+                /* in: predicted position, out: tracked position */
+                Vector2f    position;
+                Status      status;
+                float       ssd;
+                float       sad;
+                size_t      iterations;
+                /* stopped early at the finest octave */
+                bool        converged;
+            };
+
+            KLTPatchBatch( size_t octaves = 1 );
+
+            /**
+             *  \brief  extract a patch at pos from all octaves
+             *  \return false if the patch is too close to the border or has no texture,
+             *          the slot is still added to keep the indices in sync
+             */
+            bool    add( const ImagePyramid& pyr, const ImagePyramid& gradX, const ImagePyramid& gradY, const Vector2f& pos );
+
+            size_t  size() const            { return _valid.size(); }
+            size_t  numOctaves() const      { return _octaves; }
+            bool    isValid( size_t i ) const { return _valid[ i ] != 0; }
+            void    clear();
+
+            const float* pixels( size_t i, size_t octave = 0 ) const { return &_pixels[ ( i * _octaves + octave ) * NPIXELS ]; }
+
+            /**
+             *  \brief  track all patches of tracks through the pyramid
+             *  \param  maxIters        iterations per octave
+             *  \param  maxSSD, maxSAD  per pixel thresholds at the finest octave
+             *  \param  minImprovement  relative error decrease below which a patch stops iterating
+             */
+            void    track( std::vector<Track>& tracks, const ImagePyramid& pyr, size_t maxIters,
+                           float maxSSD, float maxSAD, float minImprovement = 1e-3f, KLTTrackingStats* stats = NULL ) const;
+
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        private:
+            struct Octave {
+                const float* ptr;
+                size_t       stride;
+                size_t       width;
+                size_t       height;
+            };
+
+            class TrackTask {
+                public:
+                    TrackTask( const KLTPatchBatch<pSize, PoseType>& batch, std::vector<Track>& tracks, const std::vector<Octave>& octaves,
+                               float scaleFactor, size_t maxIters, float maxSSD, float maxSAD, float minImprovement ) :
+                        _batch( batch ), _tracks( tracks ), _octaves( octaves ), _scaleFactor( scaleFactor ),
+                        _maxIters( maxIters ), _maxSSD( maxSSD ), _maxSAD( maxSAD ), _minImprovement( minImprovement )
+                    {
+                    }
+
+                    void operator()( size_t begin, size_t end );
+
+                private:
+                    const KLTPatchBatch<pSize, PoseType>& _batch;
+                    std::vector<Track>&         _tracks;
+                    const std::vector<Octave>&  _octaves;
+                    float                       _scaleFactor;
+                    size_t                      _maxIters;
+                    float                       _maxSSD;
+                    float                       _maxSAD;
+                    float                       _minImprovement;
+            };
+
+            /* maps all octaves of a pyramid, unmapped again if tracking throws */
+            class PyramidMap {
+                public:
+                    PyramidMap( const ImagePyramid& pyr );
+                    ~PyramidMap();
+
+                    const IMapScoped<const float>& operator[]( size_t o ) const { return *_maps[ o ]; }
+
+                private:
+                    PyramidMap( const PyramidMap& );
+                    PyramidMap& operator=( const PyramidMap& );
+                    void release();
+
+                    std::vector<IMapScoped<const float>*> _maps;
+            };
+
+            /* per patch scratch */
+            struct Scratch {
+                Vector2f    warped[ NPIXELS ];
+                float       transformed[ NPIXELS ];
+                float       residuals[ NPIXELS ];
+            };
+
+            bool    extract( size_t idx, const Octave& img, const Octave& gx, const Octave& gy, const Vector2f& pos, size_t octave );
+            bool    align( PoseType& pose, Scratch& scratch, size_t idx, const Octave& img, size_t octave,
+                           size_t maxIters, float minImprovement, size_t& iterations, bool& converged ) const;
+            float   residuals( Scratch& scratch, const Matrix3f& pose, size_t idx, const Octave& img, size_t octave ) const;
+            void    buildSystem( JacType& b, const float* r, size_t idx, size_t octave ) const;
+            static bool inImage( const Matrix3f& pose, size_t w, size_t h );
+
+            size_t                  _octaves;
+            std::vector<Vector2f>   _points;
+            /* [ patch ][ octave ][ pixel ] */
+            std::vector<float>      _pixels;
+            /* [ patch ][ octave ][ param ][ pixel ] */
+            std::vector<float>      _jacobians;
+            /* [ patch ][ octave ] */
+            std::vector<HessType, Eigen::aligned_allocator<HessType> > _invHessians;
+            std::vector<uint8_t>    _valid;
+            /* d( screen point ) / d( params ) at identity for all patch points */
+            std::vector<Eigen::Matrix<float, 2, NPARAMS>, Eigen::aligned_allocator<Eigen::Matrix<float, 2, NPARAMS> > > _screenJacobians;
+    };
+
+    template <size_t pSize, class PoseType>
+    inline KLTPatchBatch<pSize, PoseType>::KLTPatchBatch( size_t octaves ) :
+        _octaves( octaves )
+    {
+        PoseType pose;
+        Eigen::Vector2f p;
+        int half = pSize >> 1;
+
+        _points.reserve( NPIXELS );
+        _screenJacobians.resize( NPIXELS );
+        for( size_t y = 0; y < pSize; y++ ){
+            for( size_t x = 0; x < pSize; x++ ){
+                _points.push_back( Vector2f( ( int )x - half, ( int )y - half ) );
+                EigenBridge::toEigen( p, _points.back() );
+                pose.screenJacobian( _screenJacobians[ _points.size() - 1 ], p );
+            }
+        }
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTPatchBatch<pSize, PoseType>::clear()
+    {
+        _pixels.clear();
+        _jacobians.clear();
+        _invHessians.clear();
+        _valid.clear();
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTPatchBatch<pSize, PoseType>::add( const ImagePyramid& pyr, const ImagePyramid& gradX, const ImagePyramid& gradY, const Vector2f& pos )
+    {
+        if( pyr.octaves() != _octaves )
+            throw CVTException( "KLTPatchBatch: number of octaves does not match" );
+
+        size_t n = size();
+        _pixels.resize( _pixels.size() + _octaves * NPIXELS, 0.0f );
+        _jacobians.resize( _jacobians.size() + _octaves * NPIXELS * NPARAMS, 0.0f );
+        _invHessians.resize( _invHessians.size() + _octaves, HessType::Zero() );
+        _valid.push_back( 0 );
+
+        float scale = 1.0f;
+        bool good = true;
+        for( size_t o = 0; o < _octaves && good; o++ ){
+            IMapScoped<const float> iMap( pyr[ o ] );
+            IMapScoped<const float> gxMap( gradX[ o ] );
+            IMapScoped<const float> gyMap( gradY[ o ] );
+
+            Octave img = { iMap.ptr(), iMap.stride(), pyr[ o ].width(), pyr[ o ].height() };
+            Octave gx  = { gxMap.ptr(), gxMap.stride(), pyr[ o ].width(), pyr[ o ].height() };
+            Octave gy  = { gyMap.ptr(), gyMap.stride(), pyr[ o ].width(), pyr[ o ].height() };
+            good = extract( n, img, gx, gy, pos * scale, o );
+            scale *= pyr.scaleFactor();
+        }
+
+        _valid[ n ] = good;
+        return good;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTPatchBatch<pSize, PoseType>::extract( size_t idx, const Octave& img, const Octave& gx, const Octave& gy, const Vector2f& pos, size_t octave )
+    {
+        const size_t phalf = pSize >> 1;
+        int x = pos.x;
+        int y = pos.y;
+        if( x < ( int )phalf + 1 || ( x + phalf + 1 ) >= img.width ||
+            y < ( int )phalf + 1 || ( y + phalf + 1 ) >= img.height )
+            return false;
+
+        size_t stride = img.stride / sizeof( float );
+        size_t offset = ( int )( pos.y - phalf ) * stride + ( int )( pos.x - phalf );
+        const float* iptr  = img.ptr + offset;
+        const float* gxptr = gx.ptr + offset;
+        const float* gyptr = gy.ptr + offset;
+
+        size_t slot = idx * _octaves + octave;
+        float* p = &_pixels[ slot * NPIXELS ];
+        float* J = &_jacobians[ slot * NPIXELS * NPARAMS ];
+
+        HessType hess( HessType::Zero() );
+        JacType  j;
+        Eigen::Vector2f g;
+        size_t k = 0;
+        for( size_t r = 0; r < pSize; r++ ){
+            for( size_t c = 0; c < pSize; c++, k++ ){
+                p[ k ] = iptr[ c ];
+                g[ 0 ] = gxptr[ c ];
+                g[ 1 ] = gyptr[ c ];
+                j = _screenJacobians[ k ].transpose() * g;
+                hess.noalias() += j * j.transpose();
+                for( size_t param = 0; param < NPARAMS; param++ )
+                    J[ param * NPIXELS + k ] = j[ param ];
+            }
+            iptr  += stride;
+            gxptr += stride;
+            gyptr += stride;
+        }
+
+        if( Math::abs( hess.determinant() ) <= 1e-5 )
+            return false;
+        _invHessians[ slot ] = hess.inverse();
+        return true;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTPatchBatch<pSize, PoseType>::inImage( const Matrix3f& pose, size_t w, size_t h )
+    {
+        const float half = pSize >> 1;
+        const Vector2f corners[ 4 ] = { Vector2f( -half, -half ), Vector2f( half, -half ),
+                                        Vector2f( half, half ), Vector2f( -half, half ) };
+        for( size_t i = 0; i < 4; i++ ){
+            Vector2f p = pose * corners[ i ];
+            if( p.x < 0.0f || p.x >= w || p.y < 0.0f || p.y >= h )
+                return false;
+        }
+        return true;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline float KLTPatchBatch<pSize, PoseType>::residuals( Scratch& scratch, const Matrix3f& pose, size_t idx, const Octave& img, size_t octave ) const
+    {
+        SIMD* simd = SIMD::instance();
+        simd->transformPoints( scratch.warped, pose, &_points[ 0 ], NPIXELS );
+        simd->warpBilinear1f( scratch.transformed, &scratch.warped[ 0 ].x, img.ptr, img.stride, img.width, img.height, 2.0f, NPIXELS );
+        simd->Sub( scratch.residuals, scratch.transformed, pixels( idx, octave ), NPIXELS );
+        return simd->sumSqr( scratch.residuals, NPIXELS );
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTPatchBatch<pSize, PoseType>::buildSystem( JacType& b, const float* r, size_t idx, size_t octave ) const
+    {
+        const float* J = &_jacobians[ ( idx * _octaves + octave ) * NPIXELS * NPARAMS ];
+
+        // one sweep over the residuals for all parameters, the planes are contiguous
+        float acc[ NPARAMS ];
+        for( size_t param = 0; param < NPARAMS; param++ )
+            acc[ param ] = 0.0f;
+        for( size_t k = 0; k < NPIXELS; k++ ){
+            const float rk = r[ k ];
+            for( size_t param = 0; param < NPARAMS; param++ )
+                acc[ param ] += J[ param * NPIXELS + k ] * rk;
+        }
+
+        for( size_t param = 0; param < NPARAMS; param++ )
+            b[ param ] = acc[ param ];
+    }
+
+    template <size_t pSize, class PoseType>
+    inline bool KLTPatchBatch<pSize, PoseType>::align( PoseType& pose, Scratch& scratch, size_t idx, const Octave& img, size_t octave,
+                                                      size_t maxIters, float minImprovement, size_t& iterations, bool& converged ) const
+    {
+        const HessType& invH = _invHessians[ idx * _octaves + octave ];
+        JacType b;
+        typename PoseType::ParameterVectorType delta;
+
+        Matrix3f poseMat, poseSave;
+        EigenBridge::toCVT( poseMat, pose.transformation() );
+        poseSave = poseMat;
+        converged = false;
+        if( !inImage( poseMat, img.width, img.height ) )
+            return false;
+
+        float diffSum = residuals( scratch, poseMat, idx, img, octave );
+        buildSystem( b, scratch.residuals, idx, octave );
+
+        for( size_t iter = 0; iter < maxIters; iter++ ){
+            delta = invH * b;
+
+            float newError = diffSum + 1.0f;
+            while( newError > diffSum ){
+                if( delta.cwiseAbs().maxCoeff() < 1e-6f ){
+                    EigenBridge::toEigen( pose.transformation(), poseSave );
+                    converged = true;
+                    return true;
+                }
+
+                EigenBridge::toEigen( pose.transformation(), poseSave );
+                pose.applyInverse( -delta );
+                EigenBridge::toCVT( poseMat, pose.transformation() );
+
+                if( inImage( poseMat, img.width, img.height ) )
+                    newError = residuals( scratch, poseMat, idx, img, octave );
+
+                delta *= 0.5f;
+            }
+            poseSave = poseMat;
+            iterations++;
+
+            // early termination: no significant improvement anymore
+            bool done = ( diffSum - newError ) <= minImprovement * diffSum;
+            diffSum = newError;
+            if( done ){
+                converged = true;
+                return true;
+            }
+            buildSystem( b, scratch.residuals, idx, octave );
+        }
+        return true;
+    }
+
+    template <size_t pSize, class PoseType>
+    inline KLTPatchBatch<pSize, PoseType>::PyramidMap::PyramidMap( const ImagePyramid& pyr )
+    {
+        _maps.reserve( pyr.octaves() );
+        try {
+            for( size_t o = 0; o < pyr.octaves(); o++ )
+                _maps.push_back( new IMapScoped<const float>( pyr[ o ] ) );
+        } catch( ... ){
+            release();
+            throw;
+        }
+    }
+
+    template <size_t pSize, class PoseType>
+    inline KLTPatchBatch<pSize, PoseType>::PyramidMap::~PyramidMap()
+    {
+        release();
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTPatchBatch<pSize, PoseType>::PyramidMap::release()
+    {
+        for( size_t o = 0; o < _maps.size(); o++ )
+            delete _maps[ o ];
+        _maps.clear();
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTPatchBatch<pSize, PoseType>::TrackTask::operator()( size_t begin, size_t end )
+    {
+        Scratch scratch;
+        SIMD* simd = SIMD::instance();
+        const size_t nOctaves = _octaves.size();
+        const float invScale = 1.0f / _scaleFactor;
+
+        for( size_t t = begin; t < end; t++ ){
+            Track& track = _tracks[ t ];
+            track.status = LOST;
+            track.iterations = 0;
+            track.converged = false;
+            if( track.index >= _batch.size() || !_batch.isValid( track.index ) )
+                continue;
+
+            // start at the coarsest octave
+            float scale = Math::pow( _scaleFactor, ( float )( nOctaves - 1 ) );
+            Matrix3f poseMat;
+            poseMat.setIdentity();
+            poseMat[ 0 ][ 2 ] = track.position.x * scale;
+            poseMat[ 1 ][ 2 ] = track.position.y * scale;
+
+            PoseType pose, backup;
+            pose.set( poseMat );
+            backup = pose;
+
+            bool ret = false;
+            for( int oc = nOctaves - 1; oc >= 0; --oc ){
+                ret = _batch.align( pose, scratch, track.index, _octaves[ oc ], oc, _maxIters, _minImprovement, track.iterations, track.converged );
+                if( !ret )
+                    pose.transformation() = backup.transformation();
+
+                if( oc != 0 ){
+                    EigenBridge::toCVT( poseMat, pose.transformation() );
+                    poseMat[ 0 ][ 2 ] *= invScale;
+                    poseMat[ 1 ][ 2 ] *= invScale;
+                    pose.set( poseMat );
+                    backup.transformation() = pose.transformation();
+                }
+            }
+
+            if( !ret )
+                continue;
+
+            // warp the patch at the final pose of the finest octave
+            EigenBridge::toCVT( poseMat, pose.transformation() );
+            _batch.residuals( scratch, poseMat, track.index, _octaves[ 0 ], 0 );
+            const float* tmpl = _batch.pixels( track.index, 0 );
+            track.ssd = simd->SSD( tmpl, scratch.transformed, NPIXELS ) / ( float ) NPIXELS;
+            track.sad = simd->SAD( tmpl, scratch.transformed, NPIXELS ) / ( float ) NPIXELS;
+            track.position.x = pose.transformation()( 0, 2 );
+            track.position.y = pose.transformation()( 1, 2 );
+            track.status = ( track.ssd < _maxSSD && track.sad < _maxSAD ) ? TRACKED : REJECTED;
+        }
+    }
+
+    template <size_t pSize, class PoseType>
+    inline void KLTPatchBatch<pSize, PoseType>::track( std::vector<Track>& tracks, const ImagePyramid& pyr, size_t maxIters,
+                                                      float maxSSD, float maxSAD, float minImprovement, KLTTrackingStats* stats ) const
+    {
+        Time timer;
+
+        if( pyr.octaves() != _octaves )
+            throw CVTException( "KLTPatchBatch: number of octaves does not match" );
+        CVT_ASSERT( pyr[ 0 ].format() == IFormat::GRAY_FLOAT, "Format must be GRAY_FLOAT!" );
+
+        {
+            // map the pyramid once for all patches
+            PyramidMap maps( pyr );
+            std::vector<Octave> octaves( _octaves );
+            for( size_t o = 0; o < _octaves; o++ ){
+                octaves[ o ].ptr = maps[ o ].ptr();
+                octaves[ o ].stride = maps[ o ].stride();
+                octaves[ o ].width = pyr[ o ].width();
+                octaves[ o ].height = pyr[ o ].height();
+            }
+
+            TrackTask task( *this, tracks, octaves, pyr.scaleFactor(), maxIters, maxSSD, maxSAD, minImprovement );
+            ParallelFor::run( task, 0, tracks.size(), 8 );
+        }
+
+        if( stats ){
+            stats->reset();
+            stats->numPatches = tracks.size();
+            for( size_t i = 0; i < tracks.size(); i++ ){
+                stats->iterations += tracks[ i ].iterations;
+                if( tracks[ i ].converged )
+                    stats->numConverged++;
+                switch( tracks[ i ].status ){
+                    case TRACKED:
+                        stats->numTracked++;
+                        stats->meanSSD += tracks[ i ].ssd;
+                        break;
+                    case REJECTED: stats->numRejected++; break;
+                    case LOST:     stats->numLost++; break;
+                }
+            }
+            if( stats->numTracked )
+                stats->meanSSD /= ( float ) stats->numTracked;
+            stats->timeMs = timer.elapsedMilliSeconds();
+        }
+    }
+}
+
+#endif
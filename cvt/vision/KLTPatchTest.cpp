@@ -23,6 +23,7 @@
 */
 
 #include <cvt/vision/KLTPatch.h>
+#include <cvt/vision/KLTPatchBatch.h>
 #include <cvt/util/CVTTest.h>
 #include <cvt/io/Resources.h>
 
@@ -113,6 +114,55 @@ static bool _trackPatch( const ImagePyramid& gray,
     return true;
 }
 
+template<class PoseType>
+static bool _trackBatch( const ImagePyramid& gray,
+                         const ImagePyramid& gx,
+                         const ImagePyramid& gy )
+{
+    typedef KLTPatchBatch<16, PoseType> Batch;
+    typedef KLTPatch<16, PoseType> Patch;
+
+    Batch batch( gray.octaves() );
+    std::vector<typename Batch::Track> tracks;
+    std::vector<Vector2f> truePos;
+
+    for( size_t y = 200; y <= 320; y += 40 ){
+        for( size_t x = 200; x <= 320; x += 40 ){
+            truePos.push_back( Vector2f( x, y ) );
+            batch.add( gray, gx, gy, truePos.back() );
+            tracks.push_back( typename Batch::Track( batch.size() - 1, Vector2f( x + 4, y - 4 ) ) );
+        }
+    }
+
+    KLTTrackingStats stats;
+    batch.track( tracks, gray, 5, 1.0f, 1.0f, 1e-3f, &stats );
+
+    // check against the true position, report the single patch alignment on failure
+    Vector2f estimated;
+    for( size_t i = 0; i < tracks.size(); i++ ){
+        Patch p( gray.octaves() );
+        if( !p.update( gray, gx, gy, truePos[ i ] ) ){
+            if( batch.isValid( i ) )
+                return false;
+            continue;
+        }
+        p.initPose( Vector2f( truePos[ i ].x + 4, truePos[ i ].y - 4 ) );
+        p.align( gray, 5 );
+        p.currentCenter( estimated );
+
+        if( tracks[ i ].status != Batch::TRACKED || ( tracks[ i ].position - truePos[ i ] ).length() > 1e-1 ){
+            CVTTEST_PRINT( "Batch: " << tracks[ i ].position << " - True: " << truePos[ i ] << " - Single: " << estimated, false );
+            return false;
+        }
+    }
+
+    if( stats.numTracked != stats.numPatches ){
+        CVTTEST_PRINT( "Batch tracked " << stats.numTracked << " / " << stats.numPatches, false );
+        return false;
+    }
+    return true;
+}
+
 BEGIN_CVTTEST( KLTPatch )
 
 Resources resources;
@@ -163,6 +213,14 @@ b = _trackPatch<GA2<float> >( pyrf, gx, gy );
 CVTTEST_PRINT( "2D General Affine Test: ", b );
 result &= b;
 
+b = _trackBatch<Translation2D<float> >( pyrf, gx, gy );
+CVTTEST_PRINT( "Batch 2D Translation Test: ", b );
+result &= b;
+
+b = _trackBatch<GA2<float> >( pyrf, gx, gy );
+CVTTEST_PRINT( "Batch 2D General Affine Test: ", b );
+result &= b;
+
 return result;
 
 END_CVTTEST
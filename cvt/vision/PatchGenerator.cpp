@@ -31,12 +31,15 @@ namespace cvt
 	PatchGenerator::PatchGenerator( const Rangef & angleRange,
 									const Rangef & scaleRange, 
 									uint32_t patchSize,
-									double whiteNoiseSigma ) :
+									double whiteNoiseSigma,
+									uint64_t seed,
+									uint64_t stream ) :
 		_patchSize( patchSize ), 
 		_angleRange( angleRange ), 
 		_scaleRange( scaleRange ),		
 		_whiteNoiseSigma( whiteNoiseSigma ),
-		_rng( time( NULL ) )
+		_rng( seed, stream ),
+		_noise( patchSize * patchSize )
 	{
 	}
 	
@@ -88,6 +91,11 @@ namespace cvt
 		float fracX, fracY;
 		double pixelNoise;
 		int32_t tmp0, tmp1, tmp;
+
+		// pixel noise of the whole patch at once
+		_rng.fillGaussian( &_noise[ 0 ], _noise.size(), _whiteNoiseSigma );
+		const float* noise = &_noise[ 0 ];
+
 		for( uint32_t i = 0; i < _patchSize; i++ ){
 			currentP[ 0 ] = -(float)_patchSize / 2.0f;
 			for( uint32_t j = 0; j < _patchSize; j++ ){	
@@ -107,7 +115,7 @@ namespace cvt
 					for( size_t c = 0; c < numChannels; c++ )
 						out[ numChannels * j  + c ] = 0;
 				} else {
-					pixelNoise = Math::clamp( _rng.gaussian( _whiteNoiseSigma ), -20.0, 20.0 );
+					pixelNoise = Math::clamp( noise[ j ], -20.0f, 20.0f );
 					
 					for( size_t c = 0; c < numChannels; c++ ){						
 						if( ( uint32_t )x1 < inputImage.width() )
@@ -127,6 +135,7 @@ namespace cvt
 			}
 			
 			out += outStride;
+			noise += _patchSize;
 			currentP[ 1 ] += 1.0f;
 		}
 		
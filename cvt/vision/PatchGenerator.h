@@ -30,6 +30,7 @@
 #include <cvt/util/Range.h>
 #include <cvt/util/RNG.h>
 #include <Eigen/Core>
+#include <vector>
 
 
 namespace cvt
@@ -37,7 +38,8 @@ namespace cvt
 	class PatchGenerator
 	{
 		public:
-			PatchGenerator( const Rangef & angleRange, const Rangef & scaleRange, uint32_t patchSize = 32, double whiteNoiseSigma = 5.0 );
+			PatchGenerator( const Rangef & angleRange, const Rangef & scaleRange, uint32_t patchSize = 32, double whiteNoiseSigma = 5.0,
+							uint64_t seed = 0, uint64_t stream = 0 );
 			~PatchGenerator();
 			
 			/* generate the next patch */
@@ -50,6 +52,7 @@ namespace cvt
 			double				_whiteNoiseSigma;			
 			Eigen::Matrix2f		_affine;
 			RNG					_rng;
+			std::vector<float>	_noise;
 			size_t				_inHandle, _outHandle;
 			
 			void randomizeAffine();		
@@ -0,0 +1,551 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/util/SIMD.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/RNG.h>
+#include <cvt/util/Exception.h>
+
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+namespace cvt {
+
+	/* descriptor window radius, census uses 9x7 and BRIEF 9x9 */
+	static const int SGM_RX = 4;
+	static const int SGM_RY = 4;
+
+	/* cost of pixels without a partner in the right image */
+	static const uint8_t SGM_COSTMAX = 64;
+
+	/* offset of the path costs in a row buffer, leaves room for the sentinels at -1 and n */
+	static const size_t SGM_PATHOFFSET = 8;
+	static const uint16_t SGM_PATHSENTINEL = 0x3fff;
+
+	SGMStereo::SGMStereo( size_t numDisparities, size_t minDisparity ) :
+		_p1( 10 ),
+		_p2( 120 ),
+		_costType( SGM_CENSUS ),
+		_paths( 8 ),
+		_lrMaxDiff( 1.0f ),
+		_subpixel( true ),
+		_maxMemory( 512 * 1024 * 1024 ),
+		_tileOverlap( 32 ),
+		_costVolume( 0 ),
+		_sumVolume( 0 ),
+		_volumeSize( 0 )
+	{
+		setDisparityRange( minDisparity, numDisparities );
+
+		/* fixed BRIEF test pattern, no test compares a pixel with itself */
+		RNG rng( 0x5e3a1c );
+		for( size_t i = 0; i < 64; i++ ) {
+			do {
+				for( size_t k = 0; k < 4; k++ )
+					_brief[ i ][ k ] = ( int8_t ) rng.uniform( -SGM_RX, SGM_RX + 1 );
+			} while( _brief[ i ][ 0 ] == _brief[ i ][ 2 ] && _brief[ i ][ 1 ] == _brief[ i ][ 3 ] );
+		}
+	}
+
+	SGMStereo::~SGMStereo()
+	{
+		free( _costVolume );
+		free( _sumVolume );
+	}
+
+	void SGMStereo::allocVolumes( size_t size ) const
+	{
+		if( size <= _volumeSize )
+			return;
+		free( _costVolume );
+		free( _sumVolume );
+		_costVolume = 0;
+		_sumVolume = 0;
+		_volumeSize = 0;
+		if( posix_memalign( ( void** ) &_costVolume, 16, size ) || posix_memalign( ( void** ) &_sumVolume, 16, size * sizeof( uint16_t ) ) )
+			throw CVTException( "Could not allocate SGM volumes" );
+		_volumeSize = size;
+	}
+
+	void SGMStereo::setDisparityRange( size_t minDisparity, size_t numDisparities )
+	{
+		if( !numDisparities )
+			throw CVTException( "Number of disparities has to be positive" );
+		_minDisparity = minDisparity;
+		_numDisparities = Math::pad16( numDisparities );
+	}
+
+	void SGMStereo::setPenalties( uint16_t p1, uint16_t p2 )
+	{
+		/* path costs are bounded by SGM_COSTMAX + p2 and the sum of 8 paths has to fit in 16 bit */
+		if( p1 > p2 || p2 > 4096 )
+			throw CVTException( "Invalid SGM penalties" );
+		_p1 = p1;
+		_p2 = p2;
+	}
+
+	void SGMStereo::setPaths( size_t paths )
+	{
+		if( paths != 4 && paths != 8 )
+			throw CVTException( "SGM supports 4 or 8 paths" );
+		_paths = paths;
+	}
+
+	void SGMStereo::setMaxMemory( size_t bytes, size_t tileOverlap )
+	{
+		_maxMemory = bytes;
+		_tileOverlap = tileOverlap;
+	}
+
+	/* census or BRIEF descriptors of rows of a border replicated image */
+	class SGMDescriptor {
+		public:
+			SGMDescriptor( uint64_t* dst, const uint8_t* src, size_t sstride, size_t width, SGMStereo::MatchingCost type, const int8_t ( *brief )[ 4 ] ) :
+				_dst( dst ), _src( src ), _sstride( sstride ), _width( width ), _type( type ), _brief( brief )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				ssize_t stride = _sstride;
+				for( size_t y = begin; y < end; y++ ) {
+					const uint8_t* center = _src + ( y + SGM_RY ) * _sstride + SGM_RX;
+					uint64_t* dst = _dst + y * _width;
+
+					/* one comparison for all pixels of the row at a time */
+					for( size_t x = 0; x < _width; x++ )
+						dst[ x ] = 0;
+					if( _type == SGMStereo::SGM_CENSUS ) {
+						for( ssize_t dy = -3; dy <= 3; dy++ ) {
+							for( ssize_t dx = -SGM_RX; dx <= SGM_RX; dx++ ) {
+								if( !dx && !dy )
+									continue;
+								const uint8_t* n = center + dy * stride + dx;
+								for( size_t x = 0; x < _width; x++ )
+									dst[ x ] = ( dst[ x ] << 1 ) | ( n[ x ] < center[ x ] );
+							}
+						}
+					} else {
+						for( size_t i = 0; i < 64; i++ ) {
+							const int8_t* t = _brief[ i ];
+							const uint8_t* a = center + t[ 1 ] * stride + t[ 0 ];
+							const uint8_t* b = center + t[ 3 ] * stride + t[ 2 ];
+							for( size_t x = 0; x < _width; x++ )
+								dst[ x ] = ( dst[ x ] << 1 ) | ( a[ x ] < b[ x ] );
+						}
+					}
+				}
+			}
+
+		private:
+			uint64_t*				_dst;
+			const uint8_t*			_src;
+			size_t					_sstride;
+			size_t					_width;
+			SGMStereo::MatchingCost	_type;
+			const int8_t			( *_brief )[ 4 ];
+	};
+
+	/* hamming distances of the left descriptor to the right descriptors along the disparity range */
+	class SGMCost {
+		public:
+			SGMCost( uint8_t* cost, const uint64_t* left, const uint64_t* right, size_t width, size_t y0, size_t mind, size_t numd ) :
+				_cost( cost ), _left( left ), _right( right ), _width( width ), _y0( y0 ), _mind( mind ), _numd( numd )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				SIMD* simd = SIMD::instance();
+				std::vector<uint64_t> reversed( _width );
+
+				for( size_t y = begin; y < end; y++ ) {
+					const uint64_t* left = _left + ( _y0 + y ) * _width;
+					const uint64_t* right = _right + ( _y0 + y ) * _width;
+					uint8_t* cost = _cost + y * _width * _numd;
+
+					/* reversed right row, the partners of x for increasing disparities follow each other */
+					for( size_t x = 0; x < _width; x++ )
+						reversed[ _width - 1 - x ] = right[ x ];
+
+					for( size_t x = 0; x < _width; x++ ) {
+						size_t n = x >= _mind ? Math::min( _numd, x - _mind + 1 ) : 0;
+						if( n )
+							simd->hammingDistances_u64_to_u8( cost, left[ x ], &reversed[ _width - 1 - x + _mind ], n );
+						if( n < _numd )
+							memset( cost + n, SGM_COSTMAX, _numd - n );
+						cost += _numd;
+					}
+				}
+			}
+
+		private:
+			uint8_t*		_cost;
+			const uint64_t* _left;
+			const uint64_t* _right;
+			size_t			_width;
+			size_t			_y0;
+			size_t			_mind;
+			size_t			_numd;
+	};
+
+	/* path buffer with the sentinels around every entry of numd disparities */
+	static void _SGMInitPathBuffer( uint16_t* buf, size_t count, size_t numd, uint16_t value )
+	{
+		size_t stride = numd + 2 * SGM_PATHOFFSET;
+		for( size_t i = 0; i < count; i++ ) {
+			uint16_t* b = buf + i * stride;
+			for( size_t k = 0; k < stride; k++ )
+				b[ k ] = SGM_PATHSENTINEL;
+			for( size_t d = 0; d < numd; d++ )
+				b[ SGM_PATHOFFSET + d ] = value;
+		}
+	}
+
+	/* left to right and right to left paths, the rows are independent */
+	class SGMHorizontal {
+		public:
+			SGMHorizontal( uint16_t* sum, const uint8_t* cost, const uint16_t* start, size_t width, size_t numd, uint16_t p1, uint16_t p2 ) :
+				_sum( sum ), _cost( cost ), _start( start ), _width( width ), _numd( numd ), _p1( p1 ), _p2( p2 )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				SIMD* simd = SIMD::instance();
+				size_t stride = _numd + 2 * SGM_PATHOFFSET;
+				ScopedBuffer<uint16_t, true> buf( 2 * stride );
+				_SGMInitPathBuffer( buf.ptr(), 2, _numd, 0 );
+				uint16_t* bufs[ 2 ] = { buf.ptr() + SGM_PATHOFFSET, buf.ptr() + stride + SGM_PATHOFFSET };
+
+				for( size_t y = begin; y < end; y++ ) {
+					const uint8_t* cost = _cost + y * _width * _numd;
+					uint16_t* sum = _sum + y * _width * _numd;
+					const uint16_t* prev = _start;
+					uint16_t pm = 0;
+
+					for( size_t x = 0; x < _width; x++ ) {
+						pm = simd->SGMPath_u8_to_u16( bufs[ x & 1 ], sum + x * _numd, prev, cost + x * _numd, pm, _p1, _p2, _numd );
+						prev = bufs[ x & 1 ];
+					}
+
+					prev = _start;
+					pm = 0;
+					for( size_t x = _width; x--; ) {
+						pm = simd->SGMPath_u8_to_u16( bufs[ x & 1 ], sum + x * _numd, prev, cost + x * _numd, pm, _p1, _p2, _numd );
+						prev = bufs[ x & 1 ];
+					}
+				}
+			}
+
+		private:
+			uint16_t*		_sum;
+			const uint8_t*	_cost;
+			const uint16_t* _start;
+			size_t			_width;
+			size_t			_numd;
+			uint16_t		_p1, _p2;
+	};
+
+	/*
+	   One row of the vertical and diagonal paths, all of them coming from the previous row.
+	   The columns are independent.
+	 */
+	class SGMColumnStep {
+		public:
+			SGMColumnStep( size_t width, size_t numd, size_t ndirs, const int* dx, const uint16_t* start, uint16_t p1, uint16_t p2 ) :
+				_width( width ), _numd( numd ), _ndirs( ndirs ), _dx( dx ), _start( start ), _p1( p1 ), _p2( p2 ),
+				_sum( 0 ), _cost( 0 ), _first( true )
+			{
+			}
+
+			void setRow( uint16_t* sum, const uint8_t* cost, bool first, uint16_t* const* cur, const uint16_t* const* prev,
+						 uint16_t* const* curmin, const uint16_t* const* prevmin )
+			{
+				_sum = sum;
+				_cost = cost;
+				_first = first;
+				_cur = cur;
+				_prev = prev;
+				_curmin = curmin;
+				_prevmin = prevmin;
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				SIMD* simd = SIMD::instance();
+				size_t stride = _numd + 2 * SGM_PATHOFFSET;
+
+				for( size_t x = begin; x < end; x++ ) {
+					for( size_t k = 0; k < _ndirs; k++ ) {
+						ssize_t px = ( ssize_t ) x + _dx[ k ];
+						const uint16_t* prev = _start;
+						uint16_t pm = 0;
+						if( !_first && px >= 0 && px < ( ssize_t ) _width ) {
+							prev = _prev[ k ] + px * stride;
+							pm = _prevmin[ k ][ px ];
+						}
+						_curmin[ k ][ x ] = simd->SGMPath_u8_to_u16( _cur[ k ] + x * stride, _sum + x * _numd, prev, _cost + x * _numd,
+																	 pm, _p1, _p2, _numd );
+					}
+				}
+			}
+
+		private:
+			size_t					_width;
+			size_t					_numd;
+			size_t					_ndirs;
+			const int*				_dx;
+			const uint16_t*			_start;
+			uint16_t				_p1, _p2;
+			uint16_t*				_sum;
+			const uint8_t*			_cost;
+			bool					_first;
+			uint16_t* const*		_cur;
+			const uint16_t* const*	_prev;
+			uint16_t* const*		_curmin;
+			const uint16_t* const*	_prevmin;
+	};
+
+	/* winner takes all with subpixel refinement and left-right check */
+	class SGMSelect {
+		public:
+			SGMSelect( float* disparity, size_t dstride, const uint16_t* sum, size_t width, size_t y0, size_t mind, size_t numd,
+					   bool subpixel, float lrmaxdiff ) :
+				_disparity( disparity ), _dstride( dstride ), _sum( sum ), _width( width ), _y0( y0 ), _mind( mind ), _numd( numd ),
+				_subpixel( subpixel ), _lrmaxdiff( lrmaxdiff )
+			{
+			}
+
+			void operator()( size_t begin, size_t end )
+			{
+				std::vector<int> dr( _width, -1 );
+
+				for( size_t y = begin; y < end; y++ ) {
+					const uint16_t* sum = _sum + ( y - _y0 ) * _width * _numd;
+					float* dst = _disparity + y * _dstride;
+
+					for( size_t x = 0; x < Math::min( _mind, _width ); x++ )
+						dst[ x ] = -1.0f;
+
+					for( size_t x = _mind; x < _width; x++ ) {
+						const uint16_t* s = sum + x * _numd;
+
+						/* only disparities with a partner pixel in the right image */
+						size_t nd = Math::min( _numd, x - _mind + 1 );
+						uint16_t smin = 0xffff;
+						for( size_t d = 0; d < nd; d++ )
+							smin = Math::min( smin, s[ d ] );
+						size_t dmin = 0;
+						while( s[ dmin ] != smin )
+							dmin++;
+
+						float d = dmin;
+						if( _subpixel && dmin > 0 && dmin + 1 < nd ) {
+							float a = s[ dmin - 1 ];
+							float b = s[ dmin ];
+							float c = s[ dmin + 1 ];
+							float denom = a + c - 2.0f * b;
+							if( denom > 0.0f )
+								d += 0.5f * ( a - c ) / denom;
+						}
+						dst[ x ] = d;
+					}
+
+					if( _lrmaxdiff >= 0.0f ) {
+						/* best match of each right pixel, along the diagonal of the volume */
+						for( size_t xr = 0; xr + _mind < _width; xr++ ) {
+							const uint16_t* s = sum + ( xr + _mind ) * _numd;
+							size_t nd = Math::min( _numd, _width - _mind - xr );
+							uint16_t best = 0xffff;
+							int bd = -1;
+							for( size_t d = 0; d < nd; d++, s += _numd + 1 ) {
+								if( *s < best ) {
+									best = *s;
+									bd = d;
+								}
+							}
+							dr[ xr ] = bd;
+						}
+
+						for( size_t x = _mind; x < _width; x++ ) {
+							ssize_t xr = ( ssize_t ) x - ( ssize_t ) _mind - ( ssize_t ) ( dst[ x ] + 0.5f );
+							if( xr < 0 || Math::abs( dst[ x ] - ( float ) dr[ xr ] ) > _lrmaxdiff )
+								dst[ x ] = -1.0f;
+						}
+					}
+
+					for( size_t x = _mind; x < _width; x++ ) {
+						if( dst[ x ] >= 0.0f )
+							dst[ x ] += _mind;
+					}
+				}
+			}
+
+		private:
+			float*			_disparity;
+			size_t			_dstride;
+			const uint16_t* _sum;
+			size_t			_width;
+			size_t			_y0;
+			size_t			_mind;
+			size_t			_numd;
+			bool			_subpixel;
+			float			_lrmaxdiff;
+	};
+
+	void SGMStereo::descriptors( uint64_t* dst, const Image& img ) const
+	{
+		Image gray;
+		const Image* src = &img;
+		if( img.format() != IFormat::GRAY_UINT8 ) {
+			img.convert( gray, IFormat::GRAY_UINT8 );
+			src = &gray;
+		}
+
+		size_t w = src->width();
+		size_t h = src->height();
+		size_t pw = w + 2 * SGM_RX;
+		std::vector<uint8_t> pad( pw * ( h + 2 * SGM_RY ) );
+
+		/* replicated border */
+		size_t stride;
+		const uint8_t* p = src->map( &stride );
+		for( ssize_t y = -SGM_RY; y < ( ssize_t ) h + SGM_RY; y++ ) {
+			const uint8_t* row = p + Math::clamp<ssize_t>( y, 0, h - 1 ) * stride;
+			uint8_t* prow = &pad[ ( y + SGM_RY ) * pw ];
+			memset( prow, row[ 0 ], SGM_RX );
+			memcpy( prow + SGM_RX, row, w );
+			memset( prow + SGM_RX + w, row[ w - 1 ], SGM_RX );
+		}
+		src->unmap( p );
+
+		SGMDescriptor desc( dst, &pad[ 0 ], pw, w, _costType, _brief );
+		ParallelFor::run( desc, 0, h );
+	}
+
+	void SGMStereo::processTile( float* disparity, size_t dstride, const uint64_t* left, const uint64_t* right,
+								 size_t width, size_t y0, size_t y1, size_t out0, size_t out1,
+								 uint8_t* cost, uint16_t* sum ) const
+	{
+		size_t D = _numDisparities;
+		size_t th = y1 - y0;
+		size_t rowsize = width * D;
+		size_t stride = D + 2 * SGM_PATHOFFSET;
+
+		SGMCost costs( cost, left, right, width, y0, _minDisparity, D );
+		ParallelFor::run( costs, 0, th );
+		memset( sum, 0, sizeof( uint16_t ) * th * rowsize );
+
+		/* paths start with the plain matching cost */
+		ScopedBuffer<uint16_t, true> startbuf( stride );
+		_SGMInitPathBuffer( startbuf.ptr(), 1, D, 0 );
+		const uint16_t* start = startbuf.ptr() + SGM_PATHOFFSET;
+
+		SGMHorizontal horizontal( sum, cost, start, width, D, _p1, _p2 );
+		ParallelFor::run( horizontal, 0, th );
+
+		/* vertical and, with 8 paths, the diagonal directions: two row buffers per direction */
+		static const int dirs8[ 3 ] = { 0, -1, 1 };
+		size_t ndirs = _paths == 8 ? 3 : 1;
+		ScopedBuffer<uint16_t, true> pathbuf( 2 * ndirs * width * stride );
+		ScopedBuffer<uint16_t, true> minbuf( 2 * ndirs * width );
+		_SGMInitPathBuffer( pathbuf.ptr(), 2 * ndirs * width, D, 0 );
+		uint16_t* rows[ 2 ][ 3 ];
+		uint16_t* mins[ 2 ][ 3 ];
+		for( size_t i = 0; i < 2; i++ ) {
+			for( size_t k = 0; k < ndirs; k++ ) {
+				rows[ i ][ k ] = pathbuf.ptr() + ( i * ndirs + k ) * width * stride + SGM_PATHOFFSET;
+				mins[ i ][ k ] = minbuf.ptr() + ( i * ndirs + k ) * width;
+			}
+		}
+
+		SGMColumnStep step( width, D, ndirs, dirs8, start, _p1, _p2 );
+		for( size_t pass = 0; pass < 2; pass++ ) {
+			for( size_t i = 0; i < th; i++ ) {
+				/* downwards, then upwards with the mirrored diagonals */
+				size_t y = pass ? th - 1 - i : i;
+				size_t cur = i & 1;
+				step.setRow( sum + y * rowsize, cost + y * rowsize, i == 0, rows[ cur ], rows[ cur ^ 1 ], mins[ cur ], mins[ cur ^ 1 ] );
+				ParallelFor::run( step, 0, width );
+			}
+		}
+
+		SGMSelect select( disparity, dstride, sum, width, y0, _minDisparity, D, _subpixel, _lrMaxDiff );
+		ParallelFor::run( select, out0, out1 );
+	}
+
+	void SGMStereo::disparityMap( Image& disparity, const Image& left, const Image& right ) const
+	{
+		size_t w = left.width();
+		size_t h = left.height();
+		size_t D = _numDisparities;
+
+		if( right.width() != w || right.height() != h )
+			throw CVTException( "Left and right image dimensions differ" );
+		if( !w || !h )
+			return;
+
+		_leftDesc.resize( w * h );
+		_rightDesc.resize( w * h );
+		descriptors( &_leftDesc[ 0 ], left );
+		descriptors( &_rightDesc[ 0 ], right );
+
+		/* rows per tile from the memory bound for the cost and sum volumes, exceeded for tiny bounds */
+		size_t rowbytes = w * D * ( sizeof( uint8_t ) + sizeof( uint16_t ) );
+		size_t tilerows = Math::max( _maxMemory / rowbytes, 2 * _tileOverlap + 16 );
+		size_t core = tilerows - 2 * _tileOverlap;
+		if( tilerows >= h ) {
+			tilerows = h;
+			core = h;
+		}
+
+		allocVolumes( tilerows * w * D );
+
+		disparity.reallocate( w, h, IFormat::GRAY_FLOAT );
+		size_t dstride;
+		float* pdisp = disparity.map<float>( &dstride );
+		try {
+			for( size_t out0 = 0; out0 < h; out0 += core ) {
+				size_t out1 = Math::min( out0 + core, h );
+				size_t y0 = out0 > _tileOverlap ? out0 - _tileOverlap : 0;
+				size_t y1 = Math::min( out1 + _tileOverlap, h );
+				if( core == h ) {
+					y0 = 0;
+					y1 = h;
+				}
+				processTile( pdisp, dstride, &_leftDesc[ 0 ], &_rightDesc[ 0 ], w, y0, y1, out0, out1, _costVolume, _sumVolume );
+			}
+		} catch( ... ) {
+			disparity.unmap( pdisp );
+			throw;
+		}
+		disparity.unmap( pdisp );
+	}
+
+}
@@ -0,0 +1,109 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SGMSTEREO_H
+#define CVT_SGMSTEREO_H
+
+#include <cvt/gfx/Image.h>
+
+#include <vector>
+
+namespace cvt {
+
+	/*
+	   Dense stereo with semi-global matching on the CPU.
+	   The matching cost is the hamming distance of census or BRIEF-style
+	   descriptors, aggregated along 4 or 8 path directions in 16 bit.
+	   Input are rectified image pairs, e.g. from StereoRectification.
+	 */
+	class SGMStereo {
+		public:
+			enum MatchingCost {
+				SGM_CENSUS,	/* 9x7 census transform */
+				SGM_BRIEF	/* 64 fixed pairwise tests in a 9x9 window */
+			};
+
+			SGMStereo( size_t numDisparities = 128, size_t minDisparity = 0 );
+			~SGMStereo();
+
+			/* the number of disparities is rounded up to a multiple of 16 */
+			void			setDisparityRange( size_t minDisparity, size_t numDisparities );
+			size_t			minDisparity() const { return _minDisparity; }
+			size_t			numDisparities() const { return _numDisparities; }
+
+			/* penalties for disparity changes of one and of more than one */
+			void			setPenalties( uint16_t p1, uint16_t p2 );
+			void			setMatchingCost( MatchingCost cost ) { _costType = cost; }
+			/* 4 or 8 path directions */
+			void			setPaths( size_t paths );
+			/* maximal difference of the left and right disparity, negative values disable the check */
+			void			setLeftRightCheck( float maxdiff ) { _lrMaxDiff = maxdiff; }
+			void			setSubpixel( bool subpixel ) { _subpixel = subpixel; }
+			/*
+			   bound in bytes for the cost and aggregation volumes, larger volumes are processed in
+			   row tiles that overlap by tileOverlap rows. The bound is soft: a tile has at least
+			   2 * tileOverlap + 16 rows, and the descriptors of both images are not included.
+			 */
+			void			setMaxMemory( size_t bytes, size_t tileOverlap = 32 );
+
+			/*
+			   disparities of the left image as GRAY_FLOAT, the right pixel of x is x - disparity.
+			   Invalid pixels are set to a negative value. The volumes are kept between calls,
+			   one instance must not be used from several threads at once.
+			 */
+			void			disparityMap( Image& disparity, const Image& left, const Image& right ) const;
+
+		private:
+			SGMStereo( const SGMStereo& );
+			SGMStereo& operator=( const SGMStereo& );
+
+			void			descriptors( uint64_t* dst, const Image& img ) const;
+			void			processTile( float* disparity, size_t dstride, const uint64_t* left, const uint64_t* right,
+										 size_t width, size_t y0, size_t y1, size_t out0, size_t out1,
+										 uint8_t* cost, uint16_t* sum ) const;
+			void			allocVolumes( size_t size ) const;
+
+			size_t			_minDisparity;
+			size_t			_numDisparities;
+			uint16_t		_p1;
+			uint16_t		_p2;
+			MatchingCost	_costType;
+			size_t			_paths;
+			float			_lrMaxDiff;
+			bool			_subpixel;
+			size_t			_maxMemory;
+			size_t			_tileOverlap;
+			int8_t			_brief[ 64 ][ 4 ];
+
+			mutable std::vector<uint64_t>	_leftDesc;
+			mutable std::vector<uint64_t>	_rightDesc;
+			mutable uint8_t*				_costVolume;
+			mutable uint16_t*				_sumVolume;
+			mutable size_t					_volumeSize;
+	};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/SGMStereo.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/RNG.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	/* random texture with a square in front of a plane, right( x ) = left( x + disparity ) */
+	static void _sgmStereoPair( Image& left, Image& right, Image& truth, size_t w, size_t h )
+	{
+		RNG rng( 42 );
+		std::vector<uint8_t> tex( ( w + 64 ) * h );
+		for( size_t i = 0; i < tex.size(); i++ )
+			tex[ i ] = rng.uint32( 256 );
+
+		left.reallocate( w, h, IFormat::GRAY_UINT8 );
+		right.reallocate( w, h, IFormat::GRAY_UINT8 );
+		truth.reallocate( w, h, IFormat::GRAY_FLOAT );
+
+		IMapScoped<uint8_t> l( left );
+		IMapScoped<uint8_t> r( right );
+		IMapScoped<float> t( truth );
+		for( size_t y = 0; y < h; y++ ) {
+			for( size_t x = 0; x < w; x++ ) {
+				bool front = x > w / 3 && x < 2 * w / 3 && y > h / 4 && y < 3 * h / 4;
+				l.ptr()[ x ] = tex[ y * ( w + 64 ) + x + 32 ];
+				t.ptr()[ x ] = front ? 20.0f : 8.0f;
+			}
+			for( size_t x = 0; x < w; x++ ) {
+				/* the square occludes the plane */
+				bool front = x + 20 > w / 3 && x + 20 < 2 * w / 3 && y > h / 4 && y < 3 * h / 4;
+				r.ptr()[ x ] = tex[ y * ( w + 64 ) + x + 32 + ( front ? 20 : 8 ) ];
+			}
+			l++;
+			r++;
+			t++;
+		}
+	}
+
+	/* fraction of the valid pixels within one pixel of the truth and the fraction of valid pixels */
+	static void _sgmStereoCheck( float& good, float& valid, const Image& disparity, const Image& truth )
+	{
+		IMapScoped<const float> d( disparity );
+		IMapScoped<const float> t( truth );
+		size_t ngood = 0, nvalid = 0, n = 0;
+		for( size_t y = 0; y < disparity.height(); y++ ) {
+			for( size_t x = 32; x < disparity.width(); x++ ) {
+				n++;
+				if( d.ptr()[ x ] < 0.0f )
+					continue;
+				nvalid++;
+				if( Math::abs( d.ptr()[ x ] - t.ptr()[ x ] ) <= 1.0f )
+					ngood++;
+			}
+			d++;
+			t++;
+		}
+		good = nvalid ? ( float ) ngood / ( float ) nvalid : 0.0f;
+		valid = ( float ) nvalid / ( float ) n;
+	}
+
+	static bool _sgmStereoTest( SGMStereo& sgm, const Image& left, const Image& right, const Image& truth, Image& disparity )
+	{
+		float good, valid;
+		sgm.disparityMap( disparity, left, right );
+		_sgmStereoCheck( good, valid, disparity, truth );
+		return disparity.format() == IFormat::GRAY_FLOAT && good > 0.9f && valid > 0.8f;
+	}
+
+	/* fraction of the pixels where both maps are invalid or within one pixel */
+	static float _sgmStereoAgreement( const Image& a, const Image& b )
+	{
+		IMapScoped<const float> ma( a );
+		IMapScoped<const float> mb( b );
+		size_t n = 0;
+		for( size_t y = 0; y < a.height(); y++ ) {
+			for( size_t x = 0; x < a.width(); x++ ) {
+				float da = ma.ptr()[ x ];
+				float db = mb.ptr()[ x ];
+				if( ( da < 0.0f && db < 0.0f ) || ( da >= 0.0f && db >= 0.0f && Math::abs( da - db ) <= 1.0f ) )
+					n++;
+			}
+			ma++;
+			mb++;
+		}
+		return ( float ) n / ( float ) ( a.width() * a.height() );
+	}
+
+BEGIN_CVTTEST( SGMStereo )
+	bool result = true;
+	bool b;
+	Image left, right, truth, disparity, untiled, tiled;
+
+	_sgmStereoPair( left, right, truth, 160, 120 );
+
+	SGMStereo sgm( 32 );
+
+	b = _sgmStereoTest( sgm, left, right, truth, untiled );
+	CVTTEST_PRINT( "census, 8 paths", b );
+	result &= b;
+
+	sgm.setPaths( 4 );
+	b = _sgmStereoTest( sgm, left, right, truth, disparity );
+	CVTTEST_PRINT( "census, 4 paths", b );
+	result &= b;
+
+	sgm.setPaths( 8 );
+	sgm.setMatchingCost( SGMStereo::SGM_BRIEF );
+	b = _sgmStereoTest( sgm, left, right, truth, disparity );
+	CVTTEST_PRINT( "BRIEF, 8 paths", b );
+	result &= b;
+
+	/* tiles of 16 + 2 * 8 rows, the paths are cut at the tile borders only */
+	sgm.setMatchingCost( SGMStereo::SGM_CENSUS );
+	sgm.setMaxMemory( 1, 8 );
+	b = _sgmStereoTest( sgm, left, right, truth, tiled );
+	b &= _sgmStereoAgreement( tiled, untiled ) > 0.98f;
+	CVTTEST_PRINT( "tiled", b );
+	result &= b;
+
+	sgm.setDisparityRange( 4, 20 );
+	b = _sgmStereoTest( sgm, left, right, truth, disparity );
+	CVTTEST_PRINT( "minimal disparity", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}
@@ -29,6 +29,7 @@
 #include <cvt/math/Math.h>
 #include <cvt/math/SE3.h>
 #include <cvt/vision/Vision.h>
+#include <cvt/util/Profiler.h>
 
 #include <cstring>
 
@@ -72,6 +73,7 @@ namespace cvt {
 
     void SparseBundleAdjustment::optimize( SlamMap & map, const TerminationCriteria<double> & criteria )
     {
+        CVT_PROFILE_ZONE( "SparseBundleAdjustment::optimize" );
         _iterations = 0;
         _costs	    = 0.0;
 
@@ -99,8 +101,11 @@ namespace cvt {
                 solver.analyzePattern( _sparseReduced );
             }
 
-            solver.factorize( _sparseReduced );
-            deltaCam = solver.solve( _reducedRHS );
+            {
+                CVT_PROFILE_ZONE( "SparseBundleAdjustment::solve" );
+                solver.factorize( _sparseReduced );
+                deltaCam = solver.solve( _reducedRHS );
+            }
 
             // safety check on computed delta
             if( _vectorHasNaNOrInf( deltaCam ) ){
@@ -116,7 +121,8 @@ namespace cvt {
             lastCosts = _costs;
             solveStructure( deltaPoint, deltaCam, map );
 
-            std::cout << "Iteration: " << _iterations << " LastCosts: " << lastCosts << ", CurrentCosts: " << _costs << ", lambda: " << _lambda << std::endl;
+            CVT_PROFILE_COUNTER( "SparseBundleAdjustment::costs", _costs );
+            CVT_PROFILE_COUNTER( "SparseBundleAdjustment::lambda", _lambda );
 
             if( _costs < lastCosts ){
                 // step was good -> update lambda and do next step
@@ -142,10 +148,12 @@ namespace cvt {
             }
 
         }
+        CVT_PROFILE_HISTOGRAM( "SparseBundleAdjustment::iterations", _iterations );
     }
 
     void SparseBundleAdjustment::buildReducedCameraSystem( const SlamMap & map )
     {
+        CVT_PROFILE_ZONE( "SparseBundleAdjustment::buildReducedCameraSystem" );
         evaluateApproxHessians( map );
         updateInverseAugmentedPointHessians();
 
@@ -406,6 +414,7 @@ namespace cvt {
                                                  const Eigen::VectorXd & deltaCam,
                                                  SlamMap & map )
     {
+        CVT_PROFILE_ZONE( "SparseBundleAdjustment::solveStructure" );
         size_t nPts = map.numFeatures();
         Eigen::Vector3d res;
         Eigen::Vector3d tmp;
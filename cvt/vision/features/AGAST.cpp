@@ -28,6 +28,7 @@
 #include <cvt/vision/features/agast/Agast5_8.h>
 #include <cvt/vision/features/agast/Agast7_12d.h>
 #include <cvt/vision/features/agast/Agast7_12s.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -52,15 +53,18 @@ namespace cvt
 
     void AGAST::detect( FeatureSet& features, const Image& img )
     {
+        CVT_PROFILE_ZONE( "AGAST::detect" );
         if( img.format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
         FeatureSetWrapper fset( features );
         _astDetector->detect( img, _threshold, fset, _border );
+        CVT_PROFILE_HISTOGRAM( "AGAST::features", features.size() );
     }
 
     void AGAST::detect( FeatureSet& featureSet, const ImagePyramid& imgpyr )
     {
+        CVT_PROFILE_ZONE( "AGAST::detect" );
         if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
             throw CVTException( "Input Image format must be GRAY_UINT8" );
 
@@ -69,6 +73,7 @@ namespace cvt
             FeatureSetWrapper features( featureSet, cscale, coctave );
             _astDetector->detect( imgpyr[ coctave ], _threshold, features, _border );
         }
+        CVT_PROFILE_HISTOGRAM( "AGAST::features", featureSet.size() );
     }
 
 }
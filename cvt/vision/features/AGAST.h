@@ -43,6 +43,8 @@ namespace cvt {
             AGAST( ASTType astType, uint8_t threshold = 30, size_t border = 3 );
             ~AGAST();
 
+            AGAST* clone() const { return new AGAST( _astType, _threshold, _border ); }
+
             void detect( FeatureSet& features, const Image& image );
             void detect( FeatureSet& features, const ImagePyramid& image );
 
@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Profiler.h>
 #include <cvt/vision/ImagePyramid.h>
 #include <cvt/vision/features/FeatureSet.h>
 #include <cvt/vision/features/FeatureDescriptor.h>
@@ -170,6 +171,7 @@ namespace cvt {
 	template<size_t N>
     inline void BRIEF<N>::extract( const ImagePyramid& pyr, const FeatureSet& features )
     {
+        CVT_PROFILE_ZONE( "BRIEF::extract" );
         if( pyr[ 0 ].channels() != 1 || ( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
             throw CVTException( "Unimplemented" );
 
@@ -182,6 +184,7 @@ namespace cvt {
 	template<size_t N>
 	inline void BRIEF<N>::extract( const Image& img, const FeatureSet& features )
 	{
+		CVT_PROFILE_ZONE( "BRIEF::extract" );
 		if( img.channels() != 1 || ( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
 			throw CVTException( "Unimplemented" );
 
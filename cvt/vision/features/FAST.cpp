@@ -24,6 +24,7 @@
 
 #include <cvt/vision/features/FAST.h>
 #include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt
 {
@@ -41,6 +42,7 @@ namespace cvt
 
 	void FAST::detect( FeatureSet& featureset, const Image& img )
 	{
+		CVT_PROFILE_ZONE( "FAST::detect" );
 		if( img.format() != IFormat::GRAY_UINT8 )
 			throw CVTException( "Input Image format must be GRAY_UINT8" );
 
@@ -63,10 +65,12 @@ namespace cvt
 				throw CVTException( "Unkown FAST size" );
 				break;
 		}
+		CVT_PROFILE_HISTOGRAM( "FAST::features", featureset.size() );
 	}
 
 	void FAST::detect( FeatureSet& featureset, const ImagePyramid& imgpyr )
 	{
+		CVT_PROFILE_ZONE( "FAST::detect" );
 		if( imgpyr[ 0 ].format() != IFormat::GRAY_UINT8 )
 			throw CVTException( "Input Image format must be GRAY_UINT8" );
 
@@ -92,6 +96,7 @@ namespace cvt
 					break;
 			}
 		}
+		CVT_PROFILE_HISTOGRAM( "FAST::features", featureset.size() );
 	}
 
 	inline void FAST::detect9( const Image& img, uint8_t threshold, FeatureSetWrapper& features, size_t border )
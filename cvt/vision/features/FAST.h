@@ -48,6 +48,8 @@ namespace cvt
 			FAST( FASTSize size = SEGMENT_9, uint8_t threshold = 30, size_t border = 3 );
 			~FAST();
 
+			FAST* clone() const { return new FAST( _fastSize, _threshold, _border ); }
+
 			void detect( FeatureSet& features, const Image& image );
 			void detect( FeatureSet& features, const ImagePyramid& image );
 
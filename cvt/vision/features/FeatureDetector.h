@@ -35,6 +35,7 @@ namespace cvt {
 	{
 		public:
 			virtual ~FeatureDetector() {}
+			virtual FeatureDetector* clone() const = 0;
 			virtual void detect( FeatureSet& set, const Image& img ) = 0;
 			virtual void detect( FeatureSet& set, const ImagePyramid& imgpyr) = 0;
 
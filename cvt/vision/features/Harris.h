@@ -30,6 +30,7 @@
 #include <cvt/gfx/ifilter/BoxFilter.h>
 #include <cvt/gfx/IMapScoped.h>
 #include <cvt/util/ScopedBuffer.h>
+#include <cvt/util/Profiler.h>
 
 
 namespace cvt
@@ -40,6 +41,8 @@ namespace cvt
 			Harris( float threshold = 5e-5f, size_t border = 3 );
 			~Harris();
 
+			Harris* clone() const { return new Harris( _threshold, _border ); }
+
 			void detect( FeatureSet& features, const Image& image );
 			void detect( FeatureSet& features, const ImagePyramid& image );
 
@@ -72,6 +75,7 @@ namespace cvt
 
 	inline void Harris::detect( FeatureSet& features, const Image& image )
 	{
+		CVT_PROFILE_ZONE( "Harris::detect" );
 		if( image.format() == IFormat::GRAY_FLOAT )
 			detectFloat( features, image );
 		else if( image.format() == IFormat::GRAY_UINT8 )
@@ -79,6 +83,7 @@ namespace cvt
 		else
 			throw CVTException( "Input Image format must be GRAY_FLOAT or GRAY_UINT8" );
 
+		CVT_PROFILE_HISTOGRAM( "Harris::features", features.size() );
 	}
 
 	inline void Harris::detectFloat( FeatureSet& features, const Image& image )
@@ -26,6 +26,7 @@
 #define CVT_FEATURE_MATCHER_INL
 
 #include <cvt/vision/features/RowLookupTable.h>
+#include <cvt/util/Profiler.h>
 
 namespace cvt {
 
@@ -33,6 +34,7 @@ namespace cvt {
 		template<typename T, typename DFUNC>
 		static inline void matchBruteForce( std::vector<FeatureMatch>& matches, const std::vector<T>& seta, const std::vector<T>& setb, DFUNC dfunc, float distThreshold )
 		{
+			CVT_PROFILE_ZONE( "FeatureMatcher::matchBruteForce" );
 			matches.reserve( seta.size() );
 			for( size_t i = 0; i < seta.size(); i++ ) {
 				FeatureMatch m;
@@ -64,6 +66,7 @@ namespace cvt {
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
+			CVT_PROFILE_ZONE( "FeatureMatcher::matchInWindow" );
 			matches.reserve( setA.size() );
 			MatchingIndices m;
 			float distanceSquare = Math::sqr( maxFeatureDist );
@@ -103,6 +106,7 @@ namespace cvt {
 										  float maxFeatureDist,
 										  float maxDescDistance )
 		{
+			CVT_PROFILE_ZONE( "FeatureMatcher::matchInWindow" );
 			matches.reserve( setA.size() );
 			MatchingIndices m;
 			for( size_t i = 0; i < setA.size(); ++i ) {
@@ -154,6 +158,7 @@ namespace cvt {
 										  float maxDescDist,
 										  float maxLineDist )
 		{
+			CVT_PROFILE_ZONE( "FeatureMatcher::scanLineMatch" );
 			matches.reserve( left.size() );
 			FeatureMatch m;
 			for( size_t i = 0; i < left.size(); ++i ){
@@ -195,6 +200,7 @@ namespace cvt {
                                           float maxDescDist,
                                           float maxLineDist )
         {
+            CVT_PROFILE_ZONE( "FeatureMatcher::scanLineMatch" );
             matches.reserve( left.size() );
             FeatureMatch m;
             for( size_t i = 0; i < left.size(); ++i ){
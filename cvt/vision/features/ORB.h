@@ -27,6 +27,7 @@
 
 #include <cvt/gfx/Image.h>
 #include <cvt/gfx/IMapScoped.h>
+#include <cvt/util/Profiler.h>
 #include <cvt/vision/ImagePyramid.h>
 #include <cvt/vision/IntegralImage.h>
 #include <cvt/vision/features/FeatureSet.h>
@@ -41,7 +42,11 @@ namespace cvt {
 		public:
 			typedef FeatureDescriptorInternal<32, uint8_t, FEATUREDESC_CMP_HAMMING> Descriptor;
 
-			ORB();
+			/**
+			 * \param precision	accumulation type of the integral images, the integer
+			 *					variants are exact for GRAY_UINT8 images of any size
+			 */
+			ORB( IntegralImagePrecision precision = INTEGRAL_FLOAT );
 			ORB( const ORB& orb );
 			~ORB();
 
@@ -93,22 +98,40 @@ namespace cvt {
 				SIMD* _simd;
 			};
 
-			float centroidAngle( const Vector2f& pt, const IMapScoped<const float>& map );
-			void descriptor( Descriptor& feature, const Vector2f& pt, const IMapScoped<const float>& map );
+			/* box sums on a mapped float integral image */
+			struct FloatIntegralMap {
+				FloatIntegralMap( const Image& img ) : map( img ) {}
+				float area( int x, int y, int w, int h ) const { return IntegralImage::area( map, x, y, w, h ); }
+				IMapScoped<const float> map;
+			};
+
+			template<typename TABLE>
+			void extractFromTables( const std::vector<const TABLE*>& tables, const std::vector<float>& scales, const FeatureSet& features );
+			template<typename TABLE>
+			void extractFromTable( const TABLE& table, const FeatureSet& features );
+			template<typename T>
+			void extractExact( const ImagePyramid& pyr, const FeatureSet& features );
+
+			template<typename TABLE>
+			float centroidAngle( const Vector2f& pt, const TABLE& table );
+			template<typename TABLE>
+			void descriptor( Descriptor& feature, const Vector2f& pt, const TABLE& table );
 
 			static const int		_patterns[ 30 ][ 512 ][ 2 ];
 			static const int		_circularoffset[ 31 ];
 
 			std::vector<Descriptor> _features;
+			IntegralImagePrecision	_precision;
 	};
 
-	inline ORB::ORB()
+	inline ORB::ORB( IntegralImagePrecision precision ) : _precision( precision )
 	{
 	}
 
 	inline ORB::ORB( const ORB& orb ) :
 		FeatureDescriptorExtractor(),
-		_features( orb._features )
+		_features( orb._features ),
+		_precision( orb._precision )
 	{
 	}
 
@@ -123,7 +146,7 @@ namespace cvt {
 
 	inline ORB*	ORB::clone() const
 	{
-		ORB* ocopy = new ORB();
+		ORB* ocopy = new ORB( _precision );
 		ocopy->_features = _features;
 		return ocopy;
 	}
@@ -145,21 +168,60 @@ namespace cvt {
 
 	inline void ORB::extract( const ImagePyramid& pyr, const FeatureSet& features )
 	{
+		CVT_PROFILE_ZONE( "ORB::extract" );
+		CVT_PROFILE_HISTOGRAM( "ORB::descriptors", features.size() );
+
 		if( pyr[ 0 ].channels() != 1 ||
 			( pyr[ 0 ].format() != IFormat::GRAY_UINT8 && pyr[ 0 ].format() != IFormat::GRAY_FLOAT ) )
 			throw CVTException( "Unimplemented" );
 
+		// exact integer tables need uint8 input, float images use double tables
+		if( _precision != INTEGRAL_FLOAT ) {
+			if( pyr[ 0 ].format() == IFormat::GRAY_FLOAT || _precision == INTEGRAL_DOUBLE )
+				extractExact<double>( pyr, features );
+			else if( _precision == INTEGRAL_UINT32 )
+				extractExact<uint32_t>( pyr, features );
+			else
+				extractExact<uint64_t>( pyr, features );
+			return;
+		}
+
 		ImagePyramid integralPyr( pyr.octaves(), pyr.scaleFactor() );
 		pyr.integralImage( integralPyr );
 
 		size_t octaves = pyr.octaves();
-		std::vector<IMapScoped<const float>*> maps;
+		std::vector<const FloatIntegralMap*> maps;
 		std::vector<float> scales;
 		for( size_t i = 0; i < octaves; ++i ){
-			maps.push_back( new IMapScoped<const float>( integralPyr[ i ] ) );
+			maps.push_back( new FloatIntegralMap( integralPyr[ i ] ) );
 			scales.push_back( Math::pow( integralPyr.scaleFactor(), ( float )i ) );
 		}
 
+		extractFromTables( maps, scales, features );
+
+		for( size_t i = 0; i < octaves; ++i ){
+			delete maps[ i ];
+		}
+	}
+
+	template<typename T>
+	inline void ORB::extractExact( const ImagePyramid& pyr, const FeatureSet& features )
+	{
+		size_t octaves = pyr.octaves();
+		std::vector<IntegralTable<T> > tables( octaves );
+		std::vector<const IntegralTable<T>*> ptrs;
+		std::vector<float> scales;
+		for( size_t i = 0; i < octaves; ++i ){
+			tables[ i ].update( pyr[ i ] );
+			ptrs.push_back( &tables[ i ] );
+			scales.push_back( Math::pow( pyr.scaleFactor(), ( float )i ) );
+		}
+		extractFromTables( ptrs, scales, features );
+	}
+
+	template<typename TABLE>
+	inline void ORB::extractFromTables( const std::vector<const TABLE*>& tables, const std::vector<float>& scales, const FeatureSet& features )
+	{
 		size_t iend = features.size();
 		Vector2f vs;
 		for( size_t i = 0; i < iend; ++i ) {
@@ -168,34 +230,56 @@ namespace cvt {
 			size_t o = desc.octave;
 			vs = desc.pt * scales[ o ];
 
-			desc.angle = centroidAngle( vs, *maps[ o ] );
-			descriptor( desc, vs, *maps[ o ] );
-		}
-
-		for( size_t i = 0; i < octaves; ++i ){
-			delete maps[ i ];
+			desc.angle = centroidAngle( vs, *tables[ o ] );
+			descriptor( desc, vs, *tables[ o ] );
 		}
 	}
 
 	inline void ORB::extract( const Image& img, const FeatureSet& features )
 	{
+		CVT_PROFILE_ZONE( "ORB::extract" );
+		CVT_PROFILE_HISTOGRAM( "ORB::descriptors", features.size() );
+
 		if( img.channels() != 1 ||
 			( img.format() != IFormat::GRAY_UINT8 && img.format() != IFormat::GRAY_FLOAT ) )
 			throw CVTException( "Unimplemented" );
 
+		if( _precision != INTEGRAL_FLOAT ) {
+			if( img.format() == IFormat::GRAY_FLOAT || _precision == INTEGRAL_DOUBLE ) {
+				IntegralTable<double> table;
+				table.update( img );
+				extractFromTable( table, features );
+			} else if( _precision == INTEGRAL_UINT32 ) {
+				IntegralTable<uint32_t> table;
+				table.update( img );
+				extractFromTable( table, features );
+			} else {
+				IntegralTable<uint64_t> table;
+				table.update( img );
+				extractFromTable( table, features );
+			}
+			return;
+		}
+
 		IntegralImage iimage( img );
-		IMapScoped<const float> map( iimage.sumImage() );
+		FloatIntegralMap map( iimage.sumImage() );
+		extractFromTable( map, features );
+	}
 
+	template<typename TABLE>
+	inline void ORB::extractFromTable( const TABLE& table, const FeatureSet& features )
+	{
 		size_t iend = features.size();
 		for( size_t i = 0; i < iend; ++i ) {
 			_features.push_back( Descriptor( features[ i ] ) );
 			Descriptor& desc = _features.back();
-			desc.angle = centroidAngle( desc.pt, map );
-			descriptor( desc, desc.pt, map );
+			desc.angle = centroidAngle( desc.pt, table );
+			descriptor( desc, desc.pt, table );
 		}
 	}
 
-	inline float ORB::centroidAngle( const Vector2f& pt, const IMapScoped<const float>& map )
+	template<typename TABLE>
+	inline float ORB::centroidAngle( const Vector2f& pt, const TABLE& table )
 	{
 		float mx = 0;
 		float my = 0;
@@ -205,15 +289,15 @@ namespace cvt {
 		int curx = ( int ) pt.x;
 
 		for( int i = 0; i < 15; i++ ) {
-			mx +=( ( float ) i - 15.0f ) * ( IntegralImage::area( map, curx - _circularoffset[ i ], cury + i, 2 * _circularoffset[ i ] + 1, 1 )
-										   - IntegralImage::area( map, curx - _circularoffset[ i ], cury + 30 - i, 2 * _circularoffset[ i ] + 1, 1) );
+			mx +=( ( float ) i - 15.0f ) * ( ( float ) table.area( curx - _circularoffset[ i ], cury + i, 2 * _circularoffset[ i ] + 1, 1 )
+										   - ( float ) table.area( curx - _circularoffset[ i ], cury + 30 - i, 2 * _circularoffset[ i ] + 1, 1) );
 		}
 
 		cury = ( int ) pt.y;
 		curx = ( int ) pt.x - 15;
 		for( int i = 0; i < 15; i++ ) {
-			my += ( ( float ) i - 15.0f ) * ( IntegralImage::area( map, curx + i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 )
-											- IntegralImage::area( map, curx + 30 - i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 ) );
+			my += ( ( float ) i - 15.0f ) * ( ( float ) table.area( curx + i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 )
+											- ( float ) table.area( curx + 30 - i, cury - _circularoffset[ i ], 1, 2 * _circularoffset[ i ] + 1 ) );
 		}
 
 		angle = Math::atan2( my, mx );
@@ -227,7 +311,8 @@ namespace cvt {
 		return angle;
 	}
 
-	inline void ORB::descriptor( Descriptor& feature, const Vector2f& pt, const IMapScoped<const float>& map )
+	template<typename TABLE>
+	inline void ORB::descriptor( Descriptor& feature, const Vector2f& pt, const TABLE& table )
 	{
 		size_t index = ( size_t ) ( feature.angle * 30.0f / Math::TWO_PI );
 		if( index >= 30 )
@@ -236,9 +321,9 @@ namespace cvt {
 		int y = ( int ) pt.y;
 
 
-#define ORBTEST( n ) ( IntegralImage::area( map, x + _patterns[ index ][ ( n ) * 2 ][ 0 ] - 2,\
+#define ORBTEST( n ) ( table.area( x + _patterns[ index ][ ( n ) * 2 ][ 0 ] - 2,\
 										         y + _patterns[ index ][ ( n ) * 2 ][ 1 ] - 2, 5, 5 ) < \
-					   IntegralImage::area( map, x + _patterns[ index ][ ( n ) * 2 + 1 ][ 0 ] - 2,\
+					   table.area( x + _patterns[ index ][ ( n ) * 2 + 1 ][ 0 ] - 2,\
 										         y + _patterns[ index ][ ( n ) * 2 + 1 ][ 1 ] - 2, 5, 5 ) )
 		int idx;
 		for( int i = 0; i < 32; i++ ) {
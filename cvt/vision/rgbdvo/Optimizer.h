@@ -30,6 +30,7 @@
 #include <cvt/vision/rgbdvo/SystemBuilder.h>
 #include <cvt/vision/rgbdvo/ApproxMedian.h>
 #include <cvt/vision/rgbdvo/ErrorLogger.h>
+#include <cvt/util/Profiler.h>
 #include <Eigen/LU>
 
 namespace cvt {
@@ -128,6 +129,7 @@ namespace cvt {
     inline void Optimizer<Derived>::optimize( Result& result,
                                               CostFunction<Derived> &costFunc )
     {
+        CVT_PROFILE_ZONE( "Optimizer::optimize" );
         result.costs = 0.0f;
         result.iterations = 0;
         result.numPixels = 0;
@@ -31,6 +31,7 @@
 #include <cvt/util/Signal.h>
 #include <cvt/util/CVTAssert.h>
 #include <cvt/util/ConfigFile.h>
+#include <cvt/util/Profiler.h>
 
 #include <cvt/vision/rgbdvo/RGBDKeyframe.h>
 #include <cvt/vision/rgbdvo/Optimizer.h>
@@ -202,6 +203,7 @@ namespace cvt {
                                                          const Image& gray,
                                                          const Image& depth )
     {
+        CVT_PROFILE_ZONE( "RGBDVisualOdometry::updatePose" );
         CVT_ASSERT( ( gray.format()  == IFormat::GRAY_FLOAT ), "Gray image format has to be GRAY_FLOAT" );
         CVT_ASSERT( ( depth.format() == IFormat::GRAY_FLOAT ), "Depth image format has to be GRAY_FLOAT" );
         _costFunc->setInput( gray, depth );
@@ -209,6 +211,8 @@ namespace cvt {
         //_optimizer->optimizeMultiframe( _lastResult, pose, &_keyframes[ 0 ], _keyframes.size(), _pyramid, depth );
         _costFunc->setPose( pose );
         _optimizer->optimize( _lastResult, *_costFunc );
+        CVT_PROFILE_HISTOGRAM( "RGBDVisualOdometry::iterations", _lastResult.iterations );
+        CVT_PROFILE_HISTOGRAM( "RGBDVisualOdometry::pixels", _lastResult.numPixels );
 
         _currentPose = _costFunc->pose();
 
@@ -223,6 +227,7 @@ namespace cvt {
     template <class Derived>
     inline void RGBDVisualOdometry<Derived>::addNewKeyframe()
     {
+        CVT_PROFILE_ZONE( "RGBDVisualOdometry::addNewKeyframe" );
         _costFunc->updateOfflineData( );
         _numCreated++;
 
@@ -87,6 +87,41 @@ namespace cvt
 
 	}
 
+	FlatSLAMMap::FlatSLAMMap( const SlamMapFile& file )
+	{
+		_features.resize( file.numFeatures( ) );
+		for( size_t i = 0; i < _features.size( ); i++ ) {
+			const SlamMapFeature& f = file.feature( i );
+			_features[ i ].set( f.point[ 0 ], f.point[ 1 ], f.point[ 2 ], f.point[ 3 ] );
+		}
+
+		_cameras.resize( file.numKeyframes( ) );
+		for( size_t i = 0; i < _cameras.size( ); i++ ) {
+			const double* pose = file.keyframe( i ).pose;
+			for( size_t r = 0; r < 4; r++ )
+				for( size_t c = 0; c < 4; c++ )
+					_cameras[ i ][ r ][ c ] = pose[ r * 4 + c ];
+		}
+
+		cvt::Matrix3f K;
+		for( size_t r = 0; r < 3; r++ )
+			for( size_t c = 0; c < 3; c++ )
+				K[ r ][ c ] = file.intrinsics( )[ r * 3 + c ];
+		_intrinsics.push_back( K );
+
+		// measurements are stored in keyframe order
+		_measurementCounter = file.numMeasurements( );
+		_measurements2D.resize( _measurementCounter );
+		_camIdx.resize( _measurementCounter );
+		_featIdx.resize( _measurementCounter );
+		for( size_t i = 0; i < _measurementCounter; i++ ) {
+			const SlamMapMeasurement& m = file.measurement( i );
+			_measurements2D[ i ].set( m.point[ 0 ], m.point[ 1 ] );
+			_camIdx[ i ] = m.keyframe;
+			_featIdx[ i ] = m.feature;
+		}
+	}
+
 	FlatSLAMMap::~FlatSLAMMap( ){}
 
 } //namespace cvt
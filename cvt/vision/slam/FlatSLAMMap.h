@@ -26,6 +26,7 @@
 #define FLATSLAMMAP_H
 
 #include <cvt/vision/slam/SlamMap.h>
+#include <cvt/vision/slam/SlamMapFile.h>
 
 #include <cvt/math/Vector.h>
 #include <cvt/util/EigenBridge.h>
@@ -43,6 +44,8 @@ namespace cvt
 			}
 
 			FlatSLAMMap( const SlamMap& map );
+			/* directly from a binary map without building the SlamMap */
+			FlatSLAMMap( const SlamMapFile& file );
 			~FlatSLAMMap( );
 
 			const cvt::Matrix3f* intrinsics( ) const
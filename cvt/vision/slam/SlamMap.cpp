@@ -23,6 +23,8 @@
 */
 
 #include <cvt/vision/slam/SlamMap.h>
+#include <cvt/vision/slam/SlamMapFile.h>
+#include <cvt/vision/slam/SlamMapWriter.h>
 
 #include <set>
 
@@ -151,6 +153,29 @@ namespace cvt
         }
     }
 
+    void SlamMap::featurePositions( std::vector<Vector3f>& positions, std::vector<size_t>* ids ) const
+    {
+        positions.clear();
+        positions.reserve( _features.size() );
+        if( ids ){
+            ids->clear();
+            ids->reserve( _features.size() );
+        }
+
+        Vector3f pos;
+        for( size_t i = 0; i < _features.size(); i++ ){
+            const Eigen::Vector4d& p = _features[ i ].estimate();
+            double iw = 1.0 / p[ 3 ];
+            pos.set( p[ 0 ] * iw, p[ 1 ] * iw, p[ 2 ] * iw );
+            // skip points at infinity and broken estimates, the comparison is false for NaN and +-inf
+            if( !( Math::abs( pos.x ) <= Math::MAXF && Math::abs( pos.y ) <= Math::MAXF && Math::abs( pos.z ) <= Math::MAXF ) )
+                continue;
+            positions.push_back( pos );
+            if( ids )
+                ids->push_back( i );
+        }
+    }
+
     void SlamMap::deserialize( XMLNode* node )
     {
         if( node->name() != "SlamMap" ){
@@ -244,6 +269,30 @@ namespace cvt
         if( !FileSystem::exists( filename ) ){
             throw CVTException( "File not found" );
         }
+
+        if( SlamMapFile::isSlamMapFile( filename ) ){
+            SlamMapFile file( filename );
+            file.toSlamMap( *this );
+        } else {
+            loadLegacyBinary( filename );
+        }
+    }
+
+    void SlamMap::saveBinary( const cvt::String& filename ) const
+    {
+        SlamMapWriter writer( filename );
+        writer.write( *this );
+    }
+
+    void SlamMap::appendBinary( const cvt::String& filename ) const
+    {
+        SlamMapWriter writer( filename, true );
+        writer.write( *this );
+    }
+
+    void SlamMap::loadLegacyBinary( const cvt::String& filename )
+    {
+        clear();
         std::ifstream file( filename.c_str(), std::ios_base::in | std::ios_base::binary );
 
         uint32_t nFeatures, nKeyframes, nMeas;
@@ -304,87 +353,4 @@ namespace cvt
             addMeasurement( pointIndices[ i ], camIndices[ i ], mapMeasurement );
         }
     }
-
-    void SlamMap::saveBinary( const cvt::String& filename ) const
-    {
-        std::ofstream out( filename.c_str(), std::ios_base::out | std::ios_base::binary );
-
-        uint32_t nFeatures  = ( uint32_t )_features.size();
-        uint32_t nKeyframes = ( uint32_t )_keyframes.size();
-        uint32_t nMeas      = ( uint32_t )_numMeas;
-
-        // write a header: 3xuint32: #keyframes, #features, #measurements
-        out.write( ( const char* )&nKeyframes, sizeof( nKeyframes ) );
-        out.write( ( const char* )&nFeatures, sizeof( nFeatures ) );
-        out.write( ( const char* )&nMeas, sizeof( nMeas ) );
-
-        std::vector<Vector2d> measurements;
-        std::vector<Matrix2d> measInformations;
-        std::vector<uint32_t> camIdxForMeas;
-        std::vector<uint32_t> featIdxForMeas;
-        measurements.resize( nMeas );
-        measInformations.resize( nMeas );
-        camIdxForMeas.resize( nMeas );
-        featIdxForMeas.resize( nMeas );
-
-        // write intrinsics:
-        Matrix3d K;
-        EigenBridge::toCVT( K, intrinsics() );
-        out.write( ( const char* )K.ptr(), 9 * sizeof( double ) );
-
-        // write the cameras
-        cvt::Matrix4d poseMat;
-        size_t measId = 0;
-        for( size_t i = 0; i < nKeyframes; ++i ){
-            const Keyframe& k = _keyframes[ i ];
-            const Eigen::Matrix4d& m = k.pose().transformation();
-            cvt::EigenBridge::toCVT( poseMat, m );
-            cvt::Quaterniond q( poseMat.toMatrix3() );
-            out.write( ( const char* )&q.x, sizeof( double ) );
-            out.write( ( const char* )&q.y, sizeof( double ) );
-            out.write( ( const char* )&q.z, sizeof( double ) );
-            out.write( ( const char* )&q.w, sizeof( double ) );
-            out.write( ( const char* )&poseMat[ 0 ][ 3 ], sizeof( double ) );
-            out.write( ( const char* )&poseMat[ 1 ][ 3 ], sizeof( double ) );
-            out.write( ( const char* )&poseMat[ 2 ][ 3 ], sizeof( double ) );
-
-            // get all features:
-            Keyframe::MeasurementIterator measIter = k.measurementsBegin();
-            while( measIter != k.measurementsEnd() ){
-                const MapMeasurement& meas = measIter->second;
-
-                Vector2d& currMeas = measurements[ measId ];
-                currMeas[ 0 ] = meas.point[ 0 ];
-                currMeas[ 1 ] = meas.point[ 1 ];
-
-                EigenBridge::toCVT( measInformations[ measId ], meas.information );
-
-                camIdxForMeas[ measId ]  = k.id();
-                featIdxForMeas[ measId ] = measIter->first;
-
-                ++measId;
-                ++measIter;
-            }
-        }
-
-        // write features & covariance
-        Matrix4d covariance;
-        for( size_t i = 0; i < nFeatures; ++i ){
-            const MapFeature& m = _features[ i ];
-            const Eigen::Vector4d& f = m.estimate();
-            EigenBridge::toCVT( covariance, m.covariance() );
-            out.write( ( const char* )&f[ 0 ], sizeof( double ) );
-            out.write( ( const char* )&f[ 1 ], sizeof( double ) );
-            out.write( ( const char* )&f[ 2 ], sizeof( double ) );
-            out.write( ( const char* )&f[ 3 ], sizeof( double ) );
-            out.write( ( const char* )covariance.ptr(), 16 * sizeof( double ) );
-        }
-
-        // measurements
-        out.write( ( const char* )&measurements[ 0 ].x, 2 * sizeof( double ) * nMeas );
-        out.write( ( const char* )&measInformations[ 0 ][ 0 ], 4 * sizeof( double ) * nMeas );
-        out.write( ( const char* )&camIdxForMeas[ 0 ], sizeof( uint32_t ) * nMeas );
-        out.write( ( const char* )&featIdxForMeas[ 0 ], sizeof( uint32_t ) * nMeas );
-        out.close();
-    }
 }
@@ -101,6 +101,13 @@ namespace cvt
 		 const Eigen::Matrix3d&	intrinsics() const { return _intrinsics; }
          void setIntrinsics( const Eigen::Matrix3d & K ) { _intrinsics = K; }
 
+         /**
+          *	\brief euclidean positions of the map features in id order, e.g. for a KNNIndex3f
+          *	\param ids	feature id of each position: points at infinity ( w = 0 ) and
+          *				non-finite estimates are skipped
+          */
+         void featurePositions( std::vector<Vector3f>& positions, std::vector<size_t>* ids = NULL ) const;
+
          size_t numFeatures()	  const { return _features.size(); }
          size_t numKeyframes()	  const { return _keyframes.size(); }
          size_t numMeasurements() const { return _numMeas; }
@@ -111,10 +118,18 @@ namespace cvt
          void load( const cvt::String& filename );
          void save( const cvt::String& filename ) const;
 
+         /**
+          *	\brief binary map format, see SlamMapFile for direct access
+          *		   loadBinary also reads the unversioned format of older versions
+          */
          void loadBinary( const cvt::String& filename );
          void saveBinary( const cvt::String& filename ) const;
+         /* adds the keyframes and features created after the last save or append */
+         void appendBinary( const cvt::String& filename ) const;
 
       private:
+         void loadLegacyBinary( const cvt::String& filename );
+
 		 typedef std::vector<Keyframe, Eigen::aligned_allocator<Keyframe> > KeyframeVectorType;
          typedef std::vector<MapFeature, Eigen::aligned_allocator<MapFeature> > MapFeatureVectorType;
 
@@ -0,0 +1,287 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/slam/SlamMapFile.h>
+#include <cvt/vision/slam/SlamMap.h>
+#include <cvt/vision/CameraCalibration.h>
+#include <cvt/util/CPU.h>
+#include <cvt/util/Exception.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace cvt
+{
+	SlamMapFile::SlamMapFile( const String& filename ) :
+		_fd( -1 ),
+		_map( 0 ),
+		_mapSize( 0 )
+	{
+		if( !isLittleEndian() )
+			throw CVTException( "Binary slam maps are little-endian, big-endian hosts are not supported" );
+
+		_fd = open( filename.c_str(), O_RDONLY, 0 );
+		if( _fd < 0 ){
+			char * err = strerror( errno );
+			String msg( "Could not open file: " );
+			msg += err;
+			throw CVTException( msg.c_str() );
+		}
+
+		try {
+			struct stat fileInfo;
+			if( fstat( _fd, &fileInfo ) == -1 )
+				throw CVTException( "fstat error" );
+			_mapSize = fileInfo.st_size;
+			if( _mapSize < sizeof( SlamMapFileHeader ) )
+				throw CVTException( "Not a binary slam map" );
+
+			void* ptr = mmap( 0, _mapSize, PROT_READ, MAP_SHARED, _fd, 0 );
+			if( ptr == MAP_FAILED ){
+				String msg( "Could not map slam map: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+			_map = ( uint8_t* ) ptr;
+			madvise( _map, _mapSize, MADV_WILLNEED );
+
+			memcpy( &_header, _map, sizeof( _header ) );
+			if( memcmp( _header.magic, SLAMMAP_MAGIC, 8 ) )
+				throw CVTException( "Not a binary slam map" );
+			if( _header.version != SLAMMAP_VERSION )
+				throw CVTException( "Unsupported binary slam map version" );
+
+			parseChunks();
+		} catch( ... ){
+			if( _map )
+				munmap( _map, _mapSize );
+			::close( _fd );
+			throw;
+		}
+	}
+
+	SlamMapFile::~SlamMapFile()
+	{
+		if( _map )
+			munmap( _map, _mapSize );
+		if( _fd >= 0 )
+			::close( _fd );
+	}
+
+	void SlamMapFile::parseChunks()
+	{
+		if( _header.dataSize > _mapSize )
+			throw CVTException( "Truncated binary slam map" );
+
+		// sizes are compared against the remaining bytes, sums of untrusted fields could wrap
+		uint64_t offset = SlamMapAlign( sizeof( SlamMapFileHeader ) );
+		for( uint32_t i = 0; i < _header.numChunks; i++ ){
+			if( offset > _header.dataSize || _header.dataSize - offset < sizeof( SlamMapChunkHeader ) )
+				throw CVTException( "Truncated binary slam map" );
+
+			const SlamMapChunkHeader* chunk = ( const SlamMapChunkHeader* ) ( _map + offset );
+			if( chunk->magic != SLAMMAP_CHUNKMAGIC || chunk->recordSize == 0 ||
+				chunk->chunkSize < sizeof( SlamMapChunkHeader ) ||
+				chunk->chunkSize > _header.dataSize - offset ||
+				chunk->count > ( chunk->chunkSize - sizeof( SlamMapChunkHeader ) ) / chunk->recordSize ||
+				chunk->first > ~( uint64_t ) 0 - chunk->count )
+				throw CVTException( "Invalid chunk in binary slam map" );
+
+			Section s;
+			s.data		 = _map + offset + sizeof( SlamMapChunkHeader );
+			s.first		 = chunk->first;
+			s.count		 = chunk->count;
+			s.recordSize = chunk->recordSize;
+
+			switch( chunk->type ){
+				case SLAMMAP_CHUNK_KEYFRAMES:
+					if( s.recordSize != sizeof( SlamMapKeyframe ) )
+						throw CVTException( "Invalid keyframe chunk" );
+					_keyframes.push_back( s );
+					break;
+				case SLAMMAP_CHUNK_FEATURES:
+					if( s.recordSize != sizeof( SlamMapFeature ) )
+						throw CVTException( "Invalid feature chunk" );
+					_features.push_back( s );
+					break;
+				case SLAMMAP_CHUNK_MEASUREMENTS:
+					if( s.recordSize != sizeof( SlamMapMeasurement ) )
+						throw CVTException( "Invalid measurement chunk" );
+					_measurements.push_back( s );
+					break;
+				case SLAMMAP_CHUNK_DESCRIPTORS:
+					_descriptors.push_back( s );
+					break;
+				case SLAMMAP_CHUNK_CALIBRATIONS:
+					if( s.recordSize != sizeof( SlamMapCalibration ) )
+						throw CVTException( "Invalid calibration chunk" );
+					_calibrations.push_back( s );
+					break;
+				default:
+					// unknown chunks of newer writers are skipped
+					break;
+			}
+			offset += chunk->chunkSize;
+		}
+	}
+
+	const uint8_t* SlamMapFile::record( const std::vector<Section>& sections, size_t idx, const char* what ) const
+	{
+		// sections are appended in increasing order, find the last one starting before idx
+		size_t lo = 0, hi = sections.size();
+		while( lo < hi ){
+			size_t mid = ( lo + hi ) >> 1;
+			if( sections[ mid ].first <= idx )
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		if( lo == 0 || idx >= sections[ lo - 1 ].first + sections[ lo - 1 ].count ){
+			String msg;
+			msg.sprintf( "Binary slam map has no %s %d", what, ( int ) idx );
+			throw CVTException( msg.c_str() );
+		}
+
+		const Section& s = sections[ lo - 1 ];
+		return s.data + ( idx - s.first ) * s.recordSize;
+	}
+
+	const uint8_t* SlamMapFile::descriptor( size_t featureId, size_t* length ) const
+	{
+		// later chunks replace earlier descriptors
+		for( size_t i = _descriptors.size(); i--; ){
+			const Section& s = _descriptors[ i ];
+			if( featureId >= s.first && featureId < s.first + s.count ){
+				if( length )
+					*length = s.recordSize;
+				return s.data + ( featureId - s.first ) * s.recordSize;
+			}
+		}
+		if( length )
+			*length = 0;
+		return NULL;
+	}
+
+	void SlamMapFile::calibration( CameraCalibration& calib, size_t idx ) const
+	{
+		const SlamMapCalibration& rec = *( const SlamMapCalibration* ) record( _calibrations, idx, "calibration" );
+
+		Matrix3f K;
+		Matrix4f T;
+		for( size_t r = 0; r < 4; r++ ){
+			for( size_t c = 0; c < 4; c++ ){
+				if( r < 3 && c < 3 )
+					K[ r ][ c ] = rec.intrinsics[ r * 3 + c ];
+				T[ r ][ c ] = rec.extrinsics[ r * 4 + c ];
+			}
+		}
+
+		calib = CameraCalibration();
+		if( rec.flags & INTRINSICS )
+			calib.setIntrinsics( K );
+		if( rec.flags & EXTRINSICS )
+			calib.setExtrinsics( T );
+		if( rec.flags & DISTORTION )
+			calib.setDistortion( Vector3f( rec.radial[ 0 ], rec.radial[ 1 ], rec.radial[ 2 ] ),
+								 Vector2f( rec.tangential[ 0 ], rec.tangential[ 1 ] ) );
+		calib.setWidth( rec.width );
+		calib.setHeight( rec.height );
+	}
+
+	void SlamMapFile::toSlamMap( SlamMap& map ) const
+	{
+		map.clear();
+
+		Eigen::Matrix3d K;
+		for( size_t r = 0; r < 3; r++ )
+			for( size_t c = 0; c < 3; c++ )
+				K( r, c ) = _header.intrinsics[ r * 3 + c ];
+		map.setIntrinsics( K );
+
+		Eigen::Vector4d point;
+		Eigen::Matrix4d cov;
+		for( size_t i = 0; i < numFeatures(); i++ ){
+			const SlamMapFeature& f = feature( i );
+			for( size_t r = 0; r < 4; r++ ){
+				point[ r ] = f.point[ r ];
+				for( size_t c = 0; c < 4; c++ )
+					cov( r, c ) = f.covariance[ r * 4 + c ];
+			}
+			map.addFeature( MapFeature( point, cov ) );
+		}
+
+		Eigen::Matrix4d pose;
+		MapMeasurement meas;
+		for( size_t i = 0; i < numKeyframes(); i++ ){
+			const SlamMapKeyframe& kf = keyframe( i );
+			for( size_t r = 0; r < 4; r++ )
+				for( size_t c = 0; c < 4; c++ )
+					pose( r, c ) = kf.pose[ r * 4 + c ];
+			map.addKeyframe( pose );
+
+			for( size_t m = 0; m < kf.numMeasurements; m++ ){
+				const SlamMapMeasurement& rec = measurement( kf.firstMeasurement + m );
+				if( rec.feature >= numFeatures() || rec.keyframe != i )
+					throw CVTException( "Invalid measurement in binary slam map" );
+				meas.point[ 0 ] = rec.point[ 0 ];
+				meas.point[ 1 ] = rec.point[ 1 ];
+				for( size_t k = 0; k < 4; k++ )
+					meas.information( k / 2, k % 2 ) = rec.information[ k ];
+				map.addMeasurement( rec.feature, i, meas );
+			}
+		}
+	}
+
+	bool SlamMapFile::isSlamMapFile( const String& filename )
+	{
+		int fd = open( filename.c_str(), O_RDONLY, 0 );
+		if( fd < 0 )
+			return false;
+		char magic[ 8 ];
+		bool ret = read( fd, magic, 8 ) == 8 && !memcmp( magic, SLAMMAP_MAGIC, 8 );
+		::close( fd );
+		return ret;
+	}
+
+	void SlamMapFile::importXML( const String& xmlFile, const String& binaryFile )
+	{
+		SlamMap map;
+		map.load( xmlFile );
+		map.saveBinary( binaryFile );
+	}
+
+	void SlamMapFile::exportXML( const String& binaryFile, const String& xmlFile )
+	{
+		SlamMap map;
+		SlamMapFile file( binaryFile );
+		file.toSlamMap( map );
+		map.save( xmlFile );
+	}
+}
@@ -0,0 +1,118 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SLAMMAPFILE_H
+#define CVT_SLAMMAPFILE_H
+
+#include <cvt/vision/slam/SlamMapFormat.h>
+#include <cvt/util/String.h>
+
+#include <vector>
+
+namespace cvt
+{
+	class SlamMap;
+	class CameraCalibration;
+
+	/**
+	  Read-only view of a binary slam map.
+
+	  The file is memory mapped, the records are accessed in place without
+	  copying. Lookups are O( log( chunks ) ): saved maps have one chunk per
+	  type, every append adds one.
+	 */
+	class SlamMapFile
+	{
+		public:
+			SlamMapFile( const String& filename );
+			~SlamMapFile();
+
+			size_t	numKeyframes() const	{ return _header.numKeyframes; }
+			size_t	numFeatures() const		{ return _header.numFeatures; }
+			size_t	numMeasurements() const	{ return _header.numMeasurements; }
+			size_t	numCalibrations() const	{ return _header.numCalibrations; }
+
+			/* 3x3 row major */
+			const double*				intrinsics() const { return _header.intrinsics; }
+
+			const SlamMapKeyframe&		keyframe( size_t id ) const;
+			const SlamMapFeature&		feature( size_t id ) const;
+			/* the measurements of keyframe kf are kf.firstMeasurement, ... */
+			const SlamMapMeasurement&	measurement( size_t idx ) const;
+			/* NULL if no descriptor chunk covers the feature, features written without descriptor get a zero-filled record */
+			const uint8_t*				descriptor( size_t featureId, size_t* length = NULL ) const;
+			void						calibration( CameraCalibration& calib, size_t idx ) const;
+
+			/* builds the editable map */
+			void						toSlamMap( SlamMap& map ) const;
+
+			static bool					isSlamMapFile( const String& filename );
+			/* conversion from and to the xml map format */
+			static void					importXML( const String& xmlFile, const String& binaryFile );
+			static void					exportXML( const String& binaryFile, const String& xmlFile );
+
+		private:
+			SlamMapFile( const SlamMapFile& );
+			SlamMapFile& operator=( const SlamMapFile& );
+
+			struct Section {
+				const uint8_t*	data;
+				uint64_t		first;
+				uint64_t		count;
+				uint64_t		recordSize;
+			};
+
+			void				parseChunks();
+			const uint8_t*		record( const std::vector<Section>& sections, size_t idx, const char* what ) const;
+
+			int					_fd;
+			uint8_t*			_map;
+			size_t				_mapSize;
+			SlamMapFileHeader	_header;
+
+			std::vector<Section> _keyframes;
+			std::vector<Section> _features;
+			std::vector<Section> _measurements;
+			std::vector<Section> _descriptors;
+			std::vector<Section> _calibrations;
+	};
+
+	inline const SlamMapKeyframe& SlamMapFile::keyframe( size_t id ) const
+	{
+		return *( const SlamMapKeyframe* ) record( _keyframes, id, "keyframe" );
+	}
+
+	inline const SlamMapFeature& SlamMapFile::feature( size_t id ) const
+	{
+		return *( const SlamMapFeature* ) record( _features, id, "feature" );
+	}
+
+	inline const SlamMapMeasurement& SlamMapFile::measurement( size_t idx ) const
+	{
+		return *( const SlamMapMeasurement* ) record( _measurements, idx, "measurement" );
+	}
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SLAMMAPFORMAT_H
+#define CVT_SLAMMAPFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cvt
+{
+	/*
+	   On-disk layout of the binary slam map (version 2), little-endian:
+
+	   [ SlamMapFileHeader, padded to SLAMMAP_ALIGN ]
+	   [ SlamMapChunkHeader | records, padded to SLAMMAP_ALIGN ] * numChunks
+
+	   A chunk holds consecutive records of one type, starting with the record
+	   index first. Saving a map writes one chunk per type, appending adds
+	   chunks for the new keyframes, features and measurements and updates
+	   the header afterwards: data behind header.dataSize is ignored, so an
+	   interrupted append leaves the previous state readable.
+
+	   Measurements are stored in keyframe order, each keyframe references its
+	   range. Descriptor chunks hold raw descriptors of consecutive features,
+	   later chunks replace earlier descriptors of the same feature.
+	   Files without the magic are read as version 1.
+
+	   The records are mapped and written as they are in memory, big-endian
+	   hosts can neither read nor write the format.
+	 */
+
+	#define SLAMMAP_MAGIC		"CVTSMAP2"
+	#define SLAMMAP_CHUNKMAGIC	0x4b4e4843 /* "CHNK" */
+	#define SLAMMAP_VERSION		2
+	#define SLAMMAP_ALIGN		64
+
+	enum SlamMapChunkType {
+		SLAMMAP_CHUNK_KEYFRAMES = 1,
+		SLAMMAP_CHUNK_FEATURES,
+		SLAMMAP_CHUNK_MEASUREMENTS,
+		SLAMMAP_CHUNK_DESCRIPTORS,
+		SLAMMAP_CHUNK_CALIBRATIONS
+	};
+
+	struct SlamMapFileHeader {
+		char		magic[ 8 ];
+		uint32_t	version;
+		uint32_t	numChunks;
+		uint64_t	numKeyframes;
+		uint64_t	numFeatures;
+		uint64_t	numMeasurements;
+		uint64_t	numCalibrations;
+		/* end of the last complete chunk */
+		uint64_t	dataSize;
+		/* row major */
+		double		intrinsics[ 9 ];
+	};
+
+	struct SlamMapChunkHeader {
+		uint32_t	magic;
+		uint32_t	type;
+		uint64_t	first;
+		uint64_t	count;
+		uint64_t	recordSize;
+		/* size of the whole chunk including header and padding */
+		uint64_t	chunkSize;
+		uint64_t	reserved[ 3 ];
+	};
+
+	struct SlamMapKeyframe {
+		/* keyframe to world, row major */
+		double		pose[ 16 ];
+		uint64_t	firstMeasurement;
+		uint64_t	numMeasurements;
+	};
+
+	struct SlamMapFeature {
+		double		point[ 4 ];
+		/* row major */
+		double		covariance[ 16 ];
+	};
+
+	struct SlamMapMeasurement {
+		double		point[ 2 ];
+		/* inverse covariance, row major */
+		double		information[ 4 ];
+		uint32_t	keyframe;
+		uint32_t	feature;
+	};
+
+	struct SlamMapCalibration {
+		double		intrinsics[ 9 ];
+		double		extrinsics[ 16 ];
+		double		radial[ 3 ];
+		double		tangential[ 2 ];
+		uint32_t	width;
+		uint32_t	height;
+		/* CamCalibFlagTypes of the valid parts */
+		uint32_t	flags;
+		uint32_t	reserved;
+	};
+
+	inline uint64_t SlamMapAlign( uint64_t size )
+	{
+		return ( size + SLAMMAP_ALIGN - 1 ) & ~( ( uint64_t ) SLAMMAP_ALIGN - 1 );
+	}
+}
+
+#endif
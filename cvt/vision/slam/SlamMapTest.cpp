@@ -0,0 +1,286 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/slam/SlamMap.h>
+#include <cvt/vision/slam/SlamMapFile.h>
+#include <cvt/vision/slam/SlamMapWriter.h>
+#include <cvt/vision/slam/SlamMapFormat.h>
+#include <cvt/vision/slam/FlatSLAMMap.h>
+#include <cvt/vision/features/FeatureDescriptor.h>
+#include <cvt/util/CVTTest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+namespace cvt {
+
+	static void _addKeyframe( SlamMap& map, size_t numNew )
+	{
+		Eigen::Matrix4d pose = Eigen::Matrix4d::Identity();
+		pose( 0, 3 ) = 0.1 * map.numKeyframes();
+		pose( 1, 3 ) = -0.5;
+		size_t kf = map.addKeyframe( pose );
+
+		MapMeasurement meas;
+		meas.information( 0, 1 ) = meas.information( 1, 0 ) = 0.25;
+		// observe some old features and add new ones
+		for( size_t i = 0; i < map.numFeatures(); i += 3 ){
+			meas.point = Eigen::Vector2d( i, kf + 0.5 );
+			map.addMeasurement( i, kf, meas );
+		}
+		for( size_t i = 0; i < numNew; i++ ){
+			Eigen::Vector4d p( i, kf, 1.0 + i * 0.01, 1.0 );
+			Eigen::Matrix4d cov = Eigen::Matrix4d::Identity() * ( 1.0 + i );
+			cov( 0, 3 ) = 0.5;
+			meas.point = Eigen::Vector2d( 2.0 * i, kf );
+			map.addFeatureToKeyframe( MapFeature( p, cov ), meas, kf );
+		}
+	}
+
+	static bool _compareMaps( const SlamMap& a, const SlamMap& b )
+	{
+		if( a.numKeyframes() != b.numKeyframes() || a.numFeatures() != b.numFeatures() ||
+			a.numMeasurements() != b.numMeasurements() || a.intrinsics() != b.intrinsics() )
+			return false;
+
+		for( size_t i = 0; i < a.numFeatures(); i++ ){
+			const MapFeature& fa = a.featureForId( i );
+			const MapFeature& fb = b.featureForId( i );
+			if( fa.estimate() != fb.estimate() || fa.covariance() != fb.covariance() )
+				return false;
+			if( !std::equal( fa.pointTrackBegin(), fa.pointTrackEnd(), fb.pointTrackBegin() ) )
+				return false;
+		}
+
+		for( size_t i = 0; i < a.numKeyframes(); i++ ){
+			const Keyframe& ka = a.keyframeForId( i );
+			const Keyframe& kb = b.keyframeForId( i );
+			if( ( ka.pose().transformation() - kb.pose().transformation() ).norm() > 1e-12 ||
+				ka.numMeasurements() != kb.numMeasurements() )
+				return false;
+			Keyframe::MeasurementIterator it = ka.measurementsBegin();
+			for( ; it != ka.measurementsEnd(); ++it ){
+				const MapMeasurement& m = kb.measurementForId( it->first );
+				if( m.point != it->second.point || m.information != it->second.information )
+					return false;
+			}
+		}
+		return true;
+	}
+
+	static bool _testSaveLoad( const String& file )
+	{
+		SlamMap map;
+		Eigen::Matrix3d K;
+		K << 500.0, 0.0, 320.0, 0.0, 505.0, 240.0, 0.0, 0.0, 1.0;
+		map.setIntrinsics( K );
+		for( size_t i = 0; i < 5; i++ )
+			_addKeyframe( map, 40 );
+
+		map.saveBinary( file );
+		SlamMap loaded;
+		loaded.loadBinary( file );
+		bool ret = _compareMaps( map, loaded );
+
+		SlamMapFile view( file );
+		FlatSLAMMap flat( view );
+		ret &= flat.numCameras() == map.numKeyframes() && flat.numFeatures() == map.numFeatures() &&
+			   flat.numMeasurements() == map.numMeasurements();
+		return ret;
+	}
+
+	static bool _testAppend( const String& file )
+	{
+		SlamMap map;
+		_addKeyframe( map, 10 );
+		_addKeyframe( map, 10 );
+		map.saveBinary( file );
+
+		bool ret = true;
+		for( size_t i = 0; i < 3; i++ ){
+			_addKeyframe( map, 7 );
+			map.appendBinary( file );
+
+			SlamMapFile view( file );
+			ret &= view.numKeyframes() == map.numKeyframes() && view.numFeatures() == map.numFeatures();
+		}
+
+		SlamMap loaded;
+		loaded.loadBinary( file );
+		ret &= _compareMaps( map, loaded );
+		return ret;
+	}
+
+	static bool _testDescriptorsAndCalibration( const String& file )
+	{
+		SlamMap map;
+		_addKeyframe( map, 4 );
+
+		typedef FeatureDescriptorInternal<32, uint8_t, FEATUREDESC_CMP_HAMMING> Descriptor;
+		std::vector<Descriptor> desc( 4, Descriptor( Feature() ) );
+		std::vector<const FeatureDescriptor*> ptrs;
+		for( size_t i = 0; i < desc.size(); i++ ){
+			for( size_t k = 0; k < 32; k++ )
+				desc[ i ].desc[ k ] = ( uint8_t ) ( i * 32 + k );
+			ptrs.push_back( &desc[ i ] );
+		}
+		ptrs[ 2 ] = NULL;
+
+		CameraCalibration calib;
+		calib.setIntrinsics( 400.0f, 410.0f, 320.0f, 240.0f );
+		calib.setDistortion( Vector3f( 0.1f, -0.2f, 0.01f ), Vector2f( 0.001f, 0.002f ) );
+		calib.setWidth( 640 );
+		calib.setHeight( 480 );
+
+		{
+			SlamMapWriter writer( file );
+			writer.write( map );
+			writer.writeDescriptors( ptrs, 0 );
+			// replace the descriptor of feature 1
+			ptrs.assign( 1, &desc[ 3 ] );
+			writer.writeDescriptors( ptrs, 1 );
+			writer.writeCalibration( calib );
+		}
+
+		SlamMapFile view( file );
+		size_t length;
+		bool ret = view.numCalibrations() == 1;
+		ret &= view.descriptor( 0, &length ) != NULL && length == 32 && !memcmp( view.descriptor( 0 ), desc[ 0 ].ptr(), 32 );
+		ret &= !memcmp( view.descriptor( 1 ), desc[ 3 ].ptr(), 32 );
+		ret &= view.descriptor( 2 )[ 5 ] == 0;
+		ret &= view.descriptor( 7 ) == NULL;
+
+		CameraCalibration loaded;
+		view.calibration( loaded, 0 );
+		ret &= loaded.intrinsics() == calib.intrinsics() && loaded.radialDistortion() == calib.radialDistortion() &&
+			   loaded.tangentialDistortion() == calib.tangentialDistortion() && loaded.width() == 640 && loaded.height() == 480;
+		return ret;
+	}
+
+	static bool _testFeaturePositions()
+	{
+		SlamMap map;
+		Eigen::Matrix4d cov = Eigen::Matrix4d::Identity();
+		map.addFeature( MapFeature( Eigen::Vector4d( 2.0, 4.0, 6.0, 2.0 ), cov ) );
+		map.addFeature( MapFeature( Eigen::Vector4d( 1.0, 0.0, 0.0, 0.0 ), cov ) );
+		map.addFeature( MapFeature( Eigen::Vector4d( -1.0, 1.0, 0.0, 0.0 ), cov ) );
+		map.addFeature( MapFeature( Eigen::Vector4d( 1.0, 2.0, 3.0, 1.0 ), cov ) );
+
+		std::vector<Vector3f> pos;
+		std::vector<size_t> ids;
+		map.featurePositions( pos, &ids );
+		return pos.size() == 2 && ids.size() == 2 && ids[ 0 ] == 0 && ids[ 1 ] == 3 &&
+			   pos[ 0 ] == Vector3f( 1.0f, 2.0f, 3.0f ) && pos[ 1 ] == Vector3f( 1.0f, 2.0f, 3.0f );
+	}
+
+	/* overwrites one field of the first chunk header, true if the file is rejected */
+	static bool _rejectsChunk( const String& file, size_t field, uint64_t value )
+	{
+		FILE* f = fopen( file.c_str(), "r+b" );
+		if( !f )
+			return false;
+		fseek( f, SlamMapAlign( sizeof( SlamMapFileHeader ) ) + field, SEEK_SET );
+		fwrite( &value, sizeof( value ), 1, f );
+		fclose( f );
+
+		try {
+			SlamMapFile view( file );
+		} catch( const Exception& ){
+			return true;
+		}
+		return false;
+	}
+
+	static bool _testCorruptChunks( const String& file )
+	{
+		SlamMap map;
+		_addKeyframe( map, 8 );
+
+		// count * recordSize and offset + chunkSize wrap around to small values
+		bool ret = true;
+		map.saveBinary( file );
+		ret &= _rejectsChunk( file, offsetof( SlamMapChunkHeader, count ), ( uint64_t ) 1 << 63 );
+		map.saveBinary( file );
+		ret &= _rejectsChunk( file, offsetof( SlamMapChunkHeader, chunkSize ), ~( uint64_t ) 0 );
+		map.saveBinary( file );
+		ret &= _rejectsChunk( file, offsetof( SlamMapChunkHeader, first ), ~( uint64_t ) 0 );
+		return ret;
+	}
+
+	static bool _testXMLBridge( const String& file )
+	{
+		String xml( file );
+		xml += ".xml";
+
+		SlamMap map;
+		_addKeyframe( map, 6 );
+		_addKeyframe( map, 3 );
+		map.saveBinary( file );
+
+		SlamMapFile::exportXML( file, xml );
+		unlink( file.c_str() );
+		SlamMapFile::importXML( xml, file );
+
+		SlamMap loaded;
+		loaded.loadBinary( file );
+		unlink( xml.c_str() );
+		return loaded.numKeyframes() == map.numKeyframes() && loaded.numFeatures() == map.numFeatures() &&
+			   loaded.numMeasurements() == map.numMeasurements();
+	}
+
+BEGIN_CVTTEST( SlamMap )
+	bool result = true;
+	bool b;
+	String file( "/tmp/cvt_slammap_test.map" );
+
+	b = _testSaveLoad( file );
+	CVTTEST_PRINT( "SlamMap binary save/load", b );
+	result &= b;
+
+	b = _testAppend( file );
+	CVTTEST_PRINT( "SlamMap binary append", b );
+	result &= b;
+
+	b = _testDescriptorsAndCalibration( file );
+	CVTTEST_PRINT( "SlamMapFile descriptors and calibration", b );
+	result &= b;
+
+	b = _testFeaturePositions();
+	CVTTEST_PRINT( "SlamMap feature positions", b );
+	result &= b;
+
+	b = _testCorruptChunks( file );
+	CVTTEST_PRINT( "SlamMapFile corrupt chunks", b );
+	result &= b;
+
+	b = _testXMLBridge( file );
+	CVTTEST_PRINT( "SlamMapFile XML bridge", b );
+	result &= b;
+
+	unlink( file.c_str() );
+	return result;
+END_CVTTEST
+
+}
@@ -0,0 +1,251 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#include <cvt/vision/slam/SlamMapWriter.h>
+#include <cvt/vision/slam/SlamMap.h>
+#include <cvt/vision/CameraCalibration.h>
+#include <cvt/vision/features/FeatureDescriptor.h>
+#include <cvt/util/CPU.h>
+#include <cvt/util/Exception.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cvt
+{
+	SlamMapWriter::SlamMapWriter( const String& filename, bool append ) :
+		_fd( -1 )
+	{
+		if( !isLittleEndian() )
+			throw CVTException( "Binary slam maps are little-endian, big-endian hosts are not supported" );
+
+		int flags = O_RDWR | O_CREAT;
+		if( !append )
+			flags |= O_TRUNC;
+
+		_fd = open( filename.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+		if( _fd < 0 ){
+			char * err = strerror( errno );
+			String msg( "Could not open file: " );
+			msg += err;
+			throw CVTException( msg.c_str() );
+		}
+
+		try {
+			struct stat fileInfo;
+			if( append && fstat( _fd, &fileInfo ) == 0 && fileInfo.st_size > 0 ){
+				readHeader();
+			} else {
+				memset( &_header, 0, sizeof( _header ) );
+				memcpy( _header.magic, SLAMMAP_MAGIC, 8 );
+				_header.version = SLAMMAP_VERSION;
+				_header.dataSize = SlamMapAlign( sizeof( SlamMapFileHeader ) );
+				for( size_t i = 0; i < 3; i++ )
+					_header.intrinsics[ i * 4 ] = 1.0;
+				writeHeader();
+			}
+		} catch( ... ){
+			::close( _fd );
+			throw;
+		}
+	}
+
+	SlamMapWriter::~SlamMapWriter()
+	{
+		if( _fd >= 0 )
+			::close( _fd );
+	}
+
+	void SlamMapWriter::readHeader()
+	{
+		if( pread( _fd, &_header, sizeof( _header ), 0 ) != ( ssize_t ) sizeof( _header ) )
+			throw CVTException( "Could not read slam map header" );
+		if( memcmp( _header.magic, SLAMMAP_MAGIC, 8 ) || _header.version != SLAMMAP_VERSION )
+			throw CVTException( "Can only append to binary slam maps of version 2" );
+	}
+
+	void SlamMapWriter::writeHeader()
+	{
+		// everything up to dataSize is complete, cut off leftovers of interrupted writes
+		writeAll( &_header, sizeof( _header ), 0 );
+		if( ftruncate( _fd, ( off_t ) _header.dataSize ) != 0 )
+			throw CVTException( "Could not resize slam map file" );
+	}
+
+	void SlamMapWriter::writeAll( const void* data, size_t size, uint64_t offset )
+	{
+		const uint8_t* ptr = ( const uint8_t* ) data;
+		while( size ){
+			ssize_t n = ::pwrite( _fd, ptr, size, ( off_t ) offset );
+			if( n < 0 ){
+				if( errno == EINTR )
+					continue;
+				String msg( "Slam map write error: " );
+				msg += strerror( errno );
+				throw CVTException( msg.c_str() );
+			}
+			ptr += n;
+			offset += n;
+			size -= n;
+		}
+	}
+
+	void SlamMapWriter::writeChunk( SlamMapChunkType type, uint64_t first, const void* records, size_t count, size_t recordSize )
+	{
+		if( !count )
+			return;
+
+		SlamMapChunkHeader chunk;
+		memset( &chunk, 0, sizeof( chunk ) );
+		chunk.magic		 = SLAMMAP_CHUNKMAGIC;
+		chunk.type		 = type;
+		chunk.first		 = first;
+		chunk.count		 = count;
+		chunk.recordSize = recordSize;
+		chunk.chunkSize	 = SlamMapAlign( sizeof( chunk ) + count * recordSize );
+
+		uint64_t offset = _header.dataSize;
+		writeAll( &chunk, sizeof( chunk ), offset );
+		writeAll( records, count * recordSize, offset + sizeof( chunk ) );
+
+		_header.dataSize += chunk.chunkSize;
+		_header.numChunks++;
+	}
+
+	void SlamMapWriter::write( const SlamMap& map )
+	{
+		if( map.numKeyframes() < _header.numKeyframes || map.numFeatures() < _header.numFeatures )
+			throw CVTException( "SlamMapWriter: the map has less keyframes or features than the file" );
+
+		const Eigen::Matrix3d& K = map.intrinsics();
+		for( size_t r = 0; r < 3; r++ )
+			for( size_t c = 0; c < 3; c++ )
+				_header.intrinsics[ r * 3 + c ] = K( r, c );
+
+		// features
+		size_t nFeatures = map.numFeatures() - _header.numFeatures;
+		std::vector<SlamMapFeature> features( nFeatures );
+		for( size_t i = 0; i < nFeatures; i++ ){
+			const MapFeature& f = map.featureForId( _header.numFeatures + i );
+			SlamMapFeature& rec = features[ i ];
+			for( size_t r = 0; r < 4; r++ ){
+				rec.point[ r ] = f.estimate()[ r ];
+				for( size_t c = 0; c < 4; c++ )
+					rec.covariance[ r * 4 + c ] = f.covariance()( r, c );
+			}
+		}
+
+		// keyframes and their measurements
+		size_t nKeyframes = map.numKeyframes() - _header.numKeyframes;
+		std::vector<SlamMapKeyframe> keyframes( nKeyframes );
+		std::vector<SlamMapMeasurement> measurements;
+		for( size_t i = 0; i < nKeyframes; i++ ){
+			size_t kfId = _header.numKeyframes + i;
+			const Keyframe& kf = map.keyframeForId( kfId );
+			SlamMapKeyframe& rec = keyframes[ i ];
+
+			const Eigen::Matrix4d& pose = kf.pose().transformation();
+			for( size_t r = 0; r < 4; r++ )
+				for( size_t c = 0; c < 4; c++ )
+					rec.pose[ r * 4 + c ] = pose( r, c );
+			rec.firstMeasurement = _header.numMeasurements + measurements.size();
+			rec.numMeasurements = kf.numMeasurements();
+
+			Keyframe::MeasurementIterator it = kf.measurementsBegin();
+			const Keyframe::MeasurementIterator end = kf.measurementsEnd();
+			for( ; it != end; ++it ){
+				SlamMapMeasurement m;
+				m.point[ 0 ] = it->second.point[ 0 ];
+				m.point[ 1 ] = it->second.point[ 1 ];
+				for( size_t k = 0; k < 4; k++ )
+					m.information[ k ] = it->second.information( k / 2, k % 2 );
+				m.keyframe = ( uint32_t ) kfId;
+				m.feature  = ( uint32_t ) it->first;
+				measurements.push_back( m );
+			}
+		}
+
+		writeChunk( SLAMMAP_CHUNK_FEATURES, _header.numFeatures, features.empty() ? NULL : &features[ 0 ], nFeatures, sizeof( SlamMapFeature ) );
+		writeChunk( SLAMMAP_CHUNK_KEYFRAMES, _header.numKeyframes, keyframes.empty() ? NULL : &keyframes[ 0 ], nKeyframes, sizeof( SlamMapKeyframe ) );
+		writeChunk( SLAMMAP_CHUNK_MEASUREMENTS, _header.numMeasurements, measurements.empty() ? NULL : &measurements[ 0 ],
+					measurements.size(), sizeof( SlamMapMeasurement ) );
+
+		_header.numFeatures		+= nFeatures;
+		_header.numKeyframes	+= nKeyframes;
+		_header.numMeasurements += measurements.size();
+		writeHeader();
+	}
+
+	void SlamMapWriter::writeCalibration( const CameraCalibration& calib )
+	{
+		SlamMapCalibration rec;
+		memset( &rec, 0, sizeof( rec ) );
+
+		for( size_t r = 0; r < 4; r++ ){
+			for( size_t c = 0; c < 4; c++ ){
+				if( r < 3 && c < 3 )
+					rec.intrinsics[ r * 3 + c ] = calib.intrinsics()[ r ][ c ];
+				rec.extrinsics[ r * 4 + c ] = calib.extrinsics()[ r ][ c ];
+			}
+		}
+		for( size_t i = 0; i < 3; i++ )
+			rec.radial[ i ] = calib.radialDistortion()[ i ];
+		for( size_t i = 0; i < 2; i++ )
+			rec.tangential[ i ] = calib.tangentialDistortion()[ i ];
+		rec.width  = ( uint32_t ) calib.width();
+		rec.height = ( uint32_t ) calib.height();
+		rec.flags  = ( uint32_t ) ( size_t ) calib.flags();
+
+		writeChunk( SLAMMAP_CHUNK_CALIBRATIONS, _header.numCalibrations, &rec, 1, sizeof( rec ) );
+		_header.numCalibrations++;
+		writeHeader();
+	}
+
+	void SlamMapWriter::writeDescriptors( const std::vector<const FeatureDescriptor*>& descriptors, size_t firstFeature )
+	{
+		size_t length = 0;
+		for( size_t i = 0; i < descriptors.size() && !length; i++ ){
+			if( descriptors[ i ] )
+				length = descriptors[ i ]->length();
+		}
+		if( !length )
+			return;
+
+		std::vector<uint8_t> data( descriptors.size() * length, 0 );
+		for( size_t i = 0; i < descriptors.size(); i++ ){
+			if( !descriptors[ i ] )
+				continue;
+			if( descriptors[ i ]->length() != length )
+				throw CVTException( "SlamMapWriter: descriptors of different length" );
+			memcpy( &data[ i * length ], descriptors[ i ]->ptr(), length );
+		}
+
+		writeChunk( SLAMMAP_CHUNK_DESCRIPTORS, firstFeature, &data[ 0 ], descriptors.size(), length );
+		writeHeader();
+	}
+}
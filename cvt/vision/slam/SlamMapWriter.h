@@ -0,0 +1,78 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+#ifndef CVT_SLAMMAPWRITER_H
+#define CVT_SLAMMAPWRITER_H
+
+#include <cvt/vision/slam/SlamMapFormat.h>
+#include <cvt/util/String.h>
+
+#include <vector>
+
+namespace cvt
+{
+	class SlamMap;
+	class CameraCalibration;
+	class FeatureDescriptor;
+
+	/**
+	  Writes the binary slam map format.
+
+	  write() stores everything of the map that is not in the file yet: the
+	  keyframes and features added since the last write and the measurements
+	  of the new keyframes. Keyframes and features are identified by their
+	  index, changes of already stored entries need a rewrite of the file.
+	 */
+	class SlamMapWriter
+	{
+		public:
+			/* append: add to an existing file instead of replacing it */
+			SlamMapWriter( const String& filename, bool append = false );
+			~SlamMapWriter();
+
+			void	write( const SlamMap& map );
+			void	writeCalibration( const CameraCalibration& calib );
+			/* descriptors of the features firstFeature, ..., NULL entries are stored as zeros */
+			void	writeDescriptors( const std::vector<const FeatureDescriptor*>& descriptors, size_t firstFeature );
+
+			size_t	numKeyframes() const	{ return _header.numKeyframes; }
+			size_t	numFeatures() const		{ return _header.numFeatures; }
+			size_t	numMeasurements() const	{ return _header.numMeasurements; }
+
+		private:
+			SlamMapWriter( const SlamMapWriter& );
+			SlamMapWriter& operator=( const SlamMapWriter& );
+
+			void	readHeader();
+			void	writeHeader();
+			void	writeChunk( SlamMapChunkType type, uint64_t first, const void* records, size_t count, size_t recordSize );
+			void	writeAll( const void* data, size_t size, uint64_t offset );
+
+			int					_fd;
+			SlamMapFileHeader	_header;
+	};
+}
+
+#endif
@@ -27,6 +27,7 @@
 namespace cvt
 {
     KLTTracking::KLTTracking() :
+        _patches( 1 ),
         _ssdThreshold( Math::sqr( 30.0f ) ),
         _sadThreshold( 30 )
     {
@@ -43,40 +44,31 @@ namespace cvt
                                      const std::vector<size_t>&		predictedIds,
                                      const ImagePyramid&            pyr )
     {
-        SIMD* simd = SIMD::instance();
-        const size_t nPixels = Math::sqr( PatchType::size() );
-        const float  maxSSD = nPixels * _ssdThreshold;
-        const size_t maxSAD = nPixels * _sadThreshold;
-
-        Vector2f center;
-
+        _tracks.clear();
+        _tracks.reserve( predictedPositions.size() );
         for( size_t i = 0; i < predictedPositions.size(); i++ ){
-            const Vector2f& p = predictedPositions[ i ];
-
             size_t id = predictedIds[ i ];
-            //  get the patch
-            PatchType* patch = _patchForId[ id ];
-
-            if( patch == 0 ){
+            if( id >= _patches.size() || !_patches.isValid( id ) ){
                 // this was a bad PATCH
                 continue;
             }
-
             // start from predicted position
-            patch->initPose( p );
-
-            //  try to track the patch
-            if( patch->align( pyr, 5 ) ){
-                // successfully tracked: check SSD, SAD values
-                float ssd = simd->SSD( patch->pixels(), patch->transformed(), nPixels );
-                if( ssd < maxSSD ){
-                    size_t sad = simd->SAD( patch->pixels(), patch->transformed(), nPixels );
-                    if( sad < maxSAD ){
-                        patch->currentCenter( center );
-                        trackedPositions.add( Vector2d( center.x, center.y ) );
-                        trackedFeatureIds.push_back( id );
-                    }
-                }
+            _tracks.push_back( BatchType::Track( id, predictedPositions[ i ] ) );
+        }
+
+        if( _tracks.empty() ){
+            _stats.reset();
+            return;
+        }
+
+        // align all patches at once, SSD and SAD are checked per pixel
+        _patches.track( _tracks, pyr, 5, _ssdThreshold, _sadThreshold, 1e-3f, &_stats );
+
+        for( size_t i = 0; i < _tracks.size(); i++ ){
+            const BatchType::Track& t = _tracks[ i ];
+            if( t.status == BatchType::TRACKED ){
+                trackedPositions.add( Vector2d( t.position.x, t.position.y ) );
+                trackedFeatureIds.push_back( t.index );
             }
         }
     }
@@ -86,31 +78,23 @@ namespace cvt
                                             const ImagePyramid& pyrGradY,
                                             const Vector2f & f, size_t id )
     {
-        std::vector<PatchType*> patches;
-        std::vector<Vector2f>  feature;
-        feature.push_back( f );
-
-        PatchType::extractPatches( patches, feature, pyr, pyrGradX, pyrGradY );
-
-        if( id != _patchForId.size() ){
+        if( id != _patches.size() ){
             throw CVTException( "Patch IDs out of sync" );
         }
 
+        if( _patches.size() == 0 && _patches.numOctaves() != pyr.octaves() )
+            _patches = BatchType( pyr.octaves() );
+
         // FIXME: shall we handle this differently?
         // Problem: Map has already added feature with id at this point
-        if( patches.size() )
-            _patchForId.push_back( patches[ 0 ] );
-        else
-            _patchForId.push_back( 0 );
-
+        // -> bad patches keep their slot but are marked invalid
+        _patches.add( pyr, pyrGradX, pyrGradY, f );
     }
 
 
     void KLTTracking::clear()
     {
-        for( size_t i = 0; i < _patchForId.size(); i++ ){
-            delete _patchForId[ i ];
-        }
-        _patchForId.clear();
+        _patches.clear();
+        _tracks.clear();
     }
 }
@@ -27,7 +27,7 @@
 
 #include <cvt/vision/slam/stereo/FeatureTracking.h>
 #include <cvt/vision/slam/stereo/DescriptorDatabase.h>
-#include <cvt/vision/KLTPatch.h>
+#include <cvt/vision/KLTPatchBatch.h>
 #include <cvt/math/GA2.h>
 
 
@@ -75,12 +75,20 @@ namespace cvt
                 throw CVTException( "NOT IMPLEMENTED" );
             }
 
+            /**
+             * \brief statistics of the last trackFeatures call
+             */
+            const KLTTrackingStats& lastStats() const { return _stats; }
+
         private:
             typedef GA2<float>          PoseType;
             static const size_t         PatchSize = 16;
-            typedef KLTPatch<PatchSize, PoseType> PatchType;
+            typedef KLTPatchBatch<PatchSize, PoseType> BatchType;
 
-            std::vector<PatchType*>     _patchForId;
+            /* the patch of feature id is stored at index id */
+            BatchType                   _patches;
+            std::vector<BatchType::Track> _tracks;
+            KLTTrackingStats            _stats;
             float                       _ssdThreshold;
             float                       _sadThreshold;
     };
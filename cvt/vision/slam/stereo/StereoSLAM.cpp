@@ -35,18 +35,143 @@
 #include <cvt/vision/features/RowLookupTable.h>
 #include <cvt/vision/slam/stereo/FeatureAnalyzer.h>
 #include <cvt/util/Time.h>
+#include <cvt/util/ParallelFor.h>
+#include <cvt/util/Profiler.h>
+#include <algorithm>
 
 namespace cvt
 {
+    StereoSLAM::StereoFrame::StereoFrame( const Params& params, const FeatureDescriptorExtractor& extractor ) :
+       pyrLeft( params.pyramidOctaves, params.pyramidScaleFactor ),
+       pyrRight( params.pyramidOctaves, params.pyramidScaleFactor ),
+       descLeft( extractor.clone() ),
+       descRight( extractor.clone() ),
+       debug( false )
+    {
+    }
+
+    StereoSLAM::StereoFrame::~StereoFrame()
+    {
+        delete descLeft;
+        delete descRight;
+    }
+
+    struct StereoSLAM::ExtractFeaturesTask {
+        ExtractFeaturesTask( StereoSLAM& slam, StereoFrame& frame, const Image& left, const Image& right ) :
+            _slam( slam ), _frame( frame ), _left( left ), _right( right )
+        {
+        }
+
+        void operator()( size_t begin, size_t end )
+        {
+            for( size_t side = begin; side < end; side++ )
+                _slam.extractFeatures( _frame, side, side ? _right : _left );
+        }
+
+        StereoSLAM&  _slam;
+        StereoFrame& _frame;
+        const Image& _left;
+        const Image& _right;
+    };
+
+    StereoSLAM::FrameProcessor::FrameProcessor( StereoSLAM& slam ) :
+        _slam( slam ),
+        _frame( 0 ),
+        _started( false ),
+        _stop( false ),
+        _failed( false )
+    {
+    }
+
+    StereoSLAM::FrameProcessor::~FrameProcessor()
+    {
+        if( !_started )
+            return;
+        _mutex.lock();
+        _stop = true;
+        _cond.notifyAll();
+        _mutex.unlock();
+        join();
+    }
+
+    void StereoSLAM::FrameProcessor::start( StereoFrame* frame )
+    {
+        ScopeLock lock( &_mutex );
+        _frame = frame;
+        _failed = false;
+        // the worker is only created for the pipelined mode
+        if( !_started ){
+            run( &_slam );
+            _started = true;
+        }
+        _cond.notifyAll();
+    }
+
+    void StereoSLAM::FrameProcessor::execute( StereoSLAM* slam )
+    {
+        _mutex.lock();
+        while( true ){
+            while( !_frame && !_stop )
+                _cond.wait( _mutex );
+            if( !_frame )
+                break;
+
+            StereoFrame* frame = _frame;
+            _mutex.unlock();
+
+            // nothing may escape the thread, the caller gets the error from wait()
+            bool failed = false;
+            Exception error;
+            try {
+                slam->preprocessFrame( *frame, frame->imgLeft, frame->imgRight );
+            } catch( const Exception& e ){
+                failed = true;
+                error = e;
+            } catch( const std::exception& e ){
+                failed = true;
+                error = CVTException( e.what() );
+            } catch( ... ){
+                failed = true;
+                error = CVTException( "Unknown error in the frame preprocessing" );
+            }
+
+            _mutex.lock();
+            _failed = failed;
+            _error = error;
+            _frame = 0;
+            _cond.notifyAll();
+        }
+        _mutex.unlock();
+    }
+
+    void StereoSLAM::FrameProcessor::wait()
+    {
+        ScopeLock lock( &_mutex );
+        while( _frame )
+            _cond.wait( _mutex );
+        if( _failed ){
+            _failed = false;
+            throw _error;
+        }
+    }
+
+    bool StereoSLAM::FrameProcessor::isRunning()
+    {
+        ScopeLock lock( &_mutex );
+        return _frame != 0;
+    }
+
     StereoSLAM::StereoSLAM( FeatureDetector* detector,
                             FeatureDescriptorExtractor* descExtractor,
                             const StereoCameraCalibration &calib ,
                             const Params &params ):
+       _params( params ),
        _detector( detector ),
-       _descExtractorLeft( descExtractor ),
-       _descExtractorRight( descExtractor->clone() ),
-       _pyrLeft( _params.pyramidOctaves, _params.pyramidScaleFactor ),
-       _pyrRight( _params.pyramidOctaves, _params.pyramidScaleFactor ),
+       _detectorRight( detector->clone() ),
+       _current( 0 ),
+       _frameProcessor( *this ),
+       _nextPending( false ),
+       _numDropped( 0 ),
        _pyrLeftf( _params.pyramidOctaves, _params.pyramidScaleFactor ),
        _pyrRightf( _params.pyramidOctaves, _params.pyramidScaleFactor ),
        _gradXl( _params.pyramidOctaves, _params.pyramidScaleFactor ),
@@ -54,12 +179,14 @@ namespace cvt
        _kernelGx( IKernel::HAAR_HORIZONTAL_3 ),
        _kernelGy( IKernel::HAAR_VERTICAL_3 ),
        _calib( calib ),
-       _activeKF( -1 ),
-       _params( params )
+       _activeKF( -1 )
     {
         _kernelGx.scale( -0.5f );
         _kernelGy.scale( -0.5f );
 
+        _frames[ 0 ] = new StereoFrame( _params, *descExtractor );
+        _frames[ 1 ] = new StereoFrame( _params, *descExtractor );
+
         _keyframeRelativePose.setIdentity();
 
         Eigen::Matrix3d K;
@@ -68,19 +195,88 @@ namespace cvt
         _map.setIntrinsics( K );
     }
 
-    void StereoSLAM::newImages( const Image& imgLeftGray, const Image& imgRightGray )
+    StereoSLAM::~StereoSLAM()
+    {
+        if( _nextPending ){
+            // the frame is discarded anyway
+            try {
+                _frameProcessor.wait();
+            } catch( const Exception& ){
+            }
+        }
+
+        delete _frames[ 0 ];
+        delete _frames[ 1 ];
+        delete _detectorRight;
+    }
+
+    bool StereoSLAM::newImages( const Image& imgLeftGray, const Image& imgRightGray )
     {
         CVT_ASSERT( imgLeftGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
         CVT_ASSERT( imgRightGray.format() == IFormat::GRAY_UINT8, "INPUT IMAGES NEED TO BE GRAY_UINT8" );
 
-        // prepare debug image
-        imgLeftGray.convert( _debugMono, IFormat::RGBA_UINT8 );
+        if( !_params.pipelined ){
+            // a frame may be left over from the pipelined mode
+            flush();
+
+            StereoFrame& frame = *_frames[ 0 ];
+            frame.debug = trackedFeatureImage.numDelegates() > 0;
+            preprocessFrame( frame, imgLeftGray, imgRightGray );
+            trackFrame( frame );
+            return true;
+        }
+
+        bool trackPrevious = _nextPending;
+        if( _nextPending ){
+            // never queue more than one frame
+            if( _params.dropFrames && _frameProcessor.isRunning() ){
+                _numDropped++;
+                CVT_PROFILE_COUNTER( "StereoSLAM::droppedFrames", _numDropped );
+                return false;
+            }
+            // a frame that failed to preprocess is dropped
+            _nextPending = false;
+            _frameProcessor.wait();
+            std::swap( _frames[ 0 ], _frames[ 1 ] );
+        }
+
+        // the caller may reuse the images, keep a copy for the processor
+        StereoFrame& next = *_frames[ 1 ];
+        next.imgLeft = imgLeftGray;
+        next.imgRight = imgRightGray;
+        next.debug = trackedFeatureImage.numDelegates() > 0;
+        _frameProcessor.start( &next );
+        _nextPending = true;
+
+        // track the previous frame meanwhile
+        if( trackPrevious )
+            trackFrame( *_frames[ 0 ] );
+        return true;
+    }
+
+    void StereoSLAM::flush()
+    {
+        if( !_nextPending )
+            return;
+
+        _nextPending = false;
+        _frameProcessor.wait();
+        std::swap( _frames[ 0 ], _frames[ 1 ] );
+        trackFrame( *_frames[ 0 ] );
+    }
 
-        // detect current keypoints and extract descriptors
-        extractFeatures( imgLeftGray, imgRightGray );
+    void StereoSLAM::preprocessFrame( StereoFrame& frame, const Image& left, const Image& right )
+    {
+        CVT_PROFILE_ZONE( "StereoSLAM::preprocessFrame" );
+        // left and right image are independent
+        ExtractFeaturesTask task( *this, frame, left, right );
+        ParallelFor::run( task, 0, 2, 1 );
+    }
 
-        std::cout << "CurrentFeatures Left: "  << _descExtractorLeft->size() << std::endl;
-        std::cout << "CurrentFeatures Right: " << _descExtractorRight->size() << std::endl;
+    void StereoSLAM::trackFrame( StereoFrame& frame )
+    {
+        CVT_PROFILE_ZONE( "StereoSLAM::trackFrame" );
+        _current = &frame;
 
         // predict current visible features by projecting with current estimate of pose
         std::vector<Vector2f>           predictedPositions;
@@ -112,18 +308,22 @@ namespace cvt
                                 predictedFeatureIds );
 
         size_t numTrackedFeatures = tracked.size();
+        CVT_PROFILE_HISTOGRAM( "StereoSLAM::trackedFeatures", numTrackedFeatures );
         numTrackedPoints.notify( numTrackedFeatures );
 
-        createDebugImageMono1( _debugMono,
-                               tracked,
-                               predictedPositions,
-                               matchedIndices,
-                               predictedFeatureIds );
+        if( frame.debug ){
+            createDebugImageMono1( frame.debugImage,
+                                   tracked,
+                                   predictedPositions,
+                                   matchedIndices,
+                                   predictedFeatureIds );
 
-        trackedFeatureImage.notify( _debugMono );
+            trackedFeatureImage.notify( frame.debugImage );
+        }
 
         std::vector<size_t> trackingInliers;
         estimateCameraPose( trackingInliers, tracked.points3d, tracked.points2d );
+        CVT_PROFILE_HISTOGRAM( "StereoSLAM::inliers", trackingInliers.size() );
 
         // pose estimate was bad / not enough inliers available:
         if ( trackingInliers.size() == 0 ) {
@@ -146,72 +346,66 @@ namespace cvt
                             trackingInliers );
         }
 
-        int last = _activeKF;
         poseEigen = _pose.transformation().cast<double>();
         _activeKF = _map.findClosestKeyframe( poseEigen );
-        if ( _activeKF != last ) {
-            std::cout << "Active KF: " << _activeKF << std::endl;
-        }
 
         // update relative pose:
         Eigen::Matrix4d kfPose = _map.keyframeForId( _activeKF ).pose().transformation();
 
-        std::cout << "Keyframe Pose: " << kfPose << std::endl;
         // transform the relative pose into
         _keyframeRelativePose = poseEigen * kfPose.inverse();
-
-        std::cout << "Relative Pose " << _keyframeRelativePose << std::endl;
    }
 
-   void StereoSLAM::extractFeatures( const Image& left, const Image& right )
+   void StereoSLAM::extractFeatures( StereoFrame& frame, size_t side, const Image& img )
    {
-	   // update image pyramid(s)
-	   _pyrLeft.update( left );
-	   _pyrRight.update( right );
+	   CVT_PROFILE_ZONE( "StereoSLAM::extractFeatures" );
+	   ImagePyramid& pyr = side ? frame.pyrRight : frame.pyrLeft;
+	   FeatureDetector* detector = side ? _detectorRight : _detector;
+	   FeatureDescriptorExtractor* extractor = side ? frame.descRight : frame.descLeft;
+
+	   // debug output is drawn into the left image only
+	   Image* debugImg = NULL;
+	   if( side == 0 && frame.debug ){
+		   img.convert( frame.debugImage, IFormat::RGBA_UINT8 );
+		   debugImg = &frame.debugImage;
+	   }
+
+	   // update image pyramid
+	   pyr.update( img );
 
-	   // detect features in current left frame
-	   FeatureSet leftFeatures, rightFeatures;
-	   _detector->detect( leftFeatures, _pyrLeft );
-	   _detector->detect( rightFeatures, _pyrRight );
+	   // detect features in current frame
+	   FeatureSet features;
+	   detector->detect( features, pyr );
 
-       if ( _params.dbgShowFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLUE );
+       if ( debugImg && _params.dbgShowFeatures ) {
+           debugImageDrawFeatures( *debugImg, features, Color::BLUE );
        }
 
        const int NMS_RADIUS( _params.nonMaximumSuppressionRadius );
-	   leftFeatures.filterNMS( NMS_RADIUS, true );
-	   rightFeatures.filterNMS( NMS_RADIUS, true );
+	   features.filterNMS( NMS_RADIUS, true );
 
-       if ( _params.dbgShowNMSFilteredFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::BLACK );
+       if ( debugImg && _params.dbgShowNMSFilteredFeatures ) {
+           debugImageDrawFeatures( *debugImg, features, Color::BLACK );
        }
 
 	   const int X_CELLS = _params.gridFilteringCellsX;
 	   const int Y_CELLS = _params.gridFilteringCellsY;
 	   const int MAX_CELL_FEATURES = _params.maxFeaturesPerCell;
        if ( _params.useGridFiltering ) {
-           leftFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
-           rightFeatures.filterGrid( _pyrLeft[ 0 ].width(), _pyrLeft[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
+           features.filterGrid( pyr[ 0 ].width(), pyr[ 0 ].height(), X_CELLS, Y_CELLS, MAX_CELL_FEATURES );
        } else {
-            leftFeatures.filterBest( _params.bestFeaturesCount, true );
-            rightFeatures.filterBest( _params.bestFeaturesCount, true );
+            features.filterBest( _params.bestFeaturesCount, true );
        }
 
-	   leftFeatures.sortPosition();
-	   rightFeatures.sortPosition();
+	   features.sortPosition();
 
-       if ( _params.dbgShowBest3kFeatures ) {
-           debugImageDrawFeatures( _debugMono, leftFeatures, Color::GRAY );
+       if ( debugImg && _params.dbgShowBest3kFeatures ) {
+           debugImageDrawFeatures( *debugImg, features, Color::GRAY );
        }
 
-       std::cout << "Left: "<< leftFeatures.size() << " - Right: " << rightFeatures.size() << std::endl;
-
 	   // extract the descriptors
-	   _descExtractorLeft->clear();
-	   _descExtractorLeft->extract( _pyrLeft, leftFeatures );
-
-	   _descExtractorRight->clear();
-	   _descExtractorRight->extract( _pyrRight, rightFeatures );
+	   extractor->clear();
+	   extractor->extract( pyr, features );
    }
 
    void StereoSLAM::predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
@@ -220,14 +414,13 @@ namespace cvt
 											std::vector<PatchType*>& patches,
 											const Eigen::Matrix4d& cameraPose )
    {
+	   CVT_PROFILE_ZONE( "StereoSLAM::predictVisibleFeatures" );
 	   _map.selectVisibleFeatures( ids,
 								   imgPositions,
 								   cameraPose,
 								   _calib.firstCamera(),
 								   _params.keyframeSelectionRadius );
 
-	   std::cout << "Visible points from map (Selected points): " << ids.size() << std::endl;
-
 	   // get the corresponding descriptors
 	   _descriptorDatabase.descriptorsAndPatchesForIds( descriptors, patches, ids );
 	   for( size_t i = 0; i < descriptors.size(); ++i ){
@@ -241,12 +434,13 @@ namespace cvt
                                              std::vector<StereoSLAM::PatchType*>& predictedPatches,
                                              const std::vector<size_t>& predictedIds )
     {
-        _pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT  );
+        CVT_PROFILE_ZONE( "StereoSLAM::trackPredictedFeatures" );
+        _current->pyrLeft.convert( _pyrLeftf, IFormat::GRAY_FLOAT  );
 
 
         // match with current left features
-        RowLookupTable rlt( *_descExtractorLeft );
-        _descExtractorLeft->matchInWindow( matchedIndices,
+        RowLookupTable rlt( *_current->descLeft );
+        _current->descLeft->matchInWindow( matchedIndices,
                                            rlt,
                                            predictedDescriptors,
                                            _params.matchingWindow,
@@ -262,7 +456,7 @@ namespace cvt
             PatchType* patch = predictedPatches[ m.srcIdx ];
 
 
-            const Vector2f& pt = ( *_descExtractorLeft )[ m.dstIdx ].pt;
+            const Vector2f& pt = ( *_current->descLeft )[ m.dstIdx ].pt;
 
             // TODO: try to only update the position and keep the rest of the patch pose
             //       the idea would be, that the last alignment/oriantation of this patch
@@ -292,9 +486,9 @@ namespace cvt
 
     void StereoSLAM::estimateCameraPose( std::vector<size_t>& inlierIndices, const PointSet3f & p3d, const PointSet2f& p2d )
     {
+        CVT_PROFILE_ZONE( "StereoSLAM::estimateCameraPose" );
         if ( p3d.size() < 6 ){
             // too few features -> lost track: relocalization needed
-            std::cout << "Too few features tracked - relocalization needed" << std::endl;
             return;
         }
 
@@ -310,22 +504,13 @@ namespace cvt
         Matrix4f estimated;
         estimated.setIdentity();
 
-        float inlierPercentage( 0.0f );        
         estimated = ransac.estimate( 5000 );
-        inlierPercentage = ( float )ransac.inlierIndices().size() / ( float )p3d.size();
-
-        std::cout << "Inlier Percentage: " << inlierPercentage << " (RANSAC inliers: " <<
-                     ransac.inlierIndices().size() << ")\n";
-
-        std::cout << "EPnP: Estimated Pose: \n" << estimated << std::endl;
-
         inlierIndices = ransac.inlierIndices();
 
         ReprojectionError<float> reprError( p3d, p2d, 10, 0.05f );
         Huberf estimator;
         estimator.setThreshold( 1.0f );
         reprError.minimize( estimated, inlierIndices, k, estimator );
-        std::cout << "Refined Pose: \n" << estimated << std::endl;
 
         _pose.set( estimated );
         newCameraPose.notify( estimated );
@@ -337,14 +522,15 @@ namespace cvt
 										   const std::vector<size_t>& trackingInliers,
 										   const std::vector<MatchingIndices>& matchedIndices )
    {
+       CVT_PROFILE_ZONE( "StereoSLAM::initNewStereoFeatures" );
        // sort out free features (currently not tracked)
 	   std::vector<const FeatureDescriptor*> freeFeaturesLeft;
-	   sortOutFreeFeatures( freeFeaturesLeft, _descExtractorLeft, trackingInliers, matchedIndices );
+	   sortOutFreeFeatures( freeFeaturesLeft, _current->descLeft, trackingInliers, matchedIndices );
 
 	   // try to match the free features with right frame
 	   std::vector<FeatureMatch> stereoMatches;
-       RowLookupTable rltRight( *_descExtractorRight );
-	   _descExtractorRight->scanLineMatch( stereoMatches,
+       RowLookupTable rltRight( *_current->descRight );
+	   _current->descRight->scanLineMatch( stereoMatches,
                                            rltRight,
 										   freeFeaturesLeft,
 										   _params.minDisparity,
@@ -352,7 +538,7 @@ namespace cvt
 										   _params.stereoMaxDescDistance,
 										   _params.maxEpilineDistance );
 
-	   if ( _params.dbgShowStereoMatches ) {
+	   if ( _params.dbgShowStereoMatches && newStereoMatches.numDelegates() ) {
 		   Image debugImg;
 		   createStereoMatchingDebugImage( debugImg, stereoMatches );
 		   newStereoMatches.notify( debugImg );
@@ -361,7 +547,7 @@ namespace cvt
 	   // left is already converted to float
 	   _pyrLeftf.convolve( _gradXl, _kernelGx );
 	   _pyrLeftf.convolve( _gradYl, _kernelGy );
-	   _pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT );
+	   _current->pyrRight.convert( _pyrRightf, IFormat::GRAY_FLOAT );
 	   // maybe also update the patches of the currently tracked features
 
 	   // subpixel refinement of the stereo matches
@@ -378,7 +564,7 @@ namespace cvt
 	   float bd = 0.0f;
        //int counter = 0;
 	   for( size_t i = 0; i < stereoMatches.size(); ++i ){
-		   DescriptorDatabase::PatchType* patch = new DescriptorDatabase::PatchType( _pyrLeft.octaves() );
+		   DescriptorDatabase::PatchType* patch = new DescriptorDatabase::PatchType( _current->pyrLeft.octaves() );
 		   const FeatureMatch& m = stereoMatches[ i ];
 		   const Vector2f& posL = m.feature0->pt;
 		   const Vector2f& posR = m.feature1->pt;
@@ -461,9 +647,9 @@ namespace cvt
 									const std::vector<size_t>& trackedMapIds,
 									const std::vector<size_t>& inliers )
    {
+	   CVT_PROFILE_ZONE( "StereoSLAM::addNewKeyframe" );
 	   // a new keyframe should have a minimum number of features
 	  if( ( newPoints3d.size() + trackedMapPoints.size() ) < _params.minFeaturesForKeyframe ){
-		  std::cout << "Could only triangulate " << newPoints3d.size() << " new features " << std::endl;
 		  return;
 	  }
 	  // wait until current ba thread is ready
@@ -473,7 +659,6 @@ namespace cvt
 
 	  keyframeAdded.notify();
 	  mapChanged.notify( _map );
-	  std::cout << "Triangulated: " << newPoints3d.size() << std::endl;
 	   // add a new Keyframe to the map
 	   Eigen::Matrix4d transform( _pose.transformation().cast<double>() );
 
@@ -533,12 +718,10 @@ namespace cvt
 
 	  // if distance is too far from active, always create a new one:
 	  if( kfDist > _params.maxKeyframeDistance ){
-		  std::cout << "New keyframe needed - too far from active keyframe: " << kfDist << std::endl;
 		  return true;
 	  }
 
 	  if( numTrackedFeatures < _params.minTrackedFeatures ){
-		  std::cout << "New keyframe needed - too few inliers: " << numTrackedFeatures << std::endl;
 		  return true;
 	  }
 
@@ -584,7 +767,7 @@ namespace cvt
             const MatchingIndices& m = matchedIndices[ i ];
 
             // draw the current feature here:
-            const Vector2f& p = ( *_descExtractorLeft )[ m.dstIdx ].pt;
+            const Vector2f& p = ( *_current->descLeft )[ m.dstIdx ].pt;
             g.setColor( Color::PINK );
             g.fillRect( ( int )p.x - 2, ( int )p.y - 2, 5, 5 );
 
@@ -629,8 +812,8 @@ namespace cvt
         typedef std::vector<FeatureMatch> FeatureMatches;
 
         cvt::Image left, right;
-        _pyrLeft[ 0 ].convert( left, IFormat::RGBA_UINT8 );
-        _pyrRight[ 0 ].convert( right, IFormat::RGBA_UINT8 );
+        _current->pyrLeft[ 0 ].convert( left, IFormat::RGBA_UINT8 );
+        _current->pyrRight[ 0 ].convert( right, IFormat::RGBA_UINT8 );
 
 
         debugImage.reallocate( left.width(),
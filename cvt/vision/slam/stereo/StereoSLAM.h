@@ -36,6 +36,9 @@
 #include <cvt/vision/StereoCameraCalibration.h>
 #include <cvt/vision/slam/stereo/FeatureTracking.h>
 #include <cvt/vision/slam/stereo/MapOptimizer.h>
+#include <cvt/util/Thread.h>
+#include <cvt/util/Mutex.h>
+#include <cvt/util/Condition.h>
 #include <set>
 
 namespace cvt
@@ -73,7 +76,9 @@ namespace cvt
 				   dbgShowFeatures( false ),
 				   dbgShowNMSFilteredFeatures( false ),
 				   dbgShowBest3kFeatures( false ),
-				   dbgShowStereoMatches( false )
+				   dbgShowStereoMatches( false ),
+				   pipelined( false ),
+				   dropFrames( false )
 				{
 				}
 
@@ -122,22 +127,49 @@ namespace cvt
 				bool dbgShowNMSFilteredFeatures;
 				bool dbgShowBest3kFeatures;
 				bool dbgShowStereoMatches;
+
+				/* overlap the preprocessing (pyramids, features, descriptors)
+				 * of a frame with the tracking of the previous one: the results
+				 * of a frame are available after the next call to newImages
+				 * or after flush() */
+				bool pipelined;
+
+				/* bounded latency for the pipelined mode: drop new frames while
+				 * the preprocessing of the previous one is not finished instead
+				 * of waiting for it */
+				bool dropFrames;
 		   };
 
+		   /**
+			* @param detector		detector for the left image, cloned for the right one.
+			*						Stays owned by the caller and has to outlive the StereoSLAM
+			* @param descExtractor	prototype only: every pipeline slot and side uses its own clone,
+			*						the object itself is not used after construction and stays
+			*						owned by the caller
+			*/
 		   StereoSLAM( FeatureDetector* detector,
 					   FeatureDescriptorExtractor* descExtractor,
 					   const StereoCameraCalibration& calib,
 					   const Params& params=Params());
-
+		   ~StereoSLAM();
 
 		 /**
 		  * @brief newImages
 		  * @param imgLeft	undistorted-rectified left frame
 		  * @param imgRight undistorted-rectified right frame
+		  * @return false if the frame was dropped (pipelined mode with dropFrames)
 		  */
-		 void				newImages( const Image& imgLeft,
+		 bool				newImages( const Image& imgLeft,
 									   const Image& imgRight );
 
+		 /**
+		  * @brief track the frame still in the pipeline (pipelined mode)
+		  */
+		 void				flush();
+
+		 /* number of frames dropped in pipelined mode */
+		 size_t				numDroppedFrames() const { return _numDropped; }
+
 		 const SlamMap&		map() const { return _map; }
 
 		 void				clear();
@@ -175,14 +207,68 @@ namespace cvt
 			size_t size() const { return points3d.size(); }
 		 };
 
+		 /* preprocessed stereo frame */
+		 struct StereoFrame {
+			StereoFrame( const Params& params, const FeatureDescriptorExtractor& extractor );
+			~StereoFrame();
+
+			ImagePyramid				pyrLeft;
+			ImagePyramid				pyrRight;
+			FeatureDescriptorExtractor* descLeft;
+			FeatureDescriptorExtractor* descRight;
+
+			/* input copies for the pipelined mode */
+			Image						imgLeft;
+			Image						imgRight;
+
+			/* only created if someone listens to trackedFeatureImage */
+			bool						debug;
+			Image						debugImage;
+
+			private:
+				StereoFrame( const StereoFrame& );
+				StereoFrame& operator=( const StereoFrame& );
+		 };
+
+		 /* ParallelFor functor for the left and right image */
+		 struct ExtractFeaturesTask;
+
+		 /* persistent worker, preprocesses the next frame while the current one is tracked */
+		 class FrameProcessor : public Thread<StereoSLAM>
+		 {
+			public:
+				FrameProcessor( StereoSLAM& slam );
+				~FrameProcessor();
+
+				void execute( StereoSLAM* slam );
+				void start( StereoFrame* frame );
+				/* waits for the frame, rethrows the exception of the preprocessing */
+				void wait();
+				bool isRunning();
+
+			private:
+				StereoSLAM&  _slam;
+				Mutex		 _mutex;
+				Condition	 _cond;
+				StereoFrame* _frame;
+				bool		 _started;
+				bool		 _stop;
+				bool		 _failed;
+				Exception	 _error;
+		 };
+
 		 typedef DescriptorDatabase::PatchType	PatchType;
 		 Params						 _params;
 		 FeatureDetector*			 _detector;
-		 FeatureDescriptorExtractor* _descExtractorLeft;
-		 FeatureDescriptorExtractor* _descExtractorRight;
+		 FeatureDetector*			 _detectorRight;
 		 DescriptorDatabase			 _descriptorDatabase;
-		 ImagePyramid				 _pyrLeft;
-		 ImagePyramid				 _pyrRight;
+
+		 /* _frames[ 0 ]: current frame, _frames[ 1 ]: next frame in the pipeline */
+		 StereoFrame*				 _frames[ 2 ];
+		 StereoFrame*				 _current;
+		 FrameProcessor				 _frameProcessor;
+		 bool						 _nextPending;
+		 size_t						 _numDropped;
 
 		 /* float versions for KLT */
 		 ImagePyramid				 _pyrLeftf;
@@ -201,10 +287,10 @@ namespace cvt
          Eigen::Matrix4d             _keyframeRelativePose;
 		 SlamMap					 _map;
 		 MapOptimizer				 _bundler;
-		 Image						 _lastImage;
-		 Image						 _debugMono;
 
-		 void extractFeatures( const Image& left, const Image& right );
+		 void preprocessFrame( StereoFrame& frame, const Image& left, const Image& right );
+		 void extractFeatures( StereoFrame& frame, size_t side, const Image& img );
+		 void trackFrame( StereoFrame& frame );
 
 		 void predictVisibleFeatures( std::vector<Vector2f>& imgPositions,
 									  std::vector<size_t>& ids,
@@ -0,0 +1,180 @@
+/*
+   The MIT License (MIT)
+
+   Copyright (c) 2011 - 2013, Philipp Heise and Sebastian Klose
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include <cvt/vision/slam/stereo/StereoSLAM.h>
+#include <cvt/vision/features/FAST.h>
+#include <cvt/vision/features/ORB.h>
+#include <cvt/gfx/IMapScoped.h>
+#include <cvt/gfx/IScaleFilter.h>
+#include <cvt/util/RNG.h>
+#include <cvt/util/CVTTest.h>
+
+namespace cvt {
+
+	/* blocky random texture with enough corners */
+	static void _slamTexture( Image& tex, size_t w, size_t h )
+	{
+		tex.reallocate( w, h, IFormat::GRAY_UINT8 );
+		RNG rng( 42 );
+		{
+			IMapScoped<uint8_t> map( tex );
+			for( size_t y = 0; y < h; y++ ){
+				uint8_t* p = map.ptr();
+				for( size_t x = 0; x < w; x++ )
+					p[ x ] = ( uint8_t ) rng.uniform( 0, 255 );
+				map++;
+			}
+		}
+		Image tmp( w / 4, h / 4, IFormat::GRAY_UINT8 );
+		tex.scale( tmp, w / 4, h / 4, IScaleFilterBilinear() );
+		tmp.scale( tex, w, h, IScaleFilterBilinear() );
+	}
+
+	static StereoCameraCalibration _slamCalibration()
+	{
+		CameraCalibration c0, c1;
+		c0.setIntrinsics( 500.0f, 500.0f, 320.0f, 240.0f );
+		c1.setIntrinsics( 500.0f, 500.0f, 320.0f, 240.0f );
+		c0.setWidth( 640 );
+		c0.setHeight( 480 );
+		c1.setWidth( 640 );
+		c1.setHeight( 480 );
+		Matrix4f ext;
+		ext.setIdentity();
+		ext[ 0 ][ 3 ] = -0.1f;
+		c1.setExtrinsics( ext );
+		return StereoCameraCalibration( c0, c1 );
+	}
+
+	struct SlamPoses {
+		std::vector<Matrix4f> poses;
+		void add( const Matrix4f& pose ) { poses.push_back( pose ); }
+	};
+
+	static void _slamRun( StereoSLAM& slam, const Image& tex, size_t numFrames )
+	{
+		Image left, right;
+		for( size_t i = 0; i < numFrames; i++ ){
+			int x = 100 + 2 * i;
+			int y = 100 + i;
+			left.reallocate( 640, 480, IFormat::GRAY_UINT8 );
+			right.reallocate( 640, 480, IFormat::GRAY_UINT8 );
+			left.copyRect( 0, 0, tex, Recti( x, y, 640, 480 ) );
+			right.copyRect( 0, 0, tex, Recti( x + 20, y, 640, 480 ) );
+			slam.newImages( left, right );
+		}
+		slam.flush();
+	}
+
+	static bool _slamSameMap( const SlamMap& a, const SlamMap& b )
+	{
+		if( a.numKeyframes() != b.numKeyframes() || a.numFeatures() != b.numFeatures() || a.numMeasurements() != b.numMeasurements() )
+			return false;
+		for( size_t i = 0; i < a.numKeyframes(); i++ ){
+			if( a.keyframeForId( i ).pose().transformation() != b.keyframeForId( i ).pose().transformation() )
+				return false;
+		}
+		for( size_t i = 0; i < a.numFeatures(); i++ ){
+			if( a.featureForId( i ).estimate() != b.featureForId( i ).estimate() )
+				return false;
+		}
+		return true;
+	}
+
+	/* detector failing on every image */
+	class FailingDetector : public FeatureDetector {
+		public:
+			FeatureDetector* clone() const { return new FailingDetector(); }
+			void detect( FeatureSet&, const Image& ) { throw CVTException( "detector failure" ); }
+			void detect( FeatureSet&, const ImagePyramid& ) { throw CVTException( "detector failure" ); }
+			void setBorder( size_t ) {}
+			size_t border() const { return 0; }
+	};
+
+	static bool _slamFailure( bool pipelined )
+	{
+		FailingDetector detector;
+		ORB orb;
+		StereoSLAM::Params params;
+		params.pipelined = pipelined;
+		StereoSLAM slam( &detector, &orb, _slamCalibration(), params );
+		Image img( 640, 480, IFormat::GRAY_UINT8 );
+		img.fill( Color::BLACK );
+		try {
+			// pipelined: the error of the first frame shows up with the second one at the latest
+			slam.newImages( img, img );
+			slam.newImages( img, img );
+			slam.flush();
+		} catch( const Exception& e ){
+			return strstr( e.what(), "detector failure" ) != NULL;
+		}
+		return false;
+	}
+
+BEGIN_CVTTEST( StereoSLAM )
+	bool result = true;
+	bool b;
+
+	Image tex;
+	_slamTexture( tex, 1200, 900 );
+
+	FAST fast( SEGMENT_9, 20, 40 );
+	ORB orb;
+	StereoSLAM::Params params;
+	params.minDisparity = 5;
+
+	params.pipelined = false;
+	StereoSLAM sync( &fast, &orb, _slamCalibration(), params );
+	SlamPoses syncPoses;
+	Delegate<void ( const Matrix4f& )> dsync( &syncPoses, &SlamPoses::add );
+	sync.newCameraPose.add( dsync );
+	_slamRun( sync, tex, 20 );
+
+	params.pipelined = true;
+	StereoSLAM pipe( &fast, &orb, _slamCalibration(), params );
+	SlamPoses pipePoses;
+	Delegate<void ( const Matrix4f& )> dpipe( &pipePoses, &SlamPoses::add );
+	pipe.newCameraPose.add( dpipe );
+	_slamRun( pipe, tex, 20 );
+
+	b = sync.map().numKeyframes() > 0 && sync.map().numFeatures() > 0;
+	CVTTEST_PRINT( "map created", b );
+	result &= b;
+
+	b = _slamSameMap( sync.map(), pipe.map() ) && syncPoses.poses == pipePoses.poses;
+	CVTTEST_PRINT( "pipelined map equals synchronous map", b );
+	result &= b;
+
+	b = _slamFailure( false );
+	CVTTEST_PRINT( "synchronous preprocessing error", b );
+	result &= b;
+
+	b = _slamFailure( true );
+	CVTTEST_PRINT( "pipelined preprocessing error", b );
+	result &= b;
+
+	return result;
+END_CVTTEST
+
+}